@@ -0,0 +1,142 @@
+#include "bsp/display_profile.h"
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "display_profile";
+
+/* What every board registered before profiles existed: 50-line strips (in
+   internal RAM except on the 3.5"), CPU copies, drawing straight into the
+   live frame buffer. */
+static const bsp_display_profile_t conservative = {
+    .name = "conservative",
+    .buffer_height = 50,
+#if CONFIG_KERN_BOARD_WAVE_35
+    .buffer_in_psram = true,
+#endif
+    .double_buffer = false,
+    .ppa_accel = false,
+    .dpi_fb_count = 1,
+    .tear_avoid = BSP_TEAR_AVOID_NONE,
+};
+
+/* Tuned per board. MIPI DSI panels refresh from a DPI frame buffer, so they
+   get three of them and partial renders copied in by the PPA: LVGL never
+   draws into the buffer being scanned out. Draw buffers stay in internal RAM
+   (rendering is CPU-bound) at about 100 KiB, a tenth of a 720x720 frame. The
+   SPI-fed 3.5" panel has no frame buffer to swap; it gets taller strips and a
+   second buffer (both in PSRAM, like its conservative one) to render into
+   while the previous strip is sent. Opt-in until flush benchmark numbers
+   exist for each board. */
+#if CONFIG_KERN_BOARD_WAVE_4B
+static const bsp_display_profile_t board_tuned = {
+    .name = "wave_4b",
+    .buffer_height = 72,
+    .ppa_accel = true,
+    .dpi_fb_count = 3,
+    .tear_avoid = BSP_TEAR_AVOID_TRIPLE_PARTIAL,
+};
+#elif CONFIG_KERN_BOARD_WAVE_35
+static const bsp_display_profile_t board_tuned = {
+    .name = "wave_35",
+    .buffer_height = 80,
+    .buffer_in_psram = true,
+    .double_buffer = true,
+    .dpi_fb_count = 1,
+    .tear_avoid = BSP_TEAR_AVOID_NONE,
+};
+#elif CONFIG_KERN_BOARD_WAVE_5
+static const bsp_display_profile_t board_tuned = {
+    .name = "wave_5",
+    .buffer_height = 72,
+    .ppa_accel = true,
+    .dpi_fb_count = 3,
+    .tear_avoid = BSP_TEAR_AVOID_TRIPLE_PARTIAL,
+};
+#elif CONFIG_KERN_BOARD_WAVE_43
+static const bsp_display_profile_t board_tuned = {
+    .name = "wave_43",
+    .buffer_height = 100,
+    .ppa_accel = true,
+    .dpi_fb_count = 3,
+    .tear_avoid = BSP_TEAR_AVOID_TRIPLE_PARTIAL,
+};
+#elif CONFIG_KERN_BOARD_CROWPANEL
+static const bsp_display_profile_t board_tuned = {
+    .name = "crowpanel",
+    .buffer_height = 50,
+    .ppa_accel = true,
+    .dpi_fb_count = 3,
+    .tear_avoid = BSP_TEAR_AVOID_TRIPLE_PARTIAL,
+};
+#elif CONFIG_KERN_BOARD_WAVE_7B
+static const bsp_display_profile_t board_tuned = {
+    .name = "wave_7b",
+    .buffer_height = 50,
+    .ppa_accel = true,
+    .dpi_fb_count = 3,
+    .tear_avoid = BSP_TEAR_AVOID_TRIPLE_PARTIAL,
+};
+#else
+#define board_tuned conservative
+#endif
+
+#if CONFIG_BSP_DISPLAY_PROFILE_CUSTOM
+static const bsp_display_profile_t custom = {
+    .name = "custom",
+    .buffer_height = CONFIG_BSP_DISPLAY_BUFFER_HEIGHT,
+#if CONFIG_BSP_DISPLAY_BUFFER_PSRAM
+    .buffer_in_psram = true,
+#endif
+#if CONFIG_BSP_DISPLAY_DOUBLE_BUFFER
+    .double_buffer = true,
+#endif
+#if CONFIG_BSP_DISPLAY_PPA_ACCEL
+    .ppa_accel = true,
+#endif
+    .dpi_fb_count = CONFIG_BSP_LCD_DPI_BUFFER_NUMS,
+#if CONFIG_BSP_DISPLAY_TEAR_AVOID_TRIPLE_PARTIAL
+    .tear_avoid = BSP_TEAR_AVOID_TRIPLE_PARTIAL,
+#elif CONFIG_BSP_DISPLAY_TEAR_AVOID_DOUBLE_FULL
+    .tear_avoid = BSP_TEAR_AVOID_DOUBLE_FULL,
+#else
+    .tear_avoid = BSP_TEAR_AVOID_NONE,
+#endif
+};
+#endif
+
+uint8_t bsp_tear_avoid_fb_count(bsp_tear_avoid_t mode) {
+  switch (mode) {
+  case BSP_TEAR_AVOID_DOUBLE_FULL:
+    return 2;
+  case BSP_TEAR_AVOID_TRIPLE_PARTIAL:
+    return 3;
+  default:
+    return 1;
+  }
+}
+
+const bsp_display_profile_t *bsp_display_profile(void) {
+  static bsp_display_profile_t selected;
+  static bool resolved = false;
+  if (resolved)
+    return &selected;
+
+#if CONFIG_BSP_DISPLAY_PROFILE_CUSTOM
+  selected = custom;
+#elif CONFIG_BSP_DISPLAY_PROFILE_BOARD
+  selected = board_tuned;
+#else
+  selected = conservative;
+#endif
+  if (selected.dpi_fb_count < 1)
+    selected.dpi_fb_count = 1;
+  if (bsp_tear_avoid_fb_count(selected.tear_avoid) > selected.dpi_fb_count) {
+    ESP_LOGW(TAG, "%s: tear avoidance needs %u frame buffers, have %u; off",
+             selected.name, bsp_tear_avoid_fb_count(selected.tear_avoid),
+             selected.dpi_fb_count);
+    selected.tear_avoid = BSP_TEAR_AVOID_NONE;
+  }
+  resolved = true;
+  return &selected;
+}
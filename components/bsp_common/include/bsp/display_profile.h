@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* How the LVGL adapter keeps the panel from showing half-drawn frames. */
+typedef enum {
+  BSP_TEAR_AVOID_NONE,           /* draw into the live frame buffer */
+  BSP_TEAR_AVOID_DOUBLE_FULL,    /* two frame buffers, whole-screen renders */
+  BSP_TEAR_AVOID_TRIPLE_PARTIAL, /* three frame buffers, partial renders */
+} bsp_tear_avoid_t;
+
+/* Display pipeline settings a board registers its LVGL display with.
+   Selected through Kconfig (BSP_DISPLAY_PROFILE): the conservative settings
+   every board used before (the default), the board's tuned entry, or custom
+   values. */
+typedef struct {
+  const char *name;
+  uint16_t buffer_height; /* draw buffer lines */
+  bool buffer_in_psram;   /* draw buffers in PSRAM instead of internal RAM */
+  bool double_buffer;     /* render one strip while the previous flushes */
+  bool ppa_accel;         /* PPA copies/rotates into the frame buffer */
+  uint8_t dpi_fb_count;   /* DPI frame buffers; unused by non-DPI panels */
+  bsp_tear_avoid_t tear_avoid;
+} bsp_display_profile_t;
+
+/* The selected profile, checked against the frame buffers it gets: a tear
+   avoidance mode needing more than dpi_fb_count falls back to NONE. */
+const bsp_display_profile_t *bsp_display_profile(void);
+
+/* Frame buffers a tear avoidance mode needs. */
+uint8_t bsp_tear_avoid_fb_count(bsp_tear_avoid_t mode);
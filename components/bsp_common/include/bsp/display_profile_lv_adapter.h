@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bsp/display_profile.h"
+#include "esp_lv_adapter.h"
+
+/* Fills the pipeline part of a board's display registration from the
+   selected profile; the board sets panel, interface, rotation and size. */
+static inline void
+bsp_display_profile_apply(esp_lv_adapter_display_config_t *cfg) {
+  const bsp_display_profile_t *p = bsp_display_profile();
+  cfg->profile.buffer_height = p->buffer_height;
+  cfg->profile.use_psram = p->buffer_in_psram;
+  cfg->profile.enable_ppa_accel = p->ppa_accel;
+  cfg->profile.require_double_buffer = p->double_buffer;
+  switch (p->tear_avoid) {
+  case BSP_TEAR_AVOID_DOUBLE_FULL:
+    cfg->tear_avoid_mode = ESP_LV_ADAPTER_TEAR_AVOID_MODE_DOUBLE_FULL;
+    break;
+  case BSP_TEAR_AVOID_TRIPLE_PARTIAL:
+    cfg->tear_avoid_mode = ESP_LV_ADAPTER_TEAR_AVOID_MODE_TRIPLE_PARTIAL;
+    break;
+  default:
+    cfg->tear_avoid_mode = ESP_LV_ADAPTER_TEAR_AVOID_MODE_NONE;
+    break;
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_lcd_types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Video layer: a rectangle of the panel that a producer (the camera preview)
+   fills by PPA-copying each frame straight into the DPI frame buffers,
+   bypassing LVGL. Every frame buffer is written, so whichever one the tear
+   avoidance rotation scans out shows the latest frame. The P4's DSI host has
+   no overlay plane; this is its software equivalent, and the UI has to keep
+   its own flushes out of the rectangle while the layer is open (see
+   main/ui/video_view.h). Unavailable on panels without DPI frame buffers and
+   with full-refresh double buffering, which repaints the whole screen. */
+
+/* Most pieces a frame may be written in (the frame minus the UI drawn over
+   it). */
+#define BSP_VIDEO_LAYER_MAX_TILES 8
+
+typedef struct {
+  uint16_t x;
+  uint16_t y;
+  uint16_t w;
+  uint16_t h;
+} bsp_video_rect_t;
+
+/* Called by MIPI DSI boards once the DPI panel is initialised. */
+esp_err_t bsp_video_layer_attach_dpi(esp_lcd_panel_handle_t panel,
+                                     uint16_t h_res, uint16_t v_res);
+
+bool bsp_video_layer_available(void);
+
+/* Frames given to bsp_video_layer_present() are frame->w x frame->h RGB565
+   and land at frame->x/y (panel coordinates). Only the tiles (frame
+   coordinates) are written. */
+esp_err_t bsp_video_layer_open(const bsp_video_rect_t *frame,
+                               const bsp_video_rect_t *tiles,
+                               size_t tile_count);
+
+/* Copies one frame into every frame buffer. Any task; the buffer must be
+   cache-line aligned. ESP_ERR_INVALID_STATE while the layer is closed. */
+esp_err_t bsp_video_layer_present(const void *rgb565);
+
+/* Once this returns, no present() is in flight and later ones fail. */
+void bsp_video_layer_close(void);
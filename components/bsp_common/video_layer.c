@@ -0,0 +1,177 @@
+#include "bsp/video_layer.h"
+
+#include "bsp/display_profile.h"
+#include "driver/ppa.h"
+#include "esp_lcd_mipi_dsi.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "video_layer";
+
+#if CONFIG_BSP_LCD_COLOR_FORMAT_RGB888
+#define FB_BYTES_PER_PIXEL 3
+#define FB_COLOR_MODE PPA_SRM_COLOR_MODE_RGB888
+#else
+#define FB_BYTES_PER_PIXEL 2
+#define FB_COLOR_MODE PPA_SRM_COLOR_MODE_RGB565
+#endif
+
+#define VIDEO_LAYER_MAX_FBS 3
+
+static void *fbs[VIDEO_LAYER_MAX_FBS];
+static uint8_t fb_count = 0;
+static uint16_t panel_w = 0;
+static uint16_t panel_h = 0;
+/* The PPA syncs the whole output buffer and wants its size in cache lines. */
+static size_t fb_size = 0;
+
+/* Held across every present(), so close() can wait one out. */
+static SemaphoreHandle_t lock = NULL;
+static ppa_client_handle_t ppa_client = NULL;
+static bool layer_open = false;
+static bsp_video_rect_t frame;
+static bsp_video_rect_t tiles[BSP_VIDEO_LAYER_MAX_TILES];
+static size_t tile_count = 0;
+
+esp_err_t bsp_video_layer_attach_dpi(esp_lcd_panel_handle_t panel,
+                                     uint16_t h_res, uint16_t v_res) {
+#if CONFIG_BSP_VIDEO_LAYER
+  const bsp_display_profile_t *profile = bsp_display_profile();
+  if (profile->tear_avoid == BSP_TEAR_AVOID_DOUBLE_FULL) {
+    ESP_LOGI(TAG, "Full-refresh profile; camera preview stays in LVGL");
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+
+  uint8_t count = profile->dpi_fb_count;
+  if (count > VIDEO_LAYER_MAX_FBS)
+    count = VIDEO_LAYER_MAX_FBS;
+  void *fb[VIDEO_LAYER_MAX_FBS] = {NULL};
+  esp_err_t err = esp_lcd_dpi_panel_get_frame_buffer(panel, count, &fb[0],
+                                                     &fb[1], &fb[2]);
+  if (err != ESP_OK)
+    return err;
+
+  lock = xSemaphoreCreateMutex();
+  if (!lock)
+    return ESP_ERR_NO_MEM;
+
+  for (uint8_t i = 0; i < count; i++)
+    fbs[i] = fb[i];
+  fb_count = count;
+  panel_w = h_res;
+  panel_h = v_res;
+  fb_size = ((size_t)h_res * v_res * FB_BYTES_PER_PIXEL) &
+            ~(size_t)(CONFIG_CACHE_L2_CACHE_LINE_SIZE - 1);
+  ESP_LOGI(TAG, "Video layer over %u frame buffer(s)", fb_count);
+  return ESP_OK;
+#else
+  (void)panel;
+  (void)h_res;
+  (void)v_res;
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+bool bsp_video_layer_available(void) { return fb_count > 0; }
+
+static bool rect_within(const bsp_video_rect_t *r, uint32_t w, uint32_t h) {
+  return r->w && r->h && (uint32_t)r->x + r->w <= w &&
+         (uint32_t)r->y + r->h <= h;
+}
+
+esp_err_t bsp_video_layer_open(const bsp_video_rect_t *frame_rect,
+                               const bsp_video_rect_t *tile_rects,
+                               size_t count) {
+  if (!fb_count)
+    return ESP_ERR_NOT_SUPPORTED;
+  if (!frame_rect || !tile_rects || count == 0 ||
+      count > BSP_VIDEO_LAYER_MAX_TILES ||
+      !rect_within(frame_rect, panel_w, panel_h))
+    return ESP_ERR_INVALID_ARG;
+  /* The last frame pixel may not sit in the tail cut off by alignment. */
+  size_t end = ((size_t)(frame_rect->y + frame_rect->h - 1) * panel_w +
+                frame_rect->x + frame_rect->w) *
+               FB_BYTES_PER_PIXEL;
+  if (end > fb_size)
+    return ESP_ERR_INVALID_ARG;
+  for (size_t i = 0; i < count; i++) {
+    if (!rect_within(&tile_rects[i], frame_rect->w, frame_rect->h))
+      return ESP_ERR_INVALID_ARG;
+  }
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  esp_err_t err = ESP_OK;
+  if (!ppa_client) {
+    ppa_client_config_t cfg = {.oper_type = PPA_OPERATION_SRM};
+    err = ppa_register_client(&cfg, &ppa_client);
+    if (err != ESP_OK)
+      ppa_client = NULL;
+  }
+  if (err == ESP_OK) {
+    frame = *frame_rect;
+    for (size_t i = 0; i < count; i++)
+      tiles[i] = tile_rects[i];
+    tile_count = count;
+    layer_open = true;
+  }
+  xSemaphoreGive(lock);
+  return err;
+}
+
+esp_err_t bsp_video_layer_present(const void *rgb565) {
+  if (!lock)
+    return ESP_ERR_NOT_SUPPORTED;
+  if (!rgb565)
+    return ESP_ERR_INVALID_ARG;
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  if (!layer_open) {
+    xSemaphoreGive(lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  esp_err_t err = ESP_OK;
+  for (uint8_t f = 0; f < fb_count && err == ESP_OK; f++) {
+    for (size_t t = 0; t < tile_count && err == ESP_OK; t++) {
+      ppa_srm_oper_config_t srm = {
+          .in.buffer = rgb565,
+          .in.pic_w = frame.w,
+          .in.pic_h = frame.h,
+          .in.block_w = tiles[t].w,
+          .in.block_h = tiles[t].h,
+          .in.block_offset_x = tiles[t].x,
+          .in.block_offset_y = tiles[t].y,
+          .in.srm_cm = PPA_SRM_COLOR_MODE_RGB565,
+          .out.buffer = fbs[f],
+          .out.buffer_size = fb_size,
+          .out.pic_w = panel_w,
+          .out.pic_h = panel_h,
+          .out.block_offset_x = frame.x + tiles[t].x,
+          .out.block_offset_y = frame.y + tiles[t].y,
+          .out.srm_cm = FB_COLOR_MODE,
+          .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+          .scale_x = 1.0f,
+          .scale_y = 1.0f,
+          .mode = PPA_TRANS_MODE_BLOCKING,
+      };
+      err = ppa_do_scale_rotate_mirror(ppa_client, &srm);
+    }
+  }
+  xSemaphoreGive(lock);
+  return err;
+}
+
+void bsp_video_layer_close(void) {
+  if (!lock)
+    return;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  layer_open = false;
+  tile_count = 0;
+  if (ppa_client) {
+    ppa_unregister_client(ppa_client);
+    ppa_client = NULL;
+  }
+  xSemaphoreGive(lock);
+}
@@ -27,7 +27,19 @@ esp_err_t sd_card_remount(void);
 
 bool sd_card_is_mounted(void);
 
+/* Bumped on every (re)mount and on every create, write or delete made through
+ * this API. FAT leaves a directory's own timestamp alone when its contents
+ * change, so a cached listing checks this as well as sd_card_mtime(). */
+uint32_t sd_card_generation(void);
+
+/* Last-modified time of path, in microseconds since the epoch. */
+esp_err_t sd_card_mtime(const char *path, int64_t *mtime_out);
+
 esp_err_t sd_card_write_file(const char *path, const uint8_t *data, size_t len);
+/* Appends to path, creating it if absent. Lets long-running writers (the scan
+ * recorder) grow a file chunk by chunk without holding it open. */
+esp_err_t sd_card_append_file(const char *path, const uint8_t *data,
+                              size_t len);
 esp_err_t sd_card_read_file(const char *path, uint8_t **data_out,
                             size_t *len_out);
 esp_err_t sd_card_file_size(const char *path, size_t *size_out);
@@ -46,6 +58,78 @@ esp_err_t sd_card_list_entries(const char *dir_path, char ***names_out,
 
 void sd_card_free_file_list(char **files, int count);
 
+/* ---------- Streaming I/O ----------
+ *
+ * Files larger than a comfortable contiguous allocation (firmware images,
+ * big PSBTs, descriptor backups) are moved through a stream instead. Every
+ * card transfer goes through bounce buffers in DMA-capable internal RAM,
+ * sized in whole sectors and cache-line aligned, so FatFs hands them to the
+ * SDMMC driver as multi-sector transfers whatever memory the caller's own
+ * buffer lives in. A read stream can optionally keep a second buffer filling
+ * on a worker task while the caller consumes the first.
+ *
+ * A stream belongs to one task; it is not safe to share. */
+
+typedef struct sd_card_stream sd_card_stream_t;
+
+typedef enum {
+  SD_CARD_STREAM_READ,
+  SD_CARD_STREAM_WRITE,  /* create or truncate */
+  SD_CARD_STREAM_APPEND, /* create or append */
+} sd_card_stream_mode_t;
+
+typedef struct {
+  /* Bounce buffer size in bytes, rounded up to whole sectors; 0 selects
+   * CONFIG_SD_STREAM_BUFFER_SIZE. */
+  size_t buffer_size;
+  /* Read streams only: double-buffer, reading the next chunk on a worker
+   * task while the caller processes the current one. Costs a second buffer
+   * and a task for the life of the stream. */
+  bool read_ahead;
+} sd_card_stream_config_t;
+
+/* config may be NULL for the defaults (no read-ahead). */
+esp_err_t sd_card_stream_open(const char *path, sd_card_stream_mode_t mode,
+                              const sd_card_stream_config_t *config,
+                              sd_card_stream_t **stream_out);
+
+/* Size of the file when a read stream was opened. */
+esp_err_t sd_card_stream_size(sd_card_stream_t *stream, size_t *size_out);
+
+/* Reads up to len bytes into data. *read_out is short only at end of file
+ * (0 once the end is reached). */
+esp_err_t sd_card_stream_read_chunk(sd_card_stream_t *stream, uint8_t *data,
+                                    size_t len, size_t *read_out);
+
+/* Repositions a read stream at offset bytes from the start of the file,
+ * dropping anything read ahead. */
+esp_err_t sd_card_stream_seek(sd_card_stream_t *stream, size_t offset);
+
+esp_err_t sd_card_stream_write_chunk(sd_card_stream_t *stream,
+                                     const uint8_t *data, size_t len);
+
+/* Flushes a write stream and releases everything. Returns the first error
+ * the stream hit, so a writer only needs to check this at the end. Safe on
+ * NULL. */
+esp_err_t sd_card_stream_close(sd_card_stream_t *stream);
+
+typedef struct {
+  uint32_t freq_khz; /* bus clock; 0 on the simulator */
+  uint8_t bus_width; /* data lines; 0 on the simulator */
+  float write_mbps;
+  float read_mbps;
+  float read_ahead_mbps;
+} sd_card_self_test_result_t;
+
+/* Throughput self-test: for each bus mode the board can run (default and
+ * high speed, at the configured width and, on 4-bit boards, at 1 bit),
+ * remounts the card in that mode, streams test_bytes to a scratch file and
+ * back, and logs and reports MB/s. Leaves the card mounted in its normal
+ * mode. No stream may be open while it runs. */
+esp_err_t sd_card_self_test(size_t test_bytes,
+                            sd_card_self_test_result_t *results,
+                            size_t max_results, size_t *count_out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,15 +1,21 @@
 #include "sd_card.h"
 
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/unistd.h>
 
 #include "driver/sdmmc_host.h"
+#include "esp_heap_caps.h"
 #include "esp_ldo_regulator.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_vfs_fat.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "sdmmc_cmd.h"
 
@@ -17,6 +23,7 @@ static const char *TAG = "sd_card";
 
 static sdmmc_card_t *s_card = NULL;
 static bool s_mounted = false;
+static uint32_t s_generation = 0;
 
 /* Probe attempts on a (re)mount, and the settle delay between them. */
 #define SD_CARD_MOUNT_ATTEMPTS 3
@@ -107,16 +114,11 @@ static void sd_card_clear_mount(void) {
   s_mounted = false;
 }
 
-esp_err_t sd_card_init(void) {
-  /* Reuse a live mount; only a stale or absent one is (re)probed. A cached but
-   * dead handle must be torn down first, or the mount below early-returns on
-   * the stale flag. */
-  if (sd_card_handle_is_live())
-    return ESP_OK;
-  sd_card_clear_mount();
-
-  ESP_LOGI(TAG, "Initializing SD card");
-
+/* Mounts at width data lines, probing first at first_khz and then at
+ * fallback_khz. Some cards/wiring are marginal at high speed or need a second
+ * probe right after power-up. esp_vfs_fat_sdmmc_mount() deinits the host on
+ * failure, so re-calling it is safe. */
+static esp_err_t sd_card_mount(int width, int first_khz, int fallback_khz) {
   esp_err_t ret = sd_card_enable_power();
   if (ret != ESP_OK)
     return ret;
@@ -134,14 +136,10 @@ esp_err_t sd_card_init(void) {
   ret = sd_card_configure_slot(&slot_config);
   if (ret != ESP_OK)
     return ret;
+  slot_config.width = width;
 
-  /* Some cards/wiring are marginal at high speed or need a second probe right
-   * after power-up. Retry, dropping to default speed after the first attempt.
-   * esp_vfs_fat_sdmmc_mount() deinits the host on failure, so re-calling it is
-   * safe. */
   for (int attempt = 0; attempt < SD_CARD_MOUNT_ATTEMPTS; attempt++) {
-    host.max_freq_khz =
-        (attempt == 0) ? SDMMC_FREQ_HIGHSPEED : SDMMC_FREQ_DEFAULT;
+    host.max_freq_khz = (attempt == 0) ? first_khz : fallback_khz;
     ret = esp_vfs_fat_sdmmc_mount(SD_CARD_MOUNT_POINT, &host, &slot_config,
                                   &mount_config, &s_card);
     if (ret == ESP_OK)
@@ -158,6 +156,25 @@ esp_err_t sd_card_init(void) {
   }
 
   s_mounted = true;
+  s_generation++;
+  return ESP_OK;
+}
+
+esp_err_t sd_card_init(void) {
+  /* Reuse a live mount; only a stale or absent one is (re)probed. A cached but
+   * dead handle must be torn down first, or the mount below early-returns on
+   * the stale flag. */
+  if (sd_card_handle_is_live())
+    return ESP_OK;
+  sd_card_clear_mount();
+
+  ESP_LOGI(TAG, "Initializing SD card");
+
+  esp_err_t ret = sd_card_mount(CONFIG_SD_BUS_WIDTH, SDMMC_FREQ_HIGHSPEED,
+                                SDMMC_FREQ_DEFAULT);
+  if (ret != ESP_OK)
+    return ret;
+
   ESP_LOGI(TAG, "SD card mounted at %s", SD_CARD_MOUNT_POINT);
   sdmmc_card_print_info(stdout, s_card);
   return ESP_OK;
@@ -188,6 +205,21 @@ esp_err_t sd_card_remount(void) {
 
 bool sd_card_is_mounted(void) { return s_mounted; }
 
+uint32_t sd_card_generation(void) { return s_generation; }
+
+esp_err_t sd_card_mtime(const char *path, int64_t *mtime_out) {
+  if (!path || !mtime_out)
+    return ESP_ERR_INVALID_ARG;
+  if (!s_mounted)
+    return ESP_ERR_INVALID_STATE;
+
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return ESP_ERR_NOT_FOUND;
+  *mtime_out = (int64_t)st.st_mtime * 1000000;
+  return ESP_OK;
+}
+
 esp_err_t sd_card_write_file(const char *path, const uint8_t *data,
                              size_t len) {
   if (!path || !data)
@@ -195,6 +227,7 @@ esp_err_t sd_card_write_file(const char *path, const uint8_t *data,
   if (!s_mounted)
     return ESP_ERR_INVALID_STATE;
 
+  s_generation++;
   FILE *f = fopen(path, "wb");
   if (!f) {
     ESP_LOGE(TAG, "Failed to open %s for writing", path);
@@ -211,6 +244,30 @@ esp_err_t sd_card_write_file(const char *path, const uint8_t *data,
   return ESP_OK;
 }
 
+esp_err_t sd_card_append_file(const char *path, const uint8_t *data,
+                              size_t len) {
+  if (!path || !data)
+    return ESP_ERR_INVALID_ARG;
+  if (!s_mounted)
+    return ESP_ERR_INVALID_STATE;
+
+  s_generation++;
+  FILE *f = fopen(path, "ab");
+  if (!f) {
+    ESP_LOGE(TAG, "Failed to open %s for appending", path);
+    return ESP_FAIL;
+  }
+
+  size_t written = fwrite(data, 1, len, f);
+  fclose(f);
+
+  if (written != len) {
+    ESP_LOGE(TAG, "Append incomplete: %zu/%zu bytes", written, len);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
 esp_err_t sd_card_read_file(const char *path, uint8_t **data_out,
                             size_t *len_out) {
   if (!path || !data_out || !len_out)
@@ -283,6 +340,7 @@ esp_err_t sd_card_delete_file(const char *path) {
   struct stat st;
   if (stat(path, &st) != 0)
     return ESP_ERR_NOT_FOUND;
+  s_generation++;
   if (unlink(path) != 0)
     return ESP_FAIL;
   return ESP_OK;
@@ -311,7 +369,7 @@ static esp_err_t list_dir(const char *dir_path, bool include_dirs,
 
   char **names = NULL;
   bool *is_dir = NULL;
-  int count = 0;
+  int count = 0, cap = 0;
   struct dirent *entry;
   while ((entry = readdir(dir)) != NULL) {
     if (entry->d_name[0] == '.')
@@ -320,17 +378,24 @@ static esp_err_t list_dir(const char *dir_path, bool include_dirs,
     if (entry->d_type != DT_REG && !(include_dirs && entry_is_dir))
       continue;
 
-    char **tmp = realloc(names, (size_t)(count + 1) * sizeof(char *));
-    if (tmp)
-      names = tmp;
-    bool *tmp_dir = NULL;
-    if (is_dir_out) {
-      tmp_dir = realloc(is_dir, (size_t)(count + 1) * sizeof(bool));
-      if (tmp_dir)
-        is_dir = tmp_dir;
+    /* Grow geometrically: folders of PSBT exports run to thousands. */
+    bool grown = true;
+    if (count == cap) {
+      int new_cap = cap ? cap * 2 : 16;
+      char **tmp = realloc(names, (size_t)new_cap * sizeof(char *));
+      if (tmp)
+        names = tmp;
+      bool *tmp_dir = NULL;
+      if (is_dir_out) {
+        tmp_dir = realloc(is_dir, (size_t)new_cap * sizeof(bool));
+        if (tmp_dir)
+          is_dir = tmp_dir;
+      }
+      grown = tmp && (!is_dir_out || tmp_dir);
+      if (grown)
+        cap = new_cap;
     }
-    if (!tmp || (is_dir_out && !tmp_dir) ||
-        !(names[count] = strdup(entry->d_name))) {
+    if (!grown || !(names[count] = strdup(entry->d_name))) {
       sd_card_free_file_list(names, count);
       free(is_dir);
       closedir(dir);
@@ -368,3 +433,408 @@ void sd_card_free_file_list(char **files, int count) {
     free(files[i]);
   free(files);
 }
+
+/* ---------- Streaming I/O ---------- */
+
+#define SD_CARD_SECTOR_SIZE 512
+/* Cache-line alignment the SDMMC DMA wants for a buffer it writes into. */
+#define SD_CARD_STREAM_ALIGN 64
+
+struct sd_card_stream {
+  int fd;
+  bool writing;
+  esp_err_t err; /* first failure; every later call returns it */
+  size_t size;   /* file size at open (read streams) */
+  size_t buf_size;
+  uint8_t *buf[2];
+  int cur;           /* buffer being consumed (read) or filled (write) */
+  size_t fill;       /* valid bytes in buf[cur] */
+  size_t pos;        /* read position within buf[cur] */
+  size_t buf_offset; /* file offset of buf[cur][0] (read streams) */
+  bool eof;          /* nothing follows buf[cur] */
+  /* Read-ahead: while pending, the worker is filling buf[cur ^ 1] with the
+   * bytes that follow buf[cur]. */
+  TaskHandle_t worker;
+  QueueHandle_t request_q; /* int: index of the buffer to fill */
+  QueueHandle_t result_q;  /* ssize_t: what read() returned */
+  bool pending;
+};
+
+static void *bounce_alloc(size_t size) {
+  return heap_caps_aligned_alloc(SD_CARD_STREAM_ALIGN, size,
+                                 MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+}
+
+/* Never returns; sd_card_stream_close() deletes it once it is idle. */
+static void read_ahead_task(void *arg) {
+  sd_card_stream_t *s = arg;
+  int idx;
+  for (;;) {
+    if (xQueueReceive(s->request_q, &idx, portMAX_DELAY) != pdTRUE)
+      continue;
+    ssize_t n = read(s->fd, s->buf[idx], s->buf_size);
+    xQueueSend(s->result_q, &n, portMAX_DELAY);
+  }
+}
+
+static void read_ahead_start(sd_card_stream_t *s) {
+  int idx = s->cur ^ 1;
+  xQueueSend(s->request_q, &idx, portMAX_DELAY);
+  s->pending = true;
+}
+
+static ssize_t read_ahead_wait(sd_card_stream_t *s) {
+  ssize_t n = -1;
+  xQueueReceive(s->result_q, &n, portMAX_DELAY);
+  s->pending = false;
+  return n;
+}
+
+static void read_ahead_stop(sd_card_stream_t *s) {
+  if (s->worker) {
+    if (s->pending)
+      read_ahead_wait(s);
+    vTaskDelete(s->worker);
+    s->worker = NULL;
+  }
+  if (s->request_q)
+    vQueueDelete(s->request_q);
+  if (s->result_q)
+    vQueueDelete(s->result_q);
+  s->request_q = NULL;
+  s->result_q = NULL;
+  heap_caps_free(s->buf[1]);
+  s->buf[1] = NULL;
+}
+
+/* Read-ahead is an optimisation: without the memory for it the stream still
+ * works single-buffered. */
+static void read_ahead_setup(sd_card_stream_t *s) {
+  s->buf[1] = bounce_alloc(s->buf_size);
+  s->request_q = xQueueCreate(1, sizeof(int));
+  s->result_q = xQueueCreate(1, sizeof(ssize_t));
+  if (!s->buf[1] || !s->request_q || !s->result_q ||
+      xTaskCreatePinnedToCore(read_ahead_task, "sd_ahead",
+                              CONFIG_SD_STREAM_TASK_STACK_SIZE, s,
+                              uxTaskPriorityGet(NULL), &s->worker,
+                              tskNO_AFFINITY) != pdPASS) {
+    ESP_LOGW(TAG, "Read-ahead unavailable, streaming single-buffered");
+    s->worker = NULL;
+    read_ahead_stop(s);
+  }
+}
+
+/* Moves on to the bytes after buf[cur]. */
+static esp_err_t stream_refill(sd_card_stream_t *s) {
+  ssize_t n;
+  s->buf_offset += s->fill;
+  if (s->worker) {
+    if (!s->pending)
+      read_ahead_start(s);
+    n = read_ahead_wait(s);
+    s->cur ^= 1;
+  } else {
+    n = read(s->fd, s->buf[0], s->buf_size);
+  }
+  s->pos = 0;
+  s->fill = n > 0 ? (size_t)n : 0;
+  if (n < 0) {
+    ESP_LOGE(TAG, "Stream read failed at %zu", s->buf_offset);
+    s->err = ESP_FAIL;
+    return s->err;
+  }
+  if (n == 0)
+    s->eof = true;
+  else if (s->worker && (size_t)n == s->buf_size)
+    read_ahead_start(s);
+  return ESP_OK;
+}
+
+static esp_err_t stream_flush(sd_card_stream_t *s) {
+  if (s->fill == 0 || s->err != ESP_OK)
+    return s->err;
+  ssize_t n = write(s->fd, s->buf[0], s->fill);
+  if (n < 0 || (size_t)n != s->fill) {
+    ESP_LOGE(TAG, "Stream write incomplete: %d/%zu bytes", (int)n, s->fill);
+    s->err = ESP_FAIL;
+  }
+  s->fill = 0;
+  return s->err;
+}
+
+esp_err_t sd_card_stream_open(const char *path, sd_card_stream_mode_t mode,
+                              const sd_card_stream_config_t *config,
+                              sd_card_stream_t **stream_out) {
+  if (!path || !stream_out)
+    return ESP_ERR_INVALID_ARG;
+  *stream_out = NULL;
+  if (!s_mounted)
+    return ESP_ERR_INVALID_STATE;
+
+  int flags;
+  switch (mode) {
+  case SD_CARD_STREAM_READ:
+    flags = O_RDONLY;
+    break;
+  case SD_CARD_STREAM_WRITE:
+    flags = O_WRONLY | O_CREAT | O_TRUNC;
+    break;
+  case SD_CARD_STREAM_APPEND:
+    flags = O_WRONLY | O_CREAT | O_APPEND;
+    break;
+  default:
+    return ESP_ERR_INVALID_ARG;
+  }
+
+  size_t buf_size = (config && config->buffer_size)
+                        ? config->buffer_size
+                        : (size_t)CONFIG_SD_STREAM_BUFFER_SIZE;
+  buf_size = (buf_size + SD_CARD_SECTOR_SIZE - 1) &
+             ~(size_t)(SD_CARD_SECTOR_SIZE - 1);
+
+  sd_card_stream_t *s = calloc(1, sizeof(*s));
+  if (!s)
+    return ESP_ERR_NO_MEM;
+  s->writing = mode != SD_CARD_STREAM_READ;
+  s->buf_size = buf_size;
+  s->buf[0] = bounce_alloc(buf_size);
+  if (!s->buf[0]) {
+    free(s);
+    return ESP_ERR_NO_MEM;
+  }
+
+  if (s->writing)
+    s_generation++;
+  s->fd = open(path, flags, 0666);
+  if (s->fd < 0) {
+    esp_err_t ret = (!s->writing && errno == ENOENT) ? ESP_ERR_NOT_FOUND
+                                                     : ESP_FAIL;
+    if (s->writing)
+      ESP_LOGE(TAG, "Failed to open %s for writing", path);
+    heap_caps_free(s->buf[0]);
+    free(s);
+    return ret;
+  }
+
+  if (!s->writing) {
+    struct stat st;
+    if (fstat(s->fd, &st) == 0)
+      s->size = st.st_size;
+    if (config && config->read_ahead)
+      read_ahead_setup(s);
+  }
+
+  *stream_out = s;
+  return ESP_OK;
+}
+
+esp_err_t sd_card_stream_size(sd_card_stream_t *stream, size_t *size_out) {
+  if (!stream || stream->writing || !size_out)
+    return ESP_ERR_INVALID_ARG;
+  *size_out = stream->size;
+  return ESP_OK;
+}
+
+esp_err_t sd_card_stream_read_chunk(sd_card_stream_t *stream, uint8_t *data,
+                                    size_t len, size_t *read_out) {
+  if (!stream || stream->writing || (!data && len) || !read_out)
+    return ESP_ERR_INVALID_ARG;
+  *read_out = 0;
+  if (stream->err != ESP_OK)
+    return stream->err;
+
+  size_t done = 0;
+  while (done < len) {
+    if (stream->pos == stream->fill) {
+      if (stream->eof)
+        break;
+      esp_err_t ret = stream_refill(stream);
+      if (ret != ESP_OK)
+        return ret;
+      continue;
+    }
+    size_t n = stream->fill - stream->pos;
+    if (n > len - done)
+      n = len - done;
+    memcpy(data + done, stream->buf[stream->cur] + stream->pos, n);
+    stream->pos += n;
+    done += n;
+  }
+  *read_out = done;
+  return ESP_OK;
+}
+
+esp_err_t sd_card_stream_seek(sd_card_stream_t *stream, size_t offset) {
+  if (!stream || stream->writing)
+    return ESP_ERR_INVALID_ARG;
+  if (stream->err != ESP_OK)
+    return stream->err;
+
+  /* Header and descriptor lookups usually land in the buffer already read;
+   * the read-ahead behind it stays valid then. */
+  if (offset >= stream->buf_offset &&
+      offset <= stream->buf_offset + stream->fill) {
+    stream->pos = offset - stream->buf_offset;
+    return ESP_OK;
+  }
+
+  if (stream->pending)
+    read_ahead_wait(stream);
+  if (lseek(stream->fd, (off_t)offset, SEEK_SET) < 0) {
+    stream->err = ESP_FAIL;
+    return stream->err;
+  }
+  stream->buf_offset = offset;
+  stream->fill = 0;
+  stream->pos = 0;
+  stream->eof = false;
+  return ESP_OK;
+}
+
+esp_err_t sd_card_stream_write_chunk(sd_card_stream_t *stream,
+                                     const uint8_t *data, size_t len) {
+  if (!stream || !stream->writing || (!data && len))
+    return ESP_ERR_INVALID_ARG;
+
+  size_t done = 0;
+  while (done < len && stream->err == ESP_OK) {
+    size_t n = stream->buf_size - stream->fill;
+    if (n > len - done)
+      n = len - done;
+    memcpy(stream->buf[0] + stream->fill, data + done, n);
+    stream->fill += n;
+    done += n;
+    if (stream->fill == stream->buf_size)
+      stream_flush(stream);
+  }
+  return stream->err;
+}
+
+esp_err_t sd_card_stream_close(sd_card_stream_t *stream) {
+  if (!stream)
+    return ESP_OK;
+  if (stream->writing) {
+    stream_flush(stream);
+    s_generation++;
+  } else {
+    read_ahead_stop(stream);
+  }
+  if (close(stream->fd) != 0 && stream->err == ESP_OK)
+    stream->err = ESP_FAIL;
+
+  esp_err_t ret = stream->err;
+  heap_caps_free(stream->buf[0]);
+  free(stream);
+  return ret;
+}
+
+/* ---------- Throughput self-test ---------- */
+
+/* Dot-prefixed, so the listings never show it. */
+#define SD_CARD_SELF_TEST_PATH SD_CARD_MOUNT_POINT "/.kern_speed.tmp"
+/* What a typical consumer hands the stream per call. */
+#define SD_CARD_SELF_TEST_CHUNK 4096
+
+static float mb_per_s(size_t bytes, int64_t elapsed_us) {
+  return elapsed_us > 0 ? (float)bytes / (float)elapsed_us : 0.0f;
+}
+
+static esp_err_t time_write(uint8_t *chunk, size_t bytes, float *mbps_out) {
+  sd_card_stream_t *s;
+  int64_t start = esp_timer_get_time();
+  esp_err_t ret =
+      sd_card_stream_open(SD_CARD_SELF_TEST_PATH, SD_CARD_STREAM_WRITE, NULL,
+                          &s);
+  if (ret != ESP_OK)
+    return ret;
+  for (size_t done = 0; done < bytes && ret == ESP_OK;) {
+    size_t n = bytes - done < SD_CARD_SELF_TEST_CHUNK ? bytes - done
+                                                      : SD_CARD_SELF_TEST_CHUNK;
+    ret = sd_card_stream_write_chunk(s, chunk, n);
+    done += n;
+  }
+  esp_err_t close_ret = sd_card_stream_close(s);
+  if (ret == ESP_OK)
+    ret = close_ret;
+  *mbps_out = mb_per_s(bytes, esp_timer_get_time() - start);
+  return ret;
+}
+
+static esp_err_t time_read(uint8_t *chunk, size_t bytes, bool read_ahead,
+                           float *mbps_out) {
+  sd_card_stream_config_t config = {.read_ahead = read_ahead};
+  sd_card_stream_t *s;
+  int64_t start = esp_timer_get_time();
+  esp_err_t ret = sd_card_stream_open(SD_CARD_SELF_TEST_PATH,
+                                      SD_CARD_STREAM_READ, &config, &s);
+  if (ret != ESP_OK)
+    return ret;
+  size_t total = 0, n;
+  do {
+    ret = sd_card_stream_read_chunk(s, chunk, SD_CARD_SELF_TEST_CHUNK, &n);
+    total += n;
+  } while (ret == ESP_OK && n > 0);
+  sd_card_stream_close(s);
+  if (ret == ESP_OK && total != bytes)
+    ret = ESP_ERR_INVALID_SIZE;
+  *mbps_out = mb_per_s(total, esp_timer_get_time() - start);
+  return ret;
+}
+
+esp_err_t sd_card_self_test(size_t test_bytes,
+                            sd_card_self_test_result_t *results,
+                            size_t max_results, size_t *count_out) {
+  if (test_bytes == 0 || (!results && max_results) || !count_out)
+    return ESP_ERR_INVALID_ARG;
+  *count_out = 0;
+
+  uint8_t *chunk = malloc(SD_CARD_SELF_TEST_CHUNK);
+  if (!chunk)
+    return ESP_ERR_NO_MEM;
+  for (size_t i = 0; i < SD_CARD_SELF_TEST_CHUNK; i++)
+    chunk[i] = (uint8_t)(i * 131 + 7);
+
+  static const int freqs_khz[] = {SDMMC_FREQ_DEFAULT, SDMMC_FREQ_HIGHSPEED};
+  const int widths[] = {CONFIG_SD_BUS_WIDTH, 1};
+  const size_t width_count = CONFIG_SD_BUS_WIDTH == 1 ? 1 : 2;
+
+  esp_err_t last_err = ESP_ERR_NOT_FOUND;
+  size_t passed = 0;
+  for (size_t w = 0; w < width_count; w++) {
+    for (size_t f = 0; f < sizeof(freqs_khz) / sizeof(freqs_khz[0]); f++) {
+      sd_card_self_test_result_t r = {.freq_khz = freqs_khz[f],
+                                      .bus_width = widths[w]};
+      sd_card_clear_mount();
+      esp_err_t ret = sd_card_mount(widths[w], freqs_khz[f], freqs_khz[f]);
+      if (ret == ESP_OK)
+        ret = time_write(chunk, test_bytes, &r.write_mbps);
+      if (ret == ESP_OK)
+        ret = time_read(chunk, test_bytes, false, &r.read_mbps);
+      if (ret == ESP_OK)
+        ret = time_read(chunk, test_bytes, true, &r.read_ahead_mbps);
+      if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Self-test %d-bit @ %d kHz failed: %s", widths[w],
+                 freqs_khz[f], esp_err_to_name(ret));
+        last_err = ret;
+        continue;
+      }
+      ESP_LOGI(TAG,
+               "Self-test %d-bit @ %5d kHz: write %.2f MB/s, read %.2f MB/s, "
+               "read-ahead %.2f MB/s",
+               widths[w], freqs_khz[f], r.write_mbps, r.read_mbps,
+               r.read_ahead_mbps);
+      passed++;
+      if (*count_out < max_results)
+        results[(*count_out)++] = r;
+    }
+  }
+  free(chunk);
+
+  if (s_mounted)
+    unlink(SD_CARD_SELF_TEST_PATH);
+  sd_card_clear_mount();
+  esp_err_t ret = sd_card_init();
+  if (ret != ESP_OK)
+    return ret;
+  return passed > 0 ? ESP_OK : last_err;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * Scan recording container (.ksr)
+ *
+ * Written by the developer-only frame recorder (video_recorder.c) and ingested
+ * by the simulator's scan replay (--replay <file.ksr>). Little-endian.
+ *
+ *   File header, SCAN_RECORDING_HEADER_SIZE bytes:
+ *     char  magic[4]      "KSR1"
+ *     u16   version       SCAN_RECORDING_VERSION
+ *     u16   pixel format  SCAN_RECORDING_PIXFMT_GRAY8
+ *     u16   frame width   decode frame the ROIs below are placed in
+ *     u16   frame height
+ *     u32   reserved      0
+ *
+ *   Chunks, repeated to end of file:
+ *     char  tag[4]
+ *     u32   payload length
+ *     u8    payload[length]
+ *
+ *   "FRME" payload: the exact k_quirc input for one decoded frame
+ *     u32   timestamp_ms  since recording start
+ *     u16   roi_x, roi_y  ROI origin within the decode frame
+ *     u16   roi_w, roi_h
+ *     u16   ae_target     sensor AE target in effect (0 = unknown)
+ *     u16   focus         focus motor position in effect (0 = unknown)
+ *     u8    gray[roi_w * roi_h]
+ *
+ * Readers skip chunks with unknown tags by their length, so later versions can
+ * add chunk types without breaking older replays.
+ */
+
+#include <stdint.h>
+
+#define SCAN_RECORDING_MAGIC "KSR1"
+#define SCAN_RECORDING_VERSION 1
+#define SCAN_RECORDING_PIXFMT_GRAY8 1
+#define SCAN_RECORDING_HEADER_SIZE 16
+#define SCAN_RECORDING_CHUNK_HEADER_SIZE 8
+#define SCAN_RECORDING_TAG_FRAME "FRME"
+#define SCAN_RECORDING_FRAME_META_SIZE 16
+
+static inline void scan_recording_put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void scan_recording_put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t scan_recording_get_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t scan_recording_get_u32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
@@ -103,6 +103,8 @@ typedef struct {
   bool ready;
   bool streaming;
   bool has_focus_motor;
+  uint32_t ae_target; // Last applied, 0 until set
+  uint32_t focus;     // Last applied, 0 until set
   app_video_frame_operation_cb_t frame_cb;
   TaskHandle_t task_handle;
 } app_video_t;
@@ -668,9 +670,12 @@ esp_err_t app_video_set_ae_target(uint32_t level) {
       return ESP_FAIL;
     }
   }
+  app_video.ae_target = level;
   return ESP_OK;
 }
 
+uint32_t app_video_get_ae_target(void) { return app_video.ae_target; }
+
 esp_err_t app_video_set_focus(uint32_t position) {
   if (!app_video.ready || app_video.video_fd < 0)
     return ESP_ERR_INVALID_STATE;
@@ -686,9 +691,12 @@ esp_err_t app_video_set_focus(uint32_t position) {
     ESP_LOGW(TAG, "Set focus position failed");
     return ESP_FAIL;
   }
+  app_video.focus = position;
   return ESP_OK;
 }
 
+uint32_t app_video_get_focus(void) { return app_video.focus; }
+
 bool app_video_has_focus_motor(void) {
   return app_video.ready && app_video.has_focus_motor;
 }
@@ -147,6 +147,13 @@ esp_err_t app_video_stop(void);
  */
 esp_err_t app_video_set_ae_target(uint32_t level);
 
+/**
+ * @brief Get the AE target last applied by app_video_set_ae_target().
+ *
+ * @return Clamped AE target level, or 0 if none has been applied.
+ */
+uint32_t app_video_get_ae_target(void);
+
 /**
  * @brief Set the camera focus position (DW9714 motor).
  *
@@ -158,6 +165,13 @@ esp_err_t app_video_set_ae_target(uint32_t level);
  */
 esp_err_t app_video_set_focus(uint32_t position);
 
+/**
+ * @brief Get the focus position last applied by app_video_set_focus().
+ *
+ * @return Focus position, or 0 if none has been applied.
+ */
+uint32_t app_video_get_focus(void);
+
 /**
  * @brief Check if a focus motor (DW9714) is available.
  *
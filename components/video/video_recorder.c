@@ -0,0 +1,239 @@
+/* Developer-only scan recorder — see video_recorder.h and scan_recording.h */
+
+#include "video_recorder.h"
+
+#if CONFIG_VIDEO_SCAN_RECORDER
+
+/* C standard includes */
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* System includes */
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/* Component includes */
+#include "scan_recording.h"
+#include "sd_card.h"
+#include "video.h"
+
+static const char *TAG = "video_recorder";
+
+#define RECORDER_DIR SD_CARD_MOUNT_POINT "/kern/scans"
+#define RECORDER_MAX_FILES 1000
+#define RECORDER_TASK_STACK_SIZE 4096
+#define RECORDER_TASK_PRIORITY 2
+#define RECORDER_STOP_TIMEOUT_MS 2000
+#define RECORDER_MAX_BYTES ((uint64_t)CONFIG_VIDEO_SCAN_RECORDER_MAX_KB * 1024)
+#define RECORDER_MAX_US                                                        \
+  ((int64_t)CONFIG_VIDEO_SCAN_RECORDER_MAX_SECONDS * 1000000)
+
+// One chunk in flight: the decode task fills it, the writer task drains it.
+typedef struct {
+  char path[64];
+  uint8_t *slot;
+  size_t slot_capacity;
+  size_t slot_len;
+  volatile bool slot_busy;
+  volatile bool stopping;
+  volatile bool exit_requested;
+  bool active;
+  bool limit_logged;
+  uint64_t bytes_written;
+  int64_t start_us;
+  uint32_t frames_written;
+  uint32_t frames_dropped;
+  TaskHandle_t task;
+  SemaphoreHandle_t task_done;
+} video_recorder_t;
+
+static video_recorder_t s_rec;
+
+static bool pick_recording_path(void) {
+  mkdir(SD_CARD_MOUNT_POINT "/kern", 0775);
+  mkdir(RECORDER_DIR, 0775);
+  for (int i = 0; i < RECORDER_MAX_FILES; i++) {
+    bool exists = true;
+    snprintf(s_rec.path, sizeof(s_rec.path), RECORDER_DIR "/scan_%03d.ksr", i);
+    if (sd_card_file_exists(s_rec.path, &exists) == ESP_OK && !exists)
+      return true;
+  }
+  return false;
+}
+
+static void recorder_task(void *arg) {
+  (void)arg;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (s_rec.slot_busy) {
+      if (sd_card_append_file(s_rec.path, s_rec.slot, s_rec.slot_len) ==
+          ESP_OK) {
+        s_rec.bytes_written += s_rec.slot_len;
+        s_rec.frames_written++;
+      } else {
+        // Card pulled or full: stop accepting frames, keep what we have.
+        // The task stays until video_recorder_stop() so stop never notifies
+        // a deleted task.
+        ESP_LOGW(TAG, "Append to %s failed, recording halted", s_rec.path);
+        s_rec.stopping = true;
+      }
+      s_rec.slot_busy = false;
+    }
+    if (s_rec.exit_requested)
+      break;
+  }
+  xSemaphoreGive(s_rec.task_done);
+  vTaskDelete(NULL);
+}
+
+esp_err_t video_recorder_start(uint32_t frame_width, uint32_t frame_height) {
+  if (s_rec.active)
+    return ESP_ERR_INVALID_STATE;
+  if (frame_width == 0 || frame_height == 0 || frame_width > UINT16_MAX ||
+      frame_height > UINT16_MAX)
+    return ESP_ERR_INVALID_ARG;
+
+  esp_err_t ret = sd_card_init();
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "No SD card, not recording");
+    return ret;
+  }
+  if (!pick_recording_path()) {
+    ESP_LOGW(TAG, "No free recording name in " RECORDER_DIR);
+    return ESP_ERR_NOT_FOUND;
+  }
+
+  uint8_t header[SCAN_RECORDING_HEADER_SIZE] = {0};
+  memcpy(header, SCAN_RECORDING_MAGIC, 4);
+  scan_recording_put_u16(header + 4, SCAN_RECORDING_VERSION);
+  scan_recording_put_u16(header + 6, SCAN_RECORDING_PIXFMT_GRAY8);
+  scan_recording_put_u16(header + 8, (uint16_t)frame_width);
+  scan_recording_put_u16(header + 10, (uint16_t)frame_height);
+  ret = sd_card_write_file(s_rec.path, header, sizeof(header));
+  if (ret != ESP_OK)
+    return ret;
+
+  s_rec.slot_capacity = SCAN_RECORDING_CHUNK_HEADER_SIZE +
+                        SCAN_RECORDING_FRAME_META_SIZE +
+                        (size_t)frame_width * frame_height;
+  s_rec.slot = heap_caps_malloc(s_rec.slot_capacity, MALLOC_CAP_SPIRAM);
+  if (!s_rec.slot)
+    return ESP_ERR_NO_MEM;
+
+  s_rec.task_done = xSemaphoreCreateBinary();
+  if (!s_rec.task_done) {
+    heap_caps_free(s_rec.slot);
+    s_rec.slot = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+
+  s_rec.slot_busy = false;
+  s_rec.stopping = false;
+  s_rec.exit_requested = false;
+  s_rec.limit_logged = false;
+  s_rec.bytes_written = SCAN_RECORDING_HEADER_SIZE;
+  s_rec.frames_written = 0;
+  s_rec.frames_dropped = 0;
+  s_rec.start_us = esp_timer_get_time();
+
+  // Internal-RAM stack: the task writes through FATFS.
+  if (xTaskCreatePinnedToCore(recorder_task, "scan_rec",
+                              RECORDER_TASK_STACK_SIZE, NULL,
+                              RECORDER_TASK_PRIORITY, &s_rec.task,
+                              0) != pdPASS) {
+    vSemaphoreDelete(s_rec.task_done);
+    s_rec.task_done = NULL;
+    heap_caps_free(s_rec.slot);
+    s_rec.slot = NULL;
+    return ESP_FAIL;
+  }
+
+  s_rec.active = true;
+  ESP_LOGI(TAG, "Recording %" PRIu32 "x%" PRIu32 " decode frames to %s",
+           frame_width, frame_height, s_rec.path);
+  return ESP_OK;
+}
+
+bool video_recorder_submit(uint32_t roi_x, uint32_t roi_y, uint32_t roi_w,
+                           uint32_t roi_h, const uint8_t *gray) {
+  if (!s_rec.active || s_rec.stopping || !gray)
+    return false;
+  if (s_rec.slot_busy) {
+    s_rec.frames_dropped++;
+    return false;
+  }
+
+  size_t pixels = (size_t)roi_w * roi_h;
+  size_t payload = SCAN_RECORDING_FRAME_META_SIZE + pixels;
+  size_t chunk = SCAN_RECORDING_CHUNK_HEADER_SIZE + payload;
+  int64_t elapsed_us = esp_timer_get_time() - s_rec.start_us;
+  if (chunk > s_rec.slot_capacity) {
+    s_rec.frames_dropped++;
+    return false;
+  }
+  if (s_rec.bytes_written + chunk > RECORDER_MAX_BYTES ||
+      elapsed_us > RECORDER_MAX_US) {
+    if (!s_rec.limit_logged) {
+      ESP_LOGI(TAG, "Recording limit reached, dropping further frames");
+      s_rec.limit_logged = true;
+    }
+    s_rec.frames_dropped++;
+    return false;
+  }
+
+  uint8_t *p = s_rec.slot;
+  memcpy(p, SCAN_RECORDING_TAG_FRAME, 4);
+  scan_recording_put_u32(p + 4, (uint32_t)payload);
+  p += SCAN_RECORDING_CHUNK_HEADER_SIZE;
+  scan_recording_put_u32(p, (uint32_t)(elapsed_us / 1000));
+  scan_recording_put_u16(p + 4, (uint16_t)roi_x);
+  scan_recording_put_u16(p + 6, (uint16_t)roi_y);
+  scan_recording_put_u16(p + 8, (uint16_t)roi_w);
+  scan_recording_put_u16(p + 10, (uint16_t)roi_h);
+  scan_recording_put_u16(p + 12, (uint16_t)app_video_get_ae_target());
+  scan_recording_put_u16(p + 14, (uint16_t)app_video_get_focus());
+  memcpy(p + SCAN_RECORDING_FRAME_META_SIZE, gray, pixels);
+  s_rec.slot_len = chunk;
+
+  s_rec.slot_busy = true;
+  xTaskNotifyGive(s_rec.task);
+  return true;
+}
+
+void video_recorder_stop(void) {
+  if (!s_rec.active)
+    return;
+
+  // The writer drains a pending slot before it observes the stop request.
+  s_rec.stopping = true;
+  s_rec.exit_requested = true;
+  xTaskNotifyGive(s_rec.task);
+  if (xSemaphoreTake(s_rec.task_done,
+                     pdMS_TO_TICKS(RECORDER_STOP_TIMEOUT_MS)) != pdTRUE) {
+    // Leak the slot and semaphore rather than free them under a live writer.
+    ESP_LOGE(TAG, "Writer task did not exit");
+    s_rec.active = false;
+    return;
+  }
+
+  ESP_LOGI(TAG,
+           "Recorded %" PRIu32 " frames (%" PRIu64 " bytes, %" PRIu32
+           " dropped) to %s",
+           s_rec.frames_written, s_rec.bytes_written, s_rec.frames_dropped,
+           s_rec.path);
+
+  vSemaphoreDelete(s_rec.task_done);
+  s_rec.task_done = NULL;
+  heap_caps_free(s_rec.slot);
+  s_rec.slot = NULL;
+  s_rec.task = NULL;
+  s_rec.active = false;
+}
+
+#endif /* CONFIG_VIDEO_SCAN_RECORDER */
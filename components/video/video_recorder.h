@@ -0,0 +1,56 @@
+#pragma once
+
+/* C standard includes */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* System includes */
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/*
+ * Developer-only scan recorder (CONFIG_VIDEO_SCAN_RECORDER).
+ *
+ * Tees decoder input frames to /sdcard/kern/scans/scan_NNN.ksr in the
+ * container described in scan_recording.h. A low-priority writer task does the
+ * SD I/O; frames arriving while it is still busy are dropped rather than
+ * stalling the decode loop, so a recording is a subsequence of what was
+ * decoded. When the option is disabled these functions are not built and
+ * callers must guard their use with #if CONFIG_VIDEO_SCAN_RECORDER.
+ */
+
+#if CONFIG_VIDEO_SCAN_RECORDER
+
+/**
+ * @brief Open a new recording.
+ *
+ * Mounts the SD card if needed and writes the file header.
+ *
+ * @param frame_width Width of the decode frame ROIs are placed in.
+ * @param frame_height Height of the decode frame.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if already recording, or
+ *         an SD/allocation error.
+ */
+esp_err_t video_recorder_start(uint32_t frame_width, uint32_t frame_height);
+
+/**
+ * @brief Queue one decoder input frame for writing.
+ *
+ * Copies `gray` (roi_w * roi_h bytes, tightly packed) so the caller may reuse
+ * it on return. Must be called before the buffer is handed to k_quirc_end(),
+ * which binarizes it in place.
+ *
+ * @return true if the frame was queued, false if it was dropped (writer busy,
+ *         size/time limit reached, or not recording).
+ */
+bool video_recorder_submit(uint32_t roi_x, uint32_t roi_y, uint32_t roi_w,
+                           uint32_t roi_h, const uint8_t *gray);
+
+/**
+ * @brief Flush the pending frame and close the recording.
+ *
+ * Safe to call when not recording.
+ */
+void video_recorder_stop(void);
+
+#endif /* CONFIG_VIDEO_SCAN_RECORDER */
@@ -1,4 +1,5 @@
 #include "bsp/display.h"
+#include "bsp/display_profile.h"
 #include "bsp/esp32_p4_wifi6_touch_lcd_35.h"
 #include "bsp/touch.h"
 #include "bsp_err_check.h"
@@ -222,6 +223,8 @@ esp_err_t bsp_touch_new(const bsp_touch_config_t *config,
 }
 
 #if (BSP_CONFIG_NO_GRAPHIC_LIB == 0)
+#include "bsp/display_profile_lv_adapter.h"
+
 static lv_display_t *bsp_display_lcd_init(void) {
   BSP_ERROR_CHECK_RETURN_NULL(bsp_display_new(NULL, &panel_handle, &io_handle));
 
@@ -235,13 +238,9 @@ static lv_display_t *bsp_display_lcd_init(void) {
               .rotation = ESP_LV_ADAPTER_ROTATE_0,
               .hor_res = BSP_LCD_H_RES,
               .ver_res = BSP_LCD_V_RES,
-              .buffer_height = 50,
-              .use_psram = true,
-              .enable_ppa_accel = false,
-              .require_double_buffer = false,
           },
-      .tear_avoid_mode = ESP_LV_ADAPTER_TEAR_AVOID_MODE_NONE,
   };
+  bsp_display_profile_apply(&disp_cfg);
 
   lv_display_t *disp = esp_lv_adapter_register_display(&disp_cfg);
   if (!disp) {
@@ -1,6 +1,8 @@
 #include "bsp/display.h"
+#include "bsp/display_profile.h"
 #include "bsp/esp32_p4_wifi6_touch_lcd_5.h"
 #include "bsp/touch.h"
+#include "bsp/video_layer.h"
 #include "bsp_err_check.h"
 #include "driver/gpio.h"
 #include "driver/ledc.h"
@@ -223,7 +225,7 @@ esp_err_t bsp_display_new_with_handles(const bsp_display_config_t *config,
 #else
       .in_color_format = LCD_COLOR_FMT_RGB565,
 #endif
-      .num_fbs = CONFIG_BSP_LCD_DPI_BUFFER_NUMS,
+      .num_fbs = bsp_display_profile()->dpi_fb_count,
       .video_timing =
           {
               .h_size = 720,
@@ -264,6 +266,8 @@ esp_err_t bsp_display_new_with_handles(const bsp_display_config_t *config,
                     "LCD panel reset failed");
   ESP_GOTO_ON_ERROR(esp_lcd_panel_init(disp_panel), err, TAG,
                     "LCD panel init failed");
+  // Best effort: without it the camera preview is drawn by LVGL.
+  bsp_video_layer_attach_dpi(disp_panel, BSP_LCD_H_RES, BSP_LCD_V_RES);
 
   ret_handles->io = io;
   ret_handles->mipi_dsi_bus = mipi_dsi_bus;
@@ -338,6 +342,8 @@ esp_err_t bsp_touch_new(const bsp_touch_config_t *config,
 }
 
 #if (BSP_CONFIG_NO_GRAPHIC_LIB == 0)
+#include "bsp/display_profile_lv_adapter.h"
+
 static lv_display_t *bsp_display_lcd_init(void) {
   bsp_lcd_handles_t lcd_panels;
   BSP_ERROR_CHECK_RETURN_NULL(bsp_display_new_with_handles(NULL, &lcd_panels));
@@ -352,14 +358,10 @@ static lv_display_t *bsp_display_lcd_init(void) {
               .rotation = ESP_LV_ADAPTER_ROTATE_0,
               .hor_res = BSP_LCD_H_RES,
               .ver_res = BSP_LCD_V_RES,
-              .buffer_height = 50,
-              .use_psram = false,
-              .enable_ppa_accel = false,
-              .require_double_buffer = false,
           },
-      .tear_avoid_mode = ESP_LV_ADAPTER_TEAR_AVOID_MODE_NONE,
       .te_sync = ESP_LV_ADAPTER_TE_SYNC_DISABLED(),
   };
+  bsp_display_profile_apply(&disp_cfg);
 
   return esp_lv_adapter_register_display(&disp_cfg);
 }
@@ -1,4 +1,5 @@
 #include "bsp/display.h"
+#include "bsp/display_profile.h"
 #include "bsp/esp32_p4_wifi6_touch_lcd_7b.h"
 #include "bsp/touch.h"
 #include "bsp_err_check.h"
@@ -192,7 +193,7 @@ esp_err_t bsp_display_new_with_handles(const bsp_display_config_t *config,
   esp_lcd_dpi_panel_config_t dpi_config =
       EK79007_1024_600_PANEL_60HZ_CONFIG_CF(LCD_COLOR_FMT_RGB565);
 #endif
-  dpi_config.num_fbs = CONFIG_BSP_LCD_DPI_BUFFER_NUMS;
+  dpi_config.num_fbs = bsp_display_profile()->dpi_fb_count;
 
   ek79007_vendor_config_t vendor_config = {
       .mipi_config =
@@ -223,6 +224,8 @@ esp_err_t bsp_display_new_with_handles(const bsp_display_config_t *config,
      directions (Waveshare's BSP applies the same transform). */
   ESP_GOTO_ON_ERROR(esp_lcd_panel_mirror(disp_panel, true, true), err, TAG,
                     "LCD panel mirror failed");
+  // No video layer: the mirror is applied as the DPI driver copies LVGL's
+  // renders in, and direct frame buffer writes would bypass it.
 
   ret_handles->io = io;
   ret_handles->mipi_dsi_bus = mipi_dsi_bus;
@@ -299,6 +302,8 @@ esp_err_t bsp_touch_new(const bsp_touch_config_t *config,
 }
 
 #if (BSP_CONFIG_NO_GRAPHIC_LIB == 0)
+#include "bsp/display_profile_lv_adapter.h"
+
 static lv_display_t *bsp_display_lcd_init(void) {
   bsp_lcd_handles_t lcd_panels;
   BSP_ERROR_CHECK_RETURN_NULL(bsp_display_new_with_handles(NULL, &lcd_panels));
@@ -313,14 +318,10 @@ static lv_display_t *bsp_display_lcd_init(void) {
               .rotation = ESP_LV_ADAPTER_ROTATE_0,
               .hor_res = BSP_LCD_H_RES,
               .ver_res = BSP_LCD_V_RES,
-              .buffer_height = 50,
-              .use_psram = false,
-              .enable_ppa_accel = false,
-              .require_double_buffer = false,
           },
-      .tear_avoid_mode = ESP_LV_ADAPTER_TEAR_AVOID_MODE_NONE,
       .te_sync = ESP_LV_ADAPTER_TE_SYNC_DISABLED(),
   };
+  bsp_display_profile_apply(&disp_cfg);
 
   return esp_lv_adapter_register_display(&disp_cfg);
 }
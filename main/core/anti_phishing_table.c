@@ -0,0 +1,136 @@
+// Anti-phishing word table — words for the next PIN digit, computed ahead
+
+#include "anti_phishing_table.h"
+#include "../utils/secure_mem.h"
+#include "pin.h"
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AP_TASK_STACK_SIZE 4096
+#define AP_TASK_PRIORITY 3
+#define AP_TASK_CORE 1
+
+static const char *TAG = "ap_table";
+
+typedef struct {
+  uint32_t generation;
+  char prefix[PIN_MAX_LENGTH];
+  size_t len; // partial length; prefix[len] is the candidate digit
+} ap_job_t;
+
+static SemaphoreHandle_t lock = NULL;
+// Bumped by every prepare and clear; a worker whose run is no longer current
+// stores nothing.
+static uint32_t generation = 0;
+static bool prepared = false;
+static char partial[PIN_MAX_LENGTH];
+static size_t partial_len = 0;
+static bool ready[AP_TABLE_CANDIDATES];
+static ap_words_t words[AP_TABLE_CANDIDATES];
+
+// Lock held.
+static void wipe_table(void) {
+  generation++;
+  prepared = false;
+  secure_memzero(partial, sizeof(partial));
+  partial_len = 0;
+  secure_memzero(ready, sizeof(ready));
+  secure_memzero(words, sizeof(words));
+}
+
+/* Runs on the second core — does NOT touch LVGL */
+static void ap_task(void *arg) {
+  ap_job_t *job = arg;
+
+  for (int d = 0; d < AP_TABLE_CANDIDATES; d++) {
+    ap_words_t w = {0};
+    job->prefix[job->len] = (char)('0' + d);
+    esp_err_t err = pin_compute_anti_phishing(job->prefix, job->len + 1,
+                                              &w.word1, &w.word2, w.identicon);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool current = job->generation == generation;
+    if (current && err == ESP_OK) {
+      words[d] = w;
+      ready[d] = true;
+    }
+    xSemaphoreGive(lock);
+    secure_memzero(&w, sizeof(w));
+    if (!current)
+      break;
+  }
+
+  SECURE_FREE_BUFFER(job, sizeof(*job));
+  vTaskDelete(NULL);
+}
+
+void ap_table_prepare(const char *partial_in, size_t len) {
+  if (!partial_in || len >= PIN_MAX_LENGTH)
+    return;
+  if (!lock) {
+    lock = xSemaphoreCreateMutex();
+    if (!lock)
+      return;
+  }
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  if (prepared && partial_len == len &&
+      secure_memcmp(partial, partial_in, len) == 0) {
+    xSemaphoreGive(lock);
+    return;
+  }
+  wipe_table();
+
+  ap_job_t *job = malloc(sizeof(*job));
+  if (!job) {
+    xSemaphoreGive(lock);
+    return;
+  }
+  job->generation = generation;
+  memcpy(job->prefix, partial_in, len);
+  job->len = len;
+  memcpy(partial, partial_in, len);
+  partial_len = len;
+  prepared = true;
+  xSemaphoreGive(lock);
+
+  if (xTaskCreatePinnedToCore(ap_task, "ap_table", AP_TASK_STACK_SIZE, job,
+                              AP_TASK_PRIORITY, NULL, AP_TASK_CORE) != pdPASS) {
+    ESP_LOGW(TAG, "No worker; words will be computed on reveal");
+    SECURE_FREE_BUFFER(job, sizeof(*job));
+    ap_table_clear();
+  }
+}
+
+bool ap_table_take(const char *prefix, size_t len, ap_words_t *out) {
+  if (!lock || !prefix || !out || len == 0)
+    return false;
+
+  char digit = prefix[len - 1];
+  bool is_digit = digit >= '0' && digit <= '9';
+  int d = is_digit ? digit - '0' : 0;
+
+  // Hit or miss, the split digit has been typed: the other entries (and a
+  // worker still filling them in) are of no further use.
+  xSemaphoreTake(lock, portMAX_DELAY);
+  bool hit = is_digit && prepared && ready[d] && partial_len == len - 1 &&
+             secure_memcmp(partial, prefix, partial_len) == 0;
+  if (hit)
+    *out = words[d];
+  wipe_table();
+  xSemaphoreGive(lock);
+  return hit;
+}
+
+void ap_table_clear(void) {
+  if (!lock)
+    return;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  wipe_table();
+  xSemaphoreGive(lock);
+}
@@ -0,0 +1,44 @@
+// Anti-phishing word table — words for the next PIN digit, computed ahead
+//
+// One keystroke before the split position the PIN page hands the prefix
+// typed so far to ap_table_prepare(). A task on the second core then runs
+// pin_compute_anti_phishing() for that prefix followed by each digit, so when
+// the split digit arrives its words are already there and the reveal does
+// not wait on the HMAC peripheral. Only digits are prepared; any other
+// character (PINs may contain letters and symbols) takes the synchronous
+// path.
+//
+// Taking an entry wipes the whole table, hit or miss, and so does clearing
+// it, so no prefix's words outlive the keystroke that needed them, as with
+// the synchronous call. UI task only, apart from the internal worker.
+
+#ifndef ANTI_PHISHING_TABLE_H
+#define ANTI_PHISHING_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define AP_TABLE_CANDIDATES 10 // '0'..'9'
+
+typedef struct {
+  const char *word1; // into the BIP39 wordlist
+  const char *word2;
+  uint8_t identicon[3];
+} ap_words_t;
+
+/* Start computing the words for partial + each digit, replacing (and wiping)
+ * any earlier table. A call with the partial already prepared is a no-op. */
+void ap_table_prepare(const char *partial, size_t len);
+
+/* If prefix is the prepared partial plus a digit whose words are ready,
+ * copies them to out and returns true. Otherwise returns false; compute the
+ * words synchronously. Either way the table is wiped and a run in flight
+ * stores nothing more. */
+bool ap_table_take(const char *prefix, size_t len, ap_words_t *out);
+
+/* Wipe the table and drop a run in flight (backspace below the split, page
+ * teardown). */
+void ap_table_clear(void);
+
+#endif // ANTI_PHISHING_TABLE_H
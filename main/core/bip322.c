@@ -1,4 +1,5 @@
 #include "bip322.h"
+#include "crypto_utils.h"
 #include "psbt.h"
 #include <esp_log.h>
 #include <stdlib.h>
@@ -34,27 +35,43 @@ bool bip322_detect(const struct wally_psbt *psbt) {
   return psbt && get_message_field(psbt, &msg, &msg_len);
 }
 
-/* BIP322 tagged hash: SHA256(SHA256(tag) || SHA256(tag) || message) */
-static bool message_tagged_hash(const unsigned char *msg, size_t msg_len,
-                                unsigned char hash_out[SHA256_LEN]) {
+/* SHA256(tag) || SHA256(tag), the first block of every message hash: hashed
+ * on first use and cloned for each message after. */
+static crypto_sha256_ctx_t *tag_prefix = NULL;
+
+static bool tag_prefix_init(void) {
   static const char tag[] = "BIP0322-signed-message";
   unsigned char tag_hash[SHA256_LEN];
   if (wally_sha256((const unsigned char *)tag, sizeof(tag) - 1, tag_hash,
                    sizeof(tag_hash)) != WALLY_OK)
     return false;
 
-  size_t buf_len = 2 * SHA256_LEN + msg_len;
-  unsigned char *buf = malloc(buf_len);
-  if (!buf)
+  crypto_sha256_ctx_t *ctx;
+  if (crypto_sha256_start(&ctx) != CRYPTO_OK)
     return false;
-  memcpy(buf, tag_hash, SHA256_LEN);
-  memcpy(buf + SHA256_LEN, tag_hash, SHA256_LEN);
-  if (msg_len)
-    memcpy(buf + 2 * SHA256_LEN, msg, msg_len);
+  if (crypto_sha256_update(ctx, tag_hash, SHA256_LEN) != CRYPTO_OK ||
+      crypto_sha256_update(ctx, tag_hash, SHA256_LEN) != CRYPTO_OK) {
+    crypto_sha256_abort(ctx);
+    return false;
+  }
+  tag_prefix = ctx;
+  return true;
+}
 
-  int ret = wally_sha256(buf, buf_len, hash_out, SHA256_LEN);
-  free(buf);
-  return ret == WALLY_OK;
+/* BIP322 tagged hash: SHA256(SHA256(tag) || SHA256(tag) || message) */
+static bool message_tagged_hash(const unsigned char *msg, size_t msg_len,
+                                unsigned char hash_out[SHA256_LEN]) {
+  if (!tag_prefix && !tag_prefix_init())
+    return false;
+
+  crypto_sha256_ctx_t *ctx;
+  if (crypto_sha256_clone(tag_prefix, &ctx) != CRYPTO_OK)
+    return false;
+  if (crypto_sha256_update(ctx, msg, msg_len) != CRYPTO_OK) {
+    crypto_sha256_abort(ctx);
+    return false;
+  }
+  return crypto_sha256_finish(ctx, hash_out) == CRYPTO_OK;
 }
 
 /* Rebuild the virtual to_spend transaction for the message + proven script
@@ -1,4 +1,5 @@
 #include "crypto_utils.h"
+#include "../utils/secure_mem.h"
 #include "entropy_pool.h"
 #include <bootloader_random.h>
 #include <esp_random.h>
@@ -11,6 +12,9 @@
 /* Host mbedTLS predates PSA PBKDF2 (added in 3.5); use the legacy pkcs5 API
  * there. The simulator's force-included mbedtls_compat.h wraps it for 2.x. */
 #include <mbedtls/pkcs5.h>
+/* Nor does it have multi-part PSA AEAD; GCM streams use the legacy context.
+ * mbedtls_compat.h maps the 3.x calls for a 2.x host. */
+#include <mbedtls/gcm.h>
 #endif
 
 static bool ensure_psa_init(void) { return psa_crypto_init() == PSA_SUCCESS; }
@@ -25,6 +29,31 @@ static psa_status_t aes_key_import(const uint8_t key[CRYPTO_AES_KEY_SIZE],
   return psa_import_key(&attr, key, CRYPTO_AES_KEY_SIZE, key_id);
 }
 
+static int aes_cipher_keyed(mbedtls_svc_key_id_t key_id, psa_algorithm_t alg,
+                            bool encrypt, const uint8_t *iv, size_t iv_len,
+                            const uint8_t *input, size_t input_len,
+                            uint8_t *output) {
+  psa_cipher_operation_t op = PSA_CIPHER_OPERATION_INIT;
+  psa_status_t st = encrypt ? psa_cipher_encrypt_setup(&op, key_id, alg)
+                            : psa_cipher_decrypt_setup(&op, key_id, alg);
+  size_t out_len = 0;
+  size_t fin_len = 0;
+  if (st == PSA_SUCCESS && iv_len > 0) {
+    st = psa_cipher_set_iv(&op, iv, iv_len);
+  }
+  if (st == PSA_SUCCESS) {
+    st = psa_cipher_update(&op, input, input_len, output, input_len, &out_len);
+  }
+  if (st == PSA_SUCCESS) {
+    st =
+        psa_cipher_finish(&op, output + out_len, input_len - out_len, &fin_len);
+  }
+  psa_cipher_abort(&op);
+  return (st == PSA_SUCCESS && out_len + fin_len == input_len)
+             ? CRYPTO_OK
+             : CRYPTO_ERR_INTERNAL;
+}
+
 static int aes_cipher_run(const uint8_t key[CRYPTO_AES_KEY_SIZE],
                           psa_algorithm_t alg, bool encrypt, const uint8_t *iv,
                           size_t iv_len, const uint8_t *input, size_t input_len,
@@ -41,26 +70,61 @@ static int aes_cipher_run(const uint8_t key[CRYPTO_AES_KEY_SIZE],
     return CRYPTO_ERR_INTERNAL;
   }
 
-  psa_cipher_operation_t op = PSA_CIPHER_OPERATION_INIT;
-  st = encrypt ? psa_cipher_encrypt_setup(&op, key_id, alg)
-               : psa_cipher_decrypt_setup(&op, key_id, alg);
+  int rc = aes_cipher_keyed(key_id, alg, encrypt, iv, iv_len, input, input_len,
+                            output);
+  psa_destroy_key(key_id);
+  return rc;
+}
+
+/* PSA one-shot AEAD works on ciphertext||tag; these split and join it. */
+static int gcm_encrypt_keyed(mbedtls_svc_key_id_t key_id, psa_algorithm_t alg,
+                             const uint8_t *nonce, size_t nonce_len,
+                             const uint8_t *input, size_t input_len,
+                             uint8_t *output, uint8_t *tag, size_t tag_len) {
+  size_t scratch_len = input_len + tag_len;
+  uint8_t *scratch = malloc(scratch_len);
+  if (!scratch) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+
   size_t out_len = 0;
-  size_t fin_len = 0;
-  if (st == PSA_SUCCESS && iv_len > 0) {
-    st = psa_cipher_set_iv(&op, iv, iv_len);
+  psa_status_t st =
+      psa_aead_encrypt(key_id, alg, nonce, nonce_len, NULL, 0, input, input_len,
+                       scratch, scratch_len, &out_len);
+  if (st != PSA_SUCCESS || out_len != scratch_len) {
+    free(scratch);
+    return CRYPTO_ERR_INTERNAL;
   }
-  if (st == PSA_SUCCESS) {
-    st = psa_cipher_update(&op, input, input_len, output, input_len, &out_len);
+
+  memcpy(output, scratch, input_len);
+  memcpy(tag, scratch + input_len, tag_len);
+  free(scratch);
+  return CRYPTO_OK;
+}
+
+static int gcm_decrypt_keyed(mbedtls_svc_key_id_t key_id, psa_algorithm_t alg,
+                             const uint8_t *nonce, size_t nonce_len,
+                             const uint8_t *input, size_t input_len,
+                             uint8_t *output, const uint8_t *tag,
+                             size_t tag_len) {
+  size_t scratch_len = input_len + tag_len;
+  uint8_t *scratch = malloc(scratch_len);
+  if (!scratch) {
+    return CRYPTO_ERR_INTERNAL;
   }
-  if (st == PSA_SUCCESS) {
-    st =
-        psa_cipher_finish(&op, output + out_len, input_len - out_len, &fin_len);
+  memcpy(scratch, input, input_len);
+  memcpy(scratch + input_len, tag, tag_len);
+
+  size_t out_len = 0;
+  psa_status_t st =
+      psa_aead_decrypt(key_id, alg, nonce, nonce_len, NULL, 0, scratch,
+                       scratch_len, output, input_len, &out_len);
+  free(scratch);
+  if (st == PSA_ERROR_INVALID_SIGNATURE) {
+    return CRYPTO_ERR_AUTH_FAILED;
   }
-  psa_cipher_abort(&op);
-  psa_destroy_key(key_id);
-  return (st == PSA_SUCCESS && out_len + fin_len == input_len)
-             ? CRYPTO_OK
-             : CRYPTO_ERR_INTERNAL;
+  return (st == PSA_SUCCESS && out_len == input_len) ? CRYPTO_OK
+                                                     : CRYPTO_ERR_INTERNAL;
 }
 
 /* --- Key Derivation --- */
@@ -125,6 +189,95 @@ int crypto_sha256(const uint8_t *data, size_t data_len, uint8_t *hash_out) {
              : CRYPTO_ERR_INTERNAL;
 }
 
+/* --- Multi-part SHA-256 --- */
+
+struct crypto_sha256_ctx {
+  psa_hash_operation_t op;
+};
+
+int crypto_sha256_start(crypto_sha256_ctx_t **ctx_out) {
+  if (!ctx_out) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  *ctx_out = NULL;
+
+  if (!ensure_psa_init()) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+
+  crypto_sha256_ctx_t *ctx = calloc(1, sizeof(*ctx));
+  if (!ctx) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  ctx->op = psa_hash_operation_init();
+  if (psa_hash_setup(&ctx->op, PSA_ALG_SHA_256) != PSA_SUCCESS) {
+    free(ctx);
+    return CRYPTO_ERR_INTERNAL;
+  }
+  *ctx_out = ctx;
+  return CRYPTO_OK;
+}
+
+int crypto_sha256_update(crypto_sha256_ctx_t *ctx, const uint8_t *data,
+                         size_t data_len) {
+  if (!ctx || (!data && data_len > 0)) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  if (data_len == 0) {
+    return CRYPTO_OK;
+  }
+  return psa_hash_update(&ctx->op, data, data_len) == PSA_SUCCESS
+             ? CRYPTO_OK
+             : CRYPTO_ERR_INTERNAL;
+}
+
+int crypto_sha256_finish(crypto_sha256_ctx_t *ctx, uint8_t *hash_out) {
+  if (!ctx) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  if (!hash_out) {
+    crypto_sha256_abort(ctx);
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+
+  size_t hash_len = 0;
+  psa_status_t st =
+      psa_hash_finish(&ctx->op, hash_out, CRYPTO_SHA256_SIZE, &hash_len);
+  crypto_sha256_abort(ctx);
+  return (st == PSA_SUCCESS && hash_len == CRYPTO_SHA256_SIZE)
+             ? CRYPTO_OK
+             : CRYPTO_ERR_INTERNAL;
+}
+
+void crypto_sha256_abort(crypto_sha256_ctx_t *ctx) {
+  if (!ctx) {
+    return;
+  }
+  psa_hash_abort(&ctx->op);
+  secure_memzero(ctx, sizeof(*ctx));
+  free(ctx);
+}
+
+int crypto_sha256_clone(const crypto_sha256_ctx_t *ctx,
+                        crypto_sha256_ctx_t **clone_out) {
+  if (!ctx || !clone_out) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  *clone_out = NULL;
+
+  crypto_sha256_ctx_t *clone = calloc(1, sizeof(*clone));
+  if (!clone) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  clone->op = psa_hash_operation_init();
+  if (psa_hash_clone(&ctx->op, &clone->op) != PSA_SUCCESS) {
+    free(clone);
+    return CRYPTO_ERR_INTERNAL;
+  }
+  *clone_out = clone;
+  return CRYPTO_OK;
+}
+
 /* --- AES-256-ECB --- */
 
 int crypto_aes_ecb_encrypt(const uint8_t key[CRYPTO_AES_KEY_SIZE],
@@ -217,28 +370,10 @@ int crypto_aes_gcm_encrypt(const uint8_t key[CRYPTO_AES_KEY_SIZE],
     return CRYPTO_ERR_INTERNAL;
   }
 
-  /* PSA one-shot AEAD emits ciphertext||tag contiguously; split afterwards */
-  size_t scratch_len = input_len + tag_len;
-  uint8_t *scratch = malloc(scratch_len);
-  if (!scratch) {
-    psa_destroy_key(key_id);
-    return CRYPTO_ERR_INTERNAL;
-  }
-
-  size_t out_len = 0;
-  psa_status_t st =
-      psa_aead_encrypt(key_id, alg, nonce, nonce_len, NULL, 0, input, input_len,
-                       scratch, scratch_len, &out_len);
+  int rc = gcm_encrypt_keyed(key_id, alg, nonce, nonce_len, input, input_len,
+                             output, tag, tag_len);
   psa_destroy_key(key_id);
-  if (st != PSA_SUCCESS || out_len != scratch_len) {
-    free(scratch);
-    return CRYPTO_ERR_INTERNAL;
-  }
-
-  memcpy(output, scratch, input_len);
-  memcpy(tag, scratch + input_len, tag_len);
-  free(scratch);
-  return CRYPTO_OK;
+  return rc;
 }
 
 int crypto_aes_gcm_decrypt(const uint8_t key[CRYPTO_AES_KEY_SIZE],
@@ -261,26 +396,440 @@ int crypto_aes_gcm_decrypt(const uint8_t key[CRYPTO_AES_KEY_SIZE],
     return CRYPTO_ERR_INTERNAL;
   }
 
-  size_t scratch_len = input_len + tag_len;
-  uint8_t *scratch = malloc(scratch_len);
-  if (!scratch) {
-    psa_destroy_key(key_id);
+  int rc = gcm_decrypt_keyed(key_id, alg, nonce, nonce_len, input, input_len,
+                             output, tag, tag_len);
+  psa_destroy_key(key_id);
+  return rc;
+}
+
+/* --- Reusable AES-256 keys --- */
+
+typedef enum {
+  AES_SLOT_ECB,
+  AES_SLOT_CBC,
+  AES_SLOT_CTR,
+  AES_SLOT_GCM,
+  AES_SLOT_COUNT,
+} aes_slot_t;
+
+/* A PSA key is bound to one algorithm, so each mode gets its own, imported
+ * on first use. GCM's also fixes the tag length; another length re-imports
+ * it. */
+struct crypto_aes_key {
+  uint8_t raw[CRYPTO_AES_KEY_SIZE];
+  mbedtls_svc_key_id_t ids[AES_SLOT_COUNT];
+  psa_algorithm_t algs[AES_SLOT_COUNT];
+  bool imported[AES_SLOT_COUNT];
+};
+
+int crypto_aes_key_create(const uint8_t key[CRYPTO_AES_KEY_SIZE],
+                          crypto_aes_key_t **key_out) {
+  if (!key || !key_out) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  *key_out = NULL;
+
+  if (!ensure_psa_init()) {
     return CRYPTO_ERR_INTERNAL;
   }
-  memcpy(scratch, input, input_len);
-  memcpy(scratch + input_len, tag, tag_len);
 
-  size_t out_len = 0;
+  crypto_aes_key_t *k = calloc(1, sizeof(*k));
+  if (!k) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  memcpy(k->raw, key, CRYPTO_AES_KEY_SIZE);
+  *key_out = k;
+  return CRYPTO_OK;
+}
+
+void crypto_aes_key_destroy(crypto_aes_key_t *key) {
+  if (!key) {
+    return;
+  }
+  for (int i = 0; i < AES_SLOT_COUNT; i++) {
+    if (key->imported[i]) {
+      psa_destroy_key(key->ids[i]);
+    }
+  }
+  secure_memzero(key, sizeof(*key));
+  free(key);
+}
+
+static bool aes_key_slot(crypto_aes_key_t *key, aes_slot_t slot,
+                         psa_algorithm_t alg, mbedtls_svc_key_id_t *id_out) {
+  if (key->imported[slot] && key->algs[slot] != alg) {
+    psa_destroy_key(key->ids[slot]);
+    key->imported[slot] = false;
+  }
+  if (!key->imported[slot]) {
+    if (aes_key_import(key->raw, alg,
+                       PSA_KEY_USAGE_ENCRYPT | PSA_KEY_USAGE_DECRYPT,
+                       &key->ids[slot]) != PSA_SUCCESS) {
+      return false;
+    }
+    key->algs[slot] = alg;
+    key->imported[slot] = true;
+  }
+  *id_out = key->ids[slot];
+  return true;
+}
+
+int crypto_aes_key_ecb(crypto_aes_key_t *key, bool encrypt,
+                       const uint8_t *input, size_t input_len,
+                       uint8_t *output) {
+  if (!key || !input || !output || input_len == 0 ||
+      input_len % CRYPTO_AES_BLOCK_SIZE != 0) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+
+  mbedtls_svc_key_id_t id;
+  if (!aes_key_slot(key, AES_SLOT_ECB, PSA_ALG_ECB_NO_PADDING, &id)) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  return aes_cipher_keyed(id, PSA_ALG_ECB_NO_PADDING, encrypt, NULL, 0, input,
+                          input_len, output);
+}
+
+int crypto_aes_key_cbc(crypto_aes_key_t *key, bool encrypt,
+                       const uint8_t iv[CRYPTO_AES_IV_SIZE],
+                       const uint8_t *input, size_t input_len,
+                       uint8_t *output) {
+  if (!key || !iv || !input || !output || input_len == 0 ||
+      input_len % CRYPTO_AES_BLOCK_SIZE != 0) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+
+  mbedtls_svc_key_id_t id;
+  if (!aes_key_slot(key, AES_SLOT_CBC, PSA_ALG_CBC_NO_PADDING, &id)) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  return aes_cipher_keyed(id, PSA_ALG_CBC_NO_PADDING, encrypt, iv,
+                          CRYPTO_AES_IV_SIZE, input, input_len, output);
+}
+
+int crypto_aes_key_ctr(crypto_aes_key_t *key,
+                       const uint8_t nonce[CRYPTO_AES_CTR_NONCE_SIZE],
+                       const uint8_t *input, size_t input_len,
+                       uint8_t *output) {
+  if (!key || !nonce || !input || !output || input_len == 0) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+
+  mbedtls_svc_key_id_t id;
+  if (!aes_key_slot(key, AES_SLOT_CTR, PSA_ALG_CTR, &id)) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  uint8_t counter[CRYPTO_AES_BLOCK_SIZE] = {0};
+  memcpy(counter, nonce, CRYPTO_AES_CTR_NONCE_SIZE);
+  return aes_cipher_keyed(id, PSA_ALG_CTR, true, counter, sizeof(counter),
+                          input, input_len, output);
+}
+
+int crypto_aes_key_gcm_encrypt(crypto_aes_key_t *key, const uint8_t *nonce,
+                               size_t nonce_len, const uint8_t *input,
+                               size_t input_len, uint8_t *output, uint8_t *tag,
+                               size_t tag_len) {
+  if (!key || !nonce || !input || !output || !tag || nonce_len == 0 ||
+      tag_len == 0 || tag_len > 16) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+
+  psa_algorithm_t alg = PSA_ALG_AEAD_WITH_SHORTENED_TAG(PSA_ALG_GCM, tag_len);
+  mbedtls_svc_key_id_t id;
+  if (!aes_key_slot(key, AES_SLOT_GCM, alg, &id)) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  return gcm_encrypt_keyed(id, alg, nonce, nonce_len, input, input_len, output,
+                           tag, tag_len);
+}
+
+int crypto_aes_key_gcm_decrypt(crypto_aes_key_t *key, const uint8_t *nonce,
+                               size_t nonce_len, const uint8_t *input,
+                               size_t input_len, uint8_t *output,
+                               const uint8_t *tag, size_t tag_len) {
+  if (!key || !nonce || !input || !output || !tag || nonce_len == 0 ||
+      tag_len == 0 || tag_len > 16) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+
+  psa_algorithm_t alg = PSA_ALG_AEAD_WITH_SHORTENED_TAG(PSA_ALG_GCM, tag_len);
+  mbedtls_svc_key_id_t id;
+  if (!aes_key_slot(key, AES_SLOT_GCM, alg, &id)) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  return gcm_decrypt_keyed(id, alg, nonce, nonce_len, input, input_len, output,
+                           tag, tag_len);
+}
+
+/* --- Multi-part AES-256-CTR / GCM --- */
+
+/* Input reaches the backend in whole blocks, except for the final piece at
+ * finish: legacy mbedtls GCM requires it, and it keeps the output lag the same
+ * on every backend. */
+struct crypto_aes_stream {
+  bool gcm;
+  bool encrypt;
+  size_t tag_len;
+  uint8_t partial[CRYPTO_AES_BLOCK_SIZE];
+  size_t partial_len;
+#ifdef SIMULATOR
+  mbedtls_gcm_context gcm_ctx;
+#else
+  psa_aead_operation_t aead;
+#endif
+  psa_cipher_operation_t cipher;
+  mbedtls_svc_key_id_t key_id;
+  bool has_key;
+};
+
+static crypto_aes_stream_t *aes_stream_alloc(bool gcm, bool encrypt,
+                                             size_t tag_len) {
+  crypto_aes_stream_t *s = calloc(1, sizeof(*s));
+  if (!s) {
+    return NULL;
+  }
+  s->gcm = gcm;
+  s->encrypt = encrypt;
+  s->tag_len = tag_len;
+  s->cipher = psa_cipher_operation_init();
+#ifdef SIMULATOR
+  mbedtls_gcm_init(&s->gcm_ctx);
+#else
+  s->aead = psa_aead_operation_init();
+#endif
+  return s;
+}
+
+int crypto_aes_ctr_start(const uint8_t key[CRYPTO_AES_KEY_SIZE],
+                         const uint8_t nonce[CRYPTO_AES_CTR_NONCE_SIZE],
+                         crypto_aes_stream_t **stream_out) {
+  if (!key || !nonce || !stream_out) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  *stream_out = NULL;
+
+  if (!ensure_psa_init()) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+
+  crypto_aes_stream_t *s = aes_stream_alloc(false, true, 0);
+  if (!s) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+
+  uint8_t counter[CRYPTO_AES_BLOCK_SIZE] = {0};
+  memcpy(counter, nonce, CRYPTO_AES_CTR_NONCE_SIZE);
   psa_status_t st =
-      psa_aead_decrypt(key_id, alg, nonce, nonce_len, NULL, 0, scratch,
-                       scratch_len, output, input_len, &out_len);
-  psa_destroy_key(key_id);
-  free(scratch);
-  if (st == PSA_ERROR_INVALID_SIGNATURE) {
-    return CRYPTO_ERR_AUTH_FAILED;
+      aes_key_import(key, PSA_ALG_CTR, PSA_KEY_USAGE_ENCRYPT, &s->key_id);
+  s->has_key = st == PSA_SUCCESS;
+  if (st == PSA_SUCCESS) {
+    st = psa_cipher_encrypt_setup(&s->cipher, s->key_id, PSA_ALG_CTR);
   }
-  return (st == PSA_SUCCESS && out_len == input_len) ? CRYPTO_OK
-                                                     : CRYPTO_ERR_INTERNAL;
+  if (st == PSA_SUCCESS) {
+    st = psa_cipher_set_iv(&s->cipher, counter, sizeof(counter));
+  }
+  if (st != PSA_SUCCESS) {
+    crypto_aes_stream_abort(s);
+    return CRYPTO_ERR_INTERNAL;
+  }
+  *stream_out = s;
+  return CRYPTO_OK;
+}
+
+int crypto_aes_gcm_start(const uint8_t key[CRYPTO_AES_KEY_SIZE], bool encrypt,
+                         const uint8_t *nonce, size_t nonce_len,
+                         size_t tag_len, crypto_aes_stream_t **stream_out) {
+  if (!key || !nonce || !stream_out || nonce_len == 0 || tag_len < 4 ||
+      tag_len > 16) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  *stream_out = NULL;
+
+  if (!ensure_psa_init()) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+
+  crypto_aes_stream_t *s = aes_stream_alloc(true, encrypt, tag_len);
+  if (!s) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+
+#ifdef SIMULATOR
+  bool ok =
+      mbedtls_gcm_setkey(&s->gcm_ctx, MBEDTLS_CIPHER_ID_AES, key,
+                         CRYPTO_AES_KEY_SIZE * 8) == 0 &&
+      mbedtls_gcm_starts(&s->gcm_ctx,
+                         encrypt ? MBEDTLS_GCM_ENCRYPT : MBEDTLS_GCM_DECRYPT,
+                         nonce, nonce_len) == 0;
+#else
+  psa_algorithm_t alg = PSA_ALG_AEAD_WITH_SHORTENED_TAG(PSA_ALG_GCM, tag_len);
+  psa_status_t st = aes_key_import(
+      key, alg, encrypt ? PSA_KEY_USAGE_ENCRYPT : PSA_KEY_USAGE_DECRYPT,
+      &s->key_id);
+  s->has_key = st == PSA_SUCCESS;
+  if (st == PSA_SUCCESS) {
+    st = encrypt ? psa_aead_encrypt_setup(&s->aead, s->key_id, alg)
+                 : psa_aead_decrypt_setup(&s->aead, s->key_id, alg);
+  }
+  if (st == PSA_SUCCESS) {
+    st = psa_aead_set_nonce(&s->aead, nonce, nonce_len);
+  }
+  bool ok = st == PSA_SUCCESS;
+#endif
+  if (!ok) {
+    crypto_aes_stream_abort(s);
+    return CRYPTO_ERR_INTERNAL;
+  }
+  *stream_out = s;
+  return CRYPTO_OK;
+}
+
+static int aes_stream_run(crypto_aes_stream_t *s, const uint8_t *input,
+                          size_t input_len, uint8_t *output,
+                          size_t output_size, size_t *output_len) {
+  *output_len = 0;
+  if (input_len == 0) {
+    return CRYPTO_OK;
+  }
+  if (!s->gcm) {
+    return psa_cipher_update(&s->cipher, input, input_len, output,
+                             output_size, output_len) == PSA_SUCCESS
+               ? CRYPTO_OK
+               : CRYPTO_ERR_INTERNAL;
+  }
+#ifdef SIMULATOR
+  return mbedtls_gcm_update(&s->gcm_ctx, input, input_len, output,
+                            output_size, output_len) == 0
+             ? CRYPTO_OK
+             : CRYPTO_ERR_INTERNAL;
+#else
+  return psa_aead_update(&s->aead, input, input_len, output, output_size,
+                         output_len) == PSA_SUCCESS
+             ? CRYPTO_OK
+             : CRYPTO_ERR_INTERNAL;
+#endif
+}
+
+int crypto_aes_stream_update(crypto_aes_stream_t *stream,
+                             const uint8_t *input, size_t input_len,
+                             uint8_t *output, size_t output_size,
+                             size_t *output_len) {
+  if (!stream || (!input && input_len > 0) || !output || !output_len ||
+      output_size < stream->partial_len + input_len) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  *output_len = 0;
+
+  size_t used = 0;
+  size_t n;
+  if (stream->partial_len > 0) {
+    used = CRYPTO_AES_BLOCK_SIZE - stream->partial_len;
+    if (used > input_len) {
+      used = input_len;
+    }
+    memcpy(stream->partial + stream->partial_len, input, used);
+    stream->partial_len += used;
+    if (stream->partial_len < CRYPTO_AES_BLOCK_SIZE) {
+      return CRYPTO_OK;
+    }
+    if (aes_stream_run(stream, stream->partial, CRYPTO_AES_BLOCK_SIZE, output,
+                       output_size, &n) != CRYPTO_OK) {
+      return CRYPTO_ERR_INTERNAL;
+    }
+    *output_len = n;
+    stream->partial_len = 0;
+  }
+
+  size_t whole = (input_len - used) / CRYPTO_AES_BLOCK_SIZE *
+                 CRYPTO_AES_BLOCK_SIZE;
+  if (aes_stream_run(stream, input + used, whole, output + *output_len,
+                     output_size - *output_len, &n) != CRYPTO_OK) {
+    return CRYPTO_ERR_INTERNAL;
+  }
+  *output_len += n;
+  used += whole;
+
+  stream->partial_len = input_len - used;
+  memcpy(stream->partial, input + used, stream->partial_len);
+  return CRYPTO_OK;
+}
+
+int crypto_aes_stream_finish(crypto_aes_stream_t *stream, uint8_t *output,
+                             size_t output_size, size_t *output_len,
+                             uint8_t *tag, size_t tag_len) {
+  if (!stream) {
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  if (!output || !output_len || output_size < stream->partial_len ||
+      (stream->gcm && (!tag || tag_len != stream->tag_len))) {
+    crypto_aes_stream_abort(stream);
+    return CRYPTO_ERR_INVALID_ARG;
+  }
+  *output_len = 0;
+
+  size_t n = 0;
+  size_t fin = 0;
+  int rc = aes_stream_run(stream, stream->partial, stream->partial_len,
+                          output, output_size, &n);
+  if (rc == CRYPTO_OK && !stream->gcm) {
+    if (psa_cipher_finish(&stream->cipher, output + n, output_size - n,
+                          &fin) != PSA_SUCCESS) {
+      rc = CRYPTO_ERR_INTERNAL;
+    }
+  } else if (rc == CRYPTO_OK) {
+#ifdef SIMULATOR
+    uint8_t computed[16];
+    if (mbedtls_gcm_finish(&stream->gcm_ctx, output + n, output_size - n,
+                           &fin, computed, tag_len) != 0) {
+      rc = CRYPTO_ERR_INTERNAL;
+    } else if (stream->encrypt) {
+      memcpy(tag, computed, tag_len);
+    } else if (secure_memcmp(computed, tag, tag_len) != 0) {
+      rc = CRYPTO_ERR_AUTH_FAILED;
+    }
+    secure_memzero(computed, sizeof(computed));
+#else
+    psa_status_t st;
+    if (stream->encrypt) {
+      size_t written = 0;
+      st = psa_aead_finish(&stream->aead, output + n, output_size - n, &fin,
+                           tag, tag_len, &written);
+      if (st == PSA_SUCCESS && written != tag_len) {
+        st = PSA_ERROR_GENERIC_ERROR;
+      }
+    } else {
+      st = psa_aead_verify(&stream->aead, output + n, output_size - n, &fin,
+                           tag, tag_len);
+    }
+    if (st == PSA_ERROR_INVALID_SIGNATURE) {
+      rc = CRYPTO_ERR_AUTH_FAILED;
+    } else if (st != PSA_SUCCESS) {
+      rc = CRYPTO_ERR_INTERNAL;
+    }
+#endif
+  }
+  if (rc == CRYPTO_OK) {
+    *output_len = n + fin;
+  }
+  crypto_aes_stream_abort(stream);
+  return rc;
+}
+
+void crypto_aes_stream_abort(crypto_aes_stream_t *stream) {
+  if (!stream) {
+    return;
+  }
+  psa_cipher_abort(&stream->cipher);
+#ifdef SIMULATOR
+  mbedtls_gcm_free(&stream->gcm_ctx);
+#else
+  psa_aead_abort(&stream->aead);
+#endif
+  if (stream->has_key) {
+    psa_destroy_key(stream->key_id);
+  }
+  secure_memzero(stream, sizeof(*stream));
+  free(stream);
 }
 
 /* --- Random --- */
@@ -10,6 +10,7 @@
 #define CRYPTO_UTILS_H
 
 #include "../utils/attributes.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -40,6 +41,31 @@ crypto_pbkdf2_sha256(const uint8_t *password, size_t password_len,
 KERN_WARN_UNUSED_RESULT int crypto_sha256(const uint8_t *data, size_t data_len,
                                           uint8_t *hash_out);
 
+/* --- Multi-part SHA-256 --- */
+
+/* For data that arrives in pieces. start allocates the context; finish and
+ * abort free it. */
+typedef struct crypto_sha256_ctx crypto_sha256_ctx_t;
+
+KERN_WARN_UNUSED_RESULT int crypto_sha256_start(crypto_sha256_ctx_t **ctx_out);
+
+KERN_WARN_UNUSED_RESULT int crypto_sha256_update(crypto_sha256_ctx_t *ctx,
+                                                 const uint8_t *data,
+                                                 size_t data_len);
+
+/* Writes the digest and frees ctx, also on error. */
+KERN_WARN_UNUSED_RESULT int crypto_sha256_finish(crypto_sha256_ctx_t *ctx,
+                                                 uint8_t *hash_out);
+
+/* Frees ctx without a digest. Safe on NULL. */
+void crypto_sha256_abort(crypto_sha256_ctx_t *ctx);
+
+/* New context in ctx's state, which is left as it was: hash a shared prefix
+ * (a tagged-hash tag) once and clone it for each message. */
+KERN_WARN_UNUSED_RESULT int
+crypto_sha256_clone(const crypto_sha256_ctx_t *ctx,
+                    crypto_sha256_ctx_t **clone_out);
+
 /* --- AES-256-ECB --- */
 
 /* Encrypt/decrypt in ECB mode. input_len must be a multiple of 16. */
@@ -92,6 +118,92 @@ crypto_aes_gcm_decrypt(const uint8_t key[CRYPTO_AES_KEY_SIZE],
                        const uint8_t *input, size_t input_len, uint8_t *output,
                        const uint8_t *tag, size_t tag_len);
 
+/* --- Reusable AES-256 keys --- */
+
+/* The calls above import the key into the PSA key store and set up the
+ * driver on every call. A key used for a batch (trying several envelopes,
+ * one block at a time) is imported once here instead, per mode on first use,
+ * and each call only runs the cipher. Same results as the one-shot calls;
+ * the same argument rules apply. */
+typedef struct crypto_aes_key crypto_aes_key_t;
+
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_key_create(const uint8_t key[CRYPTO_AES_KEY_SIZE],
+                      crypto_aes_key_t **key_out);
+
+/* Removes the key from the key store and wipes it. Safe on NULL. */
+void crypto_aes_key_destroy(crypto_aes_key_t *key);
+
+KERN_WARN_UNUSED_RESULT int crypto_aes_key_ecb(crypto_aes_key_t *key,
+                                               bool encrypt,
+                                               const uint8_t *input,
+                                               size_t input_len,
+                                               uint8_t *output);
+
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_key_cbc(crypto_aes_key_t *key, bool encrypt,
+                   const uint8_t iv[CRYPTO_AES_IV_SIZE], const uint8_t *input,
+                   size_t input_len, uint8_t *output);
+
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_key_ctr(crypto_aes_key_t *key,
+                   const uint8_t nonce[CRYPTO_AES_CTR_NONCE_SIZE],
+                   const uint8_t *input, size_t input_len, uint8_t *output);
+
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_key_gcm_encrypt(crypto_aes_key_t *key, const uint8_t *nonce,
+                           size_t nonce_len, const uint8_t *input,
+                           size_t input_len, uint8_t *output, uint8_t *tag,
+                           size_t tag_len);
+
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_key_gcm_decrypt(crypto_aes_key_t *key, const uint8_t *nonce,
+                           size_t nonce_len, const uint8_t *input,
+                           size_t input_len, uint8_t *output,
+                           const uint8_t *tag, size_t tag_len);
+
+/* --- Multi-part AES-256-CTR / GCM --- */
+
+/* Streaming counterparts of crypto_aes_ctr and crypto_aes_gcm_*, producing
+ * the same bytes for the same key, nonce and data however the input is split.
+ * Output may trail input by up to one block: give update room for
+ * CRYPTO_AES_STREAM_OUT_SIZE(input_len) bytes and finish room for one block.
+ *
+ * A GCM decrypt stream hands out plaintext before the tag is checked; the
+ * caller must drop everything it received if finish fails. */
+typedef struct crypto_aes_stream crypto_aes_stream_t;
+
+#define CRYPTO_AES_STREAM_OUT_SIZE(input_len)                                  \
+  ((input_len) + CRYPTO_AES_BLOCK_SIZE)
+
+/* The counter starts at 0, as in crypto_aes_ctr. */
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_ctr_start(const uint8_t key[CRYPTO_AES_KEY_SIZE],
+                     const uint8_t nonce[CRYPTO_AES_CTR_NONCE_SIZE],
+                     crypto_aes_stream_t **stream_out);
+
+/* tag_len can be 4-16 bytes. */
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_gcm_start(const uint8_t key[CRYPTO_AES_KEY_SIZE], bool encrypt,
+                     const uint8_t *nonce, size_t nonce_len, size_t tag_len,
+                     crypto_aes_stream_t **stream_out);
+
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_stream_update(crypto_aes_stream_t *stream, const uint8_t *input,
+                         size_t input_len, uint8_t *output, size_t output_size,
+                         size_t *output_len);
+
+/* Flushes the last output and frees stream, also on error. GCM encrypt
+ * writes the tag; GCM decrypt checks it and returns CRYPTO_ERR_AUTH_FAILED on
+ * a mismatch. CTR takes no tag (NULL, 0). */
+KERN_WARN_UNUSED_RESULT int
+crypto_aes_stream_finish(crypto_aes_stream_t *stream, uint8_t *output,
+                         size_t output_size, size_t *output_len, uint8_t *tag,
+                         size_t tag_len);
+
+/* Frees stream without finishing. Safe on NULL. */
+void crypto_aes_stream_abort(crypto_aes_stream_t *stream);
+
 /* --- Random --- */
 
 /* Fill buf with cryptographically secure random bytes (hardware TRNG).
@@ -0,0 +1,155 @@
+#include "descriptor_parse.h"
+#include "descriptor_checksum.h"
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <wally_address.h>
+#include <wally_core.h>
+#include <wally_descriptor.h>
+
+/* Base58-encoded extended keys are 82 bytes: their version bytes always
+ * encode to these four leading characters. */
+#define EXTENDED_KEY_B58_LEN 111
+#define WIF_B58_LEN_UNCOMPRESSED 51
+#define WIF_B58_LEN_COMPRESSED 52
+
+static bool is_base58_char(char c) {
+  if (c >= '1' && c <= '9')
+    return true;
+  if (c >= 'a' && c <= 'z')
+    return c != 'l';
+  if (c >= 'A' && c <= 'Z')
+    return c != 'I' && c != 'O';
+  return false;
+}
+
+static bool is_hex_char(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+         (c >= 'A' && c <= 'F');
+}
+
+static descriptor_key_network_t classify_extended_key(const char *tok) {
+  if (strncmp(tok, "xpub", 4) == 0 || strncmp(tok, "xprv", 4) == 0)
+    return DESCRIPTOR_KEYS_MAINNET;
+  if (strncmp(tok, "tpub", 4) == 0 || strncmp(tok, "tprv", 4) == 0)
+    return DESCRIPTOR_KEYS_TESTNET;
+  return DESCRIPTOR_KEYS_NEUTRAL;
+}
+
+/* WIF version 0x80 encodes to '5' (uncompressed) or 'K'/'L' (compressed),
+ * 0xEF to '9' or 'c'. Hex runs (hashes, raw keys) of the same length are told
+ * apart by requiring a non-hex character, which a real WIF key has with
+ * overwhelming probability. */
+static descriptor_key_network_t classify_wif(const char *tok, size_t len) {
+  bool has_non_hex = false;
+  for (size_t i = 0; i < len && !has_non_hex; i++)
+    has_non_hex = !is_hex_char(tok[i]);
+  if (!has_non_hex)
+    return DESCRIPTOR_KEYS_NEUTRAL;
+  if (tok[0] == '5' || tok[0] == 'K' || tok[0] == 'L')
+    return DESCRIPTOR_KEYS_MAINNET;
+  if (tok[0] == '9' || tok[0] == 'c')
+    return DESCRIPTOR_KEYS_TESTNET;
+  return DESCRIPTOR_KEYS_NEUTRAL;
+}
+
+/* `addr` points just past "addr(". */
+static descriptor_key_network_t classify_address(const char *addr) {
+  if (strncasecmp(addr, "bc1", 3) == 0 || addr[0] == '1' || addr[0] == '3')
+    return DESCRIPTOR_KEYS_MAINNET;
+  if (strncasecmp(addr, "tb1", 3) == 0 || addr[0] == 'm' || addr[0] == 'n' ||
+      addr[0] == '2')
+    return DESCRIPTOR_KEYS_TESTNET;
+  return DESCRIPTOR_KEYS_NEUTRAL;
+}
+
+static descriptor_key_network_t merge(descriptor_key_network_t acc,
+                                      descriptor_key_network_t tok) {
+  if (tok == DESCRIPTOR_KEYS_NEUTRAL || tok == acc)
+    return acc;
+  if (acc == DESCRIPTOR_KEYS_NEUTRAL)
+    return tok;
+  return DESCRIPTOR_KEYS_MIXED;
+}
+
+descriptor_key_network_t descriptor_scan_key_network(const char *s) {
+  descriptor_key_network_t net = DESCRIPTOR_KEYS_NEUTRAL;
+  if (!s)
+    return net;
+
+  const char *p = s;
+  while (*p && *p != '#' && net != DESCRIPTOR_KEYS_MIXED) {
+    if (!is_base58_char(*p)) {
+      p++;
+      continue;
+    }
+    const char *tok = p;
+    while (is_base58_char(*p))
+      p++;
+    size_t len = (size_t)(p - tok);
+
+    if (len == 4 && strncmp(tok, "addr", 4) == 0 && *p == '(')
+      net = merge(net, classify_address(p + 1));
+    else if (len == EXTENDED_KEY_B58_LEN)
+      net = merge(net, classify_extended_key(tok));
+    else if (len == WIF_B58_LEN_UNCOMPRESSED || len == WIF_B58_LEN_COMPRESSED)
+      net = merge(net, classify_wif(tok, len));
+  }
+  return net;
+}
+
+int descriptor_parse_once(const char *descriptor_str,
+                          wallet_network_t preferred,
+                          descriptor_parsed_t *out) {
+  if (!out)
+    return WALLY_EINVAL;
+  memset(out, 0, sizeof(*out));
+  if (!descriptor_str)
+    return WALLY_EINVAL;
+
+  wallet_network_t network = preferred;
+  switch (descriptor_scan_key_network(descriptor_str)) {
+  case DESCRIPTOR_KEYS_MAINNET:
+    network = WALLET_NETWORK_MAINNET;
+    break;
+  case DESCRIPTOR_KEYS_TESTNET:
+    network = WALLET_NETWORK_TESTNET;
+    break;
+  case DESCRIPTOR_KEYS_MIXED:
+    return WALLY_EINVAL;
+  case DESCRIPTOR_KEYS_NEUTRAL:
+    break;
+  }
+
+  uint32_t wally_network = (network == WALLET_NETWORK_MAINNET)
+                               ? WALLY_NETWORK_BITCOIN_MAINNET
+                               : WALLY_NETWORK_BITCOIN_TESTNET;
+  int ret =
+      wallet_descriptor_parse(descriptor_str, NULL, wally_network, &out->desc);
+  if (ret != WALLY_OK) {
+    out->desc = NULL;
+    return ret;
+  }
+  out->network = network;
+  return WALLY_OK;
+}
+
+const char *descriptor_parsed_checksum(descriptor_parsed_t *parsed) {
+  if (!parsed || !parsed->desc)
+    return NULL;
+  if (parsed->checksum[0] == '\0' &&
+      !descriptor_checksum_from_descriptor(parsed->desc, parsed->checksum)) {
+    parsed->checksum[0] = '\0';
+    return NULL;
+  }
+  return parsed->checksum;
+}
+
+void descriptor_parsed_free(descriptor_parsed_t *parsed) {
+  if (!parsed)
+    return;
+  if (parsed->desc)
+    wally_descriptor_free(parsed->desc);
+  parsed->desc = NULL;
+  parsed->checksum[0] = '\0';
+}
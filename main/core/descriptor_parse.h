@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../utils/attributes.h"
+#include "wallet.h"
+#include <stdbool.h>
+
+struct wally_descriptor;
+
+/* Network a descriptor's key expressions commit to, read from the text before
+ * any parse. Extended keys and WIF keys carry it in their version bytes and
+ * addr() carries it in the address prefix; raw public keys carry none. */
+typedef enum {
+  DESCRIPTOR_KEYS_NEUTRAL = 0, /* no network-tagged key: parses on either */
+  DESCRIPTOR_KEYS_MAINNET,
+  DESCRIPTOR_KEYS_TESTNET,
+  DESCRIPTOR_KEYS_MIXED, /* both kinds: libwally rejects it on either */
+} descriptor_key_network_t;
+
+KERN_WARN_UNUSED_RESULT descriptor_key_network_t
+descriptor_scan_key_network(const char *descriptor_str);
+
+/* A descriptor parsed once and handed from validation through duplicate
+ * checks to registration, so none of them parse it again. */
+typedef struct {
+  struct wally_descriptor *desc; /* owned, NULL once released or freed */
+  wallet_network_t network;      /* network `desc` was parsed on */
+  char checksum[9]; /* h-normalized BIP-380 checksum, "" until computed */
+} descriptor_parsed_t;
+
+/* Parse `descriptor_str` with a single wallet_descriptor_parse() call on the
+ * network its keys imply; descriptors without network-tagged keys parse on
+ * `preferred`. Mixed-network descriptors are rejected without parsing. Returns
+ * the libwally result code; on WALLY_OK the caller owns `out` and frees it with
+ * descriptor_parsed_free(). */
+KERN_WARN_UNUSED_RESULT int
+descriptor_parse_once(const char *descriptor_str, wallet_network_t preferred,
+                      descriptor_parsed_t *out);
+
+/* Checksum of a parsed descriptor, computed on first use and kept in
+ * `parsed->checksum`. NULL if it cannot be computed. */
+KERN_WARN_UNUSED_RESULT const char *
+descriptor_parsed_checksum(descriptor_parsed_t *parsed);
+
+void descriptor_parsed_free(descriptor_parsed_t *parsed);
@@ -13,6 +13,7 @@
 #include <wally_descriptor.h>
 
 #include "descriptor_checksum.h"
+#include "descriptor_parse.h"
 #include "miniscript_policy.h"
 #include "psbt_internal.h"
 #include "registry.h"
@@ -35,11 +36,12 @@ typedef struct {
   validation_id_loc_cb id_loc_cb;
   void *user_data;
   descriptor_info_t info;
-  char descriptor_checksum[9];
+  /* Parsed once in validation_begin and kept until registration consumes it
+   * or the context is cleaned up; its checksum names the session entry. */
+  descriptor_parsed_t parsed;
   bool watch_only;                /* keyless: skip key/xpub stages */
-  wallet_network_t watch_network; /* network for the watch-only registry add */
   bool psb_warn; /* purpose/script-binding warning pending after the gates */
-  char psb_msg[160]; /* stashed PSB warning text (descriptor freed early) */
+  char psb_msg[160]; /* stashed PSB warning text */
 } validation_context_t;
 
 static validation_context_t *current_ctx = NULL;
@@ -60,41 +62,26 @@ static uint32_t pending_generation = 0;
  * core stays UI-free. Cleared at the start of each validate_and_load call. */
 static char last_duplicate_id[REGISTRY_ID_MAX_LEN];
 
-static uint32_t wallet_descriptor_network(void) {
-  return (wallet_get_network() == WALLET_NETWORK_MAINNET)
-             ? WALLY_NETWORK_BITCOIN_MAINNET
-             : WALLY_NETWORK_BITCOIN_TESTNET;
-}
-
-static uint32_t alternate_descriptor_network(uint32_t network) {
-  return (network == WALLY_NETWORK_BITCOIN_MAINNET)
-             ? WALLY_NETWORK_BITCOIN_TESTNET
-             : WALLY_NETWORK_BITCOIN_MAINNET;
-}
-
+/* Single parse on the network the descriptor's keys commit to. A descriptor
+ * whose keys belong to the other network is reported as a mismatch rather
+ * than a parse error. On success `out` holds the descriptor. */
 static descriptor_validation_result_t
-parse_descriptor_for_wallet(const char *descriptor_str,
-                            struct wally_descriptor **descriptor_out) {
-  if (!descriptor_str || !descriptor_out)
+parse_descriptor_for_network(const char *descriptor_str,
+                             wallet_network_t network,
+                             descriptor_parsed_t *out) {
+  if (!descriptor_str || !out)
     return VALIDATION_INTERNAL_ERROR;
 
-  *descriptor_out = NULL;
-  uint32_t wally_network = wallet_descriptor_network();
-  int ret = wallet_descriptor_parse(descriptor_str, NULL, wally_network,
-                                    descriptor_out);
-  if (ret == WALLY_OK)
-    return VALIDATION_SUCCESS;
-
-  struct wally_descriptor *other_desc = NULL;
-  if (wallet_descriptor_parse(descriptor_str, NULL,
-                              alternate_descriptor_network(wally_network),
-                              &other_desc) == WALLY_OK) {
-    wally_descriptor_free(other_desc);
+  int ret = descriptor_parse_once(descriptor_str, network, out);
+  if (ret != WALLY_OK) {
+    ESP_LOGE(TAG, "Failed to parse descriptor: %d", ret);
+    return VALIDATION_PARSE_ERROR;
+  }
+  if (out->network != network) {
+    descriptor_parsed_free(out);
     return VALIDATION_NETWORK_MISMATCH;
   }
-
-  ESP_LOGE(TAG, "Failed to parse descriptor: %d", ret);
-  return VALIDATION_PARSE_ERROR;
+  return VALIDATION_SUCCESS;
 }
 
 static bool ctx_callback_is_live(void) {
@@ -107,6 +94,7 @@ static void cleanup_context(void) {
     if (current_ctx->descriptor_str) {
       free(current_ctx->descriptor_str);
     }
+    descriptor_parsed_free(&current_ctx->parsed);
     free(current_ctx);
     current_ctx = NULL;
   }
@@ -390,6 +378,9 @@ static bool extract_descriptor_info(struct wally_descriptor *descriptor,
       snprintf(info->policy, sizeof(info->policy), "%s", policy);
       free(policy);
     }
+    /* Both validation paths computed it in checksum_and_dedup(). */
+    snprintf(info->checksum, sizeof(info->checksum), "%s",
+             current_ctx->parsed.checksum);
   }
   /* Unreachable for loadable descriptors: the script-size guard caps key
    * counts well below DESCRIPTOR_INFO_MAX_KEYS. Defensive bound for keys[]. */
@@ -453,7 +444,8 @@ static void id_loc_proceed(const char *id, storage_location_t loc,
     complete_validation(VALIDATION_USER_DECLINED);
     return;
   }
-  if (!registry_add_from_string(id, current_ctx->descriptor_str, loc, true)) {
+  if (!registry_add_parsed(id, current_ctx->descriptor_str,
+                           &current_ctx->parsed, loc, true)) {
     ESP_LOGE(TAG, "Failed to register descriptor '%s'", id);
     complete_validation(VALIDATION_INTERNAL_ERROR);
     return;
@@ -462,11 +454,11 @@ static void id_loc_proceed(const char *id, storage_location_t loc,
 }
 
 static bool build_session_descriptor_id(char out[REGISTRY_ID_MAX_LEN]) {
-  if (current_ctx->descriptor_checksum[0] == '\0')
+  if (current_ctx->parsed.checksum[0] == '\0')
     return false;
 
   char base[REGISTRY_ID_MAX_LEN];
-  snprintf(base, sizeof(base), "desc_%s", current_ctx->descriptor_checksum);
+  snprintf(base, sizeof(base), "desc_%s", current_ctx->parsed.checksum);
 
   for (size_t i = 0; i < REGISTRY_MAX_ENTRIES; i++) {
     if (i == 0)
@@ -505,11 +497,12 @@ static void session_register_current_descriptor(void) {
     return;
   }
 
-  bool added = current_ctx->watch_only
-                   ? registry_add_watch_only(id, current_ctx->descriptor_str,
-                                             current_ctx->watch_network)
-                   : registry_add_from_string(id, current_ctx->descriptor_str,
-                                              STORAGE_FLASH, false);
+  bool added =
+      current_ctx->watch_only
+          ? registry_add_watch_only_parsed(id, current_ctx->descriptor_str,
+                                           &current_ctx->parsed)
+          : registry_add_parsed(id, current_ctx->descriptor_str,
+                                &current_ctx->parsed, STORAGE_FLASH, false);
   if (!added) {
     ESP_LOGE(TAG, "Failed to load session descriptor '%s'", id);
     complete_validation(VALIDATION_INTERNAL_ERROR);
@@ -589,7 +582,6 @@ static void verify_xpub_and_show_info(struct wally_descriptor *descriptor,
                                       int key_index) {
   char *key_str = NULL;
   if (wally_descriptor_get_key(descriptor, key_index, &key_str) != WALLY_OK) {
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_INTERNAL_ERROR);
     return;
   }
@@ -598,7 +590,6 @@ static void verify_xpub_and_show_info(struct wally_descriptor *descriptor,
   wally_free_string(key_str);
 
   if (!descriptor_xpub) {
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_PARSE_ERROR);
     return;
   }
@@ -609,7 +600,6 @@ static void verify_xpub_and_show_info(struct wally_descriptor *descriptor,
                                                &origin_path_str) != WALLY_OK ||
       !origin_path_str) {
     free(descriptor_xpub);
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_INTERNAL_ERROR);
     return;
   }
@@ -619,7 +609,6 @@ static void verify_xpub_and_show_info(struct wally_descriptor *descriptor,
   char *wallet_xpub = NULL;
   if (!key_get_xpub(full_path, &wallet_xpub)) {
     free(descriptor_xpub);
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_INTERNAL_ERROR);
     return;
   }
@@ -630,15 +619,14 @@ static void verify_xpub_and_show_info(struct wally_descriptor *descriptor,
 
   if (!xpub_match) {
     ESP_LOGE(TAG, "XPub mismatch");
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_XPUB_MISMATCH);
     return;
   }
 
-  // Run soft purpose-script binding check before freeing the descriptor.
+  // Run soft purpose-script binding check.
   psb_result_t psb_result = purpose_script_binding_check_soft(descriptor);
 
-  // Build the WARN message while the descriptor is still available.
+  // Build the WARN message.
   char psb_msg[128] = {0};
   if (psb_result == PSB_WARN) {
     // Determine outer script name from canonical form.
@@ -680,10 +668,9 @@ static void verify_xpub_and_show_info(struct wally_descriptor *descriptor,
              purpose, script_name);
   }
 
-  // Extract descriptor info before freeing.
+  // Extract descriptor info for the confirmation dialog.
   extract_descriptor_info(descriptor, current_ctx->descriptor_str, key_index,
                           &current_ctx->info);
-  wally_descriptor_free(descriptor);
 
   // Stash the purpose-script binding warning to run after the keypath gate.
   current_ctx->psb_warn = (psb_result == PSB_WARN);
@@ -695,11 +682,14 @@ static void verify_xpub_and_show_info(struct wally_descriptor *descriptor,
 
 /* Shared prologue for both validate entry points: guards, context allocation,
  * descriptor copy, common callback wiring, parse, and the keyless static checks
- * (miniscript wrapper, script generatability). On success returns
- * VALIDATION_SUCCESS with *out set to the parsed descriptor (caller owns it);
- * on failure the result is already delivered and *out is NULL. */
+ * (miniscript wrapper, script generatability). `parsed` is a descriptor the
+ * caller already parsed (consumed whatever the outcome), or NULL to parse it
+ * here on `network`. On success returns VALIDATION_SUCCESS with the context
+ * owning the descriptor and *out pointing at it; on failure the result is
+ * already delivered and *out is NULL. */
 static descriptor_validation_result_t
-validation_begin(const char *descriptor_str, validation_complete_cb callback,
+validation_begin(const char *descriptor_str, descriptor_parsed_t *parsed,
+                 wallet_network_t network, validation_complete_cb callback,
                  validation_info_confirm_cb info_confirm_cb, void *user_data,
                  struct wally_descriptor **out) {
   *out = NULL;
@@ -707,18 +697,21 @@ validation_begin(const char *descriptor_str, validation_complete_cb callback,
   last_duplicate_id[0] = '\0';
 
   if (!descriptor_str || !callback) {
+    descriptor_parsed_free(parsed);
     if (callback)
       callback(VALIDATION_INTERNAL_ERROR, user_data);
     return VALIDATION_INTERNAL_ERROR;
   }
 
   if (descriptor_text_has_uppercase_hardened(descriptor_str)) {
+    descriptor_parsed_free(parsed);
     callback(VALIDATION_INVALID_HARDENED_NOTATION, user_data);
     return VALIDATION_INVALID_HARDENED_NOTATION;
   }
 
   current_ctx = malloc(sizeof(validation_context_t));
   if (!current_ctx) {
+    descriptor_parsed_free(parsed);
     callback(VALIDATION_INTERNAL_ERROR, user_data);
     return VALIDATION_INTERNAL_ERROR;
   }
@@ -726,6 +719,10 @@ validation_begin(const char *descriptor_str, validation_complete_cb callback,
   current_ctx->generation = next_generation++;
   if (next_generation == 0) /* avoid the 0 sentinel after wrap */
     next_generation = 1;
+  if (parsed) {
+    current_ctx->parsed = *parsed;
+    parsed->desc = NULL;
+  }
 
   current_ctx->descriptor_str = strdup(descriptor_str);
   if (!current_ctx->descriptor_str) {
@@ -738,29 +735,31 @@ validation_begin(const char *descriptor_str, validation_complete_cb callback,
   current_ctx->info_confirm_cb = info_confirm_cb;
   current_ctx->user_data = user_data;
 
-  struct wally_descriptor *descriptor = NULL;
-  descriptor_validation_result_t parse_result =
-      parse_descriptor_for_wallet(current_ctx->descriptor_str, &descriptor);
-  if (parse_result != VALIDATION_SUCCESS) {
-    complete_validation(parse_result);
-    return parse_result;
+  if (!current_ctx->parsed.desc) {
+    descriptor_validation_result_t parse_result = parse_descriptor_for_network(
+        current_ctx->descriptor_str, network, &current_ctx->parsed);
+    if (parse_result != VALIDATION_SUCCESS) {
+      complete_validation(parse_result);
+      return parse_result;
+    }
+  } else if (current_ctx->parsed.network != network) {
+    complete_validation(VALIDATION_NETWORK_MISMATCH);
+    return VALIDATION_NETWORK_MISMATCH;
   }
+  struct wally_descriptor *descriptor = current_ctx->parsed.desc;
 
   if (descriptor_is_miniscript(descriptor) &&
       !miniscript_wrapper_is_supported(descriptor)) {
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_UNSUPPORTED_MINISCRIPT);
     return VALIDATION_UNSUPPORTED_MINISCRIPT;
   }
 
   if (!descriptor_scripts_are_generatable(descriptor)) {
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_UNSUPPORTED_SCRIPT);
     return VALIDATION_UNSUPPORTED_SCRIPT;
   }
 
   if (tr_internal_keypath_unprovable(descriptor)) {
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_TR_INTERNAL_NOT_UNSPENDABLE);
     return VALIDATION_TR_INTERNAL_NOT_UNSPENDABLE;
   }
@@ -769,23 +768,21 @@ validation_begin(const char *descriptor_str, validation_complete_cb callback,
   return VALIDATION_SUCCESS;
 }
 
-/* Store the descriptor checksum, then reject duplicates already in the
+/* Compute the descriptor checksum, then reject duplicates already in the
  * in-memory session (h-normalized BIP-380 checksum match). Descriptor files on
  * flash/SD are explicit import sources, not registered descriptors, so dedup is
- * session-scoped. On failure frees `descriptor`, delivers the result, and
- * returns false; the caller must stop. */
-static bool checksum_and_dedup(struct wally_descriptor *descriptor) {
-  if (!descriptor_checksum_from_descriptor(descriptor,
-                                           current_ctx->descriptor_checksum)) {
-    wally_descriptor_free(descriptor);
+ * session-scoped. On failure delivers the result and returns false; the caller
+ * must stop. */
+static bool checksum_and_dedup(void) {
+  const char *checksum = descriptor_parsed_checksum(&current_ctx->parsed);
+  if (!checksum) {
     complete_validation(VALIDATION_INTERNAL_ERROR);
     return false;
   }
 
   char existing_id[REGISTRY_ID_MAX_LEN];
-  if (registry_session_has_duplicate_checksum(
-          current_ctx->descriptor_checksum, existing_id, sizeof(existing_id))) {
-    wally_descriptor_free(descriptor);
+  if (registry_session_has_duplicate_checksum(checksum, existing_id,
+                                              sizeof(existing_id))) {
     strncpy(last_duplicate_id, existing_id, sizeof(last_duplicate_id) - 1);
     last_duplicate_id[sizeof(last_duplicate_id) - 1] = '\0';
     complete_validation(VALIDATION_DUPLICATE);
@@ -808,7 +805,8 @@ void descriptor_validate_and_load(const char *descriptor_str,
   }
 
   struct wally_descriptor *descriptor = NULL;
-  if (validation_begin(descriptor_str, callback, info_confirm_cb, user_data,
+  if (validation_begin(descriptor_str, NULL, wallet_get_network(), callback,
+                       info_confirm_cb, user_data,
                        &descriptor) != VALIDATION_SUCCESS)
     return;
 
@@ -818,12 +816,11 @@ void descriptor_validate_and_load(const char *descriptor_str,
   int key_index = find_matching_key_index(descriptor);
   if (key_index < 0) {
     ESP_LOGE(TAG, "Wallet fingerprint not found in descriptor");
-    wally_descriptor_free(descriptor);
     complete_validation(VALIDATION_FINGERPRINT_NOT_FOUND);
     return;
   }
 
-  if (!checksum_and_dedup(descriptor))
+  if (!checksum_and_dedup())
     return;
 
   verify_xpub_and_show_info(descriptor, key_index);
@@ -834,7 +831,6 @@ void descriptor_validate_and_load(const char *descriptor_str,
 static void watch_only_show_info(struct wally_descriptor *descriptor) {
   extract_descriptor_info(descriptor, current_ctx->descriptor_str, -1,
                           &current_ctx->info);
-  wally_descriptor_free(descriptor);
 
   if (current_ctx->info_confirm_cb) {
     pending_generation = current_ctx->generation;
@@ -844,41 +840,26 @@ static void watch_only_show_info(struct wally_descriptor *descriptor) {
   }
 }
 
-bool descriptor_infer_network(const char *descriptor_str,
-                              wallet_network_t *network_out) {
-  if (!descriptor_str || !network_out)
-    return false;
-  struct wally_descriptor *desc = NULL;
-  if (wallet_descriptor_parse(descriptor_str, NULL,
-                              WALLY_NETWORK_BITCOIN_MAINNET,
-                              &desc) == WALLY_OK) {
-    wally_descriptor_free(desc);
-    *network_out = WALLET_NETWORK_MAINNET;
-    return true;
-  }
-  if (wallet_descriptor_parse(descriptor_str, NULL,
-                              WALLY_NETWORK_BITCOIN_TESTNET,
-                              &desc) == WALLY_OK) {
-    wally_descriptor_free(desc);
-    *network_out = WALLET_NETWORK_TESTNET;
-    return true;
-  }
-  return false;
-}
-
 void descriptor_validate_and_load_watch_only(
-    const char *descriptor_str, wallet_network_t network,
+    const char *descriptor_str, descriptor_parsed_t *parsed,
     validation_complete_cb callback, validation_info_confirm_cb info_confirm_cb,
     void *user_data) {
+  if (!parsed || !parsed->desc) {
+    if (callback)
+      callback(VALIDATION_INTERNAL_ERROR, user_data);
+    return;
+  }
+
+  wallet_network_t network = parsed->network;
   struct wally_descriptor *descriptor = NULL;
-  if (validation_begin(descriptor_str, callback, info_confirm_cb, user_data,
+  if (validation_begin(descriptor_str, parsed, network, callback,
+                       info_confirm_cb, user_data,
                        &descriptor) != VALIDATION_SUCCESS)
     return;
 
   current_ctx->watch_only = true;
-  current_ctx->watch_network = network;
 
-  if (!checksum_and_dedup(descriptor))
+  if (!checksum_and_dedup())
     return;
 
   watch_only_show_info(descriptor);
@@ -6,6 +6,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "descriptor_parse.h"
 #include "miniscript_policy.h"
 #include "storage.h"
 #include "wallet.h"
@@ -81,6 +82,8 @@ typedef struct {
   /* Miniscript only: descriptor with key expressions replaced by their
    * letter IDs (A, B, ...). Empty if unavailable. */
   char policy[512];
+  /* h-normalized BIP-380 checksum, the policy view's cache key. */
+  char checksum[9];
   /* tr() only: classification of the taproot internal (key-path) key. */
   tr_keypath_class_t tr_keypath;
 } descriptor_info_t;
@@ -113,24 +116,18 @@ void descriptor_validate_and_load(const char *descriptor_str,
                                   validation_id_loc_cb id_loc_cb,
                                   void *user_data);
 
-/* Infer a descriptor's network by trying to parse it as mainnet, then testnet.
- * Writes the network to *network_out and returns true on success; returns false
- * if the descriptor parses on neither (xpub keys parse only on mainnet, tpub
- * only on testnet, so the result is unambiguous for extended-key descriptors).
- */
-KERN_WARN_UNUSED_RESULT bool
-descriptor_infer_network(const char *descriptor_str,
-                         wallet_network_t *network_out);
-
 /* Watch-only (keyless) variant of descriptor_validate_and_load: validates and
  * loads a descriptor for address viewing without a loaded master key. Skips the
  * key precondition, fingerprint match, and xpub verification; otherwise reuses
- * the same parse/script checks, the same "Load?" info dialog (info_confirm_cb),
- * and session dedup. The caller must have set the watch-only network first (via
- * wallet_set_watch_only). On confirm the descriptor is registered watch-only.
+ * the same script checks, the same "Load?" info dialog (info_confirm_cb), and
+ * session dedup. `parsed` is the descriptor the caller parsed with
+ * descriptor_parse_once() to learn its network, and is consumed here so it is
+ * not parsed twice. The caller must have set the watch-only network first (via
+ * wallet_set_watch_only(parsed->network)). On confirm the descriptor is
+ * registered watch-only.
  */
 void descriptor_validate_and_load_watch_only(
-    const char *descriptor_str, wallet_network_t network,
+    const char *descriptor_str, descriptor_parsed_t *parsed,
     validation_complete_cb callback, validation_info_confirm_cb info_confirm_cb,
     void *user_data);
 
@@ -5,6 +5,7 @@
 #include <esp_ota_ops.h>
 #include <esp_secure_boot.h>
 #include <psa/crypto.h>
+#include <sd_card.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,16 +15,38 @@ static const char *TAG = "FW_UPDATE";
 #define READ_CHUNK 8192
 #define SIG_SECTOR_SIZE 4096
 
+/* Images are read sequentially (hash pass, OTA copy), so the next SD chunk is
+ * fetched on a worker while the current one is hashed or written to flash. */
+static esp_err_t open_image(const char *path, sd_card_stream_t **stream_out,
+                            size_t *size_out) {
+  const sd_card_stream_config_t config = {.read_ahead = true};
+  esp_err_t e =
+      sd_card_stream_open(path, SD_CARD_STREAM_READ, &config, stream_out);
+  if (e == ESP_OK)
+    e = sd_card_stream_size(*stream_out, size_out);
+  return e;
+}
+
+static bool read_exact(sd_card_stream_t *f, void *buf, size_t len) {
+  size_t n = 0;
+  return sd_card_stream_read_chunk(f, buf, len, &n) == ESP_OK && n == len;
+}
+
+static bool read_at(sd_card_stream_t *f, size_t offset, void *buf,
+                    size_t len) {
+  return sd_card_stream_seek(f, offset) == ESP_OK && read_exact(f, buf, len);
+}
+
 /* Walks the image structure and returns the offset of the appended
  * signature sector, or 0 if the layout is inconsistent with a signed
  * image of file_size bytes. */
-static size_t signature_offset(FILE *f, const esp_image_header_t *hdr,
+static size_t signature_offset(sd_card_stream_t *f,
+                               const esp_image_header_t *hdr,
                                size_t file_size) {
   size_t pos = sizeof(esp_image_header_t);
   for (int i = 0; i < hdr->segment_count; i++) {
     esp_image_segment_header_t seg;
-    if (fseek(f, pos, SEEK_SET) != 0 ||
-        fread(&seg, 1, sizeof(seg), f) != sizeof(seg))
+    if (!read_at(f, pos, &seg, sizeof(seg)))
       return 0;
     pos += sizeof(seg) + seg.data_len;
     if (pos > file_size)
@@ -39,7 +62,8 @@ static size_t signature_offset(FILE *f, const esp_image_header_t *hdr,
   return sig_offset;
 }
 
-static int sha256_file_range(FILE *f, size_t len, uint8_t digest[32],
+static int sha256_file_range(sd_card_stream_t *f, size_t len,
+                             uint8_t digest[32],
                              fw_update_progress_cb_t progress_cb,
                              void *user_data) {
   if (psa_crypto_init() != PSA_SUCCESS)
@@ -53,12 +77,12 @@ static int sha256_file_range(FILE *f, size_t len, uint8_t digest[32],
     return -1;
   }
   int ret = -1;
-  if (fseek(f, 0, SEEK_SET) != 0)
+  if (sd_card_stream_seek(f, 0) != ESP_OK)
     goto out;
   size_t done = 0;
   while (done < len) {
     size_t want = len - done < READ_CHUNK ? len - done : READ_CHUNK;
-    if (fread(buf, 1, want, f) != want)
+    if (!read_exact(f, buf, want))
       goto out;
     if (psa_hash_update(&op, buf, want) != PSA_SUCCESS)
       goto out;
@@ -83,23 +107,20 @@ int fw_update_validate(const char *path, fw_update_info_t *info,
   int ret = -1;
   uint8_t *sig = NULL;
 
-  FILE *f = fopen(path, "rb");
-  if (!f) {
+  sd_card_stream_t *f = NULL;
+  size_t fsize = 0;
+  if (open_image(path, &f, &fsize) != ESP_OK) {
+    sd_card_stream_close(f);
     *err_out = "Cannot open file";
     return -1;
   }
 
-  if (fseek(f, 0, SEEK_END) != 0)
-    goto out;
-  long fsize = ftell(f);
-  if (fsize <
-      (long)(sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) +
-             sizeof(esp_app_desc_t) + SIG_SECTOR_SIZE))
+  if (fsize < sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) +
+                  sizeof(esp_app_desc_t) + SIG_SECTOR_SIZE)
     goto out;
 
   esp_image_header_t hdr;
-  if (fseek(f, 0, SEEK_SET) != 0 ||
-      fread(&hdr, 1, sizeof(hdr), f) != sizeof(hdr))
+  if (!read_at(f, 0, &hdr, sizeof(hdr)))
     goto out;
   if (hdr.magic != ESP_IMAGE_HEADER_MAGIC)
     goto out;
@@ -109,9 +130,9 @@ int fw_update_validate(const char *path, fw_update_info_t *info,
   }
 
   esp_app_desc_t desc;
-  if (fseek(f, sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t),
-            SEEK_SET) != 0 ||
-      fread(&desc, 1, sizeof(desc), f) != sizeof(desc))
+  if (!read_at(f,
+               sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t),
+               &desc, sizeof(desc)))
     goto out;
   if (desc.magic_word != ESP_APP_DESC_MAGIC_WORD)
     goto out;
@@ -127,7 +148,7 @@ int fw_update_validate(const char *path, fw_update_info_t *info,
     goto out;
   }
 
-  size_t sig_offset = signature_offset(f, &hdr, (size_t)fsize);
+  size_t sig_offset = signature_offset(f, &hdr, fsize);
   if (sig_offset == 0) {
     err = "Image is not signed";
     goto out;
@@ -154,8 +175,7 @@ int fw_update_validate(const char *path, fw_update_info_t *info,
     err = "Out of memory";
     goto out;
   }
-  if (fseek(f, sig_offset, SEEK_SET) != 0 ||
-      fread(sig, 1, SIG_SECTOR_SIZE, f) != SIG_SECTOR_SIZE)
+  if (!read_at(f, sig_offset, sig, SIG_SECTOR_SIZE))
     goto out;
 
   uint8_t verified_digest[32];
@@ -177,13 +197,13 @@ int fw_update_validate(const char *path, fw_update_info_t *info,
     strlcpy(info->current_version, running->version,
             sizeof(info->current_version));
     info->secure_version = desc.secure_version;
-    info->image_size = (size_t)fsize;
+    info->image_size = fsize;
   }
   ret = 0;
 
 out:
   free(sig);
-  fclose(f);
+  sd_card_stream_close(f);
   if (ret != 0)
     *err_out = err;
   return ret;
@@ -197,16 +217,15 @@ int fw_update_apply(const char *path, fw_update_progress_cb_t progress_cb,
   esp_ota_handle_t ota = 0;
   bool ota_started = false;
 
-  FILE *f = fopen(path, "rb");
-  if (!f) {
+  sd_card_stream_t *f = NULL;
+  size_t fsize = 0;
+  if (open_image(path, &f, &fsize) != ESP_OK) {
+    sd_card_stream_close(f);
     *err_out = "Cannot open file";
     return -1;
   }
 
-  if (fseek(f, 0, SEEK_END) != 0)
-    goto out;
-  long fsize = ftell(f);
-  if (fsize <= 0 || fseek(f, 0, SEEK_SET) != 0)
+  if (fsize == 0)
     goto out;
 
   const esp_partition_t *next = esp_ota_get_next_update_partition(NULL);
@@ -214,7 +233,7 @@ int fw_update_apply(const char *path, fw_update_progress_cb_t progress_cb,
     err = "No OTA partition available";
     goto out;
   }
-  if ((size_t)fsize > next->size) {
+  if (fsize > next->size) {
     err = "Image too large for OTA partition";
     goto out;
   }
@@ -233,10 +252,9 @@ int fw_update_apply(const char *path, fw_update_progress_cb_t progress_cb,
   }
 
   size_t done = 0;
-  while (done < (size_t)fsize) {
-    size_t want =
-        (size_t)fsize - done < READ_CHUNK ? (size_t)fsize - done : READ_CHUNK;
-    if (fread(buf, 1, want, f) != want) {
+  while (done < fsize) {
+    size_t want = fsize - done < READ_CHUNK ? fsize - done : READ_CHUNK;
+    if (!read_exact(f, buf, want)) {
       err = "SD card read failed";
       goto out;
     }
@@ -248,7 +266,7 @@ int fw_update_apply(const char *path, fw_update_progress_cb_t progress_cb,
     }
     done += want;
     if (progress_cb)
-      progress_cb((int)(done * 100 / (size_t)fsize), user_data);
+      progress_cb((int)(done * 100 / fsize), user_data);
   }
 
   e = esp_ota_end(ota);
@@ -272,7 +290,7 @@ out:
   if (ota_started)
     esp_ota_abort(ota);
   free(buf);
-  fclose(f);
+  sd_card_stream_close(f);
   if (ret != 0)
     *err_out = err;
   return ret;
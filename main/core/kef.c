@@ -107,6 +107,39 @@ static int compute_hidden_auth(const uint8_t *data, size_t data_len,
   return rc;
 }
 
+/* Multi-part hash of a || b, for a prefix several candidates share. */
+static int hash_start(crypto_sha256_ctx_t **ctx_out, const uint8_t *a,
+                      size_t a_len, const uint8_t *b, size_t b_len) {
+  int rc = crypto_sha256_start(ctx_out);
+  if (rc == CRYPTO_OK)
+    rc = crypto_sha256_update(*ctx_out, a, a_len);
+  if (rc == CRYPTO_OK)
+    rc = crypto_sha256_update(*ctx_out, b, b_len);
+  if (rc != CRYPTO_OK) {
+    crypto_sha256_abort(*ctx_out);
+    *ctx_out = NULL;
+  }
+  return rc;
+}
+
+/* SHA256(prefix || a || b), leaving prefix as it was. */
+static int hash_clone_finish(const crypto_sha256_ctx_t *prefix,
+                             const uint8_t *a, size_t a_len, const uint8_t *b,
+                             size_t b_len, uint8_t hash[CRYPTO_SHA256_SIZE]) {
+  crypto_sha256_ctx_t *ctx;
+  int rc = crypto_sha256_clone(prefix, &ctx);
+  if (rc != CRYPTO_OK)
+    return rc;
+  rc = crypto_sha256_update(ctx, a, a_len);
+  if (rc == CRYPTO_OK)
+    rc = crypto_sha256_update(ctx, b, b_len);
+  if (rc != CRYPTO_OK) {
+    crypto_sha256_abort(ctx);
+    return rc;
+  }
+  return crypto_sha256_finish(ctx, hash);
+}
+
 /* SHA256(version || iv || data || key) truncated to auth_size bytes. */
 static kef_error_t compute_exposed_auth(uint8_t version, const uint8_t *iv,
                                         size_t iv_size, const uint8_t *data,
@@ -145,17 +178,51 @@ static kef_error_t compute_exposed_auth(uint8_t version, const uint8_t *iv,
 /*  Safety checks                                                      */
 /* ------------------------------------------------------------------ */
 
-/* True if any two 16-byte blocks in data are identical (ECB weakness). */
-static bool has_duplicate_blocks(const uint8_t *data, size_t len) {
+static uint32_t block_hash(const uint8_t *block) {
+  uint64_t a, b;
+  memcpy(&a, block, sizeof(a));
+  memcpy(&b, block + sizeof(a), sizeof(b));
+  uint64_t h = (a ^ (b * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+  return (uint32_t)(h >> 32);
+}
+
+/*
+ * KEF_ERR_DUPLICATE_BLOCKS if any two 16-byte blocks in data are identical
+ * (ECB weakness). One pass over an open-addressed table of block indices,
+ * sized to stay at most half full.
+ */
+static kef_error_t check_duplicate_blocks(const uint8_t *data, size_t len) {
   size_t nblocks = len / CRYPTO_AES_BLOCK_SIZE;
-  for (size_t i = 0; i < nblocks; i++) {
-    for (size_t j = i + 1; j < nblocks; j++) {
-      if (memcmp(data + i * CRYPTO_AES_BLOCK_SIZE,
-                 data + j * CRYPTO_AES_BLOCK_SIZE, CRYPTO_AES_BLOCK_SIZE) == 0)
-        return true;
+  if (nblocks < 2)
+    return KEF_OK;
+  if (nblocks > UINT32_MAX / 4)
+    return KEF_ERR_INVALID_ARG;
+
+  size_t slots = 4;
+  while (slots < nblocks * 2)
+    slots <<= 1;
+  /* Index + 1 per slot, 0 = empty. */
+  uint32_t *table = calloc(slots, sizeof(*table));
+  if (!table)
+    return KEF_ERR_ALLOC;
+
+  kef_error_t err = KEF_OK;
+  for (size_t i = 0; i < nblocks && err == KEF_OK; i++) {
+    const uint8_t *block = data + i * CRYPTO_AES_BLOCK_SIZE;
+    size_t at = block_hash(block) & (slots - 1);
+    while (table[at]) {
+      const uint8_t *other = data + (table[at] - 1) * CRYPTO_AES_BLOCK_SIZE;
+      if (memcmp(block, other, CRYPTO_AES_BLOCK_SIZE) == 0) {
+        err = KEF_ERR_DUPLICATE_BLOCKS;
+        break;
+      }
+      at = (at + 1) & (slots - 1);
     }
+    table[at] = (uint32_t)(i + 1);
   }
-  return false;
+  secure_memzero(table, slots * sizeof(*table));
+  free(table);
+  return err;
 }
 
 /* ------------------------------------------------------------------ */
@@ -177,16 +244,18 @@ static int cipher_encrypt(const kef_version_info_t *vi, const uint8_t *key,
   }
 }
 
-static int cipher_decrypt(const kef_version_info_t *vi, const uint8_t *key,
+/* Decryption takes the key already imported, so envelopes sharing one
+ * (same id and iterations) do not import it again. */
+static int cipher_decrypt(const kef_version_info_t *vi, crypto_aes_key_t *key,
                           const uint8_t *iv, const uint8_t *in, size_t in_len,
                           uint8_t *out) {
   switch (vi->mode) {
   case MODE_ECB:
-    return crypto_aes_ecb_decrypt(key, in, in_len, out);
+    return crypto_aes_key_ecb(key, false, in, in_len, out);
   case MODE_CBC:
-    return crypto_aes_cbc_decrypt(key, iv, in, in_len, out);
+    return crypto_aes_key_cbc(key, false, iv, in, in_len, out);
   case MODE_CTR:
-    return crypto_aes_ctr(key, iv, in, in_len, out);
+    return crypto_aes_key_ctr(key, iv, in, in_len, out);
   default:
     return CRYPTO_ERR_INVALID_ARG;
   }
@@ -269,6 +338,14 @@ static kef_error_t nul_unpad_verify_hidden(const uint8_t *dec, size_t dec_len,
   while (stripped > 0 && dec[stripped - 1] == 0)
     stripped--;
 
+  /* Every candidate hashes dec up to its own length; what they all share is
+   * hashed once and cloned for each. */
+  size_t base = stripped > auth_size ? stripped - auth_size : 0;
+  crypto_sha256_ctx_t *prefix;
+  if (hash_start(&prefix, dec, base, NULL, 0) != CRYPTO_OK)
+    return KEF_ERR_CRYPTO;
+
+  kef_error_t err = KEF_ERR_AUTH;
   for (size_t nuls = 0; nuls <= auth_size; nuls++) {
     size_t candidate = stripped + nuls;
     if (candidate < auth_size)
@@ -278,18 +355,22 @@ static kef_error_t nul_unpad_verify_hidden(const uint8_t *dec, size_t dec_len,
 
     size_t dlen = candidate - auth_size;
     uint8_t hash[CRYPTO_SHA256_SIZE];
-    if (crypto_sha256(dec, dlen, hash) != CRYPTO_OK) {
+    if (hash_clone_finish(prefix, dec + base, dlen - base, NULL, 0, hash) !=
+        CRYPTO_OK) {
       secure_memzero(hash, sizeof(hash));
-      return KEF_ERR_CRYPTO;
+      err = KEF_ERR_CRYPTO;
+      break;
     }
-    if (secure_memcmp(hash, dec + dlen, auth_size) == 0) {
-      secure_memzero(hash, sizeof(hash));
+    bool match = secure_memcmp(hash, dec + dlen, auth_size) == 0;
+    secure_memzero(hash, sizeof(hash));
+    if (match) {
       *data_len_out = dlen;
-      return KEF_OK;
+      err = KEF_OK;
+      break;
     }
-    secure_memzero(hash, sizeof(hash));
   }
-  return KEF_ERR_AUTH;
+  crypto_sha256_abort(prefix);
+  return err;
 }
 
 /*
@@ -306,26 +387,39 @@ static kef_error_t nul_unpad_verify_exposed(const uint8_t *dec, size_t dec_len,
   while (stripped > 0 && dec[stripped - 1] == 0)
     stripped--;
 
+  /* compute_exposed_auth for each candidate, with version || iv || the
+   * stripped data hashed once and cloned. */
+  crypto_sha256_ctx_t *prefix;
+  if (hash_start(&prefix, &version, 1, iv, iv_size) != CRYPTO_OK)
+    return KEF_ERR_CRYPTO;
+  if (crypto_sha256_update(prefix, dec, stripped) != CRYPTO_OK) {
+    crypto_sha256_abort(prefix);
+    return KEF_ERR_CRYPTO;
+  }
+
+  kef_error_t err = KEF_ERR_AUTH;
   for (size_t nuls = 0; nuls <= auth_size; nuls++) {
     size_t candidate = stripped + nuls;
     if (candidate > dec_len)
       break;
 
     uint8_t auth[CRYPTO_SHA256_SIZE];
-    kef_error_t err = compute_exposed_auth(version, iv, iv_size, dec, candidate,
-                                           key, auth, auth_size);
-    if (err != KEF_OK) {
+    if (hash_clone_finish(prefix, dec + stripped, nuls, key,
+                          CRYPTO_AES_KEY_SIZE, auth) != CRYPTO_OK) {
       secure_memzero(auth, sizeof(auth));
-      return err;
+      err = KEF_ERR_CRYPTO;
+      break;
     }
-    if (secure_memcmp(auth, expected_auth, auth_size) == 0) {
-      secure_memzero(auth, sizeof(auth));
+    bool match = secure_memcmp(auth, expected_auth, auth_size) == 0;
+    secure_memzero(auth, sizeof(auth));
+    if (match) {
       *data_len_out = candidate;
-      return KEF_OK;
+      err = KEF_OK;
+      break;
     }
-    secure_memzero(auth, sizeof(auth));
   }
-  return KEF_ERR_AUTH;
+  crypto_sha256_abort(prefix);
+  return err;
 }
 
 /* ------------------------------------------------------------------ */
@@ -358,6 +452,20 @@ kef_error_t kef_parse_header(const uint8_t *envelope, size_t env_len,
   return KEF_OK;
 }
 
+kef_error_t kef_derive_key(const uint8_t *id, size_t id_len,
+                           const uint8_t *password, size_t pw_len,
+                           uint32_t iterations, uint8_t key_out[32]) {
+  if (!id || id_len == 0 || !password || pw_len == 0 || iterations == 0 ||
+      !key_out)
+    return KEF_ERR_INVALID_ARG;
+  if (crypto_pbkdf2_sha256(password, pw_len, id, id_len, iterations, key_out,
+                           CRYPTO_AES_KEY_SIZE) != CRYPTO_OK) {
+    secure_memzero(key_out, CRYPTO_AES_KEY_SIZE);
+    return KEF_ERR_CRYPTO;
+  }
+  return KEF_OK;
+}
+
 /* ------------------------------------------------------------------ */
 /*  Encrypt                                                            */
 /* ------------------------------------------------------------------ */
@@ -390,12 +498,9 @@ kef_error_t kef_encrypt(const uint8_t *id, size_t id_len, uint8_t version,
     return KEF_ERR_UNSUPPORTED_VERSION;
 
   /* --- Derive key ------------------------------------------------ */
-  rc = crypto_pbkdf2_sha256(password, pw_len, id, id_len, iterations, key,
-                            CRYPTO_AES_KEY_SIZE);
-  if (rc != CRYPTO_OK) {
-    err = KEF_ERR_CRYPTO;
+  err = kef_derive_key(id, id_len, password, pw_len, iterations, key);
+  if (err != KEF_OK)
     goto cleanup;
-  }
 
   /* --- Generate IV ----------------------------------------------- */
   memset(iv, 0, sizeof(iv));
@@ -454,9 +559,10 @@ kef_error_t kef_encrypt(const uint8_t *id, size_t id_len, uint8_t version,
     goto cleanup;
 
   /* --- ECB duplicate-block check --------------------------------- */
-  if (vi->mode == MODE_ECB && has_duplicate_blocks(padded, padded_len)) {
-    err = KEF_ERR_DUPLICATE_BLOCKS;
-    goto cleanup;
+  if (vi->mode == MODE_ECB) {
+    err = check_duplicate_blocks(padded, padded_len);
+    if (err != KEF_OK)
+      goto cleanup;
   }
 
   /* --- Allocate envelope ----------------------------------------- */
@@ -548,84 +654,86 @@ cleanup:
 /*  Decrypt                                                            */
 /* ------------------------------------------------------------------ */
 
-kef_error_t kef_decrypt(const uint8_t *envelope, size_t env_len,
-                        const uint8_t *password, size_t pw_len, uint8_t **out,
-                        size_t *out_len) {
-  kef_error_t err = KEF_ERR_CRYPTO;
-  uint8_t key[CRYPTO_AES_KEY_SIZE];
-  uint8_t *decrypted = NULL;
-  size_t cipher_len = 0;
-  int rc;
-
-  /* --- Validate -------------------------------------------------- */
-  if (!envelope || env_len == 0 || !password || pw_len == 0 || !out || !out_len)
-    return KEF_ERR_INVALID_ARG;
-
-  /* --- Parse header ---------------------------------------------- */
+/* Where the parts of a well-formed envelope are. Pointers into it. */
+typedef struct {
+  const kef_version_info_t *vi;
+  uint8_t version;
   const uint8_t *id;
   size_t id_len;
-  uint8_t version;
   uint32_t iterations;
-  err =
-      kef_parse_header(envelope, env_len, &id, &id_len, &version, &iterations);
+  const uint8_t *iv;
+  const uint8_t *ciphertext;
+  size_t cipher_len;
+  const uint8_t *exposed_auth;
+} kef_layout_t;
+
+/* Everything that can be checked without the key, so a malformed envelope
+ * fails before paying for PBKDF2. */
+static kef_error_t parse_layout(const uint8_t *envelope, size_t env_len,
+                                kef_layout_t *l) {
+  kef_error_t err = kef_parse_header(envelope, env_len, &l->id, &l->id_len,
+                                     &l->version, &l->iterations);
   if (err != KEF_OK)
     return err;
 
-  const kef_version_info_t *vi = find_version(version);
+  const kef_version_info_t *vi = find_version(l->version);
   if (!vi)
     return KEF_ERR_UNSUPPORTED_VERSION;
+  l->vi = vi;
 
   /* --- Locate payload parts -------------------------------------- */
-  size_t header_size = 1 + id_len + 1 + 3;
+  size_t header_size = 1 + l->id_len + 1 + 3;
   size_t iv_start = header_size;
 
   if (iv_start + vi->iv_size > env_len)
     return KEF_ERR_ENVELOPE_TOO_SHORT;
 
-  const uint8_t *iv = (vi->iv_size > 0) ? envelope + iv_start : NULL;
+  l->iv = (vi->iv_size > 0) ? envelope + iv_start : NULL;
   size_t data_start = iv_start + vi->iv_size;
   size_t data_end = env_len;
 
   /* Extract exposed auth from end of envelope */
-  const uint8_t *exposed_auth = NULL;
+  l->exposed_auth = NULL;
   bool has_exposed =
       (vi->auth_type == AUTH_EXPOSED || vi->auth_type == AUTH_GCM);
   if (has_exposed) {
     if (data_end < data_start + vi->auth_size)
       return KEF_ERR_ENVELOPE_TOO_SHORT;
     data_end -= vi->auth_size;
-    exposed_auth = envelope + data_end;
+    l->exposed_auth = envelope + data_end;
   }
 
-  const uint8_t *ciphertext = envelope + data_start;
-  cipher_len = data_end - data_start;
+  l->ciphertext = envelope + data_start;
+  l->cipher_len = data_end - data_start;
 
-  if (cipher_len == 0)
+  if (l->cipher_len == 0)
     return KEF_ERR_ENVELOPE_TOO_SHORT;
 
   /* Block ciphers need aligned input */
   if ((vi->mode == MODE_ECB || vi->mode == MODE_CBC) &&
-      cipher_len % CRYPTO_AES_BLOCK_SIZE != 0)
+      l->cipher_len % CRYPTO_AES_BLOCK_SIZE != 0)
     return KEF_ERR_ENVELOPE_TOO_SHORT;
 
-  /* --- Derive key ------------------------------------------------ */
-  rc = crypto_pbkdf2_sha256(password, pw_len, id, id_len, iterations, key,
-                            CRYPTO_AES_KEY_SIZE);
-  if (rc != CRYPTO_OK) {
-    err = KEF_ERR_CRYPTO;
-    goto cleanup;
-  }
+  return KEF_OK;
+}
+
+static kef_error_t decrypt_layout(const kef_layout_t *l, const uint8_t *key,
+                                  crypto_aes_key_t *aes, uint8_t **out,
+                                  size_t *out_len) {
+  const kef_version_info_t *vi = l->vi;
+  size_t cipher_len = l->cipher_len;
+  kef_error_t err;
+  int rc;
 
   /* --- Decrypt --------------------------------------------------- */
-  decrypted = malloc(cipher_len);
-  if (!decrypted) {
-    err = KEF_ERR_ALLOC;
-    goto cleanup;
-  }
+  uint8_t *decrypted = malloc(cipher_len);
+  if (!decrypted)
+    return KEF_ERR_ALLOC;
 
   if (vi->mode == MODE_GCM) {
-    rc = crypto_aes_gcm_decrypt(key, iv, vi->iv_size, ciphertext, cipher_len,
-                                decrypted, exposed_auth, vi->auth_size);
+    rc = crypto_aes_key_gcm_decrypt(aes, l->iv, vi->iv_size, l->ciphertext,
+                                    cipher_len, decrypted, l->exposed_auth,
+                                    vi->auth_size);
     if (rc == CRYPTO_ERR_AUTH_FAILED) {
       err = KEF_ERR_AUTH;
       goto cleanup;
@@ -635,7 +743,7 @@ kef_error_t kef_decrypt(const uint8_t *envelope, size_t env_len,
       goto cleanup;
     }
   } else {
-    rc = cipher_decrypt(vi, key, iv, ciphertext, cipher_len, decrypted);
+    rc = cipher_decrypt(vi, aes, l->iv, l->ciphertext, cipher_len, decrypted);
     if (rc != CRYPTO_OK) {
       err = KEF_ERR_CRYPTO;
       goto cleanup;
@@ -654,8 +762,8 @@ kef_error_t kef_decrypt(const uint8_t *envelope, size_t env_len,
       err = nul_unpad_verify_hidden(decrypted, cipher_len, vi->auth_size,
                                     &plain_len);
     } else {
-      err = nul_unpad_verify_exposed(decrypted, cipher_len, version, iv,
-                                     vi->iv_size, key, exposed_auth,
+      err = nul_unpad_verify_exposed(decrypted, cipher_len, l->version, l->iv,
+                                     vi->iv_size, key, l->exposed_auth,
                                      vi->auth_size, &plain_len);
     }
     if (err != KEF_OK)
@@ -732,14 +840,431 @@ kef_error_t kef_decrypt(const uint8_t *envelope, size_t env_len,
   err = KEF_OK;
 
 cleanup:
+  secure_memzero(decrypted, cipher_len);
+  free(decrypted);
+  return err;
+}
+
+kef_error_t kef_decrypt(const uint8_t *envelope, size_t env_len,
+                        const uint8_t *password, size_t pw_len, uint8_t **out,
+                        size_t *out_len) {
+  uint8_t key[CRYPTO_AES_KEY_SIZE];
+  kef_layout_t layout;
+
+  if (!envelope || env_len == 0 || !password || pw_len == 0 || !out || !out_len)
+    return KEF_ERR_INVALID_ARG;
+
+  kef_error_t err = parse_layout(envelope, env_len, &layout);
+  if (err != KEF_OK)
+    return err;
+
+  err = kef_derive_key(layout.id, layout.id_len, password, pw_len,
+                       layout.iterations, key);
+  if (err == KEF_OK)
+    err = kef_decrypt_with_key(envelope, env_len, key, out, out_len);
   secure_memzero(key, sizeof(key));
-  if (decrypted) {
-    secure_memzero(decrypted, cipher_len);
-    free(decrypted);
+  return err;
+}
+
+struct kef_key {
+  uint8_t raw[CRYPTO_AES_KEY_SIZE]; /* exposed auth hashes the key itself */
+  crypto_aes_key_t *aes;
+};
+
+kef_error_t kef_key_create(const uint8_t key[32], kef_key_t **key_out) {
+  if (!key || !key_out)
+    return KEF_ERR_INVALID_ARG;
+  *key_out = NULL;
+
+  kef_key_t *k = calloc(1, sizeof(*k));
+  if (!k)
+    return KEF_ERR_ALLOC;
+  memcpy(k->raw, key, sizeof(k->raw));
+  if (crypto_aes_key_create(key, &k->aes) != CRYPTO_OK) {
+    kef_key_destroy(k);
+    return KEF_ERR_CRYPTO;
+  }
+  *key_out = k;
+  return KEF_OK;
+}
+
+void kef_key_destroy(kef_key_t *key) {
+  if (!key)
+    return;
+  crypto_aes_key_destroy(key->aes);
+  secure_memzero(key, sizeof(*key));
+  free(key);
+}
+
+kef_error_t kef_key_decrypt(const kef_key_t *key, const uint8_t *envelope,
+                            size_t env_len, uint8_t **out, size_t *out_len) {
+  kef_layout_t layout;
+
+  if (!key || !envelope || env_len == 0 || !out || !out_len)
+    return KEF_ERR_INVALID_ARG;
+
+  kef_error_t err = parse_layout(envelope, env_len, &layout);
+  if (err != KEF_OK)
+    return err;
+  return decrypt_layout(&layout, key->raw, key->aes, out, out_len);
+}
+
+kef_error_t kef_decrypt_with_key(const uint8_t *envelope, size_t env_len,
+                                 const uint8_t key[32], uint8_t **out,
+                                 size_t *out_len) {
+  if (!envelope || env_len == 0 || !key || !out || !out_len)
+    return KEF_ERR_INVALID_ARG;
+
+  kef_key_t *k;
+  kef_error_t err = kef_key_create(key, &k);
+  if (err != KEF_OK)
+    return err;
+  err = kef_key_decrypt(k, envelope, env_len, out, out_len);
+  kef_key_destroy(k);
+  return err;
+}
+
+kef_error_t kef_check_envelope(const uint8_t *envelope, size_t env_len) {
+  kef_layout_t layout;
+
+  if (!envelope || env_len == 0)
+    return KEF_ERR_INVALID_ARG;
+  return parse_layout(envelope, env_len, &layout);
+}
+
+/* ------------------------------------------------------------------ */
+/*  Streaming                                                          */
+/* ------------------------------------------------------------------ */
+
+/* Largest header + IV the decrypt side buffers before the ciphertext. */
+#define KEF_MAX_HEADER (1 + KEF_MAX_ID_LEN + 1 + 3 + CRYPTO_AES_IV_SIZE)
+
+struct kef_stream {
+  const kef_version_info_t *vi;
+  bool encrypt;
+  kef_sink_t sink;
+  void *sink_ctx;
+  crypto_aes_stream_t *cipher;
+  crypto_sha256_ctx_t *sha; /* CTR: hidden auth over the plaintext */
+  size_t in_len;            /* plaintext / ciphertext bytes fed to cipher */
+  size_t out_len;           /* bytes the cipher has given back */
+  /* Decrypt only: key until the header is in, then the envelope's tail. */
+  uint8_t key[CRYPTO_AES_KEY_SIZE];
+  uint8_t header[KEF_MAX_HEADER];
+  size_t header_len;
+  uint8_t tail[CRYPTO_AES_BLOCK_SIZE];
+  size_t tail_len;
+  uint8_t buf[CRYPTO_AES_STREAM_OUT_SIZE(KEF_STREAM_CHUNK)];
+};
+
+bool kef_stream_supported(uint8_t version) {
+  const kef_version_info_t *vi = find_version(version);
+  return vi && !vi->compress &&
+         (vi->mode == MODE_CTR || vi->mode == MODE_GCM);
+}
+
+static kef_error_t stream_start_cipher(kef_stream_t *s, const uint8_t *key,
+                                       const uint8_t *iv) {
+  int rc = s->vi->mode == MODE_GCM
+               ? crypto_aes_gcm_start(key, s->encrypt, iv, s->vi->iv_size,
+                                      s->vi->auth_size, &s->cipher)
+               : crypto_aes_ctr_start(key, iv, &s->cipher);
+  if (rc != CRYPTO_OK)
+    return KEF_ERR_CRYPTO;
+  if (s->vi->mode == MODE_CTR && crypto_sha256_start(&s->sha) != CRYPTO_OK)
+    return KEF_ERR_CRYPTO;
+  return KEF_OK;
+}
+
+static kef_error_t stream_emit(kef_stream_t *s, const uint8_t *data,
+                               size_t len) {
+  if (len == 0)
+    return KEF_OK;
+  return s->sink(s->sink_ctx, data, len) ? KEF_OK : KEF_ERR_SINK;
+}
+
+/* Cipher output: the plaintext side of it feeds the CTR hidden auth. */
+static kef_error_t stream_output(kef_stream_t *s, const uint8_t *data,
+                                 size_t len) {
+  s->out_len += len;
+  if (s->sha && !s->encrypt &&
+      crypto_sha256_update(s->sha, data, len) != CRYPTO_OK)
+    return KEF_ERR_CRYPTO;
+  return stream_emit(s, data, len);
+}
+
+/* Runs len bytes through the cipher, a chunk at a time. */
+static kef_error_t stream_cipher(kef_stream_t *s, const uint8_t *data,
+                                 size_t len) {
+  while (len > 0) {
+    size_t n = len < KEF_STREAM_CHUNK ? len : KEF_STREAM_CHUNK;
+    if (s->sha && s->encrypt &&
+        crypto_sha256_update(s->sha, data, n) != CRYPTO_OK)
+      return KEF_ERR_CRYPTO;
+    size_t produced;
+    if (crypto_aes_stream_update(s->cipher, data, n, s->buf, sizeof(s->buf),
+                                 &produced) != CRYPTO_OK)
+      return KEF_ERR_CRYPTO;
+    s->in_len += n;
+    kef_error_t err = stream_output(s, s->buf, produced);
+    if (err != KEF_OK)
+      return err;
+    data += n;
+    len -= n;
+  }
+  return KEF_OK;
+}
+
+kef_error_t kef_stream_encrypt_init(const uint8_t key[32], const uint8_t *id,
+                                    size_t id_len, uint8_t version,
+                                    uint32_t iterations, kef_sink_t sink,
+                                    void *sink_ctx,
+                                    kef_stream_t **stream_out) {
+  if (!key || !id || id_len == 0 || id_len > KEF_MAX_ID_LEN ||
+      iterations == 0 || !sink || !stream_out)
+    return KEF_ERR_INVALID_ARG;
+  *stream_out = NULL;
+  if (!kef_stream_supported(version))
+    return KEF_ERR_UNSUPPORTED_VERSION;
+
+  kef_stream_t *s = calloc(1, sizeof(*s));
+  if (!s)
+    return KEF_ERR_ALLOC;
+  s->vi = find_version(version);
+  s->encrypt = true;
+  s->sink = sink;
+  s->sink_ctx = sink_ctx;
+
+  /* Header and IV go out as they will sit in the envelope. */
+  uint8_t *head = s->header;
+  size_t pos = 0;
+  head[pos++] = (uint8_t)id_len;
+  memcpy(head + pos, id, id_len);
+  pos += id_len;
+  head[pos++] = version;
+  kef_encode_iterations(iterations, head + pos);
+  pos += 3;
+  uint8_t *iv = head + pos;
+  pos += s->vi->iv_size;
+
+  kef_error_t err = KEF_ERR_CRYPTO;
+  if (crypto_random_bytes(iv, s->vi->iv_size) == CRYPTO_OK)
+    err = stream_start_cipher(s, key, iv);
+  if (err == KEF_OK)
+    err = stream_emit(s, head, pos);
+  if (err != KEF_OK) {
+    kef_stream_abort(s);
+    return err;
+  }
+  *stream_out = s;
+  return KEF_OK;
+}
+
+kef_error_t kef_stream_decrypt_init(const uint8_t key[32], kef_sink_t sink,
+                                    void *sink_ctx,
+                                    kef_stream_t **stream_out) {
+  if (!key || !sink || !stream_out)
+    return KEF_ERR_INVALID_ARG;
+  *stream_out = NULL;
+
+  kef_stream_t *s = calloc(1, sizeof(*s));
+  if (!s)
+    return KEF_ERR_ALLOC;
+  s->sink = sink;
+  s->sink_ctx = sink_ctx;
+  memcpy(s->key, key, sizeof(s->key));
+  *stream_out = s;
+  return KEF_OK;
+}
+
+/*
+ * Decrypt: collects the header and IV, then starts the cipher and wipes the
+ * key. Returns how much of data it took.
+ */
+static kef_error_t stream_read_header(kef_stream_t *s, const uint8_t *data,
+                                      size_t len, size_t *used) {
+  *used = 0;
+  while (!s->cipher && *used < len) {
+    size_t need = 1;
+    if (s->header_len >= 1) {
+      size_t id_len = s->header[0];
+      if (id_len == 0)
+        return KEF_ERR_INVALID_ARG;
+      need = 1 + id_len + 1;
+      if (s->header_len >= need) {
+        if (!s->vi) {
+          if (!kef_stream_supported(s->header[1 + id_len]))
+            return KEF_ERR_UNSUPPORTED_VERSION;
+          s->vi = find_version(s->header[1 + id_len]);
+        }
+        need += 3 + s->vi->iv_size;
+      }
+    }
+    if (s->header_len < need) {
+      size_t n = need - s->header_len;
+      if (n > len - *used)
+        n = len - *used;
+      memcpy(s->header + s->header_len, data + *used, n);
+      s->header_len += n;
+      *used += n;
+    }
+    if (s->vi && s->header_len == need) {
+      kef_error_t err =
+          stream_start_cipher(s, s->key, s->header + need - s->vi->iv_size);
+      secure_memzero(s->key, sizeof(s->key));
+      if (err != KEF_OK)
+        return err;
+    }
   }
+  return KEF_OK;
+}
+
+/*
+ * Decrypt: everything but the last auth_size bytes goes through the cipher;
+ * those stay in tail until the next update or finish.
+ */
+static kef_error_t stream_decrypt_update(kef_stream_t *s, const uint8_t *data,
+                                         size_t len) {
+  size_t used;
+  kef_error_t err = stream_read_header(s, data, len, &used);
+  if (err != KEF_OK)
+    return err;
+  data += used;
+  len -= used;
+
+  size_t keep = s->vi ? s->vi->auth_size : 0;
+  if (s->tail_len + len <= keep) {
+    memcpy(s->tail + s->tail_len, data, len);
+    s->tail_len += len;
+    return KEF_OK;
+  }
+
+  size_t run = s->tail_len + len - keep;
+  size_t from_tail = run < s->tail_len ? run : s->tail_len;
+  err = stream_cipher(s, s->tail, from_tail);
+  if (err != KEF_OK)
+    return err;
+  memmove(s->tail, s->tail + from_tail, s->tail_len - from_tail);
+  s->tail_len -= from_tail;
+
+  size_t from_data = run - from_tail;
+  err = stream_cipher(s, data, from_data);
+  if (err != KEF_OK)
+    return err;
+  memcpy(s->tail + s->tail_len, data + from_data, len - from_data);
+  s->tail_len += len - from_data;
+  return KEF_OK;
+}
+
+kef_error_t kef_stream_update(kef_stream_t *stream, const uint8_t *data,
+                              size_t len) {
+  if (!stream || (!data && len > 0))
+    return KEF_ERR_INVALID_ARG;
+  if (stream->encrypt)
+    return stream_cipher(stream, data, len);
+  return stream_decrypt_update(stream, data, len);
+}
+
+static kef_error_t stream_finish_encrypt(kef_stream_t *s) {
+  if (s->in_len == 0)
+    return KEF_ERR_INVALID_ARG;
+
+  size_t auth_size = s->vi->auth_size;
+  kef_error_t err;
+  if (s->vi->mode == MODE_CTR) {
+    /* Hidden auth: SHA256(plaintext) prefix, encrypted after the data. */
+    uint8_t hash[CRYPTO_SHA256_SIZE];
+    int rc = crypto_sha256_finish(s->sha, hash);
+    s->sha = NULL;
+    err = rc == CRYPTO_OK ? stream_cipher(s, hash, auth_size)
+                          : KEF_ERR_CRYPTO;
+    secure_memzero(hash, sizeof(hash));
+    if (err != KEF_OK)
+      return err;
+  }
+
+  uint8_t tag[CRYPTO_AES_BLOCK_SIZE];
+  size_t produced;
+  int rc = crypto_aes_stream_finish(
+      s->cipher, s->buf, sizeof(s->buf), &produced,
+      s->vi->mode == MODE_GCM ? tag : NULL,
+      s->vi->mode == MODE_GCM ? auth_size : 0);
+  s->cipher = NULL;
+  if (rc != CRYPTO_OK)
+    return KEF_ERR_CRYPTO;
+  err = stream_emit(s, s->buf, produced);
+  if (err == KEF_OK && s->vi->mode == MODE_GCM)
+    err = stream_emit(s, tag, auth_size);
+  secure_memzero(tag, sizeof(tag));
+  return err;
+}
+
+static kef_error_t stream_finish_decrypt(kef_stream_t *s) {
+  if (!s->cipher || s->tail_len < s->vi->auth_size)
+    return KEF_ERR_ENVELOPE_TOO_SHORT;
+
+  size_t auth_size = s->vi->auth_size;
+  if (s->vi->mode == MODE_GCM) {
+    if (s->in_len == 0)
+      return KEF_ERR_ENVELOPE_TOO_SHORT;
+    size_t produced;
+    int rc = crypto_aes_stream_finish(s->cipher, s->buf, sizeof(s->buf),
+                                      &produced, s->tail, auth_size);
+    s->cipher = NULL;
+    if (rc == CRYPTO_ERR_AUTH_FAILED)
+      return KEF_ERR_AUTH;
+    if (rc != CRYPTO_OK)
+      return KEF_ERR_CRYPTO;
+    return stream_output(s, s->buf, produced);
+  }
+
+  /* CTR: the tail is the encrypted hidden auth. Whatever plaintext the
+   * cipher still held comes out ahead of it. */
+  size_t lag = s->in_len - s->out_len;
+  size_t n1, n2;
+  int rc = crypto_aes_stream_update(s->cipher, s->tail, auth_size, s->buf,
+                                    sizeof(s->buf), &n1);
+  if (rc == CRYPTO_OK)
+    rc = crypto_aes_stream_finish(s->cipher, s->buf + n1, sizeof(s->buf) - n1,
+                                  &n2, NULL, 0);
+  else
+    crypto_aes_stream_abort(s->cipher);
+  s->cipher = NULL;
+  if (rc != CRYPTO_OK || n1 + n2 != lag + auth_size)
+    return KEF_ERR_CRYPTO;
+
+  kef_error_t err = stream_output(s, s->buf, lag);
+  if (err != KEF_OK)
+    return err;
+  uint8_t hash[CRYPTO_SHA256_SIZE];
+  rc = crypto_sha256_finish(s->sha, hash);
+  s->sha = NULL;
+  if (rc != CRYPTO_OK)
+    err = KEF_ERR_CRYPTO;
+  else if (secure_memcmp(hash, s->buf + lag, auth_size) != 0)
+    err = KEF_ERR_AUTH;
+  secure_memzero(hash, sizeof(hash));
   return err;
 }
 
+kef_error_t kef_stream_finish(kef_stream_t *stream) {
+  if (!stream)
+    return KEF_ERR_INVALID_ARG;
+  kef_error_t err = stream->encrypt ? stream_finish_encrypt(stream)
+                                    : stream_finish_decrypt(stream);
+  kef_stream_abort(stream);
+  return err;
+}
+
+void kef_stream_abort(kef_stream_t *stream) {
+  if (!stream)
+    return;
+  crypto_aes_stream_abort(stream->cipher);
+  crypto_sha256_abort(stream->sha);
+  secure_memzero(stream, sizeof(*stream));
+  free(stream);
+}
+
 /* ------------------------------------------------------------------ */
 /*  Envelope detection                                                 */
 /* ------------------------------------------------------------------ */
@@ -852,6 +1377,8 @@ const char *kef_error_str(kef_error_t err) {
     return "envelope too short";
   case KEF_ERR_DUPLICATE_BLOCKS:
     return "duplicate ECB blocks detected";
+  case KEF_ERR_SINK:
+    return "output write failed";
   }
   return "unknown error";
 }
@@ -11,6 +11,9 @@
  *
  * Both kef_encrypt and kef_decrypt heap-allocate output.
  * Caller frees with free() or SECURE_FREE_BUFFER().
+ *
+ * Payloads too large to hold two or three times over go through a
+ * kef_stream_t instead (CTR and GCM versions without compression).
  */
 
 #ifndef KEF_H
@@ -52,6 +55,7 @@ typedef enum {
   KEF_ERR_DECOMPRESS = -7,
   KEF_ERR_ENVELOPE_TOO_SHORT = -8,
   KEF_ERR_DUPLICATE_BLOCKS = -9,
+  KEF_ERR_SINK = -10,
 } kef_error_t;
 
 /*
@@ -80,6 +84,38 @@ kef_error_t kef_decrypt(const uint8_t *envelope, size_t env_len,
                         const uint8_t *password, size_t pw_len, uint8_t **out,
                         size_t *out_len);
 
+/*
+ * Decrypt with a key already derived by kef_derive_key for the envelope's id
+ * and iterations (e.g. on another task). Same results as kef_decrypt.
+ */
+kef_error_t kef_decrypt_with_key(const uint8_t *envelope, size_t env_len,
+                                 const uint8_t key[32], uint8_t **out,
+                                 size_t *out_len);
+
+/*
+ * A derived key imported for AES once, for several envelopes with the same
+ * id and iterations (backups sharing an ID in a batch unlock): each
+ * kef_key_decrypt skips both the derivation and the key import.
+ */
+typedef struct kef_key kef_key_t;
+
+KERN_WARN_UNUSED_RESULT kef_error_t kef_key_create(const uint8_t key[32],
+                                                   kef_key_t **key_out);
+
+/* Same results as kef_decrypt_with_key. */
+kef_error_t kef_key_decrypt(const kef_key_t *key, const uint8_t *envelope,
+                            size_t env_len, uint8_t **out, size_t *out_len);
+
+/* Wipes and frees. Safe on NULL. */
+void kef_key_destroy(kef_key_t *key);
+
+/*
+ * The checks kef_decrypt makes before deriving the key: header, known
+ * version and payload sizes. KEF_OK if the envelope is worth a derivation.
+ */
+KERN_WARN_UNUSED_RESULT kef_error_t kef_check_envelope(const uint8_t *envelope,
+                                                       size_t env_len);
+
 /*
  * Parse header fields without decrypting.
  * id_out points into the envelope buffer (not a copy).
@@ -89,6 +125,76 @@ kef_error_t kef_parse_header(const uint8_t *envelope, size_t env_len,
                              const uint8_t **id_out, size_t *id_len_out,
                              uint8_t *version_out, uint32_t *iterations_out);
 
+/*
+ * PBKDF2 key for an envelope: id is the salt. iterations is the effective
+ * count (kef_parse_header reports it that way).
+ */
+KERN_WARN_UNUSED_RESULT kef_error_t kef_derive_key(const uint8_t *id,
+                                                   size_t id_len,
+                                                   const uint8_t *password,
+                                                   size_t pw_len,
+                                                   uint32_t iterations,
+                                                   uint8_t key_out[32]);
+
+/* ------------------------------------------------------------------ */
+/*  Streaming                                                          */
+/* ------------------------------------------------------------------ */
+
+/*
+ * A stream encrypts or decrypts in pieces, producing exactly the envelope /
+ * plaintext the one-shot functions would, and hands its output to a sink a
+ * chunk at a time (at most KEF_STREAM_CHUNK + 16 bytes per call). It holds
+ * about 1 KB whatever the payload size.
+ *
+ * Only versions 15 (CTR) and 20 (GCM) stream: ECB/CBC NUL padding is
+ * resolved from the end of the payload, and compression needs the whole
+ * payload up front. Other versions return KEF_ERR_UNSUPPORTED_VERSION.
+ *
+ * Decryption hands out plaintext before the auth at the end has been
+ * checked. If kef_stream_finish does not return KEF_OK, everything the sink
+ * received must be discarded.
+ */
+typedef struct kef_stream kef_stream_t;
+
+#define KEF_STREAM_CHUNK 512
+
+/* Receives output in order. Return false to fail the stream (KEF_ERR_SINK).
+ */
+typedef bool (*kef_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+KERN_WARN_UNUSED_RESULT bool kef_stream_supported(uint8_t version);
+
+/*
+ * Start an envelope. key comes from kef_derive_key for the same id and
+ * iterations. The header and IV go to the sink before this returns.
+ */
+KERN_WARN_UNUSED_RESULT kef_error_t kef_stream_encrypt_init(
+    const uint8_t key[32], const uint8_t *id, size_t id_len, uint8_t version,
+    uint32_t iterations, kef_sink_t sink, void *sink_ctx,
+    kef_stream_t **stream_out);
+
+/*
+ * Start reading an envelope, header included. The caller has already parsed
+ * the header (kef_parse_header on the first bytes) to derive key.
+ */
+KERN_WARN_UNUSED_RESULT kef_error_t
+kef_stream_decrypt_init(const uint8_t key[32], kef_sink_t sink,
+                        void *sink_ctx, kef_stream_t **stream_out);
+
+/* Plaintext (encrypt) or envelope bytes (decrypt), any split. */
+KERN_WARN_UNUSED_RESULT kef_error_t kef_stream_update(kef_stream_t *stream,
+                                                      const uint8_t *data,
+                                                      size_t len);
+
+/*
+ * Encrypt: writes the auth / tag. Decrypt: checks it (KEF_ERR_AUTH).
+ * Frees the stream either way.
+ */
+KERN_WARN_UNUSED_RESULT kef_error_t kef_stream_finish(kef_stream_t *stream);
+
+/* Frees a stream without finishing it. Safe on NULL. */
+void kef_stream_abort(kef_stream_t *stream);
+
 /* Encode effective iteration count → 3-byte big-endian stored value. */
 void kef_encode_iterations(uint32_t effective, uint8_t out[3]);
 
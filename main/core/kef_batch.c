@@ -0,0 +1,308 @@
+/*
+ * KEF batch unlock — envelopes pulled by two workers from one queue
+ *
+ * The queue is ordered by iteration count, most first, so the two workers
+ * finish close together whatever the mix. Envelopes with the same id and
+ * iterations share a key: only the first is queued, and its worker derives
+ * and imports the key once (kef_key_t) for the whole group. The batch is
+ * shared by the owner and the workers and freed by whichever lets go last:
+ * destroy does not wait for a derivation in progress.
+ */
+
+#include "kef_batch.h"
+#include "../utils/power_gov.h"
+#include "../utils/secure_mem.h"
+
+#include <esp_log.h>
+#include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/idf_additions.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEF_BATCH_WORKERS 2
+#define KEF_BATCH_STACK_SIZE 8192
+/* Core 1 priority, as the single-envelope decrypt task. */
+#define KEF_BATCH_PRIORITY 5
+#define NO_SLOT SIZE_MAX
+
+static const char *TAG = "kef_batch";
+
+typedef enum {
+  SLOT_QUEUED,
+  SLOT_RUNNING,
+  SLOT_DONE,
+  SLOT_REPORTED,
+} slot_state_t;
+
+typedef struct {
+  uint8_t *envelope;
+  size_t env_len;
+  const uint8_t *id; /* into envelope */
+  size_t id_len;
+  uint32_t iterations;
+  size_t next_same; /* next slot sharing this one's key, or NO_SLOT */
+  slot_state_t state;
+  kef_error_t err;
+  uint8_t *data;
+  size_t data_len;
+} kef_batch_slot_t;
+
+typedef struct {
+  kef_batch_t *batch;
+  int core;
+} kef_batch_worker_t;
+
+struct kef_batch {
+  SemaphoreHandle_t lock;
+  uint8_t *password;
+  size_t pw_len;
+  kef_batch_slot_t *slots;
+  size_t count;
+  size_t *queue; /* slot indices, most iterations first */
+  size_t queue_len;
+  size_t next;
+  size_t reported;
+  kef_batch_worker_t workers[KEF_BATCH_WORKERS];
+  int workers_running;
+  int refs; /* owner + running workers */
+  bool cancelled;
+};
+
+static void batch_free(kef_batch_t *b) {
+  for (size_t i = 0; i < b->count; i++) {
+    kef_batch_slot_t *slot = &b->slots[i];
+    SECURE_FREE_BUFFER(slot->envelope, slot->env_len);
+    SECURE_FREE_BUFFER(slot->data, slot->data_len);
+  }
+  free(b->slots);
+  free(b->queue);
+  SECURE_FREE_BUFFER(b->password, b->pw_len);
+  if (b->lock)
+    vSemaphoreDelete(b->lock);
+  free(b);
+}
+
+/* Drops one reference. The last worker out wipes the passphrase; the last
+ * reference frees the batch. */
+static void batch_release(kef_batch_t *b, bool worker) {
+  xSemaphoreTake(b->lock, portMAX_DELAY);
+  if (worker && --b->workers_running == 0)
+    secure_memzero(b->password, b->pw_len);
+  bool last = --b->refs == 0;
+  xSemaphoreGive(b->lock);
+  if (last)
+    batch_free(b);
+}
+
+static void post_result(kef_batch_t *b, kef_batch_slot_t *slot,
+                        kef_error_t err, uint8_t *data, size_t data_len) {
+  xSemaphoreTake(b->lock, portMAX_DELAY);
+  slot->err = err;
+  slot->data = data;
+  slot->data_len = data_len;
+  slot->state = SLOT_DONE;
+  xSemaphoreGive(b->lock);
+}
+
+/* Derive and import the key once, decrypt every envelope sharing it. */
+static void unlock_group(kef_batch_t *b, size_t first) {
+  const kef_batch_slot_t *lead = &b->slots[first];
+  uint8_t raw[32];
+  kef_key_t *key = NULL;
+
+  kef_error_t err = kef_derive_key(lead->id, lead->id_len, b->password,
+                                   b->pw_len, lead->iterations, raw);
+  if (err == KEF_OK)
+    err = kef_key_create(raw, &key);
+  secure_memzero(raw, sizeof(raw));
+
+  for (size_t i = first; i != NO_SLOT; i = b->slots[i].next_same) {
+    kef_batch_slot_t *slot = &b->slots[i];
+    uint8_t *data = NULL;
+    size_t data_len = 0;
+    kef_error_t slot_err = err;
+    if (slot_err == KEF_OK)
+      slot_err = kef_key_decrypt(key, slot->envelope, slot->env_len, &data,
+                                 &data_len);
+    post_result(b, slot, slot_err, data, data_len);
+  }
+  kef_key_destroy(key);
+}
+
+/* Does NOT touch LVGL */
+static void batch_worker_task(void *arg) {
+  kef_batch_worker_t *w = arg;
+  kef_batch_t *b = w->batch;
+
+  /* The core 1 worker starves IDLE1 for the whole batch (the core 0 one runs
+   * at idle priority and does not) */
+  TaskHandle_t idle1 = NULL;
+  if (w->core == 1) {
+    idle1 = xTaskGetIdleTaskHandleForCore(1);
+    esp_task_wdt_delete(idle1);
+  }
+  power_gov_acquire(POWER_ACT_KDF);
+
+  for (;;) {
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    if (b->cancelled || b->next == b->queue_len) {
+      xSemaphoreGive(b->lock);
+      break;
+    }
+    size_t first = b->queue[b->next++];
+    for (size_t i = first; i != NO_SLOT; i = b->slots[i].next_same)
+      b->slots[i].state = SLOT_RUNNING;
+    xSemaphoreGive(b->lock);
+
+    unlock_group(b, first);
+  }
+
+  power_gov_release(POWER_ACT_KDF);
+  if (idle1)
+    esp_task_wdt_add(idle1);
+  batch_release(b, true);
+  vTaskDelete(NULL);
+}
+
+kef_error_t kef_batch_start(const uint8_t *password, size_t pw_len,
+                            const uint8_t *const *envelopes,
+                            const size_t *env_lens, size_t count,
+                            kef_batch_t **batch_out) {
+  if (!password || pw_len == 0 || !envelopes || !env_lens || count == 0 ||
+      !batch_out)
+    return KEF_ERR_INVALID_ARG;
+  *batch_out = NULL;
+
+  kef_batch_t *b = calloc(1, sizeof(*b));
+  if (!b)
+    return KEF_ERR_ALLOC;
+  b->count = count;
+  b->lock = xSemaphoreCreateMutex();
+  b->password = malloc(pw_len);
+  b->slots = calloc(count, sizeof(*b->slots));
+  b->queue = malloc(count * sizeof(*b->queue));
+  if (!b->lock || !b->password || !b->slots || !b->queue) {
+    batch_free(b);
+    return KEF_ERR_ALLOC;
+  }
+  memcpy(b->password, password, pw_len);
+  b->pw_len = pw_len;
+
+  for (size_t i = 0; i < count; i++) {
+    kef_batch_slot_t *slot = &b->slots[i];
+    slot->err = KEF_ERR_INVALID_ARG;
+    if (envelopes[i] && env_lens[i] > 0)
+      slot->err = kef_check_envelope(envelopes[i], env_lens[i]);
+    if (slot->err != KEF_OK) {
+      slot->state = SLOT_DONE;
+      continue;
+    }
+
+    slot->envelope = malloc(env_lens[i]);
+    if (!slot->envelope) {
+      batch_free(b);
+      return KEF_ERR_ALLOC;
+    }
+    memcpy(slot->envelope, envelopes[i], env_lens[i]);
+    slot->env_len = env_lens[i];
+    (void)kef_parse_header(slot->envelope, slot->env_len, &slot->id,
+                           &slot->id_len, NULL, &slot->iterations);
+    slot->next_same = NO_SLOT;
+    slot->state = SLOT_QUEUED;
+
+    /* Same id and iterations as a queued envelope: join its group */
+    size_t lead = NO_SLOT;
+    for (size_t q = 0; q < b->queue_len && lead == NO_SLOT; q++) {
+      const kef_batch_slot_t *other = &b->slots[b->queue[q]];
+      if (other->iterations == slot->iterations &&
+          other->id_len == slot->id_len &&
+          memcmp(other->id, slot->id, slot->id_len) == 0)
+        lead = b->queue[q];
+    }
+    if (lead != NO_SLOT) {
+      while (b->slots[lead].next_same != NO_SLOT)
+        lead = b->slots[lead].next_same;
+      b->slots[lead].next_same = i;
+      continue;
+    }
+
+    /* Insertion by iterations, most first; batches are a handful long */
+    size_t pos = b->queue_len++;
+    while (pos > 0 &&
+           b->slots[b->queue[pos - 1]].iterations < slot->iterations) {
+      b->queue[pos] = b->queue[pos - 1];
+      pos--;
+    }
+    b->queue[pos] = i;
+  }
+
+  b->refs = 1 + KEF_BATCH_WORKERS;
+  b->workers_running = KEF_BATCH_WORKERS;
+  int started = 0;
+  for (int core = 1; core >= 0; core--) {
+    kef_batch_worker_t *w = &b->workers[core];
+    w->batch = b;
+    w->core = core;
+    UBaseType_t priority = core == 1 ? KEF_BATCH_PRIORITY : tskIDLE_PRIORITY;
+    if (xTaskCreatePinnedToCore(batch_worker_task, "kef_batch",
+                                KEF_BATCH_STACK_SIZE, w, priority, NULL,
+                                core) == pdPASS) {
+      started++;
+    } else {
+      ESP_LOGW(TAG, "No worker on core %d", core);
+      batch_release(b, true);
+    }
+  }
+  if (started == 0) {
+    batch_release(b, false);
+    return KEF_ERR_ALLOC;
+  }
+
+  *batch_out = b;
+  return KEF_OK;
+}
+
+bool kef_batch_poll(kef_batch_t *batch, kef_batch_result_cb_t cb, void *ctx) {
+  if (!batch)
+    return true;
+
+  for (size_t i = 0; i < batch->count; i++) {
+    kef_batch_slot_t *slot = &batch->slots[i];
+
+    xSemaphoreTake(batch->lock, portMAX_DELAY);
+    bool done = slot->state == SLOT_DONE;
+    uint8_t *data = slot->data;
+    size_t data_len = slot->data_len;
+    if (done) {
+      slot->state = SLOT_REPORTED;
+      slot->data = NULL;
+      slot->data_len = 0;
+      batch->reported++;
+    }
+    xSemaphoreGive(batch->lock);
+    if (!done)
+      continue;
+
+    /* Its envelope is no longer needed either */
+    SECURE_FREE_BUFFER(slot->envelope, slot->env_len);
+    slot->env_len = 0;
+    if (cb)
+      cb(ctx, i, slot->err, data, data_len);
+    SECURE_FREE_BUFFER(data, data_len);
+  }
+
+  return batch->reported == batch->count;
+}
+
+void kef_batch_destroy(kef_batch_t *batch) {
+  if (!batch)
+    return;
+  xSemaphoreTake(batch->lock, portMAX_DELAY);
+  batch->cancelled = true;
+  xSemaphoreGive(batch->lock);
+  batch_release(batch, false);
+}
@@ -0,0 +1,56 @@
+/*
+ * KEF batch unlock — one passphrase tried on several envelopes
+ *
+ * Each envelope has its own PBKDF2 (its id is the salt), and at 100k+
+ * iterations the derivation is nearly all of the cost of opening it. A batch
+ * runs the derivations on two worker tasks, one per core, longest first, and
+ * hands back each result as soon as it is done. The core 0 worker runs at
+ * idle priority, so it only takes time the UI leaves unused.
+ *
+ * Keys stay on the workers and are wiped after use. A plaintext is wiped and
+ * freed as soon as the poll callback reporting it returns.
+ */
+
+#ifndef KEF_BATCH_H
+#define KEF_BATCH_H
+
+#include "../utils/attributes.h"
+#include "kef.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct kef_batch kef_batch_t;
+
+/*
+ * One finished envelope. On KEF_OK data / len hold its plaintext, otherwise
+ * NULL / 0 (KEF_ERR_AUTH for a different passphrase). data is only valid
+ * during the call: copy what you keep.
+ */
+typedef void (*kef_batch_result_cb_t)(void *ctx, size_t index,
+                                      kef_error_t err, const uint8_t *data,
+                                      size_t len);
+
+/*
+ * Copies the passphrase and the envelopes and starts the workers. Envelopes
+ * that fail kef_check_envelope are reported by the first poll without a
+ * derivation.
+ */
+KERN_WARN_UNUSED_RESULT kef_error_t
+kef_batch_start(const uint8_t *password, size_t pw_len,
+                const uint8_t *const *envelopes, const size_t *env_lens,
+                size_t count, kef_batch_t **batch_out);
+
+/*
+ * Calls cb, on the calling task, for each envelope finished since the last
+ * poll. Returns true once every envelope has been reported.
+ */
+bool kef_batch_poll(kef_batch_t *batch, kef_batch_result_cb_t cb, void *ctx);
+
+/*
+ * Stops handing out envelopes and drops the batch. A derivation already
+ * running finishes on its worker and is discarded. Safe on NULL.
+ */
+void kef_batch_destroy(kef_batch_t *batch);
+
+#endif /* KEF_BATCH_H */
@@ -1,4 +1,5 @@
 #include "message_sign.h"
+#include "../utils/perf.h"
 #include "../utils/secure_mem.h"
 #include "key.h"
 #include <esp_log.h>
@@ -132,6 +133,7 @@ bool message_sign_sign(const char *derivation_path, const char *message,
     return false;
   }
 
+  PERF_COUNT(PERF_CTR_SIGNATURES);
   *signature_b64_out = b64_output;
   return true;
 }
@@ -2,7 +2,6 @@
 // and an indented tree rendering ported from Krux's MiniScriptIndenter.
 
 #include "miniscript_policy.h"
-#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -83,47 +82,103 @@ char *miniscript_policy_string(const struct wally_descriptor *desc) {
 
 // ---------------------------------------------------------------------------
 // Indenter (port of Krux MiniScriptIndenter)
+//
+// Nodes live in one array and every string the indenter produces (node
+// texts, rendered lines, flattened forms) is an offset/length slice of a
+// single growing text buffer. Each node's first line, which is what a
+// parent's flattened form is made of, is worked out once and memoized rather
+// than re-rendering the subtree for every ancestor.
 // ---------------------------------------------------------------------------
 
-typedef struct ms_node {
-  char *text; // prefix before '(' or full leaf text
-  struct ms_node **children;
-  size_t num_children;
+#define NO_SPAN UINT32_MAX
+
+typedef struct {
+  uint32_t off;
+  uint32_t len;
+} span_t;
+
+typedef enum { FLAT_UNKNOWN, FLAT_FITS, FLAT_TOO_LONG } flat_state_t;
+
+typedef struct {
+  span_t text;           // prefix before '(' or full leaf text
+  uint32_t first_child;  // node index, 0 for a leaf (the root is never a child)
+  uint32_t next_sibling; // node index, 0 for the last child
+  uint32_t num_children;
   int level;
+  span_t first_line; // trimmed first rendered line, len NO_SPAN until known
+  span_t flat;       // children on one line, valid once `fit` is known
+  uint8_t fit;       // flat_state_t
 } ms_node_t;
 
 typedef struct {
-  char **items;
+  char *buf; // starts with a copy of the expression the nodes point into
+  size_t len;
+  size_t cap;
+  ms_node_t *nodes;
+  size_t num_nodes;
+  size_t max_nodes;
+  size_t max_width;
+} indenter_t;
+
+typedef struct {
+  span_t *items;
   size_t count;
   size_t cap;
+  size_t joined; // items before this one went through join_closing_parens
 } lines_t;
 
-static char *str_printf(const char *fmt, ...) {
-  va_list ap;
-  va_start(ap, fmt);
-  int len = vsnprintf(NULL, 0, fmt, ap);
-  va_end(ap);
-  if (len < 0)
-    return NULL;
-  char *out = malloc((size_t)len + 1);
-  if (!out)
-    return NULL;
-  va_start(ap, fmt);
-  vsnprintf(out, (size_t)len + 1, fmt, ap);
-  va_end(ap);
-  return out;
+static bool text_reserve(indenter_t *r, size_t extra) {
+  if (r->len + extra <= r->cap)
+    return true;
+  if (r->len + extra >= NO_SPAN)
+    return false;
+  size_t cap = r->cap * 2;
+  if (cap < r->len + extra)
+    cap = r->len + extra;
+  char *buf = realloc(r->buf, cap);
+  if (!buf)
+    return false;
+  r->buf = buf;
+  r->cap = cap;
+  return true;
 }
 
-static bool lines_push(lines_t *l, char *line) {
-  if (!line)
+static bool text_append_span(indenter_t *r, span_t s) {
+  if (!text_reserve(r, s.len))
     return false;
+  memcpy(r->buf + r->len, r->buf + s.off, s.len); // may alias: reserve first
+  r->len += s.len;
+  return true;
+}
+
+static bool text_append_char(indenter_t *r, char c, size_t count) {
+  if (!text_reserve(r, count))
+    return false;
+  memset(r->buf + r->len, c, count);
+  r->len += count;
+  return true;
+}
+
+static span_t span_since(const indenter_t *r, size_t start) {
+  return (span_t){(uint32_t)start, (uint32_t)(r->len - start)};
+}
+
+static span_t span_trim(const indenter_t *r, span_t s) {
+  while (s.len && r->buf[s.off] == ' ') {
+    s.off++;
+    s.len--;
+  }
+  while (s.len && r->buf[s.off + s.len - 1] == ' ')
+    s.len--;
+  return s;
+}
+
+static bool lines_push(lines_t *l, span_t line) {
   if (l->count == l->cap) {
-    size_t cap = l->cap ? l->cap * 2 : 8;
-    char **items = realloc(l->items, cap * sizeof(*items));
-    if (!items) {
-      free(line);
+    size_t cap = l->cap ? l->cap * 2 : 32;
+    span_t *items = realloc(l->items, cap * sizeof(*items));
+    if (!items)
       return false;
-    }
     l->items = items;
     l->cap = cap;
   }
@@ -131,207 +186,259 @@ static bool lines_push(lines_t *l, char *line) {
   return true;
 }
 
-static void lines_free(lines_t *l) {
-  for (size_t i = 0; i < l->count; i++)
-    free(l->items[i]);
-  free(l->items);
-  memset(l, 0, sizeof(*l));
+// "<indent><text><suffix>" as a new line.
+static bool push_line(indenter_t *r, lines_t *l, int indent, span_t text,
+                      char suffix) {
+  size_t start = r->len;
+  if (!text_append_char(r, ' ', (size_t)indent) ||
+      !text_append_span(r, text) || (suffix && !text_append_char(r, suffix, 1)))
+    return false;
+  return lines_push(l, span_since(r, start));
 }
 
-static char *dup_trim(const char *s, size_t len) {
-  while (len && *s == ' ') {
-    s++;
-    len--;
+static bool append_comma(indenter_t *r, lines_t *l) {
+  span_t *last = &l->items[l->count - 1];
+  if (last->off + last->len != r->len) {
+    size_t start = r->len;
+    if (!text_append_span(r, *last))
+      return false;
+    *last = span_since(r, start);
   }
-  while (len && s[len - 1] == ' ')
-    len--;
-  char *out = malloc(len + 1);
-  if (!out)
-    return NULL;
-  memcpy(out, s, len);
-  out[len] = '\0';
-  return out;
-}
-
-static void node_free(ms_node_t *node) {
-  if (!node)
-    return;
-  for (size_t i = 0; i < node->num_children; i++)
-    node_free(node->children[i]);
-  free(node->children);
-  free(node->text);
-  free(node);
-}
-
-static bool node_add_child(ms_node_t *node, ms_node_t *child) {
-  if (!child)
-    return false;
-  ms_node_t **children =
-      realloc(node->children, (node->num_children + 1) * sizeof(*children));
-  if (!children) {
-    node_free(child);
+  if (!text_append_char(r, ',', 1))
     return false;
-  }
-  node->children = children;
-  node->children[node->num_children++] = child;
+  last->len++;
   return true;
 }
 
-static ms_node_t *parse_expr(const char *expr, size_t len, int level) {
-  while (len && *expr == ' ') {
-    expr++;
-    len--;
-  }
-  while (len && expr[len - 1] == ' ')
-    len--;
-
-  ms_node_t *node = calloc(1, sizeof(*node));
-  if (!node)
-    return NULL;
+static uint32_t parse_expr(indenter_t *r, uint32_t off, uint32_t len,
+                           int level) {
+  const char *expr = r->buf;
+  span_t trimmed = span_trim(r, (span_t){off, len});
+  off = trimmed.off;
+  len = trimmed.len;
+
+  if (r->num_nodes == r->max_nodes)
+    return NO_SPAN;
+  uint32_t index = (uint32_t)r->num_nodes++;
+  ms_node_t *node = &r->nodes[index];
+  memset(node, 0, sizeof(*node));
   node->level = level;
+  node->first_line.len = NO_SPAN;
 
-  const char *paren = memchr(expr, '(', len);
+  const char *paren = memchr(expr + off, '(', len);
   if (!paren) {
-    node->text = dup_trim(expr, len);
-    if (!node->text) {
-      node_free(node);
-      return NULL;
-    }
-    return node;
+    node->text = trimmed;
+    return index;
   }
 
-  size_t pos = (size_t)(paren - expr);
-  node->text = dup_trim(expr, pos);
-  if (!node->text || len < pos + 2) {
-    node_free(node);
-    return NULL;
-  }
+  uint32_t pos = (uint32_t)(paren - (expr + off));
+  node->text = span_trim(r, (span_t){off, pos});
+  if (len < pos + 2)
+    return NO_SPAN;
 
   // Children: inside the outermost parens, split at top-level commas.
-  const char *inside = expr + pos + 1;
-  size_t inside_len = len - pos - 2;
+  uint32_t inside = off + pos + 1;
+  uint32_t inside_len = len - pos - 2;
+  uint32_t last = 0;
   int depth = 0;
-  size_t start = 0;
-  for (size_t i = 0; i < inside_len; i++) {
-    char c = inside[i];
+  uint32_t start = 0;
+  for (uint32_t i = 0; i <= inside_len; i++) {
+    bool end = (i == inside_len);
+    char c = end ? '\0' : expr[inside + i];
     if (c == '(') {
       depth++;
-    } else if (c == ')') {
+      continue;
+    }
+    if (c == ')') {
       depth--;
-    } else if (c == ',' && depth == 0) {
-      if (!node_add_child(node,
-                          parse_expr(inside + start, i - start, level + 1))) {
-        node_free(node);
-        return NULL;
-      }
-      start = i + 1;
+      continue;
     }
+    if (end ? start >= inside_len : (c != ',' || depth != 0))
+      continue;
+    uint32_t child = parse_expr(r, inside + start, i - start, level + 1);
+    if (child == NO_SPAN)
+      return NO_SPAN;
+    if (last)
+      r->nodes[last].next_sibling = child;
+    else
+      r->nodes[index].first_child = child;
+    r->nodes[index].num_children++;
+    last = child;
+    start = i + 1;
   }
-  if (start < inside_len &&
-      !node_add_child(
-          node, parse_expr(inside + start, inside_len - start, level + 1))) {
-    node_free(node);
-    return NULL;
-  }
-  return node;
+  return index;
+}
+
+static bool all_close_parens(const char *s, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    if (s[i] != ')')
+      return false;
+  return true;
 }
 
-// Merge lines that are only closing parens into the previous line.
-static void join_closing_parens(lines_t *l) {
+// Merge lines that are only closing parens into the previous line. Lines a
+// previous pass left alone are only looked at again once a merge reaches
+// them, so each pass costs the lines added since the last one.
+static bool join_closing_parens(indenter_t *r, lines_t *l) {
+  bool merged = false;
   for (size_t i = l->count - 1; i > 0; i--) {
-    const char *s = l->items[i];
-    while (*s == ' ')
-      s++;
-    if (!*s)
-      continue;
-    const char *p = s;
-    while (*p == ')')
-      p++;
-    if (*p)
-      continue;
-    char *merged = str_printf("%s%s", l->items[i - 1], s);
-    if (!merged)
+    if (i < l->joined && !merged)
+      break;
+    merged = false;
+    span_t s = l->items[i];
+    while (s.len && r->buf[s.off] == ' ') {
+      s.off++;
+      s.len--;
+    }
+    if (s.len == 0 || !all_close_parens(r->buf + s.off, s.len))
       continue;
-    free(l->items[i - 1]);
-    l->items[i - 1] = merged;
-    free(l->items[i]);
+    size_t start = r->len;
+    if (!text_append_span(r, l->items[i - 1]) || !text_append_span(r, s))
+      return false;
+    l->items[i - 1] = span_since(r, start);
     memmove(&l->items[i], &l->items[i + 1],
             (l->count - i - 1) * sizeof(*l->items));
     l->count--;
+    merged = true;
   }
+  l->joined = l->count;
+  return true;
 }
 
-static bool node_to_lines(const ms_node_t *node, size_t max_width,
-                          lines_t *out);
+static bool node_to_lines(indenter_t *r, uint32_t index, lines_t *out);
+
+static bool has_leaf_child(const indenter_t *r, const ms_node_t *node) {
+  for (uint32_t c = node->first_child; c; c = r->nodes[c].next_sibling)
+    if (r->nodes[c].num_children == 0)
+      return true;
+  return false;
+}
+
+static bool node_first_line(indenter_t *r, uint32_t index, span_t *line);
+
+// "text(first,lines,of,children)", and whether it fits the width when
+// indented. Only asked of nodes with a leaf child below the top level.
+static bool node_flat(indenter_t *r, uint32_t index) {
+  if (r->nodes[index].fit != FLAT_UNKNOWN)
+    return true;
+
+  // Children's first lines first: each is appended to the buffer once.
+  for (uint32_t c = r->nodes[index].first_child; c;
+       c = r->nodes[c].next_sibling) {
+    span_t unused;
+    if (!node_first_line(r, c, &unused))
+      return false;
+  }
+
+  ms_node_t *node = &r->nodes[index];
+  size_t start = r->len;
+  if (!text_append_span(r, node->text) || !text_append_char(r, '(', 1))
+    return false;
+  for (uint32_t c = node->first_child; c; c = r->nodes[c].next_sibling) {
+    if (c != node->first_child && !text_append_char(r, ',', 1))
+      return false;
+    if (!text_append_span(r, r->nodes[c].first_line))
+      return false;
+  }
+  if (!text_append_char(r, ')', 1))
+    return false;
+  node->flat = span_since(r, start);
+  node->fit = ((size_t)node->level + node->flat.len <= r->max_width)
+                  ? FLAT_FITS
+                  : FLAT_TOO_LONG;
+  return true;
+}
 
 // First rendered line of a node, stripped of indentation.
-static char *node_first_line(const ms_node_t *node, size_t max_width) {
-  lines_t tmp = {0};
-  if (!node_to_lines(node, max_width, &tmp)) {
-    lines_free(&tmp);
-    return NULL;
+static bool node_first_line(indenter_t *r, uint32_t index, span_t *line) {
+  ms_node_t *node = &r->nodes[index];
+  if (node->first_line.len != NO_SPAN) {
+    *line = node->first_line;
+    return true;
+  }
+
+  span_t first;
+  if (node->num_children == 0) {
+    first = node->text;
+  } else {
+    if (node->level > 0 && has_leaf_child(r, node) && !node_flat(r, index))
+      return false;
+    const ms_node_t *child = &r->nodes[node->first_child];
+    span_t ct = child->text;
+    if (node->fit == FLAT_FITS) {
+      first = node->flat;
+    } else if (child->num_children > 0 ||
+               (ct.len > 0 && !all_close_parens(r->buf + ct.off, ct.len))) {
+      // The next line holds text, so no closing parens join this one.
+      size_t start = r->len;
+      if (!text_append_span(r, node->text) || !text_append_char(r, '(', 1))
+        return false;
+      first = span_since(r, start);
+    } else {
+      // A leaf of nothing but ')' (or nothing) under it: let the renderer
+      // work out what joins onto the first line.
+      lines_t tmp = {0};
+      bool ok = node_to_lines(r, index, &tmp);
+      if (ok)
+        first = span_trim(r, tmp.items[0]);
+      free(tmp.items);
+      if (!ok)
+        return false;
+    }
   }
-  char *first = dup_trim(tmp.items[0], strlen(tmp.items[0]));
-  lines_free(&tmp);
-  return first;
+  r->nodes[index].first_line = first;
+  *line = first;
+  return true;
 }
 
-static bool node_to_lines(const ms_node_t *node, size_t max_width,
-                          lines_t *out) {
+static bool node_to_lines(indenter_t *r, uint32_t index, lines_t *out) {
+  const ms_node_t *node = &r->nodes[index];
+  int level = node->level;
   if (node->num_children == 0)
-    return lines_push(out, str_printf("%*s%s", node->level, "", node->text));
+    return push_line(r, out, level, node->text, '\0');
 
   // If any child is a leaf, try flattening all children onto one line.
-  bool any_leaf = false;
-  for (size_t i = 0; i < node->num_children; i++)
-    if (node->children[i]->num_children == 0)
-      any_leaf = true;
-  if (any_leaf && node->level > 0) {
-    char *line = str_printf("%*s%s(", node->level, "", node->text);
-    for (size_t i = 0; line && i < node->num_children; i++) {
-      char *child = node_first_line(node->children[i], max_width);
-      char *next =
-          child ? str_printf("%s%s%s", line, i ? "," : "", child) : NULL;
-      free(child);
-      free(line);
-      line = next;
-    }
-    if (!line)
+  if (level > 0 && has_leaf_child(r, node)) {
+    if (!node_flat(r, index))
       return false;
-    char *flat = str_printf("%s)", line);
-    free(line);
-    if (!flat)
-      return false;
-    if (strlen(flat) <= max_width)
-      return lines_push(out, flat);
-    free(flat);
+    if (node->fit == FLAT_FITS)
+      return push_line(r, out, level, node->flat, '\0');
   }
 
-  if (!lines_push(out, str_printf("%*s%s(", node->level, "", node->text)))
+  if (!push_line(r, out, level, node->text, '('))
     return false;
-  for (size_t i = 0; i < node->num_children; i++) {
-    if (!node_to_lines(node->children[i], max_width, out))
+  for (uint32_t c = r->nodes[index].first_child; c;
+       c = r->nodes[c].next_sibling) {
+    if (!node_to_lines(r, c, out))
+      return false;
+    if (r->nodes[c].next_sibling && !append_comma(r, out))
       return false;
-    if (i < node->num_children - 1) {
-      char *with_comma = str_printf("%s,", out->items[out->count - 1]);
-      if (!with_comma)
-        return false;
-      free(out->items[out->count - 1]);
-      out->items[out->count - 1] = with_comma;
-    }
   }
-  if (!lines_push(out, str_printf("%*s)", node->level, "")))
+  if (!push_line(r, out, level, (span_t){0, 0}, ')'))
     return false;
 
-  join_closing_parens(out);
-  return true;
+  return join_closing_parens(r, out);
 }
 
-static void break_line_into(lines_t *out, const char *line, size_t max_width) {
-  size_t len = strlen(line);
+// Length of `line` once broken into pieces of at most max_width characters,
+// each repeating its indentation, with a '\n' or '\0' after each piece.
+static size_t broken_length(const char *line, size_t len, size_t max_width) {
+  if (len <= max_width)
+    return len + 1;
+  size_t indent = 0;
+  while (line[indent] == ' ')
+    indent++;
+  size_t chunk = (max_width > indent) ? max_width - indent : 1;
+  size_t pieces = (len - indent + chunk - 1) / chunk;
+  return len - indent + pieces * (indent + 1);
+}
+
+static char *break_line_into(char *out, const char *line, size_t len,
+                             size_t max_width) {
   if (len <= max_width) {
-    lines_push(out, str_printf("%s", line));
-    return;
+    memcpy(out, line, len);
+    out[len] = '\n';
+    return out + len + 1;
   }
   size_t indent = 0;
   while (line[indent] == ' ')
@@ -339,65 +446,81 @@ static void break_line_into(lines_t *out, const char *line, size_t max_width) {
   size_t chunk = (max_width > indent) ? max_width - indent : 1;
   const char *data = line + indent;
   size_t dlen = len - indent;
-  while (dlen > chunk) {
-    lines_push(out, str_printf("%*s%.*s", (int)indent, "", (int)chunk, data));
-    data += chunk;
-    dlen -= chunk;
+  while (dlen > 0) {
+    size_t n = dlen > chunk ? chunk : dlen;
+    memset(out, ' ', indent);
+    memcpy(out + indent, data, n);
+    out[indent + n] = '\n';
+    out += indent + n + 1;
+    data += n;
+    dlen -= n;
   }
-  lines_push(out, str_printf("%*s%.*s", (int)indent, "", (int)dlen, data));
+  return out;
 }
 
-char *miniscript_policy_indent(const char *expr, size_t max_line_width) {
+// The indented expression, '\n'-joined, with its length in *out_len.
+static char *indent_expr(const char *expr, size_t max_line_width,
+                         size_t *out_len) {
   if (!expr || !*expr || max_line_width == 0)
     return NULL;
 
-  bool multiple_tap_scripts = strchr(expr, '{') != NULL;
-
-  ms_node_t *tree = parse_expr(expr, strlen(expr), 0);
-  if (!tree)
-    return NULL;
+  size_t expr_len = strlen(expr);
+  // Every '(' and ',' starts at most one more node.
+  size_t max_nodes = 1;
+  for (size_t i = 0; i < expr_len; i++)
+    if (expr[i] == '(' || expr[i] == ',')
+      max_nodes++;
+
+  indenter_t r = {.max_width = max_line_width, .max_nodes = max_nodes};
+  r.cap = expr_len * 4 + 64;
+  r.buf = malloc(r.cap);
+  r.nodes = malloc(max_nodes * sizeof(*r.nodes));
   lines_t raw = {0};
-  bool ok = node_to_lines(tree, max_line_width, &raw);
-  node_free(tree);
-  if (!ok || raw.count == 0) {
-    lines_free(&raw);
-    return NULL;
-  }
+  char *joined = NULL;
+  if (!r.buf || !r.nodes || expr_len >= NO_SPAN / 4)
+    goto out;
+  memcpy(r.buf, expr, expr_len);
+  r.len = expr_len;
+
+  if (parse_expr(&r, 0, (uint32_t)expr_len, 0) == NO_SPAN ||
+      !node_to_lines(&r, 0, &raw) || raw.count == 0)
+    goto out;
 
-  lines_t fin = {0};
+  size_t total = 0;
   for (size_t i = 0; i < raw.count; i++)
-    break_line_into(&fin, raw.items[i], max_line_width);
-  lines_free(&raw);
-  if (fin.count == 0) {
-    lines_free(&fin);
-    return NULL;
-  }
+    total += broken_length(r.buf + raw.items[i].off, raw.items[i].len,
+                           max_line_width);
+  joined = malloc(total);
+  if (!joined)
+    goto out;
+  char *p = joined;
+  for (size_t i = 0; i < raw.count; i++)
+    p = break_line_into(p, r.buf + raw.items[i].off, raw.items[i].len,
+                        max_line_width);
+  p[-1] = '\0';
+  *out_len = total - 1;
 
-  if (multiple_tap_scripts) {
+  if (strchr(expr, '{')) {
     // Replace the penultimate ')' of the last line by '}'.
-    char *last = fin.items[fin.count - 1];
-    size_t len = strlen(last);
-    if (len >= 2)
-      last[len - 2] = '}';
+    char *last = joined + total - 1;
+    while (last > joined && last[-1] != '\n')
+      last--;
+    if (joined + total - 1 - last >= 2)
+      joined[total - 3] = '}';
   }
 
-  size_t total = 0;
-  for (size_t i = 0; i < fin.count; i++)
-    total += strlen(fin.items[i]) + 1;
-  char *joined = malloc(total);
-  if (joined) {
-    char *p = joined;
-    for (size_t i = 0; i < fin.count; i++) {
-      size_t len = strlen(fin.items[i]);
-      memcpy(p, fin.items[i], len);
-      p += len;
-      *p++ = (i < fin.count - 1) ? '\n' : '\0';
-    }
-  }
-  lines_free(&fin);
+out:
+  free(raw.items);
+  free(r.nodes);
+  free(r.buf);
   return joined;
 }
 
+char *miniscript_policy_indent(const char *expr, size_t max_line_width) {
+  size_t len;
+  return indent_expr(expr, max_line_width, &len);
+}
+
 // ---------------------------------------------------------------------------
 // Token view
 // ---------------------------------------------------------------------------
@@ -463,10 +586,33 @@ static bool format_after_note(uint32_t n, char *out, size_t out_size) {
   return true;
 }
 
+typedef struct {
+  uint32_t off; // into text, NUL-terminated without its indentation
+  int level;
+} view_line_t;
+
+struct ms_policy_view {
+  int refs;
+  size_t num_lines;
+  view_line_t *lines;
+  uint32_t *branches; // bit d-1: miniscript_policy_view_continues at depth d
+  char *text;
+  ms_token_t *tokens; // the last line tokenized
+  size_t max_tokens;
+  char *token_text;
+  size_t token_text_size;
+};
+
+// Depths whose continuation is precomputed; deeper ones are scanned for.
+#define BRANCH_BITS 32
+
 typedef struct {
   ms_token_t *items;
   size_t count;
   size_t cap;
+  char *text; // token texts back to back, the last one open for merging
+  size_t used;
+  size_t size;
 } tokens_t;
 
 static bool tokens_push(tokens_t *t, ms_token_kind_t kind, const char *text,
@@ -474,42 +620,25 @@ static bool tokens_push(tokens_t *t, ms_token_kind_t kind, const char *text,
   // Merge into the previous token when the kind matches.
   if (t->count && t->items[t->count - 1].kind == kind &&
       kind != MS_TOKEN_NOTE) {
-    ms_token_t *prev = &t->items[t->count - 1];
-    size_t prev_len = strlen(prev->text);
-    char *merged = realloc(prev->text, prev_len + len + 1);
-    if (!merged)
+    if (t->used + len > t->size)
       return false;
-    memcpy(merged + prev_len, text, len);
-    merged[prev_len + len] = '\0';
-    prev->text = merged;
+    memcpy(t->text + t->used - 1, text, len);
+    t->used += len;
+    t->text[t->used - 1] = '\0';
     return true;
   }
-  if (t->count == t->cap) {
-    size_t cap = t->cap ? t->cap * 2 : 8;
-    ms_token_t *items = realloc(t->items, cap * sizeof(*items));
-    if (!items)
-      return false;
-    t->items = items;
-    t->cap = cap;
-  }
-  char *copy = malloc(len + 1);
-  if (!copy)
+  if (t->count == t->cap || t->used + len + 1 > t->size)
     return false;
+  char *copy = t->text + t->used;
   memcpy(copy, text, len);
   copy[len] = '\0';
+  t->used += len + 1;
   t->items[t->count].kind = kind;
   t->items[t->count].text = copy;
   t->count++;
   return true;
 }
 
-static void tokens_destroy(tokens_t *t) {
-  for (size_t i = 0; i < t->count; i++)
-    free(t->items[i].text);
-  free(t->items);
-  memset(t, 0, sizeof(*t));
-}
-
 static bool is_ident_char(char c) {
   return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
 }
@@ -589,64 +718,207 @@ static bool tokenize_line(const char *s, tokens_t *out) {
   return true;
 }
 
-bool miniscript_policy_view_build(const char *policy, size_t max_line_width,
-                                  ms_policy_view_t *view) {
-  if (!view)
-    return false;
-  memset(view, 0, sizeof(*view));
+static size_t align_up(size_t n) {
+  const size_t a = sizeof(void *) > sizeof(uint32_t) ? sizeof(void *) : 4;
+  return (n + a - 1) & ~(a - 1);
+}
 
-  char *indented = miniscript_policy_indent(policy, max_line_width);
+ms_policy_view_t *miniscript_policy_view_build(const char *policy,
+                                               size_t max_line_width) {
+  size_t len;
+  char *indented = indent_expr(policy, max_line_width, &len);
   if (!indented)
-    return false;
+    return NULL;
 
   size_t num_lines = 1;
-  for (const char *p = indented; *p; p++)
-    if (*p == '\n')
-      num_lines++;
-  view->lines = calloc(num_lines, sizeof(*view->lines));
-  if (!view->lines) {
-    free(indented);
-    return false;
+  size_t longest = 0;
+  for (size_t start = 0, i = 0; i <= len; i++) {
+    if (i < len && indented[i] != '\n')
+      continue;
+    num_lines += (i < len);
+    if (i - start > longest)
+      longest = i - start;
+    start = i + 1;
   }
 
-  bool ok = true;
-  char *line = indented;
-  while (ok && line) {
-    char *next = strchr(line, '\n');
-    if (next)
-      *next++ = '\0';
+  // A token takes at least one character, except a note, which follows a
+  // timelock of at least eight and adds up to 24 bytes of its own.
+  size_t max_notes = longest / 8 + 1;
+  size_t max_tokens = longest + max_notes + 1;
+  size_t token_text_size = longest + max_tokens + max_notes * 24;
+
+  size_t lines_at = align_up(sizeof(ms_policy_view_t));
+  size_t tokens_at = align_up(lines_at + num_lines * sizeof(view_line_t));
+  size_t branches_at = align_up(tokens_at + max_tokens * sizeof(ms_token_t));
+  size_t text_at = branches_at + num_lines * sizeof(uint32_t);
+  size_t token_text_at = text_at + len + 1;
+  char *block = malloc(token_text_at + token_text_size);
+  if (!block) {
+    free(indented);
+    return NULL;
+  }
 
+  ms_policy_view_t *view = (ms_policy_view_t *)(void *)block;
+  view->refs = 1;
+  view->num_lines = num_lines;
+  view->lines = (view_line_t *)(void *)(block + lines_at);
+  view->tokens = (ms_token_t *)(void *)(block + tokens_at);
+  view->max_tokens = max_tokens;
+  view->branches = (uint32_t *)(void *)(block + branches_at);
+  view->text = block + text_at;
+  view->token_text = block + token_text_at;
+  view->token_text_size = token_text_size;
+
+  // Lines without their indentation, the depth kept instead.
+  char *p = view->text;
+  const char *line = indented;
+  for (size_t i = 0; i < num_lines; i++) {
+    const char *end = strchr(line, '\n');
+    if (!end)
+      end = indented + len;
     int level = 0;
     while (line[level] == ' ')
       level++;
-
-    tokens_t tokens = {0};
-    ok = tokenize_line(line + level, &tokens);
-    if (ok) {
-      ms_policy_line_t *out = &view->lines[view->num_lines++];
-      out->level = level;
-      out->tokens = tokens.items;
-      out->num_tokens = tokens.count;
-    } else {
-      tokens_destroy(&tokens);
-    }
-    line = next;
+    view->lines[i].off = (uint32_t)(p - view->text);
+    view->lines[i].level = level;
+    size_t n = (size_t)(end - line) - (size_t)level;
+    memcpy(p, line + level, n);
+    p[n] = '\0';
+    p += n + 1;
+    line = end + 1;
   }
   free(indented);
 
-  if (!ok)
-    miniscript_policy_view_free(view);
-  return ok;
+  // Branch continuation, from the bottom up: next[d] is the level of the
+  // first line below at or above depth d, -1 when there is none.
+  int next[BRANCH_BITS + 1];
+  for (int d = 0; d <= BRANCH_BITS; d++)
+    next[d] = -1;
+  for (size_t i = num_lines; i-- > 0;) {
+    uint32_t mask = 0;
+    for (int d = 1; d <= BRANCH_BITS; d++)
+      if (next[d] == d)
+        mask |= 1u << (d - 1);
+    view->branches[i] = mask;
+    int level = view->lines[i].level;
+    for (int d = level; d <= BRANCH_BITS; d++)
+      next[d] = level;
+  }
+  return view;
 }
 
-void miniscript_policy_view_free(ms_policy_view_t *view) {
+typedef struct {
+  char checksum[9];
+  size_t width;
+  /* Callers may hold the same descriptor's policy at different lengths (the
+   * loader's copy is cut short), so the text is part of the key too. */
+  size_t policy_len;
+  uint64_t policy_hash;
+  uint32_t last_used;
+  ms_policy_view_t *view; // NULL: slot free
+} view_cache_slot_t;
+
+static view_cache_slot_t view_cache[MINISCRIPT_POLICY_VIEW_CACHE_SLOTS];
+static uint32_t view_cache_clock = 0;
+
+/* FNV-1a over the policy text; also returns its length. */
+static uint64_t policy_text_hash(const char *policy, size_t *len_out) {
+  uint64_t h = 14695981039346656037ull;
+  size_t len = 0;
+  for (; policy[len]; len++)
+    h = (h ^ (uint8_t)policy[len]) * 1099511628211ull;
+  *len_out = len;
+  return h;
+}
+
+ms_policy_view_t *miniscript_policy_view_get(const char *checksum,
+                                             const char *policy,
+                                             size_t max_line_width) {
+  if (!checksum || !*checksum || !policy ||
+      strlen(checksum) >= sizeof(view_cache[0].checksum))
+    return miniscript_policy_view_build(policy, max_line_width);
+
+  size_t policy_len;
+  uint64_t policy_hash = policy_text_hash(policy, &policy_len);
+  view_cache_slot_t *slot = &view_cache[0];
+  for (int i = 0; i < MINISCRIPT_POLICY_VIEW_CACHE_SLOTS; i++) {
+    view_cache_slot_t *s = &view_cache[i];
+    if (s->view && s->width == max_line_width &&
+        s->policy_len == policy_len && s->policy_hash == policy_hash &&
+        strcmp(s->checksum, checksum) == 0) {
+      s->last_used = ++view_cache_clock;
+      s->view->refs++;
+      return s->view;
+    }
+    if (slot->view && (!s->view || s->last_used < slot->last_used))
+      slot = s;
+  }
+
+  ms_policy_view_t *view = miniscript_policy_view_build(policy, max_line_width);
   if (!view)
-    return;
-  for (size_t i = 0; i < view->num_lines; i++) {
-    for (size_t j = 0; j < view->lines[i].num_tokens; j++)
-      free(view->lines[i].tokens[j].text);
-    free(view->lines[i].tokens);
+    return NULL;
+  miniscript_policy_view_release(slot->view);
+  strcpy(slot->checksum, checksum);
+  slot->width = max_line_width;
+  slot->policy_len = policy_len;
+  slot->policy_hash = policy_hash;
+  slot->last_used = ++view_cache_clock;
+  slot->view = view;
+  view->refs++;
+  return view;
+}
+
+void miniscript_policy_view_release(ms_policy_view_t *view) {
+  if (view && --view->refs == 0)
+    free(view);
+}
+
+void miniscript_policy_view_cache_clear(void) {
+  for (int i = 0; i < MINISCRIPT_POLICY_VIEW_CACHE_SLOTS; i++) {
+    miniscript_policy_view_release(view_cache[i].view);
+    memset(&view_cache[i], 0, sizeof(view_cache[i]));
   }
-  free(view->lines);
-  memset(view, 0, sizeof(*view));
+}
+
+size_t miniscript_policy_view_num_lines(const ms_policy_view_t *view) {
+  return view ? view->num_lines : 0;
+}
+
+int miniscript_policy_view_level(const ms_policy_view_t *view, size_t index) {
+  if (!view || index >= view->num_lines)
+    return -1;
+  return view->lines[index].level;
+}
+
+bool miniscript_policy_view_continues(const ms_policy_view_t *view,
+                                      size_t index, int depth) {
+  if (!view || index >= view->num_lines || depth < 1)
+    return false;
+  if (depth <= BRANCH_BITS)
+    return (view->branches[index] >> (depth - 1)) & 1u;
+  for (size_t j = index + 1; j < view->num_lines; j++) {
+    if (view->lines[j].level < depth)
+      return false;
+    if (view->lines[j].level == depth)
+      return true;
+  }
+  return false;
+}
+
+bool miniscript_policy_view_line(ms_policy_view_t *view, size_t index,
+                                 ms_policy_line_t *line) {
+  if (!view || !line || index >= view->num_lines)
+    return false;
+  tokens_t tokens = {
+      .items = view->tokens,
+      .cap = view->max_tokens,
+      .text = view->token_text,
+      .size = view->token_text_size,
+  };
+  if (!tokenize_line(view->text + view->lines[index].off, &tokens))
+    return false;
+  line->level = view->lines[index].level;
+  line->tokens = view->tokens;
+  line->num_tokens = tokens.count;
+  return true;
 }
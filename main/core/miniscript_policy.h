@@ -38,27 +38,63 @@ typedef enum {
 
 typedef struct {
   ms_token_kind_t kind;
-  char *text;
+  const char *text;
 } ms_token_t;
 
 typedef struct {
   int level; // indentation depth
-  ms_token_t *tokens;
+  const ms_token_t *tokens;
   size_t num_tokens;
 } ms_policy_line_t;
 
-typedef struct {
-  ms_policy_line_t *lines;
-  size_t num_lines;
-} ms_policy_view_t;
-
-/* Indent `policy` (see miniscript_policy_indent) and split it into lines of
- * classified tokens for styled rendering. Timelocks get a NOTE token with an
- * approximate duration (older) or UTC date (after, when it is a timestamp).
- * Free with miniscript_policy_view_free. */
+/* Indented policy, split into lines that are tokenized on demand. One
+ * allocation holds the line table, the line text and the scratch the current
+ * line is tokenized into, so a screen showing a few lines of a large policy
+ * only ever classifies those. */
+typedef struct ms_policy_view ms_policy_view_t;
+
+/* Indent `policy` (see miniscript_policy_indent) into a view holding one
+ * reference, or NULL on failure. Drop it with
+ * miniscript_policy_view_release. */
+KERN_WARN_UNUSED_RESULT ms_policy_view_t *
+miniscript_policy_view_build(const char *policy, size_t max_line_width);
+
+/* Views kept by miniscript_policy_view_get; the least recently used goes
+ * first. */
+#define MINISCRIPT_POLICY_VIEW_CACHE_SLOTS 4
+
+/* Like miniscript_policy_view_build, but shared: a view built earlier for the
+ * same descriptor checksum, policy text and width is returned with another
+ * reference instead of being rebuilt. An empty or NULL checksum builds an
+ * uncached view.
+ * Not thread-safe: the cache belongs to the LVGL task. */
+KERN_WARN_UNUSED_RESULT ms_policy_view_t *
+miniscript_policy_view_get(const char *checksum, const char *policy,
+                           size_t max_line_width);
+
+void miniscript_policy_view_release(ms_policy_view_t *view);
+
+/* Drops the cache's references; views still held elsewhere stay valid.
+ * wallet_cleanup() calls it, so no policy outlives the session. */
+void miniscript_policy_view_cache_clear(void);
+
+size_t miniscript_policy_view_num_lines(const ms_policy_view_t *view);
+
+/* Indentation depth of line `index`, or -1 when out of range. */
+int miniscript_policy_view_level(const ms_policy_view_t *view, size_t index);
+
+/* Whether the branch at `depth` (1 = children of the top-level fragment)
+ * has another line after line `index` before a shallower line closes it, i.e.
+ * whether a tree guide at that depth keeps descending past the line. */
+bool miniscript_policy_view_continues(const ms_policy_view_t *view,
+                                      size_t index, int depth);
+
+/* Tokenize line `index` for styled rendering. Timelocks get a NOTE token with
+ * an approximate duration (older) or UTC date (after, when it is a
+ * timestamp). The tokens live in the view and stay valid until the next call
+ * on the same view. */
 KERN_WARN_UNUSED_RESULT bool
-miniscript_policy_view_build(const char *policy, size_t max_line_width,
-                             ms_policy_view_t *view);
-void miniscript_policy_view_free(ms_policy_view_t *view);
+miniscript_policy_view_line(ms_policy_view_t *view, size_t index,
+                            ms_policy_line_t *line);
 
 #endif // MINISCRIPT_POLICY_H
@@ -1,6 +1,7 @@
 // PIN authentication with split-PIN anti-phishing
 
 #include "pin.h"
+#include "../utils/power_gov.h"
 #include "../utils/secure_mem.h"
 #include "crypto_utils.h"
 #include "settings.h"
@@ -235,8 +236,10 @@ esp_err_t pin_setup(const char *pin, size_t len, uint8_t split_pos) {
     return err;
 
   uint8_t hash[PIN_HASH_SIZE];
+  power_gov_acquire(POWER_ACT_KDF);
   int rc = crypto_pbkdf2_sha256((const uint8_t *)pin, len, salt, sizeof(salt),
                                 PIN_PBKDF2_ITERATIONS, hash, PIN_HASH_SIZE);
+  power_gov_release(POWER_ACT_KDF);
   secure_memzero(salt, sizeof(salt));
   if (rc != CRYPTO_OK) {
     secure_memzero(hash, sizeof(hash));
@@ -295,9 +298,11 @@ pin_verify_result_t pin_verify(const char *pin, size_t len) {
   }
 
   uint8_t attempt_hash[PIN_HASH_SIZE];
+  power_gov_acquire(POWER_ACT_KDF);
   int rc =
       crypto_pbkdf2_sha256((const uint8_t *)pin, len, salt, sizeof(salt),
                            PIN_PBKDF2_ITERATIONS, attempt_hash, PIN_HASH_SIZE);
+  power_gov_release(POWER_ACT_KDF);
   secure_memzero(salt, sizeof(salt));
   if (rc != CRYPTO_OK) {
     secure_memzero(attempt_hash, sizeof(attempt_hash));
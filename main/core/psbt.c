@@ -4,6 +4,8 @@
 #include "psbt_internal.h"
 #include "script_templates.h"
 #include "wallet.h"
+#include "../utils/arena.h"
+#include "../utils/perf.h"
 #include <esp_log.h>
 #include <stdlib.h>
 #include <string.h>
@@ -322,8 +324,10 @@ PSBT_PRIVATE bool claim_regenerate(const claim_t *claim, bool is_testnet,
   memcpy(out->spk, out->witness, spk_work_len);
   out->spk_len = spk_work_len;
 
-  size_t spk_type = 0;
-  wally_scriptpubkey_get_type(out->spk, out->spk_len, &spk_type);
+  /* The output type is fixed per descriptor and cached on the entry. */
+  size_t spk_type = e->script_type;
+  if (spk_type == WALLY_SCRIPT_TYPE_UNKNOWN)
+    wally_scriptpubkey_get_type(out->spk, out->spk_len, &spk_type);
 
   if (spk_type == WALLY_SCRIPT_TYPE_P2WSH) {
     if (wally_descriptor_to_script(e->desc, 1, 0, 0, mi, cn, 0, out->witness,
@@ -938,6 +942,7 @@ size_t psbt_sign(struct wally_psbt *psbt, bool is_testnet,
     ESP_LOGE(TAG, "Invalid PSBT");
     return 0;
   }
+  PERF_BEGIN(psbt_sign);
 
   size_t num_inputs = 0;
   if (wally_psbt_get_num_inputs(psbt, &num_inputs) != WALLY_OK || !num_inputs) {
@@ -945,7 +950,11 @@ size_t psbt_sign(struct wally_psbt *psbt, bool is_testnet,
     return 0;
   }
 
-  input_plan_t *plan = calloc(num_inputs, sizeof(*plan));
+  /* The plan (ownership claims, key paths, snapshots) lives in an arena sized
+   * to hold it in one chunk, and is wiped with it. */
+  arena_t arena;
+  arena_init(&arena, num_inputs * sizeof(input_plan_t), ARENA_MEM_DEFAULT);
+  input_plan_t *plan = arena_calloc(&arena, num_inputs, sizeof(*plan));
   if (!plan) {
     ESP_LOGE(TAG, "Out of memory classifying %zu inputs", num_inputs);
     return 0;
@@ -1035,8 +1044,10 @@ size_t psbt_sign(struct wally_psbt *psbt, bool is_testnet,
 cleanup:
   for (size_t i = 0; i < num_inputs; i++)
     release_input_state(&plan[i]);
-  free(plan);
+  arena_destroy(&arena);
 
+  PERF_END(psbt_sign);
+  PERF_ADD(PERF_CTR_SIGNATURES, signatures_added);
   return signatures_added;
 }
 
@@ -1061,7 +1072,13 @@ struct wally_psbt *psbt_trim(const struct wally_psbt *psbt) {
   size_t num_inputs = 0;
   wally_psbt_get_num_inputs(psbt, &num_inputs);
 
+  /* Script buffers for one input are scratch, wiped before the next. */
+  arena_t arena;
+  arena_init(&arena, 0, ARENA_MEM_DEFAULT);
+
   for (size_t i = 0; i < num_inputs; i++) {
+    arena_reset(&arena);
+
     // Copy partial signatures using direct map access
     size_t sigs_size = 0;
     if (wally_psbt_get_input_signatures_size(psbt, i, &sigs_size) == WALLY_OK &&
@@ -1092,14 +1109,13 @@ struct wally_psbt *psbt_trim(const struct wally_psbt *psbt) {
     if (wally_psbt_get_input_final_scriptsig_len(psbt, i, &scriptsig_len) ==
             WALLY_OK &&
         scriptsig_len > 0) {
-      unsigned char *scriptsig = malloc(scriptsig_len);
+      unsigned char *scriptsig = arena_alloc(&arena, scriptsig_len);
       if (scriptsig) {
         size_t written = 0;
         if (wally_psbt_get_input_final_scriptsig(
                 psbt, i, scriptsig, scriptsig_len, &written) == WALLY_OK) {
           wally_psbt_set_input_final_scriptsig(trimmed, i, scriptsig, written);
         }
-        free(scriptsig);
       }
     }
 
@@ -1124,14 +1140,13 @@ struct wally_psbt *psbt_trim(const struct wally_psbt *psbt) {
     if (wally_psbt_get_input_redeem_script_len(psbt, i, &redeem_len) ==
             WALLY_OK &&
         redeem_len > 0) {
-      unsigned char *redeem = malloc(redeem_len);
+      unsigned char *redeem = arena_alloc(&arena, redeem_len);
       if (redeem) {
         size_t written = 0;
         if (wally_psbt_get_input_redeem_script(psbt, i, redeem, redeem_len,
                                                &written) == WALLY_OK) {
           wally_psbt_set_input_redeem_script(trimmed, i, redeem, written);
         }
-        free(redeem);
       }
     }
 
@@ -1140,7 +1155,7 @@ struct wally_psbt *psbt_trim(const struct wally_psbt *psbt) {
     if (wally_psbt_get_input_witness_script_len(psbt, i, &witness_script_len) ==
             WALLY_OK &&
         witness_script_len > 0) {
-      unsigned char *witness_script = malloc(witness_script_len);
+      unsigned char *witness_script = arena_alloc(&arena, witness_script_len);
       if (witness_script) {
         size_t written = 0;
         if (wally_psbt_get_input_witness_script(psbt, i, witness_script,
@@ -1149,7 +1164,6 @@ struct wally_psbt *psbt_trim(const struct wally_psbt *psbt) {
           wally_psbt_set_input_witness_script(trimmed, i, witness_script,
                                               written);
         }
-        free(witness_script);
       }
     }
 
@@ -1180,6 +1194,7 @@ struct wally_psbt *psbt_trim(const struct wally_psbt *psbt) {
       }
     }
   }
+  arena_destroy(&arena);
 
   return trimmed;
 }
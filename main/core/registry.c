@@ -1,19 +1,45 @@
 #include "registry.h"
 #include "bip32_path.h"
 #include "descriptor_checksum.h"
+#include "descriptor_parse.h"
 #include "key.h"
 #include "wallet.h"
+#include <esp_heap_caps.h>
 #include <esp_log.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wally_address.h>
 #include <wally_bip32.h>
 #include <wally_descriptor.h>
+#include <wally_script.h>
 
 static const char *TAG = "registry";
 
-static registry_entry_t registry_entries[REGISTRY_MAX_ENTRIES];
+#define REGISTRY_INITIAL_CAPACITY 8
+#define REGISTRY_NO_ENTRY (-1)
+
+/* Each entry lives in its own PSRAM allocation, so the pointers handed out by
+ * registry_get() and registry_match_keypath() stay valid while the table
+ * around them grows or other entries are removed. The node carries the
+ * hashes and chain links of the two lookup indexes. */
+typedef struct {
+  registry_entry_t entry;
+  uint32_t origin_hash;
+  uint32_t checksum_hash;
+  int32_t next_same_origin;   // Next entry index in this origin bucket
+  int32_t next_same_checksum; // Next entry index in this checksum bucket
+} registry_node_t;
+
+static registry_node_t **registry_nodes = NULL;
 static size_t registry_len = 0;
+static size_t registry_cap = 0;
+
+/* Hash buckets (power of two, at least twice the capacity) heading chains of
+ * entry indexes in ascending order: one keyed by the origin path of our key,
+ * one by the normalized checksum. */
+static int32_t *origin_buckets = NULL;
+static int32_t *checksum_buckets = NULL;
+static size_t bucket_count = 0;
 
 /* Descriptor registration is intentionally disabled for now. Descriptor
  * storage stays available as explicit backup/import, but boot must not treat
@@ -21,18 +47,127 @@ static size_t registry_len = 0;
  * to the descriptor's own public keys (bitcoin/bips#1951). */
 #define REGISTRY_AUTOLOAD_DESCRIPTORS 0
 
+/* FNV-1a, over the little-endian bytes of the path components so a keypath
+ * read straight from a PSBT hashes the same as a parsed origin path. */
+static uint32_t hash_bytes(uint32_t h, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    h ^= data[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+#define HASH_SEED 2166136261u
+
+static uint32_t hash_origin_path(const uint32_t *path, size_t len) {
+  uint32_t h = HASH_SEED;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t le[4] = {(uint8_t)path[i], (uint8_t)(path[i] >> 8),
+                     (uint8_t)(path[i] >> 16), (uint8_t)(path[i] >> 24)};
+    h = hash_bytes(h, le, sizeof(le));
+  }
+  return h;
+}
+
+static uint32_t hash_checksum(const char *checksum) {
+  return hash_bytes(HASH_SEED, (const uint8_t *)checksum, strlen(checksum));
+}
+
+static registry_entry_t *entry_at(size_t i) {
+  return &registry_nodes[i]->entry;
+}
+
+/* Appends entry i to the tail of its bucket chain; entries are linked in
+ * index order, so walks return the lowest matching index first. */
+static void chain_append(int32_t *buckets, size_t i, uint32_t hash,
+                         bool by_origin) {
+  int32_t *link = &buckets[hash & (bucket_count - 1)];
+  while (*link != REGISTRY_NO_ENTRY) {
+    registry_node_t *n = registry_nodes[*link];
+    link = by_origin ? &n->next_same_origin : &n->next_same_checksum;
+  }
+  *link = (int32_t)i;
+}
+
+static void index_entry(size_t i) {
+  registry_node_t *node = registry_nodes[i];
+  node->next_same_origin = REGISTRY_NO_ENTRY;
+  node->next_same_checksum = REGISTRY_NO_ENTRY;
+  chain_append(origin_buckets, i, node->origin_hash, true);
+  if (node->entry.checksum[0] != '\0')
+    chain_append(checksum_buckets, i, node->checksum_hash, false);
+}
+
+static void rebuild_index(void) {
+  for (size_t b = 0; b < bucket_count; b++) {
+    origin_buckets[b] = REGISTRY_NO_ENTRY;
+    checksum_buckets[b] = REGISTRY_NO_ENTRY;
+  }
+  for (size_t i = 0; i < registry_len; i++)
+    index_entry(i);
+}
+
+/* Makes room for one more entry, growing the node table and re-hashing into
+ * larger buckets as needed. */
+static bool reserve_entry(void) {
+  if (registry_len < registry_cap)
+    return true;
+  if (registry_cap >= REGISTRY_MAX_ENTRIES) {
+    ESP_LOGE(TAG, "registry full (%d entries)", REGISTRY_MAX_ENTRIES);
+    return false;
+  }
+
+  size_t cap = registry_cap ? registry_cap * 2 : REGISTRY_INITIAL_CAPACITY;
+  if (cap > REGISTRY_MAX_ENTRIES)
+    cap = REGISTRY_MAX_ENTRIES;
+
+  registry_node_t **nodes = heap_caps_realloc(
+      registry_nodes, cap * sizeof(registry_node_t *), MALLOC_CAP_SPIRAM);
+  if (!nodes)
+    return false;
+  registry_nodes = nodes;
+
+  size_t buckets = 1;
+  while (buckets < cap * 2)
+    buckets <<= 1;
+  int32_t *origin = heap_caps_malloc(buckets * sizeof(int32_t),
+                                     MALLOC_CAP_SPIRAM);
+  int32_t *checksum = heap_caps_malloc(buckets * sizeof(int32_t),
+                                       MALLOC_CAP_SPIRAM);
+  if (!origin || !checksum) {
+    heap_caps_free(origin);
+    heap_caps_free(checksum);
+    return false;
+  }
+  heap_caps_free(origin_buckets);
+  heap_caps_free(checksum_buckets);
+  origin_buckets = origin;
+  checksum_buckets = checksum;
+  bucket_count = buckets;
+  registry_cap = cap;
+
+  rebuild_index();
+  return true;
+}
+
+static void free_node(registry_node_t *node) {
+  if (node->entry.desc != NULL)
+    wally_descriptor_free(node->entry.desc);
+  heap_caps_free(node);
+}
+
 size_t registry_count(void) { return registry_len; }
 
 const registry_entry_t *registry_get(size_t i) {
   if (i >= registry_len)
     return NULL;
-  return &registry_entries[i];
+  return entry_at(i);
 }
 
 const registry_entry_t *registry_find_by_id(const char *id) {
   for (size_t i = 0; i < registry_len; i++) {
-    if (strncmp(registry_entries[i].id, id, REGISTRY_ID_MAX_LEN) == 0) {
-      return &registry_entries[i];
+    if (strncmp(entry_at(i)->id, id, REGISTRY_ID_MAX_LEN) == 0) {
+      return entry_at(i);
     }
   }
   return NULL;
@@ -42,9 +177,10 @@ bool registry_set_label(const char *id, const char *label) {
   if (!id || !label)
     return false;
   for (size_t i = 0; i < registry_len; i++) {
-    if (strncmp(registry_entries[i].id, id, REGISTRY_ID_MAX_LEN) == 0) {
-      strncpy(registry_entries[i].label, label, REGISTRY_LABEL_MAX_LEN - 1);
-      registry_entries[i].label[REGISTRY_LABEL_MAX_LEN - 1] = '\0';
+    registry_entry_t *e = entry_at(i);
+    if (strncmp(e->id, id, REGISTRY_ID_MAX_LEN) == 0) {
+      strncpy(e->label, label, REGISTRY_LABEL_MAX_LEN - 1);
+      e->label[REGISTRY_LABEL_MAX_LEN - 1] = '\0';
       return true;
     }
   }
@@ -56,7 +192,7 @@ bool registry_remove(const char *id) {
     return false;
   size_t idx = registry_len; // sentinel: "not found"
   for (size_t i = 0; i < registry_len; i++) {
-    if (strncmp(registry_entries[i].id, id, REGISTRY_ID_MAX_LEN) == 0) {
+    if (strncmp(entry_at(i)->id, id, REGISTRY_ID_MAX_LEN) == 0) {
       idx = i;
       break;
     }
@@ -66,40 +202,42 @@ bool registry_remove(const char *id) {
     return false;
   }
 
-  if (registry_entries[idx].desc != NULL) {
-    wally_descriptor_free(registry_entries[idx].desc);
-    registry_entries[idx].desc = NULL;
-  }
-
+  registry_entry_t *e = entry_at(idx);
   esp_err_t err = ESP_OK;
-  if (registry_entries[idx].persisted) {
-    err = storage_delete_descriptor(registry_entries[idx].loc,
-                                    registry_entries[idx].id);
+  if (e->persisted) {
+    err = storage_delete_descriptor(e->loc, e->id);
     if (err != ESP_OK) {
       ESP_LOGE(TAG, "registry_remove: storage_delete_descriptor failed (%d)",
                err);
     }
   }
 
+  free_node(registry_nodes[idx]);
   if (idx < registry_len - 1) {
-    memmove(&registry_entries[idx], &registry_entries[idx + 1],
-            (registry_len - idx - 1) * sizeof(registry_entry_t));
+    memmove(&registry_nodes[idx], &registry_nodes[idx + 1],
+            (registry_len - idx - 1) * sizeof(registry_node_t *));
   }
-
-  memset(&registry_entries[registry_len - 1], 0, sizeof(registry_entry_t));
   registry_len--;
+  registry_nodes[registry_len] = NULL;
+
+  // Later entries shifted down one index
+  rebuild_index();
 
   return (err == ESP_OK);
 }
 
 void registry_clear(void) {
-  for (size_t i = 0; i < registry_len; i++) {
-    if (registry_entries[i].desc != NULL) {
-      wally_descriptor_free(registry_entries[i].desc);
-    }
-  }
-  memset(registry_entries, 0, sizeof registry_entries);
+  for (size_t i = 0; i < registry_len; i++)
+    free_node(registry_nodes[i]);
+  heap_caps_free(registry_nodes);
+  heap_caps_free(origin_buckets);
+  heap_caps_free(checksum_buckets);
+  registry_nodes = NULL;
+  origin_buckets = NULL;
+  checksum_buckets = NULL;
   registry_len = 0;
+  registry_cap = 0;
+  bucket_count = 0;
 }
 
 static void registry_init_scan(storage_location_t loc) {
@@ -151,28 +289,6 @@ void registry_init(bool is_testnet) {
   ESP_LOGI(TAG, "Registry: %zu entries loaded", registry_len);
 }
 
-/* Compute the h-normalized BIP-380 checksum of a descriptor string by parsing
- * it on either network. Caller frees via free. NULL on failure. */
-static char *descriptor_checksum_alloc(const char *descriptor_str) {
-  if (!descriptor_str)
-    return NULL;
-  uint32_t net = (wallet_get_network() == WALLET_NETWORK_MAINNET)
-                     ? WALLY_NETWORK_BITCOIN_MAINNET
-                     : WALLY_NETWORK_BITCOIN_TESTNET;
-  struct wally_descriptor *desc = NULL;
-  if (wallet_descriptor_parse(descriptor_str, NULL, net, &desc) != WALLY_OK) {
-    net = (net == WALLY_NETWORK_BITCOIN_MAINNET)
-              ? WALLY_NETWORK_BITCOIN_TESTNET
-              : WALLY_NETWORK_BITCOIN_MAINNET;
-    if (wallet_descriptor_parse(descriptor_str, NULL, net, &desc) != WALLY_OK)
-      return NULL;
-  }
-  char checksum[9];
-  bool ok = descriptor_checksum_from_descriptor(desc, checksum);
-  wally_descriptor_free(desc);
-  return ok ? strdup(checksum) : NULL;
-}
-
 bool registry_session_has_duplicate(const char *descriptor_str, char *out_id,
                                     size_t out_id_size) {
   if (out_id && out_id_size > 0)
@@ -180,13 +296,14 @@ bool registry_session_has_duplicate(const char *descriptor_str, char *out_id,
   if (!descriptor_str)
     return false;
 
-  char *target = descriptor_checksum_alloc(descriptor_str);
-  if (!target)
+  descriptor_parsed_t parsed;
+  if (descriptor_parse_once(descriptor_str, wallet_get_network(), &parsed) !=
+      WALLY_OK)
     return false;
-
-  bool found =
-      registry_session_has_duplicate_checksum(target, out_id, out_id_size);
-  free(target);
+  const char *target = descriptor_parsed_checksum(&parsed);
+  bool found = target && registry_session_has_duplicate_checksum(
+                             target, out_id, out_id_size);
+  descriptor_parsed_free(&parsed);
   return found;
 }
 
@@ -197,25 +314,21 @@ bool registry_session_has_duplicate_checksum(const char checksum[9],
   if (!checksum || checksum[0] == '\0')
     return false;
 
-  bool found = false;
-  for (size_t i = 0; i < registry_len; i++) {
-    char entry_cksum[9];
-    if (registry_entries[i].desc &&
-        descriptor_checksum_from_descriptor(registry_entries[i].desc,
-                                            entry_cksum)) {
-      if (strcmp(entry_cksum, checksum) == 0) {
-        found = true;
-        if (out_id && out_id_size > 0) {
-          strncpy(out_id, registry_entries[i].id, out_id_size - 1);
-          out_id[out_id_size - 1] = '\0';
-        }
-      }
-      if (found)
-        break;
+  if (registry_len == 0)
+    return false;
+
+  int32_t i = checksum_buckets[hash_checksum(checksum) & (bucket_count - 1)];
+  for (; i != REGISTRY_NO_ENTRY; i = registry_nodes[i]->next_same_checksum) {
+    const registry_entry_t *e = entry_at((size_t)i);
+    if (strcmp(e->checksum, checksum) != 0)
+      continue;
+    if (out_id && out_id_size > 0) {
+      strncpy(out_id, e->id, out_id_size - 1);
+      out_id[out_id_size - 1] = '\0';
     }
+    return true;
   }
-
-  return found;
+  return false;
 }
 
 registry_entry_t *registry_match_keypath(const uint8_t *keypath,
@@ -231,41 +344,112 @@ registry_entry_t *registry_match_keypath(const uint8_t *keypath,
   if (total_depth > MAX_KEYPATH_TOTAL_DEPTH)
     return NULL;
 
-  for (size_t i = *cursor; i < registry_len; i++) {
-    registry_entry_t *e = &registry_entries[i];
-    if (e->origin_path_len > total_depth)
-      continue;
-    bool origin_matches = true;
-    for (size_t j = 0; j < e->origin_path_len; j++) {
-      if (bip32_path_u32_le(keypath + 4 + j * 4) != e->origin_path[j]) {
-        origin_matches = false;
-        break;
-      }
-    }
-    if (!origin_matches)
-      continue;
-    size_t tail_depth = total_depth - e->origin_path_len;
-    if (tail_depth != MAX_KEYPATH_TAIL_DEPTH)
-      continue;
-    const uint8_t *tail = keypath + 4 + e->origin_path_len * 4;
-    uint32_t mp = bip32_path_u32_le(tail);
-    uint32_t ix = bip32_path_u32_le(tail + 4);
-    if (bip32_path_is_hardened(mp))
-      continue;
-    if (bip32_path_is_hardened(ix))
+  if (total_depth < MAX_KEYPATH_TAIL_DEPTH || registry_len == 0)
+    return NULL;
+
+  /* Only an origin of exactly total_depth - 2 components can leave the
+   * mandatory <multipath>/<index> tail, so that prefix is the lookup key. */
+  size_t origin_len = total_depth - MAX_KEYPATH_TAIL_DEPTH;
+  if (origin_len > MAX_KEYPATH_ORIGIN_DEPTH)
+    return NULL;
+  uint32_t origin[MAX_KEYPATH_ORIGIN_DEPTH];
+  for (size_t j = 0; j < origin_len; j++)
+    origin[j] = bip32_path_u32_le(keypath + 4 + j * 4);
+
+  const uint8_t *tail = keypath + 4 + origin_len * 4;
+  uint32_t mp = bip32_path_u32_le(tail);
+  uint32_t ix = bip32_path_u32_le(tail + 4);
+  if (bip32_path_is_hardened(mp) || bip32_path_is_hardened(ix) || mp > 1)
+    return NULL;
+
+  uint32_t hash = hash_origin_path(origin, origin_len);
+  int32_t i = origin_buckets[hash & (bucket_count - 1)];
+  for (; i != REGISTRY_NO_ENTRY; i = registry_nodes[i]->next_same_origin) {
+    if ((size_t)i < *cursor)
       continue;
-    if (mp > 1)
+    registry_entry_t *e = entry_at((size_t)i);
+    if (e->origin_path_len != origin_len ||
+        memcmp(e->origin_path, origin, origin_len * sizeof(uint32_t)) != 0)
       continue;
     if (e->num_paths == 1 && mp != 0)
       continue;
-    *cursor = i + 1;
+    *cursor = (size_t)i + 1;
     return e;
   }
   return NULL;
 }
 
-bool registry_add_from_string(const char *id, const char *descriptor_str,
-                              storage_location_t loc, bool persist) {
+/* Fills the derived metadata of a freshly parsed entry: its normalized
+ * checksum (unless the caller already had it) and the script type its
+ * outputs use. */
+static void entry_compute_metadata(registry_entry_t *e) {
+  if (e->checksum[0] == '\0' &&
+      !descriptor_checksum_from_descriptor(e->desc, e->checksum))
+    e->checksum[0] = '\0';
+
+  /* libwally builds the inner script in the output buffer before hashing it
+   * and reports a too-small buffer as the length it needed, so wrapped
+   * scripts get a second pass with a buffer of that size. */
+  unsigned char spk_buf[WALLY_SCRIPTPUBKEY_P2WSH_LEN];
+  unsigned char *spk = spk_buf;
+  size_t spk_len = 0;
+  size_t type = WALLY_SCRIPT_TYPE_UNKNOWN;
+  if (wally_descriptor_to_script(e->desc, 0, 0, 0, 0, 0, 0, spk,
+                                 sizeof(spk_buf), &spk_len) == WALLY_OK &&
+      spk_len > sizeof(spk_buf)) {
+    size_t needed = spk_len;
+    spk = malloc(needed);
+    if (!spk ||
+        wally_descriptor_to_script(e->desc, 0, 0, 0, 0, 0, 0, spk, needed,
+                                   &spk_len) != WALLY_OK ||
+        spk_len > needed)
+      spk_len = 0;
+  }
+  if (spk && spk_len > 0)
+    wally_scriptpubkey_get_type(spk, spk_len, &type);
+  if (spk != spk_buf)
+    free(spk);
+  e->script_type = type;
+}
+
+/* Allocates the next entry slot and links it into the indexes once the
+ * caller has filled it. */
+static registry_entry_t *append_entry(struct wally_descriptor *desc,
+                                      const char *id) {
+  if (!reserve_entry())
+    return NULL;
+  registry_node_t *node =
+      heap_caps_calloc(1, sizeof(registry_node_t), MALLOC_CAP_SPIRAM);
+  if (!node)
+    return NULL;
+
+  registry_entry_t *e = &node->entry;
+  strncpy(e->id, id, REGISTRY_ID_MAX_LEN - 1);
+  e->desc = desc;
+  registry_nodes[registry_len] = node;
+  return e;
+}
+
+static void commit_entry(void) {
+  registry_node_t *node = registry_nodes[registry_len];
+  registry_entry_t *e = &node->entry;
+  entry_compute_metadata(e);
+  node->origin_hash = hash_origin_path(e->origin_path, e->origin_path_len);
+  node->checksum_hash = hash_checksum(e->checksum);
+  index_entry(registry_len);
+  registry_len++;
+}
+
+/* Drops the most recently committed entry (used when persisting it fails). */
+static void rollback_last_entry(void) {
+  registry_len--;
+  free_node(registry_nodes[registry_len]);
+  registry_nodes[registry_len] = NULL;
+  rebuild_index();
+}
+
+/* Checks shared by every add before the descriptor is looked at. */
+static bool can_add_entry(const char *id, const char *descriptor_str) {
   if (!id || !descriptor_str)
     return false;
   if (descriptor_text_has_uppercase_hardened(descriptor_str)) {
@@ -276,18 +460,17 @@ bool registry_add_from_string(const char *id, const char *descriptor_str,
     ESP_LOGE(TAG, "registry full (%d entries)", REGISTRY_MAX_ENTRIES);
     return false;
   }
+  return true;
+}
 
-  /* Wallet's network only. Wrong-network descriptors are skipped on
-   * boot scan; the validator blocks them on the user load path. */
-  uint32_t wally_network = (wallet_get_network() == WALLET_NETWORK_MAINNET)
-                               ? WALLY_NETWORK_BITCOIN_MAINNET
-                               : WALLY_NETWORK_BITCOIN_TESTNET;
-  struct wally_descriptor *desc = NULL;
-  int ret = wallet_descriptor_parse(descriptor_str, NULL, wally_network, &desc);
-  if (ret != WALLY_OK) {
-    ESP_LOGE(TAG, "failed to parse descriptor: %d", ret);
-    return false;
-  }
+/* Registers a parsed descriptor that must contain our key. Takes ownership of
+ * parsed->desc whatever the outcome; a checksum already in `parsed` is reused
+ * rather than recomputed. */
+static bool add_keyed_entry(const char *id, const char *descriptor_str,
+                            descriptor_parsed_t *parsed,
+                            storage_location_t loc, bool persist) {
+  struct wally_descriptor *desc = parsed->desc;
+  parsed->desc = NULL;
 
   unsigned char wallet_fp[BIP32_KEY_FINGERPRINT_LEN];
   if (!key_get_fingerprint(wallet_fp)) {
@@ -341,16 +524,18 @@ bool registry_add_from_string(const char *id, const char *descriptor_str,
     return false;
   }
 
-  registry_entry_t *e = &registry_entries[registry_len];
-  memset(e, 0, sizeof *e);
-  strncpy(e->id, id, REGISTRY_ID_MAX_LEN - 1);
+  registry_entry_t *e = append_entry(desc, id);
+  if (!e) {
+    wally_descriptor_free(desc);
+    return false;
+  }
   e->loc = loc;
-  e->desc = desc;
   e->my_key_index = (size_t)key_index;
   e->num_paths = (size_t)num_paths;
   e->origin_path_len = origin_path_len;
   memcpy(e->origin_path, origin_path, origin_path_len * sizeof(uint32_t));
-  registry_len++;
+  memcpy(e->checksum, parsed->checksum, sizeof(e->checksum));
+  commit_entry();
 
   if (persist) {
     esp_err_t err =
@@ -358,9 +543,7 @@ bool registry_add_from_string(const char *id, const char *descriptor_str,
                                 strlen(descriptor_str), false);
     if (err != ESP_OK) {
       ESP_LOGE(TAG, "storage_save_descriptor failed (%d), rolling back", err);
-      wally_descriptor_free(desc);
-      memset(&registry_entries[registry_len - 1], 0, sizeof(registry_entry_t));
-      registry_len--;
+      rollback_last_entry();
       return false;
     }
     e->persisted = true;
@@ -370,28 +553,46 @@ bool registry_add_from_string(const char *id, const char *descriptor_str,
   return true;
 }
 
-bool registry_add_watch_only(const char *id, const char *descriptor_str,
-                             wallet_network_t network) {
-  if (!id || !descriptor_str)
+bool registry_add_from_string(const char *id, const char *descriptor_str,
+                              storage_location_t loc, bool persist) {
+  if (!can_add_entry(id, descriptor_str))
     return false;
-  if (descriptor_text_has_uppercase_hardened(descriptor_str)) {
-    ESP_LOGE(TAG, "descriptor uses 'H' hardened marker (not accepted)");
+
+  /* Wallet's network only. Wrong-network descriptors are skipped on
+   * boot scan; the validator blocks them on the user load path. */
+  descriptor_parsed_t parsed;
+  int ret =
+      descriptor_parse_once(descriptor_str, wallet_get_network(), &parsed);
+  if (ret != WALLY_OK) {
+    ESP_LOGE(TAG, "failed to parse descriptor: %d", ret);
     return false;
   }
-  if (registry_len >= REGISTRY_MAX_ENTRIES) {
-    ESP_LOGE(TAG, "registry full (%d entries)", REGISTRY_MAX_ENTRIES);
+  if (parsed.network != wallet_get_network()) {
+    ESP_LOGE(TAG, "descriptor '%s' is for the other network", id);
+    descriptor_parsed_free(&parsed);
     return false;
   }
+  return add_keyed_entry(id, descriptor_str, &parsed, loc, persist);
+}
 
-  uint32_t wally_network = (network == WALLET_NETWORK_MAINNET)
-                               ? WALLY_NETWORK_BITCOIN_MAINNET
-                               : WALLY_NETWORK_BITCOIN_TESTNET;
-  struct wally_descriptor *desc = NULL;
-  if (wallet_descriptor_parse(descriptor_str, NULL, wally_network, &desc) !=
-      WALLY_OK) {
-    ESP_LOGE(TAG, "failed to parse watch-only descriptor");
+bool registry_add_parsed(const char *id, const char *descriptor_str,
+                         descriptor_parsed_t *parsed, storage_location_t loc,
+                         bool persist) {
+  if (!parsed || !parsed->desc)
+    return false;
+  if (!can_add_entry(id, descriptor_str) ||
+      parsed->network != wallet_get_network()) {
+    descriptor_parsed_free(parsed);
     return false;
   }
+  return add_keyed_entry(id, descriptor_str, parsed, loc, persist);
+}
+
+/* Watch-only counterpart of add_keyed_entry: no key lookup, never persisted.
+ * Takes ownership of parsed->desc. */
+static bool add_watch_only_entry(const char *id, descriptor_parsed_t *parsed) {
+  struct wally_descriptor *desc = parsed->desc;
+  parsed->desc = NULL;
 
   uint32_t num_paths = 0;
   if (wally_descriptor_get_num_paths(desc, &num_paths) != WALLY_OK) {
@@ -399,16 +600,44 @@ bool registry_add_watch_only(const char *id, const char *descriptor_str,
     return false;
   }
 
-  registry_entry_t *e = &registry_entries[registry_len];
-  memset(e, 0, sizeof *e);
-  strncpy(e->id, id, REGISTRY_ID_MAX_LEN - 1);
+  registry_entry_t *e = append_entry(desc, id);
+  if (!e) {
+    wally_descriptor_free(desc);
+    return false;
+  }
   e->loc = STORAGE_FLASH;
-  e->desc = desc;
   e->my_key_index = SIZE_MAX; // no key in watch-only mode
   e->num_paths = (size_t)num_paths;
   e->origin_path_len = 0;
-  registry_len++;
+  memcpy(e->checksum, parsed->checksum, sizeof(e->checksum));
+  commit_entry();
 
   ESP_LOGI(TAG, "added watch-only '%s' (%zu entries total)", id, registry_len);
   return true;
 }
+
+bool registry_add_watch_only(const char *id, const char *descriptor_str,
+                             wallet_network_t network) {
+  if (!can_add_entry(id, descriptor_str))
+    return false;
+
+  descriptor_parsed_t parsed;
+  if (descriptor_parse_once(descriptor_str, network, &parsed) != WALLY_OK ||
+      parsed.network != network) {
+    ESP_LOGE(TAG, "failed to parse watch-only descriptor");
+    descriptor_parsed_free(&parsed);
+    return false;
+  }
+  return add_watch_only_entry(id, &parsed);
+}
+
+bool registry_add_watch_only_parsed(const char *id, const char *descriptor_str,
+                                    descriptor_parsed_t *parsed) {
+  if (!parsed || !parsed->desc)
+    return false;
+  if (!can_add_entry(id, descriptor_str)) {
+    descriptor_parsed_free(parsed);
+    return false;
+  }
+  return add_watch_only_entry(id, parsed);
+}
@@ -8,11 +8,13 @@
 
 #include <wally_descriptor.h>
 
+#include "descriptor_parse.h"
 #include "ss_whitelist.h"
 #include "storage.h"
 #include "wallet.h"
 
-#define REGISTRY_MAX_ENTRIES 16
+/* The registry grows on demand; this only bounds how far. */
+#define REGISTRY_MAX_ENTRIES 512
 #define REGISTRY_ID_MAX_LEN 32
 #define REGISTRY_LABEL_MAX_LEN 48
 
@@ -26,6 +28,9 @@ typedef struct {
   uint32_t origin_path[MAX_KEYPATH_ORIGIN_DEPTH];
   size_t origin_path_len;
   bool persisted;
+  /* Computed once when the entry is added */
+  char checksum[9];   // h-normalized BIP-380 checksum, "" if unavailable
+  size_t script_type; // WALLY_SCRIPT_TYPE_* of the descriptor's outputs
 } registry_entry_t;
 
 KERN_WARN_UNUSED_RESULT size_t registry_count(void);
@@ -39,12 +44,25 @@ KERN_WARN_UNUSED_RESULT bool
 registry_add_from_string(const char *id, const char *descriptor_str,
                          storage_location_t loc, bool persist);
 
+/* Same as registry_add_from_string for a descriptor the caller has already
+ * parsed (e.g. during validation), so it is not parsed again. Takes ownership
+ * of parsed->desc whether or not the add succeeds. */
+KERN_WARN_UNUSED_RESULT bool
+registry_add_parsed(const char *id, const char *descriptor_str,
+                    descriptor_parsed_t *parsed, storage_location_t loc,
+                    bool persist);
+
 /* Watch-only (keyless) session add: registers a descriptor for address viewing
  * without requiring the loaded key's fingerprint to be present. `my_key_index`
  * is set to SIZE_MAX and the origin path is left empty. Never persisted. */
 KERN_WARN_UNUSED_RESULT bool registry_add_watch_only(const char *id,
                                                      const char *descriptor_str,
                                                      wallet_network_t network);
+/* Watch-only add of an already-parsed descriptor, registered on the network
+ * it was parsed on. Takes ownership of parsed->desc. */
+KERN_WARN_UNUSED_RESULT bool
+registry_add_watch_only_parsed(const char *id, const char *descriptor_str,
+                               descriptor_parsed_t *parsed);
 
 /* Look up whether `descriptor_str` is already loaded in the in-memory
  * session registry. Compares h-normalized BIP-380 checksums and writes the
@@ -59,6 +77,11 @@ registry_session_has_duplicate_checksum(const char checksum[9], char *out_id,
 
 void registry_clear(void);
 void registry_init(bool is_testnet);
+
+/* Next entry at or after *cursor whose origin path for our key is the keypath
+ * minus its <multipath>/<index> tail (the keypath's fingerprint is not
+ * compared). Advances *cursor past the returned entry. Looked up through a
+ * hash index on the origin path, so the cost doesn't grow with the registry. */
 KERN_WARN_UNUSED_RESULT registry_entry_t *
 registry_match_keypath(const uint8_t *keypath, size_t keypath_len,
                        size_t *cursor);
@@ -0,0 +1,186 @@
+// SD directory listing cache and per-file metadata for the SD file browser
+
+#include "sd_dir_cache.h"
+
+#include <sd_card.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Enough of a file to tell its type. */
+#define SNIFF_LEN 32
+/* One sector: reading the head of a file needs no bigger bounce buffer. */
+#define SNIFF_BUFFER_SIZE 512
+
+#define ESP_IMAGE_MAGIC 0xE9
+#define ESP_IMAGE_MAX_SEGMENTS 16
+
+typedef struct {
+  char *path; /* NULL: slot free */
+  int64_t mtime;
+  uint32_t generation;
+  uint32_t last_used;
+  sd_dir_listing_t listing;
+} cache_slot_t;
+
+static cache_slot_t slots[SD_DIR_CACHE_SLOTS];
+static uint32_t use_clock = 0;
+static uint32_t next_serial = 0;
+
+static void slot_free(cache_slot_t *slot) {
+  for (int i = 0; i < slot->listing.count; i++)
+    free(slot->listing.entries[i].name);
+  free(slot->listing.entries);
+  free(slot->path);
+  memset(slot, 0, sizeof(*slot));
+}
+
+/* Reads path into slot, directories first. Takes over the names
+ * sd_card_list_entries() allocated instead of copying them again. */
+static esp_err_t slot_fill(cache_slot_t *slot, const char *path, int64_t mtime,
+                           uint32_t generation) {
+  char **names = NULL;
+  bool *is_dir = NULL;
+  int count = 0;
+  esp_err_t ret = sd_card_list_entries(path, &names, &is_dir, &count);
+  if (ret != ESP_OK)
+    return ret;
+
+  sd_dir_entry_t *entries =
+      count > 0 ? calloc((size_t)count, sizeof(*entries)) : NULL;
+  char *path_copy = strdup(path);
+  if ((count > 0 && !entries) || !path_copy) {
+    free(entries);
+    free(path_copy);
+    sd_card_free_file_list(names, count);
+    free(is_dir);
+    return ESP_ERR_NO_MEM;
+  }
+
+  int n = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    bool want_dir = (pass == 0);
+    for (int i = 0; i < count; i++) {
+      if (is_dir[i] == want_dir)
+        entries[n++] = (sd_dir_entry_t){.name = names[i], .is_dir = is_dir[i]};
+    }
+  }
+  free(names);
+  free(is_dir);
+
+  slot->path = path_copy;
+  slot->mtime = mtime;
+  slot->generation = generation;
+  slot->listing.entries = entries;
+  slot->listing.count = count;
+  slot->listing.serial = ++next_serial;
+  return ESP_OK;
+}
+
+esp_err_t sd_dir_cache_get(const char *path, sd_dir_listing_t **listing_out) {
+  if (!path || !listing_out)
+    return ESP_ERR_INVALID_ARG;
+  *listing_out = NULL;
+
+  int64_t mtime = 0;
+  esp_err_t ret = sd_card_mtime(path, &mtime);
+  uint32_t generation = sd_card_generation();
+
+  cache_slot_t *slot = NULL;
+  for (int i = 0; i < SD_DIR_CACHE_SLOTS; i++) {
+    if (slots[i].path && strcmp(slots[i].path, path) == 0) {
+      slot = &slots[i];
+      break;
+    }
+  }
+  if (ret != ESP_OK) {
+    if (slot)
+      slot_free(slot);
+    return ret;
+  }
+
+  if (slot && slot->mtime == mtime && slot->generation == generation) {
+    slot->last_used = ++use_clock;
+    *listing_out = &slot->listing;
+    return ESP_OK;
+  }
+
+  if (!slot) {
+    slot = &slots[0];
+    for (int i = 0; i < SD_DIR_CACHE_SLOTS; i++) {
+      if (!slots[i].path) {
+        slot = &slots[i];
+        break;
+      }
+      if (slots[i].last_used < slot->last_used)
+        slot = &slots[i];
+    }
+  }
+  slot_free(slot);
+
+  ret = slot_fill(slot, path, mtime, generation);
+  if (ret != ESP_OK)
+    return ret;
+  slot->last_used = ++use_clock;
+  *listing_out = &slot->listing;
+  return ESP_OK;
+}
+
+void sd_dir_cache_clear(void) {
+  for (int i = 0; i < SD_DIR_CACHE_SLOTS; i++)
+    slot_free(&slots[i]);
+}
+
+static bool looks_like_text(const uint8_t *head, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t c = head[i];
+    if (c < 0x20 && c != '\t' && c != '\r' && c != '\n')
+      return false;
+    if (c == 0x7F)
+      return false;
+  }
+  return true;
+}
+
+static sd_file_kind_t sniff(const uint8_t *head, size_t len) {
+  if (len == 0)
+    return SD_FILE_KIND_OTHER;
+  if (len >= 5 && memcmp(head, "psbt\xff", 5) == 0)
+    return SD_FILE_KIND_PSBT;
+  if (len >= 6 && memcmp(head, "cHNidP", 6) == 0) /* base64 of "psbt\xff" */
+    return SD_FILE_KIND_PSBT;
+  if (len >= 2 && head[0] == ESP_IMAGE_MAGIC && head[1] > 0 &&
+      head[1] <= ESP_IMAGE_MAX_SEGMENTS)
+    return SD_FILE_KIND_FIRMWARE;
+  return looks_like_text(head, len) ? SD_FILE_KIND_TEXT : SD_FILE_KIND_OTHER;
+}
+
+esp_err_t sd_dir_read_meta(const char *dir, const char *name,
+                           sd_file_kind_t *kind_out, size_t *size_out) {
+  if (!dir || !name || !kind_out || !size_out)
+    return ESP_ERR_INVALID_ARG;
+
+  char path[512];
+  int n = snprintf(path, sizeof(path), "%s/%s", dir, name);
+  if (n < 0 || (size_t)n >= sizeof(path))
+    return ESP_ERR_INVALID_SIZE;
+
+  const sd_card_stream_config_t config = {.buffer_size = SNIFF_BUFFER_SIZE};
+  sd_card_stream_t *stream;
+  esp_err_t ret =
+      sd_card_stream_open(path, SD_CARD_STREAM_READ, &config, &stream);
+  if (ret != ESP_OK)
+    return ret;
+
+  uint8_t head[SNIFF_LEN];
+  size_t head_len = 0;
+  ret = sd_card_stream_size(stream, size_out);
+  if (ret == ESP_OK)
+    ret = sd_card_stream_read_chunk(stream, head, sizeof(head), &head_len);
+  sd_card_stream_close(stream);
+  if (ret != ESP_OK)
+    return ret;
+
+  *kind_out = sniff(head, head_len);
+  return ESP_OK;
+}
@@ -0,0 +1,64 @@
+/*
+ * SD directory listing cache and per-file metadata for the SD file browser
+ *
+ * A listing is read once per directory and kept (directories first) for as
+ * long as the directory's mtime and the card generation are unchanged, so
+ * navigating back and forth does not re-read, re-copy and re-order thousands
+ * of names. File sizes and content types are not part of the listing read:
+ * they are filled in per entry by the caller, typically from a worker task
+ * through sd_dir_read_meta().
+ *
+ * Not thread-safe: the cache and its listings belong to one task (the LVGL
+ * task). sd_dir_read_meta() touches neither and may run anywhere.
+ */
+
+#ifndef SD_DIR_CACHE_H
+#define SD_DIR_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* Directories kept listed at once; the least recently used goes first. */
+#define SD_DIR_CACHE_SLOTS 4
+
+typedef enum {
+  SD_FILE_KIND_PENDING = 0, /* metadata not read yet */
+  SD_FILE_KIND_OTHER,
+  SD_FILE_KIND_TEXT,
+  SD_FILE_KIND_PSBT,     /* binary or base64 */
+  SD_FILE_KIND_FIRMWARE, /* ESP application image */
+} sd_file_kind_t;
+
+#define SD_FILE_KIND_BIT(kind) (1u << (kind))
+
+typedef struct {
+  char *name;
+  bool is_dir;
+  uint8_t kind; /* sd_file_kind_t; always PENDING for directories */
+  size_t size;  /* valid once kind is not PENDING */
+} sd_dir_entry_t;
+
+typedef struct {
+  sd_dir_entry_t *entries; /* directories first, each group in readdir order */
+  int count;
+  /* Distinct for every listing ever read, so a result computed for one can
+   * be told from one for its replacement. */
+  uint32_t serial;
+} sd_dir_listing_t;
+
+/* Returns the listing of path, re-reading it only when it is not cached or
+ * may have changed. The listing stays valid until the next call or
+ * sd_dir_cache_clear(); metadata the caller stores in it is kept with it. */
+esp_err_t sd_dir_cache_get(const char *path, sd_dir_listing_t **listing_out);
+
+void sd_dir_cache_clear(void);
+
+/* Size and content type of dir/name, from one open and a read of its first
+ * bytes. */
+esp_err_t sd_dir_read_meta(const char *dir, const char *name,
+                           sd_file_kind_t *kind_out, size_t *size_out);
+
+#endif // SD_DIR_CACHE_H
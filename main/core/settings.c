@@ -2,8 +2,10 @@
 
 #include "settings.h"
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <nvs.h>
-#include <nvs_flash.h>
+#include <stddef.h>
 #include <string.h>
 
 static const char *TAG = "SETTINGS";
@@ -24,75 +26,262 @@ static const char *KEY_SCREENSAVER = "scrn_svr";
 static const char *KEY_SESSION_TIMEOUT = "sess_tout";
 static const char *KEY_DISCLAIMER_VERSION = "disc_ver";
 
+/* Changes are committed this long after the last one, so a slider drag or a
+ * run of toggles costs one encrypted page write instead of one per step. */
+#define SETTINGS_COMMIT_DELAY_MS 2000
+
+typedef enum {
+  SETTING_NETWORK,
+  SETTING_BRIGHTNESS,
+  SETTING_AE_TARGET,
+  SETTING_FOCUS_POS,
+  SETTING_QR_DENSITY,
+  SETTING_QR_SHADE,
+  SETTING_QR_FPS,
+  SETTING_PERMISSIVE_SIGNING,
+  SETTING_PARTIAL_SIGNING,
+  SETTING_EXPECTED_OWNED_SIGNING,
+  SETTING_SCREENSAVER,
+  SETTING_SESSION_TIMEOUT,
+  SETTING_DISCLAIMER_VERSION,
+  SETTING_COUNT,
+} setting_id_t;
+
+/* RAM copy of every setting. Holds the default for a key never stored and the
+ * raw stored value otherwise; getters range-check it on the way out. */
+typedef struct {
+  uint8_t network;
+  uint8_t brightness;
+  uint8_t ae_target;
+  uint16_t focus_position;
+  uint16_t qr_density;
+  uint8_t qr_shade;
+  uint8_t qr_fps;
+  uint8_t permissive_signing;
+  uint8_t partial_signing;
+  uint8_t expected_owned_signing;
+  uint16_t screensaver_timeout;
+  uint16_t session_timeout;
+  char disclaimer_version[SETTINGS_VERSION_MAX];
+} settings_values_t;
+
+typedef enum { SETTING_U8, SETTING_U16, SETTING_BLOB } setting_type_t;
+
+typedef struct {
+  const char *const *key;
+  setting_type_t type;
+  size_t offset;
+} setting_slot_t;
+
+#define SLOT(id, key, type, field)                                             \
+  [id] = {&key, type, offsetof(settings_values_t, field)}
+
+static const setting_slot_t slots[SETTING_COUNT] = {
+    SLOT(SETTING_NETWORK, KEY_NETWORK, SETTING_U8, network),
+    SLOT(SETTING_BRIGHTNESS, KEY_BRIGHTNESS, SETTING_U8, brightness),
+    SLOT(SETTING_AE_TARGET, KEY_AE_TARGET, SETTING_U8, ae_target),
+    SLOT(SETTING_FOCUS_POS, KEY_FOCUS_POS, SETTING_U16, focus_position),
+    SLOT(SETTING_QR_DENSITY, KEY_QR_DENSITY, SETTING_U16, qr_density),
+    SLOT(SETTING_QR_SHADE, KEY_QR_SHADE, SETTING_U8, qr_shade),
+    SLOT(SETTING_QR_FPS, KEY_QR_FPS, SETTING_U8, qr_fps),
+    SLOT(SETTING_PERMISSIVE_SIGNING, KEY_PERMISSIVE_SIGNING, SETTING_U8,
+         permissive_signing),
+    SLOT(SETTING_PARTIAL_SIGNING, KEY_PARTIAL_SIGNING, SETTING_U8,
+         partial_signing),
+    SLOT(SETTING_EXPECTED_OWNED_SIGNING, KEY_EXPECTED_OWNED_SIGNING,
+         SETTING_U8, expected_owned_signing),
+    SLOT(SETTING_SCREENSAVER, KEY_SCREENSAVER, SETTING_U16,
+         screensaver_timeout),
+    SLOT(SETTING_SESSION_TIMEOUT, KEY_SESSION_TIMEOUT, SETTING_U16,
+         session_timeout),
+    SLOT(SETTING_DISCLAIMER_VERSION, KEY_DISCLAIMER_VERSION, SETTING_BLOB,
+         disclaimer_version),
+};
+
+#undef SLOT
+
+static const settings_values_t settings_defaults = {
+    .network = WALLET_NETWORK_DEFAULT,
+    .brightness = 50,
+    .ae_target = AE_TARGET_DEFAULT,
+    .focus_position = FOCUS_POSITION_DEFAULT,
+    .qr_density = QR_DENSITY_DEFAULT,
+    .qr_shade = QR_SHADE_DEFAULT,
+    .qr_fps = QR_FPS_DEFAULT,
+    .screensaver_timeout = SCREENSAVER_TIMEOUT_DEFAULT_SEC,
+    .session_timeout = SESSION_TIMEOUT_DEFAULT_SEC,
+};
+
 static nvs_handle_t settings_nvs;
 static bool initialized = false;
-
-static uint8_t settings_get_u8_or_default(const char *key,
-                                          uint8_t default_value) {
-  if (!initialized)
-    return default_value;
-
-  uint8_t value = default_value;
-  if (nvs_get_u8(settings_nvs, key, &value) != ESP_OK)
-    return default_value;
-  return value;
-}
-
-static uint16_t settings_get_u16_or_default(const char *key,
-                                            uint16_t default_value) {
-  if (!initialized)
-    return default_value;
-
-  uint16_t value = default_value;
-  if (nvs_get_u16(settings_nvs, key, &value) != ESP_OK)
-    return default_value;
-  return value;
-}
-
-static bool settings_get_bool_or_default(const char *key, bool default_value) {
-  return settings_get_u8_or_default(key, default_value ? 1 : 0) != 0;
+static settings_values_t values = settings_defaults;
+/* Bit per setting_id_t: present in NVS (or about to be), awaiting a commit. */
+static uint32_t stored;
+static uint32_t dirty;
+/* Guards values, dirty and the handle: setters and the debounced commit run
+ * on the UI task, but a flush may come from another (restart handler). */
+static SemaphoreHandle_t settings_lock;
+static settings_commit_timer_t commit_timer;
+
+static void *slot_field(setting_id_t id) {
+  return (uint8_t *)&values + slots[id].offset;
+}
+
+static size_t slot_size(setting_id_t id) {
+  switch (slots[id].type) {
+  case SETTING_U8:
+    return sizeof(uint8_t);
+  case SETTING_U16:
+    return sizeof(uint16_t);
+  case SETTING_BLOB:
+    return SETTINGS_VERSION_MAX;
+  }
+  return 0;
 }
 
 /* Callers of the settings_set_* family act on the new value immediately and
  * have nothing to do about a failed write, so report it here once, naming the
  * key, rather than leaving every call site to notice on its own. */
 static esp_err_t settings_report(const char *key, esp_err_t err) {
+  (void)key;
   if (err != ESP_OK)
     ESP_LOGE(TAG, "Failed to persist '%s': %s", key, esp_err_to_name(err));
   return err;
 }
 
-static esp_err_t settings_set_u8_and_commit(const char *key, uint8_t value) {
-  if (!initialized)
-    return settings_report(key, ESP_ERR_INVALID_STATE);
+static void lock(void) {
+  if (settings_lock)
+    xSemaphoreTake(settings_lock, portMAX_DELAY);
+}
 
-  esp_err_t err = nvs_set_u8(settings_nvs, key, value);
-  if (err != ESP_OK)
-    return settings_report(key, err);
-  return settings_report(key, nvs_commit(settings_nvs));
+static void unlock(void) {
+  if (settings_lock)
+    xSemaphoreGive(settings_lock);
 }
 
-static esp_err_t settings_set_u16_and_commit(const char *key, uint16_t value) {
-  if (!initialized)
-    return settings_report(key, ESP_ERR_INVALID_STATE);
+static esp_err_t read_slot(setting_id_t id) {
+  const char *key = *slots[id].key;
+  void *field = slot_field(id);
+  switch (slots[id].type) {
+  case SETTING_U8:
+    return nvs_get_u8(settings_nvs, key, field);
+  case SETTING_U16:
+    return nvs_get_u16(settings_nvs, key, field);
+  case SETTING_BLOB: {
+    size_t len = SETTINGS_VERSION_MAX;
+    return nvs_get_blob(settings_nvs, key, field, &len);
+  }
+  }
+  return ESP_ERR_INVALID_ARG;
+}
+
+/* Caller holds the lock. */
+static void load_all(void) {
+  values = settings_defaults;
+  stored = 0;
+  dirty = 0;
+  for (setting_id_t id = 0; id < SETTING_COUNT; id++) {
+    if (read_slot(id) == ESP_OK)
+      stored |= 1u << id;
+    else
+      memcpy(slot_field(id),
+             (const uint8_t *)&settings_defaults + slots[id].offset,
+             slot_size(id));
+  }
+  values.disclaimer_version[SETTINGS_VERSION_MAX - 1] = '\0';
+}
+
+static esp_err_t write_slot(setting_id_t id) {
+  const void *field = slot_field(id);
+  switch (slots[id].type) {
+  case SETTING_U8:
+    return nvs_set_u8(settings_nvs, *slots[id].key, *(const uint8_t *)field);
+  case SETTING_U16:
+    return nvs_set_u16(settings_nvs, *slots[id].key, *(const uint16_t *)field);
+  case SETTING_BLOB:
+    return nvs_set_blob(settings_nvs, *slots[id].key, field,
+                        SETTINGS_VERSION_MAX);
+  }
+  return ESP_ERR_INVALID_ARG;
+}
+
+/* Caller holds the lock. A key that fails to write stays dirty so the next
+ * flush retries it. */
+static esp_err_t flush_locked(void) {
+  if (!initialized || !dirty)
+    return ESP_OK;
+
+  esp_err_t result = ESP_OK;
+  uint32_t written = 0;
+  for (setting_id_t id = 0; id < SETTING_COUNT; id++) {
+    if (!(dirty & (1u << id)))
+      continue;
+    esp_err_t err = settings_report(*slots[id].key, write_slot(id));
+    if (err == ESP_OK)
+      written |= 1u << id;
+    else
+      result = err;
+  }
+  if (!written)
+    return result;
 
-  esp_err_t err = nvs_set_u16(settings_nvs, key, value);
-  if (err != ESP_OK)
-    return settings_report(key, err);
-  return settings_report(key, nvs_commit(settings_nvs));
+  esp_err_t err = nvs_commit(settings_nvs);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to commit settings: %s", esp_err_to_name(err));
+    return err;
+  }
+  dirty &= ~written;
+  return result;
 }
 
-static esp_err_t settings_set_bool_and_commit(const char *key, bool value) {
-  return settings_set_u8_and_commit(key, value ? 1 : 0);
+/* Caller holds the lock. Without a timer the change is committed at once. */
+static esp_err_t mark_dirty_locked(setting_id_t id) {
+  dirty |= 1u << id;
+  if (!commit_timer.arm)
+    return flush_locked();
+  commit_timer.arm(SETTINGS_COMMIT_DELAY_MS);
+  return ESP_OK;
+}
+
+/* `value` is slot_size(id) bytes. Re-storing what a key already holds costs
+ * nothing; a key never stored is written even when it equals the default, so
+ * an explicit choice survives a later change of default. */
+static esp_err_t settings_store(setting_id_t id, const void *value) {
+  lock();
+  esp_err_t err = ESP_OK;
+  if (!initialized) {
+    err = settings_report(*slots[id].key, ESP_ERR_INVALID_STATE);
+  } else if (!(stored & (1u << id)) ||
+             memcmp(slot_field(id), value, slot_size(id)) != 0) {
+    memcpy(slot_field(id), value, slot_size(id));
+    stored |= 1u << id;
+    err = mark_dirty_locked(id);
+  }
+  unlock();
+  return err;
+}
+
+static esp_err_t settings_set_u8(setting_id_t id, uint8_t value) {
+  return settings_store(id, &value);
+}
+
+static esp_err_t settings_set_u16(setting_id_t id, uint16_t value) {
+  return settings_store(id, &value);
+}
+
+static esp_err_t settings_set_bool(setting_id_t id, bool value) {
+  return settings_set_u8(id, value ? 1 : 0);
 }
 
 esp_err_t settings_init(void) {
+  if (!settings_lock)
+    settings_lock = xSemaphoreCreateMutex();
+
   esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &settings_nvs);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(err));
     return err;
   }
-  initialized = true;
 
   /* Drop legacy "def_pol" (default wallet policy) key — superseded by the
    * per-state permissive/partial/expected-owned toggles. Inert if absent. */
@@ -105,28 +294,57 @@ esp_err_t settings_init(void) {
              esp_err_to_name(mig));
   }
 
+  lock();
+  load_all();
+  initialized = true;
+  unlock();
   return ESP_OK;
 }
 
+esp_err_t settings_flush(void) {
+  lock();
+  esp_err_t err = flush_locked();
+  unlock();
+  return err;
+}
+
+void settings_set_commit_timer(const settings_commit_timer_t *timer) {
+  lock();
+  if (commit_timer.cancel)
+    commit_timer.cancel();
+  commit_timer = timer ? *timer : (settings_commit_timer_t){0};
+  if (dirty && commit_timer.arm)
+    commit_timer.arm(SETTINGS_COMMIT_DELAY_MS);
+  unlock();
+}
+
 void settings_deinit(void) {
-  if (!initialized)
-    return;
-  nvs_close(settings_nvs);
-  initialized = false;
+  lock();
+  if (initialized) {
+    if (commit_timer.cancel)
+      commit_timer.cancel();
+    flush_locked();
+    nvs_close(settings_nvs);
+    initialized = false;
+    values = settings_defaults;
+    stored = 0;
+    dirty = 0;
+  }
+  unlock();
 }
 
 wallet_network_t settings_get_network(void) {
-  uint8_t val = settings_get_u8_or_default(KEY_NETWORK, WALLET_NETWORK_DEFAULT);
+  uint8_t val = values.network;
   return (val <= WALLET_NETWORK_TESTNET) ? (wallet_network_t)val
                                          : WALLET_NETWORK_DEFAULT;
 }
 
 esp_err_t settings_set_network(wallet_network_t network) {
-  return settings_set_u8_and_commit(KEY_NETWORK, (uint8_t)network);
+  return settings_set_u8(SETTING_NETWORK, (uint8_t)network);
 }
 
 uint8_t settings_get_brightness(void) {
-  uint8_t val = settings_get_u8_or_default(KEY_BRIGHTNESS, 50);
+  uint8_t val = values.brightness;
   return (val >= BRIGHTNESS_MIN && val <= 100) ? val : 50;
 }
 
@@ -135,11 +353,11 @@ esp_err_t settings_set_brightness(uint8_t brightness) {
     brightness = BRIGHTNESS_MIN;
   if (brightness > 100)
     brightness = 100;
-  return settings_set_u8_and_commit(KEY_BRIGHTNESS, brightness);
+  return settings_set_u8(SETTING_BRIGHTNESS, brightness);
 }
 
 uint8_t settings_get_ae_target(void) {
-  uint8_t val = settings_get_u8_or_default(KEY_AE_TARGET, AE_TARGET_DEFAULT);
+  uint8_t val = values.ae_target;
   return (val >= AE_TARGET_MIN && val <= AE_TARGET_MAX) ? val
                                                         : AE_TARGET_DEFAULT;
 }
@@ -149,24 +367,22 @@ esp_err_t settings_set_ae_target(uint8_t level) {
     level = AE_TARGET_MIN;
   if (level > AE_TARGET_MAX)
     level = AE_TARGET_MAX;
-  return settings_set_u8_and_commit(KEY_AE_TARGET, level);
+  return settings_set_u8(SETTING_AE_TARGET, level);
 }
 
 uint16_t settings_get_focus_position(void) {
-  uint16_t val =
-      settings_get_u16_or_default(KEY_FOCUS_POS, FOCUS_POSITION_DEFAULT);
+  uint16_t val = values.focus_position;
   return (val <= FOCUS_POSITION_MAX) ? val : FOCUS_POSITION_DEFAULT;
 }
 
 esp_err_t settings_set_focus_position(uint16_t position) {
   if (position > FOCUS_POSITION_MAX)
     position = FOCUS_POSITION_MAX;
-  return settings_set_u16_and_commit(KEY_FOCUS_POS, position);
+  return settings_set_u16(SETTING_FOCUS_POS, position);
 }
 
 uint16_t settings_get_qr_density(void) {
-  uint16_t val =
-      settings_get_u16_or_default(KEY_QR_DENSITY, QR_DENSITY_DEFAULT);
+  uint16_t val = values.qr_density;
   return (val >= QR_DENSITY_MIN && val <= QR_DENSITY_MAX) ? val
                                                           : QR_DENSITY_DEFAULT;
 }
@@ -176,11 +392,11 @@ esp_err_t settings_set_qr_density(uint16_t chars_per_frame) {
     chars_per_frame = QR_DENSITY_MIN;
   if (chars_per_frame > QR_DENSITY_MAX)
     chars_per_frame = QR_DENSITY_MAX;
-  return settings_set_u16_and_commit(KEY_QR_DENSITY, chars_per_frame);
+  return settings_set_u16(SETTING_QR_DENSITY, chars_per_frame);
 }
 
 uint8_t settings_get_qr_shade(void) {
-  uint8_t val = settings_get_u8_or_default(KEY_QR_SHADE, QR_SHADE_DEFAULT);
+  uint8_t val = values.qr_shade;
   return (val >= QR_SHADE_MIN && val <= QR_SHADE_MAX) ? val : QR_SHADE_DEFAULT;
 }
 
@@ -189,11 +405,11 @@ esp_err_t settings_set_qr_shade(uint8_t shade) {
     shade = QR_SHADE_MIN;
   if (shade > QR_SHADE_MAX)
     shade = QR_SHADE_MAX;
-  return settings_set_u8_and_commit(KEY_QR_SHADE, shade);
+  return settings_set_u8(SETTING_QR_SHADE, shade);
 }
 
 uint8_t settings_get_qr_fps(void) {
-  uint8_t val = settings_get_u8_or_default(KEY_QR_FPS, QR_FPS_DEFAULT);
+  uint8_t val = values.qr_fps;
   return (val >= QR_FPS_MIN && val <= QR_FPS_MAX) ? val : QR_FPS_DEFAULT;
 }
 
@@ -202,62 +418,54 @@ esp_err_t settings_set_qr_fps(uint8_t fps) {
     fps = QR_FPS_MIN;
   if (fps > QR_FPS_MAX)
     fps = QR_FPS_MAX;
-  return settings_set_u8_and_commit(KEY_QR_FPS, fps);
+  return settings_set_u8(SETTING_QR_FPS, fps);
 }
 
 bool settings_get_permissive_signing(void) {
-  return settings_get_bool_or_default(KEY_PERMISSIVE_SIGNING, false);
+  return values.permissive_signing != 0;
 }
 
 esp_err_t settings_set_permissive_signing(bool permissive) {
-  return settings_set_bool_and_commit(KEY_PERMISSIVE_SIGNING, permissive);
+  return settings_set_bool(SETTING_PERMISSIVE_SIGNING, permissive);
 }
 
 bool settings_get_partial_signing(void) {
-  return settings_get_bool_or_default(KEY_PARTIAL_SIGNING, false);
+  return values.partial_signing != 0;
 }
 
 esp_err_t settings_set_partial_signing(bool partial) {
-  return settings_set_bool_and_commit(KEY_PARTIAL_SIGNING, partial);
+  return settings_set_bool(SETTING_PARTIAL_SIGNING, partial);
 }
 
 bool settings_get_expected_owned_signing(void) {
-  return settings_get_bool_or_default(KEY_EXPECTED_OWNED_SIGNING, false);
+  return values.expected_owned_signing != 0;
 }
 
 esp_err_t settings_set_expected_owned_signing(bool enabled) {
-  return settings_set_bool_and_commit(KEY_EXPECTED_OWNED_SIGNING, enabled);
+  return settings_set_bool(SETTING_EXPECTED_OWNED_SIGNING, enabled);
 }
 
 uint16_t settings_get_screensaver_timeout(void) {
-  return settings_get_u16_or_default(KEY_SCREENSAVER,
-                                     SCREENSAVER_TIMEOUT_DEFAULT_SEC);
+  return values.screensaver_timeout;
 }
 
 esp_err_t settings_set_screensaver_timeout(uint16_t sec) {
-  return settings_set_u16_and_commit(KEY_SCREENSAVER, sec);
+  return settings_set_u16(SETTING_SCREENSAVER, sec);
 }
 
 uint16_t settings_get_session_timeout(void) {
-  return settings_get_u16_or_default(KEY_SESSION_TIMEOUT,
-                                     SESSION_TIMEOUT_DEFAULT_SEC);
+  return values.session_timeout;
 }
 
 esp_err_t settings_set_session_timeout(uint16_t sec) {
-  return settings_set_u16_and_commit(KEY_SESSION_TIMEOUT, sec);
+  return settings_set_u16(SETTING_SESSION_TIMEOUT, sec);
 }
 
 bool settings_disclaimer_acknowledged(const char *version) {
   if (!initialized || !version)
     return false;
-
-  char stored[SETTINGS_VERSION_MAX] = {0};
-  size_t len = sizeof(stored);
-  if (nvs_get_blob(settings_nvs, KEY_DISCLAIMER_VERSION, stored, &len) !=
-      ESP_OK)
-    return false;
-  stored[sizeof(stored) - 1] = '\0';
-  return strcmp(stored, version) == 0;
+  return (stored & (1u << SETTING_DISCLAIMER_VERSION)) &&
+         strcmp(values.disclaimer_version, version) == 0;
 }
 
 esp_err_t settings_acknowledge_disclaimer(const char *version) {
@@ -266,21 +474,24 @@ esp_err_t settings_acknowledge_disclaimer(const char *version) {
   if (!version)
     return ESP_ERR_INVALID_ARG;
 
-  char stored[SETTINGS_VERSION_MAX] = {0};
-  strncpy(stored, version, sizeof(stored) - 1);
-
-  esp_err_t err = nvs_set_blob(settings_nvs, KEY_DISCLAIMER_VERSION, stored,
-                               sizeof(stored));
-  if (err != ESP_OK)
-    return settings_report(KEY_DISCLAIMER_VERSION, err);
-  return settings_report(KEY_DISCLAIMER_VERSION, nvs_commit(settings_nvs));
+  char padded[SETTINGS_VERSION_MAX] = {0};
+  strncpy(padded, version, sizeof(padded) - 1);
+  return settings_store(SETTING_DISCLAIMER_VERSION, padded);
 }
 
 esp_err_t settings_reset_all(void) {
-  if (!initialized)
-    return ESP_ERR_INVALID_STATE;
-  esp_err_t err = nvs_erase_all(settings_nvs);
-  if (err != ESP_OK)
-    return err;
-  return nvs_commit(settings_nvs);
+  lock();
+  esp_err_t err = ESP_ERR_INVALID_STATE;
+  if (initialized) {
+    if (commit_timer.cancel)
+      commit_timer.cancel();
+    values = settings_defaults;
+    stored = 0;
+    dirty = 0;
+    err = nvs_erase_all(settings_nvs);
+    if (err == ESP_OK)
+      err = nvs_commit(settings_nvs);
+  }
+  unlock();
+  return err;
 }
@@ -1,4 +1,10 @@
 // Persistent settings backed by NVS (Non-Volatile Storage)
+//
+// Settings are read into RAM at init and getters never touch NVS. Setters
+// update RAM and schedule a commit a couple of seconds after the last change
+// on the timer given to settings_set_commit_timer() (until then each change
+// is committed at once); settings_flush() commits pending changes at once and
+// must run before power is cut (power-off, session lock, restart).
 
 #ifndef SETTINGS_H
 #define SETTINGS_H
@@ -28,9 +34,26 @@
 
 KERN_WARN_UNUSED_RESULT esp_err_t settings_init(void);
 
-/* Close the settings NVS handle (required before nvs_flash_deinit) */
+/* Commit pending changes and close the settings NVS handle (required before
+ * nvs_flash_deinit) */
 void settings_deinit(void);
 
+/* Commit pending changes now. Failures are logged per key, which stays
+ * pending for the next flush. */
+esp_err_t settings_flush(void);
+
+/* One-shot timer for the debounced commit. arm (re)starts it, and its expiry
+ * must call settings_flush() on the task that calls the setters; cancel stops
+ * it. Both are called with the settings lock held, from a setter, reset or
+ * deinit. */
+typedef struct {
+  void (*arm)(uint32_t delay_ms);
+  void (*cancel)(void);
+} settings_commit_timer_t;
+
+/* Copies *timer; NULL goes back to committing every change at once. */
+void settings_set_commit_timer(const settings_commit_timer_t *timer);
+
 /* The settings_set_* family deliberately carries no KERN_WARN_UNUSED_RESULT:
  * these persist a preference the caller has already applied in this session,
  * and no caller can do anything useful about a failed write. settings.c logs
@@ -3,6 +3,7 @@
 #include "storage.h"
 #include "crypto_utils.h"
 #include "kef.h"
+#include "../utils/secure_mem.h"
 
 #include <dirent.h>
 #include <esp_partition.h>
@@ -60,43 +61,191 @@ static esp_err_t write_flash_file(const char *path, const uint8_t *data,
   return (written == len) ? ESP_OK : ESP_FAIL;
 }
 
-static esp_err_t base64_encode_alloc(const uint8_t *in, size_t in_len,
-                                     unsigned char **out, size_t *out_len) {
-  size_t b64_len = 0;
-  mbedtls_base64_encode(NULL, 0, &b64_len, in, in_len);
+/* ========== SD card streaming ========== */
+
+/* Base64 goes through the stream in whole groups, so neither encoding nor
+ * decoding ever holds the file and its encoded copy at once. */
+#define SD_B64_RAW_CHUNK 384 /* encodes to 512 characters */
+#define SD_B64_TEXT_CHUNK 512
+
+struct storage_sd_writer {
+  sd_card_stream_t *stream;
+  bool base64;
+  esp_err_t err;
+  /* Raw bytes waiting for a whole base64 chunk. */
+  uint8_t pending[SD_B64_RAW_CHUNK];
+  size_t pending_len;
+  char path[96];
+};
 
-  unsigned char *buf = malloc(b64_len);
-  if (!buf)
+static esp_err_t sd_writer_open(const char *path, bool base64,
+                                storage_sd_writer_t **writer_out) {
+  storage_sd_writer_t *w = calloc(1, sizeof(*w));
+  if (!w)
     return ESP_ERR_NO_MEM;
+  esp_err_t ret =
+      sd_card_stream_open(path, SD_CARD_STREAM_WRITE, NULL, &w->stream);
+  if (ret != ESP_OK) {
+    free(w);
+    return ret;
+  }
+  w->base64 = base64;
+  snprintf(w->path, sizeof(w->path), "%s", path);
+  *writer_out = w;
+  return ESP_OK;
+}
 
-  if (mbedtls_base64_encode(buf, b64_len, &b64_len, in, in_len) != 0) {
-    free(buf);
+static esp_err_t sd_writer_encode(storage_sd_writer_t *w, const uint8_t *data,
+                                  size_t len) {
+  unsigned char b64[SD_B64_RAW_CHUNK / 3 * 4 + 1];
+  size_t b64_len = 0;
+  if (mbedtls_base64_encode(b64, sizeof(b64), &b64_len, data, len) != 0)
     return ESP_FAIL;
+  return sd_card_stream_write_chunk(w->stream, b64, b64_len);
+}
+
+bool storage_sd_writer_sink(void *writer, const uint8_t *data, size_t len) {
+  storage_sd_writer_t *w = writer;
+  if (!w || w->err != ESP_OK)
+    return false;
+  if (!w->base64) {
+    w->err = sd_card_stream_write_chunk(w->stream, data, len);
+    return w->err == ESP_OK;
   }
 
-  *out = buf;
-  *out_len = b64_len;
-  return ESP_OK;
+  /* Only whole chunks are encoded before close, so padding can only land at
+   * the very end of the file. */
+  while (len > 0 && w->err == ESP_OK) {
+    if (w->pending_len == 0 && len >= SD_B64_RAW_CHUNK) {
+      w->err = sd_writer_encode(w, data, SD_B64_RAW_CHUNK);
+      data += SD_B64_RAW_CHUNK;
+      len -= SD_B64_RAW_CHUNK;
+      continue;
+    }
+    size_t n = SD_B64_RAW_CHUNK - w->pending_len;
+    if (n > len)
+      n = len;
+    memcpy(w->pending + w->pending_len, data, n);
+    w->pending_len += n;
+    data += n;
+    len -= n;
+    if (w->pending_len == SD_B64_RAW_CHUNK) {
+      w->err = sd_writer_encode(w, w->pending, SD_B64_RAW_CHUNK);
+      w->pending_len = 0;
+    }
+  }
+  return w->err == ESP_OK;
+}
+
+esp_err_t storage_sd_writer_close(storage_sd_writer_t *writer, bool keep) {
+  if (!writer)
+    return ESP_ERR_INVALID_ARG;
+  esp_err_t ret = writer->err;
+  if (ret == ESP_OK && writer->pending_len > 0)
+    ret = sd_writer_encode(writer, writer->pending, writer->pending_len);
+  esp_err_t close_ret = sd_card_stream_close(writer->stream);
+  if (ret == ESP_OK)
+    ret = close_ret;
+  if (!keep || ret != ESP_OK)
+    sd_card_delete_file(writer->path);
+  /* The pending bytes are ciphertext, but the writer takes plaintext too. */
+  secure_memzero(writer, sizeof(*writer));
+  free(writer);
+  return keep ? ret : ESP_OK;
 }
 
-static esp_err_t base64_decode_alloc(const uint8_t *in, size_t in_len,
-                                     uint8_t **out, size_t *out_len) {
-  size_t decoded_len = 0;
-  if (mbedtls_base64_decode(NULL, 0, &decoded_len, in, in_len) !=
-      MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL)
+static esp_err_t sd_write_item(const char *path, const uint8_t *data,
+                               size_t len, bool base64) {
+  storage_sd_writer_t *writer;
+  esp_err_t ret = sd_writer_open(path, base64, &writer);
+  if (ret != ESP_OK)
+    return ret;
+  storage_sd_writer_sink(writer, data, len);
+  return storage_sd_writer_close(writer, true);
+}
+
+/* Decodes text[0..*text_len) onto the end of out[0..*len), at most cap bytes
+ * in all. Only the final group may carry '=' padding. */
+static esp_err_t sd_decode_text(unsigned char *text, size_t *text_len,
+                                bool *padded, uint8_t *out, size_t cap,
+                                size_t *len) {
+  size_t decoded = 0;
+  if (*padded || mbedtls_base64_decode(out + *len, cap - *len, &decoded, text,
+                                       *text_len) != 0)
     return ESP_ERR_INVALID_RESPONSE;
+  *len += decoded;
+  *padded = text[*text_len - 1] == '=';
+  *text_len = 0;
+  return ESP_OK;
+}
 
-  uint8_t *buf = malloc(decoded_len);
-  if (!buf)
+/* Decodes the rest of the stream into out (cap bytes), skipping line breaks
+ * and blanks. */
+static esp_err_t sd_read_base64(sd_card_stream_t *stream, uint8_t *out,
+                                size_t cap, size_t *len_out) {
+  uint8_t in[SD_B64_TEXT_CHUNK];
+  unsigned char text[SD_B64_TEXT_CHUNK];
+  size_t text_len = 0, len = 0, n;
+  bool padded = false;
+  esp_err_t ret;
+
+  do {
+    ret = sd_card_stream_read_chunk(stream, in, sizeof(in), &n);
+    for (size_t i = 0; i < n && ret == ESP_OK; i++) {
+      if (in[i] == ' ' || in[i] == '\t' || in[i] == '\r' || in[i] == '\n')
+        continue;
+      text[text_len++] = in[i];
+      if (text_len == sizeof(text))
+        ret = sd_decode_text(text, &text_len, &padded, out, cap, &len);
+    }
+  } while (ret == ESP_OK && n > 0);
+
+  if (ret == ESP_OK && text_len > 0)
+    ret = sd_decode_text(text, &text_len, &padded, out, cap, &len);
+  if (ret == ESP_OK && len == 0)
+    ret = ESP_ERR_INVALID_RESPONSE;
+  *len_out = len;
+  return ret;
+}
+
+static esp_err_t sd_read_item(const char *path, uint8_t **data_out,
+                              size_t *len_out, bool base64) {
+  sd_card_stream_t *stream;
+  esp_err_t ret = sd_card_stream_open(path, SD_CARD_STREAM_READ, NULL, &stream);
+  if (ret != ESP_OK)
+    return ret;
+
+  size_t size = 0;
+  sd_card_stream_size(stream, &size);
+  /* Whitespace only ever shrinks the decoded size below this. */
+  size_t cap = base64 ? size / 4 * 3 : size;
+  if (cap == 0) {
+    sd_card_stream_close(stream);
+    return base64 ? ESP_ERR_INVALID_RESPONSE : ESP_OK;
+  }
+
+  uint8_t *buf = malloc(cap);
+  if (!buf) {
+    sd_card_stream_close(stream);
     return ESP_ERR_NO_MEM;
+  }
 
-  if (mbedtls_base64_decode(buf, decoded_len, &decoded_len, in, in_len) != 0) {
-    free(buf);
-    return ESP_ERR_INVALID_RESPONSE;
+  size_t len = 0;
+  if (base64) {
+    ret = sd_read_base64(stream, buf, cap, &len);
+  } else {
+    ret = sd_card_stream_read_chunk(stream, buf, cap, &len);
+    if (ret == ESP_OK && len != cap)
+      ret = ESP_FAIL;
   }
+  sd_card_stream_close(stream);
 
-  *out = buf;
-  *out_len = decoded_len;
+  if (ret != ESP_OK) {
+    free(buf);
+    return ret;
+  }
+  *data_out = buf;
+  *len_out = len;
   return ESP_OK;
 }
 
@@ -264,19 +413,7 @@ static esp_err_t item_save(const storage_item_config_t *cfg,
   if (loc == STORAGE_FLASH)
     return write_flash_file(path, data, len);
 
-  if (base64_on_sd) {
-    unsigned char *b64 = NULL;
-    size_t b64_len = 0;
-    ret = base64_encode_alloc(data, len, &b64, &b64_len);
-    if (ret != ESP_OK)
-      return ret;
-
-    ret = sd_card_write_file(path, b64, b64_len);
-    free(b64);
-    return ret;
-  }
-
-  return sd_card_write_file(path, data, len);
+  return sd_write_item(path, data, len, base64_on_sd);
 }
 
 static esp_err_t item_load_file(const storage_item_config_t *cfg,
@@ -299,30 +436,7 @@ static esp_err_t item_load_file(const storage_item_config_t *cfg,
   if (loc == STORAGE_FLASH)
     return read_flash_file(path, data_out, len_out);
 
-  /* SD card */
-  uint8_t *raw = NULL;
-  size_t raw_len = 0;
-
-  ret = sd_card_read_file(path, &raw, &raw_len);
-  if (ret != ESP_OK)
-    return ret;
-
-  if (!base64_decode) {
-    *data_out = raw;
-    *len_out = raw_len;
-    return ESP_OK;
-  }
-
-  uint8_t *decoded = NULL;
-  size_t decoded_len = 0;
-  ret = base64_decode_alloc(raw, raw_len, &decoded, &decoded_len);
-  free(raw);
-  if (ret != ESP_OK)
-    return ret;
-
-  *data_out = decoded;
-  *len_out = decoded_len;
-  return ESP_OK;
+  return sd_read_item(path, data_out, len_out, base64_decode);
 }
 
 static esp_err_t item_list(const storage_item_config_t *cfg,
@@ -558,6 +672,56 @@ bool storage_descriptor_exists(storage_location_t loc, const char *id,
   return item_exists(&descriptor_config, loc, id, ext);
 }
 
+esp_err_t storage_open_descriptor_writer(const char *id,
+                                         storage_sd_writer_t **writer_out) {
+  if (!id || !writer_out)
+    return ESP_ERR_INVALID_ARG;
+  *writer_out = NULL;
+
+  esp_err_t ret = item_init_location(&descriptor_config, STORAGE_SD);
+  if (ret != ESP_OK)
+    return ret;
+
+  char path[96];
+  storage_descriptor_path(STORAGE_SD, id, true, path, sizeof(path));
+  return sd_writer_open(path, true, writer_out);
+}
+
+esp_err_t storage_save_descriptor_stream(const char *id, const uint8_t key[32],
+                                         uint8_t version, uint32_t iterations,
+                                         const uint8_t *plaintext,
+                                         size_t len) {
+  if (!id || !key || !plaintext || len == 0)
+    return ESP_ERR_INVALID_ARG;
+  if (!kef_stream_supported(version))
+    return ESP_ERR_NOT_SUPPORTED;
+
+  storage_sd_writer_t *writer;
+  esp_err_t ret = storage_open_descriptor_writer(id, &writer);
+  if (ret != ESP_OK)
+    return ret;
+
+  kef_stream_t *stream = NULL;
+  kef_error_t err =
+      kef_stream_encrypt_init(key, (const uint8_t *)id, strlen(id), version,
+                              iterations, storage_sd_writer_sink, writer,
+                              &stream);
+  for (size_t done = 0; err == KEF_OK && done < len;) {
+    size_t n = len - done < KEF_STREAM_CHUNK ? len - done : KEF_STREAM_CHUNK;
+    err = kef_stream_update(stream, plaintext + done, n);
+    done += n;
+  }
+  if (err == KEF_OK)
+    err = kef_stream_finish(stream);
+  else
+    kef_stream_abort(stream);
+
+  ret = storage_sd_writer_close(writer, err == KEF_OK);
+  if (err != KEF_OK)
+    return err == KEF_ERR_ALLOC ? ESP_ERR_NO_MEM : ESP_FAIL;
+  return ret;
+}
+
 void storage_descriptor_path(storage_location_t loc, const char *id,
                              bool encrypted, char *out, size_t out_size) {
   if (!out || out_size == 0)
@@ -177,6 +177,43 @@ KERN_WARN_UNUSED_RESULT bool storage_descriptor_exists(storage_location_t loc,
                                                        const char *id,
                                                        bool encrypted);
 
+/* ---------- Streaming writes to SD ---------- */
+
+typedef struct storage_sd_writer storage_sd_writer_t;
+
+/**
+ * Open the SD file an encrypted descriptor with the given ID is saved to, for
+ * a KEF envelope too large to build in memory (see kef_stream_encrypt_init).
+ * The envelope is base64-encoded in fixed-size chunks on its way to the card,
+ * as storage_save_descriptor would write it.
+ */
+KERN_WARN_UNUSED_RESULT esp_err_t storage_open_descriptor_writer(
+    const char *id, storage_sd_writer_t **writer_out);
+
+/**
+ * Append len bytes. Matches kef_sink_t, with the writer as its context.
+ * Returns false once any write has failed.
+ */
+bool storage_sd_writer_sink(void *writer, const uint8_t *data, size_t len);
+
+/**
+ * Flush and close. With keep false (the stream that fed the writer failed),
+ * or when any write failed, the partial file is deleted.
+ */
+esp_err_t storage_sd_writer_close(storage_sd_writer_t *writer, bool keep);
+
+/**
+ * Encrypt a descriptor into a KEF envelope written straight to its SD file,
+ * without building the envelope in memory. id is both the KEF ID and the
+ * file ID; key comes from kef_derive_key for id and iterations. Only
+ * streamable versions (kef_stream_supported); others return
+ * ESP_ERR_NOT_SUPPORTED and go through kef_encrypt and
+ * storage_save_descriptor. A failed save leaves no file behind.
+ */
+KERN_WARN_UNUSED_RESULT esp_err_t storage_save_descriptor_stream(
+    const char *id, const uint8_t key[32], uint8_t version,
+    uint32_t iterations, const uint8_t *plaintext, size_t len);
+
 /**
  * Build the full filesystem path a descriptor with the given ID would be saved
  * to, matching storage_save_descriptor's convention (flash: /spiffs/d_<id>.ext;
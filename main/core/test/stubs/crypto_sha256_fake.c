@@ -0,0 +1,70 @@
+/*
+ * Multi-part SHA-256 from crypto_utils for host tests: a context buffers
+ * what it is fed and finish hashes it with wally_sha256.
+ */
+
+#include "core/crypto_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <wally_crypto.h>
+
+struct crypto_sha256_ctx {
+  uint8_t *data;
+  size_t len;
+};
+
+int crypto_sha256_start(crypto_sha256_ctx_t **ctx_out) {
+  if (!ctx_out)
+    return CRYPTO_ERR_INVALID_ARG;
+  *ctx_out = calloc(1, sizeof(**ctx_out));
+  return *ctx_out ? CRYPTO_OK : CRYPTO_ERR_INTERNAL;
+}
+
+int crypto_sha256_update(crypto_sha256_ctx_t *ctx, const uint8_t *data,
+                         size_t data_len) {
+  if (!ctx || (!data && data_len > 0))
+    return CRYPTO_ERR_INVALID_ARG;
+  if (data_len == 0)
+    return CRYPTO_OK;
+  uint8_t *grown = realloc(ctx->data, ctx->len + data_len);
+  if (!grown)
+    return CRYPTO_ERR_INTERNAL;
+  memcpy(grown + ctx->len, data, data_len);
+  ctx->data = grown;
+  ctx->len += data_len;
+  return CRYPTO_OK;
+}
+
+int crypto_sha256_finish(crypto_sha256_ctx_t *ctx, uint8_t *hash_out) {
+  if (!ctx)
+    return CRYPTO_ERR_INVALID_ARG;
+  int rc = CRYPTO_ERR_INVALID_ARG;
+  if (hash_out)
+    rc = wally_sha256(ctx->data, ctx->len, hash_out, CRYPTO_SHA256_SIZE)
+             ? CRYPTO_ERR_INTERNAL
+             : CRYPTO_OK;
+  crypto_sha256_abort(ctx);
+  return rc;
+}
+
+void crypto_sha256_abort(crypto_sha256_ctx_t *ctx) {
+  if (!ctx)
+    return;
+  free(ctx->data);
+  free(ctx);
+}
+
+int crypto_sha256_clone(const crypto_sha256_ctx_t *ctx,
+                        crypto_sha256_ctx_t **clone_out) {
+  if (!ctx || !clone_out)
+    return CRYPTO_ERR_INVALID_ARG;
+  int rc = crypto_sha256_start(clone_out);
+  if (rc == CRYPTO_OK)
+    rc = crypto_sha256_update(*clone_out, ctx->data, ctx->len);
+  if (rc != CRYPTO_OK) {
+    crypto_sha256_abort(*clone_out);
+    *clone_out = NULL;
+  }
+  return rc;
+}
@@ -0,0 +1,49 @@
+/*
+ * esp_pm locks for host tests: acquire/release keep a count per lock type,
+ * esp_pm_fake_held() reports whether any lock of a type is held.
+ */
+
+#include "esp_pm.h"
+
+#define ESP_PM_FAKE_MAX 8
+
+struct esp_pm_fake_lock {
+  esp_pm_lock_type_t type;
+  int count;
+};
+
+static struct esp_pm_fake_lock locks[ESP_PM_FAKE_MAX];
+static int lock_count;
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg,
+                             const char *name,
+                             esp_pm_lock_handle_t *out_handle) {
+  (void)arg;
+  (void)name;
+  if (lock_count == ESP_PM_FAKE_MAX)
+    return ESP_ERR_NO_MEM;
+  struct esp_pm_fake_lock *l = &locks[lock_count++];
+  l->type = lock_type;
+  l->count = 0;
+  *out_handle = l;
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle) {
+  handle->count++;
+  return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle) {
+  if (handle->count == 0)
+    return ESP_ERR_INVALID_STATE;
+  handle->count--;
+  return ESP_OK;
+}
+
+bool esp_pm_fake_held(esp_pm_lock_type_t lock_type) {
+  for (int i = 0; i < lock_count; i++)
+    if (locks[i].type == lock_type && locks[i].count > 0)
+      return true;
+  return false;
+}
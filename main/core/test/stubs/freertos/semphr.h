@@ -0,0 +1,34 @@
+#pragma once
+#include "FreeRTOS.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Host tests are single-threaded, so a second take of a mutex that is
+ * already held can only be the same task taking it again. FreeRTOS mutexes
+ * are not recursive: on target that task would block forever, so here the
+ * test aborts instead. */
+typedef struct {
+  bool held;
+} stub_mutex_t;
+typedef stub_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return calloc(1, sizeof(stub_mutex_t));
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem,
+                                        TickType_t timeout) {
+  (void)timeout;
+  if (sem->held) {
+    fprintf(stderr, "xSemaphoreTake: mutex already held (self-deadlock)\n");
+    abort();
+  }
+  sem->held = true;
+  return pdPASS;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  sem->held = false;
+  return pdPASS;
+}
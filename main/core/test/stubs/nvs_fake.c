@@ -0,0 +1,173 @@
+/*
+ * In-memory NVS for host tests.
+ *
+ * Writes land in a staged copy; nvs_commit() makes them durable. A simulated
+ * power cut drops whatever was not committed, so tests can check what a
+ * device would find on its next boot. One namespace is enough here.
+ */
+
+#include "nvs.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define NVS_FAKE_MAX_KEYS 32
+#define NVS_FAKE_MAX_VALUE 64
+
+typedef struct {
+  bool used;
+  char key[16];
+  uint8_t type;
+  size_t len;
+  uint8_t value[NVS_FAKE_MAX_VALUE];
+} nvs_fake_entry_t;
+
+enum { TYPE_U8 = 1, TYPE_U16, TYPE_BLOB };
+
+static nvs_fake_entry_t staged[NVS_FAKE_MAX_KEYS];
+static nvs_fake_entry_t durable[NVS_FAKE_MAX_KEYS];
+static int commit_count;
+static int write_count;
+static int read_count;
+static bool fail_writes;
+
+void nvs_fake_reset(void) {
+  memset(staged, 0, sizeof(staged));
+  memset(durable, 0, sizeof(durable));
+  commit_count = 0;
+  write_count = 0;
+  read_count = 0;
+  fail_writes = false;
+}
+
+void nvs_fake_reset_counters(void) {
+  commit_count = 0;
+  write_count = 0;
+  read_count = 0;
+}
+
+int nvs_fake_commits(void) { return commit_count; }
+int nvs_fake_writes(void) { return write_count; }
+int nvs_fake_reads(void) { return read_count; }
+void nvs_fake_fail_writes(bool fail) { fail_writes = fail; }
+
+/* Lose everything not committed, as a battery pull would. */
+void nvs_fake_power_cut(void) { memcpy(staged, durable, sizeof(staged)); }
+
+/* Durable value of a u8 key, for checking what survives a power cut. */
+bool nvs_fake_durable_u8(const char *key, uint8_t *out) {
+  for (int i = 0; i < NVS_FAKE_MAX_KEYS; i++) {
+    if (durable[i].used && durable[i].type == TYPE_U8 &&
+        strcmp(durable[i].key, key) == 0) {
+      *out = durable[i].value[0];
+      return true;
+    }
+  }
+  return false;
+}
+
+static nvs_fake_entry_t *find(const char *key) {
+  for (int i = 0; i < NVS_FAKE_MAX_KEYS; i++)
+    if (staged[i].used && strcmp(staged[i].key, key) == 0)
+      return &staged[i];
+  return NULL;
+}
+
+static esp_err_t put(const char *key, uint8_t type, const void *value,
+                     size_t len) {
+  write_count++;
+  if (fail_writes)
+    return ESP_FAIL;
+  if (len > NVS_FAKE_MAX_VALUE || strlen(key) > 15)
+    return ESP_ERR_INVALID_ARG;
+  nvs_fake_entry_t *e = find(key);
+  for (int i = 0; !e && i < NVS_FAKE_MAX_KEYS; i++)
+    if (!staged[i].used)
+      e = &staged[i];
+  if (!e)
+    return ESP_ERR_NO_MEM;
+  e->used = true;
+  strcpy(e->key, key);
+  e->type = type;
+  e->len = len;
+  memcpy(e->value, value, len);
+  return ESP_OK;
+}
+
+static esp_err_t get(const char *key, uint8_t type, void *out, size_t *len) {
+  read_count++;
+  nvs_fake_entry_t *e = find(key);
+  if (!e || e->type != type)
+    return ESP_ERR_NVS_NOT_FOUND;
+  if (*len < e->len)
+    return ESP_ERR_INVALID_ARG;
+  memcpy(out, e->value, e->len);
+  *len = e->len;
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode,
+                   nvs_handle_t *out_handle) {
+  (void)namespace_name;
+  (void)open_mode;
+  *out_handle = 1;
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) { (void)handle; }
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  (void)handle;
+  commit_count++;
+  memcpy(durable, staged, sizeof(durable));
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+  (void)handle;
+  memset(staged, 0, sizeof(staged));
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+  (void)handle;
+  nvs_fake_entry_t *e = find(key);
+  if (!e)
+    return ESP_ERR_NVS_NOT_FOUND;
+  e->used = false;
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+  (void)handle;
+  return put(key, TYPE_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value) {
+  (void)handle;
+  return put(key, TYPE_U16, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value,
+                       size_t length) {
+  (void)handle;
+  return put(key, TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value) {
+  (void)handle;
+  size_t len = sizeof(*out_value);
+  return get(key, TYPE_U8, out_value, &len);
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key,
+                      uint16_t *out_value) {
+  (void)handle;
+  size_t len = sizeof(*out_value);
+  return get(key, TYPE_U16, out_value, &len);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value,
+                       size_t *length) {
+  (void)handle;
+  return get(key, TYPE_BLOB, out_value, length);
+}
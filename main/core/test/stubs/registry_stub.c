@@ -12,6 +12,7 @@ static int storage_save_descriptor_call_count = 0;
 static int storage_delete_descriptor_call_count = 0;
 static int storage_list_descriptors_call_count = 0;
 static int storage_load_descriptor_call_count = 0;
+static int descriptor_parse_call_count = 0;
 
 void registry_stub_reset_storage_counters(void) {
   storage_save_descriptor_call_count = 0;
@@ -41,11 +42,24 @@ bool key_get_fingerprint(unsigned char *fp) {
     memset(fp, 0, BIP32_KEY_FINGERPRINT_LEN);
   return true;
 }
-wallet_network_t wallet_get_network(void) { return WALLET_NETWORK_MAINNET; }
+static wallet_network_t stub_wallet_network = WALLET_NETWORK_MAINNET;
+
+void registry_stub_set_network(wallet_network_t network) {
+  stub_wallet_network = network;
+}
+
+wallet_network_t wallet_get_network(void) { return stub_wallet_network; }
+
+void registry_stub_reset_parse_counter(void) {
+  descriptor_parse_call_count = 0;
+}
+
+int registry_stub_parse_calls(void) { return descriptor_parse_call_count; }
 
 int wallet_descriptor_parse(const char *descriptor,
                             const struct wally_map *vars_in, uint32_t network,
                             struct wally_descriptor **output) {
+  descriptor_parse_call_count++;
   uint32_t flags = KERN_DESCRIPTOR_MAX_DEPTH << WALLY_MINISCRIPT_DEPTH_SHIFT;
   return wally_descriptor_parse(descriptor, vars_in, network, flags, output);
 }
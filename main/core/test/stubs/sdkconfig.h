@@ -0,0 +1,4 @@
+#pragma once
+
+/* Host tests build with every Kconfig option off, so developer-only hooks
+ * such as utils/perf.h compile to nothing. */
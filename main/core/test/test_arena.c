@@ -0,0 +1,650 @@
+/*
+ * Tests for the scratch arena (main/utils/arena.c), plus a heap
+ * fragmentation comparison of QR part reassembly with and without it.
+ *
+ * The comparison routes malloc/calloc/realloc/free (wrapped at link time, see
+ * Makefile) into a first-fit model of a small shared heap, then runs 1000 scan
+ * cycles of multi-part QR reassembly interleaved with the longer-lived
+ * allocations the rest of the firmware makes meanwhile. The reference keeps
+ * the previous per-part allocation scheme of main/qr/parser.c (a malloc for
+ * each part, its data and the pMofN payload copy, a realloc'd parts array);
+ * the other mirrors the parser's arena. Reported: the largest free block
+ * before and after the cycles, and the number of heap calls each made.
+ *
+ * Usage: test_arena [--bench]
+ */
+
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/arena.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+static void check(const char *name, bool ok, const char *msg) {
+  TEST(name);
+  if (ok)
+    PASS();
+  else
+    FAIL(msg);
+}
+
+static bool all_zero(const void *p, size_t len) {
+  const uint8_t *b = p;
+  for (size_t i = 0; i < len; i++) {
+    if (b[i])
+      return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Heap model: a first-fit allocator over a fixed region, standing in for the
+// shared heap while pool_on is set (-Wl,--wrap=malloc,...)
+// ---------------------------------------------------------------------------
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+#define POOL_SIZE (512 * 1024)
+#define POOL_HEADER 16
+#define POOL_MAX_EXTENTS 8192
+
+typedef struct {
+  uint32_t off;
+  uint32_t len;
+} extent_t;
+
+static alignas(16) uint8_t pool_mem[POOL_SIZE];
+static extent_t pool_free_list[POOL_MAX_EXTENTS]; /* sorted by offset */
+static int pool_extents;
+static bool pool_on = false;
+static size_t pool_calls;
+
+static void pool_init(void) {
+  pool_free_list[0] = (extent_t){0, POOL_SIZE};
+  pool_extents = 1;
+  pool_calls = 0;
+}
+
+static bool in_pool(const void *p) {
+  return (const uint8_t *)p >= pool_mem &&
+         (const uint8_t *)p < pool_mem + POOL_SIZE;
+}
+
+static void *pool_malloc(size_t size) {
+  pool_calls++;
+  uint32_t need = (uint32_t)((size + 15) & ~(size_t)15) + POOL_HEADER;
+  for (int i = 0; i < pool_extents; i++) {
+    extent_t *e = &pool_free_list[i];
+    if (e->len < need)
+      continue;
+    uint32_t off = e->off;
+    e->off += need;
+    e->len -= need;
+    if (e->len == 0) {
+      memmove(e, e + 1, (pool_extents - i - 1) * sizeof(*e));
+      pool_extents--;
+    }
+    memcpy(pool_mem + off, &need, sizeof(need));
+    return pool_mem + off + POOL_HEADER;
+  }
+  return NULL;
+}
+
+static uint32_t pool_block_size(const void *p) {
+  uint32_t len;
+  memcpy(&len, (const uint8_t *)p - POOL_HEADER, sizeof(len));
+  return len;
+}
+
+static void pool_release(void *p) {
+  uint32_t off = (uint32_t)((uint8_t *)p - pool_mem) - POOL_HEADER;
+  uint32_t len = pool_block_size(p);
+
+  int lo = 0, hi = pool_extents;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (pool_free_list[mid].off < off)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  bool join_prev = lo > 0 && pool_free_list[lo - 1].off +
+                                     pool_free_list[lo - 1].len ==
+                                 off;
+  bool join_next = lo < pool_extents && off + len == pool_free_list[lo].off;
+  if (join_prev && join_next) {
+    pool_free_list[lo - 1].len += len + pool_free_list[lo].len;
+    memmove(&pool_free_list[lo], &pool_free_list[lo + 1],
+            (pool_extents - lo - 1) * sizeof(extent_t));
+    pool_extents--;
+  } else if (join_prev) {
+    pool_free_list[lo - 1].len += len;
+  } else if (join_next) {
+    pool_free_list[lo].off = off;
+    pool_free_list[lo].len += len;
+  } else if (pool_extents < POOL_MAX_EXTENTS) {
+    memmove(&pool_free_list[lo + 1], &pool_free_list[lo],
+            (pool_extents - lo) * sizeof(extent_t));
+    pool_free_list[lo] = (extent_t){off, len};
+    pool_extents++;
+  }
+}
+
+static size_t pool_largest_free(void) {
+  size_t largest = 0;
+  for (int i = 0; i < pool_extents; i++) {
+    if (pool_free_list[i].len > largest)
+      largest = pool_free_list[i].len;
+  }
+  return largest > POOL_HEADER ? largest - POOL_HEADER : 0;
+}
+
+static size_t pool_total_free(void) {
+  size_t total = 0;
+  for (int i = 0; i < pool_extents; i++)
+    total += pool_free_list[i].len;
+  return total;
+}
+
+void *__wrap_malloc(size_t size) {
+  return pool_on ? pool_malloc(size) : __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  if (!pool_on)
+    return __real_calloc(n, size);
+  void *p = pool_malloc(n * size);
+  if (p)
+    memset(p, 0, n * size);
+  return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  if (!pool_on && !in_pool(ptr))
+    return __real_realloc(ptr, size);
+  void *out = pool_malloc(size);
+  if (out && ptr) {
+    size_t old = pool_block_size(ptr) - POOL_HEADER;
+    memcpy(out, ptr, old < size ? old : size);
+    pool_release(ptr);
+  }
+  return out;
+}
+
+void __wrap_free(void *ptr) {
+  if (!ptr)
+    return;
+  if (in_pool(ptr))
+    pool_release(ptr);
+  else
+    __real_free(ptr);
+}
+
+// ---------------------------------------------------------------------------
+// Arena unit tests
+// ---------------------------------------------------------------------------
+
+static void test_alloc_basics(void) {
+  arena_t a;
+  arena_init(&a, 256, ARENA_MEM_DEFAULT);
+  check("no chunk before first use", a.chunks == 0 && a.used == 0,
+        "init allocated");
+
+  bool aligned = true;
+  static const size_t sizes[] = {1, 3, 7, 13, 16, 31, 5, 100};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    void *p = arena_alloc(&a, sizes[i]);
+    aligned &= p && ((uintptr_t)p % alignof(max_align_t)) == 0;
+    memset(p, 0xA5, sizes[i]);
+  }
+  check("allocations are aligned for any type", aligned, "misaligned");
+  check("zero size gives NULL", arena_alloc(&a, 0) == NULL, "non-NULL");
+  check("calloc overflow gives NULL",
+        arena_calloc(&a, SIZE_MAX / 2, 4) == NULL, "non-NULL");
+
+  char *s = arena_strdup(&a, "tpubD6NzVbkrYhZ4");
+  char *n = arena_strndup(&a, "p1of3 abcdef", 5);
+  check("strdup / strndup copy and terminate",
+        s && strcmp(s, "tpubD6NzVbkrYhZ4") == 0 && n && strcmp(n, "p1of3") == 0,
+        "bad copy");
+  check("strdup of NULL", arena_strdup(&a, NULL) == NULL, "non-NULL");
+
+  size_t chunks = a.chunks;
+  uint8_t *big = arena_alloc(&a, 1000);
+  check("oversized request gets its own chunk",
+        big && a.chunks == chunks + 1, "no chunk");
+  check("peak tracks used", a.peak >= a.used && a.used >= 1000, "bad stats");
+
+  arena_destroy(&a);
+  check("destroy frees every chunk", a.chunks == 0 && a.used == 0,
+        "chunks left");
+  check("usable after destroy", arena_alloc(&a, 8) != NULL, "NULL");
+  arena_destroy(&a);
+}
+
+static void test_nested_scopes(void) {
+  arena_t a;
+  arena_init(&a, 128, ARENA_MEM_INTERNAL);
+
+  char *keep = arena_strdup(&a, "outer");
+  arena_mark_t outer = arena_mark(&a);
+  uint8_t *x = arena_alloc(&a, 32);
+  memset(x, 0xEE, 32);
+
+  arena_mark_t inner = arena_mark(&a);
+  uint8_t *y = arena_alloc(&a, 16);
+  memset(y, 0xDD, 16);
+  size_t used_inner = inner.used;
+  arena_rewind(&a, inner);
+  check("inner rewind restores usage", a.used == used_inner, "usage");
+  check("inner rewind wipes released bytes", all_zero(y, 16), "not wiped");
+  check("inner rewind keeps outer data", x[0] == 0xEE && x[31] == 0xEE,
+        "clobbered");
+  check("rewound space is reused", arena_alloc(&a, 16) == y, "not reused");
+
+  size_t chunks = a.chunks;
+  for (int i = 0; i < 10; i++)
+    memset(arena_alloc(&a, 100), 0xCC, 100);
+  check("scope spills into new chunks", a.chunks > chunks, "no spill");
+  arena_rewind(&a, outer);
+  check("outer rewind frees chunks opened since the mark", a.chunks == chunks,
+        "chunks kept");
+  check("outer rewind wipes its own chunk's tail", all_zero(x, 32),
+        "not wiped");
+  check("data from before the outer mark survives", strcmp(keep, "outer") == 0,
+        "clobbered");
+
+  arena_destroy(&a);
+
+  arena_init(&a, 64, ARENA_MEM_DEFAULT);
+  arena_mark_t empty = arena_mark(&a);
+  arena_alloc(&a, 40);
+  arena_alloc(&a, 40);
+  arena_rewind(&a, empty);
+  check("rewind to an empty mark releases everything",
+        a.chunks == 0 && a.used == 0, "chunks kept");
+  arena_destroy(&a);
+}
+
+static void test_reset_wipes(void) {
+  arena_t a;
+  arena_init(&a, 512, ARENA_MEM_PSRAM);
+  uint8_t *first = arena_alloc(&a, 64);
+  memset(first, 0x5A, 64);
+  for (int i = 0; i < 8; i++)
+    arena_alloc(&a, 200);
+  size_t peak = a.peak;
+
+  arena_reset(&a);
+  check("reset keeps one chunk", a.chunks == 1 && a.used == 0, "chunks");
+  check("reset wipes the kept chunk", all_zero(first, 64), "not wiped");
+  check("reset memory is reused from the start",
+        arena_alloc(&a, 64) == first, "not reused");
+  check("peak survives reset", a.peak == peak, "peak lost");
+  check("calloc after reset is zeroed", all_zero(arena_calloc(&a, 8, 8), 64),
+        "not zeroed");
+  arena_destroy(&a);
+}
+
+static void test_backings(void) {
+  static const arena_mem_t mems[] = {ARENA_MEM_DEFAULT, ARENA_MEM_INTERNAL,
+                                     ARENA_MEM_PSRAM};
+  bool ok = true;
+  for (size_t i = 0; i < 3; i++) {
+    arena_t a;
+    arena_init(&a, 0, mems[i]);
+    ok &= a.chunk_size == ARENA_DEFAULT_CHUNK_SIZE && a.mem == mems[i];
+    ok &= arena_alloc(&a, ARENA_DEFAULT_CHUNK_SIZE) != NULL && a.chunks == 1;
+    arena_destroy(&a);
+  }
+  check("every backing allocates (host heap stands in)", ok, "failed");
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the previous per-part allocation scheme of main/qr/parser.c
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  int index;
+  char *data;
+  size_t data_len;
+} part_t;
+
+typedef struct {
+  part_t **parts;
+  int capacity;
+  int count;
+  int total;
+} ref_parser_t;
+
+static ref_parser_t *ref_create(void) {
+  ref_parser_t *p = calloc(1, sizeof(*p));
+  if (!p)
+    return NULL;
+  p->capacity = 10;
+  p->parts = calloc(p->capacity, sizeof(part_t *));
+  if (!p->parts) {
+    free(p);
+    return NULL;
+  }
+  return p;
+}
+
+static void ref_add(ref_parser_t *p, int index, const char *data, size_t len) {
+  if (p->count >= p->capacity) {
+    part_t **grown = realloc(p->parts, p->capacity * 2 * sizeof(part_t *));
+    if (!grown)
+      return;
+    p->parts = grown;
+    p->capacity *= 2;
+  }
+  for (int i = 0; i < p->count; i++) {
+    if (p->parts[i]->index == index)
+      return;
+  }
+  part_t *part = calloc(1, sizeof(*part));
+  if (!part)
+    return;
+  part->index = index;
+  part->data = malloc(len + 1);
+  if (!part->data) {
+    free(part);
+    return;
+  }
+  memcpy(part->data, data, len);
+  part->data[len] = '\0';
+  part->data_len = len;
+  p->parts[p->count++] = part;
+}
+
+static void ref_parse(ref_parser_t *p, const char *frame) {
+  const char *space = strchr(frame, ' ');
+  const char *of = strstr(frame, "of");
+  size_t len = strlen(space + 1);
+  char *copy = malloc(len + 1); /* parse_pmofn_qr_part() */
+  if (!copy)
+    return;
+  memcpy(copy, space + 1, len + 1);
+  ref_add(p, atoi(frame + 1), copy, len);
+  p->total = atoi(of + 2);
+  free(copy);
+}
+
+static void ref_destroy(ref_parser_t *p) {
+  for (int i = 0; i < p->count; i++) {
+    free(p->parts[i]->data);
+    free(p->parts[i]);
+  }
+  free(p->parts);
+  free(p);
+}
+
+// ---------------------------------------------------------------------------
+// Arena-backed reassembly, as main/qr/parser.c now does it
+// ---------------------------------------------------------------------------
+
+#define PARSER_ARENA_CHUNK_SIZE 4096
+
+typedef struct {
+  part_t **parts;
+  int capacity;
+  int count;
+  int total;
+  arena_t arena;
+} arena_parser_t;
+
+static arena_parser_t *arena_parser_create(void) {
+  arena_parser_t *p = calloc(1, sizeof(*p));
+  if (!p)
+    return NULL;
+  arena_init(&p->arena, PARSER_ARENA_CHUNK_SIZE, ARENA_MEM_PSRAM);
+  p->capacity = 10;
+  p->parts = arena_calloc(&p->arena, p->capacity, sizeof(part_t *));
+  if (!p->parts) {
+    free(p);
+    return NULL;
+  }
+  return p;
+}
+
+static void arena_parser_add(arena_parser_t *p, int index, const char *data,
+                             size_t len) {
+  if (p->count >= p->capacity) {
+    part_t **grown = arena_alloc(&p->arena, p->capacity * 2 * sizeof(part_t *));
+    if (!grown)
+      return;
+    memcpy(grown, p->parts, p->count * sizeof(part_t *));
+    p->parts = grown;
+    p->capacity *= 2;
+  }
+  for (int i = 0; i < p->count; i++) {
+    if (p->parts[i]->index == index)
+      return;
+  }
+  part_t *part = arena_alloc(&p->arena, sizeof(*part));
+  if (!part)
+    return;
+  part->index = index;
+  part->data = arena_strndup(&p->arena, data, len);
+  if (!part->data)
+    return;
+  part->data_len = len;
+  p->parts[p->count++] = part;
+}
+
+static void arena_parser_parse(arena_parser_t *p, const char *frame) {
+  const char *space = strchr(frame, ' ');
+  const char *of = strstr(frame, "of");
+  arena_parser_add(p, atoi(frame + 1), space + 1, strlen(space + 1));
+  p->total = atoi(of + 2);
+}
+
+static void arena_parser_destroy(arena_parser_t *p) {
+  arena_destroy(&p->arena);
+  free(p);
+}
+
+// ---------------------------------------------------------------------------
+// Scan cycles
+// ---------------------------------------------------------------------------
+
+#define CYCLES 1000
+#define MAX_PARTS 24
+#define MAX_KEPT 512
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+/* Allocations made by the rest of the firmware while scanning (widgets,
+ * labels, the decoded result), each living for some cycles. */
+typedef struct {
+  void *ptr;
+  int expires;
+} kept_t;
+
+typedef struct {
+  size_t largest_before;
+  size_t largest_after;
+  size_t free_after;
+  int extents_after;
+  size_t heap_calls;
+  size_t parser_calls;
+  bool leak_free;
+} cycle_stats_t;
+
+static void expire(kept_t *kept, int now) {
+  for (int i = 0; i < MAX_KEPT; i++) {
+    if (kept[i].ptr && kept[i].expires <= now) {
+      free(kept[i].ptr);
+      kept[i].ptr = NULL;
+    }
+  }
+}
+
+static void keep(kept_t *kept, void *ptr, int expires) {
+  for (int i = 0; i < MAX_KEPT; i++) {
+    if (!kept[i].ptr) {
+      kept[i] = (kept_t){ptr, expires};
+      return;
+    }
+  }
+  free(ptr);
+}
+
+static cycle_stats_t run_cycles(bool use_arena, int cycles) {
+  static char frames[MAX_PARTS][700];
+  static kept_t kept[MAX_KEPT];
+  cycle_stats_t st = {0};
+
+  memset(kept, 0, sizeof(kept));
+  pool_init();
+  st.largest_before = pool_largest_free();
+  pool_on = true;
+  rng_state = 0x2545F491;
+
+  for (int c = 0; c < cycles; c++) {
+    int total = 4 + (int)(rng() % (MAX_PARTS - 4));
+    size_t part_len = 150 + rng() % 450;
+    for (int i = 0; i < total; i++) {
+      int n = snprintf(frames[i], sizeof(frames[i]), "p%dof%d ", i + 1, total);
+      for (size_t k = 0; k < part_len; k++)
+        frames[i][n + k] = (char)('A' + (rng() + k) % 26);
+      frames[i][n + part_len] = '\0';
+    }
+
+    size_t calls_before = pool_calls;
+    ref_parser_t *ref = use_arena ? NULL : ref_create();
+    arena_parser_t *ap = use_arena ? arena_parser_create() : NULL;
+    size_t parser_calls = pool_calls - calls_before;
+
+    /* Every part is seen about twice, in camera order. */
+    char *label = NULL;
+    for (int f = 0; f < 2 * total; f++) {
+      free(label);
+      label = malloc(24); /* progress text */
+      if (rng() % 8 == 0)
+        keep(kept, malloc(32 + rng() % 256), c + 1 + (int)(rng() % 40));
+
+      const char *frame = frames[rng() % total];
+      calls_before = pool_calls;
+      if (use_arena)
+        arena_parser_parse(ap, frame);
+      else
+        ref_parse(ref, frame);
+      parser_calls += pool_calls - calls_before;
+    }
+    for (int i = 0; i < total; i++) {
+      calls_before = pool_calls;
+      if (use_arena)
+        arena_parser_parse(ap, frames[i]);
+      else
+        ref_parse(ref, frames[i]);
+      parser_calls += pool_calls - calls_before;
+    }
+    free(label);
+
+    /* The combined result outlives the parser, the decoded PSBT a cycle. */
+    char *result = malloc(total * part_len + 1);
+    if (use_arena)
+      arena_parser_destroy(ap);
+    else
+      ref_destroy(ref);
+    keep(kept, malloc(total * part_len * 3 / 4), c + 1);
+    free(result);
+
+    expire(kept, c);
+    st.parser_calls += parser_calls;
+  }
+
+  st.largest_after = pool_largest_free();
+  st.free_after = pool_total_free();
+  st.extents_after = pool_extents;
+  st.heap_calls = pool_calls;
+
+  expire(kept, cycles + 1000);
+  st.leak_free = pool_extents == 1 && pool_total_free() == POOL_SIZE;
+  pool_on = false;
+  return st;
+}
+
+static void print_stats(const char *name, const cycle_stats_t *st) {
+  printf("  %-10s largest free %6zu -> %6zu B, free %6zu B in %4d blocks, "
+         "%7zu heap calls (%zu by the parser)\n",
+         name, st->largest_before, st->largest_after, st->free_after,
+         st->extents_after, st->heap_calls, st->parser_calls);
+}
+
+static void test_scan_cycles(void) {
+  cycle_stats_t ref = run_cycles(false, CYCLES);
+  cycle_stats_t arena = run_cycles(true, CYCLES);
+
+  printf("\n%d scan cycles on a %d KiB first-fit heap:\n", CYCLES,
+         POOL_SIZE / 1024);
+  print_stats("per-part", &ref);
+  print_stats("arena", &arena);
+  printf("\n");
+
+  check("per-part scheme leaves no leaks", ref.leak_free, "leak");
+  check("arena scheme leaves no leaks", arena.leak_free, "leak");
+  check("arena makes fewer heap calls",
+        arena.parser_calls * 4 < ref.parser_calls, "not fewer");
+  check("arena leaves a larger largest free block",
+        arena.largest_after >= ref.largest_after, "more fragmented");
+}
+
+static void bench(void) {
+  for (int cycles = 100; cycles <= 10000; cycles *= 10) {
+    cycle_stats_t ref = run_cycles(false, cycles);
+    cycle_stats_t arena = run_cycles(true, cycles);
+    printf("%d cycles:\n", cycles);
+    print_stats("per-part", &ref);
+    print_stats("arena", &arena);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench();
+    return 0;
+  }
+
+  printf("=== Arena Tests ===\n\n");
+  test_alloc_basics();
+  test_nested_scopes();
+  test_reset_wipes();
+  test_backings();
+  test_scan_cycles();
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
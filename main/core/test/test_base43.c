@@ -0,0 +1,407 @@
+/*
+ * Tests for the chunked base43 codec (main/core/base43.c).
+ *
+ * Known vectors come from Electrum's base_encode(..., base=43), which Krux
+ * follows. The reference is the previous implementation, which divided the
+ * input byte by byte for every digit; both must agree on random inputs with
+ * and without leading zero bytes, and on inputs of only zero bytes.
+ *
+ * Usage: test_base43 [--bench]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/base43.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+static void check(const char *name, bool ok, const char *msg) {
+  TEST(name);
+  if (ok)
+    PASS();
+  else
+    FAIL(msg);
+}
+
+/* --- Reference: the previous implementation ------------------------------ */
+
+static const char REF_CHARS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ$*+-./:";
+
+static int ref_char_to_digit(char c) {
+  for (int i = 0; i < 43; i++) {
+    if (REF_CHARS[i] == c)
+      return i;
+  }
+  return -1;
+}
+
+static bool ref_encode(const uint8_t *data, size_t data_len, char **out,
+                       size_t *out_len) {
+  size_t buf_cap = data_len * 2 + 1;
+  char *buf = malloc(buf_cap);
+  uint8_t *num = malloc(data_len);
+  if (!buf || !num) {
+    free(buf);
+    free(num);
+    return false;
+  }
+  size_t buf_len = 0;
+  memcpy(num, data, data_len);
+  size_t num_len = data_len;
+  while (num_len > 0) {
+    uint32_t remainder = 0;
+    size_t write_pos = 0;
+    for (size_t i = 0; i < num_len; i++) {
+      uint32_t val = remainder * 256 + num[i];
+      uint8_t quot = (uint8_t)(val / 43);
+      remainder = val % 43;
+      if (write_pos > 0 || quot > 0)
+        num[write_pos++] = quot;
+    }
+    buf[buf_len++] = REF_CHARS[remainder];
+    num_len = write_pos;
+  }
+  free(num);
+
+  size_t n_pad = 0;
+  while (n_pad < data_len && data[n_pad] == 0)
+    n_pad++;
+  char *result = malloc(n_pad + buf_len + 1);
+  if (!result) {
+    free(buf);
+    return false;
+  }
+  memset(result, REF_CHARS[0], n_pad);
+  for (size_t i = 0; i < buf_len; i++)
+    result[n_pad + i] = buf[buf_len - 1 - i];
+  result[n_pad + buf_len] = '\0';
+  free(buf);
+  *out = result;
+  *out_len = n_pad + buf_len;
+  return true;
+}
+
+static bool ref_decode(const char *str, size_t str_len, uint8_t **out,
+                       size_t *out_len) {
+  uint8_t *buf = calloc(str_len, 1);
+  if (!buf)
+    return false;
+  size_t buf_len = 0;
+  for (size_t i = 0; i < str_len; i++) {
+    int digit = ref_char_to_digit(str[i]);
+    if (digit < 0) {
+      free(buf);
+      return false;
+    }
+    uint32_t carry = (uint32_t)digit;
+    for (size_t j = buf_len; j > 0; j--) {
+      uint32_t val = (uint32_t)buf[j - 1] * 43 + carry;
+      buf[j - 1] = (uint8_t)(val & 0xFF);
+      carry = val >> 8;
+    }
+    while (carry > 0) {
+      memmove(buf + 1, buf, buf_len);
+      buf[0] = (uint8_t)(carry & 0xFF);
+      carry >>= 8;
+      buf_len++;
+    }
+  }
+  size_t n_pad = 0;
+  while (n_pad < str_len && str[n_pad] == REF_CHARS[0])
+    n_pad++;
+  uint8_t *result = malloc(n_pad + buf_len + 1);
+  if (!result) {
+    free(buf);
+    return false;
+  }
+  memset(result, 0, n_pad);
+  memcpy(result + n_pad, buf, buf_len);
+  free(buf);
+  *out = result;
+  *out_len = n_pad + buf_len;
+  return true;
+}
+
+/* --- Harness -------------------------------------------------------------- */
+
+typedef struct {
+  const char *hex;
+  const char *b43;
+} vector_t;
+
+static const vector_t VECTORS[] = {
+    {"01", "1"},
+    {"2a", ":"},
+    {"2b", "10"},
+    {"ff", "5."},
+    {"0001", "01"},
+    {"0000ff", "005."},
+    {"68656c6c6f20776f726c64", "-V6IR149FGZJH+5K"},
+    {"0102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f20",
+     "E9B8/QR97T6J6-2JMKM-91S9-6OCEFIPNI4+26K5/GPD0$"},
+    {"70736274ff01", "AO*93RGC7"},
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static size_t from_hex(const char *hex, uint8_t *out) {
+  size_t n = strlen(hex) / 2;
+  for (size_t i = 0; i < n; i++) {
+    unsigned v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    out[i] = (uint8_t)v;
+  }
+  return n;
+}
+
+/* xorshift32: reproducible inputs without touching rand()'s state. */
+static uint32_t rng_state = 0x2545F491u;
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void fill_random(uint8_t *buf, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    buf[i] = (uint8_t)rng();
+}
+
+/* Encodes data with both codecs, decodes with both, and checks that all four
+ * agree and round-trip. Returns NULL or what went wrong. Inputs of only zero
+ * bytes do not round-trip in Electrum either (see Group 3). */
+static const char *compare(const uint8_t *data, size_t len) {
+  char *enc = NULL, *ref_enc = NULL;
+  size_t enc_len = 0, ref_enc_len = 0;
+  uint8_t *dec = NULL, *ref_dec = NULL;
+  size_t dec_len = 0, ref_dec_len = 0;
+  const char *err = NULL;
+
+  if (!base43_encode(data, len, &enc, &enc_len) ||
+      !ref_encode(data, len, &ref_enc, &ref_enc_len))
+    err = "encode failed";
+  else if (enc_len != ref_enc_len || strlen(enc) != enc_len ||
+           memcmp(enc, ref_enc, enc_len) != 0)
+    err = "encoding differs from the previous one";
+  else if (!base43_decode(enc, enc_len, &dec, &dec_len) ||
+           !ref_decode(enc, enc_len, &ref_dec, &ref_dec_len))
+    err = "decode failed";
+  else if (dec_len != ref_dec_len || memcmp(dec, ref_dec, dec_len) != 0)
+    err = "decoding differs from the previous one";
+  else if (dec_len != len || memcmp(dec, data, len) != 0)
+    err = "round trip changed the data";
+
+  free(enc);
+  free(ref_enc);
+  free(dec);
+  free(ref_dec);
+  return err;
+}
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench(size_t len) {
+  uint8_t *data = malloc(len);
+  fill_random(data, len);
+  char *enc = NULL;
+  size_t enc_len = 0;
+  uint8_t *dec = NULL;
+  size_t dec_len = 0;
+
+  double t0 = now_us();
+  if (ref_encode(data, len, &enc, &enc_len))
+    free(enc);
+  double t1 = now_us();
+  if (!base43_encode(data, len, &enc, &enc_len)) {
+    free(data);
+    return;
+  }
+  double t2 = now_us();
+  if (ref_decode(enc, enc_len, &dec, &dec_len))
+    free(dec);
+  double t3 = now_us();
+  if (base43_decode(enc, enc_len, &dec, &dec_len))
+    free(dec);
+  double t4 = now_us();
+
+  printf("%3zu KB  encode previous %10.0f us  now %8.0f us   "
+         "decode previous %10.0f us  now %8.0f us\n",
+         len / 1024, t1 - t0, t2 - t1, t3 - t2, t4 - t3);
+  free(enc);
+  free(data);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    for (size_t kb = 1; kb <= 64; kb *= 2)
+      bench(kb * 1024);
+    return 0;
+  }
+
+  printf("=== base43 tests ===\n");
+
+  printf("\n--- Group 1: known vectors ---\n");
+  for (size_t i = 0; i < COUNT(VECTORS); i++) {
+    uint8_t bytes[64];
+    size_t len = from_hex(VECTORS[i].hex, bytes);
+    char *enc = NULL;
+    size_t enc_len = 0;
+    uint8_t *dec = NULL;
+    size_t dec_len = 0;
+    bool ok = base43_encode(bytes, len, &enc, &enc_len) &&
+              strcmp(enc, VECTORS[i].b43) == 0 &&
+              enc_len == strlen(VECTORS[i].b43) &&
+              base43_decode(VECTORS[i].b43, strlen(VECTORS[i].b43), &dec,
+                            &dec_len) &&
+              dec_len == len && memcmp(dec, bytes, len) == 0;
+    char name[96];
+    snprintf(name, sizeof(name), "vector %s", VECTORS[i].hex);
+    check(name, ok, enc ? enc : "encode failed");
+    free(enc);
+    free(dec);
+  }
+
+  printf("\n--- Group 2: random inputs match the previous codec ---\n");
+  {
+    uint8_t *buf = malloc(4096);
+    const char *err = NULL;
+    int cases = 0;
+    for (size_t len = 1; len <= 300 && !err; len++) {
+      for (int rep = 0; rep < 4 && !err; rep++) {
+        fill_random(buf, len);
+        /* Some with leading zero bytes, some with a low first byte; never
+         * all zeros (Group 3). */
+        size_t zeros = rep == 1 ? rng() % 4 : 0;
+        for (size_t z = 0; z < zeros && z < len - 1; z++)
+          buf[z] = 0;
+        if (rep == 2)
+          buf[0] &= 0x03;
+        if (buf[len - 1] == 0)
+          buf[len - 1] = 1;
+        err = compare(buf, len);
+        cases++;
+      }
+    }
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%d inputs up to 300 bytes", cases);
+    check(msg, !err, err ? err : "");
+
+    err = NULL;
+    for (size_t len = 1000; len <= 4096 && !err; len += 517) {
+      fill_random(buf, len);
+      err = compare(buf, len);
+    }
+    check("inputs of 1-4 KB", !err, err ? err : "");
+
+    memset(buf, 0xFF, 4096);
+    check("all-0xFF input", !compare(buf, 4096), "mismatch");
+
+    /* Only the encodings and decodings agree here, the round trip does not */
+    err = NULL;
+    for (size_t len = 1; len <= 40 && !err; len++) {
+      memset(buf, 0, len);
+      char *enc = NULL, *ref_enc = NULL;
+      size_t enc_len = 0, ref_enc_len = 0;
+      uint8_t *dec = NULL, *ref_dec = NULL;
+      size_t dec_len = 0, ref_dec_len = 0;
+      if (!base43_encode(buf, len, &enc, &enc_len) ||
+          !ref_encode(buf, len, &ref_enc, &ref_enc_len) ||
+          enc_len != ref_enc_len || memcmp(enc, ref_enc, enc_len) != 0)
+        err = "encoding differs from the previous one";
+      else if (!base43_decode(enc, enc_len, &dec, &dec_len) ||
+               !ref_decode(enc, enc_len, &ref_dec, &ref_dec_len) ||
+               dec_len != ref_dec_len || memcmp(dec, ref_dec, dec_len) != 0)
+        err = "decoding differs from the previous one";
+      free(enc);
+      free(ref_enc);
+      free(dec);
+      free(ref_dec);
+    }
+    check("all-zero inputs of 1-40 bytes", !err, err ? err : "");
+    free(buf);
+  }
+
+  printf("\n--- Group 3: edges ---\n");
+  {
+    char *enc = NULL;
+    size_t enc_len = 1;
+    check("empty input encodes to an empty string",
+          base43_encode((const uint8_t *)"", 0, &enc, &enc_len) &&
+              enc_len == 0 && enc[0] == '\0',
+          "not empty");
+    free(enc);
+
+    /* Electrum's base_encode writes the zero value as one '0' and then one
+     * per leading zero byte; its base_decode turns every leading '0' into a
+     * zero byte. Wire format, so pinned to its output. */
+    static const struct {
+      size_t zeros;
+      const char *b43;
+    } ZERO_VECTORS[] = {
+        {1, "00"},
+        {3, "0000"},
+        {32, "000000000000000000000000000000000"},
+    };
+    uint8_t zeros[33] = {0}; /* room for the extra decoded byte */
+    uint8_t *dec = NULL;
+    size_t dec_len = 0;
+    for (size_t i = 0; i < COUNT(ZERO_VECTORS); i++) {
+      size_t n = ZERO_VECTORS[i].zeros;
+      const char *want = ZERO_VECTORS[i].b43;
+      enc = NULL;
+      dec = NULL;
+      bool ok = base43_encode(zeros, n, &enc, &enc_len) &&
+                strcmp(enc, want) == 0 && enc_len == n + 1 &&
+                base43_decode(want, strlen(want), &dec, &dec_len) &&
+                dec_len == n + 1 && memcmp(dec, zeros, dec_len) == 0;
+      char name[64];
+      snprintf(name, sizeof(name), "%zu zero bytes encode as Electrum does",
+               n);
+      check(name, ok, enc ? enc : "encode failed");
+      free(enc);
+      free(dec);
+    }
+
+    dec = NULL;
+    check("empty string is rejected", !base43_decode("", 0, &dec, &dec_len),
+          "accepted");
+    check("lowercase is rejected", !base43_decode("AB1c", 4, &dec, &dec_len),
+          "accepted");
+    check("NUL is rejected", !base43_decode("AB\0C", 4, &dec, &dec_len),
+          "accepted");
+    check("high byte is rejected",
+          !base43_decode("AB\xC3\x89", 4, &dec, &dec_len), "accepted");
+    check("decode reads only str_len characters",
+          base43_decode("5.garbage", 2, &dec, &dec_len) && dec_len == 1 &&
+              dec[0] == 0xFF,
+          "wrong length handling");
+    free(dec);
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,468 @@
+#include "utils/bip39_filter.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <wally_bip39.h>
+#include <wally_core.h>
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                              \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "FAIL: %s\n", message);                                  \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+/* --- Reference: the original linear-scan implementation ------------------ */
+
+static struct words *ref_wordlist = NULL;
+
+static uint32_t ref_valid_letters(const char *prefix, int prefix_len) {
+  uint32_t mask = 0;
+  for (int letter = 0; letter < 26; letter++) {
+    char test_prefix[BIP39_MAX_PREFIX_LEN + 2];
+    int test_len = prefix_len + 1;
+
+    if (prefix && prefix_len > 0) {
+      int copy_len =
+          prefix_len < BIP39_MAX_PREFIX_LEN ? prefix_len : BIP39_MAX_PREFIX_LEN;
+      memcpy(test_prefix, prefix, copy_len);
+      test_prefix[copy_len] = 'a' + letter;
+      test_prefix[copy_len + 1] = '\0';
+    } else {
+      test_prefix[0] = 'a' + letter;
+      test_prefix[1] = '\0';
+      test_len = 1;
+    }
+
+    for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
+      const char *word = bip39_get_word_by_index(ref_wordlist, i);
+      if (word && strncmp(word, test_prefix, test_len) == 0) {
+        mask |= (1u << letter);
+        break;
+      }
+    }
+  }
+  return mask;
+}
+
+static int ref_by_prefix(const char *prefix, int prefix_len,
+                         const char **out_words, int max_words) {
+  int count = 0;
+  if (!prefix || prefix_len <= 0)
+    return 0;
+  for (size_t i = 0; i < BIP39_WORDLIST_SIZE && count < max_words; i++) {
+    const char *word = bip39_get_word_by_index(ref_wordlist, i);
+    if (word && strncmp(word, prefix, prefix_len) == 0)
+      out_words[count++] = word;
+  }
+  return count;
+}
+
+static int ref_count_matches(const char *prefix, int prefix_len) {
+  int count = 0;
+  if (!prefix || prefix_len <= 0)
+    return BIP39_WORDLIST_SIZE;
+  for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
+    const char *word = bip39_get_word_by_index(ref_wordlist, i);
+    if (word && strncmp(word, prefix, prefix_len) == 0)
+      count++;
+  }
+  return count;
+}
+
+static int ref_word_index(const char *word) {
+  for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
+    const char *w = bip39_get_word_by_index(ref_wordlist, i);
+    if (w && strcmp(w, word) == 0)
+      return (int)i;
+  }
+  return -1;
+}
+
+static int ref_valid_last_words(const char entered_words[24][16],
+                                int word_count, const char **out_words,
+                                int max_words) {
+  size_t checksum_bits = word_count / 3;
+  size_t entropy_bytes = ((word_count * 11) - checksum_bits) / 8;
+  size_t last_word_entropy_bits = 11 - checksum_bits;
+  int num_possibilities = 1 << last_word_entropy_bits;
+
+  uint8_t packed[32] = {0};
+  int bit_pos = 0;
+  for (int i = 0; i < word_count - 1; i++) {
+    int idx = ref_word_index(entered_words[i]);
+    if (idx < 0)
+      return 0;
+    for (int b = 10; b >= 0; b--) {
+      if (idx & (1 << b))
+        packed[bit_pos / 8] |= (1 << (7 - (bit_pos % 8)));
+      bit_pos++;
+    }
+  }
+
+  int count = 0;
+  for (int entropy_val = 0;
+       entropy_val < num_possibilities && count < max_words; entropy_val++) {
+    uint8_t test_packed[32];
+    memcpy(test_packed, packed, sizeof(test_packed));
+    int test_bit_pos = bit_pos;
+    for (int b = last_word_entropy_bits - 1; b >= 0; b--) {
+      int byte_idx = test_bit_pos / 8;
+      int bit_idx = 7 - (test_bit_pos % 8);
+      if (entropy_val & (1 << b))
+        test_packed[byte_idx] |= (1 << bit_idx);
+      else
+        test_packed[byte_idx] &= ~(1 << bit_idx);
+      test_bit_pos++;
+    }
+
+    char *mnemonic = NULL;
+    if (bip39_mnemonic_from_bytes(NULL, test_packed, entropy_bytes,
+                                  &mnemonic) != WALLY_OK)
+      continue;
+    char *last_space = strrchr(mnemonic, ' ');
+    if (last_space) {
+      int idx = ref_word_index(last_space + 1);
+      if (idx >= 0)
+        out_words[count++] = bip39_get_word_by_index(ref_wordlist, idx);
+    }
+    wally_free_string(mnemonic);
+  }
+  return count;
+}
+
+/* --- Equivalence ---------------------------------------------------------- */
+
+static bool same_words(const char **a, int a_count, const char **b,
+                       int b_count) {
+  if (a_count != b_count)
+    return false;
+  for (int i = 0; i < a_count; i++) {
+    if (a[i] != b[i])
+      return false;
+  }
+  return true;
+}
+
+/* Match count only: cheap enough to probe every miss. */
+static void check_prefix_count(const char *prefix, int prefix_len) {
+  if (bip39_filter_count_matches(prefix, prefix_len) !=
+      ref_count_matches(prefix, prefix_len)) {
+    fprintf(stderr, "FAIL: match count for \"%.*s\"\n", prefix_len,
+            prefix ? prefix : "");
+    failures++;
+  }
+}
+
+static void check_prefix(const char *prefix, int prefix_len) {
+  check_prefix_count(prefix, prefix_len);
+  if (bip39_filter_get_valid_letters(prefix, prefix_len) !=
+      ref_valid_letters(prefix, prefix_len)) {
+    fprintf(stderr, "FAIL: valid letters for \"%.*s\"\n", prefix_len,
+            prefix ? prefix : "");
+    failures++;
+  }
+
+  const char *got[BIP39_WORDLIST_SIZE];
+  const char *want[BIP39_WORDLIST_SIZE];
+  const int limits[] = {1, BIP39_MAX_FILTERED_WORDS, BIP39_WORDLIST_SIZE};
+  for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); i++) {
+    int got_count = bip39_filter_by_prefix(prefix, prefix_len, got, limits[i]);
+    int want_count = ref_by_prefix(prefix, prefix_len, want, limits[i]);
+    if (!same_words(got, got_count, want, want_count)) {
+      fprintf(stderr, "FAIL: filtered words for \"%.*s\" (max %d)\n",
+              prefix_len, prefix ? prefix : "", limits[i]);
+      failures++;
+    }
+  }
+}
+
+static void test_word_prefixes(void) {
+  // Every distinct prefix of every word, and every one-letter extension of
+  // those prefixes (which covers all the misses next to a hit)
+  const char *prev = NULL;
+  for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
+    const char *word = bip39_get_word_by_index(ref_wordlist, i);
+    int len = (int)strlen(word);
+    for (int n = 1; n <= len; n++) {
+      if (prev && strncmp(prev, word, n) == 0)
+        continue;
+      char prefix[BIP39_MAX_PREFIX_LEN + 2];
+      memcpy(prefix, word, n);
+      check_prefix(prefix, n);
+      if (n <= BIP39_MAX_PREFIX_LEN) {
+        for (char c = 'a'; c <= 'z'; c++) {
+          prefix[n] = c;
+          check_prefix_count(prefix, n + 1);
+        }
+      }
+    }
+    prev = word;
+  }
+}
+
+static void test_short_prefixes(void) {
+  // All one-, two- and three-letter strings
+  char prefix[3];
+  for (char a = 'a'; a <= 'z'; a++) {
+    prefix[0] = a;
+    check_prefix(prefix, 1);
+    for (char b = 'a'; b <= 'z'; b++) {
+      prefix[1] = b;
+      check_prefix(prefix, 2);
+      for (char c = 'a'; c <= 'z'; c++) {
+        prefix[2] = c;
+        check_prefix_count(prefix, 3);
+      }
+    }
+  }
+
+  check_prefix("", 0);
+  check_prefix(NULL, 0);
+  check_prefix("ABANDON", 7);
+  check_prefix("ab1", 3);
+  check_prefix("abandonxx", 9);
+}
+
+static void test_word_index(void) {
+  for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
+    const char *word = bip39_get_word_by_index(ref_wordlist, i);
+    if (bip39_filter_get_word_index(word) != (int)i) {
+      fprintf(stderr, "FAIL: index of \"%s\"\n", word);
+      failures++;
+    }
+
+    // Truncations and extensions only match when they are words themselves
+    char probe[16];
+    int len = (int)strlen(word);
+    for (int n = 1; n < len; n++) {
+      memcpy(probe, word, n);
+      probe[n] = '\0';
+      if (bip39_filter_get_word_index(probe) != ref_word_index(probe)) {
+        fprintf(stderr, "FAIL: index of \"%s\"\n", probe);
+        failures++;
+      }
+    }
+    snprintf(probe, sizeof(probe), "%sa", word);
+    CHECK(bip39_filter_get_word_index(probe) == ref_word_index(probe),
+          "index of extended word");
+  }
+
+  CHECK(bip39_filter_get_word_index("") == -1, "empty word");
+  CHECK(bip39_filter_get_word_index(NULL) == -1, "NULL word");
+  CHECK(bip39_filter_get_word_index("Abandon") == -1, "uppercase word");
+}
+
+static uint32_t lcg_state = 12345;
+
+static uint32_t lcg_next(void) {
+  lcg_state = lcg_state * 1103515245u + 12345u;
+  return (lcg_state >> 8) & 0xFFFFFF;
+}
+
+static void fill_random_words(char entered_words[24][16], int word_count) {
+  memset(entered_words, 0, 24 * 16);
+  for (int i = 0; i < word_count - 1; i++) {
+    const char *word =
+        bip39_get_word_by_index(ref_wordlist, lcg_next() % BIP39_WORDLIST_SIZE);
+    snprintf(entered_words[i], 16, "%s", word);
+  }
+}
+
+static void check_last_words(const char entered_words[24][16],
+                             int word_count) {
+  const char *got[128];
+  const char *want[128];
+
+  bip39_filter_clear_last_word_cache();
+  int got_count =
+      bip39_filter_get_valid_last_words(entered_words, word_count, got, 128);
+  int want_count = ref_valid_last_words(entered_words, word_count, want, 128);
+  CHECK(same_words(got, got_count, want, want_count), "valid last words");
+  CHECK(got_count == (word_count == 12 ? 128 : 8), "last word candidates");
+
+  // The cached helpers must agree with filtering the full candidate list
+  for (int w = 0; w < want_count; w++) {
+    const char *word = want[w];
+    int len = (int)strlen(word);
+    for (int n = 0; n <= len; n++) {
+      uint32_t mask = 0;
+      const char *filtered[128];
+      int filtered_count = 0;
+      for (int k = 0; k < want_count; k++) {
+        if (strncmp(want[k], word, n) != 0)
+          continue;
+        filtered[filtered_count++] = want[k];
+        if ((int)strlen(want[k]) > n)
+          mask |= 1u << (want[k][n] - 'a');
+      }
+
+      CHECK(bip39_filter_get_valid_letters_for_last_word(
+                entered_words, word_count, word, n) == mask,
+            "valid letters for last word");
+
+      const char *out[128];
+      int out_count = bip39_filter_last_word_by_prefix(
+          entered_words, word_count, word, n, out, 128);
+      CHECK(same_words(out, out_count, filtered, filtered_count),
+            "last words by prefix");
+    }
+  }
+}
+
+static void test_last_words(void) {
+  char entered_words[24][16];
+
+  // "abandon" x 11 completes with "about" among others
+  memset(entered_words, 0, sizeof(entered_words));
+  for (int i = 0; i < 11; i++)
+    strcpy(entered_words[i], "abandon");
+  const char *out[128];
+  bip39_filter_clear_last_word_cache();
+  int count = bip39_filter_get_valid_last_words(entered_words, 12, out, 128);
+  bool found_about = false;
+  for (int i = 0; i < count; i++)
+    found_about |= strcmp(out[i], "about") == 0;
+  CHECK(found_about, "\"about\" completes abandon x 11");
+
+  for (int round = 0; round < 64; round++) {
+    fill_random_words(entered_words, 12);
+    check_last_words(entered_words, 12);
+    fill_random_words(entered_words, 24);
+    check_last_words(entered_words, 24);
+  }
+
+  // Truncated candidate list keeps the first entries in order
+  fill_random_words(entered_words, 12);
+  const char *want[128];
+  int want_count = ref_valid_last_words(entered_words, 12, want, 128);
+  bip39_filter_clear_last_word_cache();
+  count = bip39_filter_get_valid_last_words(entered_words, 12, out, 5);
+  CHECK(count == 5 && want_count == 128 && same_words(out, 5, want, 5),
+        "truncated last words");
+
+  // An unknown word yields no candidates
+  strcpy(entered_words[3], "notaword");
+  bip39_filter_clear_last_word_cache();
+  CHECK(bip39_filter_get_valid_last_words(entered_words, 12, out, 128) == 0,
+        "unknown word");
+  CHECK(bip39_filter_get_valid_last_words(entered_words, 18, out, 128) == 0,
+        "unsupported word count");
+}
+
+/* --- Benchmark (run with --bench) ----------------------------------------- */
+
+static double elapsed_us(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e6 +
+         (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Replays what the keyboard asks for while a word is typed letter by letter:
+ * letter mask, match count and suggestions after every keystroke, then the
+ * index of the finished word. */
+static volatile uint32_t bench_sink;
+
+static void type_word_new(const char *word) {
+  const char *out[BIP39_MAX_FILTERED_WORDS];
+  int len = (int)strlen(word);
+  for (int n = 0; n <= len; n++) {
+    bench_sink += bip39_filter_get_valid_letters(word, n);
+    bench_sink += bip39_filter_count_matches(word, n);
+    bench_sink +=
+        bip39_filter_by_prefix(word, n, out, BIP39_MAX_FILTERED_WORDS);
+  }
+  bench_sink += bip39_filter_get_word_index(word);
+}
+
+static void type_word_ref(const char *word) {
+  const char *out[BIP39_MAX_FILTERED_WORDS];
+  int len = (int)strlen(word);
+  for (int n = 0; n <= len; n++) {
+    bench_sink += ref_valid_letters(word, n);
+    bench_sink += ref_count_matches(word, n);
+    bench_sink += ref_by_prefix(word, n, out, BIP39_MAX_FILTERED_WORDS);
+  }
+  bench_sink += ref_word_index(word);
+}
+
+static void run_bench(void) {
+  struct timespec start;
+  const int rounds = 4;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++)
+      type_word_ref(bip39_get_word_by_index(ref_wordlist, i));
+  }
+  double ref_us = elapsed_us(&start) / (rounds * BIP39_WORDLIST_SIZE);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int r = 0; r < rounds * 64; r++) {
+    for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++)
+      type_word_new(bip39_get_word_by_index(ref_wordlist, i));
+  }
+  double new_us = elapsed_us(&start) / (rounds * 64 * BIP39_WORDLIST_SIZE);
+
+  printf("typing one word:   linear %9.2f us   trie %9.2f us   (x%.0f)\n",
+         ref_us, new_us, new_us > 0 ? ref_us / new_us : 0);
+
+  char entered_words[24][16];
+  const char *out[128];
+  const int mnemonics = 16;
+
+  fill_random_words(entered_words, 12);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int r = 0; r < mnemonics; r++)
+    bench_sink += ref_valid_last_words(entered_words, 12, out, 128);
+  ref_us = elapsed_us(&start) / mnemonics;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int r = 0; r < mnemonics * 16; r++) {
+    bip39_filter_clear_last_word_cache();
+    bench_sink +=
+        bip39_filter_get_valid_last_words(entered_words, 12, out, 128);
+  }
+  new_us = elapsed_us(&start) / (mnemonics * 16);
+
+  printf("12-word last word: linear %9.2f us   trie %9.2f us   (x%.0f)\n",
+         ref_us, new_us, new_us > 0 ? ref_us / new_us : 0);
+}
+
+int main(int argc, char **argv) {
+  if (bip39_get_wordlist(NULL, &ref_wordlist) != WALLY_OK || !ref_wordlist) {
+    fprintf(stderr, "FAIL: wordlist\n");
+    return 1;
+  }
+
+  CHECK(bip39_filter_get_valid_letters("ab", 2) == 0xFFFFFFFF,
+        "letters before init");
+  CHECK(bip39_filter_count_matches("ab", 2) == 0, "count before init");
+  CHECK(bip39_filter_init(), "init");
+  CHECK(bip39_filter_init(), "second init");
+
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    run_bench();
+    return 0;
+  }
+
+  test_word_prefixes();
+  test_short_prefixes();
+  test_word_index();
+  test_last_words();
+
+  if (failures) {
+    fprintf(stderr, "%d bip39 filter test(s) failed\n", failures);
+    return 1;
+  }
+
+  puts("All bip39 filter tests passed");
+  return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * Tests for the UI deadline scheduler core (main/ui/deadline_queue.c): wait
+ * times, slack coalescing, periodic re-arming, clock wraparound, callbacks
+ * that re-arm or remove deadlines while a wakeup runs, and the wakeups an
+ * idle home screen costs with the session and battery deadlines on it.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ui/deadline_queue.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+static void check(const char *name, bool ok, const char *msg) {
+  TEST(name);
+  if (ok)
+    PASS();
+  else
+    FAIL(msg);
+}
+
+static int runs[DEADLINE_QUEUE_MAX];
+
+static void count_cb(void *user_data) { runs[(intptr_t)user_data]++; }
+
+static deadline_queue_t q;
+static int victim = -1;
+static int rearm_id = -1;
+
+static void remove_victim_cb(void *user_data) {
+  count_cb(user_data);
+  deadline_queue_remove(&q, victim);
+}
+
+static void remove_self_cb(void *user_data) {
+  count_cb(user_data);
+  deadline_queue_remove(&q, (int)(intptr_t)user_data);
+}
+
+static void rearm_self_cb(void *user_data) {
+  count_cb(user_data);
+  deadline_queue_arm(&q, rearm_id, 0, 500, 0);
+}
+
+// Session model: idle at 10 s, screensaver 110 s later, then nothing until
+// input.
+static int session_id = -1;
+static uint32_t session_now = 0;
+
+static void session_model_cb(void *user_data) {
+  (void)user_data;
+  if (session_now < 120000)
+    deadline_queue_arm(&q, session_id, session_now, 120000 - session_now, 0);
+}
+
+static void reset(void) {
+  deadline_queue_init(&q);
+  for (int i = 0; i < DEADLINE_QUEUE_MAX; i++)
+    runs[i] = 0;
+}
+
+static int add(int tag, uint32_t slack) {
+  return deadline_queue_add(&q, count_cb, (void *)(intptr_t)tag, slack);
+}
+
+/* Steps a clock from `from` to `to` the way the LVGL timer would: sleep
+ * until the next wakeup, run it. Returns the wakeups taken. */
+static uint32_t drive(uint32_t from, uint32_t to) {
+  uint32_t before = q.wakeups;
+  uint32_t now = from;
+  uint32_t wait;
+  while (deadline_queue_wait(&q, now, &wait) && now + wait <= to) {
+    now += wait;
+    session_now = now;
+    deadline_queue_run(&q, now);
+  }
+  return q.wakeups - before;
+}
+
+int main(void) {
+  printf("=== deadline queue tests ===\n");
+
+  printf("\n--- Group 1: arming and waiting ---\n");
+  {
+    reset();
+    uint32_t wait;
+    check("empty queue has no wait", !deadline_queue_wait(&q, 0, &wait),
+          "wait on empty queue");
+    int a = add(0, 0);
+    check("added deadline starts disarmed",
+          a >= 0 && !deadline_queue_armed(&q, a) &&
+              !deadline_queue_wait(&q, 0, &wait),
+          "armed on add");
+
+    deadline_queue_arm(&q, a, 1000, 250, 0);
+    check("wait is the delay", deadline_queue_wait(&q, 1000, &wait) &&
+                                   wait == 250,
+          "wrong wait");
+    check("not run early", deadline_queue_run(&q, 1249) == 0 && runs[0] == 0,
+          "ran early");
+    check("runs when due", deadline_queue_run(&q, 1250) == 1 && runs[0] == 1,
+          "did not run");
+    check("one-shot disarms", !deadline_queue_armed(&q, a) &&
+                                  deadline_queue_run(&q, 5000) == 0,
+          "ran twice");
+
+    deadline_queue_arm(&q, a, 0, 100, 0);
+    deadline_queue_arm(&q, a, 0, 300, 0);
+    check("re-arming moves it", deadline_queue_run(&q, 100) == 0 &&
+                                    deadline_queue_run(&q, 300) == 1,
+          "old due kept");
+    deadline_queue_arm(&q, a, 0, 100, 0);
+    deadline_queue_cancel(&q, a);
+    check("cancel", deadline_queue_run(&q, 100) == 0, "cancelled ran");
+
+    check("overdue waits 0", (deadline_queue_arm(&q, a, 0, 10, 0),
+                              deadline_queue_wait(&q, 50, &wait)) &&
+                                 wait == 0,
+          "negative wait");
+  }
+  {
+    reset();
+    int ids = 0;
+    while (add(ids, 0) >= 0)
+      ids++;
+    check("table holds DEADLINE_QUEUE_MAX", ids == DEADLINE_QUEUE_MAX,
+          "wrong capacity");
+    deadline_queue_remove(&q, 3);
+    check("removed slot is reused", add(99, 0) == 3, "slot not reused");
+    check("bad ids are ignored",
+          (deadline_queue_arm(&q, -1, 0, 0, 0),
+           deadline_queue_arm(&q, DEADLINE_QUEUE_MAX, 0, 0, 0),
+           deadline_queue_run(&q, 0) == 0),
+          "bad id armed");
+    check("no callback, no deadline",
+          deadline_queue_add(&q, NULL, NULL, 0) == -1, "NULL cb added");
+  }
+
+  printf("\n--- Group 2: slack and periods ---\n");
+  {
+    reset();
+    int tight = add(0, 0);
+    int loose = add(1, 5000);
+    deadline_queue_arm(&q, tight, 0, 1000, 0);
+    deadline_queue_arm(&q, loose, 0, 800, 0);
+    uint32_t wait;
+    check("slack defers the wakeup to the tight one",
+          deadline_queue_wait(&q, 0, &wait) && wait == 1000, "wrong wait");
+    deadline_queue_run(&q, 1000);
+    check("both run in one wakeup",
+          runs[0] == 1 && runs[1] == 1 && q.wakeups == 1, "not coalesced");
+
+    deadline_queue_arm(&q, loose, 1000, 800, 0);
+    check("alone, slack is used up",
+          deadline_queue_wait(&q, 1000, &wait) && wait == 5800, "wrong wait");
+  }
+  {
+    reset();
+    int p = add(0, 0);
+    deadline_queue_arm(&q, p, 0, 100, 100);
+    deadline_queue_run(&q, 100);
+    deadline_queue_run(&q, 200);
+    check("periodic runs every period", runs[0] == 2, "wrong count");
+    deadline_queue_run(&q, 1000);
+    uint32_t wait;
+    check("missed periods collapse into one run",
+          runs[0] == 3 && deadline_queue_wait(&q, 1000, &wait) &&
+              wait == 100,
+          "ran back to back");
+  }
+  {
+    reset();
+    int a = add(0, 0);
+    uint32_t near_wrap = UINT32_MAX - 50;
+    deadline_queue_arm(&q, a, near_wrap, 100, 0);
+    uint32_t wait;
+    check("wait across the wrap",
+          deadline_queue_wait(&q, near_wrap, &wait) && wait == 100,
+          "wrong wait");
+    check("not due before the wrap", deadline_queue_run(&q, UINT32_MAX) == 0,
+          "ran early");
+    check("due after the wrap", deadline_queue_run(&q, 49) == 1,
+          "did not run");
+  }
+
+  printf("\n--- Group 3: callbacks changing the queue ---\n");
+  {
+    reset();
+    int first = deadline_queue_add(&q, remove_victim_cb, (void *)0, 0);
+    victim = add(1, 0);
+    deadline_queue_arm(&q, first, 0, 10, 0);
+    deadline_queue_arm(&q, victim, 0, 10, 0);
+    deadline_queue_run(&q, 10);
+    check("a deadline removed by an earlier callback does not run",
+          runs[0] == 1 && runs[1] == 0, "removed deadline ran");
+  }
+  {
+    reset();
+    int self = deadline_queue_add(&q, remove_self_cb, (void *)0, 0);
+    deadline_queue_arm(&q, self, 0, 10, 10);
+    deadline_queue_run(&q, 10);
+    deadline_queue_run(&q, 20);
+    check("a periodic deadline can remove itself", runs[0] == 1,
+          "ran after removal");
+  }
+  {
+    reset();
+    rearm_id = deadline_queue_add(&q, rearm_self_cb, (void *)0, 0);
+    deadline_queue_arm(&q, rearm_id, 0, 10, 0);
+    deadline_queue_run(&q, 10);
+    check("a one-shot re-armed from its callback stays armed",
+          deadline_queue_armed(&q, rearm_id), "re-arm lost");
+    deadline_queue_run(&q, 500);
+    check("and runs again", runs[0] == 2, "did not run again");
+  }
+
+  printf("\n--- Group 4: idle home screen ---\n");
+  {
+    // What the home screen leaves armed once the user walks away: the
+    // session deadline (idle at 10 s, then the screensaver at 120 s), the
+    // battery label (30 s, 10 s slack) and the battery log (10 min, 1 min
+    // slack). The fixed-period timers this replaces woke the LVGL task 62
+    // times a minute.
+    reset();
+    session_id = deadline_queue_add(&q, session_model_cb, NULL, 0);
+    int battery = add(1, 10000);
+    int log = add(2, 60000);
+    deadline_queue_arm(&q, session_id, 0, 10000, 0);
+    deadline_queue_arm(&q, battery, 0, 30000, 30000);
+    deadline_queue_arm(&q, log, 0, 600000, 600000);
+
+    uint32_t first_minute = drive(0, 60000);
+    uint32_t ten_minutes = drive(60000, 660000);
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%u in the first minute, %u over the next ten",
+             (unsigned)first_minute, (unsigned)ten_minutes);
+    printf("  idle home screen: %s\n", msg);
+    check("idle home screen wakes about twice a minute",
+          first_minute <= 3 && ten_minutes <= 10 * 2 + 2, msg);
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
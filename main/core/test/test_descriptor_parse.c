@@ -0,0 +1,225 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core/descriptor_parse.h"
+#include "core/registry.h"
+#include <wally_core.h>
+
+/* Provided by stubs/registry_stub.c */
+void registry_stub_set_network(wallet_network_t network);
+void registry_stub_reset_parse_counter(void);
+int registry_stub_parse_calls(void);
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+/* Keys from the BIP39 test mnemonic "abandon...about" (master fingerprint
+ * 73c5da0a): the m/84'/0'/0' xpub, the m/84'/1'/0' tpub, and that account
+ * key as WIF on both networks and as a raw public key. The key_get_fingerprint
+ * stub returns 00000000, so origins with that fingerprint are ours. */
+#define XPUB_84                                                                \
+  "xpub6CatWdiZiodmUeTDp8LT5or8nmbKNcuyvz7WyksVFkKB4RHwCD3XyuvP"               \
+  "EbvqAQY3rAPshWcMLoP2fMFMKHPJ4ZeZXYVUhLv1VMrjPC7PW6V"
+#define TPUB_84                                                                \
+  "tpubDC8msFGeGuwnKG9Upg7DM2b4DaRqg3CUZa5g8v2SRQ6K4NSkxUgd7HsL2XVW"           \
+  "bVm39yBA4LAxysQAm397zwQSQoQgewGiYZqrA9DsP4zbQ1M"
+#define WIF_MAIN "L144R56okCQMMDS2qioJRNAUS6y6L5q9tRHnizw95dRjsrZ3XyqQ"
+#define WIF_TEST "cRR3sz6fBG6cWeuJE8cRngfY4LGVzXvqxTSFqRPeak5k8beCGBX8"
+#define RAW_PUB                                                                \
+  "03b88e0fbe3f646337ed93bc0c0f3b843fcf7d2589e5ec884754e6402027a890b4"
+
+#define DESC_MAIN "wpkh([00000000/84'/0'/0']" XPUB_84 "/<0;1>/*)"
+#define DESC_TEST "wpkh([00000000/84'/1'/0']" TPUB_84 "/<0;1>/*)"
+
+static void check_scan(const char *name, const char *desc,
+                       descriptor_key_network_t expected) {
+  TEST(name);
+  descriptor_key_network_t got = descriptor_scan_key_network(desc);
+  if (got == expected) {
+    PASS();
+  } else {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "expected %d, got %d", (int)expected, (int)got);
+    FAIL(msg);
+  }
+}
+
+static void check_parse_calls(const char *name, int expected) {
+  TEST(name);
+  int got = registry_stub_parse_calls();
+  if (got == expected) {
+    PASS();
+  } else {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "expected %d parse(s), got %d", expected, got);
+    FAIL(msg);
+  }
+}
+
+int main(void) {
+  printf("=== descriptor_parse tests ===\n");
+
+  printf("\n--- Group 1: key network scan ---\n");
+  check_scan("xpub is mainnet", DESC_MAIN, DESCRIPTOR_KEYS_MAINNET);
+  check_scan("tpub is testnet", DESC_TEST, DESCRIPTOR_KEYS_TESTNET);
+  check_scan("mainnet WIF", "wpkh(" WIF_MAIN ")", DESCRIPTOR_KEYS_MAINNET);
+  check_scan("testnet WIF", "wpkh(" WIF_TEST ")", DESCRIPTOR_KEYS_TESTNET);
+  check_scan("raw key is neutral", "wpkh(" RAW_PUB ")",
+             DESCRIPTOR_KEYS_NEUTRAL);
+  check_scan("hashes are neutral",
+             "wsh(and_v(v:pk(" RAW_PUB "),sha256(9267d3dbed802941483f1afa2a6bc6"
+             "8de5f653128aca9bf1461c5d0a3ad36ed2)))",
+             DESCRIPTOR_KEYS_NEUTRAL);
+  check_scan("xpub with tpub is mixed",
+             "wsh(multi(1,[00000000/48'/0'/0'/2']" XPUB_84
+             "/0/*,[11111111/48'/1'/0'/2']" TPUB_84 "/0/*))",
+             DESCRIPTOR_KEYS_MIXED);
+  check_scan("bech32 mainnet address",
+             "addr(bc1qcr8te4kr609gcawutmrza0j4xv80jy8z306fyu)",
+             DESCRIPTOR_KEYS_MAINNET);
+  check_scan("bech32 testnet address",
+             "addr(tb1q6rz28mcfaxtmd6v789l9rrlrusdprr9pqcpvkl)",
+             DESCRIPTOR_KEYS_TESTNET);
+  check_scan("checksum suffix ignored", DESC_MAIN "#d9qwe873",
+             DESCRIPTOR_KEYS_MAINNET);
+
+  printf("\n--- Group 2: one parse per descriptor ---\n");
+  {
+    descriptor_parsed_t parsed;
+    registry_stub_reset_parse_counter();
+    int ret = descriptor_parse_once(DESC_MAIN, WALLET_NETWORK_TESTNET, &parsed);
+    check_parse_calls("xpub on testnet preference: one parse", 1);
+    TEST("xpub parses as mainnet");
+    if (ret == WALLY_OK && parsed.network == WALLET_NETWORK_MAINNET)
+      PASS();
+    else
+      FAIL("wrong result or network");
+    descriptor_parsed_free(&parsed);
+
+    registry_stub_reset_parse_counter();
+    ret = descriptor_parse_once(DESC_TEST, WALLET_NETWORK_MAINNET, &parsed);
+    check_parse_calls("tpub on mainnet preference: one parse", 1);
+    TEST("tpub parses as testnet");
+    if (ret == WALLY_OK && parsed.network == WALLET_NETWORK_TESTNET)
+      PASS();
+    else
+      FAIL("wrong result or network");
+    descriptor_parsed_free(&parsed);
+
+    registry_stub_reset_parse_counter();
+    ret = descriptor_parse_once("wsh(multi(1," XPUB_84 "/0/*," TPUB_84
+                                "/0/*))",
+                                WALLET_NETWORK_MAINNET, &parsed);
+    check_parse_calls("mixed networks: rejected without parsing", 0);
+    TEST("mixed networks: fails");
+    if (ret != WALLY_OK && parsed.desc == NULL)
+      PASS();
+    else
+      FAIL("mixed-network descriptor accepted");
+  }
+
+  printf("\n--- Group 3: duplicate check ---\n");
+  {
+    registry_clear();
+    registry_stub_set_network(WALLET_NETWORK_MAINNET);
+    char id[REGISTRY_ID_MAX_LEN];
+    registry_stub_reset_parse_counter();
+    bool dup = registry_session_has_duplicate(DESC_TEST, id, sizeof(id));
+    check_parse_calls("other-network descriptor: one parse", 1);
+    TEST("other-network descriptor: no duplicate");
+    if (!dup)
+      PASS();
+    else
+      FAIL("reported a duplicate in an empty registry");
+  }
+
+  printf("\n--- Group 4: registration reuses the parse ---\n");
+  {
+    registry_clear();
+    registry_stub_set_network(WALLET_NETWORK_MAINNET);
+    descriptor_parsed_t parsed;
+    registry_stub_reset_parse_counter();
+    bool ok =
+        descriptor_parse_once(DESC_MAIN, WALLET_NETWORK_MAINNET, &parsed) ==
+            WALLY_OK &&
+        descriptor_parsed_checksum(&parsed) != NULL;
+    char checksum[9] = {0};
+    if (ok)
+      memcpy(checksum, parsed.checksum, sizeof(checksum));
+    ok = ok && registry_add_parsed("main", DESC_MAIN, &parsed, STORAGE_FLASH,
+                                   false);
+    check_parse_calls("validate then register: one parse", 1);
+    TEST("registered entry keeps the checksum");
+    const registry_entry_t *e = registry_find_by_id("main");
+    if (ok && e && strcmp(e->checksum, checksum) == 0 && parsed.desc == NULL)
+      PASS();
+    else
+      FAIL("entry missing, checksum differs or descriptor not taken");
+
+    char id[REGISTRY_ID_MAX_LEN];
+    TEST("checksum lookup finds it");
+    if (registry_session_has_duplicate_checksum(checksum, id, sizeof(id)) &&
+        strcmp(id, "main") == 0)
+      PASS();
+    else
+      FAIL("duplicate not found");
+
+    registry_stub_reset_parse_counter();
+    ok = descriptor_parse_once(DESC_TEST, WALLET_NETWORK_MAINNET, &parsed) ==
+             WALLY_OK &&
+         registry_add_parsed("test", DESC_TEST, &parsed, STORAGE_FLASH, false);
+    check_parse_calls("other-network add: one parse", 1);
+    TEST("other-network add: rejected and freed");
+    if (!ok && parsed.desc == NULL && registry_count() == 1)
+      PASS();
+    else
+      FAIL("wrong-network descriptor registered");
+
+    registry_stub_reset_parse_counter();
+    ok = registry_add_from_string("again", DESC_MAIN "#d9qwe873",
+                                  STORAGE_FLASH, false);
+    check_parse_calls("add from string: one parse", 1);
+    TEST("add from string");
+    if (ok && registry_count() == 2)
+      PASS();
+    else
+      FAIL("add from string failed");
+  }
+
+  printf("\n--- Group 5: watch-only registration ---\n");
+  {
+    registry_clear();
+    descriptor_parsed_t parsed;
+    registry_stub_reset_parse_counter();
+    bool ok =
+        descriptor_parse_once(DESC_TEST, WALLET_NETWORK_MAINNET, &parsed) ==
+            WALLY_OK &&
+        registry_add_watch_only_parsed("watch", DESC_TEST, &parsed);
+    check_parse_calls("watch-only load: one parse", 1);
+    TEST("watch-only entry registered");
+    const registry_entry_t *e = registry_find_by_id("watch");
+    if (ok && e && e->my_key_index == SIZE_MAX && e->checksum[0] != '\0')
+      PASS();
+    else
+      FAIL("watch-only entry missing or incomplete");
+    registry_clear();
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
@@ -239,37 +239,45 @@ typedef struct {
   size_t num_tokens;
 } expected_line_t;
 
+static void print_view(ms_policy_view_t *view) {
+  printf("\n--- got ---\n");
+  for (size_t i = 0; i < miniscript_policy_view_num_lines(view); i++) {
+    ms_policy_line_t line;
+    if (!miniscript_policy_view_line(view, i, &line))
+      continue;
+    printf("level %d:", line.level);
+    for (size_t j = 0; j < line.num_tokens; j++)
+      printf(" [%d]'%s'", line.tokens[j].kind, line.tokens[j].text);
+    printf("\n");
+  }
+}
+
 static void check_view(const char *name, const char *policy, size_t width,
                        const expected_line_t *expected, size_t num_expected) {
   TEST(name);
-  ms_policy_view_t view;
-  if (!miniscript_policy_view_build(policy, width, &view)) {
+  ms_policy_view_t *view = miniscript_policy_view_build(policy, width);
+  if (!view) {
     FAIL("view build failed");
     return;
   }
-  bool ok = (view.num_lines == num_expected);
+  bool ok = (miniscript_policy_view_num_lines(view) == num_expected);
   for (size_t i = 0; ok && i < num_expected; i++) {
-    const ms_policy_line_t *line = &view.lines[i];
+    ms_policy_line_t line;
     const expected_line_t *exp = &expected[i];
-    ok = (line->level == exp->level && line->num_tokens == exp->num_tokens);
+    ok = miniscript_policy_view_line(view, i, &line) &&
+         line.level == exp->level && line.num_tokens == exp->num_tokens &&
+         miniscript_policy_view_level(view, i) == exp->level;
     for (size_t j = 0; ok && j < exp->num_tokens; j++)
-      ok = (line->tokens[j].kind == exp->tokens[j].kind &&
-            strcmp(line->tokens[j].text, exp->tokens[j].text) == 0);
+      ok = (line.tokens[j].kind == exp->tokens[j].kind &&
+            strcmp(line.tokens[j].text, exp->tokens[j].text) == 0);
   }
   if (!ok) {
-    printf("\n--- got ---\n");
-    for (size_t i = 0; i < view.num_lines; i++) {
-      printf("level %d:", view.lines[i].level);
-      for (size_t j = 0; j < view.lines[i].num_tokens; j++)
-        printf(" [%d]'%s'", view.lines[i].tokens[j].kind,
-               view.lines[i].tokens[j].text);
-      printf("\n");
-    }
+    print_view(view);
     FAIL("mismatch");
   } else {
     PASS();
   }
-  miniscript_policy_view_free(&view);
+  miniscript_policy_view_release(view);
 }
 
 static void test_view(void) {
@@ -329,37 +337,45 @@ static void test_view(void) {
 static void check_note(const char *name, const char *policy,
                        const char *expected_note) {
   TEST(name);
-  ms_policy_view_t view;
-  if (!miniscript_policy_view_build(policy, 50, &view)) {
+  ms_policy_view_t *view = miniscript_policy_view_build(policy, 50);
+  if (!view) {
     FAIL("view build failed");
     return;
   }
-  const char *note = NULL;
+  // Notes are copied out: a line's tokens only last until the next one.
+  char note[32] = "";
+  bool has_note = false;
   bool has_timelock = false;
-  for (size_t i = 0; i < view.num_lines; i++)
-    for (size_t j = 0; j < view.lines[i].num_tokens; j++) {
-      if (view.lines[i].tokens[j].kind == MS_TOKEN_TIMELOCK)
+  for (size_t i = 0; i < miniscript_policy_view_num_lines(view); i++) {
+    ms_policy_line_t line;
+    if (!miniscript_policy_view_line(view, i, &line))
+      continue;
+    for (size_t j = 0; j < line.num_tokens; j++) {
+      if (line.tokens[j].kind == MS_TOKEN_TIMELOCK)
         has_timelock = true;
-      if (view.lines[i].tokens[j].kind == MS_TOKEN_NOTE)
-        note = view.lines[i].tokens[j].text;
+      if (line.tokens[j].kind == MS_TOKEN_NOTE) {
+        snprintf(note, sizeof(note), "%s", line.tokens[j].text);
+        has_note = true;
+      }
     }
+  }
   if (!has_timelock) {
     FAIL("no timelock token");
   } else if (!expected_note) {
-    if (note) {
+    if (has_note) {
       printf("\n--- got note '%s', expected none ---\n", note);
       FAIL("unexpected note");
     } else {
       PASS();
     }
-  } else if (!note || strcmp(note, expected_note) != 0) {
-    printf("\n--- got note '%s', expected '%s' ---\n", note ? note : "(none)",
-           expected_note);
+  } else if (!has_note || strcmp(note, expected_note) != 0) {
+    printf("\n--- got note '%s', expected '%s' ---\n",
+           has_note ? note : "(none)", expected_note);
     FAIL("note mismatch");
   } else {
     PASS();
   }
-  miniscript_policy_view_free(&view);
+  miniscript_policy_view_release(view);
 }
 
 static void test_timelock_notes(void) {
@@ -377,6 +393,79 @@ static void test_timelock_notes(void) {
              "2025-01-19");
 }
 
+static void test_view_branches(void) {
+  TEST("view: branch continuation for tree guides");
+  // Levels 0, 1, 2, 2, 3, 3
+  ms_policy_view_t *view = miniscript_policy_view_build(
+      "wsh(or_d(pk(A),and_v(v:pkh(B),older(6))))", 25);
+  if (!view) {
+    FAIL("view build failed");
+    return;
+  }
+  static const struct {
+    size_t line;
+    int depth;
+    bool continues;
+  } cases[] = {
+      {1, 1, false}, {2, 2, true},  {3, 2, false}, {2, 1, false},
+      {4, 3, true},  {5, 3, false}, {4, 2, false}, {0, 0, false},
+  };
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    if (miniscript_policy_view_continues(view, cases[i].line,
+                                         cases[i].depth) != cases[i].continues)
+      ok = false;
+  if (!ok)
+    FAIL("mismatch");
+  else
+    PASS();
+  miniscript_policy_view_release(view);
+}
+
+static void test_view_cache(void) {
+  TEST("view cache: shared per checksum and width, LRU eviction");
+  const char *policy = "wsh(or_d(pk(A),and_v(v:pkh(B),older(6))))";
+  ms_policy_view_t *a = miniscript_policy_view_get("abcd1234", policy, 25);
+  ms_policy_view_t *b = miniscript_policy_view_get("abcd1234", policy, 25);
+  ms_policy_view_t *wide = miniscript_policy_view_get("abcd1234", policy, 60);
+  ms_policy_view_t *uncached = miniscript_policy_view_get("", policy, 25);
+  bool ok = a && a == b && wide && wide != a && uncached && uncached != a;
+
+  // Fill the other slots, touching `a` so that `wide` is evicted first.
+  char checksum[9];
+  ms_policy_view_t *again = NULL;
+  for (int i = 0; ok && i < MINISCRIPT_POLICY_VIEW_CACHE_SLOTS - 1; i++) {
+    snprintf(checksum, sizeof(checksum), "fill%04d", i);
+    if (i == 1) {
+      miniscript_policy_view_release(a);
+      a = miniscript_policy_view_get("abcd1234", policy, 25);
+      ok = (a == b);
+    }
+    ms_policy_view_t *v = miniscript_policy_view_get(checksum, policy, 25);
+    ok = ok && v;
+    miniscript_policy_view_release(v);
+  }
+  // `wide` is still held here, so its memory stays valid after eviction.
+  again = miniscript_policy_view_get("abcd1234", policy, 60);
+  ok = ok && again && again != wide &&
+       miniscript_policy_view_num_lines(wide) ==
+           miniscript_policy_view_num_lines(again);
+  ms_policy_view_t *still = miniscript_policy_view_get("abcd1234", policy, 25);
+  ok = ok && still == a;
+
+  miniscript_policy_view_release(still);
+  miniscript_policy_view_release(again);
+  miniscript_policy_view_release(uncached);
+  miniscript_policy_view_release(wide);
+  miniscript_policy_view_release(b);
+  miniscript_policy_view_release(a);
+  miniscript_policy_view_cache_clear();
+  if (!ok)
+    FAIL("mismatch");
+  else
+    PASS();
+}
+
 int main(void) {
   if (wally_init(0) != WALLY_OK) {
     printf("wally_init failed\n");
@@ -388,6 +477,8 @@ int main(void) {
   test_policy_string();
   test_is_miniscript();
   test_view();
+  test_view_branches();
+  test_view_cache();
   test_timelock_notes();
 
   printf("\nResults: %d passed, %d failed\n", tests_passed, tests_failed);
@@ -0,0 +1,1163 @@
+/*
+ * Tests for the miniscript policy view (main/core/miniscript_policy.c)
+ * against the previous implementation on large synthetic policies.
+ *
+ * The reference is the previous indenter and view builder: a malloc'd node
+ * per fragment, every line and token its own allocation, and each parent
+ * re-rendering its children to find their first lines. Both must give the
+ * same indented text and, line by line, the same tokens. Allocations are
+ * counted by wrapping malloc/calloc/realloc/free at link time (see Makefile),
+ * so each build's peak heap use and number of allocations can be compared.
+ *
+ * Usage: test_miniscript_view [--bench]
+ */
+
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/miniscript_policy.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+static void check(const char *name, bool ok, const char *msg) {
+  TEST(name);
+  if (ok)
+    PASS();
+  else
+    FAIL(msg);
+}
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+// ---------------------------------------------------------------------------
+// Allocation accounting (-Wl,--wrap=malloc,...)
+// ---------------------------------------------------------------------------
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+typedef struct {
+  long long live;
+  long long peak;
+  size_t calls;
+} alloc_stats_t;
+
+static bool counting = false;
+static alloc_stats_t stats;
+
+static void note_alloc(void *ptr) {
+  if (!counting || !ptr)
+    return;
+  stats.calls++;
+  stats.live += (long long)malloc_usable_size(ptr);
+  if (stats.live > stats.peak)
+    stats.peak = stats.live;
+}
+
+static void note_free(void *ptr) {
+  if (counting && ptr)
+    stats.live -= (long long)malloc_usable_size(ptr);
+}
+
+void *__wrap_malloc(size_t size) {
+  void *ptr = __real_malloc(size);
+  note_alloc(ptr);
+  return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  void *ptr = __real_calloc(n, size);
+  note_alloc(ptr);
+  return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  size_t old = ptr ? malloc_usable_size(ptr) : 0;
+  void *out = __real_realloc(ptr, size);
+  if (counting && out) {
+    stats.live -= (long long)old;
+    note_alloc(out);
+  }
+  return out;
+}
+
+void __wrap_free(void *ptr) {
+  note_free(ptr);
+  __real_free(ptr);
+}
+
+static void stats_begin(void) {
+  memset(&stats, 0, sizeof(stats));
+  counting = true;
+}
+
+static alloc_stats_t stats_end(void) {
+  counting = false;
+  return stats;
+}
+
+// ---------------------------------------------------------------------------
+// Reference: the previous indenter and view builder
+// ---------------------------------------------------------------------------
+
+typedef struct {
+  ms_token_kind_t kind;
+  char *text;
+} ref_token_t;
+
+typedef struct {
+  int level;
+  ref_token_t *tokens;
+  size_t num_tokens;
+} ref_line_t;
+
+typedef struct {
+  ref_line_t *lines;
+  size_t num_lines;
+} ref_view_t;
+
+static void ref_view_free(ref_view_t *view);
+
+typedef struct ref_node {
+  char *text; // prefix before '(' or full leaf text
+  struct ref_node **children;
+  size_t num_children;
+  int level;
+} ref_node_t;
+
+typedef struct {
+  char **items;
+  size_t count;
+  size_t cap;
+} ref_lines_t;
+
+static char *ref_str_printf(const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int len = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (len < 0)
+    return NULL;
+  char *out = malloc((size_t)len + 1);
+  if (!out)
+    return NULL;
+  va_start(ap, fmt);
+  vsnprintf(out, (size_t)len + 1, fmt, ap);
+  va_end(ap);
+  return out;
+}
+
+static bool ref_lines_push(ref_lines_t *l, char *line) {
+  if (!line)
+    return false;
+  if (l->count == l->cap) {
+    size_t cap = l->cap ? l->cap * 2 : 8;
+    char **items = realloc(l->items, cap * sizeof(*items));
+    if (!items) {
+      free(line);
+      return false;
+    }
+    l->items = items;
+    l->cap = cap;
+  }
+  l->items[l->count++] = line;
+  return true;
+}
+
+static void ref_lines_free(ref_lines_t *l) {
+  for (size_t i = 0; i < l->count; i++)
+    free(l->items[i]);
+  free(l->items);
+  memset(l, 0, sizeof(*l));
+}
+
+static char *ref_dup_trim(const char *s, size_t len) {
+  while (len && *s == ' ') {
+    s++;
+    len--;
+  }
+  while (len && s[len - 1] == ' ')
+    len--;
+  char *out = malloc(len + 1);
+  if (!out)
+    return NULL;
+  memcpy(out, s, len);
+  out[len] = '\0';
+  return out;
+}
+
+static void ref_node_free(ref_node_t *node) {
+  if (!node)
+    return;
+  for (size_t i = 0; i < node->num_children; i++)
+    ref_node_free(node->children[i]);
+  free(node->children);
+  free(node->text);
+  free(node);
+}
+
+static bool ref_node_add_child(ref_node_t *node, ref_node_t *child) {
+  if (!child)
+    return false;
+  ref_node_t **children =
+      realloc(node->children, (node->num_children + 1) * sizeof(*children));
+  if (!children) {
+    ref_node_free(child);
+    return false;
+  }
+  node->children = children;
+  node->children[node->num_children++] = child;
+  return true;
+}
+
+static ref_node_t *ref_parse_expr(const char *expr, size_t len, int level) {
+  while (len && *expr == ' ') {
+    expr++;
+    len--;
+  }
+  while (len && expr[len - 1] == ' ')
+    len--;
+
+  ref_node_t *node = calloc(1, sizeof(*node));
+  if (!node)
+    return NULL;
+  node->level = level;
+
+  const char *paren = memchr(expr, '(', len);
+  if (!paren) {
+    node->text = ref_dup_trim(expr, len);
+    if (!node->text) {
+      ref_node_free(node);
+      return NULL;
+    }
+    return node;
+  }
+
+  size_t pos = (size_t)(paren - expr);
+  node->text = ref_dup_trim(expr, pos);
+  if (!node->text || len < pos + 2) {
+    ref_node_free(node);
+    return NULL;
+  }
+
+  // Children: inside the outermost parens, split at top-level commas.
+  const char *inside = expr + pos + 1;
+  size_t inside_len = len - pos - 2;
+  int depth = 0;
+  size_t start = 0;
+  for (size_t i = 0; i < inside_len; i++) {
+    char c = inside[i];
+    if (c == '(') {
+      depth++;
+    } else if (c == ')') {
+      depth--;
+    } else if (c == ',' && depth == 0) {
+      if (!ref_node_add_child(
+              node, ref_parse_expr(inside + start, i - start, level + 1))) {
+        ref_node_free(node);
+        return NULL;
+      }
+      start = i + 1;
+    }
+  }
+  if (start < inside_len &&
+      !ref_node_add_child(node, ref_parse_expr(inside + start,
+                                               inside_len - start,
+                                               level + 1))) {
+    ref_node_free(node);
+    return NULL;
+  }
+  return node;
+}
+
+// Merge lines that are only closing parens into the previous line.
+static void ref_join_closing_parens(ref_lines_t *l) {
+  for (size_t i = l->count - 1; i > 0; i--) {
+    const char *s = l->items[i];
+    while (*s == ' ')
+      s++;
+    if (!*s)
+      continue;
+    const char *p = s;
+    while (*p == ')')
+      p++;
+    if (*p)
+      continue;
+    char *merged = ref_str_printf("%s%s", l->items[i - 1], s);
+    if (!merged)
+      continue;
+    free(l->items[i - 1]);
+    l->items[i - 1] = merged;
+    free(l->items[i]);
+    memmove(&l->items[i], &l->items[i + 1],
+            (l->count - i - 1) * sizeof(*l->items));
+    l->count--;
+  }
+}
+
+static bool ref_node_to_lines(const ref_node_t *node, size_t max_width,
+                              ref_lines_t *out);
+
+// First rendered line of a node, stripped of indentation.
+static char *ref_node_first_line(const ref_node_t *node, size_t max_width) {
+  ref_lines_t tmp = {0};
+  if (!ref_node_to_lines(node, max_width, &tmp)) {
+    ref_lines_free(&tmp);
+    return NULL;
+  }
+  char *first = ref_dup_trim(tmp.items[0], strlen(tmp.items[0]));
+  ref_lines_free(&tmp);
+  return first;
+}
+
+static bool ref_node_to_lines(const ref_node_t *node, size_t max_width,
+                              ref_lines_t *out) {
+  if (node->num_children == 0)
+    return ref_lines_push(
+        out, ref_str_printf("%*s%s", node->level, "", node->text));
+
+  // If any child is a leaf, try flattening all children onto one line.
+  bool any_leaf = false;
+  for (size_t i = 0; i < node->num_children; i++)
+    if (node->children[i]->num_children == 0)
+      any_leaf = true;
+  if (any_leaf && node->level > 0) {
+    char *line = ref_str_printf("%*s%s(", node->level, "", node->text);
+    for (size_t i = 0; line && i < node->num_children; i++) {
+      char *child = ref_node_first_line(node->children[i], max_width);
+      char *next =
+          child ? ref_str_printf("%s%s%s", line, i ? "," : "", child) : NULL;
+      free(child);
+      free(line);
+      line = next;
+    }
+    if (!line)
+      return false;
+    char *flat = ref_str_printf("%s)", line);
+    free(line);
+    if (!flat)
+      return false;
+    if (strlen(flat) <= max_width)
+      return ref_lines_push(out, flat);
+    free(flat);
+  }
+
+  if (!ref_lines_push(out,
+                      ref_str_printf("%*s%s(", node->level, "", node->text)))
+    return false;
+  for (size_t i = 0; i < node->num_children; i++) {
+    if (!ref_node_to_lines(node->children[i], max_width, out))
+      return false;
+    if (i < node->num_children - 1) {
+      char *with_comma = ref_str_printf("%s,", out->items[out->count - 1]);
+      if (!with_comma)
+        return false;
+      free(out->items[out->count - 1]);
+      out->items[out->count - 1] = with_comma;
+    }
+  }
+  if (!ref_lines_push(out, ref_str_printf("%*s)", node->level, "")))
+    return false;
+
+  ref_join_closing_parens(out);
+  return true;
+}
+
+static void ref_break_line_into(ref_lines_t *out, const char *line,
+                                size_t max_width) {
+  size_t len = strlen(line);
+  if (len <= max_width) {
+    ref_lines_push(out, ref_str_printf("%s", line));
+    return;
+  }
+  size_t indent = 0;
+  while (line[indent] == ' ')
+    indent++;
+  size_t chunk = (max_width > indent) ? max_width - indent : 1;
+  const char *data = line + indent;
+  size_t dlen = len - indent;
+  while (dlen > chunk) {
+    ref_lines_push(out, ref_str_printf("%*s%.*s", (int)indent, "", (int)chunk,
+                                       data));
+    data += chunk;
+    dlen -= chunk;
+  }
+  ref_lines_push(out,
+                 ref_str_printf("%*s%.*s", (int)indent, "", (int)dlen, data));
+}
+
+static char *ref_miniscript_policy_indent(const char *expr,
+                                          size_t max_line_width) {
+  if (!expr || !*expr || max_line_width == 0)
+    return NULL;
+
+  bool multiple_tap_scripts = strchr(expr, '{') != NULL;
+
+  ref_node_t *tree = ref_parse_expr(expr, strlen(expr), 0);
+  if (!tree)
+    return NULL;
+  ref_lines_t raw = {0};
+  bool ok = ref_node_to_lines(tree, max_line_width, &raw);
+  ref_node_free(tree);
+  if (!ok || raw.count == 0) {
+    ref_lines_free(&raw);
+    return NULL;
+  }
+
+  ref_lines_t fin = {0};
+  for (size_t i = 0; i < raw.count; i++)
+    ref_break_line_into(&fin, raw.items[i], max_line_width);
+  ref_lines_free(&raw);
+  if (fin.count == 0) {
+    ref_lines_free(&fin);
+    return NULL;
+  }
+
+  if (multiple_tap_scripts) {
+    // Replace the penultimate ')' of the last line by '}'.
+    char *last = fin.items[fin.count - 1];
+    size_t len = strlen(last);
+    if (len >= 2)
+      last[len - 2] = '}';
+  }
+
+  size_t total = 0;
+  for (size_t i = 0; i < fin.count; i++)
+    total += strlen(fin.items[i]) + 1;
+  char *joined = malloc(total);
+  if (joined) {
+    char *p = joined;
+    for (size_t i = 0; i < fin.count; i++) {
+      size_t len = strlen(fin.items[i]);
+      memcpy(p, fin.items[i], len);
+      p += len;
+      *p++ = (i < fin.count - 1) ? '\n' : '\0';
+    }
+  }
+  ref_lines_free(&fin);
+  return joined;
+}
+
+// ---------------------------------------------------------------------------
+// Token view
+// ---------------------------------------------------------------------------
+
+static bool ref_is_operator_fragment(const char *name, size_t len) {
+  static const char *const OPS[] = {
+      "or_b",        "or_c",    "or_d",          "or_i",   "and_v",
+      "and_b",       "and_n",   "andor",         "thresh", "multi",
+      "sortedmulti", "multi_a", "sortedmulti_a",
+  };
+  for (size_t i = 0; i < sizeof(OPS) / sizeof(OPS[0]); i++)
+    if (strlen(OPS[i]) == len && memcmp(OPS[i], name, len) == 0)
+      return true;
+  return false;
+}
+
+static bool ref_is_wrapper_fragment(const char *name, size_t len) {
+  static const char *const WRAPPERS[] = {"wsh", "sh", "tr"};
+  for (size_t i = 0; i < sizeof(WRAPPERS) / sizeof(WRAPPERS[0]); i++)
+    if (strlen(WRAPPERS[i]) == len && memcmp(WRAPPERS[i], name, len) == 0)
+      return true;
+  return false;
+}
+
+// "~N min" / "~N h" / "~N day(s)" for an older() relative locktime.
+static bool ref_format_older_note(uint32_t n, char *out, size_t out_size) {
+  if (n == 0 || n >= 0x80000000u)
+    return false;
+  uint32_t secs;
+  if (n & 0x00400000u)
+    secs = (n & 0xFFFFu) * 512u; // time-based lock, 512s units
+  else
+    secs = n * 600u; // block-based lock, ~10 min per block
+  if (secs < 3600u) {
+    snprintf(out, out_size, "~%u min", (secs + 30u) / 60u);
+  } else if (secs < 24u * 3600u) {
+    snprintf(out, out_size, "~%u h", (secs + 1800u) / 3600u);
+  } else {
+    uint32_t days = (secs + 43200u) / 86400u;
+    snprintf(out, out_size, "~%u day%s", days, days == 1 ? "" : "s");
+  }
+  return true;
+}
+
+// "YYYY-MM-DD" (UTC) for an after() absolute locktime, when it is a unix
+// timestamp. Block heights (< 500000000) get no note.
+static bool ref_format_after_note(uint32_t n, char *out, size_t out_size) {
+  if (n < 500000000u)
+    return false;
+  // Civil-from-days (Howard Hinnant), all integer math.
+  int64_t z = (int64_t)(n / 86400u) + 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  uint32_t doe = (uint32_t)(z - era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t y = (int64_t)yoe + era * 400;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  uint32_t d = doy - (153 * mp + 2) / 5 + 1;
+  uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+  if (m <= 2)
+    y++;
+  snprintf(out, out_size, "%lld-%02u-%02u", (long long)y, m, d);
+  return true;
+}
+
+typedef struct {
+  ref_token_t *items;
+  size_t count;
+  size_t cap;
+} ref_tokens_t;
+
+static bool ref_tokens_push(ref_tokens_t *t, ms_token_kind_t kind,
+                            const char *text, size_t len) {
+  // Merge into the previous token when the kind matches.
+  if (t->count && t->items[t->count - 1].kind == kind &&
+      kind != MS_TOKEN_NOTE) {
+    ref_token_t *prev = &t->items[t->count - 1];
+    size_t prev_len = strlen(prev->text);
+    char *merged = realloc(prev->text, prev_len + len + 1);
+    if (!merged)
+      return false;
+    memcpy(merged + prev_len, text, len);
+    merged[prev_len + len] = '\0';
+    prev->text = merged;
+    return true;
+  }
+  if (t->count == t->cap) {
+    size_t cap = t->cap ? t->cap * 2 : 8;
+    ref_token_t *items = realloc(t->items, cap * sizeof(*items));
+    if (!items)
+      return false;
+    t->items = items;
+    t->cap = cap;
+  }
+  char *copy = malloc(len + 1);
+  if (!copy)
+    return false;
+  memcpy(copy, text, len);
+  copy[len] = '\0';
+  t->items[t->count].kind = kind;
+  t->items[t->count].text = copy;
+  t->count++;
+  return true;
+}
+
+static void ref_tokens_destroy(ref_tokens_t *t) {
+  for (size_t i = 0; i < t->count; i++)
+    free(t->items[i].text);
+  free(t->items);
+  memset(t, 0, sizeof(*t));
+}
+
+static bool ref_is_ident_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool ref_tokenize_line(const char *s, ref_tokens_t *out) {
+  size_t i = 0;
+  while (s[i]) {
+    char c = s[i];
+
+    if (c == '(' || c == ')' || c == ',' || c == '{' || c == '}') {
+      size_t start = i;
+      while (s[i] == '(' || s[i] == ')' || s[i] == ',' || s[i] == '{' ||
+             s[i] == '}')
+        i++;
+      if (!ref_tokens_push(out, MS_TOKEN_PLUMBING, s + start, i - start))
+        return false;
+      continue;
+    }
+
+    if (c >= 'A' && c <= 'Z' &&
+        (s[i + 1] == ')' || s[i + 1] == ',' || s[i + 1] == '\0')) {
+      if (!ref_tokens_push(out, MS_TOKEN_KEY, s + i, 1))
+        return false;
+      i++;
+      continue;
+    }
+
+    if (c >= 'a' && c <= 'z') {
+      size_t start = i;
+      while (ref_is_ident_char(s[i]))
+        i++;
+      size_t len = i - start;
+      if (s[i] == ':') { // type-coercion wrapper prefix (v:, snl:, ...)
+        i++;
+        if (!ref_tokens_push(out, MS_TOKEN_PLUMBING, s + start, i - start))
+          return false;
+        continue;
+      }
+      bool is_timelock = (len == 5 && (memcmp(s + start, "older", 5) == 0 ||
+                                       memcmp(s + start, "after", 5) == 0));
+      if (is_timelock && s[i] == '(') {
+        // Take the whole "older(N)" fragment when it is unbroken.
+        size_t j = i + 1, num_start = i + 1;
+        while (s[j] >= '0' && s[j] <= '9')
+          j++;
+        if (j > num_start && s[j] == ')') {
+          unsigned long n = strtoul(s + num_start, NULL, 10);
+          if (!ref_tokens_push(out, MS_TOKEN_TIMELOCK, s + start,
+                               j + 1 - start))
+            return false;
+          char note[24];
+          bool has_note =
+              (s[start] == 'o')
+                  ? ref_format_older_note((uint32_t)n, note, sizeof(note))
+                  : ref_format_after_note((uint32_t)n, note, sizeof(note));
+          if (has_note &&
+              !ref_tokens_push(out, MS_TOKEN_NOTE, note, strlen(note)))
+            return false;
+          i = j + 1;
+          continue;
+        }
+      }
+      ms_token_kind_t kind = MS_TOKEN_TEXT;
+      if (is_timelock)
+        kind = MS_TOKEN_TIMELOCK; // fragment split across lines
+      else if (ref_is_operator_fragment(s + start, len))
+        kind = MS_TOKEN_OPERATOR;
+      else if (ref_is_wrapper_fragment(s + start, len))
+        kind = MS_TOKEN_PLUMBING;
+      if (!ref_tokens_push(out, kind, s + start, len))
+        return false;
+      continue;
+    }
+
+    size_t start = i++;
+    if (!ref_tokens_push(out, MS_TOKEN_TEXT, s + start, i - start))
+      return false;
+  }
+  return true;
+}
+
+static bool ref_view_build(const char *policy, size_t max_line_width,
+                           ref_view_t *view) {
+  if (!view)
+    return false;
+  memset(view, 0, sizeof(*view));
+
+  char *indented = ref_miniscript_policy_indent(policy, max_line_width);
+  if (!indented)
+    return false;
+
+  size_t num_lines = 1;
+  for (const char *p = indented; *p; p++)
+    if (*p == '\n')
+      num_lines++;
+  view->lines = calloc(num_lines, sizeof(*view->lines));
+  if (!view->lines) {
+    free(indented);
+    return false;
+  }
+
+  bool ok = true;
+  char *line = indented;
+  while (ok && line) {
+    char *next = strchr(line, '\n');
+    if (next)
+      *next++ = '\0';
+
+    int level = 0;
+    while (line[level] == ' ')
+      level++;
+
+    ref_tokens_t tokens = {0};
+    ok = ref_tokenize_line(line + level, &tokens);
+    if (ok) {
+      ref_line_t *out = &view->lines[view->num_lines++];
+      out->level = level;
+      out->tokens = tokens.items;
+      out->num_tokens = tokens.count;
+    } else {
+      ref_tokens_destroy(&tokens);
+    }
+    line = next;
+  }
+  free(indented);
+
+  if (!ok)
+    ref_view_free(view);
+  return ok;
+}
+
+static void ref_view_free(ref_view_t *view) {
+  if (!view)
+    return;
+  for (size_t i = 0; i < view->num_lines; i++) {
+    for (size_t j = 0; j < view->lines[i].num_tokens; j++)
+      free(view->lines[i].tokens[j].text);
+    free(view->lines[i].tokens);
+  }
+  free(view->lines);
+  memset(view, 0, sizeof(*view));
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic policies
+// ---------------------------------------------------------------------------
+
+#define GEN_CAP (256 * 1024)
+
+typedef struct {
+  char buf[GEN_CAP];
+  size_t len;
+  uint32_t seed;
+} gen_t;
+
+static uint32_t gen_rand(gen_t *g) {
+  g->seed = g->seed * 1103515245u + 12345u;
+  return g->seed >> 8;
+}
+
+static void put(gen_t *g, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(g->buf + g->len, GEN_CAP - g->len, fmt, ap);
+  va_end(ap);
+  if (n > 0 && g->len + (size_t)n < GEN_CAP)
+    g->len += (size_t)n;
+}
+
+static char gen_key(gen_t *g) { return (char)('A' + gen_rand(g) % 26); }
+
+static void gen_leaf(gen_t *g) {
+  switch (gen_rand(g) % 8) {
+  case 0:
+    put(g, "pk(%c)", gen_key(g));
+    break;
+  case 1:
+    put(g, "pkh(%c)", gen_key(g));
+    break;
+  case 2:
+    put(g, "older(%u)", 1 + gen_rand(g) % 65535);
+    break;
+  case 3:
+    put(g, "after(%u)", gen_rand(g) % 2 ? 840000 + gen_rand(g) % 100000
+                                         : 1700000000 + gen_rand(g) % 1000000);
+    break;
+  case 4:
+    put(g, "sha256(");
+    for (int i = 0; i < 8; i++)
+      put(g, "%08x", gen_rand(g));
+    put(g, ")");
+    break;
+  case 5:
+    put(g, "multi(2,%c,%c,%c)", gen_key(g), gen_key(g), gen_key(g));
+    break;
+  case 6:
+    put(g, "v:pkh(%c)", gen_key(g));
+    break;
+  default:
+    put(g, "%c", gen_key(g)); // bare key, as in multi() arguments
+    break;
+  }
+}
+
+static void gen_node(gen_t *g, int depth) {
+  if (depth == 0 || gen_rand(g) % 5 == 0) {
+    gen_leaf(g);
+    return;
+  }
+  switch (gen_rand(g) % 6) {
+  case 0:
+    put(g, "and_v(v:");
+    gen_node(g, depth - 1);
+    put(g, ",");
+    gen_node(g, depth - 1);
+    put(g, ")");
+    break;
+  case 1:
+    put(g, "or_d(");
+    gen_node(g, depth - 1);
+    put(g, ",");
+    gen_node(g, depth - 1);
+    put(g, ")");
+    break;
+  case 2:
+    put(g, "or_i(");
+    gen_node(g, depth - 1);
+    put(g, ",");
+    gen_node(g, depth - 1);
+    put(g, ")");
+    break;
+  case 3:
+    put(g, "andor(");
+    for (int i = 0; i < 3; i++) {
+      put(g, i ? "," : "");
+      gen_node(g, depth - 1);
+    }
+    put(g, ")");
+    break;
+  case 4: {
+    unsigned n = 2 + gen_rand(g) % 7;
+    put(g, "thresh(%u", 1 + gen_rand(g) % n);
+    for (unsigned i = 0; i < n; i++) {
+      put(g, i ? ",a:" : ",");
+      gen_node(g, depth - 1);
+    }
+    put(g, ")");
+    break;
+  }
+  default:
+    put(g, "or_b(");
+    gen_node(g, depth - 1);
+    put(g, ",s:");
+    gen_node(g, depth - 1);
+    put(g, ")");
+    break;
+  }
+}
+
+static const char *gen_policy(gen_t *g, uint32_t seed, int depth) {
+  g->len = 0;
+  g->buf[0] = '\0';
+  g->seed = seed;
+  switch (gen_rand(g) % 3) {
+  case 0:
+    put(g, "wsh(");
+    gen_node(g, depth);
+    put(g, ")");
+    break;
+  case 1:
+    put(g, "tr(%c,{", gen_key(g));
+    gen_node(g, depth - 1);
+    put(g, ",");
+    gen_node(g, depth - 1);
+    put(g, "})");
+    break;
+  default:
+    gen_node(g, depth);
+    break;
+  }
+  return g->buf;
+}
+
+// thresh(k, ...) over `keys` keys, each branch a timelocked key path nested
+// `depth` deep, as a large recovery setup would be written.
+static const char *gen_wide(gen_t *g, int keys, int depth) {
+  g->len = 0;
+  g->buf[0] = '\0';
+  put(g, "wsh(thresh(%d", keys / 2 + 1);
+  for (int k = 0; k < keys; k++) {
+    put(g, k ? ",s:" : ",");
+    for (int d = 0; d < depth; d++)
+      put(g, "or_d(pk(%c),and_v(v:pkh(%c),or_i(", 'A' + (k + d) % 26,
+          'A' + (k + d + 1) % 26);
+    put(g, "pk(%c)", 'A' + k % 26);
+    for (int d = 0; d < depth; d++)
+      put(g, ",older(%d))))", 144 * (d + 1));
+  }
+  put(g, "))");
+  return g->buf;
+}
+
+// ---------------------------------------------------------------------------
+// Comparison
+// ---------------------------------------------------------------------------
+
+static bool same_view(const ref_view_t *ref, ms_policy_view_t *view,
+                      char *why, size_t why_size) {
+  if (miniscript_policy_view_num_lines(view) != ref->num_lines) {
+    snprintf(why, why_size, "%zu lines, previous %zu",
+             miniscript_policy_view_num_lines(view), ref->num_lines);
+    return false;
+  }
+  for (size_t i = 0; i < ref->num_lines; i++) {
+    const ref_line_t *want = &ref->lines[i];
+    ms_policy_line_t got;
+    if (!miniscript_policy_view_line(view, i, &got) ||
+        got.level != want->level || got.num_tokens != want->num_tokens) {
+      snprintf(why, why_size, "line %zu differs", i);
+      return false;
+    }
+    for (size_t j = 0; j < got.num_tokens; j++) {
+      if (got.tokens[j].kind != want->tokens[j].kind ||
+          strcmp(got.tokens[j].text, want->tokens[j].text) != 0) {
+        snprintf(why, why_size, "line %zu token %zu: '%s' vs '%s'", i, j,
+                 got.tokens[j].text, want->tokens[j].text);
+        return false;
+      }
+    }
+    // Tree guides: the bitmask against a scan of the levels.
+    for (int d = 1; d <= want->level + 1; d++) {
+      bool cont = false;
+      for (size_t k = i + 1; k < ref->num_lines; k++) {
+        if (ref->lines[k].level <= d) {
+          cont = (ref->lines[k].level == d);
+          break;
+        }
+      }
+      if (miniscript_policy_view_continues(view, i, d) != cont) {
+        snprintf(why, why_size, "line %zu depth %d continuation", i, d);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Same text, same tokens; false with a reason in `why` otherwise.
+static bool compare(const char *policy, size_t width, char *why,
+                    size_t why_size) {
+  char *want = ref_miniscript_policy_indent(policy, width);
+  char *got = miniscript_policy_indent(policy, width);
+  bool ok = (!want && !got) || (want && got && strcmp(want, got) == 0);
+  if (!ok)
+    snprintf(why, why_size, "indent differs at width %zu", width);
+  free(want);
+  free(got);
+  if (!ok || !want)
+    return ok;
+
+  ref_view_t ref;
+  ms_policy_view_t *view = miniscript_policy_view_build(policy, width);
+  if (!ref_view_build(policy, width, &ref) || !view) {
+    snprintf(why, why_size, "view build failed");
+    miniscript_policy_view_release(view);
+    return false;
+  }
+  ok = same_view(&ref, view, why, why_size);
+  ref_view_free(&ref);
+  miniscript_policy_view_release(view);
+  return ok;
+}
+
+static const size_t WIDTHS[] = {12, 20, 25, 27, 33, 40, 64};
+
+static void test_random_policies(void) {
+  static gen_t g;
+  for (int depth = 2; depth <= 6; depth++) {
+    char name[96], why[128] = "";
+    bool ok = true;
+    size_t longest = 0;
+    for (uint32_t seed = 1; ok && seed <= 60; seed++) {
+      const char *policy = gen_policy(&g, seed * 7919u + (uint32_t)depth,
+                                      depth);
+      if (g.len > longest)
+        longest = g.len;
+      for (size_t w = 0; ok && w < COUNT(WIDTHS); w++)
+        ok = compare(policy, WIDTHS[w], why, sizeof(why));
+    }
+    snprintf(name, sizeof(name),
+             "60 random policies, depth %d (up to %zu chars)", depth, longest);
+    check(name, ok, why);
+  }
+}
+
+static void test_odd_inputs(void) {
+  // Shapes the indenter does not expect from libwally, kept byte-for-byte.
+  static const char *const INPUTS[] = {
+      "pk()",
+      "f(,a)",
+      "f(a,)",
+      "f(a,,b)",
+      "f())",
+      "f(a))",
+      "f(g()))",
+      "f(g(),h())",
+      "f(  a , b )",
+      "a(b(c(d(e(f(g(h(i(j(k)))))))))))",
+      "tr(A,{pk(B),pk(C)})",
+      "tr(A,{and_v(v:pk(B),older(6)),{pk(C),pk(D)}})",
+      ")",
+      "(",
+      "x",
+      "wsh(thresh(1,pk(A),s:pk(B),s:pk(C)))",
+      "f(g(h())),a)",
+      "f(,)",
+      "f(g(,))",
+  };
+  char why[128] = "";
+  bool ok = true;
+  for (size_t i = 0; ok && i < COUNT(INPUTS); i++)
+    for (size_t w = 0; ok && w < COUNT(WIDTHS); w++)
+      if (!compare(INPUTS[i], WIDTHS[w], why, sizeof(why))) {
+        snprintf(why, sizeof(why), "'%s' at width %zu", INPUTS[i], WIDTHS[w]);
+        ok = false;
+      }
+  check("odd inputs match the previous indenter", ok, why);
+}
+
+static void measure(const char *policy, size_t width, alloc_stats_t *ref_stats,
+                    alloc_stats_t *new_stats) {
+  stats_begin();
+  ref_view_t ref;
+  if (ref_view_build(policy, width, &ref))
+    ref_view_free(&ref);
+  *ref_stats = stats_end();
+
+  stats_begin();
+  ms_policy_view_t *view = miniscript_policy_view_build(policy, width);
+  size_t n = miniscript_policy_view_num_lines(view);
+  for (size_t i = 0; i < n; i++) {
+    ms_policy_line_t line;
+    if (!miniscript_policy_view_line(view, i, &line))
+      break;
+  }
+  miniscript_policy_view_release(view);
+  *new_stats = stats_end();
+}
+
+static void test_large_policies(void) {
+  static gen_t g;
+  static const struct {
+    int keys;
+    int depth;
+  } SHAPES[] = {{8, 1}, {26, 1}, {26, 3}, {40, 4}};
+  for (size_t i = 0; i < COUNT(SHAPES); i++) {
+    const char *policy = gen_wide(&g, SHAPES[i].keys, SHAPES[i].depth);
+    char name[128], why[128] = "";
+    bool ok = compare(policy, 25, why, sizeof(why));
+    snprintf(name, sizeof(name), "%d-key thresh, depth %d (%zu chars)",
+             SHAPES[i].keys, SHAPES[i].depth, g.len);
+    check(name, ok, why);
+
+    alloc_stats_t ref_stats, new_stats;
+    measure(policy, 25, &ref_stats, &new_stats);
+    printf("  previous: %zu allocations, peak %lld B; now: %zu allocations, "
+           "peak %lld B\n",
+           ref_stats.calls, ref_stats.peak, new_stats.calls, new_stats.peak);
+    snprintf(name, sizeof(name), "%d-key depth %d: fewer allocations, lower "
+             "peak", SHAPES[i].keys, SHAPES[i].depth);
+    check(name,
+          new_stats.calls < ref_stats.calls / 10 &&
+              new_stats.peak < ref_stats.peak && new_stats.live == 0,
+          "allocation counts");
+  }
+
+  // Building and tokenizing a random deep policy also stays bounded.
+  const char *policy = gen_policy(&g, 424242u, 7);
+  char why[128] = "";
+  check("random depth-7 policy matches", compare(policy, 25, why, sizeof(why)),
+        why);
+}
+
+static void test_lazy_lines(void) {
+  static gen_t g;
+  const char *policy = gen_wide(&g, 26, 3);
+
+  // One screen's worth of lines costs no allocation beyond the build.
+  stats_begin();
+  ms_policy_view_t *view = miniscript_policy_view_build(policy, 25);
+  alloc_stats_t built = stats;
+  bool ok = view != NULL;
+  for (size_t i = 0; ok && i < 12; i++) {
+    ms_policy_line_t line;
+    ok = miniscript_policy_view_line(view, i, &line);
+  }
+  alloc_stats_t after = stats_end();
+  check("tokenizing visible lines allocates nothing",
+        ok && after.calls == built.calls, "allocations while tokenizing");
+
+  // The view is a single block once built.
+  check("built view is one allocation", ok && after.live > 0 &&
+        (size_t)after.live == malloc_usable_size(view), "view allocations");
+  miniscript_policy_view_release(view);
+
+  // A second screen for the same descriptor does not build again.
+  ms_policy_view_t *a = miniscript_policy_view_get("0123abcd", policy, 25);
+  stats_begin();
+  ms_policy_view_t *b = miniscript_policy_view_get("0123abcd", policy, 25);
+  alloc_stats_t cached = stats_end();
+  check("cached view is shared", a && a == b && cached.calls == 0,
+        "rebuilt");
+
+  // The loader holds the same descriptor's policy cut short; neither screen
+  // may be served the other's view.
+  char *cut = strndup(policy, strlen(policy) / 2);
+  ms_policy_view_t *c =
+      cut ? miniscript_policy_view_get("0123abcd", cut, 25) : NULL;
+  ms_policy_view_t *d = miniscript_policy_view_get("0123abcd", policy, 25);
+  check("same checksum, other policy text is not shared",
+        c && c != a && d == a &&
+            miniscript_policy_view_num_lines(c) <
+                miniscript_policy_view_num_lines(a),
+        "shared across policy texts");
+  miniscript_policy_view_release(d);
+  miniscript_policy_view_release(c);
+  free(cut);
+  miniscript_policy_view_release(b);
+  miniscript_policy_view_release(a);
+  miniscript_policy_view_cache_clear();
+}
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench(int keys, int depth) {
+  static gen_t g;
+  const char *policy = gen_wide(&g, keys, depth);
+
+  double t0 = now_us();
+  ref_view_t ref;
+  if (ref_view_build(policy, 25, &ref))
+    ref_view_free(&ref);
+  double t1 = now_us();
+  ms_policy_view_t *view = miniscript_policy_view_build(policy, 25);
+  double t2 = now_us();
+  size_t n = miniscript_policy_view_num_lines(view);
+  for (size_t i = 0; i < n && i < 12; i++) {
+    ms_policy_line_t line;
+    if (!miniscript_policy_view_line(view, i, &line))
+      break;
+  }
+  double t3 = now_us();
+  miniscript_policy_view_release(view);
+
+  printf("%2d keys depth %d (%5zu chars, %5zu lines)  previous %9.0f us  "
+         "now build %6.0f us + first screen %4.0f us\n",
+         keys, depth, g.len, n, t1 - t0, t2 - t1, t3 - t2);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench(8, 1);
+    bench(26, 1);
+    bench(26, 3);
+    bench(40, 4);
+    bench(40, 6);
+    return 0;
+  }
+
+  printf("=== miniscript policy view tests ===\n");
+
+  printf("\n--- Group 1: random policies match the previous view ---\n");
+  test_random_policies();
+
+  printf("\n--- Group 2: odd inputs ---\n");
+  test_odd_inputs();
+
+  printf("\n--- Group 3: large policies, outputs and allocations ---\n");
+  test_large_policies();
+
+  printf("\n--- Group 4: lazy lines and the view cache ---\n");
+  test_lazy_lines();
+
+  printf("\nResults: %d passed, %d failed\n", tests_passed, tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Tests for the power governor state machine (main/utils/power_gov.c): which
+ * state the activities and the UI level select, the PM locks and backlight
+ * each state leaves behind, camera gating and the battery estimate.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "utils/power_gov.h"
+#include <esp_pm.h>
+
+/* Provided by stubs/esp_pm_fake.c */
+bool esp_pm_fake_held(esp_pm_lock_type_t lock_type);
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+static void check(const char *name, bool ok, const char *msg) {
+  TEST(name);
+  if (ok)
+    PASS();
+  else
+    FAIL(msg);
+}
+
+static void check_state(const char *name, power_state_t expected) {
+  char msg[64];
+  snprintf(msg, sizeof(msg), "expected %s, got %s",
+           power_gov_state_name(expected),
+           power_gov_state_name(power_gov_state()));
+  check(name, power_gov_state() == expected, msg);
+}
+
+static int backlight = -1;
+static int backlight_writes = 0;
+static int camera_idle_calls = 0;
+static bool battery_present = true;
+static uint8_t battery = 100;
+
+static void fake_backlight(uint8_t percent) {
+  backlight = percent;
+  backlight_writes++;
+}
+
+static bool fake_battery(uint8_t *percent) {
+  if (!battery_present)
+    return false;
+  *percent = battery;
+  return true;
+}
+
+static void fake_camera_idle(void) { camera_idle_calls++; }
+
+static uint32_t clock_ms = 0;
+static uint32_t fake_now(void) { return clock_ms; }
+static void advance(uint32_t ms) { clock_ms += ms; }
+
+static bool locks(bool cpu, bool apb) {
+  return esp_pm_fake_held(ESP_PM_CPU_FREQ_MAX) == cpu &&
+         esp_pm_fake_held(ESP_PM_APB_FREQ_MAX) == apb &&
+         esp_pm_fake_held(ESP_PM_NO_LIGHT_SLEEP);
+}
+
+int main(void) {
+  printf("=== power governor tests ===\n");
+
+  printf("\n--- Group 1: UI levels ---\n");
+  {
+    power_gov_hooks_t hooks = {.set_backlight = fake_backlight,
+                               .battery_percent = fake_battery,
+                               .camera_idle = fake_camera_idle,
+                               .now_ms = fake_now};
+    power_gov_init(&hooks, 60);
+    check_state("starts interactive", POWER_STATE_INTERACTIVE);
+    check("interactive holds CPU and APB at max", locks(true, true),
+          "wrong locks");
+    check("init leaves the backlight alone", backlight_writes == 0,
+          "backlight written");
+
+    advance(1000);
+    power_gov_set_ui(POWER_UI_IDLE);
+    check_state("idle", POWER_STATE_IDLE);
+    check("idle drops both frequency locks", locks(false, false),
+          "locks still held");
+
+    advance(1000);
+    power_gov_set_ui(POWER_UI_SCREENSAVER);
+    check_state("screensaver", POWER_STATE_SCREENSAVER);
+    check("screensaver dims to a fifth", backlight == 12, "not dimmed");
+
+    power_gov_set_brightness(80);
+    check("brightness change while dimmed stays dimmed", backlight == 16,
+          "undimmed");
+
+    advance(1000);
+    power_gov_set_ui(POWER_UI_INTERACTIVE);
+    check_state("input wakes it", POWER_STATE_INTERACTIVE);
+    check("backlight back at the user level", backlight == 80,
+          "still dimmed");
+    check("locks back", locks(true, true), "locks missing");
+
+    int writes = backlight_writes;
+    advance(1000);
+    power_gov_set_ui(POWER_UI_INTERACTIVE);
+    check("steady state writes nothing", backlight_writes == writes,
+          "backlight rewritten");
+  }
+
+  printf("\n--- Group 2: activities ---\n");
+  {
+    advance(1000);
+    power_gov_set_ui(POWER_UI_IDLE);
+    power_gov_acquire(POWER_ACT_KDF);
+    check_state("KDF outranks idle", POWER_STATE_KDF);
+    check("KDF holds the CPU lock only", locks(true, false), "wrong locks");
+
+    power_gov_acquire(POWER_ACT_SIGNING);
+    check_state("signing outranks KDF", POWER_STATE_SIGNING);
+    check("signing holds both locks", locks(true, true), "wrong locks");
+
+    power_gov_release(POWER_ACT_SIGNING);
+    check_state("back to KDF", POWER_STATE_KDF);
+    power_gov_release(POWER_ACT_KDF);
+    check_state("back to idle", POWER_STATE_IDLE);
+    check("idle again drops the locks", locks(false, false), "locks held");
+  }
+  {
+    advance(1000);
+    power_gov_set_ui(POWER_UI_SCREENSAVER);
+    power_gov_acquire(POWER_ACT_KDF);
+    check_state("KDF under the screensaver", POWER_STATE_KDF);
+    check("busy state undims", backlight == 80, "still dimmed");
+    power_gov_release(POWER_ACT_KDF);
+    check("screensaver dims again", backlight == 16, "not dimmed");
+    advance(1000);
+    power_gov_set_ui(POWER_UI_INTERACTIVE);
+  }
+  {
+    power_gov_acquire(POWER_ACT_SCANNING);
+    power_gov_acquire(POWER_ACT_SCANNING);
+    check_state("scanning", POWER_STATE_SCANNING);
+    power_gov_release(POWER_ACT_SCANNING);
+    check("camera stays with a consumer left",
+          camera_idle_calls == 0 &&
+              power_gov_state() == POWER_STATE_SCANNING,
+          "gated early");
+    power_gov_release(POWER_ACT_SCANNING);
+    check("last consumer gates the camera", camera_idle_calls == 1,
+          "camera_idle not called");
+    check_state("back to interactive", POWER_STATE_INTERACTIVE);
+
+    power_gov_release(POWER_ACT_SCANNING);
+    check("unbalanced release is ignored",
+          camera_idle_calls == 1 &&
+              power_gov_state() == POWER_STATE_INTERACTIVE,
+          "count went negative");
+    power_gov_acquire(POWER_ACT_COUNT);
+    check_state("out-of-range activity is ignored", POWER_STATE_INTERACTIVE);
+  }
+
+  printf("\n--- Group 3: battery estimate ---\n");
+  {
+    uint32_t minutes;
+    power_gov_log_battery();
+    check("no estimate without a drop", !power_gov_battery_estimate(&minutes),
+          "estimate from nothing");
+
+    // 1% per log interval (10 min).
+    battery = 99;
+    advance(POWER_GOV_BATTERY_LOG_MS);
+    power_gov_log_battery();
+    check("1% in 10 min leaves 99 x 10 min",
+          power_gov_battery_estimate(&minutes) && minutes == 990,
+          "wrong estimate");
+
+    battery = 95;
+    advance(POWER_GOV_BATTERY_LOG_MS);
+    power_gov_log_battery();
+    check("faster drain shortens it",
+          power_gov_battery_estimate(&minutes) && minutes == 95 * 20 / 5,
+          "estimate did not follow the drain");
+
+    battery = 97;
+    advance(POWER_GOV_BATTERY_LOG_MS);
+    power_gov_log_battery();
+    check("charging restarts the window", !power_gov_battery_estimate(&minutes),
+          "estimate across a charge");
+
+    battery_present = false;
+    battery = 50;
+    advance(POWER_GOV_BATTERY_LOG_MS);
+    power_gov_log_battery();
+    check("no gauge, no new sample", !power_gov_battery_estimate(&minutes),
+          "sampled without a gauge");
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,398 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/bip32_path.h"
+#include "core/descriptor_checksum.h"
+#include "core/registry.h"
+#include <wally_script.h>
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+/* Account-level xpubs from the standard BIP39 test mnemonic "abandon...about".
+ * key_get_fingerprint stub returns {0x00,0x00,0x00,0x00}, so descriptors
+ * with origin fingerprint 00000000 match our wallet. */
+#define XPUB_84                                                                \
+  "xpub6CatWdiZiodmUeTDp8LT5or8nmbKNcuyvz7WyksVFkKB4RHwCD3XyuvP"               \
+  "EbvqAQY3rAPshWcMLoP2fMFMKHPJ4ZeZXYVUhLv1VMrjPC7PW6V"
+#define XPUB_86                                                                \
+  "xpub6BgBgsespWvERF3LHQu6CnqdvfEvtMcQjYrcRzx53QJjSxarj2afYWc"                \
+  "LteoGVky7D3UKDP9QyrLprQ3VCECoY49yfdDEHGCtMMj92pReUsQ"
+
+#define NUM_SYNTHETIC 240
+
+/* --- Reference: the original linear scans --------------------------------- */
+
+static bool ref_has_duplicate_checksum(const char checksum[9], char *out_id,
+                                       size_t out_id_size) {
+  for (size_t i = 0; i < registry_count(); i++) {
+    const registry_entry_t *e = registry_get(i);
+    char entry_cksum[9];
+    if (e->desc && descriptor_checksum_from_descriptor(e->desc, entry_cksum) &&
+        strcmp(entry_cksum, checksum) == 0) {
+      snprintf(out_id, out_id_size, "%s", e->id);
+      return true;
+    }
+  }
+  return false;
+}
+
+static const registry_entry_t *ref_match_keypath(const uint8_t *keypath,
+                                                 size_t keypath_len,
+                                                 size_t *cursor) {
+  if (keypath_len < 4 || (keypath_len - 4) % 4 != 0)
+    return NULL;
+  size_t total_depth = (keypath_len - 4) / 4;
+  if (total_depth > MAX_KEYPATH_TOTAL_DEPTH)
+    return NULL;
+
+  for (size_t i = *cursor; i < registry_count(); i++) {
+    const registry_entry_t *e = registry_get(i);
+    if (e->origin_path_len > total_depth)
+      continue;
+    bool origin_matches = true;
+    for (size_t j = 0; j < e->origin_path_len; j++) {
+      if (bip32_path_u32_le(keypath + 4 + j * 4) != e->origin_path[j]) {
+        origin_matches = false;
+        break;
+      }
+    }
+    if (!origin_matches)
+      continue;
+    if (total_depth - e->origin_path_len != MAX_KEYPATH_TAIL_DEPTH)
+      continue;
+    const uint8_t *tail = keypath + 4 + e->origin_path_len * 4;
+    uint32_t mp = bip32_path_u32_le(tail);
+    uint32_t ix = bip32_path_u32_le(tail + 4);
+    if (bip32_path_is_hardened(mp) || bip32_path_is_hardened(ix) || mp > 1)
+      continue;
+    if (e->num_paths == 1 && mp != 0)
+      continue;
+    *cursor = i + 1;
+    return e;
+  }
+  return NULL;
+}
+
+/* --- Fixtures ------------------------------------------------------------- */
+
+static void put_u32_le(uint8_t *out, uint32_t v) {
+  out[0] = (uint8_t)v;
+  out[1] = (uint8_t)(v >> 8);
+  out[2] = (uint8_t)(v >> 16);
+  out[3] = (uint8_t)(v >> 24);
+}
+
+static size_t build_keypath(uint8_t *out, const uint32_t *origin,
+                            size_t origin_len, uint32_t mp, uint32_t ix) {
+  put_u32_le(out, 0xEFBEADDE);
+  for (size_t j = 0; j < origin_len; j++)
+    put_u32_le(out + 4 + j * 4, origin[j]);
+  put_u32_le(out + 4 + origin_len * 4, mp);
+  put_u32_le(out + 8 + origin_len * 4, ix);
+  return 4 + (origin_len + 2) * 4;
+}
+
+/* Three shapes cycling over the account number: single-path wpkh, multipath
+ * wpkh and a 2-of-2 multisig whose cosigner origin is shared by all. */
+static bool add_synthetic(size_t i) {
+  char id[REGISTRY_ID_MAX_LEN];
+  char desc[512];
+  snprintf(id, sizeof(id), "d%zu", i);
+  switch (i % 3) {
+  case 0:
+    snprintf(desc, sizeof(desc), "wpkh([00000000/84'/0'/%zu']" XPUB_84 "/0/*)",
+             i);
+    break;
+  case 1:
+    snprintf(desc, sizeof(desc),
+             "wpkh([00000000/48'/0'/%zu'/2']" XPUB_84 "/<0;1>/*)", i);
+    break;
+  default:
+    snprintf(desc, sizeof(desc),
+             "wsh(multi(2,[00000000/48'/1'/%zu'/2']" XPUB_84
+             "/<0;1>/*,[73c5da0a/48'/1'/0'/2']" XPUB_86 "/<0;1>/*))",
+             i);
+    break;
+  }
+  return registry_add_from_string(id, desc, STORAGE_FLASH, false);
+}
+
+/* Every entry's own keypaths (plus near misses) must yield the same sequence
+ * of matches, cursor by cursor, as the linear scan. */
+static bool keypath_matches_agree(void) {
+  static const uint32_t tails[][2] = {
+      {0, 0}, {0, 7}, {1, 3}, {2, 0}, {0x80000000, 0}, {0, 0x80000001},
+  };
+  for (size_t i = 0; i < registry_count(); i++) {
+    const registry_entry_t *e = registry_get(i);
+    for (size_t t = 0; t < sizeof(tails) / sizeof(tails[0]); t++) {
+      for (int shorten = 0; shorten <= 1; shorten++) {
+        if (shorten && e->origin_path_len == 0)
+          continue;
+        uint8_t kp[4 + MAX_KEYPATH_TOTAL_DEPTH * 4];
+        size_t kp_len = build_keypath(kp, e->origin_path,
+                                      e->origin_path_len - (size_t)shorten,
+                                      tails[t][0], tails[t][1]);
+        size_t got_cursor = 0;
+        size_t want_cursor = 0;
+        for (;;) {
+          const registry_entry_t *got =
+              registry_match_keypath(kp, kp_len, &got_cursor);
+          const registry_entry_t *want =
+              ref_match_keypath(kp, kp_len, &want_cursor);
+          if (got != want || got_cursor != want_cursor)
+            return false;
+          if (!got)
+            break;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+static bool duplicate_checks_agree(void) {
+  for (size_t i = 0; i < registry_count(); i++) {
+    const registry_entry_t *e = registry_get(i);
+    char got_id[REGISTRY_ID_MAX_LEN];
+    char want_id[REGISTRY_ID_MAX_LEN];
+    bool got = registry_session_has_duplicate_checksum(e->checksum, got_id,
+                                                       sizeof(got_id));
+    bool want =
+        ref_has_duplicate_checksum(e->checksum, want_id, sizeof(want_id));
+    if (!got || !want || strcmp(got_id, want_id) != 0)
+      return false;
+  }
+  char id[REGISTRY_ID_MAX_LEN];
+  return !registry_session_has_duplicate_checksum("qqqqqqqq", id, sizeof(id));
+}
+
+static double elapsed_us(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e6 +
+         (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+int main(void) {
+  printf("=== registry index tests ===\n\n");
+
+  /* --- Group 1: growth --- */
+  printf("--- Group 1: growth past the initial capacity ---\n");
+  registry_clear();
+  bool all_added = add_synthetic(0);
+  const registry_entry_t *first = registry_get(0);
+  for (size_t i = 1; i < NUM_SYNTHETIC; i++)
+    all_added &= add_synthetic(i);
+
+  TEST("all synthetic descriptors added");
+  if (all_added && registry_count() == NUM_SYNTHETIC) {
+    PASS();
+  } else {
+    FAIL("add failed");
+  }
+
+  TEST("entry pointers survive growth");
+  if (first && registry_find_by_id("d0") == first) {
+    PASS();
+  } else {
+    FAIL("entry moved");
+  }
+
+  /* --- Group 2: cached metadata --- */
+  printf("\n--- Group 2: cached metadata ---\n");
+  {
+    bool ok = true;
+    for (size_t i = 0; i < registry_count(); i++) {
+      const registry_entry_t *e = registry_get(i);
+      char cksum[9];
+      if (!descriptor_checksum_from_descriptor(e->desc, cksum) ||
+          strcmp(cksum, e->checksum) != 0)
+        ok = false;
+    }
+    TEST("cached checksums match recomputed ones");
+    if (ok) {
+      PASS();
+    } else {
+      FAIL("stale checksum");
+    }
+
+    TEST("script types cached");
+    if (registry_get(0)->script_type == WALLY_SCRIPT_TYPE_P2WPKH &&
+        registry_get(2)->script_type == WALLY_SCRIPT_TYPE_P2WSH) {
+      PASS();
+    } else {
+      FAIL("wrong script type");
+    }
+  }
+
+  /* --- Group 3: equivalence with the linear scans --- */
+  printf("\n--- Group 3: equivalence with linear scans ---\n");
+  TEST("duplicate checks agree");
+  if (duplicate_checks_agree()) {
+    PASS();
+  } else {
+    FAIL("duplicate mismatch");
+  }
+
+  TEST("keypath matches agree");
+  if (keypath_matches_agree()) {
+    PASS();
+  } else {
+    FAIL("keypath mismatch");
+  }
+
+  /* A second descriptor on an existing origin chains behind the first */
+  TEST("shared origin returns both entries in order");
+  {
+    bool ok = registry_add_from_string(
+        "shared", "tr([00000000/84'/0'/0']" XPUB_86 "/0/*)", STORAGE_FLASH,
+        false);
+    static const uint32_t origin[] = {0x80000054, 0x80000000, 0x80000000};
+    uint8_t kp[4 + MAX_KEYPATH_TOTAL_DEPTH * 4];
+    size_t kp_len = build_keypath(kp, origin, 3, 0, 1);
+    size_t cursor = 0;
+    const registry_entry_t *a = registry_match_keypath(kp, kp_len, &cursor);
+    const registry_entry_t *b = registry_match_keypath(kp, kp_len, &cursor);
+    const registry_entry_t *c = registry_match_keypath(kp, kp_len, &cursor);
+    if (ok && a && strcmp(a->id, "d0") == 0 && b &&
+        strcmp(b->id, "shared") == 0 && !c && keypath_matches_agree()) {
+      PASS();
+    } else {
+      FAIL("wrong chain");
+    }
+  }
+
+  /* --- Group 4: removal re-indexes --- */
+  printf("\n--- Group 4: removal ---\n");
+  {
+    bool removed = true;
+    for (size_t i = 0; i < NUM_SYNTHETIC; i += 7) {
+      char id[REGISTRY_ID_MAX_LEN];
+      snprintf(id, sizeof(id), "d%zu", i);
+      removed &= registry_remove(id);
+    }
+    TEST("entries removed");
+    if (removed && registry_find_by_id("d7") == NULL) {
+      PASS();
+    } else {
+      FAIL("remove failed");
+    }
+
+    TEST("indexes agree after removal");
+    if (duplicate_checks_agree() && keypath_matches_agree()) {
+      PASS();
+    } else {
+      FAIL("stale index");
+    }
+
+    TEST("re-added entry is found again");
+    if (add_synthetic(7) && duplicate_checks_agree() &&
+        keypath_matches_agree()) {
+      PASS();
+    } else {
+      FAIL("re-add failed");
+    }
+  }
+
+  /* --- Group 5: timing --- */
+  printf("\n--- Group 5: timing (%zu entries) ---\n", registry_count());
+  {
+    const int rounds = 20;
+    size_t n = registry_count();
+    struct timespec start;
+    volatile size_t sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < n; i++) {
+        const registry_entry_t *e = registry_get(i);
+        uint8_t kp[4 + MAX_KEYPATH_TOTAL_DEPTH * 4];
+        size_t kp_len =
+            build_keypath(kp, e->origin_path, e->origin_path_len, 0, 1);
+        size_t cursor = 0;
+        while (ref_match_keypath(kp, kp_len, &cursor))
+          sink++;
+      }
+    }
+    double linear_match = elapsed_us(&start) / (rounds * n);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < n; i++) {
+        const registry_entry_t *e = registry_get(i);
+        uint8_t kp[4 + MAX_KEYPATH_TOTAL_DEPTH * 4];
+        size_t kp_len =
+            build_keypath(kp, e->origin_path, e->origin_path_len, 0, 1);
+        size_t cursor = 0;
+        while (registry_match_keypath(kp, kp_len, &cursor))
+          sink++;
+      }
+    }
+    double indexed_match = elapsed_us(&start) / (rounds * n);
+
+    char id[REGISTRY_ID_MAX_LEN];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < n; i++)
+      sink += ref_has_duplicate_checksum(registry_get(i)->checksum, id,
+                                         sizeof(id));
+    double linear_dup = elapsed_us(&start) / n;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < rounds; r++) {
+      for (size_t i = 0; i < n; i++)
+        sink += registry_session_has_duplicate_checksum(
+            registry_get(i)->checksum, id, sizeof(id));
+    }
+    double indexed_dup = elapsed_us(&start) / (rounds * n);
+
+    printf("keypath match:   linear %10.3f us   indexed %8.3f us\n",
+           linear_match, indexed_match);
+    printf("duplicate check: linear %10.3f us   indexed %8.3f us\n",
+           linear_dup, indexed_dup);
+    (void)sink;
+  }
+
+  /* --- Group 6: upper bound --- */
+  printf("\n--- Group 6: upper bound ---\n");
+  {
+    registry_clear();
+    bool ok = true;
+    for (size_t i = 0; i < REGISTRY_MAX_ENTRIES; i++)
+      ok &= add_synthetic(i);
+    TEST("fills to REGISTRY_MAX_ENTRIES");
+    if (ok && registry_count() == REGISTRY_MAX_ENTRIES) {
+      PASS();
+    } else {
+      FAIL("could not fill");
+    }
+
+    TEST("add past the bound fails");
+    if (!add_synthetic(REGISTRY_MAX_ENTRIES) &&
+        registry_count() == REGISTRY_MAX_ENTRIES) {
+      PASS();
+    } else {
+      FAIL("bound not enforced");
+    }
+    registry_clear();
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
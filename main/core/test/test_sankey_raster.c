@@ -0,0 +1,441 @@
+/*
+ * Tests for the Sankey rasterizer (main/ui/sankey_raster.c).
+ *
+ * The reference below is the float renderer sankey.c used before the
+ * fixed-point rewrite, ported onto a plain buffer. Both render the same
+ * diagrams and the outputs are compared pixel by pixel. Fixed-point edges and
+ * the integer blend round slightly differently from the float code, so a
+ * small share of edge pixels may differ by one step per channel.
+ *
+ * Usage: test_sankey_raster [--bench]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ui/sankey_raster.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+/* Pixels allowed to differ, and by how much per 5/6/5 channel. */
+#define MAX_DIFF_PER_MILLE 10
+#define MAX_CHANNEL_DIFF 1
+
+/* --- Reference: the float renderer -------------------------------------- */
+
+typedef struct {
+  uint8_t r, g, b;
+} rgb_t;
+
+typedef struct {
+  uint64_t amount;
+  float thickness;
+  float y_center;
+  rgb_t color;
+} ref_flow_t;
+
+static rgb_t rgb(uint32_t c) {
+  return (rgb_t){(c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF};
+}
+
+static uint16_t rgb_to_565(rgb_t c) {
+  return ((c.r & 0xF8) << 8) | ((c.g & 0xFC) << 3) | (c.b >> 3);
+}
+
+static float ref_bezier_ease(float p0, float p3, float t) {
+  float eased_t = t * t * (3.0f - 2.0f * t);
+  return p0 + (p3 - p0) * eased_t;
+}
+
+static rgb_t ref_color_lerp(rgb_t c1, rgb_t c2, float t) {
+  if (t <= 0.0f)
+    return c1;
+  if (t >= 1.0f)
+    return c2;
+  return (rgb_t){(uint8_t)(c1.r + t * (c2.r - c1.r)),
+                 (uint8_t)(c1.g + t * (c2.g - c1.g)),
+                 (uint8_t)(c1.b + t * (c2.b - c1.b))};
+}
+
+static void ref_set_pixel_blended(const sankey_raster_target_t *t, int32_t x,
+                                  int32_t y, uint16_t fg, uint8_t alpha) {
+  uint16_t *row = (uint16_t *)(t->data + y * t->stride);
+  if (alpha >= 255) {
+    row[x] = fg;
+  } else if (alpha > 0) {
+    uint16_t bg = row[x];
+    uint8_t inv = 255 - alpha;
+    row[x] =
+        ((((fg >> 11) * alpha + (bg >> 11) * inv) / 255) << 11) |
+        (((((fg >> 5) & 0x3F) * alpha + ((bg >> 5) & 0x3F) * inv) / 255) << 5) |
+        (((fg & 0x1F) * alpha + (bg & 0x1F) * inv) / 255);
+  }
+}
+
+static void ref_draw_aa_column(const sankey_raster_target_t *t, int32_t x,
+                               float y_top_f, float y_bot_f, uint16_t color16) {
+  if (x < 0 || x >= t->width)
+    return;
+  int32_t y_top = (int32_t)y_top_f;
+  int32_t y_bot = (int32_t)y_bot_f;
+  if (y_top >= 0 && y_top < t->height)
+    ref_set_pixel_blended(t, x, y_top, color16,
+                          255 - (uint8_t)((y_top_f - y_top) * 255.0f));
+  int32_t fill_start = (y_top + 1 > 0) ? y_top + 1 : 0;
+  int32_t fill_end = (y_bot < t->height) ? y_bot : t->height;
+  for (int32_t y = fill_start; y < fill_end; y++)
+    ((uint16_t *)(t->data + y * t->stride))[x] = color16;
+  if (y_bot > y_top && y_bot >= 0 && y_bot < t->height)
+    ref_set_pixel_blended(t, x, y_bot, color16,
+                          (uint8_t)((y_bot_f - y_bot) * 255.0f));
+}
+
+static void ref_draw_gradient_rect(const sankey_raster_target_t *t,
+                                   int32_t x_start, int32_t x_end,
+                                   float y_top_f, float y_bot_f, rgb_t left,
+                                   rgb_t right) {
+  int32_t width = x_end - x_start;
+  if (width <= 0)
+    return;
+  for (int32_t x = x_start; x <= x_end; x++)
+    ref_draw_aa_column(
+        t, x, y_top_f, y_bot_f,
+        rgb_to_565(ref_color_lerp(left, right, (float)(x - x_start) / width)));
+}
+
+static void ref_draw_bezier_ribbon(const sankey_raster_target_t *t, float x0,
+                                   float y0_top, float y0_bot, float x3,
+                                   float y3_top, float y3_bot, rgb_t start,
+                                   rgb_t end) {
+  float width = x3 - x0;
+  if (width <= 0.0f)
+    return;
+  for (int32_t x = (int32_t)(x0 + 0.5f); x <= (int32_t)(x3 + 0.5f); x++) {
+    float f = ((float)x - x0) / width;
+    f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+    float y_top_f = ref_bezier_ease(y0_top, y3_top, f);
+    float y_bot_f = ref_bezier_ease(y0_bot, y3_bot, f);
+    if (y_top_f > y_bot_f) {
+      float tmp = y_top_f;
+      y_top_f = y_bot_f;
+      y_bot_f = tmp;
+    }
+    ref_draw_aa_column(t, x, y_top_f, y_bot_f,
+                       rgb_to_565(ref_color_lerp(start, end, f)));
+  }
+}
+
+static void ref_layout(ref_flow_t *flows, size_t count, uint64_t total,
+                       int32_t height) {
+  float budget = height * 30 / 100.0f;
+  float gap = (count > 1) ? height * 70 / 100.0f / (count - 1) : 0;
+  float total_raw = 0;
+  for (size_t i = 0; i < count; i++) {
+    flows[i].thickness = (float)flows[i].amount / total * budget;
+    if (flows[i].thickness < 4)
+      flows[i].thickness = 4;
+    total_raw += flows[i].thickness;
+  }
+  if (total_raw > budget) {
+    float scale = budget / total_raw;
+    for (size_t i = 0; i < count; i++)
+      flows[i].thickness *= scale;
+  }
+  float y = flows[0].thickness / 2.0f;
+  for (size_t i = 0; i < count; i++) {
+    flows[i].y_center = y;
+    if (i < count - 1)
+      y += flows[i].thickness / 2.0f + gap + flows[i + 1].thickness / 2.0f;
+  }
+}
+
+static void ref_render(const sankey_raster_target_t *t, uint32_t bg_rgb,
+                       const sankey_raster_flow_t *in, size_t in_count,
+                       const sankey_raster_flow_t *out, size_t out_count,
+                       uint64_t total_ref) {
+  rgb_t bg = rgb(bg_rgb);
+  uint16_t bg16 = rgb_to_565(bg);
+  for (int32_t y = 0; y < t->height; y++)
+    for (int32_t x = 0; x < t->width; x++)
+      ((uint16_t *)(t->data + y * t->stride))[x] = bg16;
+  if (in_count == 0 || out_count == 0)
+    return;
+
+  ref_flow_t inputs[SANKEY_RASTER_MAX_FLOWS], outputs[SANKEY_RASTER_MAX_FLOWS];
+  for (size_t i = 0; i < in_count; i++)
+    inputs[i] = (ref_flow_t){.amount = in[i].amount, .color = rgb(in[i].color)};
+  for (size_t i = 0; i < out_count; i++)
+    outputs[i] =
+        (ref_flow_t){.amount = out[i].amount, .color = rgb(out[i].color)};
+
+  float center_x = t->width / 2.0f, center_y = t->height / 2.0f;
+  ref_layout(inputs, in_count, total_ref, t->height);
+  ref_layout(outputs, out_count, total_ref, t->height);
+
+  float in_stack = 0, out_stack = 0;
+  for (size_t i = 0; i < in_count; i++)
+    in_stack += inputs[i].thickness;
+  for (size_t i = 0; i < out_count; i++)
+    out_stack += outputs[i].thickness;
+  float in_pos[SANKEY_RASTER_MAX_FLOWS], out_pos[SANKEY_RASTER_MAX_FLOWS];
+  float y_pos = center_y - in_stack / 2.0f;
+  for (size_t i = 0; i < in_count; i++) {
+    in_pos[i] = y_pos + inputs[i].thickness / 2.0f;
+    y_pos += inputs[i].thickness;
+  }
+  y_pos = center_y - out_stack / 2.0f;
+  for (size_t i = 0; i < out_count; i++) {
+    out_pos[i] = y_pos + outputs[i].thickness / 2.0f;
+    y_pos += outputs[i].thickness;
+  }
+
+  float fade_width = t->width * 0.05f;
+  float fade_start_x = t->width - fade_width;
+  rgb_t white = rgb(0xFFFFFF);
+  float rect_width = t->width * 0.1f;
+  float rect_left = center_x - rect_width / 2.0f;
+  float rect_right = center_x + rect_width / 2.0f;
+  float stack = in_stack > out_stack ? in_stack : out_stack;
+
+  for (size_t i = 0; i < in_count; i++) {
+    float half = inputs[i].thickness / 2.0f;
+    ref_draw_gradient_rect(t, 0, (int32_t)fade_width,
+                           inputs[i].y_center - half, inputs[i].y_center + half,
+                           bg, inputs[i].color);
+    ref_draw_bezier_ribbon(t, fade_width, inputs[i].y_center - half,
+                           inputs[i].y_center + half, rect_left,
+                           in_pos[i] - half, in_pos[i] + half, inputs[i].color,
+                           white);
+  }
+  for (size_t i = 0; i < out_count; i++) {
+    float half = outputs[i].thickness / 2.0f;
+    ref_draw_bezier_ribbon(t, rect_right, out_pos[i] - half, out_pos[i] + half,
+                           fade_start_x, outputs[i].y_center - half,
+                           outputs[i].y_center + half, white, outputs[i].color);
+    ref_draw_gradient_rect(t, (int32_t)fade_start_x, t->width - 1,
+                           outputs[i].y_center - half,
+                           outputs[i].y_center + half, outputs[i].color, bg);
+  }
+  uint16_t white16 = rgb_to_565(white);
+  for (int32_t x = (int32_t)rect_left; x <= (int32_t)rect_right; x++)
+    ref_draw_aa_column(t, x, center_y - stack / 2.0f, center_y + stack / 2.0f,
+                       white16);
+}
+
+/* --- Harness -------------------------------------------------------------- */
+
+static const uint32_t PALETTE[] = {0xF7931A, 0x00C853, 0x2962FF, 0xD50000,
+                                   0xAA00FF, 0xFFD600, 0x00B8D4, 0xFF6D00};
+
+typedef struct {
+  sankey_raster_target_t target;
+  uint8_t *buf;
+} canvas_t;
+
+static bool canvas_init(canvas_t *c, int32_t width, int32_t height,
+                        uint32_t pad) {
+  c->target.width = width;
+  c->target.height = height;
+  c->target.stride = (uint32_t)width * 2 + pad;
+  c->buf = malloc((size_t)c->target.stride * height);
+  c->target.data = c->buf;
+  if (c->buf)
+    memset(c->buf, 0xA5, (size_t)c->target.stride * height);
+  return c->buf != NULL;
+}
+
+/* Deterministic amounts spanning a few orders of magnitude, so some flows hit
+ * the minimum thickness and others dominate. */
+static void make_flows(sankey_raster_flow_t *flows, size_t count,
+                       uint32_t seed) {
+  uint32_t s = seed;
+  for (size_t i = 0; i < count; i++) {
+    s = s * 1103515245u + 12345u;
+    uint64_t magnitude = 1000ull << ((s >> 16) % 20);
+    flows[i].amount = magnitude + (s >> 8) % magnitude;
+    flows[i].color = PALETTE[(i + seed) % (sizeof(PALETTE) / sizeof(*PALETTE))];
+  }
+}
+
+typedef struct {
+  size_t differing;
+  unsigned max_channel;
+} diff_t;
+
+static diff_t compare(const canvas_t *a, const canvas_t *b) {
+  diff_t d = {0, 0};
+  for (int32_t y = 0; y < a->target.height; y++) {
+    const uint16_t *ra = (const uint16_t *)(a->buf + y * a->target.stride);
+    const uint16_t *rb = (const uint16_t *)(b->buf + y * b->target.stride);
+    for (int32_t x = 0; x < a->target.width; x++) {
+      if (ra[x] == rb[x])
+        continue;
+      d.differing++;
+      int dr = abs((ra[x] >> 11) - (rb[x] >> 11));
+      int dg = abs(((ra[x] >> 5) & 0x3F) - ((rb[x] >> 5) & 0x3F));
+      int db = abs((ra[x] & 0x1F) - (rb[x] & 0x1F));
+      int m = dr > dg ? dr : dg;
+      m = m > db ? m : db;
+      if ((unsigned)m > d.max_channel)
+        d.max_channel = (unsigned)m;
+    }
+  }
+  return d;
+}
+
+static void golden_case(const char *name, int32_t width, int32_t height,
+                        uint32_t pad, uint32_t bg, size_t in_count,
+                        size_t out_count, uint32_t seed) {
+  sankey_raster_flow_t in[SANKEY_RASTER_MAX_FLOWS];
+  sankey_raster_flow_t out[SANKEY_RASTER_MAX_FLOWS];
+  make_flows(in, in_count, seed);
+  make_flows(out, out_count, seed * 7 + 1);
+  uint64_t total = 0;
+  for (size_t i = 0; i < in_count; i++)
+    total += in[i].amount;
+
+  canvas_t ref, got;
+  TEST(name);
+  if (!canvas_init(&ref, width, height, pad) ||
+      !canvas_init(&got, width, height, pad)) {
+    FAIL("out of memory");
+    return;
+  }
+  ref_render(&ref.target, bg, in, in_count, out, out_count, total);
+  bool ok = sankey_raster_render(&got.target, bg, in, in_count, out,
+                                 out_count, total);
+
+  diff_t d = compare(&ref, &got);
+  size_t pixels = (size_t)width * height;
+  char msg[160];
+  snprintf(msg, sizeof(msg),
+           "%zu of %zu pixels differ, max channel diff %u", d.differing,
+           pixels, d.max_channel);
+  if (!ok)
+    FAIL("render failed");
+  else if (d.differing * 1000 > pixels * MAX_DIFF_PER_MILLE ||
+           d.max_channel > MAX_CHANNEL_DIFF)
+    FAIL(msg);
+  else {
+    printf("[%s] ", msg);
+    PASS();
+  }
+  free(ref.buf);
+  free(got.buf);
+}
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench_case(int32_t width, int32_t height) {
+  sankey_raster_flow_t in[16], out[16];
+  make_flows(in, 16, 3);
+  make_flows(out, 16, 22);
+  uint64_t total = 0;
+  for (size_t i = 0; i < 16; i++)
+    total += in[i].amount;
+
+  canvas_t c;
+  if (!canvas_init(&c, width, height, 0))
+    return;
+  const int iterations = 50;
+  double t0 = now_us();
+  for (int i = 0; i < iterations; i++)
+    ref_render(&c.target, 0x000000, in, 16, out, 16, total);
+  double t1 = now_us();
+  for (int i = 0; i < iterations; i++)
+    if (!sankey_raster_render(&c.target, 0x000000, in, 16, out, 16, total))
+      break;
+  double t2 = now_us();
+  printf("%4dx%-4d 16 in / 16 out:  float %8.1f us   fixed %8.1f us\n",
+         (int)width, (int)height, (t1 - t0) / iterations,
+         (t2 - t1) / iterations);
+  free(c.buf);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench_case(720, 720);
+    bench_case(480, 800);
+    return 0;
+  }
+
+  printf("=== sankey_raster tests ===\n");
+
+  printf("\n--- Group 1: golden images against the float renderer ---\n");
+  golden_case("720x720, 2 in / 2 out", 720, 720, 0, 0x000000, 2, 2, 1);
+  golden_case("720x720, 16 in / 16 out", 720, 720, 0, 0x000000, 16, 16, 2);
+  golden_case("480x800, 16 in / 16 out", 480, 800, 0, 0x000000, 16, 16, 3);
+  golden_case("480x800, 1 in / 5 out", 480, 800, 0, 0x000000, 1, 5, 4);
+  golden_case("1024x600, 7 in / 3 out", 1024, 600, 0, 0x000000, 7, 3, 5);
+  golden_case("padded stride", 300, 200, 24, 0x000000, 4, 6, 6);
+  golden_case("non-black background", 480, 480, 0, 0x202830, 5, 5, 7);
+
+  printf("\n--- Group 2: edge cases ---\n");
+  {
+    canvas_t c;
+    TEST("empty side clears to background only");
+    if (canvas_init(&c, 64, 32, 8)) {
+      sankey_raster_flow_t one = {.amount = 1, .color = 0xFFFFFF};
+      bool ok = sankey_raster_render(&c.target, 0x000000, &one, 1, NULL, 0, 1);
+      bool clear = true;
+      for (int32_t y = 0; y < 32 && clear; y++)
+        for (int32_t x = 0; x < 64 && clear; x++)
+          clear = ((uint16_t *)(c.buf + y * c.target.stride))[x] == 0;
+      if (ok && clear)
+        PASS();
+      else
+        FAIL("background not cleared or flows drawn");
+      free(c.buf);
+    } else {
+      FAIL("out of memory");
+    }
+  }
+  {
+    canvas_t c;
+    TEST("row padding is left untouched");
+    if (canvas_init(&c, 100, 80, 6)) {
+      sankey_raster_flow_t in[3], out[3];
+      make_flows(in, 3, 9);
+      make_flows(out, 3, 10);
+      bool ok = sankey_raster_render(&c.target, 0x000000, in, 3, out, 3,
+                                     in[0].amount + in[1].amount +
+                                         in[2].amount);
+      bool untouched = true;
+      for (int32_t y = 0; y < 80 && untouched; y++)
+        for (uint32_t i = 200; i < c.target.stride && untouched; i++)
+          untouched = c.buf[y * c.target.stride + i] == 0xA5;
+      if (ok && untouched)
+        PASS();
+      else
+        FAIL("padding overwritten");
+      free(c.buf);
+    } else {
+      FAIL("out of memory");
+    }
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
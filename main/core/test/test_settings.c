@@ -0,0 +1,264 @@
+/*
+ * Tests for the RAM-mirrored settings store (main/core/settings.c) against an
+ * in-memory NVS that counts writes and commits and can simulate a power cut.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core/settings.h"
+#include <nvs.h>
+
+/* Provided by stubs/nvs_fake.c */
+void nvs_fake_reset(void);
+void nvs_fake_reset_counters(void);
+int nvs_fake_commits(void);
+int nvs_fake_writes(void);
+int nvs_fake_reads(void);
+void nvs_fake_fail_writes(bool fail);
+void nvs_fake_power_cut(void);
+bool nvs_fake_durable_u8(const char *key, uint8_t *out);
+
+/* Commit timer driven by hand: arm only records it, commit_timer_fire()
+ * expires it as the UI deadline would. */
+static bool commit_armed = false;
+
+static void fake_commit_arm(uint32_t delay_ms) {
+  (void)delay_ms;
+  commit_armed = true;
+}
+
+static void fake_commit_cancel(void) { commit_armed = false; }
+
+static const settings_commit_timer_t fake_commit_timer = {
+    .arm = fake_commit_arm,
+    .cancel = fake_commit_cancel,
+};
+
+static void commit_timer_fire(void) {
+  if (!commit_armed)
+    return;
+  commit_armed = false;
+  settings_flush();
+}
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+static void check(const char *name, bool ok, const char *msg) {
+  TEST(name);
+  if (ok)
+    PASS();
+  else
+    FAIL(msg);
+}
+
+static void check_count(const char *name, int got, int expected) {
+  char msg[64];
+  snprintf(msg, sizeof(msg), "expected %d, got %d", expected, got);
+  check(name, got == expected, msg);
+}
+
+/* Fresh device: empty NVS, settings opened on it. */
+static void boot_fresh(void) {
+  settings_deinit();
+  nvs_fake_reset();
+  if (settings_init() != ESP_OK)
+    printf("settings_init failed\n");
+  nvs_fake_reset_counters();
+}
+
+/* Reboot onto whatever NVS holds durably, as after a power cut: RAM state is
+ * gone without a settings_deinit(), so init simply runs again. */
+static void reboot_after_power_cut(void) {
+  nvs_fake_power_cut();
+  if (settings_init() != ESP_OK)
+    printf("settings_init failed\n");
+}
+
+int main(void) {
+  printf("=== settings tests ===\n");
+  settings_set_commit_timer(&fake_commit_timer);
+
+  printf("\n--- Group 1: reads come from RAM ---\n");
+  {
+    boot_fresh();
+    bool defaults = settings_get_network() == WALLET_NETWORK_DEFAULT &&
+                    settings_get_brightness() == 50 &&
+                    settings_get_qr_density() == QR_DENSITY_DEFAULT &&
+                    settings_get_session_timeout() ==
+                        SESSION_TIMEOUT_DEFAULT_SEC &&
+                    !settings_get_permissive_signing() &&
+                    !settings_disclaimer_acknowledged("1.0");
+    check("fresh device reads defaults", defaults, "wrong default");
+    unsigned sum = 0;
+    for (int i = 0; i < 100; i++)
+      sum += settings_get_brightness() + settings_get_qr_fps() +
+             settings_get_screensaver_timeout();
+    (void)sum;
+    check_count("getters do not read NVS", nvs_fake_reads(), 0);
+    check_count("boot commits nothing", nvs_fake_commits(), 0);
+  }
+  {
+    settings_deinit();
+    nvs_fake_reset();
+    nvs_handle_t h;
+    nvs_open("settings", NVS_READWRITE, &h);
+    nvs_set_u8(h, "bright", 5);    /* below BRIGHTNESS_MIN */
+    nvs_set_u8(h, "qr_fps", 3);    /* valid */
+    nvs_set_u16(h, "focus", 9999); /* above FOCUS_POSITION_MAX */
+    nvs_commit(h);
+    if (settings_init() != ESP_OK)
+      printf("settings_init failed\n");
+    check("stored values are range-checked",
+          settings_get_brightness() == 50 && settings_get_qr_fps() == 3 &&
+              settings_get_focus_position() == FOCUS_POSITION_DEFAULT,
+          "out-of-range value served");
+  }
+
+  printf("\n--- Group 2: a typical session ---\n");
+  {
+    boot_fresh();
+    /* Brightness slider dragged across its range and back. */
+    for (uint8_t b = 20; b <= 100; b += 4)
+      settings_set_brightness(b);
+    for (uint8_t b = 100; b >= 60; b -= 5)
+      settings_set_brightness(b);
+    /* A few toggles and a QR density stepper. */
+    settings_set_permissive_signing(true);
+    settings_set_permissive_signing(false);
+    settings_set_permissive_signing(true);
+    for (uint16_t d = 300; d <= 500; d += 50)
+      settings_set_qr_density(d);
+    settings_set_network(WALLET_NETWORK_MAINNET);
+    settings_acknowledge_disclaimer("1.0");
+
+    check_count("no commit while changes are coming in", nvs_fake_commits(),
+                0);
+    check("values are live before the commit",
+          settings_get_brightness() == 60 &&
+              settings_get_permissive_signing() &&
+              settings_get_qr_density() == 500 &&
+              settings_get_network() == WALLET_NETWORK_MAINNET &&
+              settings_disclaimer_acknowledged("1.0"),
+          "getter did not see the new value");
+    check("commit is scheduled", commit_armed, "no timer armed");
+
+    commit_timer_fire();
+    check_count("debounced commit: one commit", nvs_fake_commits(), 1);
+    check_count("debounced commit: one write per changed key",
+                nvs_fake_writes(), 5);
+
+    nvs_fake_reset_counters();
+    settings_set_brightness(60);
+    settings_set_permissive_signing(true);
+    check("re-setting stored values schedules nothing",
+          !commit_armed && nvs_fake_writes() == 0,
+          "unchanged value marked dirty");
+
+    reboot_after_power_cut();
+    check("committed values survive a power cut",
+          settings_get_brightness() == 60 &&
+              settings_get_permissive_signing() &&
+              settings_get_qr_density() == 500 &&
+              settings_get_network() == WALLET_NETWORK_MAINNET &&
+              settings_disclaimer_acknowledged("1.0"),
+          "value lost");
+  }
+
+  printf("\n--- Group 3: flushing before power goes ---\n");
+  {
+    boot_fresh();
+    settings_set_qr_fps(2);
+    reboot_after_power_cut();
+    check("unflushed change is lost on a power cut",
+          settings_get_qr_fps() == QR_FPS_DEFAULT,
+          "change persisted without a commit");
+
+    settings_set_qr_fps(2);
+    nvs_fake_reset_counters();
+    check("flush succeeds", settings_flush() == ESP_OK, "flush failed");
+    check_count("flush commits once", nvs_fake_commits(), 1);
+    reboot_after_power_cut();
+    check("flushed change survives a power cut", settings_get_qr_fps() == 2,
+          "flushed value lost");
+
+    nvs_fake_reset_counters();
+    check("flush with nothing pending is free",
+          settings_flush() == ESP_OK && nvs_fake_commits() == 0,
+          "empty flush committed");
+
+    settings_set_qr_shade(60);
+    settings_deinit();
+    nvs_fake_power_cut();
+    if (settings_init() != ESP_OK)
+      printf("settings_init failed\n");
+    check("deinit flushes pending changes", settings_get_qr_shade() == 60,
+          "deinit dropped the change");
+  }
+
+  printf("\n--- Group 4: explicit choices and failures ---\n");
+  {
+    boot_fresh();
+    settings_set_network(WALLET_NETWORK_DEFAULT);
+    settings_flush();
+    uint8_t v;
+    check("choosing the default is still stored",
+          nvs_fake_durable_u8("def_net", &v) && v == WALLET_NETWORK_DEFAULT,
+          "default choice not written");
+
+    settings_set_ae_target(120);
+    nvs_fake_fail_writes(true);
+    commit_timer_fire();
+    nvs_fake_fail_writes(false);
+    check("failed write keeps the key pending",
+          !nvs_fake_durable_u8("ae_tgt", &v), "failed write committed");
+    settings_flush();
+    check("next flush retries it",
+          nvs_fake_durable_u8("ae_tgt", &v) && v == 120, "not retried");
+  }
+  {
+    boot_fresh();
+    settings_set_brightness(80);
+    check("reset succeeds", settings_reset_all() == ESP_OK, "reset failed");
+    check("reset drops pending changes and restores defaults",
+          !commit_armed && settings_get_brightness() == 50,
+          "pending change survived reset");
+    reboot_after_power_cut();
+    check("reset is durable", settings_get_brightness() == 50,
+          "value back after reset");
+  }
+  {
+    boot_fresh();
+    settings_set_commit_timer(NULL);
+    settings_set_qr_fps(3);
+    check_count("without a commit timer each change commits at once",
+                nvs_fake_commits(), 1);
+    settings_set_commit_timer(&fake_commit_timer);
+  }
+  {
+    settings_deinit();
+    check("setters refuse before init",
+          settings_set_brightness(80) != ESP_OK &&
+              settings_get_brightness() == 50,
+          "setter applied without init");
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,296 @@
+/*
+ * Tests for the middle-ellipsis cut search (main/ui/text_fit_layout.c).
+ *
+ * LVGL's fonts are not available on the host, so each size in
+ * main/ui/font_policy.def gets a synthetic proportional font with kerning
+ * pairs (some strong enough to make a longer cut narrower than a shorter one).
+ * The reference is the previous ui_text_fit_middle(), which shrank the visible
+ * length one letter at a time and re-measured both parts on every step; both
+ * must pick the same cut for every string and width.
+ *
+ * Usage: test_text_fit [--bench]
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ui/text_fit_layout.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS()                                                                 \
+  do {                                                                         \
+    printf("PASS\n");                                                          \
+    tests_passed++;                                                            \
+  } while (0)
+#define FAIL(msg)                                                              \
+  do {                                                                         \
+    printf("FAIL: %s\n", msg);                                                 \
+    tests_failed++;                                                            \
+  } while (0)
+
+/* --- Synthetic fonts ------------------------------------------------------ */
+
+typedef struct {
+  int32_t px;
+  unsigned long calls;
+} fake_font_t;
+
+/* Advance in 1/16 em, roughly Montserrat's proportions. */
+static int32_t em16(uint32_t c) {
+  if (c >= '0' && c <= '9')
+    return c == '1' ? 6 : 10;
+  if (c == 'i' || c == 'j' || c == 'l')
+    return 4;
+  if (c == 'm' || c == 'w')
+    return 14;
+  if (c == 'M' || c == 'W')
+    return 16;
+  if (c >= 'a' && c <= 'z')
+    return 9;
+  if (c >= 'A' && c <= 'Z')
+    return 11;
+  if (c == '.' || c == ':')
+    return 4;
+  return 8;
+}
+
+/* Kerning in 1/16 em. */
+static int32_t kern16(uint32_t c, uint32_t next) {
+  if ((c == 'A' && next == 'V') || (c == 'V' && next == 'A'))
+    return -3;
+  if (c == 'T' && next >= 'a' && next <= 'z')
+    return -2;
+  if (c == 'r' && next == '.')
+    return -2;
+  if (c == '.' && next == '.')
+    return -1;
+  if (c == 'L' && next == 'T')
+    return -4;
+  if (c == 'f' && next == 'f')
+    return -1;
+  return 0;
+}
+
+static int32_t fake_advance(void *ctx, uint32_t letter, uint32_t next) {
+  fake_font_t *f = ctx;
+  f->calls++;
+  int32_t w = ((em16(letter) + (next ? kern16(letter, next) : 0)) * f->px +
+               8) / 16;
+  return w > 0 ? w : 0;
+}
+
+/* --- Reference: the previous fitting loop -------------------------------- */
+
+#define PART_LEN (TEXT_FIT_LAYOUT_MAX_PART + 1)
+
+typedef struct {
+  char prefix[PART_LEN];
+  char suffix[PART_LEN];
+} fit_t;
+
+/* lv_text_get_width() for a single line with no letter spacing. */
+static int32_t ref_width(const char *text, fake_font_t *font) {
+  int32_t w = 0;
+  for (size_t i = 0; text[i]; i++)
+    w += fake_advance(font, (unsigned char)text[i],
+                      (unsigned char)text[i + 1]);
+  return w;
+}
+
+static fit_t ref_fit_middle(const char *text, fake_font_t *font,
+                            int32_t max_width) {
+  fit_t fit = {0};
+  size_t len = strlen(text);
+  int32_t ellipsis_w = ref_width("...", font);
+
+  snprintf(fit.prefix, sizeof(fit.prefix), "%s", text);
+  if (ref_width(fit.prefix, font) <= max_width)
+    return fit;
+  if (ellipsis_w > max_width)
+    return (fit_t){0};
+
+  for (size_t visible = len - 1; visible > 1; visible--) {
+    size_t prefix = visible * 55 / 100;
+    size_t suffix = visible - prefix;
+    snprintf(fit.prefix, sizeof(fit.prefix), "%.*s", (int)prefix, text);
+    snprintf(fit.suffix, sizeof(fit.suffix), "%s", text + len - suffix);
+    if (ref_width(fit.prefix, font) + ellipsis_w +
+            ref_width(fit.suffix, font) <=
+        max_width)
+      return fit;
+  }
+
+  return (fit_t){0};
+}
+
+/* How ui_text_fit_middle() turns a cut into its result. */
+static fit_t new_fit_middle(const char *text, fake_font_t *font,
+                            int32_t max_width) {
+  fit_t fit = {0};
+  text_fit_cut_t cut;
+  if (!text_fit_layout_cut(text, fake_advance, font, max_width, &cut))
+    return fit;
+  memcpy(fit.prefix, text, cut.prefix_len);
+  memcpy(fit.suffix, text + strlen(text) - cut.suffix_len, cut.suffix_len);
+  return fit;
+}
+
+/* --- Harness -------------------------------------------------------------- */
+
+static const char *const SAMPLES[] = {
+    "",
+    "a",
+    "ab",
+    "abc",
+    "bc1qcr8te4kr609gcawutmrza0j4xv80jy8z306fyu",
+    "tb1q6rz28mcfaxtmd6v789l9rrlrusdprr9pqcpvkl",
+    "bc1p5cyxnuxmeuwuvkwfem96lqzszd02n6xdcjrs20cac6yqjjwudpxqkedrcr",
+    "1BvBMSEYstWetqTFn5Au4m4GFg7xJaNVN2",
+    "3J98t1WpEZ73CNmQviecrnyiWrnqRhWNLy",
+    "mipcBbFg9gMiCh81Kj8tqqdgoZub1ZJRfn",
+    "xpub6CatWdiZiodmUeTDp8LT5or8nmbKNcuyvz7WyksVFkKB4RHwCD3XyuvPEbvqAQY3rAP"
+    "shWcMLoP2fMFMKHPJ4ZeZXYVUhLv1VMrjPC7PW6V",
+    "tpubDC8msFGeGuwnKG9Upg7DM2b4DaRqg3CUZa5g8v2SRQ6K4NSkxUgd7HsL2XVWbVm39yB"
+    "A4LAxysQAm397zwQSQoQgewGiYZqrA9DsP4zbQ1M",
+    "AVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAVAV",
+    "LTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLTLT",
+    "Tr...Tr...Tr...Tr...Tr...Tr...",
+    "wsh(sortedmulti(2,[73c5da0a/48'/0'/0'/2']xpub/0/*,[f00dbabe/48h/0h/0h/2h]"
+    "xpub/1/*))",
+};
+
+static const int32_t FONT_SIZES[] = {
+#define UI_FONT_POLICY_ENTRY(max_diagonal_px, small_font_px, medium_font_px)   \
+  small_font_px, medium_font_px,
+#include "ui/font_policy.def"
+#undef UI_FONT_POLICY_ENTRY
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static void check_font(int32_t px) {
+  fake_font_t font = {.px = px};
+  char name[64];
+  snprintf(name, sizeof(name), "%d px font matches the previous fit", (int)px);
+  TEST(name);
+
+  unsigned long cases = 0;
+  for (size_t i = 0; i < COUNT(SAMPLES); i++) {
+    const char *text = SAMPLES[i];
+    int32_t full = ref_width(text, &font);
+    for (int32_t w = -1; w <= full + 2; w++) {
+      fit_t want = ref_fit_middle(text, &font, w);
+      fit_t got = new_fit_middle(text, &font, w);
+      cases++;
+      if (strcmp(want.prefix, got.prefix) != 0 ||
+          strcmp(want.suffix, got.suffix) != 0) {
+        char msg[1024];
+        snprintf(msg, sizeof(msg),
+                 "\"%s\" at %d px: want \"%s\"...\"%s\", got \"%s\"...\"%s\"",
+                 text, (int)w, want.prefix, want.suffix, got.prefix,
+                 got.suffix);
+        FAIL(msg);
+        return;
+      }
+    }
+  }
+  printf("[%lu widths] ", cases);
+  PASS();
+}
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench(const char *label, const char *text, int32_t px,
+                  int32_t max_width) {
+  const int iterations = 2000;
+  fake_font_t ref_font = {.px = px}, new_font = {.px = px};
+  volatile size_t sink = 0;
+
+  double t0 = now_us();
+  for (int i = 0; i < iterations; i++)
+    sink += strlen(ref_fit_middle(text, &ref_font, max_width).prefix);
+  double t1 = now_us();
+  for (int i = 0; i < iterations; i++)
+    sink += strlen(new_fit_middle(text, &new_font, max_width).prefix);
+  double t2 = now_us();
+  (void)sink;
+
+  printf("%-22s previous %7.2f us %6lu advances   now %6.2f us %4lu "
+         "advances\n",
+         label, (t1 - t0) / iterations, ref_font.calls / iterations,
+         (t2 - t1) / iterations, new_font.calls / iterations);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    bench("p2wpkh, half width", SAMPLES[4], 22,
+          ref_width(SAMPLES[4], &(fake_font_t){.px = 22}) / 2);
+    bench("p2tr, 60% width", SAMPLES[6], 22,
+          ref_width(SAMPLES[6], &(fake_font_t){.px = 22}) * 3 / 5);
+    bench("xpub, 40% width", SAMPLES[10], 16,
+          ref_width(SAMPLES[10], &(fake_font_t){.px = 16}) * 2 / 5);
+    return 0;
+  }
+
+  printf("=== text_fit tests ===\n");
+
+  printf("\n--- Group 1: same cuts as the previous fit, per policy font ---\n");
+  for (size_t i = 0; i < COUNT(FONT_SIZES); i++) {
+    bool seen = false;
+    for (size_t j = 0; j < i && !seen; j++)
+      seen = FONT_SIZES[j] == FONT_SIZES[i];
+    if (!seen)
+      check_font(FONT_SIZES[i]);
+  }
+
+  printf("\n--- Group 2: cut shape ---\n");
+  {
+    fake_font_t font = {.px = 22};
+    const char *addr = SAMPLES[4];
+    text_fit_cut_t cut;
+
+    TEST("whole text when it fits");
+    if (text_fit_layout_cut(addr, fake_advance, &font, ref_width(addr, &font),
+                            &cut) &&
+        cut.prefix_len == strlen(addr) && cut.suffix_len == 0)
+      PASS();
+    else
+      FAIL("wrong cut for a fitting string");
+
+    TEST("nothing when even the ellipsis does not fit");
+    if (!text_fit_layout_cut(addr, fake_advance, &font, 5, &cut))
+      PASS();
+    else
+      FAIL("returned a cut narrower than the ellipsis");
+
+    TEST("prefix keeps 55% of the visible letters");
+    if (text_fit_layout_cut(addr, fake_advance, &font,
+                            ref_width(addr, &font) / 2, &cut) &&
+        cut.prefix_len == (cut.prefix_len + cut.suffix_len) * 55 / 100)
+      PASS();
+    else
+      FAIL("unbalanced cut");
+
+    TEST("advances measured once per letter");
+    font.calls = 0;
+    text_fit_layout_cut(SAMPLES[10], fake_advance, &font, 100, &cut);
+    if (font.calls <= 3 * strlen(SAMPLES[10]) + 2)
+      PASS();
+    else
+      FAIL("advance callback called per cut");
+  }
+
+  printf("\n=== Results: %d passed, %d failed ===\n", tests_passed,
+         tests_failed);
+  return tests_failed > 0 ? 1 : 0;
+}
@@ -1,5 +1,6 @@
 #include "wallet.h"
 #include "key.h"
+#include "miniscript_policy.h"
 #include "registry.h"
 #include <wally_descriptor.h>
 
@@ -24,6 +25,7 @@ wallet_network_t wallet_get_network(void) { return wallet_network; }
 void wallet_cleanup(void) {
   wallet_initialized = false;
   registry_clear();
+  miniscript_policy_view_cache_clear();
 }
 
 void wallet_unload(void) {
@@ -41,6 +43,7 @@ bool wallet_is_watch_only(void) { return wallet_watch_only; }
 void wallet_clear_watch_only(void) {
   wallet_watch_only = false;
   registry_clear();
+  miniscript_policy_view_cache_clear();
 }
 
 int wallet_descriptor_parse(const char *descriptor,
@@ -6,8 +6,12 @@
 #include "pages/session_lock.h"
 #include "ui/assets/kern_logo_lvgl.h"
 #include "ui/entropy_input.h"
+#include "ui/flush_benchmark.h"
+#include "ui/perf_overlay.h"
+#include "ui/settings_commit.h"
 #include "ui/theme_widgets.h"
 #include "utils/bip39_filter.h"
+#include "utils/perf.h"
 #include "video.h"
 #include <bsp/display.h>
 #include <bsp/esp-bsp.h>
@@ -15,6 +19,8 @@
 #include <esp_check.h>
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_pm.h>
+#include <esp_system.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <lvgl.h>
@@ -23,10 +29,32 @@
 
 static const char *TAG = "KERN_MAIN";
 
+// Runs from esp_restart(): settings changed in the last couple of seconds are
+// still only in RAM.
+static void flush_settings_on_restart(void) { settings_flush(); }
+
 void app_main(void) {
   // Seed before anything can ask for randomness
   entropy_pool_init();
 
+#if CONFIG_KERN_PERF_TELEMETRY
+  perf_init();
+#endif
+
+#if CONFIG_PM_ENABLE
+  // Clock scaling only: the power governor (utils/power_gov.h) holds the max
+  // frequency locks whenever there is work or input. No light sleep, since
+  // DPI panels refresh from PSRAM continuously.
+  esp_pm_config_t pm_config = {
+      .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+      .min_freq_mhz = CONFIG_XTAL_FREQ,
+      .light_sleep_enable = false,
+  };
+  esp_err_t pm_ret = esp_pm_configure(&pm_config);
+  if (pm_ret != ESP_OK)
+    ESP_LOGW(TAG, "Clock scaling unavailable: %s", esp_err_to_name(pm_ret));
+#endif
+
   // Air-gap: hold the Wi-Fi/BT co-processor (ESP32-C6) in reset first.
   ESP_ERROR_CHECK(bsp_wifi_coproc_disable());
 
@@ -40,6 +68,8 @@ void app_main(void) {
   if (settings_ret != ESP_OK)
     ESP_LOGE(TAG, "Settings init failed, using defaults: %s",
              esp_err_to_name(settings_ret));
+  if (esp_register_shutdown_handler(flush_settings_on_restart) != ESP_OK)
+    ESP_LOGW(TAG, "Settings will not be flushed on restart");
 
   bsp_display_start();
   ESP_LOGI(TAG, "Display initialized successfully");
@@ -85,6 +115,14 @@ void app_main(void) {
   // Now turn on backlight
   bsp_display_brightness_set(settings_get_brightness());
 
+#if CONFIG_BSP_DISPLAY_FLUSH_BENCHMARK
+  lv_obj_t *bench = flush_benchmark_run(screen);
+  bsp_display_unlock();
+  vTaskDelay(pdMS_TO_TICKS(FLUSH_BENCHMARK_RESULT_MS));
+  bsp_display_lock(0);
+  lv_obj_delete(bench);
+#endif
+
   // Show animated logo splash screen
   kern_logo_animated(screen);
 
@@ -112,9 +150,16 @@ void app_main(void) {
   // Lock display again for modifications
   bsp_display_lock(0);
 
+  // Debounced settings commits run on the LVGL task from here on
+  ui_settings_commit_init();
+
   // Start inactivity monitoring (screensaver + session lock)
   session_lock_init();
 
+#if CONFIG_KERN_PERF_TELEMETRY
+  perf_overlay_create();
+#endif
+
   // Clear the screen
   lv_obj_clean(screen);
 
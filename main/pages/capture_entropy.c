@@ -17,8 +17,10 @@
 #include "../ui/dialog.h"
 #include "../ui/input_helpers.h"
 #include "../ui/theme_widgets.h"
+#include "../ui/video_view.h"
 #include "../utils/estimated_entropy.h"
 #include "../utils/memory_utils.h"
+#include "../utils/power_gov.h"
 #include "../utils/secure_mem.h"
 
 static const char *TAG = "capture_entropy";
@@ -65,6 +67,8 @@ static uint8_t *current_display_buffer = NULL;
 static size_t display_buffer_size = 0;
 
 static ppa_client_handle_t cam_ppa_client = NULL;
+// POWER_ACT_SCANNING held from stream start to teardown.
+static bool holds_scanning = false;
 
 static volatile bool closing = false;
 static volatile bool is_initialized = false;
@@ -240,11 +244,16 @@ static void camera_frame_cb(uint8_t *camera_buf, uint8_t camera_buf_index,
     }
   }
 
+  // On the video layer the PPA has already put the frame on screen; LVGL only
+  // draws the preview itself when the layer is missing or covered.
+  bool on_video_layer = !dialog_showing && video_view_present(back_buffer);
+
   if (!closing && !dialog_showing && bsp_display_lock(0)) {
     if (!closing && camera_img) {
       current_display_buffer = back_buffer;
       img_dsc.data = back_buffer;
-      lv_img_set_src(camera_img, &img_dsc);
+      if (!on_video_layer)
+        lv_img_set_src(camera_img, &img_dsc);
       // Live camera preview counts as activity: hold off screensaver/session
       // lock
       lv_display_trigger_activity(NULL);
@@ -293,6 +302,10 @@ static bool camera_init(void) {
 
   if (app_video_start(camera_frame_cb, 0) != ESP_OK)
     return false;
+  if (!holds_scanning) {
+    power_gov_acquire(POWER_ACT_SCANNING);
+    holds_scanning = true;
+  }
 
   // Apply the wider AE hysteresis + gain cap - without this, the sensor keeps
   // its init-time +/-8% window and uncapped gain ceiling, which causes
@@ -391,6 +404,9 @@ void capture_entropy_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
 
   ui_create_back_button(capture_screen, back_btn_cb);
 
+  // After the chrome, so whatever is drawn over the preview keeps its box.
+  video_view_attach(frame);
+
   if (!camera_init()) {
     ESP_LOGE(TAG, "Failed to initialize camera");
     return;
@@ -426,6 +442,10 @@ void capture_entropy_page_destroy(void) {
   }
 
   app_video_stop();
+  if (holds_scanning) {
+    power_gov_release(POWER_ACT_SCANNING);
+    holds_scanning = false;
+  }
 
   bool locked = bsp_display_lock(1000);
   camera_img = NULL;
@@ -27,6 +27,10 @@
 
 #define NUM_ADDRESSES 8
 #define ADDRESS_INDEX_FIT_ALLOWANCE 6
+#define ADDRESS_TEXT_LEN 128
+// Direct-mapped by index: holds the visible page plus its neighbours
+#define ADDRESS_CACHE_SLOTS (NUM_ADDRESSES * 4)
+#define ADDRESS_PREFETCH_PERIOD_MS 20
 
 static lv_obj_t *addresses_screen = NULL;
 static lv_obj_t *prev_button = NULL;
@@ -53,10 +57,33 @@ static bool active_descriptor_only = false;
 static bool show_change = false;
 static uint32_t address_offset = 0;
 
-static char stored_addresses[NUM_ADDRESSES][128];
+static char stored_addresses[NUM_ADDRESSES][ADDRESS_TEXT_LEN];
 static uint32_t stored_indices[NUM_ADDRESSES];
 static int stored_count = 0;
 
+// Row widgets are created once and re-bound on every page flip
+typedef struct {
+  lv_obj_t *button;
+  lv_obj_t *index_label;
+  lv_obj_t *address_row;
+} address_row_t;
+
+static address_row_t rows[NUM_ADDRESSES];
+
+// Derived addresses keyed by (source, account, chain, index). An entry with
+// an empty address records a derivation that failed, so it isn't retried.
+typedef struct {
+  bool valid;
+  uint16_t source;
+  uint32_t account;
+  uint32_t chain;
+  uint32_t index;
+  char address[ADDRESS_TEXT_LEN];
+} cached_address_t;
+
+static cached_address_t *address_cache = NULL;
+static lv_timer_t *prefetch_timer = NULL;
+
 static void refresh_address_list(void);
 static void scan_button_cb(lv_event_t *e);
 static void return_from_scan_cb(void);
@@ -250,11 +277,161 @@ static void address_button_cb(lv_event_t *e) {
   show_address_detail(index);
 }
 
+/* Registry entry behind the current source, or NULL for single-sig. Returns
+ * false when the source names a registry slot that no longer exists. */
+static bool current_registry_entry(const registry_entry_t **out) {
+  *out = NULL;
+  if (active_descriptor_only)
+    *out = registry_get((size_t)current_source.source);
+  else if (current_source.source >= 4)
+    *out = registry_get((size_t)(current_source.source - 4));
+  else
+    return true;
+  return *out != NULL;
+}
+
+static bool derive_address(uint32_t chain, uint32_t idx, char *out,
+                           size_t out_len) {
+  const registry_entry_t *reg_entry;
+  if (!current_registry_entry(&reg_entry))
+    return false;
+
+  if (reg_entry) {
+    char *dynamic_addr = NULL;
+    uint32_t mp = (reg_entry->num_paths <= 1) ? 0 : chain;
+    int ret = wally_descriptor_to_address(reg_entry->desc, 0, mp, idx, 0,
+                                          &dynamic_addr);
+    bool success = (ret == WALLY_OK) && dynamic_addr;
+    if (success)
+      snprintf(out, out_len, "%s", dynamic_addr);
+    if (dynamic_addr)
+      wally_free_string(dynamic_addr);
+    return success;
+  }
+
+  bool is_testnet = (wallet_get_network() == WALLET_NETWORK_TESTNET);
+  ss_script_type_t script =
+      wallet_source_picker_script_type(current_source.source);
+  char addr_buf[SS_ADDRESS_MAX_LEN];
+  if (!ss_address(script, current_source.account, chain, idx, is_testnet,
+                  addr_buf, sizeof(addr_buf)))
+    return false;
+  snprintf(out, out_len, "%s", addr_buf);
+  return true;
+}
+
+static cached_address_t *cache_slot(uint32_t idx) {
+  if (!address_cache)
+    return NULL;
+  return &address_cache[idx % ADDRESS_CACHE_SLOTS];
+}
+
+static bool cache_holds(const cached_address_t *slot, uint32_t chain,
+                        uint32_t idx) {
+  return slot && slot->valid && slot->source == current_source.source &&
+         slot->account == current_source.account && slot->chain == chain &&
+         slot->index == idx;
+}
+
+/* Derives into the cache slot for (chain, idx), replacing whatever it held. */
+static void cache_fill(cached_address_t *slot, uint32_t chain, uint32_t idx) {
+  slot->valid = true;
+  slot->source = current_source.source;
+  slot->account = current_source.account;
+  slot->chain = chain;
+  slot->index = idx;
+  if (!derive_address(chain, idx, slot->address, sizeof(slot->address)))
+    slot->address[0] = '\0';
+}
+
+static bool get_address(uint32_t chain, uint32_t idx, char *out,
+                        size_t out_len) {
+  cached_address_t *slot = cache_slot(idx);
+  if (!slot)
+    return derive_address(chain, idx, out, out_len);
+
+  if (!cache_holds(slot, chain, idx))
+    cache_fill(slot, chain, idx);
+  if (slot->address[0] == '\0')
+    return false;
+  snprintf(out, out_len, "%s", slot->address);
+  return true;
+}
+
+/* Derives one missing address of the next page, then of the previous one, per
+ * tick, so the UI stays responsive and a page flip finds its rows cached. */
+static void prefetch_timer_cb(lv_timer_t *timer) {
+  uint32_t chain = show_change ? 1 : 0;
+  const registry_entry_t *reg_entry;
+  if (!current_registry_entry(&reg_entry)) {
+    lv_timer_pause(timer);
+    return;
+  }
+
+  for (uint32_t i = 0; i < 2 * NUM_ADDRESSES; i++) {
+    uint32_t idx;
+    if (i < NUM_ADDRESSES) {
+      idx = address_offset + NUM_ADDRESSES + i;
+    } else {
+      if (address_offset < NUM_ADDRESSES)
+        break;
+      idx = address_offset - NUM_ADDRESSES + (i - NUM_ADDRESSES);
+    }
+
+    cached_address_t *slot = cache_slot(idx);
+    if (!slot)
+      break;
+    if (cache_holds(slot, chain, idx))
+      continue;
+    cache_fill(slot, chain, idx);
+    return;
+  }
+
+  lv_timer_pause(timer);
+}
+
+static void schedule_prefetch(void) {
+  if (!address_cache)
+    return;
+  if (!prefetch_timer) {
+    prefetch_timer =
+        lv_timer_create(prefetch_timer_cb, ADDRESS_PREFETCH_PERIOD_MS, NULL);
+    return;
+  }
+  lv_timer_resume(prefetch_timer);
+}
+
+static void create_address_rows(void) {
+  const lv_font_t *font = theme_font_small();
+  ui_text_fit_t empty = {0};
+
+  for (int i = 0; i < NUM_ADDRESSES; i++) {
+    lv_obj_t *btn = lv_btn_create(address_list_container);
+    lv_obj_set_size(btn, LV_PCT(100), LV_SIZE_CONTENT);
+    theme_apply_touch_button(btn, false);
+    lv_obj_set_flex_grow(btn, 1);
+    lv_obj_set_flex_flow(btn, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(btn, LV_FLEX_ALIGN_SPACE_BETWEEN,
+                          LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+    lv_obj_set_style_pad_column(btn, theme_small_padding(), 0);
+    lv_obj_add_flag(btn, LV_OBJ_FLAG_HIDDEN);
+
+    rows[i].button = btn;
+    rows[i].index_label =
+        create_address_label(btn, "", font, LV_TEXT_ALIGN_RIGHT);
+    rows[i].address_row =
+        ui_text_fit_row_create(btn, &empty, font, 1, primary_color());
+    lv_obj_set_flex_grow(rows[i].address_row, 1);
+
+    lv_obj_add_event_cb(btn, address_button_cb, LV_EVENT_CLICKED,
+                        (void *)(intptr_t)i);
+  }
+}
+
 static void refresh_address_list(void) {
   if (!address_list_container)
     return;
 
-  lv_obj_clean(address_list_container);
   stored_count = 0;
 
   if (address_offset == 0)
@@ -262,93 +439,49 @@ static void refresh_address_list(void) {
   else
     lv_obj_clear_state(prev_button, LV_STATE_DISABLED);
 
-  bool is_testnet = (wallet_get_network() == WALLET_NETWORK_TESTNET);
   uint32_t chain = show_change ? 1 : 0;
 
-  const registry_entry_t *reg_entry = NULL;
-  if (active_descriptor_only) {
-    reg_entry = registry_get((size_t)current_source.source);
-    if (!reg_entry)
-      return;
-  } else if (current_source.source >= 4) {
-    reg_entry = registry_get((size_t)(current_source.source - 4));
-    if (!reg_entry)
-      return;
-  }
+  /* Row geometry only depends on the page's widest index, so it is measured
+     once per page. Cropping by rendered width keeps proportional-font rows
+     visually aligned. */
+  const lv_font_t *font = theme_font_small();
+  char max_index_text[16];
+  snprintf(max_index_text, sizeof(max_index_text),
+           "%u:", address_offset + NUM_ADDRESSES - 1);
+  int32_t index_w =
+      ui_text_width_px(max_index_text, font) + ADDRESS_INDEX_FIT_ALLOWANCE;
+  int32_t usable_w = theme_screen_width() - 2 * theme_default_padding() - 30;
+  int32_t address_w = usable_w - index_w - theme_small_padding();
+  if (address_w < 1)
+    address_w = 1;
 
   for (uint32_t i = 0; i < NUM_ADDRESSES; i++) {
     uint32_t idx = address_offset + i;
-    char addr_buf[SS_ADDRESS_MAX_LEN];
-    char *dynamic_addr = NULL;
-    bool success = false;
-
-    if (reg_entry) {
-      uint32_t mp = (reg_entry->num_paths <= 1) ? 0 : chain;
-      int ret = wally_descriptor_to_address(reg_entry->desc, 0, mp, idx, 0,
-                                            &dynamic_addr);
-      success = (ret == WALLY_OK) && dynamic_addr;
-    } else {
-      ss_script_type_t script =
-          wallet_source_picker_script_type(current_source.source);
-      success = ss_address(script, current_source.account, chain, idx,
-                           is_testnet, addr_buf, sizeof(addr_buf));
-    }
+    int si = stored_count;
 
-    if (!success)
+    if (!get_address(chain, idx, stored_addresses[si],
+                     sizeof(stored_addresses[si])))
       continue;
-
-    /* Store address for detail view */
-    int si = stored_count;
-    snprintf(stored_addresses[si], sizeof(stored_addresses[si]), "%s",
-             dynamic_addr ? dynamic_addr : addr_buf);
     stored_indices[si] = idx;
     stored_count++;
 
-    if (dynamic_addr) {
-      wally_free_string(dynamic_addr);
-      dynamic_addr = NULL;
-    }
-
-    /* Build truncated display label from the stored copy. Cropping by rendered
-       width keeps proportional-font rows visually aligned. */
-    const lv_font_t *font = theme_font_small();
-    char max_index_text[16];
-    snprintf(max_index_text, sizeof(max_index_text),
-             "%u:", address_offset + NUM_ADDRESSES - 1);
-    int32_t index_w =
-        ui_text_width_px(max_index_text, font) + ADDRESS_INDEX_FIT_ALLOWANCE;
-    int32_t usable_w = theme_screen_width() - 2 * theme_default_padding() - 30;
-    int32_t address_w = usable_w - index_w - theme_small_padding();
-    if (address_w < 1)
-      address_w = 1;
-
     char index_text[16];
     snprintf(index_text, sizeof(index_text), "%u:", idx);
-
     ui_text_fit_t address_display =
         ui_text_fit_middle(stored_addresses[si], font, address_w);
 
-    /* Create clickable button */
-    lv_obj_t *btn = lv_btn_create(address_list_container);
-    lv_obj_set_size(btn, LV_PCT(100), LV_SIZE_CONTENT);
-    theme_apply_touch_button(btn, false);
-    lv_obj_set_flex_grow(btn, 1);
-    lv_obj_set_flex_flow(btn, LV_FLEX_FLOW_ROW);
-    lv_obj_set_flex_align(btn, LV_FLEX_ALIGN_SPACE_BETWEEN,
-                          LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
-    lv_obj_set_style_pad_column(btn, theme_small_padding(), 0);
-
-    lv_obj_t *index_label =
-        create_address_label(btn, index_text, font, LV_TEXT_ALIGN_RIGHT);
-    lv_obj_set_width(index_label, index_w);
+    address_row_t *row = &rows[si];
+    lv_label_set_text(row->index_label, index_text);
+    lv_obj_set_width(row->index_label, index_w);
+    lv_obj_set_width(row->address_row, address_w);
+    ui_text_fit_row_set(row->address_row, &address_display);
+    lv_obj_clear_flag(row->button, LV_OBJ_FLAG_HIDDEN);
+  }
 
-    lv_obj_t *address_row = ui_text_fit_row_create(btn, &address_display, font,
-                                                   address_w, primary_color());
-    lv_obj_set_flex_grow(address_row, 1);
+  for (int i = stored_count; i < NUM_ADDRESSES; i++)
+    lv_obj_add_flag(rows[i].button, LV_OBJ_FLAG_HIDDEN);
 
-    lv_obj_add_event_cb(btn, address_button_cb, LV_EVENT_CLICKED,
-                        (void *)(intptr_t)si);
-  }
+  schedule_prefetch();
 }
 
 static lv_obj_t *create_nav_button(lv_obj_t *parent, const char *text,
@@ -481,6 +614,8 @@ void addresses_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
   lv_obj_set_style_pad_row(address_list_container, theme_small_padding() / 2,
                            0);
 
+  address_cache = calloc(ADDRESS_CACHE_SLOTS, sizeof(cached_address_t));
+  create_address_rows();
   refresh_address_list();
 
   // Back button (on parent for absolute positioning)
@@ -513,6 +648,13 @@ void addresses_page_destroy(void) {
   wallet_source_picker_destroy(picker);
   picker = NULL;
 
+  if (prefetch_timer) {
+    lv_timer_delete(prefetch_timer);
+    prefetch_timer = NULL;
+  }
+  free(address_cache);
+  address_cache = NULL;
+
   if (detail_back_button) {
     lv_obj_del(detail_back_button);
     detail_back_button = NULL;
@@ -537,6 +679,7 @@ void addresses_page_destroy(void) {
   next_button = NULL;
   scan_button = NULL;
   address_list_container = NULL;
+  memset(rows, 0, sizeof(rows));
   return_callback = NULL;
   show_change = false;
   address_offset = 0;
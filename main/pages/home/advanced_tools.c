@@ -1,12 +1,23 @@
 #include "advanced_tools.h"
+#include "../../ui/dialog.h"
 #include "../../ui/menu.h"
 #include "../../ui/theme_widgets.h"
 #include "bip85.h"
 #include <lvgl.h>
+#include <sd_card.h>
+#include <stdio.h>
+
+/* Per bus mode, each way: long enough to get past FatFs and card caching,
+ * short enough that four modes finish in a few seconds. */
+#define SD_SPEED_TEST_BYTES (256 * 1024)
+/* Default and high speed, at the board's width and at 1 bit */
+#define SD_SPEED_TEST_MODES 4
 
 static ui_menu_t *advanced_tools_menu = NULL;
 static lv_obj_t *advanced_tools_screen = NULL;
 static void (*return_callback)(void) = NULL;
+static lv_obj_t *sd_test_progress = NULL;
+static lv_timer_t *sd_test_timer = NULL;
 
 static void return_from_bip85_cb(void) {
   bip85_page_destroy();
@@ -26,6 +37,50 @@ static void bip85_cb(void) {
   bip85_page_show();
 }
 
+static void deferred_sd_speed_test_cb(lv_timer_t *timer) {
+  (void)timer;
+  sd_test_timer = NULL;
+  sd_card_self_test_result_t results[SD_SPEED_TEST_MODES];
+  size_t count = 0;
+  esp_err_t ret = sd_card_init();
+  if (ret == ESP_OK)
+    ret = sd_card_self_test(SD_SPEED_TEST_BYTES, results, SD_SPEED_TEST_MODES,
+                            &count);
+
+  if (sd_test_progress) {
+    lv_obj_del(sd_test_progress);
+    sd_test_progress = NULL;
+  }
+
+  if (ret != ESP_OK || count == 0) {
+    dialog_show_error_timeout("SD card speed test failed", NULL, 0);
+    return;
+  }
+
+  char message[320];
+  size_t len = 0;
+  for (size_t i = 0; i < count && len < sizeof(message); i++) {
+    const sd_card_self_test_result_t *r = &results[i];
+    if (r->freq_khz)
+      len += snprintf(message + len, sizeof(message) - len,
+                      "%s%d-bit %lu MHz\n", i ? "\n" : "", r->bus_width,
+                      (unsigned long)(r->freq_khz / 1000));
+    if (len < sizeof(message))
+      len += snprintf(message + len, sizeof(message) - len,
+                      "write %.1f, read %.1f, read-ahead %.1f MB/s",
+                      r->write_mbps, r->read_mbps, r->read_ahead_mbps);
+  }
+  dialog_show_info("SD Card Speed", message, NULL, NULL, DIALOG_STYLE_OVERLAY);
+}
+
+static void sd_speed_test_cb(void) {
+  sd_test_progress = dialog_show_progress("SD Card", "Measuring speed...",
+                                          DIALOG_STYLE_OVERLAY);
+  /* Let the progress dialog render before the test blocks this task */
+  sd_test_timer = lv_timer_create(deferred_sd_speed_test_cb, 50, NULL);
+  lv_timer_set_repeat_count(sd_test_timer, 1);
+}
+
 static void back_cb(void) {
   void (*callback)(void) = return_callback;
   advanced_tools_page_hide();
@@ -50,6 +105,8 @@ void advanced_tools_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
   }
 
   ui_menu_add_entry(advanced_tools_menu, "Derive BIP85>BIP39", bip85_cb);
+  ui_menu_add_entry(advanced_tools_menu, "SD Card Speed Test",
+                    sd_speed_test_cb);
   ui_menu_show(advanced_tools_menu);
 }
 
@@ -68,6 +125,14 @@ void advanced_tools_page_hide(void) {
 }
 
 void advanced_tools_page_destroy(void) {
+  if (sd_test_timer) {
+    lv_timer_del(sd_test_timer);
+    sd_test_timer = NULL;
+  }
+  if (sd_test_progress) {
+    lv_obj_del(sd_test_progress);
+    sd_test_progress = NULL;
+  }
   if (advanced_tools_menu) {
     ui_menu_destroy(advanced_tools_menu);
     advanced_tools_menu = NULL;
@@ -77,8 +77,11 @@ static int shade_region_index = 0; /* doubles as the zoomed-region cursor */
 static int grid_divisions = 0;
 static qr_encode_result_t last_qr_result = {0, 0};
 
-/* Zoomed-view state: QR encoded once into zoom_qr_buf, regions drawn from it */
-static uint8_t *zoom_qr_buf = NULL;
+/* Every format's encode and drawing, wiped with the page */
+static qr_cache_t *qr_cache = NULL;
+
+/* Zoomed-view state: regions drawn from the cache's encode in zoom_qr_buf */
+static const uint8_t *zoom_qr_buf = NULL;
 static int zoom_modules = 0;
 static qr_type_t zoom_buf_type = (qr_type_t)-1;
 static lv_obj_t *zoom_col_strip = NULL;
@@ -492,8 +495,7 @@ static void encrypt_success_cb(const char *id, const uint8_t *envelope,
 
   current_qr_type = QR_TYPE_ENCRYPTED;
   lv_dropdown_set_selected(qr_type_dropdown, 3);
-  /* Same type but fresh data (new GCM IV): force the zoom cache to re-encode.
-   */
+  /* Same type but fresh data (new GCM IV): the zoom view must look it up. */
   zoom_buf_type = (qr_type_t)-1;
   shade_region_index = 0;
   update_qr_code();
@@ -528,28 +530,30 @@ static void destroy_zoom_overlays(void) {
   }
 }
 
-/* Encode the current QR into zoom_qr_buf, cached by type. Returns module count.
- */
+/* Point zoom_qr_buf at the current QR's modules in the cache, remembered by
+ * type until the next cache update. Returns module count. */
 static int ensure_zoom_encoded(void) {
-  if (!zoom_qr_buf)
+  if (!qr_cache)
     return 0;
   if (zoom_modules > 0 && zoom_buf_type == current_qr_type)
     return zoom_modules;
 
   int modules = 0;
+  zoom_qr_buf = NULL;
   if (current_qr_type == QR_TYPE_COMPACT_SEEDQR) {
     if (compact_seedqr_data && compact_seedqr_len > 0)
-      modules = qr_encode_binary(compact_seedqr_data, compact_seedqr_len,
-                                 zoom_qr_buf);
+      zoom_qr_buf = qr_cache_encode_binary(qr_cache, compact_seedqr_data,
+                                           compact_seedqr_len, &modules);
   } else if (current_qr_type == QR_TYPE_ENCRYPTED) {
     if (encrypted_qr_data)
-      modules = qr_encode_optimal(encrypted_qr_data, zoom_qr_buf);
+      zoom_qr_buf =
+          qr_cache_encode_optimal(qr_cache, encrypted_qr_data, &modules);
   } else {
     const char *data = (current_qr_type == QR_TYPE_PLAINTEXT) ? mnemonic_data
                        : (current_qr_type == QR_TYPE_SEEDQR)  ? seedqr_data
                                                               : NULL;
     if (data)
-      modules = qr_encode_optimal(data, zoom_qr_buf);
+      zoom_qr_buf = qr_cache_encode_optimal(qr_cache, data, &modules);
   }
 
   zoom_modules = modules;
@@ -789,18 +793,21 @@ static void update_qr_code(void) {
   destroy_zoom_overlays();
   if (current_qr_type == QR_TYPE_COMPACT_SEEDQR) {
     if (compact_seedqr_data && compact_seedqr_len > 0)
-      qr_update_binary(qr_code, compact_seedqr_data, compact_seedqr_len,
-                       &last_qr_result);
+      qr_cache_update_binary(qr_cache, qr_code, compact_seedqr_data,
+                             compact_seedqr_len, &last_qr_result);
   } else if (current_qr_type == QR_TYPE_ENCRYPTED) {
     if (encrypted_qr_data)
-      qr_update_optimal(qr_code, encrypted_qr_data, &last_qr_result);
+      qr_cache_update_optimal(qr_cache, qr_code, encrypted_qr_data,
+                              &last_qr_result);
   } else {
     const char *data = (current_qr_type == QR_TYPE_PLAINTEXT) ? mnemonic_data
                        : (current_qr_type == QR_TYPE_SEEDQR)  ? seedqr_data
                                                               : NULL;
     if (data)
-      qr_update_optimal(qr_code, data, &last_qr_result);
+      qr_cache_update_optimal(qr_cache, qr_code, data, &last_qr_result);
   }
+  /* The update may have reused the slot zoom_qr_buf points into */
+  zoom_buf_type = (qr_type_t)-1;
 
   reset_shade_mode();
   if (view_mode == VIEW_REGIONS)
@@ -849,7 +856,8 @@ void mnemonic_qr_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
   current_qr_type = QR_TYPE_PLAINTEXT;
   view_mode = VIEW_STANDARD;
   shade_region_index = 0;
-  zoom_qr_buf = malloc(QR_CODE_BUF_LEN);
+  qr_cache = qr_cache_create();
+  zoom_qr_buf = NULL;
   zoom_modules = 0;
   zoom_buf_type = (qr_type_t)-1;
 
@@ -955,11 +963,9 @@ void mnemonic_qr_page_destroy(void) {
   destroy_grid_overlay();
   destroy_zoom_overlays();
 
-  if (zoom_qr_buf) {
-    secure_memzero(zoom_qr_buf, QR_CODE_BUF_LEN);
-    free(zoom_qr_buf);
-    zoom_qr_buf = NULL;
-  }
+  qr_cache_destroy(qr_cache);
+  qr_cache = NULL;
+  zoom_qr_buf = NULL;
 
   if (mnemonic_data) {
     secure_memzero(mnemonic_data, strlen(mnemonic_data));
@@ -24,6 +24,7 @@ static lv_obj_t *xpub_parent = NULL;
 static lv_obj_t *picker_row = NULL;
 static lv_obj_t *policy_dropdown = NULL;
 static lv_obj_t *progress_dialog = NULL;
+static qr_cache_t *qr_cache = NULL;
 static wallet_source_picker_t *picker = NULL;
 static wallet_source_t current_source = {0, 0};
 
@@ -159,8 +160,11 @@ static void render_xpub(void) {
       theme_create_qr_container(qr_parent, square_size, theme_small_padding());
   lv_obj_update_layout(qr_container);
 
-  qr_create_optimal(qr_container, lv_obj_get_content_width(qr_container),
-                    key_origin);
+  // Picker and policy changes come back to keys already shown: those are drawn
+  // from the cache.
+  lv_obj_t *qr = qr_create_optimal(
+      qr_container, lv_obj_get_content_width(qr_container), NULL);
+  qr_cache_update_optimal(qr_cache, qr, key_origin, NULL);
   qr_viewer_attach_fullscreen(qr_container, key_origin, derivation_path);
 
   // With a custom path the picker row only shows a "Path" button, so surface
@@ -460,6 +464,7 @@ void public_key_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
   current_source = (wallet_source_t){0, 0};
   policy = POLICY_SINGLESIG;
   miniscript_path[0] = '\0';
+  qr_cache = qr_cache_create();
 
   bool landscape = theme_is_landscape();
   public_key_screen = create_public_key_screen(parent, landscape);
@@ -500,6 +505,8 @@ void public_key_page_destroy(void) {
   delete_obj(&back_button);
   delete_obj(&settings_button);
   delete_obj(&public_key_screen);
+  qr_cache_destroy(qr_cache);
+  qr_cache = NULL;
 
   qr_parent = NULL;
   xpub_parent = NULL;
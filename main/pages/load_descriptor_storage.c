@@ -4,12 +4,15 @@
 #include "../core/kef.h"
 #include "../core/storage.h"
 #include "../ui/dialog.h"
+#include "../utils/secure_mem.h"
 #include "sd_card.h"
 #include "shared/descriptor_loader.h"
+#include "shared/kef_batch_page.h"
 #include "shared/kef_decrypt_page.h"
 #include "shared/sd_file_browser.h"
 #include "shared/storage_browser.h"
 #include <lvgl.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -184,6 +187,165 @@ static bool filename_is_kef(const char *filename) {
          strcmp(filename + len - 4, STORAGE_DESCRIPTOR_EXT_KEF) == 0;
 }
 
+/* ---------- Unlock all (flash) ---------- */
+
+/* One key for every .kef descriptor: kef_batch_page derives the keys
+ * together, then the opened descriptors go through the usual "Load?" flow
+ * one after another. Each plaintext is wiped once it has been handed to the
+ * validator, and the rest on cancel or teardown. */
+static char **unlocked = NULL;
+static size_t *unlocked_lens = NULL;
+static size_t unlocked_count = 0;
+static size_t unlocked_next = 0;
+static size_t unlocked_loaded = 0;
+static lv_timer_t *unlock_timer = NULL;
+
+static void free_unlocked(void) {
+  for (size_t i = 0; unlocked && i < unlocked_count; i++)
+    SECURE_FREE_BUFFER(unlocked[i], unlocked_lens[i] + 1);
+  free(unlocked);
+  unlocked = NULL;
+  free(unlocked_lens);
+  unlocked_lens = NULL;
+  unlocked_count = 0;
+  unlocked_next = 0;
+  unlocked_loaded = 0;
+}
+
+static void load_next_unlocked(void);
+
+static void deferred_load_next_cb(lv_timer_t *timer) {
+  lv_timer_del(timer);
+  unlock_timer = NULL;
+  load_next_unlocked();
+}
+
+static void unlocked_validation_cb(descriptor_validation_result_t result,
+                                   void *user_data) {
+  (void)user_data;
+  if (result == VALIDATION_SUCCESS)
+    unlocked_loaded++;
+  else
+    descriptor_loader_show_error(result);
+
+  /* Let the validator finish with this descriptor before the next one */
+  unlock_timer = lv_timer_create(deferred_load_next_cb, 50, NULL);
+}
+
+static void load_next_unlocked(void) {
+  while (unlocked_next < unlocked_count && !unlocked[unlocked_next])
+    unlocked_next++;
+
+  if (unlocked_next < unlocked_count) {
+    size_t i = unlocked_next++;
+    descriptor_loader_process_string(unlocked[i], unlocked_validation_cb,
+                                     NULL);
+    SECURE_FREE_BUFFER(unlocked[i], unlocked_lens[i] + 1);
+    return;
+  }
+
+  size_t loaded = unlocked_loaded;
+  free_unlocked();
+  if (loaded == 0) {
+    browser_show();
+    return;
+  }
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%u descriptor%s loaded for this session",
+           (unsigned)loaded, loaded == 1 ? "" : "s");
+  dialog_show_info("Loaded", msg, success_callback_wrapper, NULL,
+                   DIALOG_STYLE_OVERLAY);
+}
+
+static void return_from_kef_batch(void) {
+  kef_batch_page_destroy();
+  free_unlocked();
+  browser_show();
+}
+
+static void result_from_kef_batch(size_t index, const uint8_t *data,
+                                  size_t len) {
+  if (index >= unlocked_count)
+    return;
+  char *descriptor_str = malloc(len + 1);
+  if (!descriptor_str)
+    return;
+  memcpy(descriptor_str, data, len);
+  descriptor_str[len] = '\0';
+  unlocked[index] = descriptor_str;
+  unlocked_lens[index] = len;
+}
+
+static void done_from_kef_batch(size_t count) {
+  (void)count;
+  kef_batch_page_destroy();
+  unlocked_next = 0;
+  unlocked_loaded = 0;
+  load_next_unlocked();
+}
+
+static void unlock_all(void) {
+  storage_location_t loc = storage_browser_get_location();
+  char **filenames = NULL;
+  int file_count = 0;
+  if (storage_list_descriptors(loc, &filenames, &file_count) != ESP_OK ||
+      file_count <= 0) {
+    storage_free_file_list(filenames, file_count);
+    dialog_show_error_timeout("Failed to list files", NULL, 0);
+    return;
+  }
+
+  uint8_t **envelopes = calloc((size_t)file_count, sizeof(*envelopes));
+  size_t *env_lens = calloc((size_t)file_count, sizeof(*env_lens));
+  size_t count = 0;
+  for (int i = 0; envelopes && env_lens && i < file_count; i++) {
+    if (!filename_is_kef(filenames[i]))
+      continue;
+    uint8_t *data = NULL;
+    size_t data_len = 0;
+    bool encrypted = false;
+    if (storage_load_descriptor(loc, filenames[i], &data, &data_len,
+                                &encrypted) != ESP_OK)
+      continue;
+    if (!encrypted || !kef_is_envelope(data, data_len)) {
+      free(data);
+      continue;
+    }
+    envelopes[count] = data;
+    env_lens[count++] = data_len;
+  }
+  storage_free_file_list(filenames, file_count);
+
+  free_unlocked();
+  if (count > 0) {
+    unlocked = calloc(count, sizeof(*unlocked));
+    unlocked_lens = calloc(count, sizeof(*unlocked_lens));
+    if (unlocked && unlocked_lens)
+      unlocked_count = count;
+    else
+      free_unlocked();
+  }
+
+  if (!envelopes || !env_lens || (count > 0 && !unlocked)) {
+    dialog_show_error_timeout("Out of memory", NULL, 0);
+  } else if (count == 0) {
+    dialog_show_error_timeout("No encrypted descriptors", NULL, 0);
+  } else {
+    browser_hide();
+    kef_batch_page_create(lv_screen_active(), return_from_kef_batch,
+                          result_from_kef_batch, done_from_kef_batch,
+                          (const uint8_t *const *)envelopes, env_lens, count);
+    kef_batch_page_show();
+  }
+
+  /* kef_batch_page copies them */
+  for (size_t i = 0; i < count; i++)
+    free(envelopes[i]);
+  free(envelopes);
+  free(env_lens);
+}
+
 static char *get_display_name(storage_location_t loc, const char *filename) {
   if (filename_is_kef(filename)) {
     uint8_t *data = NULL;
@@ -252,6 +414,7 @@ void load_descriptor_storage_page_create(lv_obj_t *parent,
       .delete_file = storage_delete_descriptor,
       .get_display_name = get_display_name,
       .load_selected = load_selected,
+      .unlock_all = unlock_all,
       .return_cb = return_cb,
   };
 
@@ -264,6 +427,12 @@ void load_descriptor_storage_page_hide(void) { browser_hide(); }
 
 void load_descriptor_storage_page_destroy(void) {
   kef_decrypt_page_destroy();
+  kef_batch_page_destroy();
+  if (unlock_timer) {
+    lv_timer_del(unlock_timer);
+    unlock_timer = NULL;
+  }
+  free_unlocked();
   if (active_browser == BROWSER_SD)
     sd_file_browser_destroy();
   else
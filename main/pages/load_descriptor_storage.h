@@ -3,6 +3,7 @@
  *
  * Lists stored descriptors from flash or SD card.
  * Select -> decrypt (if .kef) or load directly (if .txt) -> validate.
+ * On flash, "Unlock All" opens every .kef with one key, then validates each.
  * Inline delete via trash icon on each entry.
  */
 
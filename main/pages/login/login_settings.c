@@ -7,10 +7,10 @@
 #include "../../ui/input_helpers.h"
 #include "../../ui/menu.h"
 #include "../../ui/theme_widgets.h"
+#include "../../utils/power_gov.h"
 #include "../../utils/session.h"
 #include "../settings/firmware_update.h"
 #include "security_settings.h"
-#include <bsp/display.h>
 #include <lvgl.h>
 
 // -- Top-level settings menu --
@@ -36,7 +36,7 @@ static void destroy_screensaver_page(void);
 
 static void brightness_slider_cb(lv_event_t *e) {
   lv_obj_t *slider = lv_event_get_target(e);
-  bsp_display_brightness_set(lv_slider_get_value(slider));
+  power_gov_set_brightness((uint8_t)lv_slider_get_value(slider));
 }
 
 static void brightness_back_cb(lv_event_t *e) {
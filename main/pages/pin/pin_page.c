@@ -5,6 +5,7 @@
 // and symbols.
 
 #include "pin_page.h"
+#include "../../core/anti_phishing_table.h"
 #include "../../core/nvs_secure.h"
 #include "../../core/pin.h"
 #include "../../ui/dialog.h"
@@ -193,6 +194,7 @@ static void clear_state(void) {
 #endif
   secure_memzero(keystroke_cache, sizeof(keystroke_cache));
   keystroke_cache_len = 0;
+  ap_table_clear();
 }
 
 static void clear_buffers(void) {
@@ -536,18 +538,21 @@ static void pin_keystroke_cb(lv_event_t *e) {
     bool prefix_changed = keystroke_cache_len != (int)split_pos ||
                           memcmp(keystroke_cache, text, split_pos) != 0;
     if (prefix_changed) {
-      const char *word1 = NULL;
-      const char *word2 = NULL;
-      uint8_t identicon_data[3];
-      esp_err_t err = pin_compute_anti_phishing(text, split_pos, &word1, &word2,
-                                                identicon_data);
-      if (err == ESP_OK && word1 && word2) {
+      // Usually prepared on the previous keystroke; a miss (a letter, or a
+      // fast typist beating the worker) computes here as before.
+      ap_words_t ap = {0};
+      esp_err_t err = ESP_OK;
+      if (!ap_table_take(text, split_pos, &ap))
+        err = pin_compute_anti_phishing(text, split_pos, &ap.word1, &ap.word2,
+                                        ap.identicon);
+      if (err == ESP_OK && ap.word1 && ap.word2) {
         // One word per line: side by side overflows narrow displays
         char words_buf[64];
-        snprintf(words_buf, sizeof(words_buf), "%s\n%s", word1, word2);
+        snprintf(words_buf, sizeof(words_buf), "%s\n%s", ap.word1, ap.word2);
         lv_label_set_text(words_label, words_buf);
+        secure_memzero(words_buf, sizeof(words_buf));
         render_identicon_to(identicon_canvas, identicon_draw_buf,
-                            identicon_data);
+                            ap.identicon);
         lv_obj_clear_flag(words_container, LV_OBJ_FLAG_HIDDEN);
         lv_obj_clear_flag(words_warning, LV_OBJ_FLAG_HIDDEN);
         words_visible = true;
@@ -568,8 +573,16 @@ static void pin_keystroke_cb(lv_event_t *e) {
         keystroke_cache[split_pos] = '\0';
         keystroke_cache_len = (int)split_pos;
       }
+      secure_memzero(&ap, sizeof(ap));
     }
-  } else if (words_visible) {
+    return;
+  }
+
+  if (len + 1 == split_pos)
+    ap_table_prepare(text, len);
+  else
+    ap_table_clear();
+  if (words_visible) {
     lv_obj_add_flag(words_container, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(words_warning, LV_OBJ_FLAG_HIDDEN);
     words_visible = false;
@@ -640,6 +653,9 @@ static void build_unlock_entry_state(void) {
     split_pos = pin_get_split_position();
     lv_obj_add_event_cb(text_input.keyboard, pin_keystroke_cb,
                         LV_EVENT_VALUE_CHANGED, NULL);
+    // A split after the first character is one keystroke away already
+    if (split_pos == 1)
+      ap_table_prepare("", 0);
   }
 }
 
@@ -24,6 +24,8 @@
 #include "../../ui/menu.h"
 #include "../../ui/sankey.h"
 #include "../../ui/theme_widgets.h"
+#include "../../utils/arena.h"
+#include "../../utils/power_gov.h"
 #include "../../utils/secure_mem.h"
 #include "../load_descriptor_storage.h"
 #include "../shared/address_checker.h"
@@ -1097,6 +1099,19 @@ static bool check_psbt_mismatch(void) {
   return true;
 }
 
+/* Moves a decoded address into the display arena, releasing the original
+ * with the allocator that made it. */
+static char *address_to_arena(arena_t *arena, char *address) {
+  if (!address)
+    return NULL;
+  char *copy = arena_strdup(arena, address);
+  if (strcmp(address, "OP_RETURN") == 0)
+    free(address);
+  else
+    wally_free_string(address);
+  return copy;
+}
+
 static bool create_psbt_info_display(void) {
   if (!scan_screen || !current_psbt || !wallet_is_initialized()) {
     return false;
@@ -1118,20 +1133,18 @@ static bool create_psbt_info_display(void) {
     return false;
   }
 
-  uint64_t *input_amounts = malloc(num_inputs * sizeof(uint64_t));
-  if (!input_amounts) {
-    return false;
-  }
-  lv_color_t *input_colors = malloc(num_inputs * sizeof(lv_color_t));
-  if (!input_colors) {
-    free(input_amounts);
-    return false;
-  }
+  /* Everything built for the display (amounts, colors, classifications,
+   * addresses) lives in one arena, wiped and released in one go. */
+  arena_t arena;
+  arena_init(&arena, 0, ARENA_MEM_PSRAM);
+
+  uint64_t *input_amounts = arena_alloc(&arena, num_inputs * sizeof(uint64_t));
+  lv_color_t *input_colors =
+      arena_alloc(&arena, num_inputs * sizeof(lv_color_t));
   classified_input_t *classified_inputs =
-      calloc(num_inputs, sizeof(classified_input_t));
-  if (!classified_inputs) {
-    free(input_colors);
-    free(input_amounts);
+      arena_calloc(&arena, num_inputs, sizeof(classified_input_t));
+  if (!input_amounts || !input_colors || !classified_inputs) {
+    arena_destroy(&arena);
     return false;
   }
   psbt_amount_audit_t amount_audit;
@@ -1167,8 +1180,8 @@ static bool create_psbt_info_display(void) {
       unsigned char spk[34];
       size_t spk_len = 0;
       if (psbt_input_utxo_script(current_psbt, i, spk, sizeof(spk), &spk_len)) {
-        classified_inputs[i].address =
-            psbt_scriptpubkey_to_address(spk, spk_len, is_testnet);
+        classified_inputs[i].address = address_to_arena(
+            &arena, psbt_scriptpubkey_to_address(spk, spk_len, is_testnet));
       }
     }
   }
@@ -1176,22 +1189,14 @@ static bool create_psbt_info_display(void) {
   struct wally_tx *global_tx = NULL;
   int tx_ret = wally_psbt_get_global_tx_alloc(current_psbt, &global_tx);
   if (tx_ret != WALLY_OK || !global_tx) {
-    for (size_t i = 0; i < num_inputs; i++)
-      free(classified_inputs[i].address);
-    free(classified_inputs);
-    free(input_colors);
-    free(input_amounts);
+    arena_destroy(&arena);
     return false;
   }
 
   classified_output_t *classified_outputs =
-      calloc(num_outputs, sizeof(classified_output_t));
+      arena_calloc(&arena, num_outputs, sizeof(classified_output_t));
   if (!classified_outputs) {
-    for (size_t i = 0; i < num_inputs; i++)
-      free(classified_inputs[i].address);
-    free(classified_inputs);
-    free(input_colors);
-    free(input_amounts);
+    arena_destroy(&arena);
     wally_tx_free(global_tx);
     return false;
   }
@@ -1205,17 +1210,12 @@ static bool create_psbt_info_display(void) {
                      : 0;
 
   size_t diagram_output_count = num_outputs + (fee > 0 ? 1 : 0);
-  uint64_t *output_amounts = malloc(diagram_output_count * sizeof(uint64_t));
-  lv_color_t *output_colors = malloc(diagram_output_count * sizeof(lv_color_t));
+  uint64_t *output_amounts =
+      arena_alloc(&arena, diagram_output_count * sizeof(uint64_t));
+  lv_color_t *output_colors =
+      arena_alloc(&arena, diagram_output_count * sizeof(lv_color_t));
   if (!output_amounts || !output_colors) {
-    for (size_t i = 0; i < num_inputs; i++)
-      free(classified_inputs[i].address);
-    free(classified_inputs);
-    free(input_colors);
-    free(input_amounts);
-    free(output_amounts);
-    free(output_colors);
-    free(classified_outputs);
+    arena_destroy(&arena);
     wally_tx_free(global_tx);
     return false;
   }
@@ -1223,9 +1223,10 @@ static bool create_psbt_info_display(void) {
   for (size_t i = 0; i < num_outputs; i++) {
     classified_outputs[i].index = i;
     classified_outputs[i].value = global_tx->outputs[i].satoshi;
-    classified_outputs[i].address = psbt_scriptpubkey_to_address(
-        global_tx->outputs[i].script, global_tx->outputs[i].script_len,
-        is_testnet);
+    classified_outputs[i].address = address_to_arena(
+        &arena, psbt_scriptpubkey_to_address(global_tx->outputs[i].script,
+                                             global_tx->outputs[i].script_len,
+                                             is_testnet));
     classified_outputs[i].path[0] = '\0';
     classified_outputs[i].type = classify_output(
         i, &classified_outputs[i].address_index, classified_outputs[i].path,
@@ -1329,11 +1330,6 @@ static bool create_psbt_info_display(void) {
     }
   }
 
-  free(input_amounts);
-  free(input_colors);
-  free(output_amounts);
-  free(output_colors);
-
   /* Group owned-safe inputs by their signing policy and render one
    * "Inputs(N): <amount> from <policy>" row per distinct source.
    * UNSAFE / EXPECTED / External inputs keep their dedicated warning
@@ -1652,26 +1648,7 @@ static bool create_psbt_info_display(void) {
     }
   }
 
-  for (size_t i = 0; i < num_outputs; i++) {
-    if (classified_outputs[i].address) {
-      if (strcmp(classified_outputs[i].address, "OP_RETURN") == 0) {
-        free(classified_outputs[i].address);
-      } else {
-        wally_free_string(classified_outputs[i].address);
-      }
-    }
-  }
-  free(classified_outputs);
-
-  for (size_t i = 0; i < num_inputs; i++) {
-    if (classified_inputs[i].address) {
-      if (strcmp(classified_inputs[i].address, "OP_RETURN") == 0)
-        free(classified_inputs[i].address);
-      else
-        wally_free_string(classified_inputs[i].address);
-    }
-  }
-  free(classified_inputs);
+  arena_destroy(&arena);
 
   if (global_tx) {
     wally_tx_free(global_tx);
@@ -1752,8 +1729,10 @@ static void deferred_sign_cb(lv_timer_t *timer) {
       .allow_expected_owned = settings_get_expected_owned_signing(),
   };
   psbt_sign_result_t sign_result;
+  power_gov_acquire(POWER_ACT_SIGNING);
   size_t signatures_added =
       psbt_sign(current_psbt, is_testnet, sign_policy, &sign_result);
+  power_gov_release(POWER_ACT_SIGNING);
 
   if (signatures_added == 0) {
     dismiss_progress();
@@ -2143,8 +2122,11 @@ static void create_bip322_sign_display(void) {
 
 static void message_sign_button_cb(lv_event_t *e) {
   char *sig_b64 = NULL;
-  if (!message_sign_sign(current_message.derivation_path,
-                         current_message.message, &sig_b64)) {
+  power_gov_acquire(POWER_ACT_SIGNING);
+  bool signed_ok = message_sign_sign(current_message.derivation_path,
+                                     current_message.message, &sig_b64);
+  power_gov_release(POWER_ACT_SIGNING);
+  if (!signed_ok) {
     dialog_show_error_timeout("Failed to sign message", NULL, 2000);
     return;
   }
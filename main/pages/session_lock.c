@@ -6,14 +6,17 @@
 #include "../core/settings.h"
 #include "../core/wallet.h"
 #include "../ui/dialog.h"
+#include "../utils/power_gov.h"
 #include "../utils/session.h"
 #include "disclaimer.h"
 #include "login/login.h"
 #include "pin/pin_page.h"
 #include "screensaver.h"
 #include "video.h"
+#include <bsp/display.h>
 #include <bsp/pmic.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 
 static const char *TAG = "SESSION_LOCK";
 
@@ -98,6 +101,7 @@ static void lock_dismissed_cb(void) {
 }
 
 static void session_expired_handler(void) {
+  settings_flush();
   if (device_locked) {
     // Nothing left to protect at the lock face / PIN gate; power-off boards
     // save the battery instead of idling there.
@@ -131,12 +135,45 @@ static void screensaver_trigger_handler(void) {
   screensaver_create(lv_screen_active(), NULL, NULL);
 }
 
+// ---------------------------------------------------------------------------
+// Power governor hooks
+// ---------------------------------------------------------------------------
+
+static void gov_set_backlight(uint8_t percent) {
+  bsp_display_brightness_set(percent);
+}
+
+static bool gov_battery_percent(uint8_t *percent) {
+  return bsp_pmic_is_available() &&
+         bsp_pmic_get_battery_percent(percent) == ESP_OK;
+}
+
+// Camera pages stop their stream before letting go; this only catches a
+// stream left running without one.
+static void gov_camera_idle(void) {
+  if (app_video_is_streaming()) {
+    ESP_LOGW(TAG, "Camera streaming with no consumer, stopping");
+    app_video_stop();
+  }
+}
+
+static uint32_t gov_now_ms(void) {
+  return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
 void session_lock_reload_settings(void) {
   session_set_screensaver_timeout(settings_get_screensaver_timeout());
   session_set_timeout(settings_get_session_timeout());
 }
 
 void session_lock_init(void) {
+  static const power_gov_hooks_t hooks = {
+      .set_backlight = gov_set_backlight,
+      .battery_percent = gov_battery_percent,
+      .camera_idle = gov_camera_idle,
+      .now_ms = gov_now_ms,
+  };
+  power_gov_init(&hooks, settings_get_brightness());
   session_init(screensaver_trigger_handler, session_expired_handler);
   session_lock_reload_settings();
 }
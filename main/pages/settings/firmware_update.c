@@ -213,6 +213,7 @@ void firmware_update_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
       .on_file_selected = file_selected_cb,
       .return_cb = browser_return_cb,
       .max_file_size = 0x600000, /* OTA slot size */
+      .accept_kinds = SD_FILE_KIND_BIT(SD_FILE_KIND_FIRMWARE),
   };
   sd_file_browser_create(parent, &cfg);
 }
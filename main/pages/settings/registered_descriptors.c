@@ -113,7 +113,7 @@ static void view_descriptor_cb(void) {
     if (policy) {
       char ours[MINISCRIPT_POLICY_MAX_KEYS + 1];
       our_key_letters(entry->desc, ours);
-      descriptor_policy_view_create(body, policy, ours);
+      descriptor_policy_view_create(body, entry->checksum, policy, ours);
       free(policy);
     }
   }
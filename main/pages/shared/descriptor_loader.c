@@ -1,6 +1,7 @@
 #include "descriptor_loader.h"
 #include "../../../components/cUR/src/types/bytes_type.h"
 #include "../../../components/cUR/src/types/output.h"
+#include "../../core/descriptor_parse.h"
 #include "../../core/key.h"
 #include "../../core/miniscript_policy.h"
 #include "../../core/registry.h"
@@ -14,6 +15,7 @@
 #include "../../ui/menu.h"
 #include "../../ui/text_fit.h"
 #include "../../ui/theme_widgets.h"
+#include "../../utils/arena.h"
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,7 +24,7 @@
 
 // Convert extended pubkey with non-standard version bytes to xpub/tpub.
 // Handles Zpub, Ypub (mainnet) and Vpub, Upub (testnet).
-static char *convert_xpub_version(const char *key) {
+static char *convert_xpub_version(arena_t *arena, const char *key) {
   static const struct {
     uint8_t from[4], to[4];
   } version_map[] = {
@@ -56,7 +58,7 @@ encode:;
   if (wally_base58_from_bytes(decoded, written, BASE58_FLAG_CHECKSUM,
                               &wally_str) != WALLY_OK)
     return NULL;
-  char *result = strdup(wally_str);
+  char *result = arena_strdup(arena, wally_str);
   wally_free_string(wally_str);
   return result;
 }
@@ -105,10 +107,13 @@ static char *bluewallet_to_descriptor(const char *text) {
     return NULL;
   }
 
+  // Key text and converted xpubs are scratch for this one conversion
+  arena_t arena;
+  arena_init(&arena, 0, ARENA_MEM_DEFAULT);
   char fingerprints[BLUEWALLET_MAX_KEYS][9];
   char *xpubs[BLUEWALLET_MAX_KEYS];
   unsigned int found_keys = 0;
-  memset(xpubs, 0, sizeof(xpubs));
+  char *descriptor = NULL;
 
   const char *line = text;
   while (*line && found_keys < num_keys) {
@@ -131,14 +136,11 @@ static char *bluewallet_to_descriptor(const char *text) {
                *key_end != ' ')
           key_end++;
 
-        char *raw_key = malloc(key_end - key_start + 1);
+        char *raw_key = arena_strndup(&arena, key_start, key_end - key_start);
         if (!raw_key)
           goto cleanup;
-        memcpy(raw_key, key_start, key_end - key_start);
-        raw_key[key_end - key_start] = '\0';
 
-        xpubs[found_keys] = convert_xpub_version(raw_key);
-        free(raw_key);
+        xpubs[found_keys] = convert_xpub_version(&arena, raw_key);
         if (!xpubs[found_keys])
           goto cleanup;
         found_keys++;
@@ -158,7 +160,7 @@ static char *bluewallet_to_descriptor(const char *text) {
   for (unsigned int i = 0; i < num_keys; i++)
     desc_size += 8 + strlen(origin_path) + strlen(xpubs[i]) + 5;
 
-  char *descriptor = malloc(desc_size);
+  descriptor = malloc(desc_size);
   if (!descriptor)
     goto cleanup;
 
@@ -169,14 +171,9 @@ static char *bluewallet_to_descriptor(const char *text) {
                     fingerprints[i], origin_path, xpubs[i]);
   snprintf(descriptor + pos, desc_size - pos, ")%s", wrapper_close);
 
-  for (unsigned int i = 0; i < found_keys; i++)
-    free(xpubs[i]);
-  return descriptor;
-
 cleanup:
-  for (unsigned int i = 0; i < found_keys; i++)
-    free(xpubs[i]);
-  return NULL;
+  arena_destroy(&arena);
+  return descriptor;
 }
 
 bool descriptor_loader_show_error(descriptor_validation_result_t result) {
@@ -361,43 +358,35 @@ static lv_color_t policy_token_color(const ms_token_t *tok,
   }
 }
 
-// Recover a child spangroup's nesting level from its left padding.
-static int32_t policy_line_level(lv_obj_t *child, int32_t indent_px) {
-  return lv_obj_get_style_pad_left(child, 0) / indent_px;
-}
-
-// Scanning forward from line i, is there another line at exactly `depth` before
-// a shallower line closes the branch? (i.e. does this branch have more
-// siblings, so its spine should keep descending).
-static bool policy_branch_continues(lv_obj_t *cont, uint32_t n, uint32_t i,
-                                    int32_t depth, int32_t indent_px) {
-  for (uint32_t j = i + 1; j < n; j++) {
-    int32_t lj = policy_line_level(lv_obj_get_child(cont, j), indent_px);
-    if (lj < depth)
-      return false;
-    if (lj == depth)
-      return true;
-  }
-  return false;
-}
-
-// Draw a file-tree style guide: a vertical spine per nesting branch with an
-// elbow joining each line to its parent (tee while siblings remain, corner on
-// the last one). Each child spangroup's level is recovered from its padding.
-static void policy_tree_draw_cb(lv_event_t *e) {
-  lv_obj_t *cont = lv_event_get_target(e);
-  lv_layer_t *layer = lv_event_get_layer(e);
-  int32_t indent_px = (int32_t)(intptr_t)lv_event_get_user_data(e);
-  if (!layer || indent_px <= 0)
+// State of one rendered policy: the shared view (a cache reference) and the
+// row geometry the draw callback lays lines out with.
+typedef struct {
+  ms_policy_view_t *view;
+  const lv_font_t *font;
+  int32_t indent_px;
+  int32_t pitch; // line height plus the gap between lines
+  char ours[MINISCRIPT_POLICY_MAX_KEYS + 1];
+} policy_render_t;
+
+// Draw a file-tree style guide for line i at row y1: a vertical spine per
+// nesting branch with an elbow joining the line to its parent (tee while
+// siblings remain, corner on the last one).
+static void policy_draw_guides(lv_layer_t *layer, const policy_render_t *pr,
+                               size_t i, int32_t x0, int32_t y1) {
+  int32_t level = miniscript_policy_view_level(pr->view, i);
+  if (level <= 0 || pr->indent_px <= 0)
     return;
 
   int32_t guide_px = theme_small_padding() / 4;
   if (guide_px < 1)
     guide_px = 1;
-  int32_t inset = indent_px / 4;
+  int32_t inset = pr->indent_px / 4;
   if (inset < 2)
     inset = 2;
-  int32_t gap = lv_obj_get_style_pad_row(cont, 0);
+  int32_t y2 = y1 + pr->font->line_height - 1;
+  int32_t mid = (y1 + y2) / 2;
+  // Bridge the inter-row gap up to the parent.
+  int32_t top = y1 - (pr->pitch - pr->font->line_height);
 
   lv_draw_line_dsc_t dsc;
   lv_draw_line_dsc_init(&dsc);
@@ -405,49 +394,117 @@ static void policy_tree_draw_cb(lv_event_t *e) {
   dsc.width = guide_px;
   dsc.opa = LV_OPA_50;
 
-  lv_area_t content;
+  // Ancestor branches still expecting siblings get a pass-through spine.
+  for (int32_t d = 1; d < level; d++) {
+    if (!miniscript_policy_view_continues(pr->view, i, d))
+      continue;
+    dsc.p1.x = dsc.p2.x = x0 + (d - 1) * pr->indent_px + inset;
+    dsc.p1.y = top;
+    dsc.p2.y = y2;
+    lv_draw_line(layer, &dsc);
+  }
+
+  // This line's own branch: spine down to the elbow, then across to the text.
+  int32_t x = x0 + (level - 1) * pr->indent_px + inset;
+  bool last = !miniscript_policy_view_continues(pr->view, i, level);
+  dsc.p1.x = dsc.p2.x = x;
+  dsc.p1.y = top;
+  dsc.p2.y = last ? mid : y2;
+  lv_draw_line(layer, &dsc);
+
+  dsc.p1.x = x;
+  dsc.p1.y = dsc.p2.y = mid;
+  dsc.p2.x = x0 + level * pr->indent_px;
+  lv_draw_line(layer, &dsc);
+}
+
+// Only the rows inside the scrolling parent are tokenized and drawn, so a
+// policy of a thousand lines costs what one screenful does.
+static void policy_draw_cb(lv_event_t *e) {
+  lv_obj_t *cont = lv_event_get_target(e);
+  lv_layer_t *layer = lv_event_get_layer(e);
+  policy_render_t *pr = lv_event_get_user_data(e);
+  if (!layer || !pr)
+    return;
+
+  lv_area_t content, visible;
   lv_obj_get_content_coords(cont, &content);
-  int32_t x0 = content.x1;
-  uint32_t n = lv_obj_get_child_count(cont);
+  visible = content;
+  lv_obj_t *viewport = lv_obj_get_parent(cont);
+  if (viewport) {
+    lv_area_t port;
+    lv_obj_get_coords(viewport, &port);
+    if (!lv_area_intersect(&visible, &content, &port))
+      return;
+  }
 
-  for (uint32_t i = 0; i < n; i++) {
-    lv_obj_t *child = lv_obj_get_child(cont, i);
-    int32_t level = policy_line_level(child, indent_px);
-    if (level <= 0)
+  size_t n = miniscript_policy_view_num_lines(pr->view);
+  if (n == 0 || pr->pitch <= 0)
+    return;
+  size_t first = (size_t)((visible.y1 - content.y1) / pr->pitch);
+  size_t last = (size_t)((visible.y2 - content.y1) / pr->pitch);
+  if (last >= n)
+    last = n - 1;
+
+  lv_draw_label_dsc_t dsc;
+  lv_draw_label_dsc_init(&dsc);
+  dsc.font = pr->font;
+  dsc.text_local = 1; // token text is reused for the next line
+
+  for (size_t i = first; i <= last; i++) {
+    int32_t y1 = content.y1 + (int32_t)i * pr->pitch;
+    policy_draw_guides(layer, pr, i, content.x1, y1);
+
+    ms_policy_line_t line;
+    if (!miniscript_policy_view_line(pr->view, i, &line))
       continue;
-
-    lv_area_t a;
-    lv_obj_get_coords(child, &a);
-    int32_t mid = (a.y1 + a.y2) / 2;
-    int32_t top = a.y1 - gap; // bridge the inter-row gap up to the parent
-
-    // Ancestor branches still expecting siblings get a pass-through spine.
-    for (int32_t d = 1; d < level; d++) {
-      if (!policy_branch_continues(cont, n, i, d, indent_px))
-        continue;
-      int32_t x = x0 + (d - 1) * indent_px + inset;
-      dsc.p1.x = dsc.p2.x = x;
-      dsc.p1.y = top;
-      dsc.p2.y = a.y2;
-      lv_draw_line(layer, &dsc);
+    lv_area_t area = {
+        .x1 = content.x1 + line.level * pr->indent_px,
+        .y1 = y1,
+        .x2 = content.x2,
+        .y2 = y1 + pr->font->line_height - 1,
+    };
+    for (size_t j = 0; j < line.num_tokens && area.x1 < area.x2; j++) {
+      const ms_token_t *tok = &line.tokens[j];
+      char note[32];
+      const char *text = tok->text;
+      if (tok->kind == MS_TOKEN_NOTE) {
+        snprintf(note, sizeof(note), " %s", tok->text);
+        text = note;
+      }
+      dsc.text = text;
+      dsc.color = policy_token_color(tok, pr->ours);
+      lv_draw_label(layer, &dsc, &area);
+
+      lv_point_t size;
+      lv_text_get_size(&size, text, pr->font, 0, 0, LV_COORD_MAX,
+                       LV_TEXT_FLAG_NONE);
+      area.x1 += size.x;
     }
+  }
+}
 
-    // This line's own branch: spine down to the elbow, then across to the text.
-    int32_t x = x0 + (level - 1) * indent_px + inset;
-    bool last = !policy_branch_continues(cont, n, i, level, indent_px);
-    dsc.p1.x = dsc.p2.x = x;
-    dsc.p1.y = top;
-    dsc.p2.y = last ? mid : a.y2;
-    lv_draw_line(layer, &dsc);
+// Rows are drawn rather than laid out, so the container reports their
+// height itself and still sizes to content around any padding it is given.
+static void policy_size_cb(lv_event_t *e) {
+  policy_render_t *pr = lv_event_get_user_data(e);
+  lv_point_t *size = lv_event_get_self_size_info(e);
+  int32_t n = (int32_t)miniscript_policy_view_num_lines(pr->view);
+  int32_t height = n * pr->pitch - (pr->pitch - pr->font->line_height);
+  if (size->y < height)
+    size->y = height;
+}
 
-    dsc.p1.x = x;
-    dsc.p1.y = dsc.p2.y = mid;
-    dsc.p2.x = x0 + level * indent_px;
-    lv_draw_line(layer, &dsc);
-  }
+static void policy_delete_cb(lv_event_t *e) {
+  policy_render_t *pr = lv_event_get_user_data(e);
+  if (!pr)
+    return;
+  miniscript_policy_view_release(pr->view);
+  free(pr);
 }
 
-lv_obj_t *descriptor_policy_view_create(lv_obj_t *parent, const char *policy,
+lv_obj_t *descriptor_policy_view_create(lv_obj_t *parent, const char *checksum,
+                                        const char *policy,
                                         const char *our_letters) {
   if (!parent || !policy || !*policy)
     return NULL;
@@ -460,50 +517,29 @@ lv_obj_t *descriptor_policy_view_create(lv_obj_t *parent, const char *policy,
   if (max_chars < 20)
     max_chars = 20;
 
-  ms_policy_view_t view;
-  if (!miniscript_policy_view_build(policy, max_chars, &view))
+  policy_render_t *pr = calloc(1, sizeof(*pr));
+  if (!pr)
+    return NULL;
+  pr->view = miniscript_policy_view_get(checksum, policy, max_chars);
+  if (!pr->view) {
+    free(pr);
     return NULL;
+  }
+  pr->font = font;
+  pr->indent_px = theme_default_padding() / 2;
+  pr->pitch = font->line_height + theme_small_padding() / 2;
+  snprintf(pr->ours, sizeof(pr->ours), "%s", our_letters ? our_letters : "");
 
+  // One object as tall as every line; rows are drawn on demand.
   lv_obj_t *cont = lv_obj_create(parent);
   lv_obj_set_style_bg_opa(cont, LV_OPA_TRANSP, 0);
   lv_obj_set_style_border_width(cont, 0, 0);
   lv_obj_set_style_pad_all(cont, 0, 0);
-  lv_obj_set_style_pad_row(cont, theme_small_padding() / 2, 0);
-  lv_obj_set_size(cont, LV_PCT(100), LV_SIZE_CONTENT);
-  lv_obj_set_flex_flow(cont, LV_FLEX_FLOW_COLUMN);
   lv_obj_clear_flag(cont, LV_OBJ_FLAG_SCROLLABLE);
-
-  int32_t indent_px = theme_default_padding() / 2;
-  lv_obj_add_event_cb(cont, policy_tree_draw_cb, LV_EVENT_DRAW_MAIN,
-                      (void *)(intptr_t)indent_px);
-
-  for (size_t i = 0; i < view.num_lines; i++) {
-    const ms_policy_line_t *line = &view.lines[i];
-    lv_obj_t *sg = lv_spangroup_create(cont);
-    lv_spangroup_set_mode(sg, LV_SPAN_MODE_BREAK);
-    lv_obj_set_width(sg, LV_PCT(100));
-    lv_obj_set_height(sg, LV_SIZE_CONTENT);
-    lv_obj_set_style_text_font(sg, font, 0);
-    lv_obj_set_style_pad_left(sg, line->level * indent_px, 0);
-    for (size_t j = 0; j < line->num_tokens; j++) {
-      const ms_token_t *tok = &line->tokens[j];
-      lv_span_t *span = lv_spangroup_add_span(sg);
-      if (!span)
-        continue;
-      if (tok->kind == MS_TOKEN_NOTE) {
-        char text[32];
-        snprintf(text, sizeof(text), " %s", tok->text);
-        lv_span_set_text(span, text);
-      } else {
-        lv_span_set_text(span, tok->text);
-      }
-      lv_style_set_text_color(lv_span_get_style(span),
-                              policy_token_color(tok, our_letters));
-    }
-    lv_spangroup_refresh(sg);
-  }
-
-  miniscript_policy_view_free(&view);
+  lv_obj_add_event_cb(cont, policy_size_cb, LV_EVENT_GET_SELF_SIZE, pr);
+  lv_obj_add_event_cb(cont, policy_draw_cb, LV_EVENT_DRAW_MAIN, pr);
+  lv_obj_add_event_cb(cont, policy_delete_cb, LV_EVENT_DELETE, pr);
+  lv_obj_set_size(cont, LV_PCT(100), LV_SIZE_CONTENT);
   return cont;
 }
 
@@ -647,8 +683,8 @@ static void descriptor_info_confirm_wrapper(const descriptor_info_t *info,
         ours[n_ours++] = (char)('A' + i);
     ours[n_ours] = '\0';
 
-    lv_obj_t *policy_view =
-        descriptor_policy_view_create(scroll, info->policy, ours);
+    lv_obj_t *policy_view = descriptor_policy_view_create(
+        scroll, info->checksum, info->policy, ours);
     if (policy_view)
       lv_obj_set_style_pad_top(policy_view, theme_small_padding(), 0);
   }
@@ -736,8 +772,11 @@ void descriptor_loader_process_string_watch_only(
   char *unambiguous = descriptor_to_unambiguous(to_process);
   const char *final = unambiguous ? unambiguous : to_process;
 
-  wallet_network_t net;
-  if (!descriptor_infer_network(final, &net)) {
+  /* The keys decide the network; a descriptor of raw keys only defaults to
+   * mainnet. The parse is handed on to validation rather than repeated. */
+  descriptor_parsed_t parsed;
+  if (descriptor_parse_once(final, WALLET_NETWORK_MAINNET, &parsed) !=
+      WALLY_OK) {
     if (validation_cb)
       validation_cb(VALIDATION_PARSE_ERROR, user_data);
     free(unambiguous);
@@ -745,9 +784,10 @@ void descriptor_loader_process_string_watch_only(
     return;
   }
 
-  wallet_set_watch_only(net);
-  descriptor_validate_and_load_watch_only(
-      final, net, validation_cb, descriptor_info_confirm_wrapper, user_data);
+  wallet_set_watch_only(parsed.network);
+  descriptor_validate_and_load_watch_only(final, &parsed, validation_cb,
+                                          descriptor_info_confirm_wrapper,
+                                          user_data);
   free(unambiguous);
   free(converted);
 }
@@ -83,10 +83,16 @@ char *descriptor_to_unambiguous(const char *descriptor);
  * accented with ~duration/date notes, structural plumbing dimmed. Letters in
  * `our_letters` (e.g. "AC", may be NULL/empty) get the highlight color.
  *
+ * Only lines scrolled into `parent` are tokenized and drawn. The indented
+ * policy is shared through the view cache under the descriptor `checksum`
+ * (NULL/empty: not cached), so reopening the same descriptor does not
+ * indent it again.
+ *
  * @return Container with the rendered lines, or NULL if the policy could not
  *         be rendered.
  */
-lv_obj_t *descriptor_policy_view_create(lv_obj_t *parent, const char *policy,
+lv_obj_t *descriptor_policy_view_create(lv_obj_t *parent, const char *checksum,
+                                        const char *policy,
                                         const char *our_letters);
 
 #endif // DESCRIPTOR_LOADER_H
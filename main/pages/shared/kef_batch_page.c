@@ -0,0 +1,233 @@
+/*
+ * KEF Batch Page
+ * One key entry for several KEF envelopes.
+ * Follows the same pattern as kef_decrypt_page.c.
+ *
+ * kef_batch runs the PBKDF2 derivations on its own worker tasks; a UI
+ * deadline polls it and hands each opened envelope to the caller on the
+ * UI thread.
+ */
+
+#include "kef_batch_page.h"
+#include "../../core/kef_batch.h"
+#include "../../ui/deadline.h"
+#include "../../ui/dialog.h"
+#include "../../ui/input_helpers.h"
+#include "../../ui/theme_widgets.h"
+#include "../../utils/secure_mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POLL_PERIOD_MS 100
+
+static lv_obj_t *batch_screen = NULL;
+static lv_obj_t *progress_dialog = NULL;
+static ui_text_input_t text_input = {0};
+static int poll_deadline = -1;
+
+static void (*return_callback)(void) = NULL;
+static kef_batch_page_result_cb_t result_callback = NULL;
+static kef_batch_page_done_cb_t done_callback = NULL;
+
+/* Envelope copies, kept for a retry after a wrong key */
+static uint8_t **envelope_copies = NULL;
+static size_t *envelope_lens = NULL;
+static size_t envelope_count = 0;
+
+static kef_batch_t *batch = NULL;
+static size_t unlocked_count = 0;
+static kef_error_t first_error = KEF_OK;
+
+static void show_input(void) {
+  ui_text_input_show(&text_input);
+  if (progress_dialog) {
+    lv_obj_del(progress_dialog);
+    progress_dialog = NULL;
+  }
+}
+
+static void show_loading(void) {
+  char msg[40];
+  snprintf(msg, sizeof(msg), "Decrypting %u files...",
+           (unsigned)envelope_count);
+  ui_text_input_hide(&text_input);
+  progress_dialog = dialog_show_progress("KEF", msg, DIALOG_STYLE_OVERLAY);
+}
+
+static void stop_batch(void) {
+  ui_deadline_remove(poll_deadline);
+  poll_deadline = -1;
+  kef_batch_destroy(batch);
+  batch = NULL;
+}
+
+static void on_result(void *ctx, size_t index, kef_error_t err,
+                      const uint8_t *data, size_t len) {
+  (void)ctx;
+  if (err != KEF_OK) {
+    /* A different passphrase is expected; anything else is worth showing */
+    if (err != KEF_ERR_AUTH && first_error == KEF_OK)
+      first_error = err;
+    return;
+  }
+  unlocked_count++;
+  if (result_callback)
+    result_callback(index, data, len);
+}
+
+/* UI deadline polls the batch for finished envelopes */
+static void poll_cb(void *user_data) {
+  (void)user_data;
+  if (!kef_batch_poll(batch, on_result, NULL))
+    return;
+
+  stop_batch();
+
+  if (unlocked_count > 0) {
+    if (done_callback)
+      done_callback(unlocked_count);
+    return;
+  }
+
+  /* Nothing opened — show error and let user retry */
+  show_input();
+  if (text_input.textarea)
+    lv_textarea_set_text(text_input.textarea, "");
+
+  if (first_error == KEF_OK)
+    dialog_show_error_timeout("Wrong key", NULL, 0);
+  else
+    dialog_show_error_timeout(kef_error_str(first_error), NULL, 0);
+}
+
+static void keyboard_ready_cb(lv_event_t *e) {
+  (void)e;
+  const char *text = lv_textarea_get_text(text_input.textarea);
+  if (!text || text[0] == '\0' || batch)
+    return;
+
+  unlocked_count = 0;
+  first_error = KEF_OK;
+
+  /* kef_batch_start copies the key, so the textarea is the only other copy */
+  kef_error_t err = kef_batch_start(
+      (const uint8_t *)text, strlen(text),
+      (const uint8_t *const *)envelope_copies, envelope_lens, envelope_count,
+      &batch);
+  lv_textarea_set_text(text_input.textarea, "");
+  if (err != KEF_OK) {
+    batch = NULL;
+    dialog_show_error_timeout(kef_error_str(err), NULL, 0);
+    return;
+  }
+
+  show_loading();
+
+  poll_deadline = ui_deadline_add(poll_cb, NULL, POLL_PERIOD_MS / 2);
+  if (poll_deadline < 0) {
+    kef_batch_destroy(batch);
+    batch = NULL;
+    show_input();
+    dialog_show_error_timeout("Timer creation failed", NULL, 0);
+    return;
+  }
+  ui_deadline_arm(poll_deadline, POLL_PERIOD_MS, POLL_PERIOD_MS);
+}
+
+static void back_btn_cb(lv_event_t *e) {
+  (void)e;
+  if (return_callback)
+    return_callback();
+}
+
+static void free_envelopes(void) {
+  for (size_t i = 0; i < envelope_count; i++)
+    SECURE_FREE_BUFFER(envelope_copies[i], envelope_lens[i]);
+  free(envelope_copies);
+  envelope_copies = NULL;
+  free(envelope_lens);
+  envelope_lens = NULL;
+  envelope_count = 0;
+}
+
+void kef_batch_page_create(lv_obj_t *parent, void (*return_cb)(void),
+                           kef_batch_page_result_cb_t result_cb,
+                           kef_batch_page_done_cb_t done_cb,
+                           const uint8_t *const *envelopes,
+                           const size_t *env_lens, size_t count) {
+  (void)parent;
+  if (!envelopes || !env_lens || count == 0)
+    return;
+
+  return_callback = return_cb;
+  result_callback = result_cb;
+  done_callback = done_cb;
+
+  /* Copy envelope data */
+  envelope_copies = calloc(count, sizeof(*envelope_copies));
+  envelope_lens = calloc(count, sizeof(*envelope_lens));
+  if (!envelope_copies || !envelope_lens) {
+    free_envelopes();
+    return;
+  }
+  envelope_count = count;
+  for (size_t i = 0; i < count; i++) {
+    envelope_copies[i] = malloc(env_lens[i]);
+    if (!envelope_copies[i]) {
+      free_envelopes();
+      return;
+    }
+    memcpy(envelope_copies[i], envelopes[i], env_lens[i]);
+    envelope_lens[i] = env_lens[i];
+  }
+
+  char title[40];
+  snprintf(title, sizeof(title), "Enter Key for %u files", (unsigned)count);
+
+  /* Screen */
+  batch_screen = theme_create_page_container(lv_screen_active());
+  theme_create_page_title(batch_screen, title);
+  ui_create_back_button(batch_screen, back_btn_cb);
+
+  /* Text input (textarea + eye toggle + keyboard) */
+  ui_text_input_create(&text_input, batch_screen, "key", true,
+                       keyboard_ready_cb);
+
+  progress_dialog = NULL;
+}
+
+void kef_batch_page_show(void) {
+  if (batch_screen)
+    lv_obj_clear_flag(batch_screen, LV_OBJ_FLAG_HIDDEN);
+  if (text_input.keyboard)
+    lv_obj_clear_flag(text_input.keyboard, LV_OBJ_FLAG_HIDDEN);
+}
+
+void kef_batch_page_hide(void) {
+  if (batch_screen)
+    lv_obj_add_flag(batch_screen, LV_OBJ_FLAG_HIDDEN);
+  if (text_input.keyboard)
+    lv_obj_add_flag(text_input.keyboard, LV_OBJ_FLAG_HIDDEN);
+}
+
+void kef_batch_page_destroy(void) {
+  stop_batch();
+  ui_text_input_destroy(&text_input);
+  if (batch_screen) {
+    lv_obj_del(batch_screen);
+    batch_screen = NULL;
+  }
+  if (progress_dialog) {
+    lv_obj_del(progress_dialog);
+    progress_dialog = NULL;
+  }
+
+  free_envelopes();
+  unlocked_count = 0;
+  first_error = KEF_OK;
+
+  return_callback = NULL;
+  result_callback = NULL;
+  done_callback = NULL;
+}
@@ -0,0 +1,36 @@
+/*
+ * KEF Batch Page
+ * One key entry for several KEF envelopes, decrypted with kef_batch.
+ */
+
+#ifndef KEF_BATCH_PAGE_H
+#define KEF_BATCH_PAGE_H
+
+#include <lvgl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Called once per envelope the key opened, as soon as it is done. data is
+ * only valid during the call (the page wipes it afterwards); copy what you
+ * keep. index is the envelope's position in the array given to create.
+ */
+typedef void (*kef_batch_page_result_cb_t)(size_t index, const uint8_t *data,
+                                           size_t len);
+
+/**
+ * Called once every envelope has been tried and at least one opened.
+ * If none did, the page shows "Wrong key" and asks again instead.
+ */
+typedef void (*kef_batch_page_done_cb_t)(size_t unlocked);
+
+void kef_batch_page_create(lv_obj_t *parent, void (*return_cb)(void),
+                           kef_batch_page_result_cb_t result_cb,
+                           kef_batch_page_done_cb_t done_cb,
+                           const uint8_t *const *envelopes,
+                           const size_t *env_lens, size_t count);
+void kef_batch_page_show(void);
+void kef_batch_page_hide(void);
+void kef_batch_page_destroy(void);
+
+#endif // KEF_BATCH_PAGE_H
@@ -13,6 +13,7 @@
 #include "../../ui/dialog.h"
 #include "../../ui/input_helpers.h"
 #include "../../ui/theme_widgets.h"
+#include "../../utils/power_gov.h"
 #include "../../utils/secure_mem.h"
 #include <esp_task_wdt.h>
 #include <freertos/FreeRTOS.h>
@@ -71,8 +72,10 @@ static void decrypt_task(void *arg) {
     decrypted_len = 0;
   }
 
+  power_gov_acquire(POWER_ACT_KDF);
   decrypt_result = kef_decrypt(envelope_copy, envelope_copy_len, key_copy,
                                key_copy_len, &decrypted_data, &decrypted_len);
+  power_gov_release(POWER_ACT_KDF);
 
   /* Zero key immediately after use */
   SECURE_FREE_BUFFER(key_copy, key_copy_len);
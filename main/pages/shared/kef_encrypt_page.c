@@ -3,7 +3,8 @@
  *
  * Shared encryption flow: fingerprint/custom ID prompt, two-step key
  * confirmation, and background encryption on CPU 1.  On success the
- * caller-supplied callback receives the encrypted KEF envelope.
+ * caller-supplied callback receives the encrypted KEF envelope, or in
+ * stream mode the derived key to write the envelope with.
  *
  * Mirrors the kef_decrypt_page pattern.
  */
@@ -14,6 +15,7 @@
 #include "../../ui/dialog.h"
 #include "../../ui/input_helpers.h"
 #include "../../ui/theme_widgets.h"
+#include "../../utils/power_gov.h"
 #include "../../utils/secure_mem.h"
 
 #include <esp_task_wdt.h>
@@ -25,6 +27,7 @@
 #include <string.h>
 
 #define KEF_ITERATIONS 100000
+#define KEF_VERSION KEF_V20_GCM_E4
 #define ENCRYPT_TASK_STACK_SIZE 8192
 
 static lv_obj_t *overlay_screen = NULL;
@@ -35,6 +38,7 @@ static lv_obj_t *strength_label = NULL;
 
 static void (*return_callback)(void) = NULL;
 static kef_encrypt_success_cb_t success_callback = NULL;
+static kef_encrypt_stream_cb_t stream_callback = NULL;
 
 /* Data to encrypt (copied from caller) */
 static uint8_t *data_copy = NULL;
@@ -54,6 +58,7 @@ static uint8_t *encrypt_key_copy = NULL;
 static size_t encrypt_key_copy_len = 0;
 static uint8_t *encrypt_envelope = NULL;
 static size_t encrypt_envelope_len = 0;
+static uint8_t derived_key[32];
 
 /* Key confirmation (two-step entry) */
 static uint8_t *confirm_key = NULL;
@@ -240,10 +245,18 @@ static void encrypt_task(void *arg) {
     encrypt_envelope_len = 0;
   }
 
-  encrypt_result = kef_encrypt(
-      (const uint8_t *)kef_id, strlen(kef_id), KEF_V20_GCM_E4, encrypt_key_copy,
-      encrypt_key_copy_len, KEF_ITERATIONS, data_copy, data_copy_len,
-      &encrypt_envelope, &encrypt_envelope_len);
+  power_gov_acquire(POWER_ACT_KDF);
+  if (stream_callback)
+    encrypt_result =
+        kef_derive_key((const uint8_t *)kef_id, strlen(kef_id),
+                       encrypt_key_copy, encrypt_key_copy_len, KEF_ITERATIONS,
+                       derived_key);
+  else
+    encrypt_result = kef_encrypt(
+        (const uint8_t *)kef_id, strlen(kef_id), KEF_VERSION, encrypt_key_copy,
+        encrypt_key_copy_len, KEF_ITERATIONS, data_copy, data_copy_len,
+        &encrypt_envelope, &encrypt_envelope_len);
+  power_gov_release(POWER_ACT_KDF);
 
   SECURE_FREE_BUFFER(encrypt_key_copy, encrypt_key_copy_len);
   encrypt_key_copy_len = 0;
@@ -267,7 +280,9 @@ static void encrypt_poll_timer_cb(lv_timer_t *timer) {
   if (encrypt_result == KEF_OK) {
     destroy_overlay();
 
-    if (success_callback)
+    if (stream_callback)
+      stream_callback(kef_id, KEF_VERSION, KEF_ITERATIONS, derived_key);
+    else if (success_callback)
       success_callback(kef_id, encrypt_envelope, encrypt_envelope_len);
     return;
   }
@@ -389,6 +404,31 @@ static void id_confirm_cb(bool confirmed, void *user_data) {
 
 /* ---------- Page lifecycle ---------- */
 
+/* Offer the suggested ID (or the fingerprint) before the key prompt. */
+static void confirm_id(const char *suggested_id) {
+  char msg[80];
+
+  if (suggested_id && suggested_id[0] != '\0') {
+    /* Caller-provided ID (e.g. descriptor checksum) */
+    snprintf(kef_id, sizeof(kef_id), "%s", suggested_id);
+    snprintf(msg, sizeof(msg), "Use %s as backup ID?", suggested_id);
+  } else {
+    /* Fall back to wallet fingerprint */
+    char fp_hex[9] = {0};
+    if (!key_get_fingerprint_hex(fp_hex)) {
+      SECURE_FREE_BUFFER(data_copy, data_copy_len);
+      data_copy_len = 0;
+      dialog_show_error_timeout("Failed to get fingerprint", return_callback,
+                              0);
+      return;
+    }
+    snprintf(kef_id, sizeof(kef_id), "%s", fp_hex);
+    snprintf(msg, sizeof(msg), "Use fingerprint %s as backup ID?", fp_hex);
+  }
+
+  dialog_show_confirm(msg, id_confirm_cb, NULL, DIALOG_STYLE_OVERLAY);
+}
+
 void kef_encrypt_page_create(lv_obj_t *parent, void (*return_cb)(void),
                              kef_encrypt_success_cb_t success_cb,
                              const uint8_t *data, size_t data_len,
@@ -399,6 +439,7 @@ void kef_encrypt_page_create(lv_obj_t *parent, void (*return_cb)(void),
 
   return_callback = return_cb;
   success_callback = success_cb;
+  stream_callback = NULL;
 
   /* Copy data to encrypt */
   data_copy = malloc(data_len);
@@ -407,26 +448,21 @@ void kef_encrypt_page_create(lv_obj_t *parent, void (*return_cb)(void),
   memcpy(data_copy, data, data_len);
   data_copy_len = data_len;
 
-  char msg[80];
+  confirm_id(suggested_id);
+}
 
-  if (suggested_id && suggested_id[0] != '\0') {
-    /* Caller-provided ID (e.g. descriptor checksum) */
-    snprintf(kef_id, sizeof(kef_id), "%s", suggested_id);
-    snprintf(msg, sizeof(msg), "Use %s as backup ID?", suggested_id);
-  } else {
-    /* Fall back to wallet fingerprint */
-    char fp_hex[9] = {0};
-    if (!key_get_fingerprint_hex(fp_hex)) {
-      SECURE_FREE_BUFFER(data_copy, data_copy_len);
-      data_copy_len = 0;
-      dialog_show_error_timeout("Failed to get fingerprint", return_cb, 0);
-      return;
-    }
-    snprintf(kef_id, sizeof(kef_id), "%s", fp_hex);
-    snprintf(msg, sizeof(msg), "Use fingerprint %s as backup ID?", fp_hex);
-  }
+void kef_encrypt_page_create_stream(lv_obj_t *parent,
+                                    void (*return_cb)(void),
+                                    kef_encrypt_stream_cb_t stream_cb,
+                                    const char *suggested_id) {
+  (void)parent;
+  if (!stream_cb)
+    return;
 
-  dialog_show_confirm(msg, id_confirm_cb, NULL, DIALOG_STYLE_OVERLAY);
+  return_callback = return_cb;
+  success_callback = NULL;
+  stream_callback = stream_cb;
+  confirm_id(suggested_id);
 }
 
 void kef_encrypt_page_show(void) {
@@ -447,7 +483,10 @@ void kef_encrypt_page_destroy(void) {
   SECURE_FREE_BUFFER(encrypt_envelope, encrypt_envelope_len);
   encrypt_envelope_len = 0;
 
+  secure_memzero(derived_key, sizeof(derived_key));
+
   return_callback = NULL;
   success_callback = NULL;
+  stream_callback = NULL;
   secure_memzero(kef_id, sizeof(kef_id));
 }
@@ -18,6 +18,15 @@
 typedef void (*kef_encrypt_success_cb_t)(const char *id,
                                          const uint8_t *envelope, size_t len);
 
+/**
+ * Stream callback — for callers that write the envelope themselves with
+ * kef_stream_encrypt_init.  Receives the KEF ID, version, effective
+ * iterations and the key derived from them; same lifetime as above.
+ */
+typedef void (*kef_encrypt_stream_cb_t)(const char *id, uint8_t version,
+                                        uint32_t iterations,
+                                        const uint8_t key[32]);
+
 /**
  * @param suggested_id  When non-NULL, offered as the default backup ID
  *                      (e.g. a descriptor checksum).  When NULL the wallet
@@ -27,6 +36,14 @@ void kef_encrypt_page_create(lv_obj_t *parent, void (*return_cb)(void),
                              kef_encrypt_success_cb_t success_cb,
                              const uint8_t *data, size_t data_len,
                              const char *suggested_id);
+/**
+ * Same ID and key prompts, but only derives the key (on CPU 1) and hands it
+ * to stream_cb instead of building the envelope in memory.
+ */
+void kef_encrypt_page_create_stream(lv_obj_t *parent,
+                                    void (*return_cb)(void),
+                                    kef_encrypt_stream_cb_t stream_cb,
+                                    const char *suggested_id);
 void kef_encrypt_page_show(void);
 void kef_encrypt_page_hide(void);
 void kef_encrypt_page_destroy(void);
@@ -1,10 +1,14 @@
 // SD File Browser — reusable browse-anywhere SD-card file picker
 
 #include "sd_file_browser.h"
+#include "../../ui/deadline.h"
 #include "../../ui/dialog.h"
 #include "../../ui/menu.h"
 #include "../../ui/theme_widgets.h"
 #include "sd_card.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 #include <lvgl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,19 +22,26 @@
 
 #define BROWSER_MAX_FILE_SIZE (256 * 1024)
 
+/* File metadata (size, sniffed type) is read on a worker task a batch at a
+ * time, visible rows first and then on through the listing, so later pages
+ * and return visits show it straight away. */
+#define META_BATCH 8
+#define META_NAME_LEN 256
+#define META_POLL_MS 30
+#define META_TASK_STACK_SIZE 4096
+
 static lv_obj_t *browser_screen = NULL;
 static ui_menu_t *browser_menu = NULL;
 static lv_obj_t *loading_label = NULL;
-static lv_timer_t *init_timer = NULL;
+static int init_deadline = -1;
 static sd_file_browser_config_t cfg;
 
 static char current_path[512] = SD_CARD_MOUNT_POINT;
 
-/* Directory listing (files + subdirs), ordered directories-first so a menu
- * position maps straight onto it as page_start + index. */
-static char **raw_names = NULL;
-static bool *raw_is_dir = NULL;
-static int raw_count = 0;
+/* Cached directory listing (files + subdirs), ordered directories-first so a
+ * menu position maps straight onto it as page_start + index. Owned by
+ * sd_dir_cache; only ever touched from the LVGL task. */
+static sd_dir_listing_t *listing = NULL;
 
 static int page_start = 0;
 static int shown_count = 0;
@@ -43,13 +54,7 @@ static void entry_selected_cb(void);
 /* ---------- Cleanup ---------- */
 
 static void cleanup_listing(void) {
-  if (raw_names) {
-    sd_card_free_file_list(raw_names, raw_count);
-    raw_names = NULL;
-  }
-  free(raw_is_dir);
-  raw_is_dir = NULL;
-  raw_count = 0;
+  listing = NULL;
   shown_count = 0;
 }
 
@@ -90,6 +95,13 @@ static void back_cb(void) {
 
 /* ---------- File selection ---------- */
 
+/* Anything loadable (PSBT, descriptor, mnemonic, message, address) is far
+ * smaller — the cap keeps a mis-tapped photo or log from stalling the UI.
+ * Callers with bigger payloads (firmware images) raise it via the config. */
+static size_t max_file_size(void) {
+  return cfg.max_file_size ? cfg.max_file_size : BROWSER_MAX_FILE_SIZE;
+}
+
 static void open_file(const char *name) {
   char full[512];
   int n = snprintf(full, sizeof(full), "%s/%s", current_path, name);
@@ -98,13 +110,9 @@ static void open_file(const char *name) {
     return;
   }
 
-  // Anything loadable (PSBT, descriptor, mnemonic, message, address) is far
-  // smaller — the cap keeps a mis-tapped photo or log from stalling the UI.
-  // Callers with bigger payloads (firmware images) raise it via the config.
-  size_t max_size =
-      cfg.max_file_size ? cfg.max_file_size : BROWSER_MAX_FILE_SIZE;
+  // The listing's size may be stale or not read yet; checking costs one stat.
   size_t size = 0;
-  if (sd_card_file_size(full, &size) == ESP_OK && size > max_size) {
+  if (sd_card_file_size(full, &size) == ESP_OK && size > max_file_size()) {
     dialog_show_error_timeout("File too large", NULL, 0);
     return;
   }
@@ -118,11 +126,11 @@ static void entry_selected_cb(void) {
   if (idx < 0 || idx >= shown_count)
     return;
 
-  int r = page_start + idx;
-  if (raw_is_dir[r])
-    navigate_into(raw_names[r]);
+  const sd_dir_entry_t *e = &listing->entries[page_start + idx];
+  if (e->is_dir)
+    navigate_into(e->name);
   else
-    open_file(raw_names[r]);
+    open_file(e->name);
 }
 
 /* ---------- Menu building ---------- */
@@ -131,7 +139,7 @@ static void build_menu(void);
 
 static void more_cb(void) {
   page_start += shown_count;
-  if (page_start >= raw_count)
+  if (page_start >= listing->count)
     page_start = 0;
   if (browser_menu) {
     ui_menu_destroy(browser_menu);
@@ -140,32 +148,132 @@ static void more_cb(void) {
   build_menu();
 }
 
-/* Stable-partition the listing so directories come first. */
-static void order_dirs_first(void) {
-  if (raw_count <= 1)
-    return;
-  char **names = malloc((size_t)raw_count * sizeof(char *));
-  bool *dirs = malloc((size_t)raw_count * sizeof(bool));
-  if (!names || !dirs) { // keep raw order when memory is tight
-    free(names);
-    free(dirs);
+/* ---------- Background metadata ---------- */
+
+/* The worker never sees the listing (which the cache may free at any
+ * navigation): it gets copies of the names and hands back plain results,
+ * which the LVGL task applies only if the listing is still the same one. */
+typedef struct {
+  char dir[512];
+  uint32_t serial;
+  int count;
+  int index[META_BATCH];
+  char name[META_BATCH][META_NAME_LEN];
+  uint8_t kind[META_BATCH];
+  size_t size[META_BATCH];
+} meta_job_t;
+
+/* The worker and its job outlive any one browser: a job still running when
+ * the browser closes is discarded by serial when it lands. */
+static meta_job_t meta_job;
+static TaskHandle_t meta_task = NULL;
+static SemaphoreHandle_t meta_start = NULL;
+static volatile bool meta_busy = false;
+static volatile bool meta_done = false;
+
+static lv_timer_t *meta_timer = NULL;
+static int meta_cursor = 0; /* next listing index the prefetch considers */
+
+static void meta_task_fn(void *arg) {
+  (void)arg;
+  for (;;) {
+    xSemaphoreTake(meta_start, portMAX_DELAY);
+    for (int i = 0; i < meta_job.count; i++) {
+      sd_file_kind_t kind = SD_FILE_KIND_OTHER;
+      size_t size = 0;
+      sd_dir_read_meta(meta_job.dir, meta_job.name[i], &kind, &size);
+      meta_job.kind[i] = (uint8_t)kind;
+      meta_job.size[i] = size;
+    }
+    meta_done = true;
+  }
+}
+
+/* Oversized files, and files of a type the caller does not take, recede. */
+static void apply_row_meta(int row) {
+  const sd_dir_entry_t *e = &listing->entries[page_start + row];
+  if (e->is_dir || e->kind == SD_FILE_KIND_PENDING)
     return;
+  bool wanted =
+      !cfg.accept_kinds || (cfg.accept_kinds & SD_FILE_KIND_BIT(e->kind));
+  bool dim = !wanted || e->size > max_file_size();
+  ui_menu_set_entry_secondary(browser_menu, row, dim);
+}
+
+static bool meta_job_add(int r) {
+  const sd_dir_entry_t *e = &listing->entries[r];
+  if (e->is_dir || e->kind != SD_FILE_KIND_PENDING)
+    return false;
+  for (int i = 0; i < meta_job.count; i++) {
+    if (meta_job.index[i] == r)
+      return false;
+  }
+  int n = snprintf(meta_job.name[meta_job.count], META_NAME_LEN, "%s",
+                   e->name);
+  if (n < 0 || n >= META_NAME_LEN) {
+    /* Not worth a bigger buffer: such a row just stays undimmed. */
+    listing->entries[r].kind = SD_FILE_KIND_OTHER;
+    return false;
   }
-  int n = 0;
-  for (int pass = 0; pass < 2; pass++) {
-    bool want_dir = (pass == 0);
-    for (int r = 0; r < raw_count; r++) {
-      if (raw_is_dir[r] == want_dir) {
-        names[n] = raw_names[r];
-        dirs[n] = raw_is_dir[r];
-        n++;
+  meta_job.index[meta_job.count++] = r;
+  return true;
+}
+
+static void meta_timer_cb(lv_timer_t *timer) {
+  (void)timer;
+  if (meta_busy) {
+    if (!meta_done)
+      return;
+    if (listing && listing->serial == meta_job.serial) {
+      for (int i = 0; i < meta_job.count; i++) {
+        int r = meta_job.index[i];
+        listing->entries[r].kind = meta_job.kind[i];
+        listing->entries[r].size = meta_job.size[i];
+        if (browser_menu && r >= page_start && r < page_start + shown_count)
+          apply_row_meta(r - page_start);
       }
     }
+    meta_done = false;
+    meta_busy = false;
   }
-  memcpy(raw_names, names, (size_t)raw_count * sizeof(char *));
-  memcpy(raw_is_dir, dirs, (size_t)raw_count * sizeof(bool));
-  free(names);
-  free(dirs);
+  if (!listing)
+    return;
+
+  meta_job.count = 0;
+  for (int i = 0; i < shown_count && meta_job.count < META_BATCH; i++)
+    meta_job_add(page_start + i);
+  for (; meta_cursor < listing->count && meta_job.count < META_BATCH;
+       meta_cursor++)
+    meta_job_add(meta_cursor);
+  if (meta_job.count == 0) {
+    lv_timer_pause(meta_timer);
+    return;
+  }
+
+  snprintf(meta_job.dir, sizeof(meta_job.dir), "%s", current_path);
+  meta_job.serial = listing->serial;
+  meta_busy = true;
+  xSemaphoreGive(meta_start);
+}
+
+/* (Re)starts fetching for the current listing and page. */
+static void meta_kick(void) {
+  if (!meta_task) {
+    meta_start = xSemaphoreCreateBinary();
+    if (!meta_start ||
+        xTaskCreatePinnedToCore(meta_task_fn, "sd_meta", META_TASK_STACK_SIZE,
+                                NULL, 2, &meta_task, 1) != pdPASS) {
+      if (meta_start)
+        vSemaphoreDelete(meta_start);
+      meta_start = NULL;
+      meta_task = NULL;
+      return; /* rows simply stay as listed */
+    }
+  }
+  if (!meta_timer)
+    meta_timer = lv_timer_create(meta_timer_cb, META_POLL_MS, NULL);
+  else
+    lv_timer_resume(meta_timer);
 }
 
 static void build_menu(void) {
@@ -174,32 +282,36 @@ static void build_menu(void) {
   if (!browser_menu)
     return;
 
-  bool paged = raw_count > BROWSER_MAX_DISPLAYED;
-  if (page_start >= raw_count)
+  int count = listing->count;
+  bool paged = count > BROWSER_MAX_DISPLAYED;
+  if (page_start >= count)
     page_start = 0;
-  shown_count = raw_count - page_start;
+  shown_count = count - page_start;
   if (paged && shown_count > BROWSER_PAGE_SIZE)
     shown_count = BROWSER_PAGE_SIZE;
 
   for (int i = 0; i < shown_count; i++) {
-    int r = page_start + i;
-    ui_menu_add_entry_with_icon(
-        browser_menu, raw_is_dir[r] ? LV_SYMBOL_DIRECTORY : LV_SYMBOL_FILE,
-        raw_names[r], entry_selected_cb);
+    const sd_dir_entry_t *e = &listing->entries[page_start + i];
+    ui_menu_add_entry_with_icon(browser_menu,
+                                e->is_dir ? LV_SYMBOL_DIRECTORY
+                                          : LV_SYMBOL_FILE,
+                                e->name, entry_selected_cb);
+    apply_row_meta(i);
   }
 
-  if (raw_count == 0) {
+  if (count == 0) {
     ui_menu_add_entry(browser_menu, "(empty)", entry_selected_cb);
     ui_menu_set_entry_enabled(browser_menu, 0, false);
   } else if (paged) {
     char more[32];
-    int pages = (raw_count + BROWSER_PAGE_SIZE - 1) / BROWSER_PAGE_SIZE;
+    int pages = (count + BROWSER_PAGE_SIZE - 1) / BROWSER_PAGE_SIZE;
     snprintf(more, sizeof(more), "More... (%d/%d)",
              page_start / BROWSER_PAGE_SIZE + 1, pages);
     ui_menu_add_entry(browser_menu, more, more_cb);
   }
 
   ui_menu_show(browser_menu);
+  meta_kick();
 }
 
 void sd_file_browser_refresh(void) {
@@ -209,22 +321,25 @@ void sd_file_browser_refresh(void) {
   }
   cleanup_listing();
 
-  esp_err_t ret =
-      sd_card_list_entries(current_path, &raw_names, &raw_is_dir, &raw_count);
-  if (ret != ESP_OK) {
+  /* Opening the page empties the cache (deferred_init_cb), so a cached
+   * listing only ever serves navigation within one visit. */
+  sd_dir_listing_t *fresh = NULL;
+  if (sd_dir_cache_get(current_path, &fresh) != ESP_OK) {
     dialog_show_error_timeout("Cannot read directory", back_cb, 0);
     return;
   }
 
-  order_dirs_first();
+  listing = fresh;
+  meta_cursor = 0;
   build_menu();
 }
 
 /* ---------- Deferred initialization ---------- */
 
-static void deferred_init_cb(lv_timer_t *timer) {
-  (void)timer;
-  init_timer = NULL;
+static void deferred_init_cb(void *user_data) {
+  (void)user_data;
+  ui_deadline_remove(init_deadline);
+  init_deadline = -1;
 
   if (loading_label) {
     lv_obj_del(loading_label);
@@ -237,6 +352,11 @@ static void deferred_init_cb(lv_timer_t *timer) {
     dialog_show_error_timeout("No SD card", cfg.return_cb, 0);
     return;
   }
+  /* A live mount is reused without bumping the card generation, and FAT
+   * leaves a directory's mtime alone when its contents change, so listings
+   * from a previous visit cannot be trusted: the card may have been written
+   * elsewhere in between. */
+  sd_dir_cache_clear();
 
   sd_file_browser_refresh();
 }
@@ -260,8 +380,8 @@ void sd_file_browser_create(lv_obj_t *parent,
   lv_obj_set_style_text_color(loading_label, primary_color(), 0);
   lv_obj_align(loading_label, LV_ALIGN_CENTER, 0, 0);
 
-  init_timer = lv_timer_create(deferred_init_cb, 50, NULL);
-  lv_timer_set_repeat_count(init_timer, 1);
+  init_deadline = ui_deadline_add(deferred_init_cb, NULL, 0);
+  ui_deadline_arm(init_deadline, 50, 0);
 }
 
 void sd_file_browser_show(void) {
@@ -275,9 +395,11 @@ void sd_file_browser_hide(void) {
 }
 
 void sd_file_browser_destroy(void) {
-  if (init_timer) {
-    lv_timer_del(init_timer);
-    init_timer = NULL;
+  ui_deadline_remove(init_deadline);
+  init_deadline = -1;
+  if (meta_timer) {
+    lv_timer_del(meta_timer);
+    meta_timer = NULL;
   }
   if (browser_menu) {
     ui_menu_destroy(browser_menu);
@@ -4,13 +4,19 @@
  * Navigates SD-card directories (subfolders, paged listings, remount-on-open)
  * and hands the chosen file's path back to a caller-supplied callback. The
  * caller reads and frees the file; the browser only locates it.
+ *
+ * Listings come from sd_dir_cache, so revisiting a directory is free; file
+ * sizes and types are read in the background and recede rows the caller
+ * could not use.
  */
 
 #ifndef SD_FILE_BROWSER_H
 #define SD_FILE_BROWSER_H
 
+#include "../../core/sd_dir_cache.h"
 #include <lvgl.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct {
   /* Menu title; NULL shows the current directory path (the default). */
@@ -23,6 +29,9 @@ typedef struct {
   void (*return_cb)(void);
   /* Selectable file-size cap in bytes; 0 uses the 256KB default. */
   size_t max_file_size;
+  /* SD_FILE_KIND_BIT()s of the file types the caller takes; others are shown
+   * receded once sniffed. 0 takes everything. */
+  uint32_t accept_kinds;
 } sd_file_browser_config_t;
 
 void sd_file_browser_create(lv_obj_t *parent,
@@ -2,6 +2,7 @@
 
 #include "storage_browser.h"
 #include "../../core/storage.h"
+#include "../../ui/deadline.h"
 #include "../../ui/dialog.h"
 #include "../../ui/menu.h"
 #include "../../ui/theme_widgets.h"
@@ -17,7 +18,7 @@ static storage_browser_config_t cfg;
 static ui_menu_t *browser_menu = NULL;
 static lv_obj_t *browser_screen = NULL;
 static lv_obj_t *loading_label = NULL;
-static lv_timer_t *init_timer = NULL;
+static int init_deadline = -1;
 
 /* File listing */
 static char **stored_filenames = NULL;
@@ -150,6 +151,13 @@ static void delete_action_cb(int idx) {
                              DIALOG_STYLE_OVERLAY);
 }
 
+/* ---------- Unlock all ---------- */
+
+static void unlock_all_cb(void) {
+  if (cfg.unlock_all)
+    cfg.unlock_all();
+}
+
 /* ---------- Wipe flash ---------- */
 
 static void wipe_flash_cb(void) { wipe_flash_dialog_start(back_cb); }
@@ -171,6 +179,9 @@ static void build_menu(void) {
                                   LV_SYMBOL_TRASH, delete_action_cb);
   }
 
+  if (cfg.unlock_all)
+    ui_menu_add_entry(browser_menu, "Unlock All", unlock_all_cb);
+
   if (cfg.location == STORAGE_FLASH) {
     ui_menu_add_entry(browser_menu, "Wipe Flash", wipe_flash_cb);
     int wipe_idx = ui_menu_get_entry_count(browser_menu) - 1;
@@ -182,9 +193,10 @@ static void build_menu(void) {
 
 /* ---------- Deferred initialization ---------- */
 
-static void deferred_list_cb(lv_timer_t *timer) {
-  (void)timer;
-  init_timer = NULL;
+static void deferred_list_cb(void *user_data) {
+  (void)user_data;
+  ui_deadline_remove(init_deadline);
+  init_deadline = -1;
 
   char **raw_filenames = NULL;
   int raw_count = 0;
@@ -226,8 +238,8 @@ void storage_browser_create(lv_obj_t *parent,
   lv_obj_set_style_text_color(loading_label, primary_color(), 0);
   lv_obj_align(loading_label, LV_ALIGN_CENTER, 0, 0);
 
-  init_timer = lv_timer_create(deferred_list_cb, 50, NULL);
-  lv_timer_set_repeat_count(init_timer, 1);
+  init_deadline = ui_deadline_add(deferred_list_cb, NULL, 0);
+  ui_deadline_arm(init_deadline, 50, 0);
 }
 
 void storage_browser_show(void) {
@@ -248,10 +260,8 @@ storage_location_t storage_browser_get_location(void) { return cfg.location; }
 
 void storage_browser_destroy(void) {
   wipe_flash_dialog_cleanup();
-  if (init_timer) {
-    lv_timer_del(init_timer);
-    init_timer = NULL;
-  }
+  ui_deadline_remove(init_deadline);
+  init_deadline = -1;
   if (browser_menu) {
     ui_menu_destroy(browser_menu);
     browser_menu = NULL;
@@ -26,6 +26,9 @@ typedef struct {
   /* Called when user selects an entry (type-specific load logic) */
   void (*load_selected)(int idx, const char *filename);
 
+  /* Optional "Unlock All" entry: one key for every encrypted entry */
+  void (*unlock_all)(void);
+
   /* Navigation */
   void (*return_cb)(void);
 } storage_browser_config_t;
@@ -25,10 +25,15 @@ static bool target_encrypted;
 /* Descriptor text to save */
 static char *descriptor_text = NULL;
 
-/* Pending save (encrypted path — valid between encrypt success and save) */
+/* Pending save (encrypted path — valid between encrypt success and save).
+ * SD saves get the derived key and stream the envelope to the card; flash
+ * saves get the whole envelope. */
 static const uint8_t *pending_envelope = NULL;
 static size_t pending_envelope_len = 0;
 static const char *pending_id = NULL;
+static const uint8_t *pending_key = NULL;
+static uint8_t pending_version;
+static uint32_t pending_iterations;
 
 /* Plaintext path — ID text input */
 static ui_text_input_t id_input = {0};
@@ -56,19 +61,29 @@ static void show_saved(const char *path) {
                    DIALOG_STYLE_OVERLAY);
 }
 
+static void clear_pending_encrypted(void) {
+  pending_envelope = NULL;
+  pending_envelope_len = 0;
+  pending_id = NULL;
+  pending_key = NULL;
+}
+
 static void do_save_encrypted(void) {
-  esp_err_t ret =
-      storage_save_descriptor(target_location, pending_id, pending_envelope,
-                              pending_envelope_len, true);
+  esp_err_t ret;
+  if (pending_key)
+    ret = storage_save_descriptor_stream(
+        pending_id, pending_key, pending_version, pending_iterations,
+        (const uint8_t *)descriptor_text, strlen(descriptor_text));
+  else
+    ret = storage_save_descriptor(target_location, pending_id,
+                                  pending_envelope, pending_envelope_len, true);
 
   /* Build the path before the cleanup below frees pending_id (page-owned). */
   char path[96];
   storage_descriptor_path(target_location, pending_id, true, path,
                           sizeof(path));
 
-  pending_envelope = NULL;
-  pending_envelope_len = 0;
-  pending_id = NULL;
+  clear_pending_encrypted();
 
   if (progress_dialog) {
     lv_obj_del(progress_dialog);
@@ -115,9 +130,7 @@ static void overwrite_confirm_cb(bool confirmed, void *user_data) {
     }
   } else {
     if (target_encrypted) {
-      pending_envelope = NULL;
-      pending_envelope_len = 0;
-      pending_id = NULL;
+      clear_pending_encrypted();
       if (progress_dialog) {
         lv_obj_del(progress_dialog);
         progress_dialog = NULL;
@@ -165,6 +178,19 @@ static void encrypt_success_cb(const char *id, const uint8_t *envelope,
   lv_timer_set_repeat_count(save_timer, 1);
 }
 
+static void encrypt_stream_cb(const char *id, uint8_t version,
+                              uint32_t iterations, const uint8_t key[32]) {
+  pending_id = id;
+  pending_key = key;
+  pending_version = version;
+  pending_iterations = iterations;
+
+  progress_dialog =
+      dialog_show_progress("KEF", "Saving...", DIALOG_STYLE_OVERLAY);
+  save_timer = lv_timer_create(deferred_save_encrypted_cb, 50, NULL);
+  lv_timer_set_repeat_count(save_timer, 1);
+}
+
 /* ---------- Plaintext path — ID input ---------- */
 
 static void deferred_save_plaintext_cb(lv_timer_t *timer) {
@@ -232,11 +258,16 @@ void store_descriptor_page_create_for_descriptor(
   lv_obj_set_style_text_color(title_label, primary_color(), 0);
   lv_obj_align(title_label, LV_ALIGN_CENTER, 0, 0);
 
-  if (encrypted) {
-    kef_encrypt_page_create(
-        parent, encrypt_return_cb, encrypt_success_cb,
-        (const uint8_t *)descriptor_text, strlen(descriptor_text),
-        descriptor_default_id[0] ? descriptor_default_id : NULL);
+  const char *suggested_id =
+      descriptor_default_id[0] ? descriptor_default_id : NULL;
+  if (encrypted && location == STORAGE_SD) {
+    /* Streamed to the card: the envelope is never held in memory. */
+    kef_encrypt_page_create_stream(parent, encrypt_return_cb,
+                                   encrypt_stream_cb, suggested_id);
+  } else if (encrypted) {
+    kef_encrypt_page_create(parent, encrypt_return_cb, encrypt_success_cb,
+                            (const uint8_t *)descriptor_text,
+                            strlen(descriptor_text), suggested_id);
   } else {
     /* Show ID text input for plaintext save */
     ui_text_input_create(&id_input, parent, "Descriptor name", false,
@@ -279,9 +310,7 @@ void store_descriptor_page_destroy(void) {
     id_input_created = false;
   }
 
-  pending_envelope = NULL;
-  pending_envelope_len = 0;
-  pending_id = NULL;
+  clear_pending_encrypted();
   pending_plaintext_id[0] = '\0';
   descriptor_default_id[0] = '\0';
 
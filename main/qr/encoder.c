@@ -1,4 +1,5 @@
 #include "encoder.h"
+#include "../utils/secure_mem.h"
 #include "src/libs/qrcode/qrcodegen.h"
 #include "src/misc/cache/instance/lv_image_cache.h"
 #include <ctype.h>
@@ -8,6 +9,7 @@
 #include <string.h>
 #include <wally_bip39.h>
 #include <wally_core.h>
+#include <wally_crypto.h>
 
 _Static_assert(QR_CODE_BUF_LEN == qrcodegen_BUFFER_LEN_MAX,
                "QR_CODE_BUF_LEN must match qrcodegen_BUFFER_LEN_MAX");
@@ -78,6 +80,19 @@ static void qr_blit_region(lv_obj_t *qr_obj, const uint8_t *qr_buf, int x0,
   lv_obj_invalidate(qr_obj);
 }
 
+// Draw a whole encoded QR to fill the canvas, as qr_update_* do.
+static void qr_blit_full(lv_obj_t *qr_obj, const lv_draw_buf_t *draw_buf,
+                         const uint8_t *qr_buf, int modules,
+                         qr_encode_result_t *result) {
+  int32_t scale = draw_buf->header.w / modules;
+  if (result) {
+    result->modules = modules;
+    result->scale = scale;
+  }
+
+  qr_blit_region(qr_obj, qr_buf, 0, 0, modules, modules, scale, modules, 0, 0);
+}
+
 void qr_set_light_color(lv_obj_t *qr_obj, lv_color_t color) {
   if (!qr_obj)
     return;
@@ -446,13 +461,7 @@ lv_result_t qr_update_binary(lv_obj_t *qr_obj, const unsigned char *data,
     return LV_RESULT_INVALID;
   }
 
-  int32_t scale = draw_buf->header.w / modules;
-  if (result) {
-    result->modules = modules;
-    result->scale = scale;
-  }
-
-  qr_blit_region(qr_obj, qr_buf, 0, 0, modules, modules, scale, modules, 0, 0);
+  qr_blit_full(qr_obj, draw_buf, qr_buf, modules, result);
   free(qr_buf);
   return LV_RESULT_OK;
 }
@@ -545,13 +554,7 @@ lv_result_t qr_update_optimal(lv_obj_t *qr_obj, const char *text,
     return LV_RESULT_INVALID;
   }
 
-  int32_t scale = draw_buf->header.w / modules;
-  if (result) {
-    result->modules = modules;
-    result->scale = scale;
-  }
-
-  qr_blit_region(qr_obj, qr_buf, 0, 0, modules, modules, scale, modules, 0, 0);
+  qr_blit_full(qr_obj, draw_buf, qr_buf, modules, result);
   free(qr_buf);
   return LV_RESULT_OK;
 }
@@ -578,3 +581,219 @@ void qr_draw_region(lv_obj_t *qr_obj, const uint8_t *qr_buf, int x0, int y0,
 
   qr_blit_region(qr_obj, qr_buf, x0, y0, w, h, scale, cell, ofs_x, ofs_y);
 }
+
+/* ---------- Encode cache ---------- */
+
+// Enough for every format a backup page offers; renders count each format
+// once per widget size.
+#define QR_CACHE_ENCODES 4
+#define QR_CACHE_RENDERS 8
+
+typedef struct {
+  bool used;
+  bool binary; // qr_encode_binary rather than qr_encode_optimal
+  uint8_t hash[SHA256_LEN];
+  uint32_t last_use;
+} qr_cache_key_t;
+
+typedef struct {
+  qr_cache_key_t key;
+  int modules;
+  uint8_t qr_buf[QR_CODE_BUF_LEN];
+} qr_cache_encode_t;
+
+// The I1 pixels after the palette; the palette is reset on restore, as a blit
+// does, so a light color set on top still has to be re-applied.
+typedef struct {
+  qr_cache_key_t key;
+  uint32_t w, h, stride;
+  qr_encode_result_t result;
+  uint8_t *bits;
+  size_t bits_len;
+} qr_cache_render_t;
+
+struct qr_cache {
+  uint32_t clock;
+  qr_cache_encode_t encodes[QR_CACHE_ENCODES];
+  qr_cache_render_t renders[QR_CACHE_RENDERS];
+};
+
+qr_cache_t *qr_cache_create(void) { return calloc(1, sizeof(qr_cache_t)); }
+
+void qr_cache_destroy(qr_cache_t *cache) {
+  if (!cache)
+    return;
+  for (int i = 0; i < QR_CACHE_RENDERS; i++)
+    SECURE_FREE_BUFFER(cache->renders[i].bits, cache->renders[i].bits_len);
+  secure_memzero(cache, sizeof(*cache));
+  free(cache);
+}
+
+static bool qr_cache_key(bool binary, const uint8_t *payload, size_t len,
+                         qr_cache_key_t *key) {
+  memset(key, 0, sizeof(*key));
+  key->binary = binary;
+  return payload && len > 0 &&
+         wally_sha256(payload, len, key->hash, SHA256_LEN) == WALLY_OK;
+}
+
+static bool qr_cache_key_matches(const qr_cache_key_t *entry,
+                                 const qr_cache_key_t *key) {
+  return entry->used && entry->binary == key->binary &&
+         memcmp(entry->hash, key->hash, SHA256_LEN) == 0;
+}
+
+// Empty slots go first, then the least recently used.
+static bool qr_cache_better_victim(const qr_cache_key_t *entry,
+                                   const qr_cache_key_t *victim) {
+  return victim->used &&
+         (!entry->used || entry->last_use < victim->last_use);
+}
+
+static const qr_cache_encode_t *qr_cache_encode(qr_cache_t *cache,
+                                                const qr_cache_key_t *key,
+                                                const uint8_t *payload,
+                                                size_t len) {
+  qr_cache_encode_t *victim = &cache->encodes[0];
+  for (int i = 0; i < QR_CACHE_ENCODES; i++) {
+    qr_cache_encode_t *e = &cache->encodes[i];
+    if (qr_cache_key_matches(&e->key, key)) {
+      e->key.last_use = ++cache->clock;
+      return e;
+    }
+    if (qr_cache_better_victim(&e->key, &victim->key))
+      victim = e;
+  }
+
+  secure_memzero(victim, sizeof(*victim));
+  int modules = key->binary
+                    ? qr_encode_binary(payload, len, victim->qr_buf)
+                    : qr_encode_optimal((const char *)payload, victim->qr_buf);
+  if (modules <= 0) {
+    secure_memzero(victim, sizeof(*victim));
+    return NULL;
+  }
+  victim->key = *key;
+  victim->key.used = true;
+  victim->key.last_use = ++cache->clock;
+  victim->modules = modules;
+  return victim;
+}
+
+static void qr_cache_keep_render(qr_cache_t *cache, qr_cache_render_t *r,
+                                 const qr_cache_key_t *key,
+                                 const lv_draw_buf_t *draw_buf,
+                                 const qr_encode_result_t *result) {
+  size_t bits_len = (size_t)draw_buf->header.stride * draw_buf->header.h;
+  SECURE_FREE_BUFFER(r->bits, r->bits_len);
+  secure_memzero(r, sizeof(*r));
+  if (bits_len == 0 || draw_buf->data_size < 8 + bits_len)
+    return;
+
+  // Failing here only costs the next redraw its shortcut.
+  r->bits = malloc(bits_len);
+  if (!r->bits)
+    return;
+  memcpy(r->bits, draw_buf->data + 8, bits_len);
+  r->bits_len = bits_len;
+  r->key = *key;
+  r->key.used = true;
+  r->key.last_use = ++cache->clock;
+  r->w = draw_buf->header.w;
+  r->h = draw_buf->header.h;
+  r->stride = draw_buf->header.stride;
+  r->result = *result;
+}
+
+static void qr_cache_restore_render(lv_obj_t *qr_obj, lv_draw_buf_t *draw_buf,
+                                    const qr_cache_render_t *r) {
+  lv_canvas_set_palette(qr_obj, 0,
+                        lv_color_to_32(lv_color_white(), LV_OPA_COVER));
+  lv_canvas_set_palette(qr_obj, 1,
+                        lv_color_to_32(lv_color_black(), LV_OPA_COVER));
+  memcpy(draw_buf->data + 8, r->bits, r->bits_len);
+  lv_image_cache_drop(draw_buf);
+  lv_obj_invalidate(qr_obj);
+}
+
+static lv_result_t qr_cache_update(qr_cache_t *cache, lv_obj_t *qr_obj,
+                                   bool binary, const uint8_t *payload,
+                                   size_t len, qr_encode_result_t *result) {
+  lv_draw_buf_t *draw_buf = qr_obj ? lv_canvas_get_draw_buf(qr_obj) : NULL;
+  qr_cache_key_t key;
+  if (!draw_buf || !qr_cache_key(binary, payload, len, &key))
+    return LV_RESULT_INVALID;
+
+  qr_cache_render_t *victim = &cache->renders[0];
+  for (int i = 0; i < QR_CACHE_RENDERS; i++) {
+    qr_cache_render_t *r = &cache->renders[i];
+    if (qr_cache_key_matches(&r->key, &key) && r->w == draw_buf->header.w &&
+        r->h == draw_buf->header.h && r->stride == draw_buf->header.stride) {
+      r->key.last_use = ++cache->clock;
+      qr_cache_restore_render(qr_obj, draw_buf, r);
+      if (result)
+        *result = r->result;
+      return LV_RESULT_OK;
+    }
+    if (qr_cache_better_victim(&r->key, &victim->key))
+      victim = r;
+  }
+
+  const qr_cache_encode_t *e = qr_cache_encode(cache, &key, payload, len);
+  secure_memzero(&key.hash, sizeof(key.hash));
+  if (!e)
+    return LV_RESULT_INVALID;
+
+  qr_encode_result_t drawn;
+  qr_blit_full(qr_obj, draw_buf, e->qr_buf, e->modules, &drawn);
+  qr_cache_keep_render(cache, victim, &e->key, draw_buf, &drawn);
+  if (result)
+    *result = drawn;
+  return LV_RESULT_OK;
+}
+
+lv_result_t qr_cache_update_optimal(qr_cache_t *cache, lv_obj_t *qr_obj,
+                                    const char *text,
+                                    qr_encode_result_t *result) {
+  if (!cache)
+    return qr_update_optimal(qr_obj, text, result);
+  return qr_cache_update(cache, qr_obj, false, (const uint8_t *)text,
+                         text ? strlen(text) : 0, result);
+}
+
+lv_result_t qr_cache_update_binary(qr_cache_t *cache, lv_obj_t *qr_obj,
+                                   const unsigned char *data, size_t len,
+                                   qr_encode_result_t *result) {
+  if (!cache)
+    return qr_update_binary(qr_obj, data, len, result);
+  return qr_cache_update(cache, qr_obj, true, data, len, result);
+}
+
+static const uint8_t *qr_cache_modules(qr_cache_t *cache, bool binary,
+                                       const uint8_t *payload, size_t len,
+                                       int *modules_out) {
+  qr_cache_key_t key;
+  if (!modules_out)
+    return NULL;
+  *modules_out = 0;
+  if (!cache || !qr_cache_key(binary, payload, len, &key))
+    return NULL;
+
+  const qr_cache_encode_t *e = qr_cache_encode(cache, &key, payload, len);
+  secure_memzero(&key.hash, sizeof(key.hash));
+  if (!e)
+    return NULL;
+  *modules_out = e->modules;
+  return e->qr_buf;
+}
+
+const uint8_t *qr_cache_encode_optimal(qr_cache_t *cache, const char *text,
+                                       int *modules_out) {
+  return qr_cache_modules(cache, false, (const uint8_t *)text,
+                          text ? strlen(text) : 0, modules_out);
+}
+
+const uint8_t *qr_cache_encode_binary(qr_cache_t *cache, const uint8_t *data,
+                                      size_t len, int *modules_out) {
+  return qr_cache_modules(cache, true, data, len, modules_out);
+}
@@ -127,6 +127,52 @@ int32_t qr_module_scale(lv_obj_t *qr_obj, int cell);
 void qr_draw_region(lv_obj_t *qr_obj, const uint8_t *qr_buf, int x0, int y0,
                     int w, int h, int cell, int32_t ofs_x, int32_t ofs_y);
 
+/**
+ * @brief Cache of encoded and drawn QR codes, owned by one page.
+ *
+ * Pages that show the same payloads again and again (a format, view or
+ * policy switched back and forth) keep one so each payload is encoded once
+ * and drawn once per widget size; later updates copy the drawing back into
+ * the canvas. ECC, version and mask are fixed by the encoder, so entries are
+ * keyed by encode mode and a SHA-256 of the payload, never the payload
+ * itself. Everything, module buffers and drawings included, is wiped by
+ * qr_cache_destroy(), so pages showing a seed may use one too.
+ */
+typedef struct qr_cache qr_cache_t;
+
+/** @brief Allocate an empty cache. Returns NULL when out of memory. */
+KERN_WARN_UNUSED_RESULT qr_cache_t *qr_cache_create(void);
+
+/** @brief Wipe and free a cache. Safe on NULL. */
+void qr_cache_destroy(qr_cache_t *cache);
+
+/**
+ * @brief qr_update_optimal / qr_update_binary through a cache.
+ *
+ * Same drawing and result as the uncached calls, palette reset included, so
+ * a light color is re-applied the same way. A NULL cache falls back to them.
+ */
+lv_result_t qr_cache_update_optimal(qr_cache_t *cache, lv_obj_t *qr_obj,
+                                    const char *text,
+                                    qr_encode_result_t *result);
+lv_result_t qr_cache_update_binary(qr_cache_t *cache, lv_obj_t *qr_obj,
+                                   const unsigned char *data, size_t len,
+                                   qr_encode_result_t *result);
+
+/**
+ * @brief qr_encode_optimal / qr_encode_binary through a cache.
+ *
+ * Returns the cache's module buffer, for qr_draw_region(), or NULL on
+ * failure (0 modules). The buffer stays the cache's: it is valid until the
+ * next call on the cache, which may reuse it for another payload.
+ *
+ * @param modules_out Receives the module count (side length)
+ */
+const uint8_t *qr_cache_encode_optimal(qr_cache_t *cache, const char *text,
+                                       int *modules_out);
+const uint8_t *qr_cache_encode_binary(qr_cache_t *cache, const uint8_t *data,
+                                      size_t len, int *modules_out);
+
 /**
  * @brief Uppercase a bech32 string for QR alphanumeric mode
  *
@@ -1,6 +1,8 @@
 #include "parser.h"
 #include "../../components/bbqr/src/bbqr.h"
 #include "../../components/cUR/src/ur_decoder.h"
+#include "../utils/perf.h"
+#include "../utils/secure_mem.h"
 #include <ctype.h>
 #include <math.h>
 #include <stdio.h>
@@ -20,8 +22,9 @@ static const int QR_CAPACITY_ALPHANUMERIC[] = {
 
 // Helper function prototypes
 static int detect_format(const char *data, BBQrCode **bbqr);
-static bool parse_pmofn_qr_part(const char *data, char **part, int *index,
-                                int *total);
+static bool parse_pmofn_qr_part(const char *data, size_t data_len,
+                                const char **part, size_t *part_len,
+                                int *index, int *total);
 static bool starts_with_case_insensitive(const char *str, const char *prefix);
 static int max_qr_bytes(int max_width, const char *encoding);
 static void find_min_num_parts(const char *data, size_t data_len, int max_width,
@@ -35,8 +38,11 @@ QRPartParser *qr_parser_create(void) {
   if (!parser)
     return NULL;
 
+  // Parts, their data and the parts array all live in the parser's arena
+  arena_init(&parser->arena, QR_PARSER_ARENA_CHUNK_SIZE, ARENA_MEM_PSRAM);
   parser->parts_capacity = 10;
-  parser->parts = (QRPart **)calloc(parser->parts_capacity, sizeof(QRPart *));
+  parser->parts = (QRPart **)arena_calloc(
+      &parser->arena, parser->parts_capacity, sizeof(QRPart *));
   if (!parser->parts) {
     free(parser);
     return NULL;
@@ -51,15 +57,7 @@ void qr_parser_destroy(QRPartParser *parser) {
   if (!parser)
     return;
 
-  if (parser->parts) {
-    for (int i = 0; i < parser->parts_count; i++) {
-      if (parser->parts[i]) {
-        free(parser->parts[i]->data);
-        free(parser->parts[i]);
-      }
-    }
-    free(parser->parts);
-  }
+  arena_destroy(&parser->arena);
 
   if (parser->bbqr) {
     free(parser->bbqr->payload);
@@ -99,15 +97,24 @@ int qr_parser_total_count(QRPartParser *parser) {
   return parser->total;
 }
 
+static bool has_part(const QRPartParser *parser, int index) {
+  for (int i = 0; i < parser->parts_count; i++) {
+    if (parser->parts[i]->index == index)
+      return true;
+  }
+  return false;
+}
+
 static bool add_part(QRPartParser *parser, int index, const char *data,
                      size_t data_len) {
   // Resize if needed
   if (parser->parts_count >= parser->parts_capacity) {
     int new_capacity = parser->parts_capacity * 2;
-    QRPart **new_parts =
-        (QRPart **)realloc(parser->parts, new_capacity * sizeof(QRPart *));
+    QRPart **new_parts = (QRPart **)arena_alloc(
+        &parser->arena, new_capacity * sizeof(QRPart *));
     if (!new_parts)
       return false;
+    memcpy(new_parts, parser->parts, parser->parts_count * sizeof(QRPart *));
     parser->parts = new_parts;
     parser->parts_capacity = new_capacity;
   }
@@ -115,31 +122,31 @@ static bool add_part(QRPartParser *parser, int index, const char *data,
   // Check if part already exists
   for (int i = 0; i < parser->parts_count; i++) {
     if (parser->parts[i]->index == index) {
-      // Update existing part
-      free(parser->parts[i]->data);
-      parser->parts[i]->data = (char *)malloc(data_len + 1);
-      if (!parser->parts[i]->data)
+      // A repeat of a part we hold is the common case while scanning a loop
+      if (parser->parts[i]->data_len == data_len &&
+          memcmp(parser->parts[i]->data, data, data_len) == 0)
+        return true;
+      // Update existing part; the old copy is wiped now and its space
+      // returned with the arena
+      char *copy = arena_strndup(&parser->arena, data, data_len);
+      if (!copy)
         return false;
-      memcpy(parser->parts[i]->data, data, data_len);
-      parser->parts[i]->data[data_len] = '\0';
+      secure_memzero(parser->parts[i]->data, parser->parts[i]->data_len);
+      parser->parts[i]->data = copy;
       parser->parts[i]->data_len = data_len;
       return true;
     }
   }
 
   // Add new part
-  QRPart *part = (QRPart *)calloc(1, sizeof(QRPart));
+  QRPart *part = (QRPart *)arena_alloc(&parser->arena, sizeof(QRPart));
   if (!part)
     return false;
 
   part->index = index;
-  part->data = (char *)malloc(data_len + 1);
-  if (!part->data) {
-    free(part);
+  part->data = arena_strndup(&parser->arena, data, data_len);
+  if (!part->data)
     return false;
-  }
-  memcpy(part->data, data, data_len);
-  part->data[data_len] = '\0';
   part->data_len = data_len;
 
   parser->parts[parser->parts_count++] = part;
@@ -160,12 +167,13 @@ int qr_parser_parse_with_len(QRPartParser *parser, const char *data,
     add_part(parser, 1, data, data_len);
     parser->total = 1;
   } else if (parser->format == FORMAT_PMOFN) {
-    char *part = NULL;
+    const char *part;
+    size_t part_len;
     int index, total;
-    if (parse_pmofn_qr_part(data, &part, &index, &total)) {
-      add_part(parser, index, part, strlen(part));
+    if (parse_pmofn_qr_part(data, data_len, &part, &part_len, &index,
+                            &total)) {
+      add_part(parser, index, part, part_len);
       parser->total = total;
-      free(part);
       return index - 1;
     }
   } else if (parser->format == FORMAT_UR) {
@@ -199,6 +207,76 @@ int qr_parser_parse_with_len(QRPartParser *parser, const char *data,
   return -1;
 }
 
+// Header-only lookup: the index qr_parser_parse_with_len() would return for
+// a part already stored, or -1.
+static int known_part_index(const QRPartParser *parser, const char *data,
+                            size_t data_len) {
+  if (parser->format == FORMAT_BBQR) {
+    BBQrPart part;
+    if (bbqr_parse_part(data, data_len, &part) &&
+        part.total == parser->total && has_part(parser, part.index))
+      return part.index;
+  } else if (parser->format == FORMAT_PMOFN) {
+    const char *space_pos = memchr(data, ' ', data_len);
+    if (data_len < 2 || data[0] != 'p' || !space_pos)
+      return -1;
+    const char *of_pos = strstr(data, "of");
+    if (!of_pos || of_pos >= space_pos)
+      return -1;
+    int index = atoi(data + 1);
+    if (atoi(of_pos + 2) == parser->total && has_part(parser, index))
+      return index - 1;
+  }
+  return -1;
+}
+
+bool qr_parser_is_known_part(QRPartParser *parser, const char *data,
+                             size_t data_len) {
+  if (!parser || !data)
+    return false;
+  return known_part_index(parser, data, data_len) >= 0;
+}
+
+int qr_parser_parse_batch(QRPartParser *parser, const QRPayload *payloads,
+                          int count, int *indices_out) {
+  int parts_new = 0;
+  for (int i = 0; i < count; i++) {
+    if (indices_out)
+      indices_out[i] = -1;
+  }
+
+  for (int i = 0; i < count; i++) {
+    const QRPayload *payload = &payloads[i];
+    if (qr_parser_is_complete(parser) || qr_parser_is_failed(parser))
+      break;
+
+    bool repeated = false;
+    for (int j = 0; j < i && !repeated; j++) {
+      repeated =
+          payloads[j].data_len == payload->data_len &&
+          memcmp(payloads[j].data, payload->data, payload->data_len) == 0;
+    }
+    if (repeated)
+      continue;
+    int known = known_part_index(parser, payload->data, payload->data_len);
+    if (known >= 0) {
+      if (indices_out)
+        indices_out[i] = known;
+      continue;
+    }
+
+    int parsed_before = qr_parser_parsed_count(parser);
+    int index = qr_parser_parse_with_len(parser, payload->data,
+                                         payload->data_len);
+    if (indices_out)
+      indices_out[i] = index;
+    if (qr_parser_parsed_count(parser) > parsed_before)
+      parts_new++;
+  }
+  PERF_ADD(PERF_CTR_PARTS_PARSED, (uint32_t)parts_new);
+  return parts_new;
+}
+
 bool qr_parser_is_failed(QRPartParser *parser) {
   if (parser->format == FORMAT_UR && parser->ur_decoder) {
     ur_decoder_state_t state =
@@ -400,8 +478,10 @@ static int detect_format(const char *data, BBQrCode **bbqr) {
   return FORMAT_NONE;
 }
 
-static bool parse_pmofn_qr_part(const char *data, char **part, int *index,
-                                int *total) {
+// The part data is returned in place, as the tail of data after the header.
+static bool parse_pmofn_qr_part(const char *data, size_t data_len,
+                                const char **part, size_t *part_len,
+                                int *index, int *total) {
   const char *of_pos = strstr(data, "of");
   const char *space_pos = strchr(data, ' ');
 
@@ -414,13 +494,9 @@ static bool parse_pmofn_qr_part(const char *data, char **part, int *index,
   // Parse total
   *total = atoi(of_pos + 2);
 
-  // Extract part data (after space)
-  size_t part_len = strlen(space_pos + 1);
-  *part = (char *)malloc(part_len + 1);
-  if (!*part)
-    return false;
-  memcpy(*part, space_pos + 1, part_len);
-  (*part)[part_len] = '\0';
+  // Part data (after space)
+  *part = space_pos + 1;
+  *part_len = strnlen(*part, data + data_len - *part);
 
   return true;
 }
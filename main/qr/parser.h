@@ -1,6 +1,7 @@
 #ifndef QR_PARSER_H
 #define QR_PARSER_H
 
+#include "../utils/arena.h"
 #include "../utils/attributes.h"
 
 #include <stdbool.h>
@@ -31,6 +32,11 @@
  */
 #define QR_CAPACITY_SIZE 20
 
+/**
+ * @brief Arena chunk size for a parser's parts (a few dozen typical parts)
+ */
+#define QR_PARSER_ARENA_CHUNK_SIZE 4096
+
 /**
  * @brief Structure to hold a single QR part
  */
@@ -49,6 +55,14 @@ typedef struct {
   char *payload;  /**< Decoded payload */
 } BBQrCode;
 
+/**
+ * @brief One decoded QR payload, as handed to qr_parser_parse_batch()
+ */
+typedef struct {
+  const char *data; /**< Payload bytes, NUL-terminated */
+  size_t data_len;  /**< Payload length, excluding the terminator */
+} QRPayload;
+
 /**
  * @brief Main QR Parser structure
  *
@@ -63,6 +77,7 @@ typedef struct {
   int format;         /**< Detected QR format (FORMAT_* constants) */
   BBQrCode *bbqr;     /**< BBQr specific data (if format is BBQR) */
   void *ur_decoder;   /**< UR decoder instance (if format is UR) */
+  arena_t arena;      /**< Backs parts, their data and the parts array */
 } QRPartParser;
 
 /**
@@ -146,6 +161,42 @@ KERN_WARN_UNUSED_RESULT int qr_parser_parse_with_len(QRPartParser *parser,
                                                      const char *data,
                                                      size_t data_len);
 
+/**
+ * @brief Check whether a payload is a part the parser already holds
+ *
+ * Reads only the part header (P M-of-N and BBQr) and never allocates, so a
+ * scanner can skip re-parsing parts it keeps seeing. Always false for UR,
+ * whose fountain decoder de-duplicates on its own, and before the format is
+ * known.
+ *
+ * @param parser Parser instance
+ * @param data QR code data
+ * @param data_len Length of the data in bytes
+ * @return true if a part with the same index is already stored
+ */
+KERN_WARN_UNUSED_RESULT bool qr_parser_is_known_part(QRPartParser *parser,
+                                                     const char *data,
+                                                     size_t data_len);
+
+/**
+ * @brief Parse every QR code decoded from one frame
+ *
+ * Skips payloads repeated within the batch and parts the parser already
+ * holds, feeds the rest in order, and stops early once the sequence is
+ * complete or has failed.
+ *
+ * @param parser Parser instance
+ * @param payloads Decoded payloads
+ * @param count Number of payloads
+ * @param indices_out Optional, `count` entries: the part index of each payload
+ *        (as qr_parser_parse_with_len() returns it, including for parts
+ *        already held), or -1 if it repeated an earlier payload, was
+ *        rejected, or was not reached
+ * @return Number of parts that were new to the parser
+ */
+int qr_parser_parse_batch(QRPartParser *parser, const QRPayload *payloads,
+                          int count, int *indices_out);
+
 /**
  * @brief Check if all expected parts have been received
  *
@@ -2,17 +2,23 @@
 
 #include "scanner.h"
 #include "../components/cUR/src/ur_decoder.h"
+#include "../components/video/video_recorder.h"
 #include "../core/entropy_pool.h"
 #include "../core/settings.h"
+#include "../ui/deadline.h"
 #include "../ui/dialog.h"
 #include "../ui/input_helpers.h"
 #include "../ui/theme_widgets.h"
+#include "../ui/video_view.h"
 #include "../utils/memory_utils.h"
+#include "../utils/perf.h"
+#include "../utils/power_gov.h"
 #include "../utils/secure_mem.h"
 #include "parser.h"
 #include <bsp/esp-bsp.h>
 #include <driver/ppa.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <freertos/semphr.h>
@@ -52,12 +58,19 @@
 #define PROGRESS_BAR_HEIGHT 20
 #define PROGRESS_FRAME_PADD 2
 #define PROGRESS_BLOC_PAD 1
-#define PROGRESS_UPDATE_INTERVAL_MS 50
 #define QR_ROI_MARGIN_PERCENT 20
 #define QR_ROI_MIN_SIZE 64
 #define QR_ROI_SIZE_QUANTUM 16
 #define QR_ROI_SHRINK_HYSTERESIS (2 * QR_ROI_SIZE_QUANTUM)
 #define QR_ROI_FAILED_DECODE_LIMIT 10
+// While a multi-part scan is incomplete, an ROI that keeps yielding only parts
+// we already hold gets one full-frame pass after this many frames, so parts
+// shown beside the tracked one (a coordinator's grid, a printed sheet) are
+// still found.
+#define QR_ROI_FULL_FRAME_PROBE_FRAMES 8
+// Every code k_quirc finds in a frame is decoded and parsed as one batch.
+#define QR_MAX_CODES_PER_FRAME 8
+#define QR_PAYLOAD_SLOT_SIZE (sizeof(((k_quirc_result_t *)0)->data.payload))
 // While the settings overlay is open, only every Nth camera frame is
 // processed so PPA work and full-image LVGL invalidations don't starve
 // touch handling; the preview still updates enough to judge exposure.
@@ -69,6 +82,9 @@
 #define RGB565_RED_LEVELS (1 << RGB565_RED_BITS)
 #define RGB565_GREEN_LEVELS (1 << RGB565_GREEN_BITS)
 #define RGB565_BLUE_LEVELS (1 << RGB565_BLUE_BITS)
+#if CONFIG_VIDEO_PREVIEW_STATS
+#define PREVIEW_STATS_INTERVAL_US (5 * 1000 * 1000)
+#endif
 
 typedef enum {
   CAMERA_EVENT_TASK_RUN = BIT(0),
@@ -95,8 +111,17 @@ typedef struct {
   uint32_t width;
   uint32_t height;
   uint8_t failed_decodes;
+  uint8_t stale_frames;
 } qr_decode_roi_t;
 
+// Bounding box of the codes decoded in one frame, in decode-buffer pixels.
+typedef struct {
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+} qr_decode_box_t;
+
 static const char *TAG = "QR_SCANNER";
 
 static lv_obj_t *qr_scanner_screen = NULL;
@@ -111,6 +136,8 @@ static void (*return_callback)(void) = NULL;
 
 static lv_img_dsc_t img_refresh_dsc;
 static EventGroupHandle_t camera_event_group = NULL;
+// POWER_ACT_SCANNING held from stream start to teardown.
+static bool holds_scanning = false;
 
 static uint8_t *display_buffer_a = NULL;
 static uint8_t *display_buffer_b = NULL;
@@ -137,6 +164,9 @@ static QueueHandle_t qr_progress_queue = NULL;
 static QueueHandle_t qr_buffer_return_queue = NULL;
 static SemaphoreHandle_t qr_task_done_sem = NULL;
 static QRPartParser *qr_parser = NULL;
+// Copies of one frame's decoded payloads (QR_MAX_CODES_PER_FRAME slots,
+// PSRAM); wiped after every batch since they may hold a mnemonic.
+static char *qr_batch_storage = NULL;
 static int previously_parsed = -1;
 
 // Direct RGB565-to-grayscale lookup table (64KB, initialized once)
@@ -161,7 +191,20 @@ static volatile bool settings_active = false;
 static ppa_client_handle_t cam_ppa_client = NULL;
 
 static volatile int active_frame_operations = 0;
-static lv_timer_t *completion_timer = NULL;
+// Progress and the scan result are pushed, not polled: the frame operation,
+// already holding the display lock for its swap, arms this deadline when the
+// decoder has left something for the UI.
+static int completion_deadline = -1;
+static volatile bool progress_pending = false;
+
+static volatile qr_scanner_frame_observer_t frame_observer = NULL;
+
+#if CONFIG_VIDEO_PREVIEW_STATS
+static int64_t stats_window_start = 0;
+static uint32_t stats_frames = 0;
+static uint32_t stats_layer_frames = 0;
+static configRUN_TIME_COUNTER_TYPE stats_decode_start = 0;
+#endif
 
 static void touch_event_cb(lv_event_t *e);
 static void camera_video_frame_operation(uint8_t *camera_buf,
@@ -177,7 +220,7 @@ static void rgb565_region_to_grayscale(const uint8_t *rgb565_data,
                                        uint32_t region_y, uint32_t region_width,
                                        uint32_t region_height);
 static void update_decode_roi(qr_decode_roi_t *roi,
-                              const k_quirc_result_t *result,
+                              const qr_decode_box_t *box,
                               uint32_t decode_origin_x,
                               uint32_t decode_origin_y, uint32_t frame_width,
                               uint32_t frame_height);
@@ -299,13 +342,14 @@ static void process_pending_progress_update(void) {
   if (!qr_progress_queue)
     return;
 
+  progress_pending = false;
   qr_progress_update_t update;
   while (xQueueReceive(qr_progress_queue, &update, 0) == pdTRUE) {
     if (closing || destruction_in_progress || !qr_scanner_screen)
       return;
 
-    // This runs from an LVGL timer, so progress objects can be mutated without
-    // taking the display lock from the decoder task.
+    // This runs from a UI deadline, so progress objects can be mutated
+    // without taking the display lock from the decoder task.
     if (update.format == FORMAT_UR) {
       if (!ur_progress_bar)
         create_ur_progress_bar();
@@ -323,14 +367,15 @@ static void process_pending_progress_update(void) {
   }
 }
 
-static void completion_timer_cb(lv_timer_t *timer) {
+static void completion_cb(void *user_data) {
+  (void)user_data;
   process_pending_progress_update();
 
   if ((scan_completed || scan_failed) && return_callback && !closing &&
       !destruction_in_progress) {
     closing = true;
-    lv_timer_del(completion_timer);
-    completion_timer = NULL;
+    ui_deadline_remove(completion_deadline);
+    completion_deadline = -1;
 
     if (camera_event_group)
       xEventGroupClearBits(camera_event_group, CAMERA_EVENT_TASK_RUN);
@@ -553,30 +598,41 @@ static void rgb565_region_to_grayscale(const uint8_t *rgb565_data,
   }
 }
 
+static void extend_decode_box(qr_decode_box_t *box, bool *has_box,
+                              const k_quirc_result_t *result) {
+  for (int i = 0; i < 4; i++) {
+    int x = result->corners[i].x;
+    int y = result->corners[i].y;
+    if (!*has_box) {
+      *box = (qr_decode_box_t){x, y, x, y};
+      *has_box = true;
+      continue;
+    }
+    if (x < box->min_x)
+      box->min_x = x;
+    if (x > box->max_x)
+      box->max_x = x;
+    if (y < box->min_y)
+      box->min_y = y;
+    if (y > box->max_y)
+      box->max_y = y;
+  }
+}
+
+// Centers the ROI on every code decoded this frame. When the codes are spread
+// too far apart for a square ROI smaller than the frame, the ROI is dropped
+// and decoding falls back to the full frame.
 static void update_decode_roi(qr_decode_roi_t *roi,
-                              const k_quirc_result_t *result,
+                              const qr_decode_box_t *box,
                               uint32_t decode_origin_x,
                               uint32_t decode_origin_y, uint32_t frame_width,
                               uint32_t frame_height) {
   roi->failed_decodes = 0;
 
-  int min_x = result->corners[0].x;
-  int max_x = result->corners[0].x;
-  int min_y = result->corners[0].y;
-  int max_y = result->corners[0].y;
-  for (int i = 1; i < 4; i++) {
-    if (result->corners[i].x < min_x)
-      min_x = result->corners[i].x;
-    if (result->corners[i].x > max_x)
-      max_x = result->corners[i].x;
-    if (result->corners[i].y < min_y)
-      min_y = result->corners[i].y;
-    if (result->corners[i].y > max_y)
-      max_y = result->corners[i].y;
-  }
-
-  int qr_width = max_x - min_x + 1;
-  int qr_height = max_y - min_y + 1;
+  int min_x = box->min_x;
+  int min_y = box->min_y;
+  int qr_width = box->max_x - box->min_x + 1;
+  int qr_height = box->max_y - box->min_y + 1;
   if (qr_width <= 0 || qr_height <= 0 || frame_width == 0 || frame_height == 0)
     return;
 
@@ -615,7 +671,10 @@ static void update_decode_roi(qr_decode_roi_t *roi,
   if ((uint32_t)origin_y + target_side > frame_height)
     origin_y = (int)(frame_height - target_side);
 
+  bool was_active = roi->active;
   roi->active = target_side < frame_width || target_side < frame_height;
+  if (!was_active)
+    roi->stale_frames = 0;
   roi->x = (uint32_t)origin_x;
   roi->y = (uint32_t)origin_y;
   roi->width = target_side;
@@ -643,6 +702,18 @@ static void release_decode_frame(uint8_t *frame_buffer) {
     xQueueSend(qr_buffer_return_queue, &frame_buffer, 0);
 }
 
+// Never blocks the decoder: a full queue sheds its oldest update.
+static void publish_progress(qr_progress_update_t update) {
+  if (!qr_progress_queue)
+    return;
+  if (xQueueSend(qr_progress_queue, &update, 0) != pdTRUE) {
+    qr_progress_update_t stale_update;
+    xQueueReceive(qr_progress_queue, &stale_update, 0);
+    xQueueSend(qr_progress_queue, &update, 0);
+  }
+  progress_pending = true;
+}
+
 static void qr_decode_task(void *pvParameters) {
   qr_frame_data_t frame_data;
   k_quirc_result_t qr_result;
@@ -669,10 +740,15 @@ static void qr_decode_task(void *pvParameters) {
       continue;
     }
 
-    uint32_t decode_x = roi.active ? roi.x : 0;
-    uint32_t decode_y = roi.active ? roi.y : 0;
-    uint32_t decode_width = roi.active ? roi.width : frame_data.width;
-    uint32_t decode_height = roi.active ? roi.height : frame_data.height;
+    bool use_roi = roi.active;
+    if (use_roi && roi.stale_frames >= QR_ROI_FULL_FRAME_PROBE_FRAMES) {
+      roi.stale_frames = 0;
+      use_roi = false;
+    }
+    uint32_t decode_x = use_roi ? roi.x : 0;
+    uint32_t decode_y = use_roi ? roi.y : 0;
+    uint32_t decode_width = use_roi ? roi.width : frame_data.width;
+    uint32_t decode_height = use_roi ? roi.height : frame_data.height;
 
     if (decode_x + decode_width > frame_data.width ||
         decode_y + decode_height > frame_data.height) {
@@ -703,77 +779,115 @@ static void qr_decode_task(void *pvParameters) {
       decoder_height = decode_height;
     }
 
+    qr_scanner_frame_stats_t stats = {0};
+    int64_t decode_start_us = esp_timer_get_time();
+    PERF_BEGIN(qr_decode);
+
     uint8_t *qr_buf = k_quirc_begin(qr_decoder, NULL, NULL);
     if (qr_buf) {
       rgb565_region_to_grayscale(frame_data.frame_data, qr_buf,
                                  frame_data.width, decode_x, decode_y,
                                  decode_width, decode_height);
+#if CONFIG_VIDEO_SCAN_RECORDER
+      // Before k_quirc_end(), which binarizes qr_buf in place.
+      video_recorder_submit(decode_x, decode_y, decode_width, decode_height,
+                            qr_buf);
+#endif
       // The RGB frame is fully copied into the decoder's grayscale buffer;
       // hand it back so the camera can reuse it as a PPA target.
       release_decode_frame(frame_data.frame_data);
       k_quirc_end(qr_decoder, false);
+      PERF_COUNT(PERF_CTR_FRAMES_DECODED);
 
       int num_codes = k_quirc_count(qr_decoder);
+      if (num_codes > QR_MAX_CODES_PER_FRAME)
+        num_codes = QR_MAX_CODES_PER_FRAME;
+      QRPayload batch[QR_MAX_CODES_PER_FRAME];
+      int batch_indices[QR_MAX_CODES_PER_FRAME];
+      int batch_count = 0;
+      qr_decode_box_t decoded_box = {0};
       bool frame_decoded = false;
+      stats.codes_detected = num_codes;
       for (int i = 0; i < num_codes; i++) {
         if (closing || destruction_in_progress)
           break;
 
         k_quirc_error_t err = k_quirc_decode(qr_decoder, i, &qr_result);
-        if (err == K_QUIRC_SUCCESS && qr_result.valid && qr_parser) {
-          if (!frame_decoded) {
-            update_decode_roi(&roi, &qr_result, decode_x, decode_y,
-                              frame_data.width, frame_data.height);
-            frame_decoded = true;
-          }
+        if (err != K_QUIRC_SUCCESS || !qr_result.valid || !qr_parser ||
+            !qr_batch_storage)
+          continue;
+
+        extend_decode_box(&decoded_box, &frame_decoded, &qr_result);
+        stats.codes_decoded++;
+
+        char *slot = qr_batch_storage + batch_count * QR_PAYLOAD_SLOT_SIZE;
+        size_t len = qr_result.data.payload_len;
+        if (len > QR_PAYLOAD_SLOT_SIZE - 1)
+          len = QR_PAYLOAD_SLOT_SIZE - 1;
+        memcpy(slot, qr_result.data.payload, len);
+        slot[len] = '\0';
+        batch[batch_count++] = (QRPayload){.data = slot, .data_len = len};
+      }
 
-          int part_index = qr_parser_parse_with_len(
-              qr_parser, (const char *)qr_result.data.payload,
-              qr_result.data.payload_len);
+      // k_quirc clears its own copies on return; the decoded payload - a
+      // mnemonic or PSBT fragment - now lives only here, on a task stack that
+      // outlives the scan.
+      secure_memzero(&qr_result, sizeof(qr_result));
 
-          if (part_index >= 0 || qr_parser->total == 1) {
-            qr_progress_update_t progress_update = {
+      if (frame_decoded)
+        update_decode_roi(&roi, &decoded_box, decode_x, decode_y,
+                          frame_data.width, frame_data.height);
+
+      if (batch_count > 0 && !closing && !destruction_in_progress) {
+        stats.parts_new = qr_parser_parse_batch(qr_parser, batch, batch_count,
+                                                batch_indices);
+        stats.parts_duplicate = batch_count - stats.parts_new;
+
+        if (qr_parser->format == FORMAT_UR && qr_parser->ur_decoder) {
+          publish_progress((qr_progress_update_t){
+              .format = FORMAT_UR,
+              .total = qr_parser->total,
+              .part_index = -1,
+              .percent_complete = ur_decoder_estimated_percent_complete(
+                  (ur_decoder_t *)qr_parser->ur_decoder),
+          });
+        } else if ((qr_parser->format == FORMAT_PMOFN ||
+                    qr_parser->format == FORMAT_BBQR) &&
+                   qr_parser->total > 1) {
+          for (int i = 0; i < batch_count; i++) {
+            if (batch_indices[i] < 0)
+              continue;
+            publish_progress((qr_progress_update_t){
                 .format = qr_parser->format,
                 .total = qr_parser->total,
-                .part_index = part_index,
-                .percent_complete = 0.0f,
-            };
-            bool publish_progress = (qr_parser->format == FORMAT_PMOFN ||
-                                     qr_parser->format == FORMAT_BBQR) &&
-                                    qr_parser->total > 1;
-
-            if (qr_parser->format == FORMAT_UR && qr_parser->ur_decoder) {
-              progress_update.percent_complete =
-                  ur_decoder_estimated_percent_complete(
-                      (ur_decoder_t *)qr_parser->ur_decoder);
-              publish_progress = true;
-            }
-
-            if (publish_progress && qr_progress_queue &&
-                xQueueSend(qr_progress_queue, &progress_update, 0) != pdTRUE) {
-              qr_progress_update_t stale_update;
-              xQueueReceive(qr_progress_queue, &stale_update, 0);
-              xQueueSend(qr_progress_queue, &progress_update, 0);
-            }
-
-            if (qr_parser_is_complete(qr_parser)) {
-              scan_completed = true;
-              break;
-            }
+                .part_index = batch_indices[i],
+            });
           }
+        }
 
-          if (qr_parser_is_failed(qr_parser)) {
-            scan_failure_msg = ur_failure_message(qr_parser);
-            scan_failed = true;
-            break;
-          }
+        if (qr_parser_is_complete(qr_parser)) {
+          scan_completed = true;
+          stats.complete = true;
+        } else if (qr_parser_is_failed(qr_parser)) {
+          scan_failure_msg = ur_failure_message(qr_parser);
+          scan_failed = true;
+          stats.failed = true;
         }
       }
 
-      // k_quirc clears its own copies on return; the decoded payload - a
-      // mnemonic or PSBT fragment - now lives only here, on a task stack that
-      // outlives the scan.
-      secure_memzero(&qr_result, sizeof(qr_result));
+      if (batch_count > 0)
+        secure_memzero(qr_batch_storage, batch_count * QR_PAYLOAD_SLOT_SIZE);
+
+      // Only ROI passes count towards a full-frame probe; a multi-part scan
+      // that stops gaining parts may have more of them outside the ROI.
+      if (use_roi && roi.active) {
+        bool multi_part = qr_parser && (qr_parser->format == FORMAT_UR ||
+                                        qr_parser->total > 1);
+        if (multi_part && stats.parts_new == 0 && !stats.complete)
+          roi.stale_frames++;
+        else
+          roi.stale_frames = 0;
+      }
 
       if (!frame_decoded && roi.active) {
         if (num_codes > 0) {
@@ -793,6 +907,13 @@ static void qr_decode_task(void *pvParameters) {
     } else {
       release_decode_frame(frame_data.frame_data);
     }
+    PERF_END(qr_decode);
+
+    qr_scanner_frame_observer_t observer = frame_observer;
+    if (observer) {
+      stats.decode_us = esp_timer_get_time() - decode_start_us;
+      observer(&stats);
+    }
   }
 
   if (qr_task_done_sem)
@@ -822,6 +943,14 @@ static bool qr_decoder_init(uint32_t width, uint32_t height) {
     }
   }
 
+  qr_batch_storage =
+      heap_caps_malloc(QR_MAX_CODES_PER_FRAME * QR_PAYLOAD_SLOT_SIZE,
+                       MALLOC_CAP_SPIRAM);
+  if (!qr_batch_storage) {
+    ESP_LOGE(TAG, "Failed to allocate QR payload batch");
+    goto error;
+  }
+
   qr_decoder = k_quirc_new();
   if (!qr_decoder) {
     ESP_LOGE(TAG, "Failed to create QR decoder");
@@ -839,7 +968,9 @@ static bool qr_decoder_init(uint32_t width, uint32_t height) {
     goto error;
   }
 
-  qr_progress_queue = xQueueCreate(2, sizeof(qr_progress_update_t));
+  // Room for one update per part harvested from a single frame.
+  qr_progress_queue =
+      xQueueCreate(QR_MAX_CODES_PER_FRAME, sizeof(qr_progress_update_t));
   if (!qr_progress_queue) {
     ESP_LOGE(TAG, "Failed to create QR progress queue");
     goto error;
@@ -907,6 +1038,7 @@ error:
     k_quirc_destroy(qr_decoder);
     qr_decoder = NULL;
   }
+  SAFE_FREE_STATIC(qr_batch_storage);
   return false;
 }
 
@@ -953,12 +1085,47 @@ static void qr_decoder_cleanup(void) {
     qr_parser = NULL;
   }
 
+  SECURE_FREE_BUFFER(qr_batch_storage,
+                     QR_MAX_CODES_PER_FRAME * QR_PAYLOAD_SLOT_SIZE);
+
   if (rgb565_gray_lut) {
     heap_caps_free(rgb565_gray_lut);
     rgb565_gray_lut = NULL;
   }
 }
 
+#if CONFIG_VIDEO_PREVIEW_STATS
+// Preview FPS, how many frames went out on the video layer, and the decode
+// task's share of one core (FreeRTOS run-time stats, in microseconds).
+static void preview_stats_frame(bool on_video_layer) {
+  int64_t now = esp_timer_get_time();
+  TaskHandle_t decode_task = qr_decode_task_handle;
+  configRUN_TIME_COUNTER_TYPE decode_now =
+      decode_task ? ulTaskGetRunTimeCounter(decode_task) : 0;
+  if (stats_window_start == 0) {
+    stats_window_start = now;
+    stats_decode_start = decode_now;
+    return;
+  }
+  stats_frames++;
+  if (on_video_layer)
+    stats_layer_frames++;
+
+  int64_t elapsed = now - stats_window_start;
+  if (elapsed < PREVIEW_STATS_INTERVAL_US)
+    return;
+  ESP_LOGI(TAG,
+           "Preview %.1f fps (%" PRIu32 "/%" PRIu32
+           " on video layer), decode task %.1f%% CPU",
+           stats_frames * 1e6 / elapsed, stats_layer_frames, stats_frames,
+           (uint32_t)(decode_now - stats_decode_start) * 100.0 / elapsed);
+  stats_window_start = now;
+  stats_decode_start = decode_now;
+  stats_frames = 0;
+  stats_layer_frames = 0;
+}
+#endif
+
 static void camera_video_frame_operation(uint8_t *camera_buf,
                                          uint8_t camera_buf_index,
                                          uint32_t camera_buf_hes,
@@ -1109,6 +1276,13 @@ static void camera_video_frame_operation(uint8_t *camera_buf,
   }
   buffer_swap_needed = true;
 
+  // On the video layer the PPA has already put the frame on screen; LVGL only
+  // draws the preview itself when the layer is missing or covered.
+  bool on_video_layer = video_view_present(display_src);
+#if CONFIG_VIDEO_PREVIEW_STATS
+  preview_stats_frame(on_video_layer);
+#endif
+
   if (buffer_swap_needed && !closing && !destruction_in_progress &&
       bsp_display_lock(0)) {
     // Re-check after taking lock — destroy may have run between the check
@@ -1116,9 +1290,12 @@ static void camera_video_frame_operation(uint8_t *camera_buf,
     if (!closing && !destruction_in_progress && camera_img) {
       current_display_buffer = back_buffer;
       img_refresh_dsc.data = display_src;
-      lv_img_set_src(camera_img, &img_refresh_dsc);
+      if (!on_video_layer)
+        lv_img_set_src(camera_img, &img_refresh_dsc);
       // Active scanning counts as activity: hold off screensaver/session lock
       lv_display_trigger_activity(NULL);
+      if (progress_pending || scan_completed || scan_failed)
+        ui_deadline_arm(completion_deadline, 0, 0);
     }
     buffer_swap_needed = false;
     bsp_display_unlock();
@@ -1178,6 +1355,10 @@ static bool camera_init(void) {
   if (!qr_decoder_init(CAMERA_SCREEN_WIDTH, CAMERA_SCREEN_HEIGHT)) {
     ESP_LOGE(TAG, "Failed to initialize QR decoder");
   }
+#if CONFIG_VIDEO_SCAN_RECORDER
+  // Best effort: scanning works the same without a card.
+  video_recorder_start(CAMERA_SCREEN_WIDTH, CAMERA_SCREEN_HEIGHT);
+#endif
 
   // PPA does centered crop + downscale on every frame.
   ppa_client_config_t ppa_cfg = {.oper_type = PPA_OPERATION_SRM};
@@ -1192,6 +1373,10 @@ static bool camera_init(void) {
              esp_err_to_name(start_err));
     return false;
   }
+  if (!holds_scanning) {
+    power_gov_acquire(POWER_ACT_SCANNING);
+    holds_scanning = true;
+  }
 
   // Apply camera settings after stream starts (V4L2 controls register with the
   // sensor device only once streaming).
@@ -1219,6 +1404,7 @@ void qr_scanner_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
   scan_completed = false;
   scan_failed = false;
   scan_failure_msg = NULL;
+  progress_pending = false;
   is_fully_initialized = false;
   active_frame_operations = 0;
 
@@ -1273,13 +1459,19 @@ void qr_scanner_page_create(lv_obj_t *parent, void (*return_cb)(void)) {
     lv_obj_set_style_bg_color(settings_btn, bg_color(), 0);
   }
 
+  // After the chrome, so whatever is drawn over the preview keeps its box.
+  // Without a video layer the preview stays an lv_image.
+  video_view_attach(frame_buffer);
+#if CONFIG_VIDEO_PREVIEW_STATS
+  stats_window_start = 0;
+#endif
+
   if (!camera_run()) {
     ESP_LOGE(TAG, "Failed to initialize camera");
     return;
   }
 
-  completion_timer =
-      lv_timer_create(completion_timer_cb, PROGRESS_UPDATE_INTERVAL_MS, NULL);
+  completion_deadline = ui_deadline_add(completion_cb, NULL, 0);
   is_fully_initialized = true;
 }
 
@@ -1303,10 +1495,8 @@ void qr_scanner_page_destroy(void) {
   has_focus_motor = false;
   has_ae_control = false;
 
-  if (completion_timer) {
-    lv_timer_del(completion_timer);
-    completion_timer = NULL;
-  }
+  ui_deadline_remove(completion_deadline);
+  completion_deadline = -1;
   scan_completed = false;
   scan_failed = false;
   scan_failure_msg = NULL;
@@ -1330,8 +1520,15 @@ void qr_scanner_page_destroy(void) {
              remaining_ops);
 
   app_video_stop();
+  if (holds_scanning) {
+    power_gov_release(POWER_ACT_SCANNING);
+    holds_scanning = false;
+  }
 
   qr_decoder_cleanup();
+#if CONFIG_VIDEO_SCAN_RECORDER
+  video_recorder_stop();
+#endif
 
   bool display_locked = bsp_display_lock(1000);
   if (!display_locked)
@@ -1412,3 +1609,7 @@ bool qr_scanner_get_ur_result(const char **ur_type_out,
   }
   return false;
 }
+
+void qr_scanner_set_frame_observer(qr_scanner_frame_observer_t observer) {
+  frame_observer = observer;
+}
@@ -11,6 +11,26 @@
 #include "../utils/attributes.h"
 #include <lvgl.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Per-frame decode statistics reported to the frame observer
+ */
+typedef struct {
+  int64_t decode_us;   /**< Grayscale conversion + detect + decode time */
+  int codes_detected;  /**< Symbols k_quirc located in the frame */
+  int codes_decoded;   /**< Symbols that decoded to a valid payload */
+  int parts_new;       /**< Payloads that grew the parser's part count */
+  int parts_duplicate; /**< Payloads the parser had already seen */
+  bool complete;       /**< Parser completed on this frame */
+  bool failed;         /**< Parser reached a terminal failure on this frame */
+} qr_scanner_frame_stats_t;
+
+/**
+ * @brief Frame observer callback, invoked from the decode task
+ */
+typedef void (*qr_scanner_frame_observer_t)(
+    const qr_scanner_frame_stats_t *stats);
 
 /**
  * @brief Create the QR scanner page
@@ -102,4 +122,15 @@ KERN_WARN_UNUSED_RESULT bool
 qr_scanner_get_ur_result(const char **ur_type_out,
                          const uint8_t **cbor_data_out, size_t *cbor_len_out);
 
+/**
+ * @brief Install an observer called once per decoded frame
+ *
+ * Runs on the decode task after each frame handed to k_quirc, so it must be
+ * short and must not touch LVGL. Used by the simulator's scan-replay
+ * benchmark; pass NULL to remove.
+ *
+ * @param observer Callback, or NULL
+ */
+void qr_scanner_set_frame_observer(qr_scanner_frame_observer_t observer);
+
 #endif // QR_SCANNER_H
@@ -1,9 +1,13 @@
 #include "battery.h"
+#include "deadline.h"
 #include "theme.h"
 #include <bsp/pmic.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #define BATTERY_REFRESH_MS 30000
+// The level moves slowly; let the refresh ride along with another wakeup.
+#define BATTERY_REFRESH_SLACK_MS 10000
 
 static void battery_update(lv_obj_t *label) {
   uint8_t pct;
@@ -42,13 +46,10 @@ static void battery_update(lv_obj_t *label) {
   lv_obj_set_style_text_color(label, color, 0);
 }
 
-static void battery_timer_cb(lv_timer_t *t) {
-  battery_update(lv_timer_get_user_data(t));
-}
+static void battery_deadline_cb(void *user_data) { battery_update(user_data); }
 
 static void battery_label_deleted_cb(lv_event_t *e) {
-  lv_timer_t *timer = lv_event_get_user_data(e);
-  lv_timer_delete(timer);
+  ui_deadline_remove((int)(intptr_t)lv_event_get_user_data(e));
 }
 
 lv_obj_t *ui_battery_create(lv_obj_t *parent) {
@@ -60,9 +61,11 @@ lv_obj_t *ui_battery_create(lv_obj_t *parent) {
 
   battery_update(label);
 
-  lv_timer_t *timer =
-      lv_timer_create(battery_timer_cb, BATTERY_REFRESH_MS, label);
-  lv_obj_add_event_cb(label, battery_label_deleted_cb, LV_EVENT_DELETE, timer);
+  int deadline =
+      ui_deadline_add(battery_deadline_cb, label, BATTERY_REFRESH_SLACK_MS);
+  ui_deadline_arm(deadline, BATTERY_REFRESH_MS, BATTERY_REFRESH_MS);
+  lv_obj_add_event_cb(label, battery_label_deleted_cb, LV_EVENT_DELETE,
+                      (void *)(intptr_t)deadline);
 
   return label;
 }
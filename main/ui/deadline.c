@@ -0,0 +1,63 @@
+// Deadline scheduler - one LVGL timer for every UI deadline
+
+#include "deadline.h"
+
+#include <lvgl.h>
+
+static deadline_queue_t queue;
+static lv_timer_t *timer = NULL;
+
+static void rearm(void) {
+  if (!timer)
+    return;
+  uint32_t wait;
+  if (!deadline_queue_wait(&queue, lv_tick_get(), &wait)) {
+    lv_timer_pause(timer);
+    return;
+  }
+  lv_timer_set_period(timer, wait);
+  lv_timer_reset(timer);
+  lv_timer_resume(timer);
+}
+
+static void timer_cb(lv_timer_t *t) {
+  (void)t;
+  deadline_queue_run(&queue, lv_tick_get());
+  rearm();
+}
+
+int ui_deadline_add(deadline_cb_t cb, void *user_data, uint32_t slack_ms) {
+  if (!timer) {
+    deadline_queue_init(&queue);
+    timer = lv_timer_create(timer_cb, 1000, NULL);
+    if (!timer)
+      return -1;
+    lv_timer_pause(timer);
+  }
+  return deadline_queue_add(&queue, cb, user_data, slack_ms);
+}
+
+void ui_deadline_remove(int id) {
+  if (id < 0)
+    return;
+  deadline_queue_remove(&queue, id);
+  rearm();
+}
+
+void ui_deadline_arm(int id, uint32_t delay_ms, uint32_t period_ms) {
+  if (id < 0)
+    return;
+  deadline_queue_arm(&queue, id, lv_tick_get(), delay_ms, period_ms);
+  rearm();
+}
+
+void ui_deadline_cancel(int id) {
+  if (id < 0)
+    return;
+  deadline_queue_cancel(&queue, id);
+  rearm();
+}
+
+bool ui_deadline_armed(int id) { return deadline_queue_armed(&queue, id); }
+
+uint32_t ui_deadline_wakeups(void) { return queue.wakeups; }
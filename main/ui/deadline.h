@@ -0,0 +1,31 @@
+#ifndef UI_DEADLINE_H
+#define UI_DEADLINE_H
+
+#include "deadline_queue.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Deadlines for the UI, all served by one LVGL timer that is re-armed to the
+ * nearest of them and paused while none is armed. Use these instead of an
+ * lv_timer that polls on a fixed period: work that waits on another task is
+ * armed with delay 0 by that task's LVGL-side hand-off, and nothing wakes the
+ * LVGL task in between.
+ *
+ * Every call needs the LVGL lock (LVGL task, or bsp_display_lock()). */
+
+/* slack_ms: how late the callback may run to share a wakeup with an earlier
+ * deadline. Returns -1 when the table is full. */
+int ui_deadline_add(deadline_cb_t cb, void *user_data, uint32_t slack_ms);
+
+/* Also cancels. Safe from the deadline's own callback; -1 is ignored. */
+void ui_deadline_remove(int id);
+
+/* Runs delay_ms from now, then every period_ms if non-zero. */
+void ui_deadline_arm(int id, uint32_t delay_ms, uint32_t period_ms);
+void ui_deadline_cancel(int id);
+bool ui_deadline_armed(int id);
+
+/* Wakeups of the shared timer since boot that ran at least one deadline. */
+uint32_t ui_deadline_wakeups(void);
+
+#endif // UI_DEADLINE_H
@@ -0,0 +1,126 @@
+#include "deadline_queue.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// a at or before b on the wrapping clock.
+static bool not_after(uint32_t a, uint32_t b) { return (int32_t)(a - b) <= 0; }
+
+static deadline_slot_t *slot(deadline_queue_t *q, int id) {
+  if (id < 0 || id >= DEADLINE_QUEUE_MAX || !q->slots[id].used)
+    return NULL;
+  return &q->slots[id];
+}
+
+void deadline_queue_init(deadline_queue_t *q) { memset(q, 0, sizeof(*q)); }
+
+int deadline_queue_add(deadline_queue_t *q, deadline_cb_t cb, void *user_data,
+                       uint32_t slack_ms) {
+  if (!cb)
+    return -1;
+  for (int i = 0; i < DEADLINE_QUEUE_MAX; i++) {
+    deadline_slot_t *s = &q->slots[i];
+    if (s->used)
+      continue;
+    uint16_t gen = s->gen + 1;
+    *s = (deadline_slot_t){
+        .cb = cb,
+        .user_data = user_data,
+        .slack = slack_ms,
+        .gen = gen,
+        .used = true,
+    };
+    return i;
+  }
+  return -1;
+}
+
+void deadline_queue_remove(deadline_queue_t *q, int id) {
+  deadline_slot_t *s = slot(q, id);
+  if (!s)
+    return;
+  s->used = false;
+  s->armed = false;
+  s->gen++;
+}
+
+void deadline_queue_arm(deadline_queue_t *q, int id, uint32_t now,
+                        uint32_t delay_ms, uint32_t period_ms) {
+  deadline_slot_t *s = slot(q, id);
+  if (!s)
+    return;
+  s->due = now + delay_ms;
+  s->period = period_ms;
+  s->armed = true;
+  s->gen++;
+}
+
+void deadline_queue_cancel(deadline_queue_t *q, int id) {
+  deadline_slot_t *s = slot(q, id);
+  if (!s || !s->armed)
+    return;
+  s->armed = false;
+  s->gen++;
+}
+
+bool deadline_queue_armed(const deadline_queue_t *q, int id) {
+  return id >= 0 && id < DEADLINE_QUEUE_MAX && q->slots[id].used &&
+         q->slots[id].armed;
+}
+
+bool deadline_queue_wait(const deadline_queue_t *q, uint32_t now,
+                         uint32_t *wait_ms) {
+  bool any = false;
+  uint32_t wait = 0;
+  for (int i = 0; i < DEADLINE_QUEUE_MAX; i++) {
+    const deadline_slot_t *s = &q->slots[i];
+    if (!s->used || !s->armed)
+      continue;
+    uint32_t latest = s->due + s->slack;
+    uint32_t w = not_after(latest, now) ? 0 : latest - now;
+    if (!any || w < wait)
+      wait = w;
+    any = true;
+  }
+  if (any)
+    *wait_ms = wait;
+  return any;
+}
+
+int deadline_queue_run(deadline_queue_t *q, uint32_t now) {
+  uint16_t gens[DEADLINE_QUEUE_MAX];
+  bool due[DEADLINE_QUEUE_MAX] = {false};
+  int count = 0;
+
+  // Settle every due slot before any callback runs, so a callback that
+  // re-arms one sees a clean state and its own arm sticks.
+  for (int i = 0; i < DEADLINE_QUEUE_MAX; i++) {
+    deadline_slot_t *s = &q->slots[i];
+    if (!s->used || !s->armed || !not_after(s->due, now))
+      continue;
+    if (s->period) {
+      s->due += s->period;
+      // Missed periods are dropped, not run back to back.
+      if (not_after(s->due, now))
+        s->due = now + s->period;
+    } else {
+      s->armed = false;
+    }
+    gens[i] = ++s->gen;
+    due[i] = true;
+    count++;
+  }
+  if (!count)
+    return 0;
+  q->wakeups++;
+
+  int ran = 0;
+  for (int i = 0; i < DEADLINE_QUEUE_MAX; i++) {
+    deadline_slot_t *s = &q->slots[i];
+    if (!due[i] || !s->used || s->gen != gens[i])
+      continue;
+    s->cb(s->user_data);
+    ran++;
+  }
+  return ran;
+}
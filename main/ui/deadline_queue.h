@@ -0,0 +1,60 @@
+#ifndef DEADLINE_QUEUE_H
+#define DEADLINE_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Scheduler behind deadline.c: a fixed table of deadlines on a wrapping
+ * millisecond clock. It never reads the clock itself, so the host tests can
+ * drive it without LVGL.
+ *
+ * Each deadline has a slack: it may run up to that much late, so that it
+ * shares a wakeup with an earlier one instead of causing its own. A wakeup
+ * runs every deadline already due, whatever its slack. */
+
+#define DEADLINE_QUEUE_MAX 16
+
+typedef void (*deadline_cb_t)(void *user_data);
+
+typedef struct {
+  deadline_cb_t cb;
+  void *user_data;
+  uint32_t due;
+  uint32_t slack;
+  uint32_t period; /* 0: one-shot */
+  uint16_t gen;    /* bumped by every arm/cancel/remove */
+  bool used;
+  bool armed;
+} deadline_slot_t;
+
+typedef struct {
+  deadline_slot_t slots[DEADLINE_QUEUE_MAX];
+  uint32_t wakeups; /* deadline_queue_run() calls that ran something */
+} deadline_queue_t;
+
+void deadline_queue_init(deadline_queue_t *q);
+
+/* Returns an id, or -1 when the table is full. Starts disarmed. */
+int deadline_queue_add(deadline_queue_t *q, deadline_cb_t cb, void *user_data,
+                       uint32_t slack_ms);
+void deadline_queue_remove(deadline_queue_t *q, int id);
+
+/* Due delay_ms after now, then every period_ms if non-zero. Re-arming an
+ * armed deadline moves it. */
+void deadline_queue_arm(deadline_queue_t *q, int id, uint32_t now,
+                        uint32_t delay_ms, uint32_t period_ms);
+void deadline_queue_cancel(deadline_queue_t *q, int id);
+bool deadline_queue_armed(const deadline_queue_t *q, int id);
+
+/* Milliseconds until the next wakeup is needed (0: now). False when nothing
+ * is armed. */
+bool deadline_queue_wait(const deadline_queue_t *q, uint32_t now,
+                         uint32_t *wait_ms);
+
+/* Runs every deadline due at now, one-shots disarmed and periodic ones moved
+ * to their next period first. Callbacks may arm, cancel or remove any
+ * deadline, themselves included; one cancelled or re-armed by an earlier
+ * callback in the same wakeup does not run. Returns how many ran. */
+int deadline_queue_run(deadline_queue_t *q, uint32_t now);
+
+#endif // DEADLINE_QUEUE_H
@@ -0,0 +1,134 @@
+// Display flush benchmark — see flush_benchmark.h
+
+#include "flush_benchmark.h"
+
+#if CONFIG_BSP_DISPLAY_FLUSH_BENCHMARK
+
+#include <bsp/display_profile.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdio.h>
+
+static const char *TAG = "flush_bench";
+
+#define FRAMES_PER_SCENE 30
+#define TEXT_LABELS 48
+
+typedef struct {
+  const char *name;
+  void (*setup)(lv_obj_t *panel);
+  void (*step)(lv_obj_t *panel, int frame); // changes every pixel
+} scene_t;
+
+static void fill_setup(lv_obj_t *panel) {
+  lv_obj_set_style_bg_grad_dir(panel, LV_GRAD_DIR_NONE, 0);
+}
+
+static void fill_step(lv_obj_t *panel, int frame) {
+  lv_obj_set_style_bg_color(
+      panel, (frame & 1) ? lv_color_white() : lv_color_black(), 0);
+}
+
+static void gradient_setup(lv_obj_t *panel) {
+  lv_obj_set_style_bg_grad_dir(panel, LV_GRAD_DIR_VER, 0);
+}
+
+static void gradient_step(lv_obj_t *panel, int frame) {
+  lv_color_t a = lv_palette_main(LV_PALETTE_ORANGE);
+  lv_color_t b = lv_palette_darken(LV_PALETTE_BLUE, 3);
+  lv_obj_set_style_bg_color(panel, (frame & 1) ? a : b, 0);
+  lv_obj_set_style_bg_grad_color(panel, (frame & 1) ? b : a, 0);
+}
+
+static void text_setup(lv_obj_t *panel) {
+  lv_obj_set_style_bg_grad_dir(panel, LV_GRAD_DIR_NONE, 0);
+  lv_obj_set_flex_flow(panel, LV_FLEX_FLOW_ROW_WRAP);
+  for (int i = 0; i < TEXT_LABELS; i++) {
+    lv_obj_t *label = lv_label_create(panel);
+    lv_label_set_text(label, "bc1qar0srrr7xfkvy5l643lydnw9re59gtzzwf5mdq");
+  }
+}
+
+static void text_step(lv_obj_t *panel, int frame) {
+  lv_obj_set_style_bg_color(
+      panel, (frame & 1) ? lv_color_white() : lv_color_black(), 0);
+  lv_obj_set_style_text_color(
+      panel, (frame & 1) ? lv_color_black() : lv_color_white(), 0);
+}
+
+static const scene_t scenes[] = {
+    {"fill", fill_setup, fill_step},
+    {"gradient", gradient_setup, gradient_step},
+    {"text", text_setup, text_step},
+};
+
+#define SCENE_COUNT (sizeof(scenes) / sizeof(scenes[0]))
+
+static const char *tear_avoid_name(bsp_tear_avoid_t mode) {
+  switch (mode) {
+  case BSP_TEAR_AVOID_DOUBLE_FULL:
+    return "double full";
+  case BSP_TEAR_AVOID_TRIPLE_PARTIAL:
+    return "triple partial";
+  default:
+    return "none";
+  }
+}
+
+lv_obj_t *flush_benchmark_run(lv_obj_t *parent) {
+  lv_obj_t *panel = lv_obj_create(parent);
+  lv_obj_remove_style_all(panel);
+  lv_obj_set_size(panel, LV_PCT(100), LV_PCT(100));
+  lv_obj_set_style_bg_opa(panel, LV_OPA_COVER, 0);
+  lv_obj_set_style_pad_all(panel, 8, 0);
+
+  double avg_ms[SCENE_COUNT];
+  for (size_t s = 0; s < SCENE_COUNT; s++) {
+    lv_obj_clean(panel);
+    scenes[s].setup(panel);
+    scenes[s].step(panel, 0);
+    lv_refr_now(NULL); // layout and first render outside the timing
+
+    // Back to back, so each refresh also waits out the previous flush
+    int64_t start = esp_timer_get_time();
+    for (int f = 1; f <= FRAMES_PER_SCENE; f++) {
+      scenes[s].step(panel, f);
+      lv_obj_invalidate(panel);
+      lv_refr_now(NULL);
+    }
+    avg_ms[s] =
+        (esp_timer_get_time() - start) / 1000.0 / (double)FRAMES_PER_SCENE;
+    ESP_LOGI(TAG, "%s: %.1f ms per full-screen refresh, %.1f FPS",
+             scenes[s].name, avg_ms[s], 1000.0 / avg_ms[s]);
+  }
+
+  const bsp_display_profile_t *p = bsp_display_profile();
+  char text[384];
+  int n = snprintf(text, sizeof(text),
+                   "Display profile: %s\n"
+                   "%u-line buffers in %s%s, PPA %s,\n"
+                   "%u frame buffer(s), tear avoidance %s\n\n",
+                   p->name, p->buffer_height,
+                   p->buffer_in_psram ? "PSRAM" : "internal RAM",
+                   p->double_buffer ? " (double)" : "",
+                   p->ppa_accel ? "on" : "off", p->dpi_fb_count,
+                   tear_avoid_name(p->tear_avoid));
+  for (size_t s = 0; s < SCENE_COUNT && n > 0 && (size_t)n < sizeof(text);
+       s++) {
+    n += snprintf(text + n, sizeof(text) - n, "%-9s %6.1f ms  %5.1f FPS\n",
+                  scenes[s].name, avg_ms[s], 1000.0 / avg_ms[s]);
+  }
+
+  lv_obj_clean(panel);
+  lv_obj_set_layout(panel, LV_LAYOUT_NONE);
+  lv_obj_set_style_bg_grad_dir(panel, LV_GRAD_DIR_NONE, 0);
+  lv_obj_set_style_bg_color(panel, lv_color_black(), 0);
+  lv_obj_t *label = lv_label_create(panel);
+  lv_obj_set_style_text_color(label, lv_color_white(), 0);
+  lv_label_set_text(label, text);
+  lv_obj_center(label);
+  lv_refr_now(NULL);
+  return panel;
+}
+
+#endif
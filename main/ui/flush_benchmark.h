@@ -0,0 +1,25 @@
+#ifndef UI_FLUSH_BENCHMARK_H
+#define UI_FLUSH_BENCHMARK_H
+
+#include "sdkconfig.h"
+
+// Developer-only display flush benchmark (CONFIG_BSP_DISPLAY_FLUSH_BENCHMARK),
+// for tuning the board display profiles in bsp_common. Not built otherwise.
+
+#if CONFIG_BSP_DISPLAY_FLUSH_BENCHMARK
+
+#include <lvgl.h>
+
+// How long main.c leaves the results up before booting on
+#define FLUSH_BENCHMARK_RESULT_MS 8000
+
+// Times back-to-back full-screen refreshes of a few scenes (solid fill,
+// gradient, a screen of text) drawn on a panel covering parent, logs the
+// average ms and FPS of each with the active profile, and leaves them shown
+// on the panel, which is returned for the caller to delete. Call with the
+// display lock held.
+lv_obj_t *flush_benchmark_run(lv_obj_t *parent);
+
+#endif
+
+#endif
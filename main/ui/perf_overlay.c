@@ -0,0 +1,133 @@
+// Performance telemetry overlay — see perf_overlay.h
+
+#include "perf_overlay.h"
+
+#if CONFIG_KERN_PERF_TELEMETRY
+
+#include "../utils/perf.h"
+#include "theme.h"
+#include <esp_log.h>
+#include <inttypes.h>
+#include <lvgl.h>
+#include <sd_card.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define OVERLAY_TASKS 4
+
+static const char *TAG = "perf_overlay";
+
+static lv_obj_t *overlay = NULL;
+static bool folded = false;
+// Outcome of the last dump, shown until the next
+static char dump_status[48];
+
+static void append(char *buf, size_t size, size_t *len, const char *fmt,
+                   ...) {
+  if (*len >= size)
+    return;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf + *len, size - *len, fmt, ap);
+  va_end(ap);
+  if (n > 0)
+    *len += (size_t)n;
+}
+
+static void refresh(void) {
+  char text[384];
+  size_t len = 0;
+  text[0] = '\0';
+
+  perf_sample_t s;
+  bool sampled = perf_latest(&s);
+  if (sampled)
+    append(text, sizeof(text), &len,
+           "int %" PRIu32 "/%" PRIu32 "K  psram %" PRIu32 "/%" PRIu32 "K",
+           s.internal_free / 1024, s.internal_largest / 1024,
+           s.psram_free / 1024, s.psram_largest / 1024);
+  else
+    append(text, sizeof(text), &len, "perf: no sample yet");
+
+  if (!folded) {
+    for (uint32_t i = 0; sampled && i < s.task_count && i < OVERLAY_TASKS;
+         i++)
+      append(text, sizeof(text), &len, "\n%-12s %3u.%u%%  %" PRIu32 " free",
+             s.tasks[i].name, (unsigned)s.tasks[i].cpu_permille / 10,
+             (unsigned)s.tasks[i].cpu_permille % 10, s.tasks[i].stack_free);
+    append(text, sizeof(text), &len,
+           "\nframes %" PRIu32 "  parts %" PRIu32 "  sigs %" PRIu32,
+           perf_counter(PERF_CTR_FRAMES_DECODED),
+           perf_counter(PERF_CTR_PARTS_PARSED),
+           perf_counter(PERF_CTR_SIGNATURES));
+    if (dump_status[0])
+      append(text, sizeof(text), &len, "\n%s", dump_status);
+  }
+
+  lv_label_set_text(overlay, text);
+}
+
+static void refresh_timer_cb(lv_timer_t *timer) {
+  (void)timer;
+  refresh();
+}
+
+static void clicked_cb(lv_event_t *e) {
+  (void)e;
+  folded = !folded;
+  refresh();
+}
+
+static void long_pressed_cb(lv_event_t *e) {
+  (void)e;
+  char path[64];
+  if (perf_overlay_dump(path, sizeof(path)))
+    snprintf(dump_status, sizeof(dump_status), "saved %s", path);
+  else
+    snprintf(dump_status, sizeof(dump_status), "SD dump failed");
+  folded = false;
+  refresh();
+}
+
+bool perf_overlay_dump(char *path_out, size_t path_len) {
+  size_t len = 0;
+  char *json = perf_json(&len);
+  if (!json) {
+    ESP_LOGE(TAG, "No memory for the telemetry JSON");
+    return false;
+  }
+
+  bool ok = false;
+  snprintf(path_out, path_len, SD_CARD_MOUNT_POINT "/perf-%" PRIu32 ".json",
+           (uint32_t)(perf_now_us() / 1000));
+  if (sd_card_init() != ESP_OK)
+    ESP_LOGW(TAG, "No SD card");
+  else if (sd_card_write_file(path_out, (const uint8_t *)json, len) != ESP_OK)
+    ESP_LOGW(TAG, "Writing %s failed", path_out);
+  else
+    ok = true;
+  free(json);
+  return ok;
+}
+
+void perf_overlay_create(void) {
+  if (overlay)
+    return;
+
+  overlay = lv_label_create(lv_layer_top());
+  lv_obj_set_style_text_font(overlay, theme_font_small(), 0);
+  lv_obj_set_style_text_color(overlay, lv_color_white(), 0);
+  lv_obj_set_style_bg_color(overlay, lv_color_black(), 0);
+  lv_obj_set_style_bg_opa(overlay, LV_OPA_70, 0);
+  lv_obj_set_style_pad_all(overlay, theme_small_padding(), 0);
+  lv_obj_align(overlay, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+  lv_obj_add_flag(overlay, LV_OBJ_FLAG_CLICKABLE);
+  lv_obj_add_event_cb(overlay, clicked_cb, LV_EVENT_SHORT_CLICKED, NULL);
+  lv_obj_add_event_cb(overlay, long_pressed_cb, LV_EVENT_LONG_PRESSED, NULL);
+
+  refresh();
+  lv_timer_create(refresh_timer_cb, PERF_SAMPLE_MS, NULL);
+}
+
+#endif // CONFIG_KERN_PERF_TELEMETRY
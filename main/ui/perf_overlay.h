@@ -0,0 +1,26 @@
+#ifndef UI_PERF_OVERLAY_H
+#define UI_PERF_OVERLAY_H
+
+#include "sdkconfig.h"
+
+// Developer-only telemetry overlay (CONFIG_KERN_PERF_TELEMETRY), showing what
+// utils/perf.h collects. Not built otherwise.
+
+#if CONFIG_KERN_PERF_TELEMETRY
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A small panel on the top layer, in the bottom-left corner, refreshed every
+// sample: heap, the busiest tasks and the counters. A tap folds it down to
+// one line and back; a long press writes perf_json() to the SD card. Call
+// with the display lock held, after perf_init().
+void perf_overlay_create(void);
+
+// Writes perf_json() to SD_CARD_MOUNT_POINT "/perf-<uptime ms>.json" and
+// returns that path in path_out. Blocks for the card.
+bool perf_overlay_dump(char *path_out, size_t path_len);
+
+#endif
+
+#endif
@@ -1,5 +1,6 @@
 #include "power.h"
 
+#include "../core/settings.h"
 #include "../core/wallet.h"
 #include "dialog.h"
 
@@ -14,6 +15,7 @@ void ui_power_off_confirmed_cb(bool confirmed, void *user_data) {
   if (unload_key)
     wallet_unload();
 
+  settings_flush();
   if (bsp_pmic_power_off() != ESP_OK) {
     if (unload_key) {
       esp_restart();
@@ -0,0 +1,311 @@
+#include "sankey_raster.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_THICKNESS 4
+#define THICKNESS_BUDGET_PCT 30
+
+/* Vertical positions are Q16.16 fixed point: integer row in the high half,
+ * coverage of that row in the low half. */
+#define Q16_SHIFT 16
+#define Q16_ONE (1 << Q16_SHIFT)
+#define Q16_FRAC_MASK (Q16_ONE - 1)
+
+typedef int32_t q16_t;
+
+typedef struct {
+  float thickness;
+  float y_center;
+} flow_layout_t;
+
+/* One horizontal run of columns shared by every flow drawn across it: the
+ * columns' interpolation factors are computed once, and each flow only adds
+ * its own offsets and colors. */
+typedef struct {
+  int32_t x_first;
+  int32_t count;
+  q16_t *ease; /* smoothstep of `lerp`, for ribbon edges */
+  q16_t *lerp; /* linear position across the run, for colors */
+} column_table_t;
+
+static inline q16_t to_q16(float v) { return (q16_t)(v * Q16_ONE); }
+
+static inline q16_t q16_interp(q16_t from, q16_t to, q16_t factor) {
+  return from + (q16_t)(((int64_t)(to - from) * factor) >> Q16_SHIFT);
+}
+
+static inline uint16_t rgb888_to_565(uint32_t r, uint32_t g, uint32_t b) {
+  return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+/* Exact v / 255 for any v a channel blend can form (at most 63 * 255). */
+static inline uint32_t div255(uint32_t v) { return (v * 0x8081u) >> 23; }
+
+static inline uint16_t blend565(uint16_t fg, uint16_t bg, uint32_t alpha) {
+  uint32_t inv = 255 - alpha;
+  uint32_t r = div255((fg >> 11) * alpha + (bg >> 11) * inv);
+  uint32_t g = div255(((fg >> 5) & 0x3F) * alpha + ((bg >> 5) & 0x3F) * inv);
+  uint32_t b = div255((fg & 0x1F) * alpha + (bg & 0x1F) * inv);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void clear_target(const sankey_raster_target_t *t, uint16_t bg16) {
+  size_t row_bytes = (size_t)t->width * sizeof(uint16_t);
+  if (bg16 == 0) {
+    if (t->stride == row_bytes)
+      memset(t->data, 0, (size_t)t->stride * t->height);
+    else
+      for (int32_t y = 0; y < t->height; y++)
+        memset(t->data + (size_t)y * t->stride, 0, row_bytes);
+    return;
+  }
+  uint16_t *first = (uint16_t *)t->data;
+  for (int32_t x = 0; x < t->width; x++)
+    first[x] = bg16;
+  for (int32_t y = 1; y < t->height; y++)
+    memcpy(t->data + (size_t)y * t->stride, first, row_bytes);
+}
+
+/* One column of a flow: a partially covered pixel at each end and a solid
+ * vertical span between them. */
+static void draw_column(const sankey_raster_target_t *t, int32_t x, q16_t top,
+                        q16_t bot, uint16_t color) {
+  if (x < 0 || x >= t->width)
+    return;
+  if (top > bot) {
+    q16_t tmp = top;
+    top = bot;
+    bot = tmp;
+  }
+
+  int32_t y_top = top >> Q16_SHIFT;
+  int32_t y_bot = bot >> Q16_SHIFT;
+  uint8_t *col = t->data + (size_t)x * sizeof(uint16_t);
+
+  if (y_top >= 0 && y_top < t->height) {
+    uint16_t *px = (uint16_t *)(col + (size_t)y_top * t->stride);
+    uint32_t alpha =
+        255 - (((uint32_t)(top & Q16_FRAC_MASK) * 255) >> Q16_SHIFT);
+    *px = (alpha >= 255) ? color : blend565(color, *px, alpha);
+  }
+
+  int32_t fill_start = (y_top + 1 > 0) ? y_top + 1 : 0;
+  int32_t fill_end = (y_bot < t->height) ? y_bot : t->height;
+  uint8_t *p = col + (size_t)fill_start * t->stride;
+  for (int32_t y = fill_start; y < fill_end; y++, p += t->stride)
+    *(uint16_t *)p = color;
+
+  if (y_bot > y_top && y_bot >= 0 && y_bot < t->height) {
+    uint16_t *px = (uint16_t *)(col + (size_t)y_bot * t->stride);
+    uint32_t alpha = ((uint32_t)(bot & Q16_FRAC_MASK) * 255) >> Q16_SHIFT;
+    if (alpha > 0)
+      *px = blend565(color, *px, alpha);
+  }
+}
+
+/* Columns x_first .. x_first + count - 1 spread evenly from `x0` to `x1`. */
+static void build_columns(column_table_t *ct, int32_t x_first, int32_t x_last,
+                          float x0, float x1) {
+  float span = x1 - x0;
+  ct->x_first = x_first;
+  ct->count = (x_last >= x_first && span > 0.0f) ? x_last - x_first + 1 : 0;
+  for (int32_t i = 0; i < ct->count; i++) {
+    float t = ((float)(x_first + i) - x0) / span;
+    if (t < 0.0f)
+      t = 0.0f;
+    else if (t > 1.0f)
+      t = 1.0f;
+    float eased = t * t * (3.0f - 2.0f * t);
+    ct->lerp[i] = (q16_t)(t * Q16_ONE + 0.5f);
+    ct->ease[i] = (q16_t)(eased * Q16_ONE + 0.5f);
+  }
+}
+
+/* The flow's color at every column of the run, from `from` to `to`. */
+static void build_gradient(uint16_t *lut, const column_table_t *ct,
+                           uint32_t from, uint32_t to) {
+  int32_t r0 = (from >> 16) & 0xFF, g0 = (from >> 8) & 0xFF, b0 = from & 0xFF;
+  int32_t dr = (int32_t)((to >> 16) & 0xFF) - r0;
+  int32_t dg = (int32_t)((to >> 8) & 0xFF) - g0;
+  int32_t db = (int32_t)(to & 0xFF) - b0;
+  for (int32_t i = 0; i < ct->count; i++) {
+    q16_t f = ct->lerp[i];
+    lut[i] = rgb888_to_565((uint32_t)(r0 + ((dr * f) >> Q16_SHIFT)),
+                           (uint32_t)(g0 + ((dg * f) >> Q16_SHIFT)),
+                           (uint32_t)(b0 + ((db * f) >> Q16_SHIFT)));
+  }
+}
+
+static void draw_band(const sankey_raster_target_t *t, const column_table_t *ct,
+                      const uint16_t *lut, q16_t top, q16_t bot) {
+  for (int32_t i = 0; i < ct->count; i++)
+    draw_column(t, ct->x_first + i, top, bot, lut[i]);
+}
+
+static void draw_ribbon(const sankey_raster_target_t *t,
+                        const column_table_t *ct, const uint16_t *lut,
+                        q16_t top0, q16_t bot0, q16_t top1, q16_t bot1) {
+  for (int32_t i = 0; i < ct->count; i++) {
+    q16_t e = ct->ease[i];
+    draw_column(t, ct->x_first + i, q16_interp(top0, top1, e),
+                q16_interp(bot0, bot1, e), lut[i]);
+  }
+}
+
+static void calculate_flow_layout(flow_layout_t *layout,
+                                  const sankey_raster_flow_t *flows,
+                                  size_t count, uint64_t total_amount,
+                                  int32_t height) {
+  float thickness_budget = height * THICKNESS_BUDGET_PCT / 100.0f;
+  float gap = (count > 1)
+                  ? height * (100 - THICKNESS_BUDGET_PCT) / 100.0f / (count - 1)
+                  : 0;
+
+  float total_raw = 0;
+  for (size_t i = 0; i < count; i++) {
+    layout[i].thickness =
+        (float)flows[i].amount / total_amount * thickness_budget;
+    if (layout[i].thickness < MIN_THICKNESS)
+      layout[i].thickness = MIN_THICKNESS;
+    total_raw += layout[i].thickness;
+  }
+
+  if (total_raw > thickness_budget) {
+    float scale = thickness_budget / total_raw;
+    for (size_t i = 0; i < count; i++)
+      layout[i].thickness *= scale;
+  }
+
+  float y = layout[0].thickness / 2.0f;
+  for (size_t i = 0; i < count; i++) {
+    layout[i].y_center = y;
+    if (i < count - 1)
+      y += layout[i].thickness / 2.0f + gap + layout[i + 1].thickness / 2.0f;
+  }
+}
+
+/* Centers of the flows once stacked edge to edge around `center_y`. */
+static float stack_flows(const flow_layout_t *layout, size_t count,
+                         float center_y, float *centers) {
+  float stack_height = 0;
+  for (size_t i = 0; i < count; i++)
+    stack_height += layout[i].thickness;
+  float y = center_y - stack_height / 2.0f;
+  for (size_t i = 0; i < count; i++) {
+    centers[i] = y + layout[i].thickness / 2.0f;
+    y += layout[i].thickness;
+  }
+  return stack_height;
+}
+
+bool sankey_raster_render(const sankey_raster_target_t *target, uint32_t bg,
+                          const sankey_raster_flow_t *inputs,
+                          size_t input_count,
+                          const sankey_raster_flow_t *outputs,
+                          size_t output_count, uint64_t total_ref) {
+  if (!target || !target->data || target->width <= 0 || target->height <= 0)
+    return false;
+
+  clear_target(target, rgb888_to_565((bg >> 16) & 0xFF, (bg >> 8) & 0xFF,
+                                     bg & 0xFF));
+  if (!inputs || !outputs || input_count == 0 || output_count == 0)
+    return true;
+  if (input_count > SANKEY_RASTER_MAX_FLOWS)
+    input_count = SANKEY_RASTER_MAX_FLOWS;
+  if (output_count > SANKEY_RASTER_MAX_FLOWS)
+    output_count = SANKEY_RASTER_MAX_FLOWS;
+  if (total_ref == 0)
+    total_ref = 1;
+
+  int32_t width = target->width;
+  int32_t height = target->height;
+
+  /* Four column runs (left fade, input ribbons, output ribbons, right fade),
+   * none wider than the target, plus one gradient LUT reused per flow. */
+  size_t cols = (size_t)width + 1;
+  q16_t *tables = malloc(cols * 8 * sizeof(q16_t));
+  uint16_t *lut = malloc(cols * sizeof(uint16_t));
+  if (!tables || !lut) {
+    free(tables);
+    free(lut);
+    return false;
+  }
+  column_table_t fade_in = {.ease = tables, .lerp = tables + cols};
+  column_table_t ribbon_in = {.ease = tables + 2 * cols,
+                              .lerp = tables + 3 * cols};
+  column_table_t ribbon_out = {.ease = tables + 4 * cols,
+                               .lerp = tables + 5 * cols};
+  column_table_t fade_out = {.ease = tables + 6 * cols,
+                             .lerp = tables + 7 * cols};
+
+  flow_layout_t in_layout[SANKEY_RASTER_MAX_FLOWS];
+  flow_layout_t out_layout[SANKEY_RASTER_MAX_FLOWS];
+  float in_centers[SANKEY_RASTER_MAX_FLOWS];
+  float out_centers[SANKEY_RASTER_MAX_FLOWS];
+  calculate_flow_layout(in_layout, inputs, input_count, total_ref, height);
+  calculate_flow_layout(out_layout, outputs, output_count, total_ref, height);
+
+  float center_x = width / 2.0f;
+  float center_y = height / 2.0f;
+  float in_stack = stack_flows(in_layout, input_count, center_y, in_centers);
+  float out_stack =
+      stack_flows(out_layout, output_count, center_y, out_centers);
+
+  float fade_width = width * 0.05f;
+  float fade_start_x = width - fade_width;
+
+  // Central "transaction" rectangle (10% of width)
+  float rect_width = width * 0.1f;
+  float rect_left = center_x - rect_width / 2.0f;
+  float rect_right = center_x + rect_width / 2.0f;
+  float stack_height = (in_stack > out_stack) ? in_stack : out_stack;
+
+  int32_t fade_in_end = (int32_t)fade_width;
+  build_columns(&fade_in, 0, fade_in_end, 0.0f, (float)fade_in_end);
+  build_columns(&ribbon_in, (int32_t)(fade_width + 0.5f),
+                (int32_t)(rect_left + 0.5f), fade_width, rect_left);
+  build_columns(&ribbon_out, (int32_t)(rect_right + 0.5f),
+                (int32_t)(fade_start_x + 0.5f), rect_right, fade_start_x);
+  int32_t fade_out_start = (int32_t)fade_start_x;
+  build_columns(&fade_out, fade_out_start, width - 1, (float)fade_out_start,
+                (float)(width - 1));
+
+  const uint32_t white = 0xFFFFFF;
+
+  for (size_t i = 0; i < input_count; i++) {
+    float half = in_layout[i].thickness / 2.0f;
+    q16_t top = to_q16(in_layout[i].y_center - half);
+    q16_t bot = to_q16(in_layout[i].y_center + half);
+    if (fade_in.count > 1) {
+      build_gradient(lut, &fade_in, bg, inputs[i].color);
+      draw_band(target, &fade_in, lut, top, bot);
+    }
+    build_gradient(lut, &ribbon_in, inputs[i].color, white);
+    draw_ribbon(target, &ribbon_in, lut, top, bot,
+                to_q16(in_centers[i] - half), to_q16(in_centers[i] + half));
+  }
+
+  for (size_t i = 0; i < output_count; i++) {
+    float half = out_layout[i].thickness / 2.0f;
+    q16_t top = to_q16(out_layout[i].y_center - half);
+    q16_t bot = to_q16(out_layout[i].y_center + half);
+    build_gradient(lut, &ribbon_out, white, outputs[i].color);
+    draw_ribbon(target, &ribbon_out, lut, to_q16(out_centers[i] - half),
+                to_q16(out_centers[i] + half), top, bot);
+    if (fade_out.count > 1) {
+      build_gradient(lut, &fade_out, outputs[i].color, bg);
+      draw_band(target, &fade_out, lut, top, bot);
+    }
+  }
+
+  // Draw central rectangle last to cover AA artifacts at junctions
+  uint16_t white16 = rgb888_to_565(0xFF, 0xFF, 0xFF);
+  q16_t rect_top = to_q16(center_y - stack_height / 2.0f);
+  q16_t rect_bot = to_q16(center_y + stack_height / 2.0f);
+  for (int32_t x = (int32_t)rect_left; x <= (int32_t)rect_right; x++)
+    draw_column(target, x, rect_top, rect_bot, white16);
+
+  free(tables);
+  free(lut);
+  return true;
+}
@@ -0,0 +1,37 @@
+#ifndef SANKEY_RASTER_H
+#define SANKEY_RASTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Rasterizer behind sankey.c. It only touches a plain RGB565 buffer, so the
+ * host tests can render and time diagrams without LVGL. */
+
+#define SANKEY_RASTER_MAX_FLOWS 16
+
+typedef struct {
+  uint64_t amount;
+  uint32_t color; /* 0xRRGGBB */
+} sankey_raster_flow_t;
+
+typedef struct {
+  uint8_t *data;   /* RGB565 pixels */
+  uint32_t stride; /* bytes per row */
+  int32_t width;
+  int32_t height;
+} sankey_raster_target_t;
+
+/* Clear `target` to `bg` (0xRRGGBB) and draw the diagram: inputs fade in from
+ * the left edge, converge on a central rectangle and fan out to the outputs,
+ * which fade out at the right edge. Flow thickness is relative to
+ * `total_ref`. Only the background is drawn when either side is empty.
+ * Returns false if the per-column scratch tables cannot be allocated, in
+ * which case the buffer is left cleared. */
+bool sankey_raster_render(const sankey_raster_target_t *target, uint32_t bg,
+                          const sankey_raster_flow_t *inputs,
+                          size_t input_count,
+                          const sankey_raster_flow_t *outputs,
+                          size_t output_count, uint64_t total_ref);
+
+#endif
@@ -0,0 +1,38 @@
+#include "settings_commit.h"
+#include "../core/settings.h"
+#include "deadline.h"
+#include <esp_log.h>
+#include <stdint.h>
+
+// A commit only has to land a couple of seconds after the last change.
+#define SETTINGS_COMMIT_SLACK_MS 500
+
+static const char *TAG = "settings_commit";
+
+static int commit_deadline = -1;
+
+static void commit_cb(void *user_data) {
+  (void)user_data;
+  settings_flush();
+}
+
+static void commit_arm(uint32_t delay_ms) {
+  ui_deadline_arm(commit_deadline, delay_ms, 0);
+}
+
+static void commit_cancel(void) { ui_deadline_cancel(commit_deadline); }
+
+void ui_settings_commit_init(void) {
+  if (commit_deadline >= 0)
+    return;
+  commit_deadline = ui_deadline_add(commit_cb, NULL, SETTINGS_COMMIT_SLACK_MS);
+  if (commit_deadline < 0) {
+    ESP_LOGW(TAG, "No commit deadline, settings are committed on every change");
+    return;
+  }
+  const settings_commit_timer_t timer = {
+      .arm = commit_arm,
+      .cancel = commit_cancel,
+  };
+  settings_set_commit_timer(&timer);
+}
@@ -0,0 +1,12 @@
+#ifndef SETTINGS_COMMIT_H
+#define SETTINGS_COMMIT_H
+
+/**
+ * Run the debounced settings commit from a UI deadline, so the NVS write
+ * (encrypted on device) happens on the LVGL task instead of blocking the
+ * esp_timer task. Until this is called each change is committed at once.
+ * Needs the LVGL lock.
+ */
+void ui_settings_commit_init(void);
+
+#endif
@@ -1,6 +1,5 @@
 #include "text_fit.h"
 #include "theme_widgets.h"
-#include <stdio.h>
 #include <string.h>
 
 int32_t ui_text_width_px(const char *text, const lv_font_t *font) {
@@ -9,30 +8,86 @@ int32_t ui_text_width_px(const char *text, const lv_font_t *font) {
   return size.x;
 }
 
+/* Advances of the printable ASCII letters (every bech32 and base58 character)
+ * for the fonts in use. Lone advances are kept for the whole range; kerned
+ * pairs go to a small direct-mapped table, which holds most of the pairs
+ * appearing in a page of addresses. */
+#define ADVANCE_CACHE_FONTS 2
+#define ADVANCE_FIRST 0x20
+#define ADVANCE_COUNT 95
+#define ADVANCE_PAIR_SLOTS 128
+#define ADVANCE_UNKNOWN 0xFF
+
+typedef struct {
+  const lv_font_t *font;
+  const void *dsc; /* catches a font struct re-initialized in place */
+  uint8_t lone[ADVANCE_COUNT];
+  uint16_t pair_key[ADVANCE_PAIR_SLOTS]; /* 0: empty */
+  uint8_t pair_advance[ADVANCE_PAIR_SLOTS];
+} advance_cache_t;
+
+static advance_cache_t advance_cache[ADVANCE_CACHE_FONTS];
+static size_t advance_cache_next;
+
+static advance_cache_t *advance_cache_for(const lv_font_t *font) {
+  for (size_t i = 0; i < ADVANCE_CACHE_FONTS; i++) {
+    if (advance_cache[i].font == font && advance_cache[i].dsc == font->dsc)
+      return &advance_cache[i];
+  }
+  advance_cache_t *c = &advance_cache[advance_cache_next];
+  advance_cache_next = (advance_cache_next + 1) % ADVANCE_CACHE_FONTS;
+  memset(c, 0, sizeof(*c));
+  memset(c->lone, ADVANCE_UNKNOWN, sizeof(c->lone));
+  c->font = font;
+  c->dsc = font->dsc;
+  return c;
+}
+
+static bool is_cached_letter(uint32_t letter) {
+  return letter >= ADVANCE_FIRST && letter < ADVANCE_FIRST + ADVANCE_COUNT;
+}
+
+static int32_t cached_advance(void *ctx, uint32_t letter, uint32_t next) {
+  advance_cache_t *c = ctx;
+  if (!is_cached_letter(letter))
+    return lv_font_get_glyph_width(c->font, letter, next);
+
+  if (next == 0) {
+    uint8_t *slot = &c->lone[letter - ADVANCE_FIRST];
+    if (*slot != ADVANCE_UNKNOWN)
+      return *slot;
+    uint16_t w = lv_font_get_glyph_width(c->font, letter, 0);
+    if (w < ADVANCE_UNKNOWN)
+      *slot = (uint8_t)w;
+    return w;
+  }
+
+  if (!is_cached_letter(next))
+    return lv_font_get_glyph_width(c->font, letter, next);
+  uint16_t key = (uint16_t)((letter - ADVANCE_FIRST) * ADVANCE_COUNT +
+                            (next - ADVANCE_FIRST) + 1);
+  size_t slot = (letter * 31 + next) % ADVANCE_PAIR_SLOTS;
+  if (c->pair_key[slot] == key)
+    return c->pair_advance[slot];
+  uint16_t w = lv_font_get_glyph_width(c->font, letter, next);
+  if (w <= UINT8_MAX) {
+    c->pair_key[slot] = key;
+    c->pair_advance[slot] = (uint8_t)w;
+  }
+  return w;
+}
+
 ui_text_fit_t ui_text_fit_middle(const char *text, const lv_font_t *font,
                                  int32_t max_width) {
   ui_text_fit_t fit = {0};
-  size_t len = strlen(text);
-  int32_t ellipsis_w = ui_text_width_px("...", font);
-
-  snprintf(fit.prefix, sizeof(fit.prefix), "%s", text);
-  if (ui_text_width_px(fit.prefix, font) <= max_width)
+  text_fit_cut_t cut;
+  if (!text_fit_layout_cut(text, cached_advance, advance_cache_for(font),
+                           max_width, &cut))
     return fit;
-  if (ellipsis_w > max_width)
-    return (ui_text_fit_t){0};
-
-  for (size_t visible = len - 1; visible > 1; visible--) {
-    size_t prefix = visible * 55 / 100;
-    size_t suffix = visible - prefix;
-    snprintf(fit.prefix, sizeof(fit.prefix), "%.*s", (int)prefix, text);
-    snprintf(fit.suffix, sizeof(fit.suffix), "%s", text + len - suffix);
-    if (ui_text_width_px(fit.prefix, font) + ellipsis_w +
-            ui_text_width_px(fit.suffix, font) <=
-        max_width)
-      return fit;
-  }
 
-  return (ui_text_fit_t){0};
+  memcpy(fit.prefix, text, cut.prefix_len);
+  memcpy(fit.suffix, text + strlen(text) - cut.suffix_len, cut.suffix_len);
+  return fit;
 }
 
 static lv_obj_t *create_part_label(lv_obj_t *parent, const char *text,
@@ -59,10 +114,29 @@ lv_obj_t *ui_text_fit_row_create(lv_obj_t *parent, const ui_text_fit_t *fit,
   lv_obj_clear_flag(row, LV_OBJ_FLAG_CLICKABLE);
   lv_obj_clear_flag(row, LV_OBJ_FLAG_SCROLLABLE);
 
-  create_part_label(row, fit->prefix, font, color, LV_TEXT_ALIGN_LEFT);
+  // All three parts always exist so the row can be re-bound; the ellipsis and
+  // suffix are hidden (and skipped by the flex layout) for single-piece text.
+  create_part_label(row, "", font, color, LV_TEXT_ALIGN_LEFT);
+  create_part_label(row, "...", font, color, LV_TEXT_ALIGN_CENTER);
+  create_part_label(row, "", font, color, LV_TEXT_ALIGN_RIGHT);
+  ui_text_fit_row_set(row, fit);
+  return row;
+}
+
+void ui_text_fit_row_set(lv_obj_t *row, const ui_text_fit_t *fit) {
+  lv_obj_t *prefix = lv_obj_get_child(row, 0);
+  lv_obj_t *ellipsis = lv_obj_get_child(row, 1);
+  lv_obj_t *suffix = lv_obj_get_child(row, 2);
+  if (!prefix || !ellipsis || !suffix)
+    return;
+
+  lv_label_set_text(prefix, fit->prefix);
+  lv_label_set_text(suffix, fit->suffix);
   if (fit->suffix[0] != '\0') {
-    create_part_label(row, "...", font, color, LV_TEXT_ALIGN_CENTER);
-    create_part_label(row, fit->suffix, font, color, LV_TEXT_ALIGN_RIGHT);
+    lv_obj_clear_flag(ellipsis, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_clear_flag(suffix, LV_OBJ_FLAG_HIDDEN);
+  } else {
+    lv_obj_add_flag(ellipsis, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_flag(suffix, LV_OBJ_FLAG_HIDDEN);
   }
-  return row;
 }
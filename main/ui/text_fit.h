@@ -10,8 +10,9 @@
 #define UI_TEXT_FIT_H
 
 #include "lvgl.h"
+#include "text_fit_layout.h"
 
-#define UI_TEXT_FIT_PART_LEN 128
+#define UI_TEXT_FIT_PART_LEN (TEXT_FIT_LAYOUT_MAX_PART + 1)
 
 typedef struct {
   char prefix[UI_TEXT_FIT_PART_LEN];
@@ -40,4 +41,10 @@ lv_obj_t *ui_text_fit_row_create(lv_obj_t *parent, const ui_text_fit_t *fit,
                                  const lv_font_t *font, int32_t width,
                                  lv_color_t color);
 
+/**
+ * Re-bind a row made by ui_text_fit_row_create() to a new fitted string
+ * without recreating its labels.
+ */
+void ui_text_fit_row_set(lv_obj_t *row, const ui_text_fit_t *fit);
+
 #endif // UI_TEXT_FIT_H
@@ -0,0 +1,50 @@
+#include "text_fit_layout.h"
+#include <string.h>
+
+/* Share of the visible letters kept in front of the ellipsis. */
+#define PREFIX_PERCENT 55
+
+bool text_fit_layout_cut(const char *text, text_fit_advance_cb_t advance,
+                         void *ctx, int32_t max_width, text_fit_cut_t *cut) {
+  const unsigned char *t = (const unsigned char *)text;
+  size_t len = strlen(text);
+  size_t part_max = len < TEXT_FIT_LAYOUT_MAX_PART ? len
+                                                   : TEXT_FIT_LAYOUT_MAX_PART;
+
+  /* head[p]: width of the first p letters on their own, the last one with no
+   * kerning partner. tail[s]: width of the last s letters. */
+  int32_t head[TEXT_FIT_LAYOUT_MAX_PART + 1];
+  int32_t tail[TEXT_FIT_LAYOUT_MAX_PART + 1];
+  int32_t kerned = 0;
+  head[0] = 0;
+  tail[0] = 0;
+  for (size_t i = 0; i < part_max; i++) {
+    head[i + 1] = kerned + advance(ctx, t[i], 0);
+    kerned += advance(ctx, t[i], t[i + 1]);
+    size_t j = len - 1 - i;
+    tail[i + 1] = tail[i] + advance(ctx, t[j], t[j + 1]);
+  }
+
+  if (len <= TEXT_FIT_LAYOUT_MAX_PART && tail[len] <= max_width) {
+    *cut = (text_fit_cut_t){.prefix_len = len, .suffix_len = 0};
+    return true;
+  }
+
+  int32_t ellipsis_w = 2 * advance(ctx, '.', '.') + advance(ctx, '.', 0);
+  if (ellipsis_w > max_width)
+    return false;
+
+  /* Kerning can make a longer cut narrower than a shorter one, so every
+   * length is tried from the longest down; each try is two table lookups. */
+  for (size_t visible = len > 0 ? len - 1 : 0; visible > 1; visible--) {
+    size_t prefix = visible * PREFIX_PERCENT / 100;
+    size_t suffix = visible - prefix;
+    if (prefix > part_max || suffix > part_max)
+      continue;
+    if (head[prefix] + ellipsis_w + tail[suffix] <= max_width) {
+      *cut = (text_fit_cut_t){.prefix_len = prefix, .suffix_len = suffix};
+      return true;
+    }
+  }
+  return false;
+}
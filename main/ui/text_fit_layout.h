@@ -0,0 +1,43 @@
+/**
+ * Middle-ellipsis cut search behind text_fit.c, free of LVGL so the host tests
+ * can run it against synthetic fonts.
+ *
+ * Text is measured byte by byte, which matches LVGL for the ASCII strings this
+ * is used on (addresses, xpubs, descriptors).
+ */
+
+#ifndef TEXT_FIT_LAYOUT_H
+#define TEXT_FIT_LAYOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Longest prefix or suffix a cut may keep. */
+#define TEXT_FIT_LAYOUT_MAX_PART 127
+
+/**
+ * Advance of `letter` in pixels when followed by `next` (0 at the end of the
+ * measured string), kerning included. A string's width is the sum of its
+ * letters' advances, as lv_text_get_width() computes it.
+ */
+typedef int32_t (*text_fit_advance_cb_t)(void *ctx, uint32_t letter,
+                                         uint32_t next);
+
+typedef struct {
+  size_t prefix_len;
+  size_t suffix_len; /* 0: the whole text fits and prefix_len is its length */
+} text_fit_cut_t;
+
+/**
+ * Find the longest cut, keeping 55% of the visible letters in front, such that
+ * prefix + "..." + suffix fits within max_width pixels. Each letter's advance
+ * is measured once, so the search is linear in the text length.
+ *
+ * Returns false if nothing fits: not even "...", or no cut of at least two
+ * letters.
+ */
+bool text_fit_layout_cut(const char *text, text_fit_advance_cb_t advance,
+                         void *ctx, int32_t max_width, text_fit_cut_t *cut);
+
+#endif // TEXT_FIT_LAYOUT_H
@@ -0,0 +1,300 @@
+// Video View - LVGL side of the camera video layer
+
+#include "video_view.h"
+
+#include <bsp/video_layer.h>
+#include <stddef.h>
+
+// UI objects drawn over the preview when it is attached; each one splits the
+// area into more tiles, i.e. more PPA copies per frame.
+#define VIDEO_VIEW_MAX_HOLES 4
+// Pieces an invalidation is split into around the tiles.
+#define VIDEO_VIEW_MAX_PIECES 16
+
+typedef struct {
+  lv_obj_t *root;
+  const lv_area_t *targets;
+  size_t target_count;
+  lv_area_t *holes; // NULL: stop at the first overlap
+  size_t hole_count;
+  size_t max_holes;
+  bool overlap;
+} overlap_walk_t;
+
+static lv_obj_t *view_obj = NULL;
+static lv_display_t *view_disp = NULL;
+static lv_area_t view_area;
+static lv_area_t tiles[BSP_VIDEO_LAYER_MAX_TILES];
+static size_t tile_count = 0;
+// One pixel outside every tile, redrawn in place of invalidations that fall
+// entirely on the video (an invalidation cannot be dropped outright).
+static lv_area_t spare_pixel;
+static bool has_spare_pixel = false;
+static bool layer_open = false;
+
+// a minus b as up to four disjoint areas: full-width bands above and below b,
+// then the parts left and right of it.
+static size_t area_subtract(const lv_area_t *a, const lv_area_t *b,
+                            lv_area_t out[4]) {
+  lv_area_t common;
+  if (!lv_area_intersect(&common, a, b)) {
+    out[0] = *a;
+    return 1;
+  }
+  size_t n = 0;
+  if (a->y1 < common.y1)
+    out[n++] = (lv_area_t){a->x1, a->y1, a->x2, common.y1 - 1};
+  if (common.y2 < a->y2)
+    out[n++] = (lv_area_t){a->x1, common.y2 + 1, a->x2, a->y2};
+  if (a->x1 < common.x1)
+    out[n++] = (lv_area_t){a->x1, common.y1, common.x1 - 1, common.y2};
+  if (common.x2 < a->x2)
+    out[n++] = (lv_area_t){common.x2 + 1, common.y1, a->x2, common.y2};
+  return n;
+}
+
+// area minus every cut, in out[]. False if it takes more than max pieces.
+static bool area_subtract_all(const lv_area_t *area, const lv_area_t *cuts,
+                              size_t cut_count, lv_area_t *out, size_t max,
+                              size_t *out_count) {
+  lv_area_t scratch[VIDEO_VIEW_MAX_PIECES];
+  if (max > VIDEO_VIEW_MAX_PIECES)
+    max = VIDEO_VIEW_MAX_PIECES;
+  out[0] = *area;
+  size_t n = 1;
+  for (size_t c = 0; c < cut_count && n > 0; c++) {
+    size_t next = 0;
+    for (size_t i = 0; i < n; i++) {
+      lv_area_t parts[4];
+      size_t count = area_subtract(&out[i], &cuts[c], parts);
+      if (next + count > max)
+        return false;
+      for (size_t p = 0; p < count; p++)
+        scratch[next++] = parts[p];
+    }
+    for (size_t i = 0; i < next; i++)
+      out[i] = scratch[i];
+    n = next;
+  }
+  *out_count = n;
+  return true;
+}
+
+static bool overlaps_any(const lv_area_t *area, const lv_area_t *targets,
+                         size_t count) {
+  lv_area_t common;
+  for (size_t i = 0; i < count; i++) {
+    if (lv_area_intersect(&common, area, &targets[i]))
+      return true;
+  }
+  return false;
+}
+
+static bool is_view_ancestor(const lv_obj_t *obj) {
+  for (lv_obj_t *p = lv_obj_get_parent(view_obj); p; p = lv_obj_get_parent(p)) {
+    if (p == obj)
+      return true;
+  }
+  return false;
+}
+
+// Visible objects other than the view, its children and its ancestors whose
+// drawing reaches into the targets.
+static lv_obj_tree_walk_res_t overlap_walk_cb(lv_obj_t *obj, void *user_data) {
+  overlap_walk_t *walk = user_data;
+  if (obj == walk->root || is_view_ancestor(obj))
+    return LV_OBJ_TREE_WALK_NEXT;
+  if (obj == view_obj || lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN))
+    return LV_OBJ_TREE_WALK_SKIP_CHILDREN;
+
+  lv_area_t box;
+  lv_obj_get_coords(obj, &box);
+  int32_t ext = lv_obj_get_ext_draw_size(obj);
+  lv_area_increase(&box, ext, ext);
+  // Children can overflow a parent that misses the area.
+  if (!overlaps_any(&box, walk->targets, walk->target_count))
+    return LV_OBJ_TREE_WALK_NEXT;
+
+  walk->overlap = true;
+  if (!walk->holes)
+    return LV_OBJ_TREE_WALK_END;
+  if (walk->hole_count == walk->max_holes) {
+    walk->hole_count++;
+    return LV_OBJ_TREE_WALK_END;
+  }
+  lv_area_intersect(&walk->holes[walk->hole_count++], &box, &view_area);
+  return LV_OBJ_TREE_WALK_SKIP_CHILDREN;
+}
+
+static void overlap_walk(overlap_walk_t *walk) {
+  lv_obj_t *roots[] = {lv_obj_get_screen(view_obj),
+                       lv_display_get_layer_top(view_disp),
+                       lv_display_get_layer_sys(view_disp)};
+  for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+    if (!roots[i])
+      continue;
+    walk->root = roots[i];
+    lv_obj_tree_walk(roots[i], overlap_walk_cb, walk);
+    if (walk->overlap && !walk->holes)
+      return;
+    if (walk->hole_count > walk->max_holes)
+      return;
+  }
+}
+
+// The video may be shown: the view is on the active screen and nothing has
+// been drawn over its tiles since it was attached.
+static bool view_is_clear(void) {
+  if (lv_obj_get_screen(view_obj) != lv_display_get_screen_active(view_disp) ||
+      !lv_obj_is_visible(view_obj))
+    return false;
+  overlap_walk_t walk = {.targets = tiles, .target_count = tile_count};
+  overlap_walk(&walk);
+  return !walk.overlap;
+}
+
+static void open_layer(void) {
+  bsp_video_rect_t frame = {
+      .x = (uint16_t)view_area.x1,
+      .y = (uint16_t)view_area.y1,
+      .w = (uint16_t)lv_area_get_width(&view_area),
+      .h = (uint16_t)lv_area_get_height(&view_area),
+  };
+  bsp_video_rect_t rects[BSP_VIDEO_LAYER_MAX_TILES];
+  for (size_t i = 0; i < tile_count; i++) {
+    rects[i] = (bsp_video_rect_t){
+        .x = (uint16_t)(tiles[i].x1 - view_area.x1),
+        .y = (uint16_t)(tiles[i].y1 - view_area.y1),
+        .w = (uint16_t)lv_area_get_width(&tiles[i]),
+        .h = (uint16_t)lv_area_get_height(&tiles[i]),
+    };
+  }
+  layer_open = bsp_video_layer_open(&frame, rects, tile_count) == ESP_OK;
+}
+
+static void close_layer(void) {
+  bsp_video_layer_close();
+  layer_open = false;
+}
+
+static void invalidate_area_cb(lv_event_t *e) {
+  lv_area_t *area = lv_event_get_invalidated_area(e);
+  lv_area_t common;
+  if (!view_obj || !area || !lv_area_intersect(&common, area, &view_area))
+    return;
+
+  bool clear = view_is_clear();
+  if (clear && !layer_open) {
+    open_layer();
+  } else if (!clear && layer_open) {
+    // Frames stop landing here; let LVGL paint the whole area under
+    // whatever now covers it. Re-entrant: this invalidation passes through.
+    close_layer();
+    lv_obj_invalidate(view_obj);
+  }
+  if (!layer_open)
+    return;
+
+  lv_area_t pieces[VIDEO_VIEW_MAX_PIECES];
+  size_t count;
+  if (!area_subtract_all(area, tiles, tile_count, pieces,
+                         VIDEO_VIEW_MAX_PIECES, &count))
+    return; // the video repairs it on the next frame
+  if (count == 0) {
+    if (has_spare_pixel)
+      *area = spare_pixel;
+    return;
+  }
+  *area = pieces[0];
+  // These miss the tiles, so they come back through here unchanged.
+  for (size_t i = 1; i < count; i++)
+    lv_inv_area(view_disp, &pieces[i]);
+}
+
+static void find_spare_pixel(const lv_area_t *holes, size_t hole_count) {
+  int32_t w = lv_display_get_horizontal_resolution(view_disp);
+  int32_t h = lv_display_get_vertical_resolution(view_disp);
+  lv_point_t candidates[4 + VIDEO_VIEW_MAX_HOLES] = {
+      {0, 0}, {w - 1, 0}, {0, h - 1}, {w - 1, h - 1}};
+  size_t count = 4;
+  for (size_t i = 0; i < hole_count; i++)
+    candidates[count++] = (lv_point_t){holes[i].x1, holes[i].y1};
+
+  has_spare_pixel = false;
+  for (size_t i = 0; i < count; i++) {
+    lv_area_t pixel = {candidates[i].x, candidates[i].y, candidates[i].x,
+                       candidates[i].y};
+    if (!overlaps_any(&pixel, tiles, tile_count)) {
+      spare_pixel = pixel;
+      has_spare_pixel = true;
+      return;
+    }
+  }
+}
+
+static void view_delete_cb(lv_event_t *e) {
+  (void)e;
+  lv_display_remove_event_cb_with_user_data(view_disp, invalidate_area_cb,
+                                            NULL);
+  close_layer();
+  // Deleting an ancestor invalidated this area while it was still cut out;
+  // repaint it so the last video frame does not linger.
+  lv_inv_area(view_disp, &view_area);
+  view_obj = NULL;
+  view_disp = NULL;
+  tile_count = 0;
+}
+
+bool video_view_attach(lv_obj_t *obj) {
+  video_view_detach();
+  if (!obj || !bsp_video_layer_available())
+    return false;
+  lv_display_t *disp = lv_obj_get_display(obj);
+  if (!disp || lv_display_get_rotation(disp) != LV_DISPLAY_ROTATION_0)
+    return false;
+
+  view_obj = obj;
+  view_disp = disp;
+  lv_obj_update_layout(obj);
+  lv_obj_get_coords(obj, &view_area);
+
+  lv_area_t holes[VIDEO_VIEW_MAX_HOLES];
+  overlap_walk_t walk = {.targets = &view_area,
+                         .target_count = 1,
+                         .holes = holes,
+                         .max_holes = VIDEO_VIEW_MAX_HOLES};
+  overlap_walk(&walk);
+  if (walk.hole_count > VIDEO_VIEW_MAX_HOLES ||
+      !area_subtract_all(&view_area, holes, walk.hole_count, tiles,
+                         BSP_VIDEO_LAYER_MAX_TILES, &tile_count) ||
+      tile_count == 0) {
+    view_obj = NULL;
+    view_disp = NULL;
+    tile_count = 0;
+    return false;
+  }
+  find_spare_pixel(holes, walk.hole_count);
+
+  open_layer();
+  if (!layer_open) {
+    view_obj = NULL;
+    view_disp = NULL;
+    tile_count = 0;
+    return false;
+  }
+  lv_display_add_event_cb(disp, invalidate_area_cb, LV_EVENT_INVALIDATE_AREA,
+                          NULL);
+  lv_obj_add_event_cb(obj, view_delete_cb, LV_EVENT_DELETE, NULL);
+  return true;
+}
+
+void video_view_detach(void) {
+  if (!view_obj)
+    return;
+  lv_obj_remove_event_cb(view_obj, view_delete_cb);
+  view_delete_cb(NULL);
+}
+
+bool video_view_present(const void *rgb565) {
+  return bsp_video_layer_present(rgb565) == ESP_OK;
+}
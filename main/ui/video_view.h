@@ -0,0 +1,35 @@
+#ifndef VIDEO_VIEW_H
+#define VIDEO_VIEW_H
+
+#include <lvgl.h>
+#include <stdbool.h>
+
+/* Puts a camera preview on the board's video layer (bsp/video_layer.h):
+ * frames go straight into the frame buffers and LVGL only draws the chrome
+ * around them.
+ *
+ * The object stays in the tree for layout and touch, but its area is cut out
+ * of every display invalidation, so LVGL never re-renders or flushes over the
+ * video. Objects already drawn over it when it is attached (titles, corner
+ * buttons) keep their boxes: the video is not written under them. Anything
+ * that covers the area later (an overlay, a dialog, another page) hands it
+ * back to LVGL on its first invalidation there; video_view_present() then
+ * fails and the caller draws the frame through its lv_image as before, until
+ * the area is clear again.
+ *
+ * One view at a time. It is released when its object is deleted. */
+
+/* Call with the LVGL lock held, once the object and the chrome around it
+ * exist. The object must be the size of the frames to be presented. Returns
+ * false where the board has no video layer or the area cannot be claimed;
+ * the caller keeps using an lv_image. */
+bool video_view_attach(lv_obj_t *obj);
+
+/* Releases the area back to LVGL. LVGL lock held. */
+void video_view_detach(void);
+
+/* Copies one RGB565 frame (cache-line aligned) onto the screen. Any task, no
+ * LVGL lock. False while the view is detached or handed back to LVGL. */
+bool video_view_present(const void *rgb565);
+
+#endif // VIDEO_VIEW_H
@@ -0,0 +1,149 @@
+// Scratch arena allocator for per-operation sessions
+
+#include "arena.h"
+#include "secure_mem.h"
+
+#include <esp_heap_caps.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ARENA_ALIGN alignof(max_align_t)
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct arena_chunk {
+  arena_chunk_t *prev;
+  size_t size;   /* usable bytes after the header */
+  size_t offset; /* bytes handed out */
+};
+
+#define CHUNK_HEADER ALIGN_UP(sizeof(arena_chunk_t))
+
+static inline uint8_t *chunk_data(arena_chunk_t *chunk) {
+  return (uint8_t *)chunk + CHUNK_HEADER;
+}
+
+static void *mem_alloc(size_t size, arena_mem_t mem) {
+  void *p = NULL;
+  switch (mem) {
+  case ARENA_MEM_PSRAM:
+    p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p)
+      return p;
+    /* fall through */
+  case ARENA_MEM_INTERNAL:
+    p = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (p)
+      return p;
+    /* fall through */
+  default:
+    return malloc(size);
+  }
+}
+
+static void chunk_free(arena_t *arena, arena_chunk_t *chunk) {
+  secure_memzero(chunk_data(chunk), chunk->offset);
+  heap_caps_free(chunk);
+  arena->chunks--;
+}
+
+void arena_init(arena_t *arena, size_t chunk_size, arena_mem_t mem) {
+  memset(arena, 0, sizeof(*arena));
+  arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+  arena->mem = mem;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+  if (!arena || size == 0 || size > SIZE_MAX / 2)
+    return NULL;
+  size = ALIGN_UP(size);
+
+  arena_chunk_t *chunk = arena->head;
+  if (!chunk || chunk->size - chunk->offset < size) {
+    size_t data_size = size > arena->chunk_size ? size : arena->chunk_size;
+    chunk = mem_alloc(CHUNK_HEADER + data_size, arena->mem);
+    if (!chunk)
+      return NULL;
+    chunk->prev = arena->head;
+    chunk->size = data_size;
+    chunk->offset = 0;
+    arena->head = chunk;
+    arena->chunks++;
+  }
+
+  void *p = chunk_data(chunk) + chunk->offset;
+  chunk->offset += size;
+  arena->used += size;
+  if (arena->used > arena->peak)
+    arena->peak = arena->used;
+  return p;
+}
+
+void *arena_calloc(arena_t *arena, size_t count, size_t size) {
+  if (size && count > SIZE_MAX / size)
+    return NULL;
+  void *p = arena_alloc(arena, count * size);
+  if (p)
+    memset(p, 0, count * size);
+  return p;
+}
+
+char *arena_strndup(arena_t *arena, const char *str, size_t len) {
+  if (!str)
+    return NULL;
+  char *copy = arena_alloc(arena, len + 1);
+  if (copy) {
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+  }
+  return copy;
+}
+
+char *arena_strdup(arena_t *arena, const char *str) {
+  return str ? arena_strndup(arena, str, strlen(str)) : NULL;
+}
+
+arena_mark_t arena_mark(const arena_t *arena) {
+  arena_mark_t mark = {.chunk = arena->head, .used = arena->used};
+  if (arena->head)
+    mark.offset = arena->head->offset;
+  return mark;
+}
+
+void arena_rewind(arena_t *arena, arena_mark_t mark) {
+  /* A chunk opened after the mark may hold data from before it only if it
+   * is the mark's own chunk, so everything newer goes whole. */
+  while (arena->head && arena->head != mark.chunk) {
+    arena_chunk_t *prev = arena->head->prev;
+    chunk_free(arena, arena->head);
+    arena->head = prev;
+  }
+  if (arena->head && arena->head->offset > mark.offset) {
+    secure_memzero(chunk_data(arena->head) + mark.offset,
+                   arena->head->offset - mark.offset);
+    arena->head->offset = mark.offset;
+  }
+  arena->used = mark.used;
+}
+
+void arena_reset(arena_t *arena) {
+  if (!arena->head)
+    return;
+  while (arena->head->prev) {
+    arena_chunk_t *prev = arena->head->prev;
+    chunk_free(arena, arena->head);
+    arena->head = prev;
+  }
+  secure_memzero(chunk_data(arena->head), arena->head->offset);
+  arena->head->offset = 0;
+  arena->used = 0;
+}
+
+void arena_destroy(arena_t *arena) {
+  while (arena->head) {
+    arena_chunk_t *prev = arena->head->prev;
+    chunk_free(arena, arena->head);
+    arena->head = prev;
+  }
+  arena->used = 0;
+}
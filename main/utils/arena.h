@@ -0,0 +1,70 @@
+/*
+ * Scratch Arena Allocator
+ * Bump allocation for per-operation sessions (a scan, a PSBT analysis or
+ * signature, a descriptor load): everything the operation allocates comes
+ * from a few large chunks and is zeroized and released at once, instead of
+ * as many small malloc/free pairs interleaved in the shared heap.
+ *
+ * Scopes nest through arena_mark()/arena_rewind(): a rewind releases (and
+ * wipes) everything allocated since the mark, so scratch for one step of a
+ * loop does not accumulate. Marks must be rewound in LIFO order.
+ *
+ * Not thread-safe: an arena belongs to the task running its operation.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Heap a chunk comes from. PSRAM falls back to internal RAM (and internal to
+ * whatever is left) rather than failing. */
+typedef enum {
+  ARENA_MEM_DEFAULT = 0, /* whatever malloc() would use */
+  ARENA_MEM_INTERNAL,    /* internal RAM: small, hot scratch */
+  ARENA_MEM_PSRAM,       /* external RAM: large buffers */
+} arena_mem_t;
+
+/* Chunk size when 0 is passed to arena_init() */
+#define ARENA_DEFAULT_CHUNK_SIZE 4096
+
+typedef struct arena_chunk arena_chunk_t;
+
+typedef struct {
+  arena_chunk_t *head; /* newest chunk; each links to the one before */
+  size_t chunk_size;
+  arena_mem_t mem;
+  size_t used;   /* bytes currently handed out, alignment included */
+  size_t peak;   /* high-water mark of used */
+  size_t chunks; /* chunks currently held */
+} arena_t;
+
+typedef struct {
+  arena_chunk_t *chunk;
+  size_t offset;
+  size_t used;
+} arena_mark_t;
+
+/* No memory is taken until the first allocation. */
+void arena_init(arena_t *arena, size_t chunk_size, arena_mem_t mem);
+
+/* Aligned for any type; NULL on zero size or out of memory. Requests larger
+ * than the chunk size get a chunk of their own. */
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_calloc(arena_t *arena, size_t count, size_t size);
+
+/* NUL-terminated copies; strndup copies exactly len bytes. */
+char *arena_strndup(arena_t *arena, const char *str, size_t len);
+char *arena_strdup(arena_t *arena, const char *str);
+
+arena_mark_t arena_mark(const arena_t *arena);
+/* Wipes and releases everything allocated since mark. */
+void arena_rewind(arena_t *arena, arena_mark_t mark);
+
+/* Wipes everything and keeps the oldest chunk for reuse. */
+void arena_reset(arena_t *arena);
+/* Wipes and frees everything; the arena may be used again afterwards. */
+void arena_destroy(arena_t *arena);
+
+#endif // ARENA_H
@@ -1,96 +1,222 @@
 // BIP39 word filtering utilities for smart keyboard input
 
 #include "bip39_filter.h"
+#include "secure_mem.h"
+#include <stdlib.h>
 #include <string.h>
 #include <wally_bip39.h>
 #include <wally_core.h>
+#include <wally_crypto.h>
 
 static struct words *wordlist = NULL;
 
+/*
+ * Prefix trie over the wordlist, built once by bip39_filter_init(). The
+ * wordlist is sorted, so every node covers a contiguous run of words sharing
+ * its prefix. Children are stored consecutively in letter order: the child for
+ * letter L sits at child_base + popcount(child_mask below L). A node covering
+ * a single word has no children; the rest of a prefix is compared against
+ * that word directly, which keeps the trie to a few thousand nodes.
+ */
+typedef struct {
+  uint16_t first;      // Index of the first word under this prefix
+  uint16_t count;      // Number of words under this prefix
+  uint32_t child_mask; // Bit N set if some word continues with 'a' + N
+  uint16_t child_base; // Node index of the first child
+  uint8_t depth;       // Prefix length
+} prefix_node_t;
+
+static prefix_node_t *trie = NULL;
+
+typedef struct {
+  int first;
+  int count;
+  uint32_t next_letters;
+} prefix_range_t;
+
 // Cache for valid last words to avoid recalculating on every keystroke
 #define MAX_VALID_LAST_WORDS 128
 static const char *valid_last_words_cache[MAX_VALID_LAST_WORDS];
 static int valid_last_words_count = 0;
 
-bool bip39_filter_init(void) {
-  if (wordlist)
-    return true;
-  return bip39_get_wordlist(NULL, &wordlist) == WALLY_OK;
+static inline const char *word_at(size_t index) {
+  return bip39_get_word_by_index(wordlist, index);
 }
 
-uint32_t bip39_filter_get_valid_letters(const char *prefix, int prefix_len) {
-  uint32_t mask = 0;
-  if (!wordlist)
-    return 0xFFFFFFFF;
+static inline bool is_letter(char c) { return c >= 'a' && c <= 'z'; }
+
+static inline uint32_t letter_bit(char c) {
+  return is_letter(c) ? (1u << (c - 'a')) : 0;
+}
 
-  for (int letter = 0; letter < 26; letter++) {
-    char test_prefix[BIP39_MAX_PREFIX_LEN + 2];
-    int test_len = prefix_len + 1;
-
-    if (prefix && prefix_len > 0) {
-      int copy_len =
-          prefix_len < BIP39_MAX_PREFIX_LEN ? prefix_len : BIP39_MAX_PREFIX_LEN;
-      memcpy(test_prefix, prefix, copy_len);
-      test_prefix[copy_len] = 'a' + letter;
-      test_prefix[copy_len + 1] = '\0';
-    } else {
-      test_prefix[0] = 'a' + letter;
-      test_prefix[1] = '\0';
-      test_len = 1;
+/* Number of nodes the trie needs for the words [first, first + count) sharing
+ * a prefix of length depth. */
+static size_t count_trie_nodes(int first, int count, int depth) {
+  size_t nodes = 1;
+  if (count < 2)
+    return nodes;
+
+  int end = first + count;
+  int i = first;
+  while (i < end) {
+    char c = word_at(i)[depth];
+    int run = i;
+    while (run < end && word_at(run)[depth] == c)
+      run++;
+    // A word ending here sorts first and needs no child
+    if (c != '\0')
+      nodes += count_trie_nodes(i, run - i, depth + 1);
+    i = run;
+  }
+  return nodes;
+}
+
+/* Fills the trie breadth-first: nodes are expanded in order, appending their
+ * children at the tail, so each node's children end up contiguous. */
+static void fill_trie(prefix_node_t *nodes) {
+  size_t used = 1;
+  nodes[0] = (prefix_node_t){.first = 0, .count = BIP39_WORDLIST_SIZE};
+
+  for (size_t n = 0; n < used; n++) {
+    prefix_node_t *node = &nodes[n];
+    int depth = node->depth;
+    node->child_base = (uint16_t)used;
+
+    if (node->count == 1) {
+      node->child_mask = letter_bit(word_at(node->first)[depth]);
+      continue;
     }
 
-    for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
-      const char *word = bip39_get_word_by_index(wordlist, i);
-      if (word && strncmp(word, test_prefix, test_len) == 0) {
-        mask |= (1u << letter);
-        break;
+    int end = node->first + node->count;
+    int i = node->first;
+    while (i < end) {
+      char c = word_at(i)[depth];
+      int run = i;
+      while (run < end && word_at(run)[depth] == c)
+        run++;
+      if (c != '\0') {
+        node->child_mask |= letter_bit(c);
+        nodes[used++] = (prefix_node_t){.first = (uint16_t)i,
+                                        .count = (uint16_t)(run - i),
+                                        .depth = (uint8_t)(depth + 1)};
       }
+      i = run;
     }
   }
-  return mask;
+}
+
+/* The trie relies on a sorted, lowercase wordlist. */
+static bool wordlist_is_indexable(void) {
+  const char *prev = NULL;
+  for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
+    const char *word = word_at(i);
+    if (!word || !word[0])
+      return false;
+    for (const char *c = word; *c; c++) {
+      if (!is_letter(*c))
+        return false;
+    }
+    if (prev && strcmp(prev, word) >= 0)
+      return false;
+    prev = word;
+  }
+  return true;
+}
+
+static bool build_trie(void) {
+  if (!wordlist_is_indexable())
+    return false;
+
+  size_t node_count = count_trie_nodes(0, BIP39_WORDLIST_SIZE, 0);
+  if (node_count > UINT16_MAX)
+    return false;
+
+  prefix_node_t *nodes = calloc(node_count, sizeof(prefix_node_t));
+  if (!nodes)
+    return false;
+
+  fill_trie(nodes);
+  trie = nodes;
+  return true;
+}
+
+/* Walks the trie along prefix: one step per character. */
+static prefix_range_t lookup_prefix(const char *prefix, int prefix_len) {
+  prefix_range_t range = {0, 0, 0};
+  const prefix_node_t *node = &trie[0];
+
+  for (int i = 0; i < prefix_len; i++) {
+    if (node->count == 1) {
+      const char *word = word_at(node->first);
+      for (; i < prefix_len; i++) {
+        if (!word[i] || word[i] != prefix[i])
+          return range;
+      }
+      range.first = node->first;
+      range.count = 1;
+      range.next_letters = letter_bit(word[prefix_len]);
+      return range;
+    }
+
+    uint32_t bit = letter_bit(prefix[i]);
+    if (!(node->child_mask & bit))
+      return range;
+    node = &trie[node->child_base +
+                 __builtin_popcount(node->child_mask & (bit - 1))];
+  }
+
+  range.first = node->first;
+  range.count = node->count;
+  range.next_letters = node->child_mask;
+  return range;
+}
+
+bool bip39_filter_init(void) {
+  if (trie)
+    return true;
+  if (!wordlist && bip39_get_wordlist(NULL, &wordlist) != WALLY_OK)
+    return false;
+  return build_trie();
+}
+
+uint32_t bip39_filter_get_valid_letters(const char *prefix, int prefix_len) {
+  if (!trie)
+    return 0xFFFFFFFF;
+  if (!prefix || prefix_len <= 0)
+    return trie[0].child_mask;
+  return lookup_prefix(prefix, prefix_len).next_letters;
 }
 
 int bip39_filter_by_prefix(const char *prefix, int prefix_len,
                            const char **out_words, int max_words) {
-  int count = 0;
-  if (!wordlist || !out_words || max_words <= 0)
+  if (!trie || !out_words || max_words <= 0)
     return 0;
   if (!prefix || prefix_len <= 0)
     return 0;
 
-  for (size_t i = 0; i < BIP39_WORDLIST_SIZE && count < max_words; i++) {
-    const char *word = bip39_get_word_by_index(wordlist, i);
-    if (word && strncmp(word, prefix, prefix_len) == 0) {
-      out_words[count++] = word;
-    }
-  }
+  prefix_range_t range = lookup_prefix(prefix, prefix_len);
+  int count = range.count < max_words ? range.count : max_words;
+  for (int i = 0; i < count; i++)
+    out_words[i] = word_at(range.first + i);
   return count;
 }
 
 int bip39_filter_count_matches(const char *prefix, int prefix_len) {
-  int count = 0;
-  if (!wordlist)
+  if (!trie)
     return 0;
   if (!prefix || prefix_len <= 0)
     return BIP39_WORDLIST_SIZE;
-
-  for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
-    const char *word = bip39_get_word_by_index(wordlist, i);
-    if (word && strncmp(word, prefix, prefix_len) == 0)
-      count++;
-  }
-  return count;
+  return lookup_prefix(prefix, prefix_len).count;
 }
 
 int bip39_filter_get_word_index(const char *word) {
-  if (!wordlist || !word)
+  if (!trie || !word)
     return -1;
 
-  for (size_t i = 0; i < BIP39_WORDLIST_SIZE; i++) {
-    const char *w = bip39_get_word_by_index(wordlist, i);
-    if (w && strcmp(w, word) == 0)
-      return (int)i;
-  }
+  // An exact match sorts before every longer word sharing its prefix
+  prefix_range_t range = lookup_prefix(word, (int)strlen(word));
+  if (range.count > 0 && strcmp(word_at(range.first), word) == 0)
+    return range.first;
   return -1;
 }
 
@@ -110,7 +236,7 @@ static int ensure_last_word_cache(const char entered_words[24][16],
 int bip39_filter_get_valid_last_words(const char entered_words[24][16],
                                       int word_count, const char **out_words,
                                       int max_words) {
-  if (!wordlist || !entered_words || !out_words || max_words <= 0)
+  if (!trie || !entered_words || !out_words || max_words <= 0)
     return 0;
   if (word_count != 12 && word_count != 24)
     return 0;
@@ -128,8 +254,10 @@ int bip39_filter_get_valid_last_words(const char entered_words[24][16],
 
   for (int i = 0; i < word_count - 1; i++) {
     int idx = bip39_filter_get_word_index(entered_words[i]);
-    if (idx < 0)
+    if (idx < 0) {
+      secure_memzero(packed, sizeof(packed));
       return 0;
+    }
 
     for (int b = 10; b >= 0; b--) {
       int byte_idx = bit_pos / 8;
@@ -140,44 +268,37 @@ int bip39_filter_get_valid_last_words(const char entered_words[24][16],
     }
   }
 
+  // The checksum is the leading bits of SHA-256(entropy), so each candidate
+  // costs one hash and its word index comes straight from the bits
   int count = 0;
   valid_last_words_count = 0;
+  uint8_t hash[SHA256_LEN];
 
   for (int entropy_val = 0;
        entropy_val < num_possibilities && count < max_words; entropy_val++) {
-    uint8_t test_packed[32];
-    memcpy(test_packed, packed, sizeof(test_packed));
-
     int test_bit_pos = bit_pos;
     for (int b = last_word_entropy_bits - 1; b >= 0; b--) {
       int byte_idx = test_bit_pos / 8;
       int bit_idx = 7 - (test_bit_pos % 8);
       if (entropy_val & (1 << b))
-        test_packed[byte_idx] |= (1 << bit_idx);
+        packed[byte_idx] |= (1 << bit_idx);
       else
-        test_packed[byte_idx] &= ~(1 << bit_idx);
+        packed[byte_idx] &= ~(1 << bit_idx);
       test_bit_pos++;
     }
 
-    char *new_mnemonic = NULL;
-    if (bip39_mnemonic_from_bytes(NULL, test_packed, entropy_bytes,
-                                  &new_mnemonic) != WALLY_OK)
+    if (wally_sha256(packed, entropy_bytes, hash, sizeof(hash)) != WALLY_OK)
       continue;
 
-    char *last_space = strrchr(new_mnemonic, ' ');
-    if (last_space) {
-      int idx = bip39_filter_get_word_index(last_space + 1);
-      if (idx >= 0) {
-        const char *w = bip39_get_word_by_index(wordlist, idx);
-        out_words[count++] = w;
-        if (valid_last_words_count < MAX_VALID_LAST_WORDS)
-          valid_last_words_cache[valid_last_words_count++] = w;
-      }
-    }
-
-    wally_free_string(new_mnemonic);
+    int idx = (entropy_val << checksum_bits) | (hash[0] >> (8 - checksum_bits));
+    const char *w = word_at(idx);
+    out_words[count++] = w;
+    if (valid_last_words_count < MAX_VALID_LAST_WORDS)
+      valid_last_words_cache[valid_last_words_count++] = w;
   }
 
+  secure_memzero(packed, sizeof(packed));
+  secure_memzero(hash, sizeof(hash));
   return count;
 }
 
@@ -185,38 +306,26 @@ uint32_t
 bip39_filter_get_valid_letters_for_last_word(const char entered_words[24][16],
                                              int word_count, const char *prefix,
                                              int prefix_len) {
-  if (!wordlist)
+  if (!trie)
     return 0xFFFFFFFF;
 
   if (ensure_last_word_cache(entered_words, word_count) == 0)
     return 0;
 
-  uint32_t mask = 0;
-  for (int letter = 0; letter < 26; letter++) {
-    char test_prefix[BIP39_MAX_PREFIX_LEN + 2];
-    int test_len;
-
-    if (prefix && prefix_len > 0) {
-      int copy_len =
-          prefix_len < BIP39_MAX_PREFIX_LEN ? prefix_len : BIP39_MAX_PREFIX_LEN;
-      memcpy(test_prefix, prefix, copy_len);
-      test_prefix[copy_len] = 'a' + letter;
-      test_prefix[copy_len + 1] = '\0';
-      test_len = prefix_len + 1;
-    } else {
-      test_prefix[0] = 'a' + letter;
-      test_prefix[1] = '\0';
-      test_len = 1;
-    }
+  if (!prefix || prefix_len < 0)
+    prefix_len = 0;
 
-    for (int i = 0; i < valid_last_words_count; i++) {
-      if (strncmp(valid_last_words_cache[i], test_prefix, test_len) == 0) {
-        mask |= (1u << letter);
-        break;
-      }
-    }
-  }
+  // Longer prefixes can never extend to a word
+  if (prefix_len >= BIP39_MAX_PREFIX_LEN)
+    return 0;
 
+  uint32_t mask = 0;
+  for (int i = 0; i < valid_last_words_count; i++) {
+    const char *w = valid_last_words_cache[i];
+    if (strlen(w) > (size_t)prefix_len &&
+        strncmp(w, prefix ? prefix : "", prefix_len) == 0)
+      mask |= letter_bit(w[prefix_len]);
+  }
   return mask;
 }
 
@@ -224,7 +333,7 @@ int bip39_filter_last_word_by_prefix(const char entered_words[24][16],
                                      int word_count, const char *prefix,
                                      int prefix_len, const char **out_words,
                                      int max_words) {
-  if (!wordlist || !out_words || max_words <= 0)
+  if (!trie || !out_words || max_words <= 0)
     return 0;
 
   if (ensure_last_word_cache(entered_words, word_count) == 0)
@@ -0,0 +1,362 @@
+// Performance telemetry — see perf.h
+
+#include "perf.h"
+
+#if CONFIG_KERN_PERF_TELEMETRY
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERF_STACK_SIZE 4096
+/* Just above idle: a sample is never worth delaying real work for. */
+#define PERF_PRIORITY (tskIDLE_PRIORITY + 1)
+/* Tasks whose run time the previous sample remembers. */
+#define PERF_MAX_PREV 48
+
+static const char *TAG = "perf";
+
+typedef struct {
+  uint8_t timer;
+  uint32_t at_ms;
+  uint32_t us;
+} perf_ring_entry_t;
+
+static SemaphoreHandle_t lock = NULL;
+static perf_timer_stats_t timers[PERF_MAX_TIMERS];
+static size_t timer_count = 0;
+static perf_ring_entry_t ring[PERF_RING_SAMPLES];
+static uint32_t ring_written = 0;
+static uint32_t counters[PERF_CTR_COUNT];
+static perf_sample_t latest;
+static bool have_latest = false;
+
+static const char *const counter_names[PERF_CTR_COUNT] = {
+    [PERF_CTR_FRAMES_DECODED] = "frames_decoded",
+    [PERF_CTR_PARTS_PARSED] = "parts_parsed",
+    [PERF_CTR_SIGNATURES] = "signatures",
+};
+
+int64_t perf_now_us(void) { return esp_timer_get_time(); }
+
+void perf_timer_record(int *slot, const char *name, int64_t start_us) {
+  int64_t now = perf_now_us();
+  int64_t elapsed = now - start_us;
+  uint32_t us = elapsed < 0            ? 0
+                : elapsed > UINT32_MAX ? UINT32_MAX
+                                       : (uint32_t)elapsed;
+  if (!lock)
+    return;
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  int i = *slot;
+  if (i < 0) {
+    /* By name, so every PERF_END of one PERF_BEGIN shares its timer */
+    for (i = 0; i < (int)timer_count; i++) {
+      if (strcmp(timers[i].name, name) == 0)
+        break;
+    }
+    if (i == (int)timer_count) {
+      if (timer_count == PERF_MAX_TIMERS) {
+        xSemaphoreGive(lock);
+        return;
+      }
+      timers[timer_count++] =
+          (perf_timer_stats_t){.name = name, .min_us = UINT32_MAX};
+    }
+    *slot = i;
+  }
+
+  perf_timer_stats_t *t = &timers[i];
+  t->count++;
+  t->total_us += us;
+  if (us < t->min_us)
+    t->min_us = us;
+  if (us > t->max_us)
+    t->max_us = us;
+  ring[ring_written++ % PERF_RING_SAMPLES] = (perf_ring_entry_t){
+      .timer = (uint8_t)i, .at_ms = (uint32_t)(now / 1000), .us = us};
+  xSemaphoreGive(lock);
+}
+
+void perf_add(perf_counter_t counter, uint32_t n) {
+  if (counter < PERF_CTR_COUNT)
+    __atomic_add_fetch(&counters[counter], n, __ATOMIC_RELAXED);
+}
+
+uint32_t perf_counter(perf_counter_t counter) {
+  if (counter >= PERF_CTR_COUNT)
+    return 0;
+  return __atomic_load_n(&counters[counter], __ATOMIC_RELAXED);
+}
+
+const char *perf_counter_name(perf_counter_t counter) {
+  return counter < PERF_CTR_COUNT ? counter_names[counter] : "?";
+}
+
+size_t perf_timers(perf_timer_stats_t *out, size_t max) {
+  if (!lock || !out)
+    return 0;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  size_t n = timer_count < max ? timer_count : max;
+  memcpy(out, timers, n * sizeof(*out));
+  xSemaphoreGive(lock);
+  return n;
+}
+
+bool perf_latest(perf_sample_t *out) {
+  if (!lock || !out)
+    return false;
+  xSemaphoreTake(lock, portMAX_DELAY);
+  bool ok = have_latest;
+  if (ok)
+    *out = latest;
+  xSemaphoreGive(lock);
+  return ok;
+}
+
+/* ---------- Sampler ---------- */
+
+#ifndef SIMULATOR
+/* Run time of each task at the previous sample, to turn totals into shares */
+typedef struct {
+  TaskHandle_t handle;
+  configRUN_TIME_COUNTER_TYPE run_time;
+} perf_prev_t;
+
+static perf_prev_t prev[PERF_MAX_PREV];
+static size_t prev_count = 0;
+static configRUN_TIME_COUNTER_TYPE prev_total = 0;
+
+/* Quotes and control characters would break the JSON */
+static void copy_task_name(char *dst, size_t dst_len, const char *src) {
+  size_t i = 0;
+  for (; src && src[i] && i + 1 < dst_len; i++) {
+    char c = src[i];
+    dst[i] = (c < 0x20 || c == '"' || c == '\\') ? '_' : c;
+  }
+  dst[i] = '\0';
+}
+
+static void sample_tasks(perf_sample_t *s) {
+  UBaseType_t cap = uxTaskGetNumberOfTasks() + 4;
+  TaskStatus_t *status = malloc(cap * sizeof(*status));
+  if (!status)
+    return;
+
+  configRUN_TIME_COUNTER_TYPE total = 0;
+  UBaseType_t n = uxTaskGetSystemState(status, cap, &total);
+  uint64_t elapsed = prev_total ? (uint64_t)(total - prev_total) : 0;
+
+  for (UBaseType_t i = 0; i < n; i++) {
+    const TaskStatus_t *st = &status[i];
+    uint64_t ran = 0;
+    for (size_t j = 0; j < prev_count; j++) {
+      if (prev[j].handle == st->xHandle) {
+        ran = (uint64_t)(st->ulRunTimeCounter - prev[j].run_time);
+        break;
+      }
+    }
+    uint32_t permille = elapsed ? (uint32_t)(ran * 1000 / elapsed) : 0;
+    if (permille > 1000)
+      permille = 1000;
+
+    /* Insertion by share, busiest first; the least busy fall off the end */
+    size_t pos = s->task_count;
+    while (pos > 0 && s->tasks[pos - 1].cpu_permille < permille)
+      pos--;
+    if (pos == PERF_MAX_TASKS)
+      continue;
+    size_t last =
+        s->task_count < PERF_MAX_TASKS ? s->task_count : PERF_MAX_TASKS - 1;
+    memmove(&s->tasks[pos + 1], &s->tasks[pos],
+            (last - pos) * sizeof(s->tasks[0]));
+    if (s->task_count < PERF_MAX_TASKS)
+      s->task_count++;
+
+    perf_task_stats_t *t = &s->tasks[pos];
+    copy_task_name(t->name, sizeof(t->name), st->pcTaskName);
+    t->cpu_permille = (uint16_t)permille;
+    /* Bytes: StackType_t is one byte on ESP-IDF */
+    t->stack_free = st->usStackHighWaterMark;
+  }
+
+  prev_count = n < PERF_MAX_PREV ? n : PERF_MAX_PREV;
+  for (size_t j = 0; j < prev_count; j++)
+    prev[j] = (perf_prev_t){status[j].xHandle, status[j].ulRunTimeCounter};
+  prev_total = total;
+  free(status);
+}
+#endif
+
+static void take_sample(void) {
+  perf_sample_t s = {0};
+  s.uptime_ms = (uint32_t)(perf_now_us() / 1000);
+  s.internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  s.internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  s.psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  s.psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+#ifndef SIMULATOR
+  /* The simulator's tasks are host threads, with no run time to read */
+  sample_tasks(&s);
+#endif
+
+  xSemaphoreTake(lock, portMAX_DELAY);
+  latest = s;
+  have_latest = true;
+  xSemaphoreGive(lock);
+}
+
+static void perf_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    take_sample();
+    vTaskDelay(pdMS_TO_TICKS(PERF_SAMPLE_MS));
+  }
+}
+
+void perf_init(void) {
+  if (lock)
+    return;
+  lock = xSemaphoreCreateMutex();
+  if (!lock) {
+    ESP_LOGE(TAG, "No memory for the telemetry lock");
+    return;
+  }
+  if (xTaskCreatePinnedToCore(perf_task, "perf", PERF_STACK_SIZE, NULL,
+                              PERF_PRIORITY, NULL, 0) != pdPASS)
+    ESP_LOGW(TAG, "Sampler not started; timers and counters only");
+}
+
+/* ---------- JSON ---------- */
+
+typedef struct {
+  char *buf;
+  size_t len;
+  size_t cap;
+  bool failed;
+} json_out_t;
+
+static void json_printf(json_out_t *o, const char *fmt, ...) {
+  if (o->failed)
+    return;
+  for (;;) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+      o->failed = true;
+      return;
+    }
+    if ((size_t)n < o->cap - o->len) {
+      o->len += (size_t)n;
+      return;
+    }
+    size_t cap = o->cap * 2 + (size_t)n;
+    char *grown = realloc(o->buf, cap);
+    if (!grown) {
+      o->failed = true;
+      return;
+    }
+    o->buf = grown;
+    o->cap = cap;
+  }
+}
+
+char *perf_json(size_t *len_out) {
+  json_out_t o = {.cap = 4096};
+  o.buf = malloc(o.cap);
+  /* Copies, so the lock is not held while formatting */
+  perf_timer_stats_t *t = malloc(sizeof(timers));
+  perf_ring_entry_t *r = malloc(sizeof(ring));
+  if (!o.buf || !t || !r) {
+    free(o.buf);
+    free(t);
+    free(r);
+    return NULL;
+  }
+  o.buf[0] = '\0';
+
+  perf_sample_t s = {0};
+  bool sampled = perf_latest(&s);
+  size_t timers_n = 0, ring_n = 0, ring_first = 0;
+  if (lock) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    timers_n = timer_count;
+    memcpy(t, timers, timers_n * sizeof(t[0]));
+    ring_n =
+        ring_written < PERF_RING_SAMPLES ? ring_written : PERF_RING_SAMPLES;
+    ring_first = ring_written - ring_n;
+    memcpy(r, ring, sizeof(ring));
+    xSemaphoreGive(lock);
+  }
+
+  json_printf(&o, "{\n  \"uptime_ms\": %" PRIu32 ",\n",
+              (uint32_t)(perf_now_us() / 1000));
+  json_printf(&o, "  \"sample\": ");
+  if (sampled) {
+    json_printf(&o,
+                "{\n    \"uptime_ms\": %" PRIu32 ",\n"
+                "    \"internal_free\": %" PRIu32 ",\n"
+                "    \"internal_largest\": %" PRIu32 ",\n"
+                "    \"psram_free\": %" PRIu32 ",\n"
+                "    \"psram_largest\": %" PRIu32 ",\n"
+                "    \"tasks\": [",
+                s.uptime_ms, s.internal_free, s.internal_largest,
+                s.psram_free, s.psram_largest);
+    for (uint32_t i = 0; i < s.task_count; i++)
+      json_printf(&o,
+                  "%s\n      {\"name\": \"%s\", \"cpu_pct\": %u.%u, "
+                  "\"stack_free\": %" PRIu32 "}",
+                  i ? "," : "", s.tasks[i].name,
+                  (unsigned)s.tasks[i].cpu_permille / 10,
+                  (unsigned)s.tasks[i].cpu_permille % 10,
+                  s.tasks[i].stack_free);
+    json_printf(&o, "%s]\n  },\n", s.task_count ? "\n    " : "");
+  } else {
+    json_printf(&o, "null,\n");
+  }
+
+  json_printf(&o, "  \"counters\": {");
+  for (int i = 0; i < PERF_CTR_COUNT; i++)
+    json_printf(&o, "%s\n    \"%s\": %" PRIu32, i ? "," : "",
+                counter_names[i], perf_counter((perf_counter_t)i));
+  json_printf(&o, "\n  },\n  \"timers\": [");
+  for (size_t i = 0; i < timers_n; i++)
+    json_printf(&o,
+                "%s\n    {\"name\": \"%s\", \"count\": %" PRIu32
+                ", \"total_us\": %" PRIu64 ", \"min_us\": %" PRIu32
+                ", \"max_us\": %" PRIu32 "}",
+                i ? "," : "", t[i].name, t[i].count, t[i].total_us,
+                t[i].count ? t[i].min_us : 0, t[i].max_us);
+  json_printf(&o, "%s],\n  \"samples\": [", timers_n ? "\n  " : "");
+  for (size_t i = 0; i < ring_n; i++) {
+    const perf_ring_entry_t *e = &r[(ring_first + i) % PERF_RING_SAMPLES];
+    json_printf(&o,
+                "%s\n    {\"timer\": \"%s\", \"at_ms\": %" PRIu32
+                ", \"us\": %" PRIu32 "}",
+                i ? "," : "", t[e->timer].name, e->at_ms, e->us);
+  }
+  json_printf(&o, "%s]\n}\n", ring_n ? "\n  " : "");
+  free(t);
+  free(r);
+
+  if (o.failed) {
+    free(o.buf);
+    return NULL;
+  }
+  if (len_out)
+    *len_out = o.len;
+  return o.buf;
+}
+
+#endif // CONFIG_KERN_PERF_TELEMETRY
@@ -0,0 +1,117 @@
+// Performance telemetry — developer builds only (CONFIG_KERN_PERF_TELEMETRY)
+//
+// Three kinds of data, all readable from any task:
+//
+//   - Named timers around a section of code:
+//
+//       PERF_BEGIN(qr_decode);
+//       ...
+//       PERF_END(qr_decode);
+//
+//     Each timer keeps a count, total, min and max, and every sample also goes
+//     into one ring of the most recent PERF_RING_SAMPLES across all timers.
+//   - Event counters: PERF_COUNT(PERF_CTR_FRAMES_DECODED), PERF_ADD(ctr, n).
+//   - A sampler task that, every PERF_SAMPLE_MS, reads per-task CPU share
+//     (FreeRTOS run-time stats), stack high-water marks, and free and largest
+//     blocks of internal RAM and PSRAM.
+//
+// perf_json() renders all of it for the SD dump (ui/perf_overlay.h) and the
+// simulator's --perf-json export. Without the option the macros expand to
+// nothing and perf.c is empty; anything else here must be guarded with
+// #if CONFIG_KERN_PERF_TELEMETRY by its caller.
+
+#ifndef PERF_H
+#define PERF_H
+
+#include "sdkconfig.h"
+
+#if CONFIG_KERN_PERF_TELEMETRY
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PERF_MAX_TIMERS 32
+#define PERF_RING_SAMPLES 256
+#define PERF_MAX_TASKS 24
+#define PERF_SAMPLE_MS 1000
+
+typedef enum {
+  PERF_CTR_FRAMES_DECODED, // camera frames run through the QR decoder
+  PERF_CTR_PARTS_PARSED,   // new QR parts taken by the parser
+  PERF_CTR_SIGNATURES,     // PSBT input and message signatures
+  PERF_CTR_COUNT,
+} perf_counter_t;
+
+typedef struct {
+  const char *name;
+  uint32_t count;
+  uint64_t total_us;
+  uint32_t min_us;
+  uint32_t max_us;
+} perf_timer_stats_t;
+
+typedef struct {
+  char name[16];
+  uint16_t cpu_permille; // of one core, since the previous sample
+  uint32_t stack_free;   // bytes, lowest seen by FreeRTOS
+} perf_task_stats_t;
+
+typedef struct {
+  uint32_t uptime_ms;
+  uint32_t internal_free;
+  uint32_t internal_largest;
+  uint32_t psram_free;
+  uint32_t psram_largest;
+  uint32_t task_count; // entries in tasks, busiest first
+  perf_task_stats_t tasks[PERF_MAX_TASKS];
+} perf_sample_t;
+
+/* Starts the sampler. Counters work before it; timer samples before it are
+ * dropped. */
+void perf_init(void);
+
+int64_t perf_now_us(void);
+
+/* Backs PERF_END: slot caches the timer's index for the call site. */
+void perf_timer_record(int *slot, const char *name, int64_t start_us);
+
+void perf_add(perf_counter_t counter, uint32_t n);
+uint32_t perf_counter(perf_counter_t counter);
+const char *perf_counter_name(perf_counter_t counter);
+
+/* Copies up to max timers' aggregates, in first-use order. */
+size_t perf_timers(perf_timer_stats_t *out, size_t max);
+/* The sampler's latest. False until its first sample. */
+bool perf_latest(perf_sample_t *out);
+
+/* Everything above, plus the sample ring, as a JSON object. Caller frees. */
+char *perf_json(size_t *len_out);
+
+#define PERF_BEGIN(name) const int64_t perf_begin_##name = perf_now_us()
+#define PERF_END(name)                                                         \
+  do {                                                                         \
+    static int perf_slot_##name = -1;                                          \
+    perf_timer_record(&perf_slot_##name, #name, perf_begin_##name);            \
+  } while (0)
+#define PERF_ADD(counter, n) perf_add((counter), (n))
+#define PERF_COUNT(counter) perf_add((counter), 1)
+
+#else
+
+#define PERF_BEGIN(name)                                                       \
+  do {                                                                         \
+  } while (0)
+#define PERF_END(name)                                                         \
+  do {                                                                         \
+  } while (0)
+#define PERF_ADD(counter, n)                                                   \
+  do {                                                                         \
+  } while (0)
+#define PERF_COUNT(counter)                                                    \
+  do {                                                                         \
+  } while (0)
+
+#endif // CONFIG_KERN_PERF_TELEMETRY
+
+#endif // PERF_H
@@ -0,0 +1,286 @@
+// Power governor — activity-driven CPU clock locks and peripheral gating
+
+#include "power_gov.h"
+#include <esp_log.h>
+#include <esp_pm.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+
+static const char *TAG = "power_gov";
+
+typedef struct {
+  bool cpu_max;
+  bool apb_max;
+  bool dim;
+} power_policy_t;
+
+// KDF is pure CPU work; everything else busy talks to peripherals (CSI, ISP
+// and PPA while scanning, SD and QR export while signing, touch and SD while
+// the user is browsing).
+static const power_policy_t policies[POWER_STATE_COUNT] = {
+    [POWER_STATE_SCREENSAVER] = {.dim = true},
+    [POWER_STATE_IDLE] = {0},
+    [POWER_STATE_INTERACTIVE] = {.cpu_max = true, .apb_max = true},
+    [POWER_STATE_KDF] = {.cpu_max = true},
+    [POWER_STATE_SIGNING] = {.cpu_max = true, .apb_max = true},
+    [POWER_STATE_SCANNING] = {.cpu_max = true, .apb_max = true},
+};
+
+static const char *const state_names[POWER_STATE_COUNT] = {
+    [POWER_STATE_SCREENSAVER] = "screensaver",
+    [POWER_STATE_IDLE] = "idle",
+    [POWER_STATE_INTERACTIVE] = "interactive",
+    [POWER_STATE_KDF] = "kdf",
+    [POWER_STATE_SIGNING] = "signing",
+    [POWER_STATE_SCANNING] = "scanning",
+};
+
+static const power_state_t activity_states[POWER_ACT_COUNT] = {
+    [POWER_ACT_SCANNING] = POWER_STATE_SCANNING,
+    [POWER_ACT_SIGNING] = POWER_STATE_SIGNING,
+    [POWER_ACT_KDF] = POWER_STATE_KDF,
+};
+
+static SemaphoreHandle_t mutex = NULL;
+static power_gov_hooks_t hooks;
+static esp_pm_lock_handle_t cpu_lock = NULL;
+static esp_pm_lock_handle_t apb_lock = NULL;
+static esp_pm_lock_handle_t sleep_lock = NULL;
+static bool cpu_held = false;
+static bool apb_held = false;
+static bool dimmed = false;
+
+static uint16_t activity_count[POWER_ACT_COUNT];
+static power_ui_t ui_level = POWER_UI_INTERACTIVE;
+static power_state_t state = POWER_STATE_INTERACTIVE;
+static uint8_t user_brightness = 100;
+
+// Battery log: time spent in each state since the last entry, and the level
+// at the start of the current discharge.
+static uint32_t state_ms[POWER_STATE_COUNT];
+static uint32_t state_since_ms = 0;
+static bool window_open = false;
+static uint32_t window_start_ms = 0;
+static uint8_t window_start_pct = 0;
+static uint8_t last_pct = 0;
+static uint32_t last_pct_ms = 0;
+
+static esp_pm_lock_handle_t create_lock(esp_pm_lock_type_t type,
+                                        const char *name) {
+  esp_pm_lock_handle_t lock = NULL;
+  esp_err_t err = esp_pm_lock_create(type, 0, name, &lock);
+  if (err == ESP_OK)
+    return lock;
+  // NOT_SUPPORTED: built without CONFIG_PM_ENABLE, said once in init.
+  if (err != ESP_ERR_NOT_SUPPORTED)
+    ESP_LOGW(TAG, "No %s lock: %s", name, esp_err_to_name(err));
+  return NULL;
+}
+
+static void set_lock(esp_pm_lock_handle_t lock, bool *held, bool want) {
+  if (!lock || *held == want)
+    return;
+  esp_err_t err = want ? esp_pm_lock_acquire(lock) : esp_pm_lock_release(lock);
+  if (err == ESP_OK)
+    *held = want;
+}
+
+static uint32_t now(void) { return hooks.now_ms ? hooks.now_ms() : 0; }
+
+// Mutex held.
+static void account(void) {
+  uint32_t t = now();
+  state_ms[state] += t - state_since_ms;
+  state_since_ms = t;
+}
+
+static uint8_t dim_level(void) {
+  uint8_t level = (uint8_t)(user_brightness * POWER_GOV_DIM_PERCENT / 100);
+  return level ? level : 1;
+}
+
+static power_state_t compute_state(void) {
+  for (int s = POWER_STATE_COUNT - 1; s > POWER_STATE_INTERACTIVE; s--) {
+    for (int a = 0; a < POWER_ACT_COUNT; a++) {
+      if (activity_states[a] == (power_state_t)s && activity_count[a])
+        return (power_state_t)s;
+    }
+  }
+  switch (ui_level) {
+  case POWER_UI_SCREENSAVER:
+    return POWER_STATE_SCREENSAVER;
+  case POWER_UI_IDLE:
+    return POWER_STATE_IDLE;
+  default:
+    return POWER_STATE_INTERACTIVE;
+  }
+}
+
+// Mutex held.
+static void apply(void) {
+  power_state_t next = compute_state();
+  if (next == state)
+    return;
+  const power_policy_t *p = &policies[next];
+  // Raise before lowering so a busy state never runs a refresh slow.
+  if (p->cpu_max)
+    set_lock(cpu_lock, &cpu_held, true);
+  if (p->apb_max)
+    set_lock(apb_lock, &apb_held, true);
+  if (!p->apb_max)
+    set_lock(apb_lock, &apb_held, false);
+  if (!p->cpu_max)
+    set_lock(cpu_lock, &cpu_held, false);
+  if (p->dim != dimmed && hooks.set_backlight) {
+    hooks.set_backlight(p->dim ? dim_level() : user_brightness);
+    dimmed = p->dim;
+  }
+  ESP_LOGD(TAG, "%s -> %s", state_names[state], state_names[next]);
+  account();
+  state = next;
+}
+
+void power_gov_init(const power_gov_hooks_t *h, uint8_t brightness) {
+  mutex = xSemaphoreCreateMutex();
+  if (h)
+    hooks = *h;
+  user_brightness = brightness;
+  state_since_ms = now();
+  cpu_lock = create_lock(ESP_PM_CPU_FREQ_MAX, "gov_cpu");
+  apb_lock = create_lock(ESP_PM_APB_FREQ_MAX, "gov_apb");
+  sleep_lock = create_lock(ESP_PM_NO_LIGHT_SLEEP, "gov_no_sleep");
+  if (!cpu_lock && !apb_lock)
+    ESP_LOGI(TAG, "No PM locks; clock scaling off");
+  if (sleep_lock)
+    esp_pm_lock_acquire(sleep_lock);
+  set_lock(cpu_lock, &cpu_held, true);
+  set_lock(apb_lock, &apb_held, true);
+}
+
+void power_gov_acquire(power_activity_t activity) {
+  if (!mutex || activity >= POWER_ACT_COUNT)
+    return;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  activity_count[activity]++;
+  apply();
+  xSemaphoreGive(mutex);
+}
+
+void power_gov_release(power_activity_t activity) {
+  if (!mutex || activity >= POWER_ACT_COUNT)
+    return;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  bool camera_idle = false;
+  if (activity_count[activity]) {
+    activity_count[activity]--;
+    camera_idle =
+        activity == POWER_ACT_SCANNING && activity_count[activity] == 0;
+  } else {
+    ESP_LOGW(TAG, "Unbalanced release of %s",
+             state_names[activity_states[activity]]);
+  }
+  apply();
+  xSemaphoreGive(mutex);
+  if (camera_idle && hooks.camera_idle)
+    hooks.camera_idle();
+}
+
+static inline unsigned share(uint32_t ms, uint32_t total) {
+  return (unsigned)((uint64_t)ms * 100 / total);
+}
+
+// Mutex held.
+static bool battery_estimate_locked(uint32_t *minutes) {
+  if (!window_open || last_pct >= window_start_pct)
+    return false;
+  uint64_t elapsed = last_pct_ms - window_start_ms;
+  uint32_t drop = window_start_pct - last_pct;
+  *minutes = (uint32_t)(elapsed * last_pct / drop / 60000);
+  return true;
+}
+
+void power_gov_log_battery(void) {
+  uint8_t pct;
+  if (!mutex || !hooks.battery_percent || !hooks.battery_percent(&pct))
+    return;
+  uint32_t now_ms = now();
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  account();
+  // Charging (or the first sample): start a new discharge window.
+  if (!window_open || pct > last_pct) {
+    window_open = true;
+    window_start_ms = now_ms;
+    window_start_pct = pct;
+  }
+  last_pct = pct;
+  last_pct_ms = now_ms;
+
+  uint32_t total = 0;
+  for (int s = 0; s < POWER_STATE_COUNT; s++)
+    total += state_ms[s];
+  uint32_t minutes;
+  if (total && battery_estimate_locked(&minutes)) {
+    ESP_LOGI(TAG,
+             "Battery %u%%, ~%lu h %02lu min left; last interval: scanning "
+             "%u%%, signing/kdf %u%%, interactive %u%%, idle %u%%, "
+             "screensaver %u%%",
+             pct, (unsigned long)(minutes / 60), (unsigned long)(minutes % 60),
+             share(state_ms[POWER_STATE_SCANNING], total),
+             share(state_ms[POWER_STATE_SIGNING] + state_ms[POWER_STATE_KDF],
+                   total),
+             share(state_ms[POWER_STATE_INTERACTIVE], total),
+             share(state_ms[POWER_STATE_IDLE], total),
+             share(state_ms[POWER_STATE_SCREENSAVER], total));
+  } else {
+    ESP_LOGI(TAG, "Battery %u%%", pct);
+  }
+  for (int s = 0; s < POWER_STATE_COUNT; s++)
+    state_ms[s] = 0;
+  xSemaphoreGive(mutex);
+}
+
+void power_gov_set_ui(power_ui_t ui) {
+  if (!mutex)
+    return;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  ui_level = ui;
+  apply();
+  xSemaphoreGive(mutex);
+}
+
+void power_gov_set_brightness(uint8_t brightness) {
+  if (!mutex) {
+    user_brightness = brightness;
+    if (hooks.set_backlight)
+      hooks.set_backlight(brightness);
+    return;
+  }
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  user_brightness = brightness;
+  if (hooks.set_backlight)
+    hooks.set_backlight(dimmed ? dim_level() : brightness);
+  xSemaphoreGive(mutex);
+}
+
+power_state_t power_gov_state(void) {
+  if (!mutex)
+    return state;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  power_state_t s = state;
+  xSemaphoreGive(mutex);
+  return s;
+}
+
+const char *power_gov_state_name(power_state_t s) {
+  return s < POWER_STATE_COUNT ? state_names[s] : "?";
+}
+
+bool power_gov_battery_estimate(uint32_t *minutes) {
+  if (!mutex)
+    return false;
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  bool ok = battery_estimate_locked(minutes);
+  xSemaphoreGive(mutex);
+  return ok;
+}
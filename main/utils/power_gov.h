@@ -0,0 +1,89 @@
+// Power governor — activity-driven CPU clock locks and peripheral gating
+//
+// Work that needs the CPU at full speed holds an activity for as long as it
+// runs (refcounted, any task); the session timer reports how long the user
+// has been away. The highest level held is the power state:
+//
+//   SCANNING > SIGNING > KDF > INTERACTIVE > IDLE > SCREENSAVER
+//
+// Each state maps to a policy: which esp_pm max-frequency locks are held, and
+// whether the backlight is dimmed. With no lock held, DFS drops the CPU and
+// APB clocks to their minimum between LVGL refreshes. Light sleep stays
+// disabled throughout: DPI panels scan out of PSRAM continuously. Without
+// CONFIG_PM_ENABLE the locks cannot be created and only the backlight and
+// camera policy apply.
+
+#ifndef POWER_GOV_H
+#define POWER_GOV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  POWER_ACT_SCANNING, // camera streaming into a decoder or preview
+  POWER_ACT_SIGNING,  // PSBT / message signing
+  POWER_ACT_KDF,      // PIN / KEF key stretching
+  POWER_ACT_COUNT,
+} power_activity_t;
+
+typedef enum {
+  POWER_UI_INTERACTIVE, // input within POWER_GOV_IDLE_MS
+  POWER_UI_IDLE,
+  POWER_UI_SCREENSAVER,
+} power_ui_t;
+
+typedef enum {
+  POWER_STATE_SCREENSAVER,
+  POWER_STATE_IDLE,
+  POWER_STATE_INTERACTIVE,
+  POWER_STATE_KDF,
+  POWER_STATE_SIGNING,
+  POWER_STATE_SCANNING,
+  POWER_STATE_COUNT,
+} power_state_t;
+
+/* Inactivity after which the UI counts as idle and the clocks may drop. */
+#define POWER_GOV_IDLE_MS 10000
+/* Backlight while the screensaver is up, in percent of the user setting. */
+#define POWER_GOV_DIM_PERCENT 20
+/* Interval the session is expected to call power_gov_log_battery() at. */
+#define POWER_GOV_BATTERY_LOG_MS (10 * 60 * 1000)
+
+typedef struct {
+  /* Backlight, 0-100. */
+  void (*set_backlight)(uint8_t percent);
+  /* False when there is no fuel gauge or it cannot be read. */
+  bool (*battery_percent)(uint8_t *percent);
+  /* The last camera consumer let go: stop anything still streaming. */
+  void (*camera_idle)(void);
+  /* Millisecond clock, callable from any task. Times the states for the
+   * battery log. */
+  uint32_t (*now_ms)(void);
+} power_gov_hooks_t;
+
+/* Creates the PM locks and applies the INTERACTIVE policy. brightness is the
+ * user setting already on the backlight. Call once, before any other call. */
+void power_gov_init(const power_gov_hooks_t *hooks, uint8_t brightness);
+
+/* Any task. Every acquire needs a matching release. */
+void power_gov_acquire(power_activity_t activity);
+void power_gov_release(power_activity_t activity);
+
+/* From the session deadlines and input events (LVGL task). */
+void power_gov_set_ui(power_ui_t ui);
+
+/* Samples the battery and logs the estimate with the share of time spent in
+ * each state since the previous call. No-op without a fuel gauge. */
+void power_gov_log_battery(void);
+
+/* New user brightness (settings slider). Applied now unless dimmed. */
+void power_gov_set_brightness(uint8_t brightness);
+
+power_state_t power_gov_state(void);
+const char *power_gov_state_name(power_state_t state);
+
+/* Minutes of battery left at the drain rate seen since the last charge or
+ * boot. False until the level has dropped at least one percent. */
+bool power_gov_battery_estimate(uint32_t *minutes);
+
+#endif // POWER_GOV_H
@@ -1,7 +1,10 @@
 // Inactivity monitoring — screensaver overlay and session lock
 
 #include "session.h"
+#include "../ui/deadline.h"
+#include "power_gov.h"
 #include <lvgl.h>
+#include <stddef.h>
 
 static session_screensaver_cb_t screensaver_cb = NULL;
 static session_expired_cb_t expired_cb = NULL;
@@ -10,9 +13,50 @@ static uint32_t session_ms = 0;
 static bool expired_fired = false;
 static bool screensaver_fired = false;
 
-static void session_timer_cb(lv_timer_t *timer) {
-  (void)timer;
+// The lock face counts as a screensaver too: the backlight dims either way.
+static power_ui_t ui_level(uint32_t inactive) {
+  if ((session_ms && inactive >= session_ms) ||
+      (screensaver_ms && inactive >= screensaver_ms))
+    return POWER_UI_SCREENSAVER;
+  if (inactive >= POWER_GOV_IDLE_MS)
+    return POWER_UI_IDLE;
+  return POWER_UI_INTERACTIVE;
+}
+
+// Timeouts are in whole seconds; running up to one late costs nothing and
+// lets the check share a wakeup with the battery label.
+#define SESSION_SLACK_MS 1000
+// The battery log only needs to land roughly every ten minutes.
+#define BATTERY_LOG_SLACK_MS 60000
+
+static int check_deadline = -1;
+
+// Next threshold the inactivity has yet to cross, or 0 when none is left:
+// then only input (or a timeout change) re-runs the check.
+static uint32_t next_threshold(uint32_t inactive) {
+  const uint32_t thresholds[] = {POWER_GOV_IDLE_MS, screensaver_ms,
+                                 session_ms};
+  uint32_t next = 0;
+  for (size_t i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); i++) {
+    uint32_t t = thresholds[i];
+    if (t > inactive && (!next || t < next))
+      next = t;
+  }
+  return next;
+}
+
+static void session_check(void) {
   uint32_t inactive = lv_display_get_inactive_time(NULL);
+  power_gov_set_ui(ui_level(inactive));
+
+  // Pages that trigger activity themselves (scanner, animated QR) push the
+  // thresholds out without input; re-arming from the measured inactivity
+  // follows them.
+  uint32_t next = next_threshold(inactive);
+  if (next)
+    ui_deadline_arm(check_deadline, next - inactive, 0);
+  else
+    ui_deadline_cancel(check_deadline);
 
   if (session_ms && expired_cb && inactive >= session_ms) {
     if (!expired_fired) {
@@ -33,11 +77,35 @@ static void session_timer_cb(lv_timer_t *timer) {
   screensaver_fired = false;
 }
 
+static void check_deadline_cb(void *user_data) {
+  (void)user_data;
+  session_check();
+}
+
+static void battery_log_cb(void *user_data) {
+  (void)user_data;
+  power_gov_log_battery();
+}
+
+// Input resets the inactivity: raise the clocks now and move the next check
+// out to the idle threshold.
+static void input_cb(lv_event_t *e) {
+  (void)e;
+  session_check();
+}
+
 void session_init(session_screensaver_cb_t saver_cb,
                   session_expired_cb_t exp_cb) {
   screensaver_cb = saver_cb;
   expired_cb = exp_cb;
-  lv_timer_create(session_timer_cb, 1000, NULL);
+  check_deadline = ui_deadline_add(check_deadline_cb, NULL, SESSION_SLACK_MS);
+  int log_deadline =
+      ui_deadline_add(battery_log_cb, NULL, BATTERY_LOG_SLACK_MS);
+  ui_deadline_arm(log_deadline, 0, POWER_GOV_BATTERY_LOG_MS);
+  for (lv_indev_t *indev = lv_indev_get_next(NULL); indev;
+       indev = lv_indev_get_next(indev))
+    lv_indev_add_event_cb(indev, input_cb, LV_EVENT_PRESSED, NULL);
+  session_check();
 }
 
 void session_set_screensaver_timeout(uint16_t sec) {
@@ -45,9 +113,13 @@ void session_set_screensaver_timeout(uint16_t sec) {
   // A timeout change counts as activity so shrinking below the accrued
   // inactivity can't fire on the next tick.
   lv_display_trigger_activity(NULL);
+  if (check_deadline >= 0)
+    session_check();
 }
 
 void session_set_timeout(uint16_t sec) {
   session_ms = (uint32_t)sec * 1000;
   lv_display_trigger_activity(NULL);
+  if (check_deadline >= 0)
+    session_check();
 }
@@ -8,7 +8,8 @@
 typedef void (*session_expired_cb_t)(void);
 typedef void (*session_screensaver_cb_t)(void);
 
-/* Create the 1s inactivity timer. Call once at boot, after LVGL is up. */
+/* Arm the inactivity deadlines and hook input. Call once at boot, after LVGL
+ * and the input devices are up. */
 void session_init(session_screensaver_cb_t saver_cb,
                   session_expired_cb_t expired_cb);
 
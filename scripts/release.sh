@@ -36,6 +36,22 @@ for DEVICE in $DEVICES; do
     just build "$DEVICE"
 
     BUILD_DIR="$REPO_ROOT/build_${DEVICE}"
+
+    # The scan recorder writes camera images of scanned secrets to the SD card
+    if grep -q '^CONFIG_VIDEO_SCAN_RECORDER=y' "$BUILD_DIR/sdkconfig"; then
+        echo "Error: ${DEVICE} was built with CONFIG_VIDEO_SCAN_RECORDER"
+        exit 1
+    fi
+    # The flush benchmark holds up every boot for several seconds
+    if grep -q '^CONFIG_BSP_DISPLAY_FLUSH_BENCHMARK=y' "$BUILD_DIR/sdkconfig"; then
+        echo "Error: ${DEVICE} was built with CONFIG_BSP_DISPLAY_FLUSH_BENCHMARK"
+        exit 1
+    fi
+    # The telemetry overlay sits over every screen and dumps to the SD card
+    if grep -q '^CONFIG_KERN_PERF_TELEMETRY=y' "$BUILD_DIR/sdkconfig"; then
+        echo "Error: ${DEVICE} was built with CONFIG_KERN_PERF_TELEMETRY"
+        exit 1
+    fi
     DEVICE_DIR="$RELEASE_DIR/${DEVICE}"
     mkdir -p "$DEVICE_DIR"
 
@@ -4,6 +4,7 @@
 
 #include "esp_lvgl_port.h"
 #include "bsp/esp32_p4_wifi6_touch_lcd_4b.h"
+#include "bsp/video_layer.h"
 #include "esp_log.h"
 
 #include "src/drivers/sdl/lv_sdl_window.h"
@@ -162,3 +163,26 @@ i2c_master_bus_handle_t bsp_i2c_get_handle(void) {
      * don't bail out. app_video_init_once() ignores it in the simulator. */
     return (i2c_master_bus_handle_t)1;
 }
+
+/* ---------- Video layer stubs ---------- */
+
+bool bsp_video_layer_available(void) {
+    return false;
+}
+
+esp_err_t bsp_video_layer_open(const bsp_video_rect_t *frame,
+                               const bsp_video_rect_t *tiles,
+                               size_t tile_count) {
+    (void)frame;
+    (void)tiles;
+    (void)tile_count;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t bsp_video_layer_present(const void *rgb565) {
+    (void)rgb565;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void bsp_video_layer_close(void) {
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The SDL window has no DPI frame buffers to write into, so the simulator
+ * never offers a video layer and the camera preview stays in LVGL. */
+
+#define BSP_VIDEO_LAYER_MAX_TILES 8
+
+typedef struct {
+  uint16_t x;
+  uint16_t y;
+  uint16_t w;
+  uint16_t h;
+} bsp_video_rect_t;
+
+bool bsp_video_layer_available(void);
+esp_err_t bsp_video_layer_open(const bsp_video_rect_t *frame,
+                               const bsp_video_rect_t *tiles,
+                               size_t tile_count);
+esp_err_t bsp_video_layer_present(const void *rgb565);
+void bsp_video_layer_close(void);
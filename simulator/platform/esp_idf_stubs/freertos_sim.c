@@ -153,6 +153,14 @@ SemaphoreHandle_t xSemaphoreCreateBinary(void) {
     return s;
 }
 
+/* No priority inheritance or owner tracking: a binary semaphore that starts
+ * available is all the firmware's mutexes need here. */
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    sem_impl_t *s = xSemaphoreCreateBinary();
+    if (s) s->value = 1;
+    return s;
+}
+
 BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t timeout) {
     sem_impl_t *s = (sem_impl_t *)sem;
     if (!s) return pdFAIL;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "esp_err.h"
+
+/* Power management stubs — as on a build without CONFIG_PM_ENABLE, locks
+ * cannot be created and the power governor runs without them */
+typedef enum {
+    ESP_PM_CPU_FREQ_MAX,
+    ESP_PM_APB_FREQ_MAX,
+    ESP_PM_NO_LIGHT_SLEEP,
+} esp_pm_lock_type_t;
+
+typedef struct esp_pm_lock *esp_pm_lock_handle_t;
+
+static inline esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char *name,
+                                           esp_pm_lock_handle_t *out) {
+    (void)type; (void)arg; (void)name; (void)out;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+static inline esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t h) { (void)h; return ESP_ERR_NOT_SUPPORTED; }
+static inline esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t h) { (void)h; return ESP_ERR_NOT_SUPPORTED; }
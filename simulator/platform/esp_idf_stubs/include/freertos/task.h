@@ -6,6 +6,8 @@
 typedef void *TaskHandle_t;
 typedef void (*TaskFunction_t)(void *);
 
+#define tskIDLE_PRIORITY ((UBaseType_t)0U)
+
 BaseType_t xTaskCreate(TaskFunction_t func, const char *name,
                        uint32_t stack_size, void *param,
                        UBaseType_t priority, TaskHandle_t *handle);
@@ -53,4 +53,21 @@ static inline int mbedtls_pkcs5_pbkdf2_hmac_ext(mbedtls_md_type_t md_type,
     return ret;
 }
 
+/* GCM streaming moved to the 3.x signatures: additional data is fed apart
+ * from the nonce, and update/finish report how much output they wrote. 2.x
+ * writes exactly what it is given (crypto_utils only ever feeds whole blocks
+ * before the last call) and nothing at finish. Declared first so the macros
+ * below do not rewrite the 2.x prototypes. */
+#include <mbedtls/gcm.h>
+
+#define mbedtls_gcm_starts(ctx, mode, iv, iv_len) \
+    mbedtls_gcm_starts((ctx), (mode), (iv), (iv_len), NULL, 0)
+#define mbedtls_gcm_update(ctx, input, input_len, output, output_size,    \
+                           output_len)                                    \
+    (*(output_len) = (input_len),                                         \
+     mbedtls_gcm_update((ctx), (input_len), (input), (output)))
+#define mbedtls_gcm_finish(ctx, output, output_size, output_len, tag,     \
+                           tag_len)                                       \
+    (*(output_len) = 0, mbedtls_gcm_finish((ctx), (tag), (tag_len)))
+
 #endif /* MBEDTLS_VERSION_MAJOR < 3 */
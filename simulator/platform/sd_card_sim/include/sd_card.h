@@ -16,6 +16,8 @@ esp_err_t sd_card_init(void);
 esp_err_t sd_card_deinit(void);
 esp_err_t sd_card_remount(void);
 bool      sd_card_is_mounted(void);
+uint32_t  sd_card_generation(void);
+esp_err_t sd_card_mtime(const char *path, int64_t *mtime_out);
 
 esp_err_t sd_card_write_file(const char *path, const uint8_t *data, size_t len);
 esp_err_t sd_card_read_file(const char *path, uint8_t **data_out, size_t *len_out);
@@ -28,6 +30,43 @@ esp_err_t sd_card_list_entries(const char *dir_path, char ***names_out,
                                bool **is_dir_out, int *count_out);
 void      sd_card_free_file_list(char **files, int count);
 
+/* Streaming I/O — see components/sd_card/include/sd_card.h. */
+typedef struct sd_card_stream sd_card_stream_t;
+
+typedef enum {
+    SD_CARD_STREAM_READ,
+    SD_CARD_STREAM_WRITE,
+    SD_CARD_STREAM_APPEND,
+} sd_card_stream_mode_t;
+
+typedef struct {
+    size_t buffer_size;
+    bool   read_ahead;
+} sd_card_stream_config_t;
+
+esp_err_t sd_card_stream_open(const char *path, sd_card_stream_mode_t mode,
+                              const sd_card_stream_config_t *config,
+                              sd_card_stream_t **stream_out);
+esp_err_t sd_card_stream_size(sd_card_stream_t *stream, size_t *size_out);
+esp_err_t sd_card_stream_read_chunk(sd_card_stream_t *stream, uint8_t *data,
+                                    size_t len, size_t *read_out);
+esp_err_t sd_card_stream_seek(sd_card_stream_t *stream, size_t offset);
+esp_err_t sd_card_stream_write_chunk(sd_card_stream_t *stream,
+                                     const uint8_t *data, size_t len);
+esp_err_t sd_card_stream_close(sd_card_stream_t *stream);
+
+typedef struct {
+    uint32_t freq_khz;
+    uint8_t  bus_width;
+    float    write_mbps;
+    float    read_mbps;
+    float    read_ahead_mbps;
+} sd_card_self_test_result_t;
+
+esp_err_t sd_card_self_test(size_t test_bytes,
+                            sd_card_self_test_result_t *results,
+                            size_t max_results, size_t *count_out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,10 +8,12 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 static const char *TAG = "SD_SIM";
@@ -19,6 +21,7 @@ static const char *TAG = "SD_SIM";
 #define SIM_SDCARD_DEFAULT_ROOT "simulator/sim_data/sdcard"
 
 static bool s_mounted = false;
+static uint32_t s_generation = 0;
 
 static char *s_sdcard_root_override = NULL;
 
@@ -98,6 +101,7 @@ esp_err_t sd_card_init(void) {
     snprintf(path, sizeof(path), "%s/kern/descriptors", root);
     mkdir_p(path);
     s_mounted = true;
+    s_generation++;
     ESP_LOGI(TAG, "SD card simulator initialized at %s", root);
     return ESP_OK;
 }
@@ -116,11 +120,30 @@ bool sd_card_is_mounted(void) {
     return s_mounted;
 }
 
+uint32_t sd_card_generation(void) {
+    return s_generation;
+}
+
+esp_err_t sd_card_mtime(const char *path, int64_t *mtime_out) {
+    if (!path || !mtime_out) return ESP_ERR_INVALID_ARG;
+    if (!s_mounted) return ESP_ERR_INVALID_STATE;
+    char buf[1024];
+    const char *rpath = rewrite_path(path, buf, sizeof(buf));
+    if (!rpath) return ESP_ERR_INVALID_ARG;
+    struct stat st;
+    if (stat(rpath, &st) != 0) return ESP_ERR_NOT_FOUND;
+    /* Host filesystems keep sub-second times and, unlike FAT, update a
+     * directory's when its entries change. */
+    *mtime_out = (int64_t)st.st_mtim.tv_sec * 1000000 + st.st_mtim.tv_nsec / 1000;
+    return ESP_OK;
+}
+
 esp_err_t sd_card_write_file(const char *path, const uint8_t *data, size_t len) {
     if (!path || !data) return ESP_ERR_INVALID_ARG;
     char buf[1024];
     const char *rpath = rewrite_path(path, buf, sizeof(buf));
     if (!rpath) return ESP_ERR_INVALID_ARG;
+    s_generation++;
     FILE *f = fopen(rpath, "wb");
     if (!f) {
         ESP_LOGE(TAG, "write_file: cannot open %s: %s", rpath, strerror(errno));
@@ -131,6 +154,22 @@ esp_err_t sd_card_write_file(const char *path, const uint8_t *data, size_t len)
     return (written == len) ? ESP_OK : ESP_FAIL;
 }
 
+esp_err_t sd_card_append_file(const char *path, const uint8_t *data, size_t len) {
+    if (!path || !data) return ESP_ERR_INVALID_ARG;
+    char buf[1024];
+    const char *rpath = rewrite_path(path, buf, sizeof(buf));
+    if (!rpath) return ESP_ERR_INVALID_ARG;
+    s_generation++;
+    FILE *f = fopen(rpath, "ab");
+    if (!f) {
+        ESP_LOGE(TAG, "append_file: cannot open %s: %s", rpath, strerror(errno));
+        return ESP_FAIL;
+    }
+    size_t written = fwrite(data, 1, len, f);
+    fclose(f);
+    return (written == len) ? ESP_OK : ESP_FAIL;
+}
+
 esp_err_t sd_card_read_file(const char *path, uint8_t **data_out, size_t *len_out) {
     if (!path || !data_out || !len_out) return ESP_ERR_INVALID_ARG;
     char pathbuf[1024];
@@ -176,6 +215,7 @@ esp_err_t sd_card_delete_file(const char *path) {
     char buf[1024];
     const char *rpath = rewrite_path(path, buf, sizeof(buf));
     if (!rpath) return ESP_ERR_INVALID_ARG;
+    s_generation++;
     return (remove(rpath) == 0) ? ESP_OK : ESP_FAIL;
 }
 
@@ -199,7 +239,7 @@ static esp_err_t list_dir(const char *dir_path, bool include_dirs,
 
     char **names = NULL;
     bool *is_dir = NULL;
-    int count = 0;
+    int count = 0, cap = 0;
     struct dirent *entry;
 
     while ((entry = readdir(d)) != NULL) {
@@ -212,15 +252,20 @@ static esp_err_t list_dir(const char *dir_path, bool include_dirs,
         bool entry_is_dir = S_ISDIR(st.st_mode);
         if (!S_ISREG(st.st_mode) && !(include_dirs && entry_is_dir)) continue;
 
-        char **tmp = realloc(names, (size_t)(count + 1) * sizeof(char *));
-        if (tmp) names = tmp;
-        bool *tmp_dir = NULL;
-        if (is_dir_out) {
-            tmp_dir = realloc(is_dir, (size_t)(count + 1) * sizeof(bool));
-            if (tmp_dir) is_dir = tmp_dir;
+        bool grown = true;
+        if (count == cap) {
+            int new_cap = cap ? cap * 2 : 16;
+            char **tmp = realloc(names, (size_t)new_cap * sizeof(char *));
+            if (tmp) names = tmp;
+            bool *tmp_dir = NULL;
+            if (is_dir_out) {
+                tmp_dir = realloc(is_dir, (size_t)new_cap * sizeof(bool));
+                if (tmp_dir) is_dir = tmp_dir;
+            }
+            grown = tmp && (!is_dir_out || tmp_dir);
+            if (grown) cap = new_cap;
         }
-        if (!tmp || (is_dir_out && !tmp_dir) ||
-            !(names[count] = strdup(entry->d_name))) {
+        if (!grown || !(names[count] = strdup(entry->d_name))) {
             sd_card_free_file_list(names, count);
             free(is_dir);
             closedir(d);
@@ -251,3 +296,239 @@ void sd_card_free_file_list(char **files, int count) {
     for (int i = 0; i < count; i++) free(files[i]);
     free(files);
 }
+
+/* ---------- Streaming I/O ----------
+ * Same contract as the hardware component over POSIX file descriptors: the
+ * bounce buffer, sector rounding and seek-within-buffer behave identically.
+ * Read-ahead is accepted but served synchronously — the host page cache
+ * already does the job. */
+
+#define SIM_SECTOR_SIZE 512
+#ifndef CONFIG_SD_STREAM_BUFFER_SIZE
+#define CONFIG_SD_STREAM_BUFFER_SIZE 16384
+#endif
+
+struct sd_card_stream {
+    int fd;
+    bool writing;
+    esp_err_t err;
+    size_t size;
+    size_t buf_size;
+    uint8_t *buf;
+    size_t fill;
+    size_t pos;
+    size_t buf_offset;
+    bool eof;
+};
+
+static esp_err_t stream_refill(sd_card_stream_t *s) {
+    s->buf_offset += s->fill;
+    ssize_t n = read(s->fd, s->buf, s->buf_size);
+    s->pos = 0;
+    s->fill = n > 0 ? (size_t)n : 0;
+    if (n < 0) {
+        ESP_LOGE(TAG, "stream read failed: %s", strerror(errno));
+        s->err = ESP_FAIL;
+        return s->err;
+    }
+    if (n == 0) s->eof = true;
+    return ESP_OK;
+}
+
+static esp_err_t stream_flush(sd_card_stream_t *s) {
+    if (s->fill == 0 || s->err != ESP_OK) return s->err;
+    ssize_t n = write(s->fd, s->buf, s->fill);
+    if (n < 0 || (size_t)n != s->fill) s->err = ESP_FAIL;
+    s->fill = 0;
+    return s->err;
+}
+
+esp_err_t sd_card_stream_open(const char *path, sd_card_stream_mode_t mode,
+                              const sd_card_stream_config_t *config,
+                              sd_card_stream_t **stream_out) {
+    if (!path || !stream_out) return ESP_ERR_INVALID_ARG;
+    *stream_out = NULL;
+    if (!s_mounted) return ESP_ERR_INVALID_STATE;
+
+    int flags;
+    switch (mode) {
+    case SD_CARD_STREAM_READ:   flags = O_RDONLY; break;
+    case SD_CARD_STREAM_WRITE:  flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+    case SD_CARD_STREAM_APPEND: flags = O_WRONLY | O_CREAT | O_APPEND; break;
+    default: return ESP_ERR_INVALID_ARG;
+    }
+
+    char pathbuf[1024];
+    const char *rpath = rewrite_path(path, pathbuf, sizeof(pathbuf));
+    if (!rpath) return ESP_ERR_INVALID_ARG;
+
+    size_t buf_size = (config && config->buffer_size)
+                          ? config->buffer_size
+                          : (size_t)CONFIG_SD_STREAM_BUFFER_SIZE;
+    buf_size = (buf_size + SIM_SECTOR_SIZE - 1) & ~(size_t)(SIM_SECTOR_SIZE - 1);
+
+    sd_card_stream_t *s = calloc(1, sizeof(*s));
+    if (!s) return ESP_ERR_NO_MEM;
+    s->writing = mode != SD_CARD_STREAM_READ;
+    s->buf_size = buf_size;
+    s->buf = malloc(buf_size);
+    if (!s->buf) { free(s); return ESP_ERR_NO_MEM; }
+
+    if (s->writing) s_generation++;
+    s->fd = open(rpath, flags, 0666);
+    if (s->fd < 0) {
+        esp_err_t ret = (!s->writing && errno == ENOENT) ? ESP_ERR_NOT_FOUND
+                                                         : ESP_FAIL;
+        if (s->writing)
+            ESP_LOGE(TAG, "stream_open: cannot open %s: %s", rpath, strerror(errno));
+        free(s->buf);
+        free(s);
+        return ret;
+    }
+    if (!s->writing) {
+        struct stat st;
+        if (fstat(s->fd, &st) == 0) s->size = (size_t)st.st_size;
+    }
+    *stream_out = s;
+    return ESP_OK;
+}
+
+esp_err_t sd_card_stream_size(sd_card_stream_t *stream, size_t *size_out) {
+    if (!stream || stream->writing || !size_out) return ESP_ERR_INVALID_ARG;
+    *size_out = stream->size;
+    return ESP_OK;
+}
+
+esp_err_t sd_card_stream_read_chunk(sd_card_stream_t *stream, uint8_t *data,
+                                    size_t len, size_t *read_out) {
+    if (!stream || stream->writing || (!data && len) || !read_out)
+        return ESP_ERR_INVALID_ARG;
+    *read_out = 0;
+    if (stream->err != ESP_OK) return stream->err;
+
+    size_t done = 0;
+    while (done < len) {
+        if (stream->pos == stream->fill) {
+            if (stream->eof) break;
+            esp_err_t ret = stream_refill(stream);
+            if (ret != ESP_OK) return ret;
+            continue;
+        }
+        size_t n = stream->fill - stream->pos;
+        if (n > len - done) n = len - done;
+        memcpy(data + done, stream->buf + stream->pos, n);
+        stream->pos += n;
+        done += n;
+    }
+    *read_out = done;
+    return ESP_OK;
+}
+
+esp_err_t sd_card_stream_seek(sd_card_stream_t *stream, size_t offset) {
+    if (!stream || stream->writing) return ESP_ERR_INVALID_ARG;
+    if (stream->err != ESP_OK) return stream->err;
+    if (offset >= stream->buf_offset &&
+        offset <= stream->buf_offset + stream->fill) {
+        stream->pos = offset - stream->buf_offset;
+        return ESP_OK;
+    }
+    if (lseek(stream->fd, (off_t)offset, SEEK_SET) < 0) {
+        stream->err = ESP_FAIL;
+        return stream->err;
+    }
+    stream->buf_offset = offset;
+    stream->fill = 0;
+    stream->pos = 0;
+    stream->eof = false;
+    return ESP_OK;
+}
+
+esp_err_t sd_card_stream_write_chunk(sd_card_stream_t *stream,
+                                     const uint8_t *data, size_t len) {
+    if (!stream || !stream->writing || (!data && len)) return ESP_ERR_INVALID_ARG;
+    size_t done = 0;
+    while (done < len && stream->err == ESP_OK) {
+        size_t n = stream->buf_size - stream->fill;
+        if (n > len - done) n = len - done;
+        memcpy(stream->buf + stream->fill, data + done, n);
+        stream->fill += n;
+        done += n;
+        if (stream->fill == stream->buf_size) stream_flush(stream);
+    }
+    return stream->err;
+}
+
+esp_err_t sd_card_stream_close(sd_card_stream_t *stream) {
+    if (!stream) return ESP_OK;
+    if (stream->writing) {
+        stream_flush(stream);
+        s_generation++;
+    }
+    if (close(stream->fd) != 0 && stream->err == ESP_OK) stream->err = ESP_FAIL;
+    esp_err_t ret = stream->err;
+    free(stream->buf);
+    free(stream);
+    return ret;
+}
+
+/* One "bus mode" on the host: whatever the filesystem under the SD root
+ * delivers, through the same stream path the firmware uses. */
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+esp_err_t sd_card_self_test(size_t test_bytes,
+                            sd_card_self_test_result_t *results,
+                            size_t max_results, size_t *count_out) {
+    if (test_bytes == 0 || (!results && max_results) || !count_out)
+        return ESP_ERR_INVALID_ARG;
+    *count_out = 0;
+    if (!s_mounted) return ESP_ERR_INVALID_STATE;
+
+    const char *path = SD_CARD_MOUNT_POINT "/.kern_speed.tmp";
+    uint8_t chunk[4096];
+    for (size_t i = 0; i < sizeof(chunk); i++) chunk[i] = (uint8_t)(i * 131 + 7);
+
+    sd_card_self_test_result_t r = {0};
+    sd_card_stream_t *s;
+    double t0 = now_us();
+    esp_err_t ret = sd_card_stream_open(path, SD_CARD_STREAM_WRITE, NULL, &s);
+    if (ret != ESP_OK) return ret;
+    for (size_t done = 0; done < test_bytes && ret == ESP_OK; done += sizeof(chunk)) {
+        size_t n = test_bytes - done < sizeof(chunk) ? test_bytes - done : sizeof(chunk);
+        ret = sd_card_stream_write_chunk(s, chunk, n);
+    }
+    esp_err_t close_ret = sd_card_stream_close(s);
+    if (ret == ESP_OK) ret = close_ret;
+    double t1 = now_us();
+    r.write_mbps = (float)(test_bytes / (t1 - t0));
+
+    for (int pass = 0; pass < 2 && ret == ESP_OK; pass++) {
+        sd_card_stream_config_t config = {.read_ahead = pass == 1};
+        t0 = now_us();
+        ret = sd_card_stream_open(path, SD_CARD_STREAM_READ, &config, &s);
+        if (ret != ESP_OK) break;
+        size_t total = 0, n;
+        do {
+            ret = sd_card_stream_read_chunk(s, chunk, sizeof(chunk), &n);
+            total += n;
+        } while (ret == ESP_OK && n > 0);
+        sd_card_stream_close(s);
+        if (ret == ESP_OK && total != test_bytes) ret = ESP_ERR_INVALID_SIZE;
+        float mbps = (float)(total / (now_us() - t0));
+        if (pass == 0) r.read_mbps = mbps;
+        else r.read_ahead_mbps = mbps;
+    }
+    sd_card_delete_file(path);
+    if (ret != ESP_OK) return ret;
+
+    ESP_LOGI(TAG, "self-test: write %.2f MB/s, read %.2f MB/s, read-ahead %.2f MB/s",
+             r.write_mbps, r.read_mbps, r.read_ahead_mbps);
+    if (max_results > 0) {
+        results[0] = r;
+        *count_out = 1;
+    }
+    return ESP_OK;
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 /**
  * Set the QR image path for the video simulator.
  * Call before app_video_init_once(). If NULL or not called, a blank frame is
@@ -22,3 +26,24 @@ void sim_video_set_qr_dir(const char *dir_path);
  * Requires SIM_WEBCAM build option; otherwise prints a warning and is a no-op.
  */
 void sim_video_set_webcam(const char *device);
+
+/**
+ * Switch the video simulator to lockstep replay of a recorded frame sequence.
+ * `path` is a directory holding either a frames.txt manifest
+ * ("<timestamp_ms> <file> [<width> <height>]" per line, dimensions marking a
+ * raw little-endian RGB565 frame) or, without one, PNG/JPEG frames replayed
+ * in filename order at a nominal 33 ms spacing. `path` may instead be a .ksr
+ * recording from the on-device scan recorder (components/video/scan_recording.h).
+ * Call before app_video_init_once(). Returns false if no frame was found.
+ */
+bool sim_video_set_replay(const char *path);
+
+/** Number of frames loaded by sim_video_set_replay(). */
+size_t sim_video_replay_frame_count(void);
+
+/**
+ * Deliver replay frame `index` to the active frame callback, synchronously on
+ * the calling thread. Only valid between app_video_start() and
+ * app_video_stop(). Stores the frame's recorded timestamp in `timestamp_ms`.
+ */
+bool sim_video_replay_push(size_t index, uint32_t *timestamp_ms);
@@ -4,10 +4,16 @@
  * Loads QR images from disk or captures webcam frames, converts them to RGB565,
  * and delivers frames at ~30fps through the same singleton video API used by
  * firmware.
+ *
+ * Replay mode (sim_video_set_replay) instead delivers a recorded frame
+ * sequence one frame at a time, on the caller's thread, when the headless
+ * scan benchmark asks for it.
  */
 
 #include "video/video.h"
+#include "video/scan_recording.h"
 #include "esp_err.h"
+#include "sim_video.h"
 #include "esp_log.h"
 #include "stb_image.h"
 #ifdef SIM_WEBCAM
@@ -23,6 +29,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 static const char *TAG = "VIDEO_SIM";
@@ -34,6 +41,7 @@ static uint32_t s_height = 640;
 static size_t s_frame_size = 0;
 
 static pthread_t s_stream_thread;
+static bool s_stream_thread_running = false;
 static volatile bool s_streaming = false;
 static bool s_initialized = false;
 
@@ -41,6 +49,21 @@ static char *s_qr_image_path = NULL;
 static char *s_qr_image_dir = NULL;
 static size_t s_qr_dir_index = 0;
 
+typedef struct {
+  char *path;            // NULL for frames of a .ksr recording
+  long ksr_offset;       // FRME payload offset within s_replay_ksr_path
+  uint32_t timestamp_ms;
+  uint32_t width; // 0: taken from the decoded image
+  uint32_t height;
+} replay_frame_t;
+
+static replay_frame_t *s_replay_frames = NULL;
+static size_t s_replay_count = 0;
+static char *s_replay_ksr_path = NULL;
+
+static uint32_t s_ae_target = 0;
+static uint32_t s_focus = 0;
+
 #ifdef SIM_WEBCAM
 static bool s_webcam_enabled = false;
 static char *s_webcam_device = NULL;
@@ -77,6 +100,27 @@ static uint8_t *load_rgb565(const char *path, uint32_t *out_w, uint32_t *out_h,
   return (uint8_t *)buf;
 }
 
+static uint8_t *load_raw_rgb565(const char *path, uint32_t w, uint32_t h,
+                                size_t *out_size) {
+  size_t sz = (size_t)w * h * 2;
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    ESP_LOGE(TAG, "Cannot open raw frame: %s", path);
+    return NULL;
+  }
+  uint8_t *buf = malloc(sz);
+  if (buf && fread(buf, 1, sz, f) != sz) {
+    ESP_LOGE(TAG, "Raw frame %s is shorter than %" PRIu32 "x%" PRIu32, path, w,
+             h);
+    free(buf);
+    buf = NULL;
+  }
+  fclose(f);
+  if (buf)
+    *out_size = sz;
+  return buf;
+}
+
 static uint8_t *alloc_blank_rgb565(uint32_t w, uint32_t h, size_t *out_size) {
   size_t sz = (size_t)w * h * 2;
   uint8_t *buf = calloc(1, sz);
@@ -159,12 +203,92 @@ static uint8_t *load_next_dir_rgb565(uint32_t *out_w, uint32_t *out_h,
   return buf;
 }
 
+// Rebuilds the scanner's decode frame from a recorded ROI: gray pixels are
+// widened to RGB565 (the scanner converts back, losing the low 2-3 bits) and
+// placed on a mid-gray frame of the recording's decode size, which the
+// simulator PPA then passes through unscaled.
+static uint8_t *load_ksr_frame(const replay_frame_t *frame, size_t *out_size) {
+  FILE *f = fopen(s_replay_ksr_path, "rb");
+  if (!f) {
+    ESP_LOGE(TAG, "Cannot open recording: %s", s_replay_ksr_path);
+    return NULL;
+  }
+  uint8_t meta[SCAN_RECORDING_FRAME_META_SIZE];
+  uint16_t *buf = NULL;
+  uint8_t *gray = NULL;
+  if (fseek(f, frame->ksr_offset, SEEK_SET) != 0 ||
+      fread(meta, 1, sizeof(meta), f) != sizeof(meta))
+    goto out;
+
+  uint32_t rx = scan_recording_get_u16(meta + 4);
+  uint32_t ry = scan_recording_get_u16(meta + 6);
+  uint32_t rw = scan_recording_get_u16(meta + 8);
+  uint32_t rh = scan_recording_get_u16(meta + 10);
+  if (rx + rw > frame->width || ry + rh > frame->height) {
+    ESP_LOGE(TAG, "Recorded ROI exceeds frame at offset %ld",
+             frame->ksr_offset);
+    goto out;
+  }
+
+  size_t npixels = (size_t)frame->width * frame->height;
+  buf = malloc(npixels * 2);
+  gray = malloc((size_t)rw * rh);
+  if (!buf || !gray || fread(gray, 1, (size_t)rw * rh, f) != (size_t)rw * rh) {
+    free(buf);
+    buf = NULL;
+    goto out;
+  }
+
+  const uint16_t mid_gray = (16 << 11) | (32 << 5) | 16;
+  for (size_t i = 0; i < npixels; i++)
+    buf[i] = mid_gray;
+  for (uint32_t y = 0; y < rh; y++) {
+    const uint8_t *src = gray + (size_t)y * rw;
+    uint16_t *dst = buf + (size_t)(ry + y) * frame->width + rx;
+    for (uint32_t x = 0; x < rw; x++) {
+      uint16_t v = src[x];
+      dst[x] = (uint16_t)(((v >> 3) << 11) | ((v >> 2) << 5) | (v >> 3));
+    }
+  }
+  *out_size = npixels * 2;
+
+out:
+  free(gray);
+  fclose(f);
+  return (uint8_t *)buf;
+}
+
+static uint8_t *load_replay_frame(size_t index, uint32_t *out_w,
+                                  uint32_t *out_h, size_t *out_size) {
+  const replay_frame_t *frame = &s_replay_frames[index];
+  if (!frame->path) {
+    *out_w = frame->width;
+    *out_h = frame->height;
+    return load_ksr_frame(frame, out_size);
+  }
+  if (frame->width && frame->height) {
+    *out_w = frame->width;
+    *out_h = frame->height;
+    return load_raw_rgb565(frame->path, frame->width, frame->height, out_size);
+  }
+  return load_rgb565(frame->path, out_w, out_h, out_size);
+}
+
 static esp_err_t load_configured_frame(bool rotate_dir) {
 #ifdef SIM_WEBCAM
   if (s_webcam)
     return ESP_OK;
 #endif
 
+  if (s_replay_count > 0) {
+    // Frames are pushed by sim_video_replay_push(); the first one only sizes
+    // the buffer so pages can query the resolution before streaming.
+    if (s_frame_buf)
+      return ESP_OK;
+    s_frame_buf = load_replay_frame(0, &s_width, &s_height, &s_frame_size);
+    return s_frame_buf ? ESP_OK : ESP_FAIL;
+  }
+
   uint8_t *new_buf = NULL;
   uint32_t new_w = 0;
   uint32_t new_h = 0;
@@ -320,11 +444,14 @@ esp_err_t app_video_start(app_video_frame_operation_cb_t cb, int core_id) {
 
   s_frame_cb = cb;
   s_streaming = true;
+  if (s_replay_count > 0)
+    return ESP_OK; // Lockstep: frames arrive via sim_video_replay_push()
   if (pthread_create(&s_stream_thread, NULL, stream_thread_func, NULL) != 0) {
     s_streaming = false;
     s_frame_cb = NULL;
     return ESP_FAIL;
   }
+  s_stream_thread_running = true;
   return ESP_OK;
 }
 
@@ -334,7 +461,10 @@ esp_err_t app_video_stop(void) {
     return ESP_OK;
   }
   s_streaming = false;
-  pthread_join(s_stream_thread, NULL);
+  if (s_stream_thread_running) {
+    pthread_join(s_stream_thread, NULL);
+    s_stream_thread_running = false;
+  }
   s_frame_cb = NULL;
 #ifdef SIM_WEBCAM
   if (s_webcam) {
@@ -347,14 +477,20 @@ esp_err_t app_video_stop(void) {
 
 esp_err_t app_video_set_ae_target(uint32_t level) {
   ESP_LOGI(TAG, "AE target: %" PRIu32 " (no-op in sim)", level);
+  s_ae_target = level;
   return ESP_OK;
 }
 
+uint32_t app_video_get_ae_target(void) { return s_ae_target; }
+
 esp_err_t app_video_set_focus(uint32_t position) {
   ESP_LOGI(TAG, "Focus: %" PRIu32 " (no-op in sim)", position);
+  s_focus = position;
   return ESP_OK;
 }
 
+uint32_t app_video_get_focus(void) { return s_focus; }
+
 bool app_video_has_focus_motor(void) { return false; }
 
 bool app_video_has_ae_control(void) { return false; }
@@ -371,6 +507,226 @@ void sim_video_set_qr_dir(const char *dir_path) {
   s_qr_image_dir = dir_path ? strdup(dir_path) : NULL;
 }
 
+static int compare_replay_frames(const void *a, const void *b) {
+  return strcmp(((const replay_frame_t *)a)->path,
+                ((const replay_frame_t *)b)->path);
+}
+
+static bool add_replay_frame(size_t *capacity, const char *dir,
+                             const char *name, uint32_t timestamp_ms,
+                             uint32_t width, uint32_t height) {
+  if (s_replay_count >= *capacity) {
+    size_t new_capacity = *capacity ? *capacity * 2 : 64;
+    replay_frame_t *tmp =
+        realloc(s_replay_frames, new_capacity * sizeof(replay_frame_t));
+    if (!tmp)
+      return false;
+    s_replay_frames = tmp;
+    *capacity = new_capacity;
+  }
+  size_t len = strlen(dir) + 1 + strlen(name) + 1;
+  char *path = malloc(len);
+  if (!path)
+    return false;
+  snprintf(path, len, "%s/%s", dir, name);
+  s_replay_frames[s_replay_count++] = (replay_frame_t){
+      .path = path,
+      .ksr_offset = -1,
+      .timestamp_ms = timestamp_ms,
+      .width = width,
+      .height = height,
+  };
+  return true;
+}
+
+static void clear_replay(void) {
+  for (size_t i = 0; i < s_replay_count; i++)
+    free(s_replay_frames[i].path);
+  free(s_replay_frames);
+  s_replay_frames = NULL;
+  s_replay_count = 0;
+  free(s_replay_ksr_path);
+  s_replay_ksr_path = NULL;
+}
+
+// frames.txt: one "<timestamp_ms> <file> [<width> <height>]" per line; the
+// dimensions mark a raw little-endian RGB565 frame. '#' starts a comment.
+static bool load_replay_manifest(const char *dir, FILE *manifest) {
+  size_t capacity = 0;
+  char line[512];
+  unsigned line_no = 0;
+  while (fgets(line, sizeof(line), manifest)) {
+    line_no++;
+    char *hash = strchr(line, '#');
+    if (hash)
+      *hash = '\0';
+    char name[256];
+    unsigned long ts = 0, w = 0, h = 0;
+    int fields = sscanf(line, "%lu %255s %lu %lu", &ts, name, &w, &h);
+    if (fields <= 0)
+      continue;
+    if (fields != 2 && fields != 4) {
+      ESP_LOGE(TAG, "frames.txt:%u: expected <ms> <file> [<w> <h>]", line_no);
+      return false;
+    }
+    if (!add_replay_frame(&capacity, dir, name, (uint32_t)ts, (uint32_t)w,
+                          (uint32_t)h))
+      return false;
+  }
+  return true;
+}
+
+static bool load_replay_dir(const char *dir_path) {
+  DIR *dir = opendir(dir_path);
+  if (!dir)
+    return false;
+
+  size_t capacity = 0;
+  bool ok = true;
+  struct dirent *ent;
+  while (ok && (ent = readdir(dir)) != NULL) {
+    const char *name = ent->d_name;
+    size_t nlen = strlen(name);
+    bool is_img =
+        (nlen > 4 && (strcasecmp(name + nlen - 4, ".png") == 0 ||
+                      strcasecmp(name + nlen - 4, ".jpg") == 0)) ||
+        (nlen > 5 && strcasecmp(name + nlen - 5, ".jpeg") == 0);
+    if (is_img)
+      ok = add_replay_frame(&capacity, dir_path, name, 0, 0, 0);
+  }
+  closedir(dir);
+  if (!ok)
+    return false;
+
+  qsort(s_replay_frames, s_replay_count, sizeof(replay_frame_t),
+        compare_replay_frames);
+  // No manifest: assume the sensor's nominal ~30 fps.
+  for (size_t i = 0; i < s_replay_count; i++)
+    s_replay_frames[i].timestamp_ms = (uint32_t)(i * 33);
+  return true;
+}
+
+// Indexes the FRME chunks of a .ksr recording (format in scan_recording.h);
+// pixels are read lazily by load_ksr_frame().
+static bool load_replay_ksr(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+
+  uint8_t header[SCAN_RECORDING_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+      memcmp(header, SCAN_RECORDING_MAGIC, 4) != 0 ||
+      scan_recording_get_u16(header + 4) != SCAN_RECORDING_VERSION ||
+      scan_recording_get_u16(header + 6) != SCAN_RECORDING_PIXFMT_GRAY8) {
+    ESP_LOGE(TAG, "%s is not a version %d scan recording", path,
+             SCAN_RECORDING_VERSION);
+    fclose(f);
+    return false;
+  }
+  uint32_t frame_w = scan_recording_get_u16(header + 8);
+  uint32_t frame_h = scan_recording_get_u16(header + 10);
+
+  s_replay_ksr_path = strdup(path);
+  size_t capacity = 0;
+  bool ok = s_replay_ksr_path != NULL;
+  long offset = SCAN_RECORDING_HEADER_SIZE;
+  uint8_t chunk[SCAN_RECORDING_CHUNK_HEADER_SIZE + 4];
+  while (ok && fseek(f, offset, SEEK_SET) == 0 &&
+         fread(chunk, 1, sizeof(chunk), f) == sizeof(chunk)) {
+    uint32_t len = scan_recording_get_u32(chunk + 4);
+    long payload = offset + SCAN_RECORDING_CHUNK_HEADER_SIZE;
+    if (memcmp(chunk, SCAN_RECORDING_TAG_FRAME, 4) == 0 &&
+        len >= SCAN_RECORDING_FRAME_META_SIZE) {
+      if (s_replay_count >= capacity) {
+        size_t new_capacity = capacity ? capacity * 2 : 64;
+        replay_frame_t *tmp =
+            realloc(s_replay_frames, new_capacity * sizeof(replay_frame_t));
+        if (!tmp) {
+          ok = false;
+          break;
+        }
+        s_replay_frames = tmp;
+        capacity = new_capacity;
+      }
+      s_replay_frames[s_replay_count++] = (replay_frame_t){
+          .path = NULL,
+          .ksr_offset = payload,
+          .timestamp_ms = scan_recording_get_u32(chunk + 8),
+          .width = frame_w,
+          .height = frame_h,
+      };
+    }
+    offset = payload + (long)len;
+  }
+  fclose(f);
+  // A recording cut short by power loss ends in a partial chunk; the frames
+  // before it are still usable, and load_ksr_frame() rejects a short read.
+  return ok;
+}
+
+bool sim_video_set_replay(const char *path) {
+  clear_replay();
+
+  struct stat st;
+  if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+    if (!load_replay_ksr(path) || s_replay_count == 0) {
+      ESP_LOGE(TAG, "No replay frames found in %s", path);
+      clear_replay();
+      return false;
+    }
+    ESP_LOGI(TAG, "Replay: %zu recorded frames from %s", s_replay_count, path);
+    return true;
+  }
+
+  size_t len = strlen(path) + sizeof("/frames.txt");
+  char *manifest_path = malloc(len);
+  if (!manifest_path)
+    return false;
+  snprintf(manifest_path, len, "%s/frames.txt", path);
+  FILE *manifest = fopen(manifest_path, "r");
+  free(manifest_path);
+
+  bool ok;
+  if (manifest) {
+    ok = load_replay_manifest(path, manifest);
+    fclose(manifest);
+  } else {
+    ok = load_replay_dir(path);
+  }
+
+  if (!ok || s_replay_count == 0) {
+    ESP_LOGE(TAG, "No replay frames found in %s", path);
+    clear_replay();
+    return false;
+  }
+  ESP_LOGI(TAG, "Replay: %zu frames from %s", s_replay_count, path);
+  return true;
+}
+
+size_t sim_video_replay_frame_count(void) { return s_replay_count; }
+
+bool sim_video_replay_push(size_t index, uint32_t *timestamp_ms) {
+  if (index >= s_replay_count || !s_streaming || !s_frame_cb)
+    return false;
+
+  uint32_t w = 0, h = 0;
+  size_t size = 0;
+  uint8_t *buf = load_replay_frame(index, &w, &h, &size);
+  if (!buf)
+    return false;
+
+  free(s_frame_buf);
+  s_frame_buf = buf;
+  s_width = w;
+  s_height = h;
+  s_frame_size = size;
+
+  if (timestamp_ms)
+    *timestamp_ms = s_replay_frames[index].timestamp_ms;
+  s_frame_cb(s_frame_buf, 0, s_width, s_height, s_frame_size);
+  return true;
+}
+
 void sim_video_set_webcam(const char *device) {
 #ifdef SIM_WEBCAM
   free(s_webcam_device);
@@ -3,6 +3,10 @@
  *
  * Mirrors the initialization sequence from main/main.c but uses
  * SDL2 for display and mouse input instead of ESP32-P4 hardware.
+ * With --headless it skips SDL entirely and runs the scan-replay
+ * benchmark against a dummy display instead of the interactive UI.
+ * --perf-json starts the telemetry sampler (utils/perf.h), shows its overlay
+ * and writes the collected JSON on exit.
  */
 
 #include "lvgl.h"
@@ -17,9 +21,13 @@
 #include "pages/session_lock.h"
 #include "esp_lvgl_port.h"
 #include "utils/bip39_filter.h"
+#include "utils/perf.h"
+#include "ui/perf_overlay.h"
+#include "ui/settings_commit.h"
 #include <wally_core.h>
 #include <nvs_flash.h>
 #include <esp_err.h>
+#include "scan_bench.h"
 #include "sim_video.h"
 #include "video/video.h"
 #include "sim_flash.h"
@@ -48,6 +56,23 @@
 /* Splash → PIN transition (fired by one-shot LVGL timer after 3 s)          */
 /* -------------------------------------------------------------------------- */
 
+/* Quitting and esp_restart() both go through exit(): commit what the
+ * debounced settings commit has not reached yet. */
+static void flush_settings_at_exit(void) { settings_flush(); }
+
+static const char *perf_json_path = NULL;
+
+static void write_perf_json_at_exit(void) {
+    size_t len = 0;
+    char *json = perf_json(&len);
+    FILE *f = json ? fopen(perf_json_path, "w") : NULL;
+    if (!f || fwrite(json, 1, len, f) != len)
+        fprintf(stderr, "Cannot write %s\n", perf_json_path);
+    if (f)
+        fclose(f);
+    free(json);
+}
+
 static void splash_done_cb(lv_timer_t *t) {
     lv_timer_delete(t);
 
@@ -56,6 +81,32 @@ static void splash_done_cb(lv_timer_t *t) {
     session_lock_boot_gate(scr);
 }
 
+/* -------------------------------------------------------------------------- */
+/* Headless display: renders into a strip buffer that is never shown          */
+/* -------------------------------------------------------------------------- */
+
+#define HEADLESS_BUF_LINES 40
+
+static void headless_flush_cb(lv_display_t *disp, const lv_area_t *area,
+                              uint8_t *px_map) {
+    (void)area;
+    (void)px_map;
+    lv_display_flush_ready(disp);
+}
+
+static lv_display_t *headless_display_create(int width, int height) {
+    lv_display_t *disp = lv_display_create(width, height);
+    if (!disp) return NULL;
+    uint32_t buf_size = (uint32_t)width * HEADLESS_BUF_LINES *
+                        lv_color_format_get_size(lv_display_get_color_format(disp));
+    void *buf = malloc(buf_size);
+    if (!buf) return NULL;
+    lv_display_set_buffers(disp, buf, NULL, buf_size,
+                           LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(disp, headless_flush_cb);
+    return disp;
+}
+
 /* -------------------------------------------------------------------------- */
 /* Main                                                                        */
 /* -------------------------------------------------------------------------- */
@@ -70,6 +121,10 @@ static void print_usage(const char *prog) {
     printf("  -W, --width <N>         Display width in pixels (default: %d)\n", SIM_LCD_H_RES);
     printf("  -H, --height <N>        Display height in pixels (default: %d)\n", SIM_LCD_V_RES);
     printf("  -w, --webcam [device]   Use webcam (default: /dev/video0)\n");
+    printf("  -r, --replay <path>     Replay a frame directory or .ksr recording\n");
+    printf("      --headless          No window: run the scan-replay benchmark\n");
+    printf("      --report <path>     Benchmark JSON report (default: stdout)\n");
+    printf("      --perf-json <path>  Telemetry overlay; JSON written on exit\n");
     printf("  -v, --verbose           Enable DEBUG-level logging\n");
     printf("  -h, --help              Show this help\n");
 }
@@ -102,14 +157,20 @@ int main(int argc, char *argv[]) {
         { "width",    required_argument, NULL, 'W' },
         { "height",   required_argument, NULL, 'H' },
         { "webcam",   optional_argument, NULL, 'w' },
+        { "replay",   required_argument, NULL, 'r' },
+        { "headless", no_argument,       NULL, 'X' },
+        { "report",   required_argument, NULL, 'R' },
+        { "perf-json", required_argument, NULL, 'P' },
         { "verbose",  no_argument,       NULL, 'v' },
         { "help",     no_argument,       NULL, 'h' },
         { NULL, 0, NULL, 0 }
     };
     int sim_width = SIM_LCD_H_RES;
     int sim_height = SIM_LCD_V_RES;
+    bool headless = false;
+    const char *report_path = NULL;
     int opt;
-    while ((opt = getopt_long(argc, argv, "q:Q:d:W:H:w::vh", long_opts, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "q:Q:d:W:H:w::r:vh", long_opts, NULL)) != -1) {
         switch (opt) {
             case 'q':
                 sim_video_set_qr_image(optarg);
@@ -138,6 +199,21 @@ int main(int argc, char *argv[]) {
             case 'w':
                 sim_video_set_webcam(optarg);
                 break;
+            case 'r':
+                if (!sim_video_set_replay(optarg)) {
+                    fprintf(stderr, "Cannot load replay: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'X':
+                headless = true;
+                break;
+            case 'R':
+                report_path = optarg;
+                break;
+            case 'P':
+                perf_json_path = optarg;
+                break;
             case 'v':
                 esp_log_level_set("*", ESP_LOG_DEBUG);
                 break;
@@ -147,7 +223,8 @@ int main(int argc, char *argv[]) {
             default:
                 fprintf(stderr,
                     "Usage: %s [--qr-image PATH] [--qr-dir DIR] [--data-dir DIR]"
-                    " [--width N] [--height N] [--verbose]\n",
+                    " [--width N] [--height N] [--replay PATH [--headless]]"
+                    " [--perf-json PATH] [--verbose]\n",
                     argv[0]);
                 return 1;
         }
@@ -161,21 +238,40 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (headless && sim_video_replay_frame_count() == 0) {
+        fprintf(stderr, "--headless requires --replay <path>\n");
+        return 1;
+    }
+
+    /* Before anything that is timed or counted. Also covers the headless
+     * benchmark, whose return from main() runs the export. */
+    if (perf_json_path) {
+        perf_init();
+        atexit(write_perf_json_at_exit);
+    }
+
     /* Initialize LVGL */
     lv_init();
 
-    /* Create SDL2 display */
-    lv_display_t *disp = lv_sdl_window_create(sim_width, sim_height);
-    if (!disp) {
-        fprintf(stderr, "Failed to create SDL display\n");
-        return 1;
-    }
+    if (headless) {
+        if (!headless_display_create(sim_width, sim_height)) {
+            fprintf(stderr, "Failed to create headless display\n");
+            return 1;
+        }
+    } else {
+        /* Create SDL2 display */
+        lv_display_t *disp = lv_sdl_window_create(sim_width, sim_height);
+        if (!disp) {
+            fprintf(stderr, "Failed to create SDL display\n");
+            return 1;
+        }
 
-    lv_sdl_window_set_title(disp, "Kern Simulator");
+        lv_sdl_window_set_title(disp, "Kern Simulator");
 
-    /* Create SDL2 mouse input */
-    lv_indev_t *mouse = lv_sdl_mouse_create();
-    (void)mouse;
+        /* Create SDL2 mouse input */
+        lv_indev_t *mouse = lv_sdl_mouse_create();
+        (void)mouse;
+    }
 
     /* Initialize theme (copies Montserrat fonts, sets icon fallbacks) */
     theme_init();
@@ -203,6 +299,7 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "Settings init failed, using defaults: %s\n",
                 esp_err_to_name(settings_ret));
     }
+    atexit(flush_settings_at_exit);
 
     /* Initialize PMIC (simulated battery on wave_35; no-op on wave_4b) */
     bsp_pmic_init();
@@ -213,6 +310,9 @@ int main(int argc, char *argv[]) {
                  esp_err_to_name(video_ret));
     }
 
+    if (headless)
+        return scan_bench_run(report_path);
+
     /* -----------------------------------------------------------------------
      * Show animated Kern logo splash screen
      * --------------------------------------------------------------------- */
@@ -233,9 +333,15 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    /* Debounced settings commits run from a UI deadline from here on */
+    ui_settings_commit_init();
+
     /* Start inactivity monitoring (screensaver + session lock) */
     session_lock_init();
 
+    if (perf_json_path)
+        perf_overlay_create();
+
     /* -----------------------------------------------------------------------
      * Schedule transition to PIN gate after 3-second splash
      * (single-threaded: use one-shot LVGL timer instead of vTaskDelay)
@@ -0,0 +1,236 @@
+/**
+ * Headless scan-replay benchmark — see scan_bench.h.
+ *
+ * Frames are pushed from the main thread through sim_video_replay_push(),
+ * which runs the scanner's camera callback synchronously; the decode task then
+ * reports back through the scanner frame observer. Waiting for that report
+ * before pushing the next frame keeps the run deterministic: no frame is ever
+ * dropped because the decoder happened to be busy.
+ *
+ * Times to first part / completion are measured on the recording's own
+ * timeline (frame timestamps), so they do not depend on host speed. Decode
+ * latency is host wall-clock time spent inside the decode task per frame.
+ */
+
+#include "scan_bench.h"
+#include "esp_lvgl_port.h"
+#include "qr/parser.h"
+#include "qr/scanner.h"
+#include "sim_video.h"
+#include "lvgl.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* A frame that never reports back (decoder resize failure) is counted as lost
+ * rather than hanging the run. */
+#define FRAME_DECODE_TIMEOUT_MS 5000
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t reported;
+    qr_scanner_frame_stats_t last;
+} frame_sync_t;
+
+static frame_sync_t s_sync = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void frame_observer(const qr_scanner_frame_stats_t *stats) {
+    pthread_mutex_lock(&s_sync.lock);
+    s_sync.last = *stats;
+    s_sync.reported++;
+    pthread_cond_signal(&s_sync.cond);
+    pthread_mutex_unlock(&s_sync.lock);
+}
+
+static bool wait_for_frame(uint64_t expected, qr_scanner_frame_stats_t *out) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += FRAME_DECODE_TIMEOUT_MS / 1000;
+    deadline.tv_nsec += (long)(FRAME_DECODE_TIMEOUT_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    bool ok = true;
+    pthread_mutex_lock(&s_sync.lock);
+    while (s_sync.reported < expected) {
+        if (pthread_cond_timedwait(&s_sync.cond, &s_sync.lock, &deadline) ==
+            ETIMEDOUT) {
+            ok = false;
+            break;
+        }
+    }
+    if (ok)
+        *out = s_sync.last;
+    else
+        s_sync.reported = expected; /* Give up on this frame's report */
+    pthread_mutex_unlock(&s_sync.lock);
+    return ok;
+}
+
+static void scanner_return_cb(void) {}
+
+static int compare_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile over a sorted array. */
+static int64_t percentile(const int64_t *sorted, size_t n, unsigned pct) {
+    if (n == 0)
+        return 0;
+    size_t rank = (n * pct + 99) / 100;
+    if (rank == 0)
+        rank = 1;
+    return sorted[rank - 1];
+}
+
+static const char *format_name(int format) {
+    switch (format) {
+        case FORMAT_NONE:  return "single";
+        case FORMAT_PMOFN: return "pMofN";
+        case FORMAT_UR:    return "UR";
+        case FORMAT_BBQR:  return "BBQr";
+        default:           return "unknown";
+    }
+}
+
+int scan_bench_run(const char *report_path) {
+    size_t frame_count = sim_video_replay_frame_count();
+    if (frame_count == 0) {
+        fprintf(stderr, "scan bench: no replay loaded (use --replay)\n");
+        return 1;
+    }
+
+    int64_t *latencies = calloc(frame_count, sizeof(int64_t));
+    if (!latencies)
+        return 1;
+
+    qr_scanner_set_frame_observer(frame_observer);
+
+    lvgl_port_lock(0);
+    qr_scanner_page_create(lv_screen_active(), scanner_return_cb);
+    bool ready = qr_scanner_is_ready();
+    lvgl_port_unlock();
+    if (!ready) {
+        fprintf(stderr, "scan bench: scanner failed to start\n");
+        qr_scanner_set_frame_observer(NULL);
+        free(latencies);
+        return 1;
+    }
+
+    size_t frames_pushed = 0;
+    size_t frames_decoded = 0;
+    size_t frames_lost = 0;
+    size_t frames_with_code = 0;
+    long parts_new = 0;
+    long parts_duplicate = 0;
+    bool complete = false;
+    bool failed = false;
+    uint32_t first_ts = 0;
+    int64_t first_part_ms = -1;
+    int64_t complete_ms = -1;
+    int64_t decode_total_us = 0;
+    uint64_t expected_reports = 0;
+
+    for (size_t i = 0; i < frame_count && !complete && !failed; i++) {
+        uint32_t ts = 0;
+        lvgl_port_lock(0);
+        bool pushed = sim_video_replay_push(i, &ts);
+        lvgl_port_unlock();
+        if (!pushed) {
+            fprintf(stderr, "scan bench: failed to load frame %zu\n", i);
+            continue;
+        }
+        if (frames_pushed++ == 0)
+            first_ts = ts;
+
+        qr_scanner_frame_stats_t stats;
+        if (!wait_for_frame(++expected_reports, &stats)) {
+            frames_lost++;
+            continue;
+        }
+
+        latencies[frames_decoded++] = stats.decode_us;
+        decode_total_us += stats.decode_us;
+        if (stats.codes_detected > 0)
+            frames_with_code++;
+        parts_new += stats.parts_new;
+        parts_duplicate += stats.parts_duplicate;
+        if (stats.parts_new > 0 && first_part_ms < 0)
+            first_part_ms = (int64_t)ts - first_ts;
+        if (stats.complete) {
+            complete = true;
+            complete_ms = (int64_t)ts - first_ts;
+        }
+        failed = stats.failed;
+
+        /* Let LVGL render the preview as it would on device. */
+        lvgl_port_lock(0);
+        lv_timer_handler();
+        lvgl_port_unlock();
+    }
+
+    int format = qr_scanner_get_format();
+
+    lvgl_port_lock(0);
+    qr_scanner_page_destroy();
+    lvgl_port_unlock();
+    qr_scanner_set_frame_observer(NULL);
+
+    qsort(latencies, frames_decoded, sizeof(int64_t), compare_i64);
+
+    FILE *out = stdout;
+    if (report_path && strcmp(report_path, "-") != 0) {
+        out = fopen(report_path, "w");
+        if (!out) {
+            fprintf(stderr, "scan bench: cannot write %s\n", report_path);
+            free(latencies);
+            return 1;
+        }
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"frames_total\": %zu,\n", frame_count);
+    fprintf(out, "  \"frames_pushed\": %zu,\n", frames_pushed);
+    fprintf(out, "  \"frames_decoded\": %zu,\n", frames_decoded);
+    fprintf(out, "  \"frames_lost\": %zu,\n", frames_lost);
+    fprintf(out, "  \"frames_with_code\": %zu,\n", frames_with_code);
+    fprintf(out, "  \"format\": \"%s\",\n", format_name(format));
+    fprintf(out, "  \"complete\": %s,\n", complete ? "true" : "false");
+    fprintf(out, "  \"failed\": %s,\n", failed ? "true" : "false");
+    fprintf(out, "  \"parts_new\": %ld,\n", parts_new);
+    fprintf(out, "  \"parts_duplicate\": %ld,\n", parts_duplicate);
+    fprintf(out, "  \"time_to_first_part_ms\": %" PRId64 ",\n", first_part_ms);
+    fprintf(out, "  \"time_to_complete_ms\": %" PRId64 ",\n", complete_ms);
+    fprintf(out, "  \"decode_total_us\": %" PRId64 ",\n", decode_total_us);
+    fprintf(out, "  \"decode_latency_us\": {\n");
+    fprintf(out, "    \"p50\": %" PRId64 ",\n",
+            percentile(latencies, frames_decoded, 50));
+    fprintf(out, "    \"p90\": %" PRId64 ",\n",
+            percentile(latencies, frames_decoded, 90));
+    fprintf(out, "    \"p99\": %" PRId64 ",\n",
+            percentile(latencies, frames_decoded, 99));
+    fprintf(out, "    \"max\": %" PRId64 "\n",
+            frames_decoded ? latencies[frames_decoded - 1] : 0);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+
+    if (out != stdout)
+        fclose(out);
+    free(latencies);
+    return complete ? 0 : 2;
+}
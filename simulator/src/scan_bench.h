@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * Headless scan-replay benchmark.
+ *
+ * Drives the real QR scanner page (main/qr/scanner.c) with a replay loaded by
+ * sim_video_set_replay(), one frame at a time: each frame is fully decoded
+ * before the next is pushed, so results depend only on the recording. Writes a
+ * JSON report to `report_path` ("-" or NULL for stdout).
+ *
+ * Requires lv_init(), a display (the headless dummy one is enough), and
+ * app_video_init_once() to have run. Returns 0 when the scan completed, 2 when
+ * the replay ran out first, 1 on setup errors.
+ */
+int scan_bench_run(const char *report_path);
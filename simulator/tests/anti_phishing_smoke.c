@@ -0,0 +1,173 @@
+/*
+ * Drives PIN entry through the anti-phishing table the way pin_page.c does,
+ * with pin_compute_anti_phishing() replaced by a slow stand-in, and checks
+ * that the keystroke revealing the words does not stall the UI task while
+ * still showing the words the synchronous call would.
+ */
+
+#include "core/anti_phishing_table.h"
+#include "core/pin.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "anti_phishing_smoke failed: %s\n", msg);               \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+/* Per call, roughly a slow HMAC round trip plus the wordlist lookup. */
+#define COMPUTE_MS 8
+/* Longest the reveal keystroke may hold the UI task. */
+#define UI_STALL_MS 3
+/* Between keystrokes: quicker than anyone types on a touch keypad. */
+#define KEY_GAP_MS 120
+
+static const char *const fake_words[] = {"abandon", "ability", "able",
+                                         "about",   "above",   "absent",
+                                         "absorb",  "abstract"};
+
+static uint32_t fake_hash(const char *prefix, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++)
+    h = (h ^ (uint8_t)prefix[i]) * 16777619u;
+  return h;
+}
+
+esp_err_t pin_compute_anti_phishing(const char *prefix, size_t len,
+                                    const char **word1_out,
+                                    const char **word2_out,
+                                    uint8_t identicon_out[3]) {
+  usleep(COMPUTE_MS * 1000);
+  uint32_t h = fake_hash(prefix, len);
+  *word1_out = fake_words[h % 8];
+  *word2_out = fake_words[(h >> 3) % 8];
+  if (identicon_out) {
+    identicon_out[0] = (uint8_t)(h >> 8);
+    identicon_out[1] = (uint8_t)(h >> 16);
+    identicon_out[2] = (uint8_t)(h >> 24);
+  }
+  return ESP_OK;
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* What pin_keystroke_cb does with text[0..len) for a given split. Returns
+ * the time spent, and the words when they were revealed. */
+static double keystroke(const char *text, size_t len, size_t split,
+                        ap_words_t *shown, bool *from_table) {
+  double start = now_ms();
+  *from_table = false;
+  if (len >= split) {
+    *from_table = ap_table_take(text, split, shown);
+    if (!*from_table &&
+        pin_compute_anti_phishing(text, split, &shown->word1, &shown->word2,
+                                  shown->identicon) != ESP_OK)
+      shown->word1 = shown->word2 = NULL;
+  } else if (len + 1 == split) {
+    ap_table_prepare(text, len);
+  } else {
+    ap_table_clear();
+  }
+  return now_ms() - start;
+}
+
+static bool same_as_sync(const char *prefix, size_t len,
+                         const ap_words_t *shown) {
+  ap_words_t sync;
+  if (pin_compute_anti_phishing(prefix, len, &sync.word1, &sync.word2,
+                                sync.identicon) != ESP_OK)
+    return false;
+  return shown->word1 == sync.word1 && shown->word2 == sync.word2 &&
+         memcmp(shown->identicon, sync.identicon, 3) == 0;
+}
+
+/* Types pin up to its split at KEY_GAP_MS; returns the reveal's duration. */
+static double type_to_split(const char *pin, size_t split, ap_words_t *shown,
+                            bool *from_table) {
+  double reveal = 0;
+  for (size_t len = 1; len <= split; len++) {
+    double took = keystroke(pin, len, split, shown, from_table);
+    if (len == split)
+      reveal = took;
+    else
+      usleep(KEY_GAP_MS * 1000);
+  }
+  return reveal;
+}
+
+int main(void) {
+  ap_words_t shown;
+  bool from_table;
+
+  /* Every digit at the split comes from the table, instantly. */
+  for (char d = '0'; d <= '9'; d++) {
+    char pin[] = "4820157";
+    pin[3] = d;
+    double reveal = type_to_split(pin, 4, &shown, &from_table);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "digit %c: reveal took %.2f ms", d, reveal);
+    CHECK(from_table, msg);
+    CHECK(reveal < UI_STALL_MS, msg);
+    CHECK(same_as_sync(pin, 4, &shown), "table words differ from sync");
+    ap_table_clear();
+  }
+
+  /* Taking wiped the table: the next digit is not there any more. */
+  type_to_split("1234", 3, &shown, &from_table);
+  CHECK(!ap_table_take("125", 3, &shown), "table kept after take");
+
+  /* A letter at the split is not prepared and is computed in place. */
+  double sync = type_to_split("98a", 3, &shown, &from_table);
+  CHECK(!from_table && sync >= COMPUTE_MS, "letter fell back to sync");
+  CHECK(same_as_sync("98a", 3, &shown), "letter words");
+
+  /* The miss wiped the table too, and the worker stored nothing after it. */
+  usleep(COMPUTE_MS * 2 * 1000);
+  CHECK(!ap_table_take("981", 3, &shown), "table kept after a miss");
+  printf("reveal: synchronous %.2f ms, from the table < %d ms\n", sync,
+         UI_STALL_MS);
+
+  /* Backspace below the split drops the table. */
+  keystroke("55", 2, 3, &shown, &from_table);
+  usleep(KEY_GAP_MS * 1000);
+  keystroke("5", 1, 3, &shown, &from_table);
+  CHECK(!ap_table_take("551", 3, &shown), "table survived backspace");
+
+  /* Retyped partial: the first run's late results must not land in the new
+   * table; the words shown are the new prefix's. */
+  keystroke("11", 2, 3, &shown, &from_table);
+  keystroke("22", 2, 3, &shown, &from_table);
+  usleep(KEY_GAP_MS * 1000);
+  keystroke("227", 3, 3, &shown, &from_table);
+  CHECK(from_table && same_as_sync("227", 3, &shown), "stale run stored");
+
+  /* A typist faster than the worker still gets the right words. */
+  keystroke("33", 2, 3, &shown, &from_table);
+  keystroke("339", 3, 3, &shown, &from_table);
+  CHECK(same_as_sync("339", 3, &shown), "fast typist words");
+
+  /* Split after the first character, prepared from the empty prefix. */
+  ap_table_prepare("", 0);
+  usleep(KEY_GAP_MS * 1000);
+  double reveal = keystroke("7", 1, 1, &shown, &from_table);
+  CHECK(from_table && reveal < UI_STALL_MS && same_as_sync("7", 1, &shown),
+        "split at 1");
+
+  ap_table_clear();
+  /* Let any worker still running finish before exit. */
+  usleep((COMPUTE_MS * AP_TABLE_CANDIDATES + 20) * 1000);
+  puts("anti_phishing_smoke ok");
+  return 0;
+}
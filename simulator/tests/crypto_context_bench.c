@@ -0,0 +1,203 @@
+/*
+ * Reusable crypto_utils contexts against per-call setup: checks that both
+ * give the same bytes, then times each for 32 B to 4 KB messages. Timings
+ * are printed, not checked.
+ */
+
+#include "core/crypto_utils.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "crypto_context_bench failed: %s\n", msg);              \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define MAX_LEN 4096
+#define TAG_LEN 4
+
+static const size_t sizes[] = {32, 64, 256, 1024, 4096};
+
+static const uint8_t key[CRYPTO_AES_KEY_SIZE] = {
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae,
+    0xf0, 0x85, 0x7d, 0x77, 0x81, 0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61,
+    0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4};
+static const uint8_t nonce[CRYPTO_AES_GCM_NONCE_SIZE] = {1, 2, 3, 4,  5,  6,
+                                                         7, 8, 9, 10, 11, 12};
+static const char tag_name[] = "BIP0322-signed-message";
+
+static uint8_t msg[MAX_LEN];
+static uint8_t out_a[MAX_LEN];
+static uint8_t out_b[MAX_LEN];
+
+static crypto_aes_key_t *aes_key;
+static crypto_sha256_ctx_t *tag_prefix;
+static uint8_t tag_hash[CRYPTO_SHA256_SIZE];
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* SHA256(SHA256(tag) || SHA256(tag) || data), as BIP340/BIP322 hash. */
+static int tagged_per_call(const uint8_t *data, size_t len, uint8_t *out) {
+  crypto_sha256_ctx_t *ctx;
+  int rc = crypto_sha256((const uint8_t *)tag_name, strlen(tag_name), out);
+  if (rc == CRYPTO_OK)
+    rc = crypto_sha256_start(&ctx);
+  if (rc != CRYPTO_OK)
+    return rc;
+  if (crypto_sha256_update(ctx, out, CRYPTO_SHA256_SIZE) != CRYPTO_OK ||
+      crypto_sha256_update(ctx, out, CRYPTO_SHA256_SIZE) != CRYPTO_OK ||
+      crypto_sha256_update(ctx, data, len) != CRYPTO_OK) {
+    crypto_sha256_abort(ctx);
+    return CRYPTO_ERR_INTERNAL;
+  }
+  return crypto_sha256_finish(ctx, out);
+}
+
+static int tagged_reused(const uint8_t *data, size_t len, uint8_t *out) {
+  crypto_sha256_ctx_t *ctx;
+  int rc = crypto_sha256_clone(tag_prefix, &ctx);
+  if (rc != CRYPTO_OK)
+    return rc;
+  if (crypto_sha256_update(ctx, data, len) != CRYPTO_OK) {
+    crypto_sha256_abort(ctx);
+    return CRYPTO_ERR_INTERNAL;
+  }
+  return crypto_sha256_finish(ctx, out);
+}
+
+static int gcm_per_call(const uint8_t *data, size_t len, uint8_t *out) {
+  return crypto_aes_gcm_encrypt(key, nonce, sizeof(nonce), data, len, out,
+                                out + len - TAG_LEN, TAG_LEN);
+}
+
+static int gcm_reused(const uint8_t *data, size_t len, uint8_t *out) {
+  return crypto_aes_key_gcm_encrypt(aes_key, nonce, sizeof(nonce), data, len,
+                                    out, out + len - TAG_LEN, TAG_LEN);
+}
+
+static int ecb_per_call(const uint8_t *data, size_t len, uint8_t *out) {
+  return crypto_aes_ecb_decrypt(key, data, len, out);
+}
+
+static int ecb_reused(const uint8_t *data, size_t len, uint8_t *out) {
+  return crypto_aes_key_ecb(aes_key, false, data, len, out);
+}
+
+typedef int (*op_fn)(const uint8_t *data, size_t len, uint8_t *out);
+
+typedef struct {
+  const char *name;
+  op_fn per_call;
+  op_fn reused;
+  bool whole_output; /* compare len bytes, not a digest */
+} bench_op_t;
+
+static const bench_op_t ops[] = {
+    {"tagged SHA-256", tagged_per_call, tagged_reused, false},
+    {"AES-256-GCM", gcm_per_call, gcm_reused, true},
+    {"AES-256-ECB", ecb_per_call, ecb_reused, true},
+};
+
+static double time_op(op_fn fn, size_t len, int reps) {
+  double start = now_us();
+  for (int i = 0; i < reps; i++) {
+    if (fn(msg, len, out_a) != CRYPTO_OK)
+      return -1;
+  }
+  return (now_us() - start) / reps;
+}
+
+static int check_keyed_aes(void) {
+  uint8_t iv[CRYPTO_AES_IV_SIZE] = {0};
+  uint8_t back[256];
+  memcpy(iv, nonce, sizeof(nonce));
+
+  CHECK(crypto_aes_cbc_encrypt(key, iv, msg, 256, out_a) == CRYPTO_OK &&
+            crypto_aes_key_cbc(aes_key, true, iv, msg, 256, out_b) ==
+                CRYPTO_OK &&
+            memcmp(out_a, out_b, 256) == 0,
+        "keyed CBC matches one-shot");
+  CHECK(crypto_aes_key_cbc(aes_key, false, iv, out_b, 256, back) ==
+                CRYPTO_OK &&
+            memcmp(back, msg, 256) == 0,
+        "keyed CBC round trip");
+  CHECK(crypto_aes_ctr(key, nonce, msg, 100, out_a) == CRYPTO_OK &&
+            crypto_aes_key_ctr(aes_key, nonce, msg, 100, out_b) == CRYPTO_OK &&
+            memcmp(out_a, out_b, 100) == 0,
+        "keyed CTR matches one-shot");
+
+  /* A GCM key re-imported for another tag length still verifies both. */
+  uint8_t tag16[16];
+  CHECK(crypto_aes_key_gcm_encrypt(aes_key, nonce, sizeof(nonce), msg, 100,
+                                   out_a, tag16, sizeof(tag16)) == CRYPTO_OK &&
+            crypto_aes_key_gcm_decrypt(aes_key, nonce, sizeof(nonce), out_a,
+                                       100, back, tag16,
+                                       sizeof(tag16)) == CRYPTO_OK &&
+            memcmp(back, msg, 100) == 0,
+        "keyed GCM with a 16-byte tag");
+  tag16[0] ^= 1;
+  CHECK(crypto_aes_key_gcm_decrypt(aes_key, nonce, sizeof(nonce), out_a, 100,
+                                   back, tag16, sizeof(tag16)) ==
+            CRYPTO_ERR_AUTH_FAILED,
+        "keyed GCM rejects a bad tag");
+  return 0;
+}
+
+int main(void) {
+  for (size_t i = 0; i < sizeof(msg); i++)
+    msg[i] = (uint8_t)(i * 31 + 7);
+
+  CHECK(crypto_aes_key_create(key, &aes_key) == CRYPTO_OK, "create AES key");
+  CHECK(crypto_sha256((const uint8_t *)tag_name, strlen(tag_name),
+                      tag_hash) == CRYPTO_OK &&
+            crypto_sha256_start(&tag_prefix) == CRYPTO_OK &&
+            crypto_sha256_update(tag_prefix, tag_hash, sizeof(tag_hash)) ==
+                CRYPTO_OK &&
+            crypto_sha256_update(tag_prefix, tag_hash, sizeof(tag_hash)) ==
+                CRYPTO_OK,
+        "tag prefix");
+
+  if (check_keyed_aes() != 0)
+    return 1;
+
+  for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t len = sizes[s];
+      size_t cmp = ops[o].whole_output ? len : CRYPTO_SHA256_SIZE;
+      CHECK(ops[o].per_call(msg, len, out_a) == CRYPTO_OK &&
+                ops[o].reused(msg, len, out_b) == CRYPTO_OK &&
+                memcmp(out_a, out_b, cmp) == 0,
+            ops[o].name);
+    }
+  }
+
+  printf("%-16s %6s %12s %12s %8s\n", "operation", "bytes", "per-call us",
+         "reused us", "speedup");
+  for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t len = sizes[s];
+      int reps = (int)(200000 / len) + 200;
+      double per_call = time_op(ops[o].per_call, len, reps);
+      double reused = time_op(ops[o].reused, len, reps);
+      CHECK(per_call >= 0 && reused >= 0, "timed run");
+      printf("%-16s %6zu %12.2f %12.2f %7.2fx\n", ops[o].name, len, per_call,
+             reused, reused > 0 ? per_call / reused : 0);
+    }
+  }
+
+  crypto_sha256_abort(tag_prefix);
+  crypto_aes_key_destroy(aes_key);
+  puts("crypto_context_bench ok");
+  return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Batch KEF unlock against one kef_decrypt after another: 20 envelopes of
+ * every version and mixed iteration counts, a few under another passphrase
+ * and one truncated. Checks that every envelope is reported once with the
+ * plaintext (or error) kef_decrypt gives, then prints both timings. Timings
+ * are printed, not checked.
+ */
+
+#include "core/kef.h"
+#include "core/kef_batch.h"
+#include "utils/power_gov.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "kef_batch_bench failed: %s\n", msg);                   \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define ENVELOPES 20
+
+static const uint8_t versions[] = {
+    KEF_V0_ECB_NUL_H16,    KEF_V1_CBC_NUL_H16,    KEF_V5_ECB_NUL_E3,
+    KEF_V6_ECB_PKCS7_H4,   KEF_V7_ECB_PKCS7Z_H4,  KEF_V10_CBC_NUL_E4,
+    KEF_V11_CBC_PKCS7_H4,  KEF_V12_CBC_PKCS7Z_H4, KEF_V15_CTR_H4,
+    KEF_V16_CTR_Z_H4,      KEF_V20_GCM_E4,        KEF_V21_GCM_Z_E4};
+static const uint32_t iteration_mix[] = {10000, 100000, 20000, 50000, 30000};
+
+static const char password[] = "correct horse battery staple";
+static const char other_password[] = "a different passphrase";
+
+static uint8_t *envelopes[ENVELOPES];
+static size_t env_lens[ENVELOPES];
+static char plaintexts[ENVELOPES][128];
+
+/* Expected outcome, from kef_decrypt */
+static kef_error_t expected_err[ENVELOPES];
+
+static int seen[ENVELOPES];
+static int mismatches;
+static int reported;
+static double first_ok_ms = -1;
+static double batch_start_ms;
+
+/* The governor itself is not under test. */
+void power_gov_acquire(power_activity_t activity) { (void)activity; }
+void power_gov_release(power_activity_t activity) { (void)activity; }
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void on_result(void *ctx, size_t index, kef_error_t err,
+                      const uint8_t *data, size_t len) {
+  (void)ctx;
+  reported++;
+  if (index >= ENVELOPES) {
+    mismatches++;
+    return;
+  }
+  seen[index]++;
+  if (err != expected_err[index]) {
+    mismatches++;
+    return;
+  }
+  if (err == KEF_OK) {
+    if (first_ok_ms < 0)
+      first_ok_ms = now_ms() - batch_start_ms;
+    if (!data || len != strlen(plaintexts[index]) ||
+        memcmp(data, plaintexts[index], len) != 0)
+      mismatches++;
+  } else if (data || len) {
+    mismatches++;
+  }
+}
+
+static int make_envelopes(void) {
+  for (int i = 0; i < ENVELOPES; i++) {
+    char id[16];
+    snprintf(id, sizeof(id), "backup-%02d", i);
+    snprintf(plaintexts[i], sizeof(plaintexts[i]),
+             "%02d abandon ability able about above absent absorb abstract "
+             "absurd abuse access accident",
+             i);
+    /* Three under another passphrase */
+    const char *pw = (i % 7 == 3) ? other_password : password;
+    uint8_t version = versions[i % sizeof(versions)];
+    uint32_t iterations = iteration_mix[i % 5];
+    kef_error_t err =
+        kef_encrypt((const uint8_t *)id, strlen(id), version,
+                    (const uint8_t *)pw, strlen(pw), iterations,
+                    (const uint8_t *)plaintexts[i], strlen(plaintexts[i]),
+                    &envelopes[i], &env_lens[i]);
+    CHECK(err == KEF_OK, "encrypt");
+  }
+  /* One cut short inside its header's IV */
+  env_lens[ENVELOPES - 1] = 12;
+  return 0;
+}
+
+int main(void) {
+  if (make_envelopes() != 0)
+    return 1;
+
+  /* Sequential baseline, which also gives the expected outcomes */
+  double start = now_ms();
+  for (int i = 0; i < ENVELOPES; i++) {
+    uint8_t *out = NULL;
+    size_t out_len = 0;
+    expected_err[i] = kef_decrypt(envelopes[i], env_lens[i],
+                                  (const uint8_t *)password, strlen(password),
+                                  &out, &out_len);
+    free(out);
+  }
+  double sequential_ms = now_ms() - start;
+
+  int expected_ok = 0;
+  for (int i = 0; i < ENVELOPES; i++)
+    expected_ok += expected_err[i] == KEF_OK;
+  CHECK(expected_ok == ENVELOPES - 4, "baseline outcomes");
+  CHECK(expected_err[3] == KEF_ERR_AUTH && expected_err[10] == KEF_ERR_AUTH &&
+            expected_err[17] == KEF_ERR_AUTH,
+        "other passphrase fails auth");
+  CHECK(expected_err[ENVELOPES - 1] != KEF_OK, "truncated envelope");
+
+  /* Batch */
+  kef_batch_t *batch = NULL;
+  batch_start_ms = now_ms();
+  CHECK(kef_batch_start((const uint8_t *)password, strlen(password),
+                        (const uint8_t *const *)envelopes, env_lens, ENVELOPES,
+                        &batch) == KEF_OK,
+        "start");
+  /* The truncated one needs no derivation */
+  CHECK(!kef_batch_poll(batch, on_result, NULL) && seen[ENVELOPES - 1] == 1,
+        "malformed envelope reported up front");
+  while (!kef_batch_poll(batch, on_result, NULL))
+    usleep(1000);
+  double batch_ms = now_ms() - batch_start_ms;
+  kef_batch_destroy(batch);
+
+  CHECK(reported == ENVELOPES && mismatches == 0, "batch results");
+  for (int i = 0; i < ENVELOPES; i++)
+    CHECK(seen[i] == 1, "each envelope reported once");
+
+  /* Dropped mid-run: the workers finish what they hold and free the batch */
+  CHECK(kef_batch_start((const uint8_t *)password, strlen(password),
+                        (const uint8_t *const *)envelopes, env_lens, ENVELOPES,
+                        &batch) == KEF_OK,
+        "restart");
+  usleep(5000);
+  kef_batch_destroy(batch);
+  usleep((useconds_t)(sequential_ms * 1000 / 2));
+
+  printf("%d envelopes: sequential %.1f ms, batch %.1f ms (%.2fx), first "
+         "plaintext after %.1f ms\n",
+         ENVELOPES, sequential_ms, batch_ms,
+         batch_ms > 0 ? sequential_ms / batch_ms : 0, first_ok_ms);
+
+  for (int i = 0; i < ENVELOPES; i++)
+    free(envelopes[i]);
+  puts("kef_batch_bench ok");
+  return 0;
+}
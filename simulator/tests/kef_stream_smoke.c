@@ -0,0 +1,369 @@
+#include "core/kef.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "kef_stream_smoke failed: %s (version %u)\n", msg,      \
+              (unsigned)current_version);                                      \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define ITERATIONS 10000
+#define PEAK_LEN (256 * 1024)
+
+static const uint8_t id[] = "StreamSmoke";
+static const uint8_t password[] = "correct horse";
+static uint8_t current_version;
+
+/* ---------- Heap accounting (linked with --wrap=malloc,...) ---------- */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+#define HEAP_HDR 16
+static size_t heap_now = 0;
+static size_t heap_peak = 0;
+
+static void heap_add(size_t size) {
+  heap_now += size;
+  if (heap_now > heap_peak)
+    heap_peak = heap_now;
+}
+
+void *__wrap_malloc(size_t size) {
+  uint8_t *p = __real_malloc(size + HEAP_HDR);
+  if (!p)
+    return NULL;
+  memcpy(p, &size, sizeof(size));
+  heap_add(size);
+  return p + HEAP_HDR;
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  if (size && n > SIZE_MAX / size)
+    return NULL;
+  void *p = __wrap_malloc(n * size);
+  if (p)
+    memset(p, 0, n * size);
+  return p;
+}
+
+void __wrap_free(void *ptr) {
+  if (!ptr)
+    return;
+  uint8_t *p = (uint8_t *)ptr - HEAP_HDR;
+  size_t size;
+  memcpy(&size, p, sizeof(size));
+  heap_now -= size;
+  __real_free(p);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  if (!ptr)
+    return __wrap_malloc(size);
+  size_t old;
+  memcpy(&old, (uint8_t *)ptr - HEAP_HDR, sizeof(old));
+  void *p = __wrap_malloc(size);
+  if (!p)
+    return NULL;
+  memcpy(p, ptr, old < size ? old : size);
+  __wrap_free(ptr);
+  return p;
+}
+
+/* ---------- Sinks ---------- */
+
+typedef struct {
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+  size_t max_chunk;
+} buffer_sink_t;
+
+static bool buffer_sink(void *ctx, const uint8_t *data, size_t len) {
+  buffer_sink_t *b = ctx;
+  if (len > b->max_chunk)
+    b->max_chunk = len;
+  if (b->len + len > b->cap) {
+    size_t cap = b->cap ? b->cap * 2 : 1024;
+    while (cap < b->len + len)
+      cap *= 2;
+    uint8_t *grown = realloc(b->data, cap);
+    if (!grown)
+      return false;
+    b->data = grown;
+    b->cap = cap;
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+  return true;
+}
+
+static void buffer_reset(buffer_sink_t *b) {
+  free(b->data);
+  memset(b, 0, sizeof(*b));
+}
+
+/* Counts and drops, like a sink that hands each chunk to the card. */
+static bool counting_sink(void *ctx, const uint8_t *data, size_t len) {
+  (void)data;
+  *(size_t *)ctx += len;
+  return true;
+}
+
+/* Piece sizes that cross blocks, chunks and the header in every way. */
+static size_t piece_len(size_t i, size_t salt) {
+  return 1 + (i * 389 + salt * 97) % 1100;
+}
+
+static void fill(uint8_t *data, size_t len, uint32_t seed) {
+  for (size_t i = 0; i < len; i++) {
+    seed = seed * 1103515245u + 12345u;
+    data[i] = (uint8_t)(seed >> 16);
+  }
+}
+
+static kef_error_t stream_encrypt(const uint8_t key[32], uint8_t version,
+                                  const uint8_t *pt, size_t len, size_t salt,
+                                  buffer_sink_t *out) {
+  kef_stream_t *s;
+  kef_error_t err = kef_stream_encrypt_init(key, id, sizeof(id) - 1, version,
+                                            ITERATIONS, buffer_sink, out, &s);
+  for (size_t done = 0, i = 0; err == KEF_OK && done < len; i++) {
+    size_t n = piece_len(i, salt);
+    if (n > len - done)
+      n = len - done;
+    err = kef_stream_update(s, pt + done, n);
+    done += n;
+  }
+  if (err != KEF_OK) {
+    kef_stream_abort(s);
+    return err;
+  }
+  return kef_stream_finish(s);
+}
+
+static kef_error_t stream_decrypt(const uint8_t key[32], const uint8_t *env,
+                                  size_t len, size_t salt,
+                                  buffer_sink_t *out) {
+  kef_stream_t *s;
+  kef_error_t err = kef_stream_decrypt_init(key, buffer_sink, out, &s);
+  for (size_t done = 0, i = 0; err == KEF_OK && done < len; i++) {
+    size_t n = salt == 0 ? 1 : piece_len(i, salt);
+    if (n > len - done)
+      n = len - done;
+    err = kef_stream_update(s, env + done, n);
+    done += n;
+  }
+  if (err != KEF_OK) {
+    kef_stream_abort(s);
+    return err;
+  }
+  return kef_stream_finish(s);
+}
+
+static const uint8_t versions[] = {
+    KEF_V0_ECB_NUL_H16,   KEF_V1_CBC_NUL_H16,    KEF_V5_ECB_NUL_E3,
+    KEF_V6_ECB_PKCS7_H4,  KEF_V7_ECB_PKCS7Z_H4,  KEF_V10_CBC_NUL_E4,
+    KEF_V11_CBC_PKCS7_H4, KEF_V12_CBC_PKCS7Z_H4, KEF_V15_CTR_H4,
+    KEF_V16_CTR_Z_H4,     KEF_V20_GCM_E4,        KEF_V21_GCM_Z_E4,
+};
+
+static const size_t lengths[] = {1, 4, 15, 16, 17, 511, 512, 513, 70001};
+
+static int check_version(uint8_t version, const uint8_t key[32],
+                         const uint8_t *pt) {
+  current_version = version;
+  buffer_sink_t out = {0};
+  kef_stream_t *s = NULL;
+
+  if (!kef_stream_supported(version)) {
+    CHECK(kef_stream_encrypt_init(key, id, sizeof(id) - 1, version,
+                                  ITERATIONS, buffer_sink, &out,
+                                  &s) == KEF_ERR_UNSUPPORTED_VERSION &&
+              s == NULL && out.len == 0,
+          "unstreamable version refused on encrypt");
+
+    uint8_t *env = NULL;
+    size_t env_len = 0;
+    CHECK(kef_encrypt(id, sizeof(id) - 1, version, password,
+                      sizeof(password) - 1, ITERATIONS, pt, 40, &env,
+                      &env_len) == KEF_OK,
+          "one-shot encrypt");
+    CHECK(stream_decrypt(key, env, env_len, 3, &out) ==
+              KEF_ERR_UNSUPPORTED_VERSION,
+          "unstreamable version refused on decrypt");
+    free(env);
+    buffer_reset(&out);
+    return 0;
+  }
+
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    size_t len = lengths[i];
+
+    /* Stream out, one-shot back. */
+    CHECK(stream_encrypt(key, version, pt, len, i, &out) == KEF_OK,
+          "stream encrypt");
+    CHECK(out.max_chunk <= KEF_STREAM_CHUNK + 16, "sink chunk too large");
+    uint8_t *dec = NULL;
+    size_t dec_len = 0;
+    CHECK(kef_decrypt(out.data, out.len, password, sizeof(password) - 1, &dec,
+                      &dec_len) == KEF_OK,
+          "one-shot decrypt of a streamed envelope");
+    CHECK(dec_len == len && memcmp(dec, pt, len) == 0,
+          "streamed envelope decrypts to the plaintext");
+    free(dec);
+
+    /* One-shot out, stream back (byte by byte for the short ones). */
+    uint8_t *env = NULL;
+    size_t env_len = 0;
+    CHECK(kef_encrypt(id, sizeof(id) - 1, version, password,
+                      sizeof(password) - 1, ITERATIONS, pt, len, &env,
+                      &env_len) == KEF_OK,
+          "one-shot encrypt");
+    CHECK(env_len == out.len, "stream and one-shot envelope sizes differ");
+    buffer_reset(&out);
+    CHECK(stream_decrypt(key, env, env_len, len < 600 ? 0 : i, &out) ==
+                  KEF_OK &&
+              out.len == len && memcmp(out.data, pt, len) == 0,
+          "stream decrypt of a one-shot envelope");
+    buffer_reset(&out);
+
+    /* Any flipped ciphertext or auth byte is caught at finish. */
+    env[env_len - 1] ^= 0x01;
+    CHECK(stream_decrypt(key, env, env_len, i + 1, &out) == KEF_ERR_AUTH,
+          "tampered auth");
+    env[env_len - 1] ^= 0x01;
+    env[env_len - 1 - len / 2 - 4] ^= 0x80;
+    CHECK(stream_decrypt(key, env, env_len, i + 1, &out) == KEF_ERR_AUTH,
+          "tampered ciphertext");
+    buffer_reset(&out);
+
+    CHECK(stream_decrypt(key, env, env_len - 1 - len, i, &out) != KEF_OK,
+          "truncated envelope");
+    buffer_reset(&out);
+    free(env);
+  }
+
+  CHECK(kef_stream_encrypt_init(key, id, sizeof(id) - 1, version, ITERATIONS,
+                                buffer_sink, &out, &s) == KEF_OK &&
+            kef_stream_finish(s) == KEF_ERR_INVALID_ARG,
+        "empty plaintext refused");
+  buffer_reset(&out);
+  return 0;
+}
+
+static int check_duplicate_blocks(const uint8_t *pt) {
+  current_version = KEF_V6_ECB_PKCS7_H4;
+  uint8_t *env = NULL;
+  size_t env_len = 0;
+
+  /* 4096 distinct blocks: the old pairwise scan made 8M comparisons. */
+  CHECK(kef_encrypt(id, sizeof(id) - 1, KEF_V6_ECB_PKCS7_H4, password,
+                    sizeof(password) - 1, ITERATIONS, pt, 65536, &env,
+                    &env_len) == KEF_OK,
+        "distinct blocks accepted");
+  free(env);
+
+  uint8_t repeated[200];
+  memcpy(repeated, pt, sizeof(repeated));
+  memcpy(repeated + 160, repeated + 32, 16);
+  CHECK(kef_encrypt(id, sizeof(id) - 1, KEF_V6_ECB_PKCS7_H4, password,
+                    sizeof(password) - 1, ITERATIONS, repeated,
+                    sizeof(repeated), &env,
+                    &env_len) == KEF_ERR_DUPLICATE_BLOCKS,
+        "repeated block refused");
+  return 0;
+}
+
+/* Peak heap for a PEAK_LEN payload, not counting the payload itself. */
+static int report_peak(const uint8_t key[32], const uint8_t *pt) {
+  current_version = KEF_V20_GCM_E4;
+  uint8_t *env = NULL;
+  size_t env_len = 0;
+
+  size_t base = heap_now;
+  heap_peak = base;
+  CHECK(kef_encrypt(id, sizeof(id) - 1, KEF_V20_GCM_E4, password,
+                    sizeof(password) - 1, ITERATIONS, pt, PEAK_LEN, &env,
+                    &env_len) == KEF_OK,
+        "one-shot encrypt");
+  size_t oneshot_enc = heap_peak - base;
+
+  base = heap_now;
+  heap_peak = base;
+  uint8_t *dec = NULL;
+  size_t dec_len = 0;
+  CHECK(kef_decrypt(env, env_len, password, sizeof(password) - 1, &dec,
+                    &dec_len) == KEF_OK,
+        "one-shot decrypt");
+  size_t oneshot_dec = heap_peak - base;
+  free(dec);
+
+  size_t counted = 0;
+  kef_stream_t *s;
+  base = heap_now;
+  heap_peak = base;
+  CHECK(kef_stream_encrypt_init(key, id, sizeof(id) - 1, KEF_V20_GCM_E4,
+                                ITERATIONS, counting_sink, &counted,
+                                &s) == KEF_OK,
+        "stream encrypt init");
+  for (size_t done = 0; done < PEAK_LEN; done += 4096)
+    CHECK(kef_stream_update(s, pt + done, 4096) == KEF_OK, "stream update");
+  CHECK(kef_stream_finish(s) == KEF_OK && counted == env_len,
+        "stream encrypt");
+  size_t stream_enc = heap_peak - base;
+
+  counted = 0;
+  base = heap_now;
+  heap_peak = base;
+  CHECK(kef_stream_decrypt_init(key, counting_sink, &counted, &s) == KEF_OK,
+        "stream decrypt init");
+  for (size_t done = 0; done < env_len; done += 4096) {
+    size_t n = env_len - done < 4096 ? env_len - done : 4096;
+    CHECK(kef_stream_update(s, env + done, n) == KEF_OK, "stream update");
+  }
+  CHECK(kef_stream_finish(s) == KEF_OK && counted == PEAK_LEN,
+        "stream decrypt");
+  size_t stream_dec = heap_peak - base;
+  free(env);
+
+  printf("peak heap for %u KB (GCM, beyond the input buffer):\n"
+         "  encrypt: one-shot %zu bytes, stream %zu bytes\n"
+         "  decrypt: one-shot %zu bytes, stream %zu bytes\n",
+         PEAK_LEN / 1024, oneshot_enc, stream_enc, oneshot_dec, stream_dec);
+  CHECK(stream_enc < 4096 && stream_dec < 4096, "stream holds a few KB");
+  CHECK(oneshot_enc > 2 * PEAK_LEN && oneshot_dec > 2 * PEAK_LEN,
+        "one-shot holds the payload twice over");
+  return 0;
+}
+
+int main(void) {
+  uint8_t key[32];
+  CHECK(kef_derive_key(id, sizeof(id) - 1, password, sizeof(password) - 1,
+                       ITERATIONS, key) == KEF_OK,
+        "derive key");
+
+  uint8_t *pt = malloc(PEAK_LEN);
+  CHECK(pt != NULL, "alloc");
+  fill(pt, PEAK_LEN, 7);
+
+  for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+    if (check_version(versions[i], key, pt) != 0)
+      return 1;
+  }
+  if (check_duplicate_blocks(pt) != 0 || report_peak(key, pt) != 0)
+    return 1;
+
+  free(pt);
+  puts("kef_stream_smoke ok");
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * The telemetry module as the firmware uses it: counters before and after
+ * perf_init(), two timers filling the sample ring past its size, the
+ * sampler's first sample and the JSON the SD dump and --perf-json write.
+ */
+
+#include "utils/perf.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "perf_smoke failed: %s\n", msg);                        \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define LONG_RUNS 300
+#define SHORT_RUNS 10
+
+static void timed_long(void) {
+  PERF_BEGIN(long_section);
+  volatile uint32_t x = 0;
+  for (int i = 0; i < 20000; i++)
+    x += i;
+  PERF_END(long_section);
+}
+
+static void timed_short(void) {
+  PERF_BEGIN(short_section);
+  PERF_END(short_section);
+}
+
+static size_t count_of(const char *haystack, const char *needle) {
+  size_t n = 0;
+  for (const char *p = strstr(haystack, needle); p; p = strstr(p + 1, needle))
+    n++;
+  return n;
+}
+
+int main(void) {
+  perf_timer_stats_t t[PERF_MAX_TIMERS];
+
+  /* Counters count from the start; timers wait for perf_init() */
+  PERF_COUNT(PERF_CTR_FRAMES_DECODED);
+  timed_short();
+  CHECK(perf_counter(PERF_CTR_FRAMES_DECODED) == 1, "counter before init");
+  CHECK(perf_timers(t, PERF_MAX_TIMERS) == 0, "timer before init dropped");
+
+  perf_init();
+  for (int i = 0; i < LONG_RUNS; i++)
+    timed_long();
+  for (int i = 0; i < SHORT_RUNS; i++)
+    timed_short();
+  PERF_ADD(PERF_CTR_PARTS_PARSED, 7);
+  PERF_ADD(PERF_CTR_SIGNATURES, 2);
+  PERF_COUNT(PERF_CTR_FRAMES_DECODED);
+
+  CHECK(perf_timers(t, PERF_MAX_TIMERS) == 2, "two timers");
+  CHECK(strcmp(t[0].name, "long_section") == 0 && t[0].count == LONG_RUNS,
+        "long timer");
+  CHECK(strcmp(t[1].name, "short_section") == 0 && t[1].count == SHORT_RUNS,
+        "short timer");
+  CHECK(t[0].min_us <= t[0].max_us && t[0].total_us >= t[0].max_us,
+        "aggregates");
+
+  /* The sampler takes its first sample as it starts */
+  perf_sample_t s;
+  bool sampled = false;
+  for (int i = 0; i < 100 && !sampled; i++) {
+    sampled = perf_latest(&s);
+    if (!sampled)
+      vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  CHECK(sampled, "first sample");
+  CHECK(s.psram_free > 0 && s.psram_largest <= s.psram_free, "heap sample");
+
+  size_t len = 0;
+  char *json = perf_json(&len);
+  CHECK(json && len == strlen(json), "json");
+  CHECK(strstr(json, "\"frames_decoded\": 2") &&
+            strstr(json, "\"parts_parsed\": 7") &&
+            strstr(json, "\"signatures\": 2"),
+        "json counters");
+  CHECK(strstr(json, "{\"name\": \"long_section\", \"count\": 300,"),
+        "json timers");
+  /* The ring keeps the newest PERF_RING_SAMPLES, oldest first */
+  CHECK(count_of(json, "\"at_ms\"") == PERF_RING_SAMPLES, "ring size");
+  CHECK(count_of(json, "{\"timer\": \"short_section\"") == SHORT_RUNS,
+        "ring keeps the newest");
+  const char *last_long = strstr(json, "{\"timer\": \"long_section\"");
+  CHECK(last_long && last_long < strstr(json, "{\"timer\": \"short_section\""),
+        "ring order");
+  CHECK(json[0] == '{' && json[len - 2] == '}', "json object");
+  free(json);
+
+  puts("perf_smoke ok");
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * The mnemonic backup and public key screens through a QR cache against the
+ * uncached updates: formats switched back and forth at two widget sizes (the
+ * plain and the regions view), then zoomed regions. Checks that every cached
+ * drawing is the one the uncached call makes, then prints the time per
+ * interaction both ways. Timings are printed, not checked.
+ */
+
+#include "qr/encoder.h"
+
+#include <lvgl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "qr_cache_bench failed: %s\n", msg);                    \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define ROUNDS 20
+#define PLAIN_SIZE 440
+#define REGIONS_SIZE 400
+
+static const char mnemonic[] =
+    "abandon ability able about above absent absorb abstract absurd abuse "
+    "access accident account accuse achieve acid acoustic acquire across act "
+    "action actor actress actual";
+static const char seedqr[] = "000000010002000300040005000600070008000900100011"
+                             "001200130014001500160017001800190020002100220023";
+static const uint8_t compact[32] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+                                    0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d,
+                                    0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14,
+                                    0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b,
+                                    0x1c, 0x1d, 0x1e, 0x1f};
+static const char *const key_origins[] = {
+    "[73c5da0a/84h/0h/0h]xpub6CatWdiZiodmUeTDp8LT5or8nmbKNcuyvz7WyksVFkKB4RHwCD"
+    "3XyuvPEbvqAQY3rAPshWcMLoP2fMFMKHPJ4ZeZXYVUhLv1VMrjPC7PW6V",
+    "[73c5da0a/49h/0h/0h]ypub6Ww3ibxVfGzLrAH1PNcjyAWenMTbbAosGNB6VvmSEgytSER9az"
+    "LDWCxoJwW7Ke7icmizBMXrzBx9979FfaHxHcrArf3zbeJJJUZPf663zsP",
+    "[73c5da0a/86h/0h/0h]xpub6BgBgsespWvERF3LHQu6CnqdvfEvtMcQjYrcRzx53QJjSxarj2"
+    "afYWcLteoGVky7D3UKDP9QyrLprQ3VCECoY49yfdDEHGCtMMj92pReUsQ"};
+#define KEY_ORIGINS (sizeof(key_origins) / sizeof(key_origins[0]))
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static bool same_canvas(lv_obj_t *a, lv_obj_t *b) {
+  lv_draw_buf_t *da = lv_canvas_get_draw_buf(a);
+  lv_draw_buf_t *db = lv_canvas_get_draw_buf(b);
+  return da && db && da->data_size == db->data_size &&
+         memcmp(da->data, db->data, da->data_size) == 0;
+}
+
+/* One format switch on the backup screen: format i of 3, plain or regions. */
+static lv_result_t show_backup(qr_cache_t *cache, lv_obj_t *qr, int i,
+                               qr_encode_result_t *result) {
+  switch (i % 3) {
+  case 0:
+    return cache ? qr_cache_update_optimal(cache, qr, mnemonic, result)
+                 : qr_update_optimal(qr, mnemonic, result);
+  case 1:
+    return cache ? qr_cache_update_optimal(cache, qr, seedqr, result)
+                 : qr_update_optimal(qr, seedqr, result);
+  default:
+    return cache ? qr_cache_update_binary(cache, qr, compact, sizeof(compact),
+                                          result)
+                 : qr_update_binary(qr, compact, sizeof(compact), result);
+  }
+}
+
+static lv_result_t show_key(qr_cache_t *cache, lv_obj_t *qr, int i) {
+  const char *origin = key_origins[i % KEY_ORIGINS];
+  return cache ? qr_cache_update_optimal(cache, qr, origin, NULL)
+               : qr_update_optimal(qr, origin, NULL);
+}
+
+/* Interactions switching format and, every third, the view size. */
+static int bench_backup(lv_obj_t *plain, lv_obj_t *cached, qr_cache_t *cache,
+                        double *plain_ms, double *cached_ms) {
+  for (int n = 0; n < ROUNDS * 3; n++) {
+    int32_t size = (n / 3) % 2 ? REGIONS_SIZE : PLAIN_SIZE;
+    qr_resize(plain, size);
+    qr_resize(cached, size);
+
+    qr_encode_result_t want, got;
+    double start = now_ms();
+    CHECK(show_backup(NULL, plain, n, &want) == LV_RESULT_OK, "uncached");
+    *plain_ms += now_ms() - start;
+
+    start = now_ms();
+    CHECK(show_backup(cache, cached, n, &got) == LV_RESULT_OK, "cached");
+    *cached_ms += now_ms() - start;
+
+    CHECK(want.modules == got.modules && want.scale == got.scale, "result");
+    CHECK(same_canvas(plain, cached), "backup drawing");
+  }
+  return 0;
+}
+
+static int bench_keys(lv_obj_t *plain, lv_obj_t *cached, qr_cache_t *cache,
+                      double *plain_ms, double *cached_ms) {
+  qr_resize(plain, PLAIN_SIZE);
+  qr_resize(cached, PLAIN_SIZE);
+  for (int n = 0; n < ROUNDS * (int)KEY_ORIGINS; n++) {
+    double start = now_ms();
+    CHECK(show_key(NULL, plain, n) == LV_RESULT_OK, "uncached key");
+    *plain_ms += now_ms() - start;
+
+    start = now_ms();
+    CHECK(show_key(cache, cached, n) == LV_RESULT_OK, "cached key");
+    *cached_ms += now_ms() - start;
+
+    CHECK(same_canvas(plain, cached), "key drawing");
+  }
+  return 0;
+}
+
+/* Zoomed regions of the SeedQR, from a fresh encode and from the cache. */
+static int bench_zoom(lv_obj_t *plain, lv_obj_t *cached, qr_cache_t *cache,
+                      double *plain_ms, double *cached_ms) {
+  static uint8_t qr_buf[QR_CODE_BUF_LEN];
+  for (int n = 0; n < ROUNDS * 4; n++) {
+    int interval = 8 + (n % 4);
+
+    double start = now_ms();
+    int modules = qr_encode_optimal(seedqr, qr_buf);
+    CHECK(modules > 0, "encode");
+    qr_draw_region(plain, qr_buf, interval, interval, interval, interval,
+                   interval, 0, 0);
+    *plain_ms += now_ms() - start;
+
+    start = now_ms();
+    int cached_modules = 0;
+    const uint8_t *modules_buf =
+        qr_cache_encode_optimal(cache, seedqr, &cached_modules);
+    CHECK(modules_buf && cached_modules == modules, "cached encode");
+    qr_draw_region(cached, modules_buf, interval, interval, interval, interval,
+                   interval, 0, 0);
+    *cached_ms += now_ms() - start;
+
+    CHECK(same_canvas(plain, cached), "zoom drawing");
+  }
+  return 0;
+}
+
+int main(void) {
+  lv_init();
+  lv_display_t *display = lv_display_create(PLAIN_SIZE, PLAIN_SIZE);
+  CHECK(display, "display");
+  lv_obj_t *screen = lv_screen_active();
+
+  lv_obj_t *plain = qr_create_optimal(screen, PLAIN_SIZE, NULL);
+  lv_obj_t *cached = qr_create_optimal(screen, PLAIN_SIZE, NULL);
+  CHECK(plain && cached, "widgets");
+
+  qr_cache_t *backup_cache = qr_cache_create();
+  qr_cache_t *key_cache = qr_cache_create();
+  CHECK(backup_cache && key_cache, "caches");
+
+  double backup_plain = 0, backup_cached = 0;
+  double key_plain = 0, key_cached = 0;
+  double zoom_plain = 0, zoom_cached = 0;
+  if (bench_backup(plain, cached, backup_cache, &backup_plain,
+                   &backup_cached) != 0 ||
+      bench_keys(plain, cached, key_cache, &key_plain, &key_cached) != 0 ||
+      bench_zoom(plain, cached, backup_cache, &zoom_plain, &zoom_cached) != 0)
+    return 1;
+
+  qr_cache_destroy(backup_cache);
+  qr_cache_destroy(key_cache);
+  /* A page whose cache failed to allocate draws uncached */
+  CHECK(qr_cache_update_optimal(NULL, cached, mnemonic, NULL) == LV_RESULT_OK,
+        "NULL cache");
+
+  printf("per interaction, uncached / cached: backup format %.3f / %.3f ms, "
+         "public key %.3f / %.3f ms, zoom region %.3f / %.3f ms\n",
+         backup_plain / (ROUNDS * 3), backup_cached / (ROUNDS * 3),
+         key_plain / (ROUNDS * KEY_ORIGINS),
+         key_cached / (ROUNDS * KEY_ORIGINS), zoom_plain / (ROUNDS * 4),
+         zoom_cached / (ROUNDS * 4));
+
+  lv_deinit();
+  puts("qr_cache_bench ok");
+  return 0;
+}
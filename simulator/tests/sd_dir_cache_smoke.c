@@ -0,0 +1,226 @@
+#include "core/sd_dir_cache.h"
+#include "sd_card.h"
+#include "sim_sdcard.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "sd_dir_cache_smoke failed: %s\n", msg);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+/* A folder of exports the size the browser has to cope with. */
+#define FILE_COUNT 5000
+#define SUBDIR_COUNT 20
+#define PAGE 8
+#define EXPORTS SD_CARD_MOUNT_POINT "/exports"
+
+static void remove_tree(const char *path) {
+  DIR *dir = opendir(path);
+  if (!dir)
+    return;
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+
+    char child[512];
+    snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+
+    struct stat st;
+    if (lstat(child, &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode))
+      remove_tree(child);
+    else
+      unlink(child);
+  }
+
+  closedir(dir);
+  rmdir(path);
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* The sniffed kind file i is written as. */
+static sd_file_kind_t kind_of(int i) {
+  static const sd_file_kind_t kinds[] = {SD_FILE_KIND_PSBT, SD_FILE_KIND_PSBT,
+                                         SD_FILE_KIND_FIRMWARE,
+                                         SD_FILE_KIND_TEXT, SD_FILE_KIND_OTHER};
+  return kinds[i % 5];
+}
+
+/* Written straight to the host directory, as a computer would. */
+static int write_host_file(const char *root, int i) {
+  static const uint8_t psbt[] = {'p', 's', 'b', 't', 0xff, 0x01, 0x00};
+  static const uint8_t image[] = {0xE9, 0x04, 0x02, 0x20, 0x00, 0x00};
+  static const uint8_t photo[] = {0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10};
+  static const char base64[] = "cHNidP8BAHECAAAAAQ==\n";
+  static const char text[] = "wsh(sortedmulti(2,...))\n";
+  const void *data;
+  size_t len;
+  switch (i % 5) {
+  case 0:
+    data = psbt, len = sizeof(psbt);
+    break;
+  case 1:
+    data = base64, len = strlen(base64);
+    break;
+  case 2:
+    data = image, len = sizeof(image);
+    break;
+  case 3:
+    data = text, len = strlen(text);
+    break;
+  default:
+    data = photo, len = sizeof(photo);
+    break;
+  }
+
+  char path[512];
+  snprintf(path, sizeof(path), "%s/exports/file-%05d.bin", root, i);
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return -1;
+  size_t n = fwrite(data, 1, len, f);
+  return (fclose(f) == 0 && n == len) ? 0 : -1;
+}
+
+static int entry_index(const sd_dir_listing_t *l, const char *name) {
+  for (int i = 0; i < l->count; i++) {
+    if (strcmp(l->entries[i].name, name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+int main(void) {
+  char root[256];
+  snprintf(root, sizeof(root), "/tmp/kern-sim-sd-dir-%ld", (long)getpid());
+  remove_tree(root);
+  sim_sdcard_set_data_dir(root);
+  CHECK(sd_card_init() == ESP_OK, "sd_card_init");
+
+  char host[512];
+  snprintf(host, sizeof(host), "%s/exports", root);
+  CHECK(mkdir(host, 0755) == 0, "mkdir exports");
+  /* Directories created last: the cache must still put them first. */
+  for (int i = 0; i < FILE_COUNT; i++)
+    CHECK(write_host_file(root, i) == 0, "seed file");
+  for (int i = 0; i < SUBDIR_COUNT; i++) {
+    snprintf(host, sizeof(host), "%s/exports/dir-%02d", root, i);
+    CHECK(mkdir(host, 0755) == 0, "mkdir subdir");
+  }
+
+  sd_dir_listing_t *l = NULL;
+  double t0 = now_ms();
+  CHECK(sd_dir_cache_get(EXPORTS, &l) == ESP_OK, "cold listing");
+  double t1 = now_ms();
+  CHECK(l->count == FILE_COUNT + SUBDIR_COUNT, "entry count");
+  for (int i = 0; i < l->count; i++) {
+    CHECK(l->entries[i].is_dir == (i < SUBDIR_COUNT), "directories first");
+    CHECK(l->entries[i].kind == SD_FILE_KIND_PENDING, "metadata is lazy");
+  }
+
+  sd_dir_listing_t *again = NULL;
+  double t2 = now_ms();
+  for (int i = 0; i < 100; i++)
+    CHECK(sd_dir_cache_get(EXPORTS, &again) == ESP_OK && again == l,
+          "warm listing is the cached one");
+  double t3 = now_ms();
+
+  /* One visible page first, as the browser does, then everything else. */
+  for (int i = SUBDIR_COUNT; i < SUBDIR_COUNT + PAGE; i++) {
+    sd_file_kind_t kind;
+    CHECK(sd_dir_read_meta(EXPORTS, l->entries[i].name, &kind,
+                           &l->entries[i].size) == ESP_OK,
+          "page metadata");
+    l->entries[i].kind = kind;
+  }
+  double t4 = now_ms();
+  for (int i = SUBDIR_COUNT + PAGE; i < l->count; i++) {
+    sd_file_kind_t kind;
+    CHECK(sd_dir_read_meta(EXPORTS, l->entries[i].name, &kind,
+                           &l->entries[i].size) == ESP_OK,
+          "metadata");
+    l->entries[i].kind = kind;
+  }
+  double t5 = now_ms();
+
+  for (int i = SUBDIR_COUNT; i < l->count; i++) {
+    int n = atoi(l->entries[i].name + strlen("file-"));
+    CHECK(l->entries[i].kind == kind_of(n), "sniffed kind");
+    CHECK(l->entries[i].size > 0, "size");
+  }
+  printf("%d entries: cold list %.2f ms, warm list %.4f ms, first page "
+         "metadata %.2f ms, all metadata %.2f ms\n",
+         l->count, t1 - t0, (t3 - t2) / 100, t4 - t3, t5 - t3);
+
+  CHECK(sd_dir_cache_get(EXPORTS, &again) == ESP_OK && again == l &&
+            l->entries[SUBDIR_COUNT].kind != SD_FILE_KIND_PENDING,
+        "metadata kept with the cached listing");
+  uint32_t serial = l->serial;
+
+  /* Invalidation: a write through the API (generation)... */
+  CHECK(sd_card_write_file(EXPORTS "/new.txt", (const uint8_t *)"x", 1) ==
+            ESP_OK,
+        "API write");
+  CHECK(sd_dir_cache_get(EXPORTS, &l) == ESP_OK && l->serial != serial &&
+            entry_index(l, "new.txt") >= 0,
+        "API write invalidates");
+  serial = l->serial;
+
+  /* ...a remount, e.g. after a card swap... */
+  CHECK(sd_card_deinit() == ESP_OK && sd_card_init() == ESP_OK, "remount");
+  CHECK(sd_dir_cache_get(EXPORTS, &l) == ESP_OK && l->serial != serial,
+        "remount invalidates");
+  serial = l->serial;
+
+  /* ...and a file added behind the API's back (directory mtime). */
+  snprintf(host, sizeof(host), "%s/exports/external.txt", root);
+  FILE *f = fopen(host, "w");
+  CHECK(f && fputs("hi\n", f) >= 0 && fclose(f) == 0, "external write");
+  CHECK(sd_dir_cache_get(EXPORTS, &l) == ESP_OK && l->serial != serial &&
+            entry_index(l, "external.txt") >= 0,
+        "mtime change invalidates");
+
+  /* Least recently used directory goes once more are visited than fit. */
+  serial = l->serial;
+  for (int i = 0; i < SD_DIR_CACHE_SLOTS - 1; i++) {
+    char sub[128];
+    snprintf(sub, sizeof(sub), EXPORTS "/dir-%02d", i);
+    CHECK(sd_dir_cache_get(sub, &again) == ESP_OK && again->count == 0,
+          "subdir listing");
+  }
+  CHECK(sd_dir_cache_get(EXPORTS, &l) == ESP_OK && l->serial == serial,
+        "still cached with every slot in use");
+  for (int i = SD_DIR_CACHE_SLOTS - 1; i < 2 * SD_DIR_CACHE_SLOTS; i++) {
+    char sub[128];
+    snprintf(sub, sizeof(sub), EXPORTS "/dir-%02d", i);
+    CHECK(sd_dir_cache_get(sub, &again) == ESP_OK, "subdir listing");
+  }
+  CHECK(sd_dir_cache_get(EXPORTS, &l) == ESP_OK && l->serial != serial,
+        "evicted once least recently used");
+
+  CHECK(sd_dir_cache_get(EXPORTS "/missing", &l) != ESP_OK && l == NULL,
+        "missing directory");
+
+  sd_dir_cache_clear();
+  remove_tree(root);
+  puts("sd_dir_cache_smoke ok");
+  return 0;
+}
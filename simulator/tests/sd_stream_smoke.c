@@ -0,0 +1,176 @@
+#include "sd_card.h"
+#include "sim_sdcard.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "sd_stream_smoke failed: %s\n", msg);                   \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define FILE_LEN 100000
+#define PATH SD_CARD_MOUNT_POINT "/kern/stream.bin"
+
+static void remove_tree(const char *path) {
+  DIR *dir = opendir(path);
+  if (!dir)
+    return;
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+
+    char child[512];
+    snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+
+    struct stat st;
+    if (lstat(child, &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode))
+      remove_tree(child);
+    else
+      unlink(child);
+  }
+
+  closedir(dir);
+  rmdir(path);
+}
+
+/* Chunk sizes that straddle the bounce buffer in every possible way. */
+static size_t chunk_len(size_t i) { return 1 + (i * 389) % 1500; }
+
+static int read_back(const uint8_t *expected, bool read_ahead) {
+  sd_card_stream_config_t config = {.buffer_size = 1000,
+                                    .read_ahead = read_ahead};
+  sd_card_stream_t *s = NULL;
+  CHECK(sd_card_stream_open(PATH, SD_CARD_STREAM_READ, &config, &s) == ESP_OK,
+        "open for reading");
+
+  size_t size = 0;
+  CHECK(sd_card_stream_size(s, &size) == ESP_OK && size == FILE_LEN,
+        "stream size");
+
+  uint8_t *got = malloc(FILE_LEN + 1);
+  CHECK(got != NULL, "alloc");
+  size_t done = 0, n = 0;
+  for (size_t i = 0;; i++) {
+    CHECK(sd_card_stream_read_chunk(s, got + done, chunk_len(i), &n) ==
+              ESP_OK,
+          "read chunk");
+    if (n == 0)
+      break;
+    done += n;
+    CHECK(done <= FILE_LEN, "read past end");
+  }
+  CHECK(done == FILE_LEN && memcmp(got, expected, FILE_LEN) == 0,
+        "chunked read matches");
+
+  /* Backwards into the current buffer, far back, forwards, and to the end. */
+  static const size_t offsets[] = {FILE_LEN - 5, 0, 3, 50000, 49999, 99990};
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+    uint8_t buf[10];
+    size_t want = FILE_LEN - offsets[i] < sizeof(buf) ? FILE_LEN - offsets[i]
+                                                      : sizeof(buf);
+    CHECK(sd_card_stream_seek(s, offsets[i]) == ESP_OK, "seek");
+    CHECK(sd_card_stream_read_chunk(s, buf, sizeof(buf), &n) == ESP_OK &&
+              n == want && memcmp(buf, expected + offsets[i], want) == 0,
+          "read after seek");
+  }
+  CHECK(sd_card_stream_seek(s, FILE_LEN) == ESP_OK &&
+            sd_card_stream_read_chunk(s, got, 1, &n) == ESP_OK && n == 0,
+        "seek to end reads nothing");
+
+  CHECK(sd_card_stream_write_chunk(s, got, 1) == ESP_ERR_INVALID_ARG,
+        "write on a read stream");
+  free(got);
+  CHECK(sd_card_stream_close(s) == ESP_OK, "close read stream");
+  return 0;
+}
+
+int main(void) {
+  char root[256];
+  snprintf(root, sizeof(root), "/tmp/kern-sim-sd-stream-%ld", (long)getpid());
+  remove_tree(root);
+  sim_sdcard_set_data_dir(root);
+
+  sd_card_stream_t *s = NULL;
+  CHECK(sd_card_stream_open(PATH, SD_CARD_STREAM_WRITE, NULL, &s) ==
+            ESP_ERR_INVALID_STATE,
+        "open before mount");
+  CHECK(sd_card_init() == ESP_OK, "sd_card_init");
+
+  uint8_t *data = malloc(FILE_LEN);
+  CHECK(data != NULL, "alloc");
+  for (size_t i = 0; i < FILE_LEN; i++)
+    data[i] = (uint8_t)(i * 7 + (i >> 8));
+
+  sd_card_stream_config_t config = {.buffer_size = 1000};
+  CHECK(sd_card_stream_open(PATH, SD_CARD_STREAM_WRITE, &config, &s) ==
+            ESP_OK,
+        "open for writing");
+  for (size_t done = 0, i = 0; done < FILE_LEN; i++) {
+    size_t n = chunk_len(i);
+    if (n > FILE_LEN - done)
+      n = FILE_LEN - done;
+    CHECK(sd_card_stream_write_chunk(s, data + done, n) == ESP_OK,
+          "write chunk");
+    done += n;
+  }
+  CHECK(sd_card_stream_close(s) == ESP_OK, "close write stream");
+
+  uint8_t *whole = NULL;
+  size_t whole_len = 0;
+  CHECK(sd_card_read_file(PATH, &whole, &whole_len) == ESP_OK &&
+            whole_len == FILE_LEN && memcmp(whole, data, FILE_LEN) == 0,
+        "streamed write matches read_file");
+  free(whole);
+
+  if (read_back(data, false) != 0 || read_back(data, true) != 0)
+    return 1;
+
+  CHECK(sd_card_stream_open(PATH, SD_CARD_STREAM_APPEND, NULL, &s) == ESP_OK,
+        "open for appending");
+  CHECK(sd_card_stream_write_chunk(s, data, 10) == ESP_OK &&
+            sd_card_stream_close(s) == ESP_OK,
+        "append");
+  size_t size = 0;
+  CHECK(sd_card_file_size(PATH, &size) == ESP_OK && size == FILE_LEN + 10,
+        "append grows the file");
+
+  CHECK(sd_card_stream_open(SD_CARD_MOUNT_POINT "/missing.bin",
+                            SD_CARD_STREAM_READ, NULL, &s) ==
+                ESP_ERR_NOT_FOUND &&
+            s == NULL,
+        "missing file");
+  CHECK(sd_card_stream_open(SD_CARD_MOUNT_POINT "/../escape.bin",
+                            SD_CARD_STREAM_WRITE, NULL, &s) ==
+            ESP_ERR_INVALID_ARG,
+        "traversal rejected");
+  CHECK(sd_card_stream_close(NULL) == ESP_OK, "close NULL");
+
+  sd_card_self_test_result_t result;
+  size_t count = 0;
+  CHECK(sd_card_self_test(256 * 1024, &result, 1, &count) == ESP_OK &&
+            count == 1 && result.write_mbps > 0 && result.read_mbps > 0 &&
+            result.read_ahead_mbps > 0,
+        "self-test reports throughput");
+  bool exists = true;
+  CHECK(sd_card_file_exists(SD_CARD_MOUNT_POINT "/.kern_speed.tmp",
+                            &exists) == ESP_OK &&
+            !exists,
+        "self-test removes its scratch file");
+
+  free(data);
+  remove_tree(root);
+  puts("sd_stream_smoke ok");
+  return 0;
+}
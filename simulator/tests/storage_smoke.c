@@ -1,6 +1,7 @@
 #include "core/storage.h"
 #include "core/kef.h"
 #include "sim_flash.h"
+#include "sim_sdcard.h"
 
 #include <dirent.h>
 #include <stdio.h>
@@ -88,6 +89,8 @@ int main(void) {
   char flash_root[320];
   char nvs_root[320];
   char sentinel[384];
+  char sd_root[320];
+  snprintf(sd_root, sizeof(sd_root), "%s/sdcard", root);
   snprintf(flash_root, sizeof(flash_root), "%s/spiffs", root);
   snprintf(nvs_root, sizeof(nvs_root), "%s/nvs", root);
   snprintf(sentinel, sizeof(sentinel), "%s/settings.nvs", nvs_root);
@@ -100,6 +103,7 @@ int main(void) {
   fclose(nf);
 
   sim_flash_set_data_dir(flash_root);
+  sim_sdcard_set_data_dir(sd_root);
   CHECK(storage_init() == ESP_OK, "storage_init");
 
   uint8_t *kef_blob = NULL;
@@ -193,6 +197,45 @@ int main(void) {
         "plaintext descriptor round-trip");
   free(loaded);
 
+  /* A descriptor backup streamed to SD loads back as if saved whole. */
+  uint8_t big[5000];
+  for (size_t i = 0; i < sizeof(big); i++)
+    big[i] = (uint8_t)(i * 7 + i / 256);
+  uint8_t key[32];
+  CHECK(kef_derive_key((const uint8_t *)"Big Backup", 10, password,
+                       strlen((const char *)password), 10000,
+                       key) == KEF_OK,
+        "derive key");
+  CHECK(storage_save_descriptor_stream("Big Backup", key, KEF_V20_GCM_E4, 10000,
+                                       big, sizeof(big)) == ESP_OK,
+        "stream descriptor to SD");
+  CHECK(storage_save_descriptor_stream("Big Backup", key, KEF_V21_GCM_Z_E4,
+                                       10000, big, sizeof(big)) ==
+            ESP_ERR_NOT_SUPPORTED,
+        "compressed versions are not streamed");
+
+  CHECK(storage_load_descriptor(STORAGE_SD, "Big_Backup.kef", &loaded,
+                                &loaded_len, &encrypted) == ESP_OK &&
+            encrypted,
+        "load streamed descriptor");
+  CHECK(kef_decrypt(loaded, loaded_len, password,
+                    strlen((const char *)password), &decrypted,
+                    &decrypted_len) == KEF_OK,
+        "decrypt streamed descriptor");
+  CHECK(expect_loaded(big, sizeof(big), decrypted, decrypted_len,
+                      "streamed descriptor") == 0,
+        "streamed descriptor round-trip");
+  free(decrypted);
+  free(loaded);
+
+  storage_sd_writer_t *writer = NULL;
+  CHECK(storage_open_descriptor_writer("Dropped", &writer) == ESP_OK &&
+            storage_sd_writer_sink(writer, big, 100),
+        "open second writer");
+  CHECK(storage_sd_writer_close(writer, false) == ESP_OK &&
+            !storage_descriptor_exists(STORAGE_SD, "Dropped", true),
+        "abandoned stream leaves no file");
+
   CHECK(storage_delete_mnemonic(STORAGE_FLASH, "m_Smoke_Name.kef") == ESP_OK,
         "delete mnemonic");
   CHECK(!storage_mnemonic_exists(STORAGE_FLASH, "Smoke Name"),